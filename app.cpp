@@ -3,13 +3,28 @@
 static const int kBackBufferCount = 3;
 static const int kScreenWidth = 1920;
 static const int kScreenHeight = 1080;
+// the per frame descriptors cycle through the first 1024 entries of the global heap, the bindless material
+// textures follow them.
+static const int kMaterialTextureHeapStart = 1024;
+// software occlusion culling resolution and the number of largest meshes drawn into it.
+static const int kOcclusionWidth = 256;
+static const int kOcclusionHeight = 144;
+static const int kOccluderCount = 16;
+// the timestamp pairs of a frame.
+static const int kGpuProfilerPassCount = 16;
+// seconds a clip switch fades from the pose of the previous clip.
+static const float kAnimationFadeTime = 0.3f;
 
 #include <random>
 #include <utility>
 #include <algorithm>
 #include <thread>
+#include <chrono>
+#include <string>
 
 #include "tools/input.h"
+#include "tools/batch_math.h"
+#include "tools/cpu_profiler.h"
 
 #include "imgui_dx12/imgui.h"
 #include "imgui_dx12/imgui_impl_win32.h"
@@ -29,9 +44,15 @@ App::~App() {
 }
 
 bool App::initialize(HWND hwnd) {
+	CpuProfiler::Instance().setThreadName("main");
+	CPU_PROFILE_SCOPE("initialize");
 
+	CpuProfileScope stage("device");
 	m_device.create();
 
+	PipelineCache::Instance().open(m_device.getDevice(), "pipeline_cache.bin");
+	m_pipelineCompiler.create();
+
 	m_queue.createGraphicsQueue(m_device.getDevice());
 
 	m_swapchain.create(m_queue.getQueue(), hwnd, kBackBufferCount, kScreenWidth, kScreenHeight, false);
@@ -47,7 +68,11 @@ bool App::initialize(HWND hwnd) {
 
 	m_presentFence.create(m_device.getDevice());
 
+	// the frame runs the same without timestamps, only the gpu timings are missing.
+	if (!m_gpuProfiler.create(m_device.getDevice(), m_queue.getQueue(), kBackBufferCount, kGpuProfilerPassCount))
+		OutputDebugString("app: gpu timing is off.\n");
 
+	stage.next("render targets");
 	m_backBuffer = resMgr.createBackBuffer(m_device.getDevice(), m_swapchain.getSwapchain(), kBackBufferCount);
 
 	m_depthBuffer = resMgr.createDepthStencilBuffer(m_device.getDevice(), kBackBufferCount, kScreenWidth, kScreenHeight, false);
@@ -57,11 +82,14 @@ bool App::initialize(HWND hwnd) {
 	m_visibilityBuffer = resMgr.createRenderTarget2D(m_device.getDevice(), kBackBufferCount, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
 		DXGI_FORMAT_R32G32_UINT, kScreenWidth, kScreenHeight);
 
+	m_renderingBuffer = resMgr.createRenderTarget2D(m_device.getDevice(), kBackBufferCount, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		DXGI_FORMAT_R8G8B8A8_UNORM, kScreenWidth, kScreenHeight);
+
+	stage.next("model");
 	m_model.create(m_device.getDevice(), m_queue.getQueue(), "models/sponza/gltf/", "models/sponza/gltf/sponza.gltf");
 
+	D3D12_SAMPLER_DESC samplerDesc{};
 	{
-
-		D3D12_SAMPLER_DESC samplerDesc{};
 		samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
 		samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
 		samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
@@ -79,15 +107,46 @@ bool App::initialize(HWND hwnd) {
 		m_wrapSampler = resMgr.addSamplerState(samplerDesc);
 	}
 
+	stage.next("shaders");
+	auto shaderLoadStart = std::chrono::high_resolution_clock::now();
+
 	m_vs = resMgr.addVertexShader(L"shaders/vs.fx");
 	m_ps = resMgr.addPixelShader(L"shaders/ps.fx");
+	m_drawCullCS = resMgr.addComputeShader(L"shaders/draw_cull_cs.fx");
+	m_hiZBuildCS = resMgr.addComputeShader(L"shaders/hiz_build_cs.fx");
 	m_materialCountCS = resMgr.addComputeShader(L"shaders/material_count_cs.fx");
+	m_materialArgsCS = resMgr.addComputeShader(L"shaders/material_args_cs.fx");
 	m_materialSortCS = resMgr.addComputeShader(L"shaders/material_sort_cs.fx");
-	m_renderingCS = resMgr.addComputeShader(L"shaders/rendering_cs.fx");
+	m_skinningCS = resMgr.addComputeShader(L"shaders/skinning_cs.fx");
+
+	m_renderingPermutation.setSource(L"shaders/rendering_cs.fx", L"main", L"cs_6_0");
+	m_visibilityDebugFeature = m_renderingPermutation.addFeature(L"VISIBILITY_DEBUG");
+	m_albedoMapFeature = m_renderingPermutation.addFeature(L"HAS_ALBEDO_MAP");
+	m_normalMapFeature = m_renderingPermutation.addFeature(L"HAS_NORMAL_MAP");
+	m_roughMetalMapFeature = m_renderingPermutation.addFeature(L"HAS_ROUGH_METAL_MAP");
+
+	if (!createMaterialData() || !createDrawCullData() || !createHiZData() || !createSkinningData())
+		return false;
+
+	std::vector<uint32_t> renderingVariants = m_closureFeatures;
+	renderingVariants.push_back(0);
+	renderingVariants.push_back(m_visibilityDebugFeature);
+	m_renderingPermutation.compile(renderingVariants);
+
+	{
+		// compare a run with an empty shader_cache directory against a warm one.
+		auto shaderLoadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - shaderLoadStart);
+		std::string message = "shader load: " + std::to_string(shaderLoadTime.count()) + " ms\n";
+		OutputDebugString(message.c_str());
+	}
 
-	m_rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 0, 1);
-	m_rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
-	m_rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 0, 1);
+	stage.next("pipelines");
+	m_rootSignature.addRootDescriptor(D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_PARAMETER_TYPE_CBV, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+	// draw id and closure id, the vertex shader finds the instances of the draw and the pixel shader writes the closure.
+	m_rootSignature.addConstants(D3D12_SHADER_VISIBILITY_ALL, 1, 2);
+	// the draw instances and the instance buffer.
+	m_rootSignature.addRootDescriptor(D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_PARAMETER_TYPE_SRV, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC);
+	m_rootSignature.addRootDescriptor(D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_PARAMETER_TYPE_SRV, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC);
 	m_rootSignature.create(m_device.getDevice(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
@@ -111,84 +170,331 @@ bool App::initialize(HWND hwnd) {
 	m_pipeline.setPixelShader(ps->getByteCode());
 	m_pipeline.setPrimitiveType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
 
-	m_pipeline.create(m_device.getDevice(), m_rootSignature.getRootSignature());
+	m_pipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_rootSignature.getRootSignature());
 
-	m_materialCountRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 0, 1);
-	m_materialCountRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
-	m_materialCountRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
-	m_materialCountRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
-
-	m_materialCountRS.create(m_device.getDevice(),
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS);
+	{
+		ShaderReflection vsReflection;
+		ShaderReflection psReflection;
+		vsReflection.create(vs->getByteCode(), D3D12_SHADER_VISIBILITY_VERTEX);
+		psReflection.create(ps->getByteCode(), D3D12_SHADER_VISIBILITY_PIXEL);
+
+		BindingLayout layout;
+		layout.merge(vsReflection);
+		layout.merge(psReflection);
+		if (!layout.validate(&m_rootSignature))
+			return false;
+	}
 
+	ShaderSp drawCullCS = resMgr.GetShader(m_drawCullCS);
+	ShaderSp hiZBuildCS = resMgr.GetShader(m_hiZBuildCS);
 	ShaderSp materialCountCS = resMgr.GetShader(m_materialCountCS);
+	ShaderSp materialArgsCS = resMgr.GetShader(m_materialArgsCS);
 	ShaderSp materialSortCS = resMgr.GetShader(m_materialSortCS);
-	ShaderSp renderingCS = resMgr.GetShader(m_renderingCS);
-
-	m_materialSortRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
-	m_materialSortRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
-	m_materialSortRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1);
-	m_materialSortRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 1);
+	ShaderSp skinningCS = resMgr.GetShader(m_skinningCS);
 
-	m_materialSortRS.create(m_device.getDevice(),
+	const D3D12_ROOT_SIGNATURE_FLAGS computeRootSignatureFlags =
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS);
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 0, 1);
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 1);
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 1);
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 1);
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 0, 1);
-	m_renderingRS.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
-	m_renderingRS.create(m_device.getDevice(),
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS);
+	{
+		m_drawCullLayout.setRootConstants("CullPhaseConstant", 1);
+
+		ShaderReflection reflection;
+		if (reflection.create(drawCullCS->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) &&
+			m_drawCullLayout.merge(reflection) &&
+			m_drawCullLayout.createRootSignature(m_device.getDevice(), &m_drawCullRS, computeRootSignatureFlags)) {
+			m_drawCullPipeline.setComputeShader(drawCullCS->getByteCode());
+			m_drawCullPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_drawCullRS.getRootSignature());
+		}
+	}
 
+	{
+		ShaderReflection reflection;
+		if (reflection.create(hiZBuildCS->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) &&
+			m_hiZBuildLayout.merge(reflection) &&
+			m_hiZBuildLayout.createRootSignature(m_device.getDevice(), &m_hiZBuildRS, computeRootSignatureFlags)) {
+			m_hiZBuildPipeline.setComputeShader(hiZBuildCS->getByteCode());
+			m_hiZBuildPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_hiZBuildRS.getRootSignature());
+		}
+	}
 
-	m_materialCountPipeline.setComputeShader(materialCountCS->getByteCode());
-	m_materialCountPipeline.create(m_device.getDevice(), m_materialCountRS.getRootSignature());
+	// the root constants of the visibility pass come first in every draw command.
+	m_drawSignature.addConstant(1, 0, 2);
+	m_drawSignature.addDrawIndexedCommand();
+	if (m_drawSignature.createDrawIndirect(m_device.getDevice(), m_rootSignature.getRootSignature()) &&
+		m_drawSignature.getByteStride() != sizeof(IndirectDrawCommand)) {
+		OutputDebugString("draw command signature does not match IndirectDrawCommand.\n");
+	}
 
-	m_materialSortPipeline.setComputeShader(materialSortCS->getByteCode());
-	m_materialSortPipeline.create(m_device.getDevice(), m_materialSortRS.getRootSignature());
+	{
+		ShaderReflection reflection;
+		if (reflection.create(materialCountCS->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) &&
+			m_materialCountLayout.merge(reflection) &&
+			m_materialCountLayout.createRootSignature(m_device.getDevice(), &m_materialCountRS, computeRootSignatureFlags)) {
+			m_materialCountPipeline.setComputeShader(materialCountCS->getByteCode());
+			m_materialCountPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_materialCountRS.getRootSignature());
+		}
+	}
 
-	m_renderingPipeline.setComputeShader(renderingCS->getByteCode());
-	m_renderingPipeline.create(m_device.getDevice(), m_renderingRS.getRootSignature());
+	{
+		ShaderReflection reflection;
+		if (reflection.create(materialArgsCS->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) &&
+			m_materialArgsLayout.merge(reflection) &&
+			m_materialArgsLayout.createRootSignature(m_device.getDevice(), &m_materialArgsRS, computeRootSignatureFlags)) {
+			m_materialArgsPipeline.setComputeShader(materialArgsCS->getByteCode());
+			m_materialArgsPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_materialArgsRS.getRootSignature());
+		}
+	}
 
-	resMgr.updateDescriptorHeap(&m_device, 1024 * kBackBufferCount);
+	{
+		ShaderReflection reflection;
+		if (reflection.create(materialSortCS->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) &&
+			m_materialSortLayout.merge(reflection) &&
+			m_materialSortLayout.createRootSignature(m_device.getDevice(), &m_materialSortRS, computeRootSignatureFlags)) {
+			m_materialSortPipeline.setComputeShader(materialSortCS->getByteCode());
+			m_materialSortPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_materialSortRS.getRootSignature());
+		}
+	}
 
+	m_materialSortSignature.createDispatchIndirect(m_device.getDevice(), nullptr);
+
+	{
+		m_skinningLayout.setRootConstants("SkinningConstant", 1);
+
+		ShaderReflection reflection;
+		if (reflection.create(skinningCS->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) &&
+			m_skinningLayout.merge(reflection) &&
+			m_skinningLayout.createRootSignature(m_device.getDevice(), &m_skinningRS, computeRootSignatureFlags)) {
+			m_skinningPipeline.setComputeShader(skinningCS->getByteCode());
+			m_skinningPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_skinningRS.getRootSignature());
+		}
+	}
+
+	{
+		m_renderingLayout.setStaticSampler("wrapSampler", samplerDesc);
+		m_renderingLayout.setRootConstants("ClosureConstant", 2);
+
+		// the variants only differ in the resources they read, one root signature covers all of them.
+		bool isMerged = true;
+		for (uint32_t features : renderingVariants) {
+			ShaderSp variant = m_renderingPermutation.getVariant(features);
+			ShaderReflection reflection;
+			isMerged = isMerged && variant && reflection.create(variant->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) && m_renderingLayout.merge(reflection);
+		}
+
+		if (isMerged && m_renderingLayout.createRootSignature(m_device.getDevice(), &m_renderingRS, computeRootSignatureFlags)) {
+			m_renderingPipeline.setComputeShader(m_renderingPermutation.getVariant(0)->getByteCode());
+			m_renderingPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_renderingRS.getRootSignature());
+
+			m_visibilityDebugPipeline.setComputeShader(m_renderingPermutation.getVariant(m_visibilityDebugFeature)->getByteCode());
+			m_visibilityDebugPipeline.createAsync(&m_pipelineCompiler, m_device.getDevice(), m_renderingRS.getRootSignature());
+
+			m_closurePipelines.resize(m_closureFeatures.size());
+			for (size_t i = 0; i < m_closureFeatures.size(); i++) {
+				m_closurePipelines[i].setComputeShader(m_renderingPermutation.getVariant(m_closureFeatures[i])->getByteCode());
+				m_closurePipelines[i].setFallback(&m_renderingPipeline);
+				m_closurePipelines[i].createAsync(&m_pipelineCompiler, m_device.getDevice(), m_renderingRS.getRootSignature());
+			}
+
+			// the root constants come first in every record of the argument buffer, followed by the dispatch.
+			m_materialShadingSignature.addConstant(m_renderingLayout.getRootParameterIndex("ClosureConstant"), 0, 2);
+			m_materialShadingSignature.addDispatchCommand();
+			if (m_materialShadingSignature.createDispatchIndirect(m_device.getDevice(), m_renderingRS.getRootSignature()) &&
+				m_materialShadingSignature.getByteStride() != kClosureArgumentStride * sizeof(uint32_t)) {
+				OutputDebugString("material shading command signature does not match the argument buffer layout.\n");
+			}
+		}
+	}
+
+	{
+		auto addShader = [this](const ShaderSource& source, ShaderSp shader) {
+			int handle = m_shaderHotReload.addShader(source);
+			m_shaderCompiler.setShader(handle, shader);
+			return handle;
+		};
+		m_shaderHotReload.setCompiler(&m_shaderCompiler);
+
+		int vsHandle = addShader({ L"shaders/vs.fx", L"main", L"vs_6_0", {} }, vs);
+		int psHandle = addShader({ L"shaders/ps.fx", L"main", L"ps_6_0", {} }, ps);
+		int drawCullHandle = addShader({ L"shaders/draw_cull_cs.fx", L"main", L"cs_6_0", {} }, drawCullCS);
+		int hiZBuildHandle = addShader({ L"shaders/hiz_build_cs.fx", L"main", L"cs_6_0", {} }, hiZBuildCS);
+		int materialCountHandle = addShader({ L"shaders/material_count_cs.fx", L"main", L"cs_6_0", {} }, materialCountCS);
+		int materialArgsHandle = addShader({ L"shaders/material_args_cs.fx", L"main", L"cs_6_0", {} }, materialArgsCS);
+		int materialSortHandle = addShader({ L"shaders/material_sort_cs.fx", L"main", L"cs_6_0", {} }, materialSortCS);
+		int skinningHandle = addShader({ L"shaders/skinning_cs.fx", L"main", L"cs_6_0", {} }, skinningCS);
+
+		m_shaderHotReload.addPipeline({ vsHandle, psHandle }, [this, vsHandle, psHandle]() {
+			Pipeline pipeline = m_pipeline;
+			pipeline.setVertexShader(m_shaderCompiler.getShader(vsHandle)->getByteCode());
+			pipeline.setPixelShader(m_shaderCompiler.getShader(psHandle)->getByteCode());
+			if (!pipeline.create(m_device.getDevice(), m_rootSignature.getRootSignature()))
+				return false;
+
+			retirePipeline(m_pipeline.getPipelineState());
+			m_pipeline = pipeline;
+			return true;
+		});
+		m_shaderHotReload.addPipeline({ drawCullHandle }, [this, drawCullHandle]() {
+			return reloadComputePipeline(&m_drawCullPipeline, &m_drawCullRS, drawCullHandle);
+		});
+		m_shaderHotReload.addPipeline({ hiZBuildHandle }, [this, hiZBuildHandle]() {
+			return reloadComputePipeline(&m_hiZBuildPipeline, &m_hiZBuildRS, hiZBuildHandle);
+		});
+		m_shaderHotReload.addPipeline({ materialCountHandle }, [this, materialCountHandle]() {
+			return reloadComputePipeline(&m_materialCountPipeline, &m_materialCountRS, materialCountHandle);
+		});
+		m_shaderHotReload.addPipeline({ materialArgsHandle }, [this, materialArgsHandle]() {
+			return reloadComputePipeline(&m_materialArgsPipeline, &m_materialArgsRS, materialArgsHandle);
+		});
+		m_shaderHotReload.addPipeline({ materialSortHandle }, [this, materialSortHandle]() {
+			return reloadComputePipeline(&m_materialSortPipeline, &m_materialSortRS, materialSortHandle);
+		});
+		m_shaderHotReload.addPipeline({ skinningHandle }, [this, skinningHandle]() {
+			return reloadComputePipeline(&m_skinningPipeline, &m_skinningRS, skinningHandle);
+		});
+
+		auto addRenderingVariant = [this, &addShader](uint32_t features, ComputePipeline* pipeline) {
+			int handle = addShader({ L"shaders/rendering_cs.fx", L"main", L"cs_6_0", m_renderingPermutation.getDefines(features) },
+				m_renderingPermutation.getVariant(features));
+			m_shaderHotReload.addPipeline({ handle }, [this, pipeline, handle]() {
+				return reloadComputePipeline(pipeline, &m_renderingRS, handle);
+			});
+		};
+		addRenderingVariant(0, &m_renderingPipeline);
+		addRenderingVariant(m_visibilityDebugFeature, &m_visibilityDebugPipeline);
+		for (size_t i = 0; i < m_closurePipelines.size(); i++)
+			addRenderingVariant(m_closureFeatures[i], &m_closurePipelines[i]);
+
+		m_shaderHotReload.create(L"shaders");
+	}
+
+	stage.next("descriptor heap");
+	// the hi-z views follow the material textures.
+	m_hiZHeapStart = kMaterialTextureHeapStart + (int)m_materialTextures.size();
+	resMgr.updateDescriptorHeap(&m_device, std::max(1024 * kBackBufferCount, m_hiZHeapStart + 1 + (int)kHiZMipCount));
+
+	for (size_t i = 0; i < m_materialTextures.size(); i++)
+		resMgr.getGlobalHeap(kMaterialTextureHeapStart + (int)i, m_materialTextures[i], 0);
+
+	createHiZViews();
+
+	stage.next("initial transitions");
+	{
+		// the frame expects these resources in a fixed state between frames, move them there once.
+		CommandAllocator commandAllocator;
+		CommandList commandList;
+		if (!commandAllocator.createGraphicsCommandAllocator(m_device.getDevice()) ||
+			!commandList.createGraphicsCommandList(m_device.getDevice(), commandAllocator.getCommandAllocator()))
+			return false;
+
+		ID3D12GraphicsCommandList* command = commandList.getCommandList();
+		command->Reset(commandAllocator.getCommandAllocator(), nullptr);
+
+		for (int i = 0; i < kBackBufferCount; i++) {
+			resMgr.getResourceAsTexture(m_visibilityBuffer)->transitionResource(command, i, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			resMgr.getResourceAsTexture(m_renderingBuffer)->transitionResource(command, i, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		}
+
+		for (int id : { m_closureTileCountBuffer, m_closureTileOffsetBuffer, m_closureTileCursorBuffer, m_workItemBuffer, m_sortedTileBuffer, m_materialArgumentBuffer })
+			resMgr.getResourceAsStuructured(id)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		for (int id : { m_drawCommandBuffer, m_drawCommandCountBuffer, m_lateDrawCommandBuffer, m_lateDrawCommandCountBuffer, m_drawVisibilityBuffer, m_hiZCounterBuffer })
+			resMgr.getResourceAsStuructured(id)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		resMgr.getResourceAsTexture(m_hiZBuffer)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		for (int id : { m_drawInstanceBuffer, m_drawBuffer, m_instanceBuffer, m_materialBuffer })
+			resMgr.getResourceAsStuructured(id)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+		if (m_model.isSkinned()) {
+			resMgr.getResourceAsStuructured(m_skinVertexBuffer)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			for (int i = 0; i < kBackBufferCount; i++) {
+				resMgr.getResourceAsStuructured(m_skinnedVertexBuffer)->transitionResource(command, i, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON,
+					D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			}
+		}
+
+		// the shading pass reads the geometry too.
+		static_cast<VertexBuffer*>(resMgr.getResource(m_model.vertexBuffer()))->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE,
+			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		static_cast<IndexBuffer*>(resMgr.getResource(m_model.indexBuffer()))->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE,
+			D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_INDEX_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+		command->Close();
+
+		ID3D12CommandList* cmdList[] = { command };
+		m_queue.getQueue()->ExecuteCommandLists(_countof(cmdList), cmdList);
+		m_queue.waitForFence(m_presentFence.getFence(), m_presentFence.getFenceEvent(), m_presentFence.getFenceValue());
+	}
 
+
+	stage.next("gui");
 	m_gui.create(hwnd, m_device.getDevice(), DXGI_FORMAT_R8G8B8A8_UNORM, kBackBufferCount, resMgr.getGlobalHeap()->getDescriptorHeap());
 
 	return true;
 }
 
 void App::shutdown() {
+	m_shaderHotReload.destroy();
+	m_pipelineCompiler.destroy();
+
+	{
+		auto& pipelineCache = PipelineCache::Instance();
+		std::string message = "pipeline cache: " + std::to_string(pipelineCache.getLibraryHitCount()) + " loaded, " +
+			std::to_string(pipelineCache.getMemoryHitCount()) + " shared, " + std::to_string(pipelineCache.getMissCount()) + " compiled\n";
+		OutputDebugString(message.c_str());
+		pipelineCache.save();
+	}
 	m_queue.waitForFence(m_presentFence.getFence(), m_presentFence.getFenceEvent(), m_presentFence.getFenceValue());
 	m_gui.destroy();
 }
 
 void App::render() {
+	CPU_PROFILE_SCOPE("render");
+
 	UINT curImageCount = m_swapchain.getSwapchain()->GetCurrentBackBufferIndex();
 
-	this->run((curImageCount + 1) % kBackBufferCount);
+	{
+		CPU_PROFILE_SCOPE("shader hot reload");
+		// nothing is being recorded yet, so pipelines can be swapped here. the list submitted below still uses the old ones.
+		m_shaderHotReload.update(m_presentFence.getNextSignalValue(), m_presentFence.getCompletedValue());
+	}
+
+	{
+		CPU_PROFILE_SCOPE("update");
+		this->run((curImageCount + 1) % kBackBufferCount);
+	}
 
 	static int heapIndex;
 	if (curImageCount == 0) {
 		heapIndex = 0;
 	}
 
-	std::thread th1([this]() {
+	// the readback recorded last frame is complete once this frame's fence wait returns.
+	bool isValidationSubmitted = m_isValidationRecorded;
+	bool isDrawCullValidationSubmitted = m_isDrawCullValidationRecorded;
+	bool isSkinningValidationSubmitted = m_isSkinningValidationRecorded;
+	m_isValidationRecorded = false;
+	m_isDrawCullValidationRecorded = false;
+	m_isSkinningValidationRecorded = false;
+
+	// the list recorded below is submitted by the next render, which signals the value after the one this render signals.
+	uint64_t completedFenceValue = m_presentFence.getCompletedValue();
+	uint64_t recordFenceValue = m_presentFence.getNextSignalValue() + 1;
+
+	std::thread th1([this, completedFenceValue, recordFenceValue]() {
+		CpuProfiler::Instance().setThreadName("record");
+		CPU_PROFILE_SCOPE("record");
+
 		auto& resMgr = ResourceManager::Instance();
 	UINT curImageCount = (m_swapchain.getSwapchain()->GetCurrentBackBufferIndex() + 1) % kBackBufferCount;
 	m_commandAllocator[curImageCount].getCommandAllocator()->Reset();
 	ID3D12GraphicsCommandList* command = m_commandList[curImageCount].getCommandList();
 	command->Reset(m_commandAllocator[curImageCount].getCommandAllocator(), nullptr);
 
+	m_gpuProfiler.beginFrame(completedFenceValue);
+
 	{
 		D3D12_VIEWPORT viewport{};
 		viewport.Width = (float)kScreenWidth;
@@ -214,69 +520,1069 @@ void App::render() {
 
 		Texture* backBuffer = static_cast<Texture*>(resMgr.getResource(m_backBuffer));
 		Texture* depthBuffer = static_cast<Texture*>(resMgr.getResource(m_depthBuffer));
-		backBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		Texture* visibilityBuffer = resMgr.getResourceAsTexture(m_visibilityBuffer);
+		Texture* renderingBuffer = resMgr.getResourceAsTexture(m_renderingBuffer);
+
+		CpuProfileScope pass("skinning");
+		bool isSkinning = isSkinningReady();
+		if (isSkinning) {
+			m_gpuProfiler.beginPass(command, "skinning");
+			skinVertices(command, curImageCount, heapIndex);
+			m_gpuProfiler.endPass(command);
+		}
+
+		pass.next("visibility pass");
+		m_gpuProfiler.beginPass(command, "visibility pass");
+		bool isGpuCulling = m_isGpuCulling && isDrawCullReady();
+		bool isTwoPhaseCulling = isGpuCulling && m_isHiZCulling && isHiZReady();
+		if (isGpuCulling) {
+			m_gpuProfiler.beginPass(command, "draw culling");
+			cullDraws(command, curImageCount, heapIndex, isTwoPhaseCulling ? CullPhase::eEarly : CullPhase::eFrustum);
+			m_gpuProfiler.endPass(command);
+		}
+
 		depthBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+		visibilityBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle[] = {
-	resMgr.getRenderTargetCpuHandle(m_backBuffer, curImageCount)
+	resMgr.getRenderTargetCpuHandle(m_visibilityBuffer, curImageCount)
 		};
 		D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = resMgr.getDepthStencilCpuHandle(m_depthBuffer, curImageCount);
 		command->OMSetRenderTargets(1, rtvHandle, false, &dsvHandle);
 
-		float clearcolor[] = { 0.5f, 0.5f, 0.0f, 0.0f };
+		// pixels without geometry get a closure id no closure uses.
+		float clearcolor[] = { 0.0f, (float)kClosureIdMask, 0.0f, 0.0f };
 		command->ClearRenderTargetView(rtvHandle[0], clearcolor, 0, nullptr);
 		command->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
 		auto vertexBuffer = static_cast<VertexBuffer*>(resMgr.getResource(m_model.vertexBuffer()));
 		auto indexBuffer = static_cast<IndexBuffer*>(resMgr.getResource(m_model.indexBuffer()));
 
-		command->SetGraphicsRootSignature(m_rootSignature.getRootSignature());
+		// the model is skipped for the first frames while its pipeline is still compiling.
+		ID3D12PipelineState* pipelineState = m_pipeline.getPipelineState();
+		auto setVisibilityPassState = [&]() {
+			command->SetGraphicsRootSignature(m_rootSignature.getRootSignature());
 
-		command->SetPipelineState(m_pipeline.getPipelineState());
+			command->SetPipelineState(pipelineState);
 
-		command->SetGraphicsRootDescriptorTable(0, resMgr.getGlobalHeap((heapIndex++) % 1024, m_cb0, curImageCount));
-		command->SetGraphicsRootDescriptorTable(2, resMgr.getSamplerStateGpuHandle(m_wrapSampler, 0));
+			command->SetGraphicsRootConstantBufferView(0, resMgr.getResourceAsCB(m_cb0)->getResource(curImageCount)->GetGPUVirtualAddress());
+			command->SetGraphicsRootShaderResourceView(2, resMgr.getResourceAsStuructured(m_drawInstanceBuffer)->getResource(0)->GetGPUVirtualAddress());
+			command->SetGraphicsRootShaderResourceView(3, resMgr.getResourceAsStuructured(m_instanceBuffer)->getResource(0)->GetGPUVirtualAddress());
 
 
-		command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		command->IASetVertexBuffers(0, 1, vertexBuffer->getVertexBuferView(0));
-		command->IASetIndexBuffer(indexBuffer->getIndexBufferView(0));
+			command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			command->IASetVertexBuffers(0, 1, isSkinning ? &m_skinnedVertexViews[curImageCount] : vertexBuffer->getVertexBuferView(0));
+			command->IASetIndexBuffer(indexBuffer->getIndexBufferView(0));
+		};
 
-		int vertexOffset = 0;
-		int indexOffset = 0;
-		for (int i = 0; i < m_model.meshCount(); i++) {
-			command->SetGraphicsRootDescriptorTable(1, resMgr.getGlobalHeap((heapIndex++) % 1024, m_model.normalIndex(m_model.materialIndex(i)), 0));
+		if (pipelineState) {
+			setVisibilityPassState();
+
+			if (isGpuCulling) {
+				command->ExecuteIndirect(m_drawSignature.getCommandSignatue(), m_model.meshCount(),
+					resMgr.getResourceAsStuructured(m_drawCommandBuffer)->getResource(0), 0,
+					resMgr.getResourceAsStuructured(m_drawCommandCountBuffer)->getResource(0), 0);
+			}
+			else {
+				auto cullStart = std::chrono::high_resolution_clock::now();
+				m_frustumCuller.setMatrix(m_drawCullMatrix);
+				m_frustumCuller.cullBoxes(m_cullBounds, m_visibleDraws);
+				m_cpuCullTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+
+				if (m_isOcclusionCulling) {
+					auto rasterStart = std::chrono::high_resolution_clock::now();
+					m_occlusionCuller.begin(m_drawCullMatrix);
+					for (size_t i = 0; i < m_occluders.size(); i++) {
+						const DrawInstance& instance = m_drawInstances[m_model.instanceMesh(m_occluders[i])];
+						m_occlusionCuller.addOccluder(m_occluderPositions[i].data(), m_model.indices().data() + instance.indexOffset, instance.indexCount);
+					}
+					m_occlusionCuller.rasterize();
+
+					auto queryStart = std::chrono::high_resolution_clock::now();
+					m_occlusionCuller.cull(m_cullBounds, m_visibleDraws);
+					auto queryEnd = std::chrono::high_resolution_clock::now();
+
+					m_occluderRasterTime = std::chrono::duration<double, std::milli>(queryStart - rasterStart).count();
+					m_occlusionQueryTime = std::chrono::duration<double, std::milli>(queryEnd - queryStart).count();
+				}
+
+				for (uint32_t i : m_visibleDraws) {
+					IndirectDrawCommand draw = DrawCuller::packCommand(i, m_drawInstances[i]);
+					command->SetGraphicsRoot32BitConstants(1, 2, &draw.drawId, 0);
+
+					command->DrawIndexedInstanced(draw.indexCountPerInstance, draw.instanceCount, draw.startIndexLocation, draw.baseVertexLocation, draw.startInstanceLocation);
+				}
+			}
+		}
 
-			command->DrawIndexedInstanced(m_model.indexCount(i), 1, indexOffset, vertexOffset, 0);
+		if (isTwoPhaseCulling) {
+			// the pyramid only holds what the early phase drew, the late phase draws what it does not hide.
+			depthBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			m_gpuProfiler.beginPass(command, "hi-z and late culling");
+			buildHiZ(command, curImageCount, heapIndex);
+			cullDraws(command, curImageCount, heapIndex, CullPhase::eLate);
+			m_gpuProfiler.endPass(command);
+			resMgr.getResourceAsTexture(m_hiZBuffer)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			depthBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+			if (pipelineState) {
+				// the cull passes replaced the pipeline state.
+				setVisibilityPassState();
+
+				command->ExecuteIndirect(m_drawSignature.getCommandSignatue(), m_model.meshCount(),
+					resMgr.getResourceAsStuructured(m_lateDrawCommandBuffer)->getResource(0), 0,
+					resMgr.getResourceAsStuructured(m_lateDrawCommandCountBuffer)->getResource(0), 0);
+			}
+		}
 
-			vertexOffset += m_model.vertexCount(i);
-			indexOffset += m_model.indexCount(i);
+		if (isGpuCulling) {
+			// the cpu culler only knows the frustum phase.
+			if (m_isDrawCullValidationRequested && !isTwoPhaseCulling)
+				copyDrawCullValidationData(command);
+
+			int commandBuffers[] = { m_drawCommandBuffer, m_drawCommandCountBuffer, m_lateDrawCommandBuffer, m_lateDrawCommandCountBuffer };
+			for (int i = 0; i < (isTwoPhaseCulling ? 4 : 2); i++)
+				resMgr.getResourceAsStuructured(commandBuffers[i])->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 		}
 
 		depthBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		visibilityBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+		m_gpuProfiler.endPass(command);
+
+		pass.next("material passes");
+		if (isMaterialPassReady()) {
+			m_gpuProfiler.beginPass(command, "material passes");
+			renderMaterialPasses(command, curImageCount, heapIndex, isSkinning);
+			m_gpuProfiler.endPass(command);
+		}
+
+		pass.next("copy and gui");
+		m_gpuProfiler.beginPass(command, "copy and gui");
+		// the shading result has a full mip chain and the back buffer has none, so only the top level is copied.
+		renderingBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		backBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_COPY_DEST);
+
+		D3D12_TEXTURE_COPY_LOCATION copyDest{};
+		copyDest.pResource = backBuffer->getResource(curImageCount);
+		copyDest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		copyDest.SubresourceIndex = 0;
+
+		D3D12_TEXTURE_COPY_LOCATION copySource{};
+		copySource.pResource = renderingBuffer->getResource(curImageCount);
+		copySource.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		copySource.SubresourceIndex = 0;
+
+		command->CopyTextureRegion(&copyDest, 0, 0, 0, &copySource, nullptr);
+
+		backBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		renderingBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		D3D12_CPU_DESCRIPTOR_HANDLE backBufferHandle = resMgr.getRenderTargetCpuHandle(m_backBuffer, curImageCount);
+		command->OMSetRenderTargets(1, &backBufferHandle, false, nullptr);
 
 		m_gui.renderFrame(command);
 
+		m_gpuProfiler.endPass(command);
+
 		backBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 	}
 
+	m_gpuProfiler.endFrame(command, recordFenceValue);
 
 	command->Close();
 		});
 
 	ID3D12GraphicsCommandList* command = m_commandList[curImageCount].getCommandList();
 
+	CpuProfileScope stage("submit");
 	ID3D12CommandList* cmdList[] = { command };
 	m_queue.getQueue()->ExecuteCommandLists(_countof(cmdList), cmdList);
 
-
+	stage.next("wait for gpu");
 	m_queue.waitForFence(m_presentFence.getFence(), m_presentFence.getFenceEvent(), m_presentFence.getFenceValue());
 
+	stage.next("present");
 	m_swapchain.getSwapchain()->Present(0, 0);
 
+	stage.next("wait for record");
 	th1.join();
+
+	stage.next("validation");
+
+	if (isValidationSubmitted)
+		validateMaterialClassification();
+	if (isDrawCullValidationSubmitted)
+		validateDrawCulling();
+	if (isSkinningValidationSubmitted)
+		validateSkinning();
+}
+
+
+bool App::reloadComputePipeline(ComputePipeline* pipeline, RootSignature* rootSignature, int shaderHandle) {
+	ShaderSp shader = m_shaderCompiler.getShader(shaderHandle);
+
+	// an edit that changes the bindings needs a new root signature, which is left to a restart.
+	ShaderReflection reflection;
+	BindingLayout layout;
+	if (!reflection.create(shader->getByteCode(), D3D12_SHADER_VISIBILITY_ALL) || !layout.merge(reflection) || !layout.validate(rootSignature))
+		return false;
+
+	ComputePipeline newPipeline = *pipeline;
+	newPipeline.setComputeShader(shader->getByteCode());
+	if (!newPipeline.create(m_device.getDevice(), rootSignature->getRootSignature()))
+		return false;
+
+	retirePipeline(pipeline->getPipelineState());
+	*pipeline = newPipeline;
+	return true;
+}
+
+void App::retirePipeline(ID3D12PipelineState* pipelineState) {
+	if (pipelineState == nullptr)
+		return;
+
+	pipelineState->AddRef();
+	m_shaderHotReload.retire(std::shared_ptr<void>(pipelineState, [](void* object) {
+		PipelineCache::Instance().release(static_cast<ID3D12PipelineState*>(object));
+	}));
+}
+
+bool App::createMaterialData() {
+	auto& resMgr = ResourceManager::Instance();
+
+	struct DrawData {
+		uint32_t indexOffset;
+		uint32_t vertexOffset;
+		uint32_t materialIndex;
+		uint32_t closureId;
+	};
+
+	struct MaterialData {
+		uint32_t albedoTexture;
+		uint32_t normalTexture;
+		uint32_t roughMetalTexture;
+		uint32_t padding;
+	};
+
+	// slot of a texture in the bindless table, textures shared by materials are only added once.
+	auto getTextureSlot = [this](int texture) {
+		if (texture < 0)
+			return UINT32_MAX;
+
+		auto ite = std::find(m_materialTextures.begin(), m_materialTextures.end(), texture);
+		if (ite != m_materialTextures.end())
+			return (uint32_t)(ite - m_materialTextures.begin());
+
+		m_materialTextures.push_back(texture);
+		return (uint32_t)(m_materialTextures.size() - 1);
+	};
+
+	std::vector<MaterialData> materials(std::max(m_model.materialCount(), 1));
+	std::vector<uint32_t> materialClosureIds(materials.size());
+	for (int i = 0; i < (int)materials.size(); i++) {
+		MaterialData& material = materials[i];
+		material.albedoTexture = getTextureSlot(m_model.albedoIndex(i));
+		material.normalTexture = getTextureSlot(m_model.normalIndex(i));
+		material.roughMetalTexture = getTextureSlot(m_model.roughMetalIndex(i));
+		material.padding = 0;
+
+		// a closure is the set of texture maps the material samples.
+		uint32_t features = 0;
+		if (material.albedoTexture != UINT32_MAX) features |= m_albedoMapFeature;
+		if (material.normalTexture != UINT32_MAX) features |= m_normalMapFeature;
+		if (material.roughMetalTexture != UINT32_MAX) features |= m_roughMetalMapFeature;
+
+		auto ite = std::find(m_closureFeatures.begin(), m_closureFeatures.end(), features);
+		if (ite == m_closureFeatures.end()) {
+			if (m_closureFeatures.size() == kNumClosures) {
+				OutputDebugString("the materials need more closures than kNumClosures.\n");
+				return false;
+			}
+			ite = m_closureFeatures.insert(m_closureFeatures.end(), features);
+		}
+		materialClosureIds[i] = (uint32_t)(ite - m_closureFeatures.begin());
+	}
+
+	std::vector<DrawData> draws(std::max(m_model.meshCount(), 1));
+	m_drawClosureIds.resize(m_model.meshCount());
+	uint32_t indexOffset = 0;
+	uint32_t vertexOffset = 0;
+	for (int i = 0; i < m_model.meshCount(); i++) {
+		DrawData& draw = draws[i];
+		draw.indexOffset = indexOffset;
+		draw.vertexOffset = vertexOffset;
+		draw.materialIndex = m_model.materialIndex(i);
+		draw.closureId = materialClosureIds[draw.materialIndex];
+		m_drawClosureIds[i] = draw.closureId;
+
+		indexOffset += m_model.indexCount(i);
+		vertexOffset += m_model.vertexCount(i);
+	}
+
+	// same layout as InstanceData in material_common.hlsli.
+	struct InstanceData {
+		glm::mat4 world;
+		uint32_t drawId;
+		uint32_t materialIndex;
+		uint32_t padding[2];
+	};
+
+	std::vector<InstanceData> instances(std::max(m_model.instanceCount(), 1));
+	for (int i = 0; i < m_model.instanceCount(); i++) {
+		InstanceData& instance = instances[i];
+		instance.world = m_model.instanceMatrix(i);
+		instance.drawId = (uint32_t)m_model.instanceMesh(i);
+		instance.materialIndex = m_model.materialIndex(m_model.instanceMesh(i));
+		instance.padding[0] = instance.padding[1] = 0;
+	}
+
+	m_drawBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), m_queue.getQueue(), 1, sizeof(DrawData), (UINT)draws.size(), draws.data());
+	m_instanceBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), m_queue.getQueue(), 1, sizeof(InstanceData), (UINT)instances.size(), instances.data());
+	m_materialBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), m_queue.getQueue(), 1, sizeof(MaterialData), (UINT)materials.size(), materials.data());
+
+	// every tile can hold every closure in the worst case.
+	UINT tileCount = ((kScreenWidth + kMaterialTileSizeX - 1) / kMaterialTileSizeX) * ((kScreenHeight + kMaterialTileSizeY - 1) / kMaterialTileSizeY);
+	m_closureTileCountBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), kNumClosures + 1, false, true);
+	m_closureTileOffsetBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), kNumClosures + 1, false, true);
+	m_closureTileCursorBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), kNumClosures, false, true);
+	m_workItemBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(MaterialWorkItem), tileCount * kNumClosures, false, true);
+	m_sortedTileBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), tileCount * kNumClosures, false, true);
+	m_materialArgumentBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), kMaterialArgumentCount, false, true);
+
+	for (int id : { m_drawBuffer, m_instanceBuffer, m_materialBuffer, m_closureTileCountBuffer, m_closureTileOffsetBuffer, m_closureTileCursorBuffer,
+		m_workItemBuffer, m_sortedTileBuffer, m_materialArgumentBuffer }) {
+		if (id == -1)
+			return false;
+	}
+
+	return true;
+}
+
+bool App::isMaterialPassReady() {
+	return m_materialCountPipeline.getPipelineState() && m_materialArgsPipeline.getPipelineState() &&
+		m_materialSortPipeline.getPipelineState() && m_materialSortSignature.getCommandSignatue() &&
+		m_materialShadingSignature.getCommandSignatue() && m_renderingRS.getRootSignature();
 }
 
+void App::renderMaterialPasses(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex, bool isSkinned) {
+	auto& resMgr = ResourceManager::Instance();
+
+	// descriptor index 0 is the srv and 1 the uav of a single buffer, textures keep their uavs after the srvs.
+	auto setTable = [&](const BindingLayout& layout, const char* name, int id, int index) {
+		int parameter = layout.getRootParameterIndex(name);
+		if (parameter != -1)
+			command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap((heapIndex++) % 1024, id, index));
+	};
+
+	auto uavBarrier = [command]() {
+		D3D12_RESOURCE_BARRIER barrier{};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+		barrier.UAV.pResource = nullptr;
+		command->ResourceBarrier(1, &barrier);
+	};
+
+	StructuredBuffer* sortedTileBuffer = resMgr.getResourceAsStuructured(m_sortedTileBuffer);
+	StructuredBuffer* argumentBuffer = resMgr.getResourceAsStuructured(m_materialArgumentBuffer);
+
+	// classify the tiles.
+	command->SetComputeRootSignature(m_materialCountRS.getRootSignature());
+	command->SetPipelineState(m_materialCountPipeline.getPipelineState());
+	setTable(m_materialCountLayout, "visibilityBuffer", m_visibilityBuffer, curImageCount);
+	setTable(m_materialCountLayout, "closureTileCounts", m_closureTileCountBuffer, 1);
+	setTable(m_materialCountLayout, "workItems", m_workItemBuffer, 1);
+	command->Dispatch((kScreenWidth + kMaterialTileSizeX - 1) / kMaterialTileSizeX, (kScreenHeight + kMaterialTileSizeY - 1) / kMaterialTileSizeY, 1);
+
+	uavBarrier();
+
+	// prefix sum and indirect arguments.
+	command->SetComputeRootSignature(m_materialArgsRS.getRootSignature());
+	command->SetPipelineState(m_materialArgsPipeline.getPipelineState());
+	setTable(m_materialArgsLayout, "closureTileCounts", m_closureTileCountBuffer, 1);
+	setTable(m_materialArgsLayout, "closureTileOffsets", m_closureTileOffsetBuffer, 1);
+	setTable(m_materialArgsLayout, "closureTileCursors", m_closureTileCursorBuffer, 1);
+	setTable(m_materialArgsLayout, "materialArguments", m_materialArgumentBuffer, 1);
+	command->Dispatch(1, 1, 1);
+
+	uavBarrier();
+	argumentBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+
+	// scatter the work items into per closure tile lists.
+	command->SetComputeRootSignature(m_materialSortRS.getRootSignature());
+	command->SetPipelineState(m_materialSortPipeline.getPipelineState());
+	setTable(m_materialSortLayout, "workItems", m_workItemBuffer, 1);
+	setTable(m_materialSortLayout, "closureTileOffsets", m_closureTileOffsetBuffer, 1);
+	setTable(m_materialSortLayout, "closureTileCursors", m_closureTileCursorBuffer, 1);
+	setTable(m_materialSortLayout, "sortedTiles", m_sortedTileBuffer, 1);
+	command->ExecuteIndirect(m_materialSortSignature.getCommandSignatue(), 1, argumentBuffer->getResource(0), kSortArgumentOffset * sizeof(uint32_t), nullptr, 0);
+
+	sortedTileBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	// pixels without geometry are never shaded.
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = resMgr.getGlobalHeap((heapIndex++) % 1024, m_renderingBuffer, kBackBufferCount + curImageCount);
+		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = resMgr.getShaderResourceCpuHandle(m_renderingBuffer, kBackBufferCount + curImageCount);
+		float clearcolor[] = { 0.5f, 0.5f, 0.0f, 0.0f };
+		command->ClearUnorderedAccessViewFloat(gpuHandle, cpuHandle, resMgr.getResourceAsTexture(m_renderingBuffer)->getResource(curImageCount), clearcolor, 0, nullptr);
+		uavBarrier();
+	}
+
+	// one indirect dispatch per closure, the argument record also sets the tile offset and closure id.
+	command->SetComputeRootSignature(m_renderingRS.getRootSignature());
+	{
+		int parameter = m_renderingLayout.getRootParameterIndex("MatrixBuffer");
+		if (parameter != -1)
+			command->SetComputeRootConstantBufferView(parameter, resMgr.getResourceAsCB(m_cb0)->getResource(curImageCount)->GetGPUVirtualAddress());
+
+		parameter = m_renderingLayout.getRootParameterIndex("materialTextures");
+		if (parameter != -1)
+			command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap()->getGpuHandle(kMaterialTextureHeapStart));
+	}
+	setTable(m_renderingLayout, "visibilityBuffer", m_visibilityBuffer, curImageCount);
+	if (isSkinned)
+		setTable(m_renderingLayout, "vertexBuffer", m_skinnedVertexBuffer, curImageCount * 2);
+	else
+		setTable(m_renderingLayout, "vertexBuffer", m_model.vertexBuffer(), 0);
+	setTable(m_renderingLayout, "indexBuffer", m_model.indexBuffer(), 0);
+	setTable(m_renderingLayout, "drawBuffer", m_drawBuffer, 0);
+	setTable(m_renderingLayout, "instanceBuffer", m_instanceBuffer, 0);
+	setTable(m_renderingLayout, "materialBuffer", m_materialBuffer, 0);
+	setTable(m_renderingLayout, "sortedTiles", m_sortedTileBuffer, 0);
+	setTable(m_renderingLayout, "resultTex", m_renderingBuffer, kBackBufferCount + curImageCount);
+
+	for (size_t i = 0; i < m_closurePipelines.size(); i++) {
+		ID3D12PipelineState* pipelineState = m_isVisibilityDebug ? m_visibilityDebugPipeline.getPipelineState() : m_closurePipelines[i].getPipelineState();
+		if (!pipelineState)
+			continue;
+
+		command->SetPipelineState(pipelineState);
+		command->ExecuteIndirect(m_materialShadingSignature.getCommandSignatue(), 1, argumentBuffer->getResource(0),
+			i * kClosureArgumentStride * sizeof(uint32_t), nullptr, 0);
+	}
+
+	if (m_isValidationRequested)
+		copyMaterialValidationData(command, curImageCount);
+
+	sortedTileBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	argumentBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+void App::copyMaterialValidationData(ID3D12GraphicsCommandList* command, UINT curImageCount) {
+	auto& resMgr = ResourceManager::Instance();
+
+	Texture* visibilityBuffer = resMgr.getResourceAsTexture(m_visibilityBuffer);
+	StructuredBuffer* sortedTileBuffer = resMgr.getResourceAsStuructured(m_sortedTileBuffer);
+	StructuredBuffer* argumentBuffer = resMgr.getResourceAsStuructured(m_materialArgumentBuffer);
+
+	// visibility buffer, then the arguments, then the sorted tiles.
+	UINT64 sortedTileSize = sortedTileBuffer->getResource(0)->GetDesc().Width;
+	UINT64 argumentOffset = 0;
+	UINT64 sortedTileOffset = 0;
+	{
+		D3D12_RESOURCE_DESC desc = visibilityBuffer->getResource(curImageCount)->GetDesc();
+		UINT64 visibilitySize = 0;
+		m_device.getDevice()->GetCopyableFootprints(&desc, 0, 1, 0, &m_visibilityFootprint, nullptr, nullptr, &visibilitySize);
+		argumentOffset = visibilitySize;
+		sortedTileOffset = argumentOffset + kMaterialArgumentCount * sizeof(uint32_t);
+	}
+
+	if (!m_validationReadback) {
+		D3D12_HEAP_PROPERTIES heapProp{};
+		heapProp.Type = D3D12_HEAP_TYPE_READBACK;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapProp.CreationNodeMask = 1;
+		heapProp.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC resDesc{};
+		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resDesc.Width = sortedTileOffset + sortedTileSize;
+		resDesc.Height = 1;
+		resDesc.DepthOrArraySize = 1;
+		resDesc.MipLevels = 1;
+		resDesc.Format = DXGI_FORMAT_UNKNOWN;
+		resDesc.SampleDesc.Count = 1;
+		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+		HRESULT res = m_device.getDevice()->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(m_validationReadback.ReleaseAndGetAddressOf()));
+		if (FAILED(res)) {
+			OutputDebugString("failed to create the material validation readback buffer.\n");
+			m_isValidationRequested = false;
+			m_isReferenceRequested = false;
+			return;
+		}
+	}
+
+	visibilityBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	argumentBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	sortedTileBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+	D3D12_TEXTURE_COPY_LOCATION copyDest{};
+	copyDest.pResource = m_validationReadback.Get();
+	copyDest.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	copyDest.PlacedFootprint = m_visibilityFootprint;
+
+	D3D12_TEXTURE_COPY_LOCATION copySource{};
+	copySource.pResource = visibilityBuffer->getResource(curImageCount);
+	copySource.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	copySource.SubresourceIndex = 0;
+
+	command->CopyTextureRegion(&copyDest, 0, 0, 0, &copySource, nullptr);
+	command->CopyBufferRegion(m_validationReadback.Get(), argumentOffset, argumentBuffer->getResource(0), 0, kMaterialArgumentCount * sizeof(uint32_t));
+	command->CopyBufferRegion(m_validationReadback.Get(), sortedTileOffset, sortedTileBuffer->getResource(0), 0, sortedTileSize);
+
+	visibilityBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	argumentBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	sortedTileBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	m_isValidationRequested = false;
+	m_isValidationRecorded = true;
+}
+
+void App::validateMaterialClassification() {
+	uint8_t* data = nullptr;
+	if (!m_validationReadback || FAILED(m_validationReadback->Map(0, nullptr, (void**)&data))) {
+		m_validationResult = "failed to map the readback buffer.";
+		if (m_isReferenceRequested)
+			renderReference(nullptr, 0);
+		return;
+	}
+
+	UINT64 argumentOffset = m_visibilityFootprint.Offset + (UINT64)m_visibilityFootprint.Footprint.RowPitch * m_visibilityFootprint.Footprint.Height;
+	const uint32_t* visibility = (const uint32_t*)(data + m_visibilityFootprint.Offset);
+	const uint32_t* arguments = (const uint32_t*)(data + argumentOffset);
+	const uint32_t* sortedTiles = arguments + kMaterialArgumentCount;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	bool isClassified = m_materialClassifier.classify(visibility, m_visibilityFootprint.Footprint.Width, m_visibilityFootprint.Footprint.Height,
+		m_visibilityFootprint.Footprint.RowPitch / (sizeof(uint32_t) * 2));
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::string error;
+	if (isClassified && m_materialClassifier.validateArguments(arguments, error)) {
+		std::vector<uint32_t> closureTileCounts(kNumClosures);
+		size_t sortedTileCount = 0;
+		for (uint32_t i = 0; i < kNumClosures; i++) {
+			closureTileCounts[i] = arguments[i * kClosureArgumentStride + 2];
+			sortedTileCount += closureTileCounts[i];
+		}
+		m_materialClassifier.validate(closureTileCounts.data(), sortedTiles, sortedTileCount, error);
+	}
+	else if (!isClassified) {
+		error = "cpu classification failed.";
+	}
+
+	if (m_isReferenceRequested)
+		renderReference(visibility, m_visibilityFootprint.Footprint.RowPitch / (sizeof(uint32_t) * 2));
+
+	m_validationReadback->Unmap(0, nullptr);
+
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	m_validationResult = error.empty() ? "material classification matches (cpu " + std::to_string(milliseconds) + " ms)" : error;
+	OutputDebugString((m_validationResult + "\n").c_str());
+}
+
+void App::renderReference(const uint32_t* visibility, uint32_t rowPitch) {
+	m_isReferenceRequested = false;
+
+	if (!m_isReferenceCreated) {
+		if (!m_referenceRenderer.create(m_model, m_drawClosureIds)) {
+			m_referenceResult = "failed to create the reference renderer.";
+			OutputDebugString((m_referenceResult + "\n").c_str());
+			return;
+		}
+		m_isReferenceCreated = true;
+	}
+
+	m_referenceRenderer.render(m_referenceCamera, kScreenWidth, kScreenHeight);
+	m_referenceRenderer.writeVisibility("reference_visibility.png");
+	m_referenceRenderer.writeColor("reference_color.png");
+
+	// pixels whose centers lie on a triangle edge may go either way, so this reports the count instead of failing.
+	uint32_t mismatchCount = 0;
+	if (visibility) {
+		const auto& reference = m_referenceRenderer.getVisibility();
+		for (uint32_t y = 0; y < (uint32_t)kScreenHeight; y++) {
+			for (uint32_t x = 0; x < (uint32_t)kScreenWidth; x++) {
+				const uint32_t* texel = visibility + ((size_t)y * rowPitch + x) * 2;
+				const glm::uvec2& expected = reference[(size_t)y * kScreenWidth + x];
+				bool isBackground = (texel[1] & kClosureIdMask) == kClosureIdMask;
+				bool isExpectedBackground = (expected.y & kClosureIdMask) == kClosureIdMask;
+				if (isBackground != isExpectedBackground || (!isBackground && (texel[0] != expected.x || texel[1] != expected.y)))
+					mismatchCount++;
+			}
+		}
+	}
+
+	m_referenceResult = "reference: build " + std::to_string(m_referenceRenderer.getBuildTime()) + " ms, " +
+		std::to_string(m_referenceRenderer.getRaysPerSecond() * 1e-6) + " Mrays/s, " + std::to_string(mismatchCount) + " of " +
+		std::to_string(kScreenWidth * kScreenHeight) + " pixels differ from the gpu";
+	OutputDebugString((m_referenceResult + "\n").c_str());
+}
+
+bool App::createDrawCullData() {
+	auto& resMgr = ResourceManager::Instance();
+
+	m_drawInstances.resize(m_model.meshCount());
+	m_cullBounds.clear();
+	m_cullBounds.reserve(m_model.meshCount());
+	uint32_t indexOffset = 0;
+	int32_t vertexOffset = 0;
+	for (int i = 0; i < m_model.meshCount(); i++) {
+		DrawInstance& instance = m_drawInstances[i];
+		instance.boundsMin = m_model.boundsMin(i);
+		instance.indexCount = m_model.indexCount(i);
+		instance.boundsMax = m_model.boundsMax(i);
+		instance.indexOffset = indexOffset;
+		instance.vertexOffset = vertexOffset;
+		instance.closureId = m_drawClosureIds[i];
+		instance.instanceOffset = (uint32_t)m_model.meshInstanceOffset(i);
+		instance.instanceCount = (uint32_t)m_model.meshInstanceCount(i);
+
+		// the instances are culled together, the box holds the mesh box at every one of them.
+		bool isUntransformed = instance.instanceCount == 1 && m_model.instanceMatrix(instance.instanceOffset) == glm::mat4(1.0f);
+		if (!isUntransformed && instance.instanceCount > 0) {
+			glm::vec3 boundsMin(FLT_MAX);
+			glm::vec3 boundsMax(-FLT_MAX);
+			for (uint32_t j = 0; j < instance.instanceCount; j++) {
+				glm::vec3 transformedMin, transformedMax;
+				transformBounds(m_model.instanceMatrix(instance.instanceOffset + j), &m_model.boundsMin(i), &m_model.boundsMax(i), 1, &transformedMin, &transformedMax);
+				boundsMin = glm::min(boundsMin, transformedMin);
+				boundsMax = glm::max(boundsMax, transformedMax);
+			}
+			instance.boundsMin = boundsMin;
+			instance.boundsMax = boundsMax;
+		}
+
+		if (isUntransformed)
+			m_cullBounds.add(instance.boundsMin, instance.boundsMax, m_model.boundsRadius(i));
+		else
+			m_cullBounds.add(instance.boundsMin, instance.boundsMax);
+
+		indexOffset += m_model.indexCount(i);
+		vertexOffset += m_model.vertexCount(i);
+	}
+
+	UINT drawCount = std::max((UINT)m_drawInstances.size(), 1u);
+	m_drawCullCB = resMgr.createConstantBuffer(m_device.getDevice(), (sizeof(DrawCullConstant) + 255) & ~255, kBackBufferCount);
+	m_drawInstanceBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), m_queue.getQueue(), 1, sizeof(DrawInstance), drawCount, m_drawInstances.data());
+	m_drawCommandBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(IndirectDrawCommand), drawCount, false, true);
+	m_drawCommandCountBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), 1, false, true);
+	m_drawCountResetBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), 1, true, false);
+	m_lateDrawCommandBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(IndirectDrawCommand), drawCount, false, true);
+	m_lateDrawCommandCountBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), 1, false, true);
+	// starts out zero, the first frame draws everything in the late phase.
+	m_drawVisibilityBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), drawCount, false, true);
+
+	for (int id : { m_drawCullCB, m_drawInstanceBuffer, m_drawCommandBuffer, m_drawCommandCountBuffer, m_drawCountResetBuffer,
+		m_lateDrawCommandBuffer, m_lateDrawCommandCountBuffer, m_drawVisibilityBuffer }) {
+		if (id == -1)
+			return false;
+	}
+
+	uint32_t zero = 0;
+	resMgr.getResourceAsStuructured(m_drawCountResetBuffer)->updateBuffer(0, sizeof(uint32_t), &zero);
+
+	// the largest instances are the walls and floors that hide most of the rest.
+	std::vector<float> instanceRadius(m_model.instanceCount());
+	m_occluders.resize(m_model.instanceCount());
+	for (int i = 0; i < m_model.instanceCount(); i++) {
+		glm::mat3 matrix(m_model.instanceMatrix(i));
+		float scale = std::max(glm::length(matrix[0]), std::max(glm::length(matrix[1]), glm::length(matrix[2])));
+		instanceRadius[i] = m_model.boundsRadius(m_model.instanceMesh(i)) * scale;
+		m_occluders[i] = i;
+	}
+	std::sort(m_occluders.begin(), m_occluders.end(), [&instanceRadius](int a, int b) { return instanceRadius[a] > instanceRadius[b]; });
+	m_occluders.resize(std::min((int)m_occluders.size(), kOccluderCount));
+
+	m_occluderPositions.resize(m_occluders.size());
+	for (size_t i = 0; i < m_occluders.size(); i++) {
+		const glm::mat4& matrix = m_model.instanceMatrix(m_occluders[i]);
+		const DrawInstance& instance = m_drawInstances[m_model.instanceMesh(m_occluders[i])];
+		const glm::vec3* positions = m_model.positions().data() + instance.vertexOffset;
+		m_occluderPositions[i].resize(m_model.vertexCount(m_model.instanceMesh(m_occluders[i])));
+		transformPoints(matrix, positions, (uint32_t)m_occluderPositions[i].size(), m_occluderPositions[i].data());
+	}
+
+	if (!m_occlusionCuller.create(kOcclusionWidth, kOcclusionHeight))
+		return false;
+
+	{
+		std::vector<glm::vec3> boundsMin(m_drawInstances.size());
+		std::vector<glm::vec3> boundsMax(m_drawInstances.size());
+		for (size_t i = 0; i < m_drawInstances.size(); i++) {
+			boundsMin[i] = m_drawInstances[i].boundsMin;
+			boundsMax[i] = m_drawInstances[i].boundsMax;
+		}
+		if (!m_meshBvh.build(boundsMin.data(), boundsMax.data(), (uint32_t)m_drawInstances.size()))
+			return false;
+	}
+
+	return true;
+}
+
+bool App::isDrawCullReady() {
+	return m_drawCullPipeline.getPipelineState() && m_drawSignature.getCommandSignatue() && !m_drawInstances.empty();
+}
+
+void App::cullDraws(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex, CullPhase phase) {
+	auto& resMgr = ResourceManager::Instance();
+
+	int commandBufferId = phase == CullPhase::eLate ? m_lateDrawCommandBuffer : m_drawCommandBuffer;
+	int commandCountBufferId = phase == CullPhase::eLate ? m_lateDrawCommandCountBuffer : m_drawCommandCountBuffer;
+	StructuredBuffer* drawCommandBuffer = resMgr.getResourceAsStuructured(commandBufferId);
+	StructuredBuffer* drawCommandCountBuffer = resMgr.getResourceAsStuructured(commandCountBufferId);
+
+	drawCommandCountBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST);
+	command->CopyBufferRegion(drawCommandCountBuffer->getResource(0), 0, resMgr.getResourceAsStuructured(m_drawCountResetBuffer)->getResource(0), 0, sizeof(uint32_t));
+	drawCommandCountBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	command->SetComputeRootSignature(m_drawCullRS.getRootSignature());
+	command->SetPipelineState(m_drawCullPipeline.getPipelineState());
+
+	int constantParameter = m_drawCullLayout.getRootParameterIndex("CullConstant");
+	if (constantParameter != -1)
+		command->SetComputeRootConstantBufferView(constantParameter, resMgr.getResourceAsCB(m_drawCullCB)->getResource(curImageCount)->GetGPUVirtualAddress());
+
+	int phaseParameter = m_drawCullLayout.getRootParameterIndex("CullPhaseConstant");
+	if (phaseParameter != -1)
+		command->SetComputeRoot32BitConstant(phaseParameter, (UINT)phase, 0);
+
+	auto setTable = [&](const char* name, int id, int index) {
+		int parameter = m_drawCullLayout.getRootParameterIndex(name);
+		if (parameter != -1)
+			command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap((heapIndex++) % 1024, id, index));
+	};
+	setTable("drawInstances", m_drawInstanceBuffer, 0);
+	setTable("drawCommands", commandBufferId, 1);
+	setTable("drawCommandCount", commandCountBufferId, 1);
+	setTable("drawVisibility", m_drawVisibilityBuffer, 1);
+
+	int hiZParameter = m_drawCullLayout.getRootParameterIndex("hiZ");
+	if (hiZParameter != -1)
+		command->SetComputeRootDescriptorTable(hiZParameter, resMgr.getGlobalHeap()->getGpuHandle(m_hiZHeapStart));
+
+	command->Dispatch(((UINT)m_drawInstances.size() + kDrawCullThreadCount - 1) / kDrawCullThreadCount, 1, 1);
+
+	// the early phase has to finish with the visibility flags before the late one rewrites them.
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+	barrier.UAV.pResource = resMgr.getResourceAsStuructured(m_drawVisibilityBuffer)->getResource(0);
+	command->ResourceBarrier(1, &barrier);
+
+	drawCommandBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	drawCommandCountBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+}
+
+void App::copyDrawCullValidationData(ID3D12GraphicsCommandList* command) {
+	auto& resMgr = ResourceManager::Instance();
+
+	StructuredBuffer* drawCommandBuffer = resMgr.getResourceAsStuructured(m_drawCommandBuffer);
+	StructuredBuffer* drawCommandCountBuffer = resMgr.getResourceAsStuructured(m_drawCommandCountBuffer);
+
+	// the count, then the commands.
+	UINT64 commandSize = m_drawInstances.size() * sizeof(IndirectDrawCommand);
+	if (!m_drawCullReadback) {
+		D3D12_HEAP_PROPERTIES heapProp{};
+		heapProp.Type = D3D12_HEAP_TYPE_READBACK;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapProp.CreationNodeMask = 1;
+		heapProp.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC resDesc{};
+		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resDesc.Width = sizeof(uint32_t) + commandSize;
+		resDesc.Height = 1;
+		resDesc.DepthOrArraySize = 1;
+		resDesc.MipLevels = 1;
+		resDesc.Format = DXGI_FORMAT_UNKNOWN;
+		resDesc.SampleDesc.Count = 1;
+		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+		HRESULT res = m_device.getDevice()->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(m_drawCullReadback.ReleaseAndGetAddressOf()));
+		if (FAILED(res)) {
+			OutputDebugString("failed to create the draw cull readback buffer.\n");
+			m_isDrawCullValidationRequested = false;
+			return;
+		}
+	}
+
+	drawCommandBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	drawCommandCountBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+	command->CopyBufferRegion(m_drawCullReadback.Get(), 0, drawCommandCountBuffer->getResource(0), 0, sizeof(uint32_t));
+	command->CopyBufferRegion(m_drawCullReadback.Get(), sizeof(uint32_t), drawCommandBuffer->getResource(0), 0, commandSize);
+
+	drawCommandBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	drawCommandCountBuffer->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+
+	// run() wrote the culling constants of the frame being recorded from this matrix.
+	m_drawCullValidationMatrix = m_drawCullMatrix;
+	m_isDrawCullValidationRequested = false;
+	m_isDrawCullValidationRecorded = true;
+}
+
+void App::validateDrawCulling() {
+	uint8_t* data = nullptr;
+	if (!m_drawCullReadback || FAILED(m_drawCullReadback->Map(0, nullptr, (void**)&data))) {
+		m_drawCullValidationResult = "failed to map the readback buffer.";
+		return;
+	}
+
+	uint32_t commandCount = *(const uint32_t*)data;
+	const IndirectDrawCommand* commands = (const IndirectDrawCommand*)(data + sizeof(uint32_t));
+
+	auto start = std::chrono::high_resolution_clock::now();
+	m_drawCuller.cull(m_drawInstances, m_drawCullValidationMatrix);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::string error;
+	m_drawCuller.validate(m_drawInstances, commands, commandCount, error);
+
+	m_drawCullReadback->Unmap(0, nullptr);
+
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	m_drawCullValidationResult = error.empty() ? "draw culling matches, " + std::to_string(commandCount) + " of " +
+		std::to_string(m_drawInstances.size()) + " draws (cpu " + std::to_string(milliseconds) + " ms)" : error;
+	OutputDebugString((m_drawCullValidationResult + "\n").c_str());
+}
+
+bool App::createHiZData() {
+	auto& resMgr = ResourceManager::Instance();
+
+	// the resource gets the full mip chain, the views are made per mip by createHiZViews.
+	m_hiZBuffer = resMgr.createRenderTarget2D(m_device.getDevice(), 1, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, DXGI_FORMAT_R32_FLOAT, kHiZSize, kHiZSize);
+	m_hiZCounterBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), 1, sizeof(uint32_t), 1, false, true);
+
+	return m_hiZBuffer != -1 && m_hiZCounterBuffer != -1;
+}
+
+void App::createHiZViews() {
+	auto& resMgr = ResourceManager::Instance();
+
+	ID3D12Resource* hiZ = resMgr.getResourceAsTexture(m_hiZBuffer)->getResource(0);
+	DescriptorHeap* globalHeap = resMgr.getGlobalHeap();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = kHiZMipCount;
+	m_device.getDevice()->CreateShaderResourceView(hiZ, &srvDesc, globalHeap->getCpuHandle(m_hiZHeapStart));
+
+	for (uint32_t i = 0; i < kHiZMipCount; i++) {
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+		uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		uavDesc.Texture2D.MipSlice = i;
+		m_device.getDevice()->CreateUnorderedAccessView(hiZ, nullptr, &uavDesc, globalHeap->getCpuHandle(m_hiZHeapStart + 1 + i));
+	}
+}
+
+bool App::isHiZReady() {
+	return m_hiZBuildPipeline.getPipelineState() != nullptr;
+}
+
+void App::buildHiZ(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex) {
+	auto& resMgr = ResourceManager::Instance();
+
+	command->SetComputeRootSignature(m_hiZBuildRS.getRootSignature());
+	command->SetPipelineState(m_hiZBuildPipeline.getPipelineState());
+
+	int parameter = m_hiZBuildLayout.getRootParameterIndex("depthBuffer");
+	if (parameter != -1)
+		command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap((heapIndex++) % 1024, m_depthBuffer, curImageCount));
+	parameter = m_hiZBuildLayout.getRootParameterIndex("hiZMips");
+	if (parameter != -1)
+		command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap()->getGpuHandle(m_hiZHeapStart + 1));
+	parameter = m_hiZBuildLayout.getRootParameterIndex("hiZGroupCounter");
+	if (parameter != -1)
+		command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap((heapIndex++) % 1024, m_hiZCounterBuffer, 1));
+
+	command->Dispatch(kHiZSize / kHiZTileSize, kHiZSize / kHiZTileSize, 1);
+
+	resMgr.getResourceAsTexture(m_hiZBuffer)->transitionResource(command, 0, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+bool App::createSkinningData() {
+	if (!m_model.isSkinned())
+		return true;
+
+	auto& resMgr = ResourceManager::Instance();
+
+	const std::vector<SkinVertex>& skinVertices = m_model.skinVertices();
+	UINT vertexCount = (UINT)skinVertices.size();
+	UINT vertexStride = static_cast<VertexBuffer*>(resMgr.getResource(m_model.vertexBuffer()))->getVertexBuferView(0)->StrideInBytes;
+
+	m_skinVertexBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), m_queue.getQueue(), 1, sizeof(SkinVertex), vertexCount, (void*)skinVertices.data());
+	m_skinMatrixBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), kBackBufferCount, sizeof(glm::mat4), (UINT)m_model.skinJointCount(), true, false);
+	m_skinnedVertexBuffer = resMgr.createStructuredBuffer(m_device.getDevice(), kBackBufferCount, vertexStride, vertexCount, false, true);
+	for (int id : { m_skinVertexBuffer, m_skinMatrixBuffer, m_skinnedVertexBuffer }) {
+		if (id == -1)
+			return false;
+	}
+
+	// the visibility pass reads the skinned vertices through the input assembler.
+	m_skinnedVertexViews.resize(kBackBufferCount);
+	for (int i = 0; i < kBackBufferCount; i++) {
+		m_skinnedVertexViews[i].BufferLocation = resMgr.getResourceAsStuructured(m_skinnedVertexBuffer)->getResource(i)->GetGPUVirtualAddress();
+		m_skinnedVertexViews[i].SizeInBytes = vertexCount * vertexStride;
+		m_skinnedVertexViews[i].StrideInBytes = vertexStride;
+	}
+
+	m_pose = m_model.restPose();
+	m_blendedPose = m_pose;
+	m_skinMatrices.resize(m_model.skinJointCount());
+
+	return true;
+}
+
+bool App::isSkinningReady() {
+	return m_model.isSkinned() && m_skinningPipeline.getPipelineState();
+}
+
+void App::switchAnimation(int clip) {
+	if (clip == m_animationClip || clip < 0 || clip >= m_model.animationCount())
+		return;
+
+	// a switch during a fade starts over from the clip that is fading in.
+	std::swap(m_fadeSampler, m_animationSampler);
+	std::swap(m_fadePose, m_pose);
+	m_fadeClip = m_animationClip;
+	m_fadeTime = m_animationTime;
+	m_fadeWeight = 0.0f;
+
+	// the joints the new clip does not animate start from the rest pose.
+	m_animationClip = clip;
+	m_animationTime = 0.0f;
+	m_animationSampler.reset(m_model.animation(clip));
+	m_pose = m_model.restPose();
+}
+
+void App::skinVertices(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex) {
+	auto& resMgr = ResourceManager::Instance();
+
+	StructuredBuffer* skinnedVertexBuffer = resMgr.getResourceAsStuructured(m_skinnedVertexBuffer);
+	skinnedVertexBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE,
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	command->SetComputeRootSignature(m_skinningRS.getRootSignature());
+	command->SetPipelineState(m_skinningPipeline.getPipelineState());
+
+	UINT vertexCount = (UINT)m_model.skinVertices().size();
+	int constantParameter = m_skinningLayout.getRootParameterIndex("SkinningConstant");
+	if (constantParameter != -1)
+		command->SetComputeRoot32BitConstant(constantParameter, vertexCount, 0);
+
+	// every buffer with a uav has its srv at 2 * index and its uav after it, the palette has no uav.
+	auto setTable = [&](const char* name, int id, int index) {
+		int parameter = m_skinningLayout.getRootParameterIndex(name);
+		if (parameter != -1)
+			command->SetComputeRootDescriptorTable(parameter, resMgr.getGlobalHeap((heapIndex++) % 1024, id, index));
+	};
+	setTable("vertexBuffer", m_model.vertexBuffer(), 0);
+	setTable("skinVertices", m_skinVertexBuffer, 0);
+	setTable("skinMatrices", m_skinMatrixBuffer, curImageCount);
+	setTable("skinnedVertices", m_skinnedVertexBuffer, curImageCount * 2 + 1);
+
+	command->Dispatch((vertexCount + kSkinningThreadCount - 1) / kSkinningThreadCount, 1, 1);
+
+	if (m_isSkinningValidationRequested) {
+		skinnedVertexBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		copySkinningValidationData(command, curImageCount);
+		skinnedVertexBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	}
+
+	skinnedVertexBuffer->transitionResource(command, curImageCount, D3D12_RESOURCE_BARRIER_FLAG_NONE,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+void App::copySkinningValidationData(ID3D12GraphicsCommandList* command, UINT curImageCount) {
+	auto& resMgr = ResourceManager::Instance();
+
+	UINT64 size = m_skinnedVertexViews[curImageCount].SizeInBytes;
+	if (!m_skinningReadback) {
+		D3D12_HEAP_PROPERTIES heapProp{};
+		heapProp.Type = D3D12_HEAP_TYPE_READBACK;
+		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapProp.CreationNodeMask = 1;
+		heapProp.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC resDesc{};
+		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resDesc.Width = size;
+		resDesc.Height = 1;
+		resDesc.DepthOrArraySize = 1;
+		resDesc.MipLevels = 1;
+		resDesc.Format = DXGI_FORMAT_UNKNOWN;
+		resDesc.SampleDesc.Count = 1;
+		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+		HRESULT res = m_device.getDevice()->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(m_skinningReadback.ReleaseAndGetAddressOf()));
+		if (FAILED(res)) {
+			OutputDebugString("failed to create the skinning readback buffer.\n");
+			m_isSkinningValidationRequested = false;
+			return;
+		}
+	}
+
+	command->CopyBufferRegion(m_skinningReadback.Get(), 0, resMgr.getResourceAsStuructured(m_skinnedVertexBuffer)->getResource(curImageCount), 0, size);
+
+	// run() wrote the palette of the frame being recorded from these.
+	m_skinValidationMatrices = m_skinMatrices;
+	m_isSkinningValidationRequested = false;
+	m_isSkinningValidationRecorded = true;
+}
+
+void App::validateSkinning() {
+	uint8_t* data = nullptr;
+	if (!m_skinningReadback || FAILED(m_skinningReadback->Map(0, nullptr, (void**)&data))) {
+		m_skinningValidationResult = "failed to map the readback buffer.";
+		return;
+	}
+
+	const std::vector<glm::vec3>& positions = m_model.positions();
+	const std::vector<glm::vec3>& normals = m_model.normals();
+	uint32_t vertexCount = (uint32_t)positions.size();
+	UINT stride = m_skinnedVertexViews[0].StrideInBytes;
+
+	std::vector<glm::vec3> skinnedPositions(vertexCount);
+	std::vector<glm::vec3> skinnedNormals(vertexCount);
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	auto start = std::chrono::high_resolution_clock::now();
+	skinLinear(positions.data(), normals.data(), m_model.skinVertices().data(), vertexCount, m_skinValidationMatrices.data(),
+		skinnedPositions.data(), skinnedNormals.data(), &boundsMin, &boundsMax);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	// the vertex starts with its position and normal, the gpu may contract the multiply adds differently.
+	float tolerance = 1.0e-4f * std::max(1.0f, glm::length(boundsMax - boundsMin));
+	uint32_t mismatchCount = 0;
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		const float* vertex = (const float*)(data + (size_t)i * stride);
+		float error = glm::length(glm::vec3(vertex[0], vertex[1], vertex[2]) - skinnedPositions[i]);
+		float normalError = glm::length(glm::vec3(vertex[3], vertex[4], vertex[5]) - skinnedNormals[i]);
+		maxError = std::max(maxError, error);
+		if (!(error <= tolerance) || !(normalError <= 1.0e-3f))
+			mismatchCount++;
+	}
+
+	m_skinningReadback->Unmap(0, nullptr);
+
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	double verticesPerSecond = milliseconds > 0.0 ? vertexCount / (milliseconds * 0.001) : 0.0;
+	m_skinningValidationResult = (mismatchCount == 0 ? std::string("skinning matches, ") : std::to_string(mismatchCount) + " vertices differ, ") +
+		std::to_string(vertexCount) + " vertices, max error " + std::to_string(maxError) + " (cpu " + std::to_string(milliseconds) + " ms, " +
+		std::to_string(verticesPerSecond / 1000000.0) + " M vertices/s)";
+	OutputDebugString((m_skinningValidationResult + "\n").c_str());
+}
 
 void App::run(UINT curImageCount) {
 	auto& resMgr = ResourceManager::Instance();
@@ -297,14 +1603,61 @@ void App::run(UINT curImageCount) {
 			glm::mat4 view;
 			glm::mat4 proj;
 			glm::mat4 world;
+			glm::vec4 lightDirection;
 		};
 
 		cb_t cb{};
 		cb.view = glm::lookAt(glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 		cb.proj = glm::perspective(glm::half_pi<float>(), 16.0f / 9.0f, 0.1f, 100.0f);
 		cb.world = glm::scale(glm::identity<glm::mat4>(), glm::vec3(scl, scl, scl)) * glm::mat4(rotation);
+		cb.lightDirection = glm::vec4(glm::normalize(glm::vec3(-0.3f, -1.0f, 0.2f)), 0.0f);
 
 		cb0->updateBuffer(curImageCount, sizeof(cb_t), &cb);
+
+		m_drawCullMatrix = cb.proj * cb.view * cb.world;
+
+		// kept from the frame the reference was requested in until its readback arrives.
+		if (!m_isReferenceRequested) {
+			m_referenceCamera.view = cb.view;
+			m_referenceCamera.proj = cb.proj;
+			m_referenceCamera.world = cb.world;
+			m_referenceCamera.lightDirection = glm::vec3(cb.lightDirection);
+		}
+
+		if (m_model.isSkinned()) {
+			if (m_isAnimating && m_model.animationCount() > 0) {
+				float deltaTime = ImGui::GetIO().DeltaTime;
+				m_animationTime += deltaTime;
+				m_animationSampler.sample(m_model.animation(m_animationClip), m_animationTime, m_pose.data());
+
+				// the previous clip keeps playing under the new one until the fade is over.
+				const JointTransform* pose = m_pose.data();
+				if (m_fadeClip >= 0) {
+					m_fadeTime += deltaTime;
+					m_fadeWeight = (std::min)(1.0f, m_fadeWeight + deltaTime / kAnimationFadeTime);
+					m_fadeSampler.sample(m_model.animation(m_fadeClip), m_fadeTime, m_fadePose.data());
+					blendPoses(m_fadePose.data(), m_pose.data(), m_fadeWeight, (uint32_t)m_pose.size(), m_blendedPose.data());
+					pose = m_blendedPose.data();
+					if (m_fadeWeight >= 1.0f)
+						m_fadeClip = -1;
+				}
+
+				TransformHierarchy& transforms = m_model.transforms();
+				for (uint32_t i = 0; i < (uint32_t)m_pose.size(); i++) {
+					transforms.setLocalPosition(i, pose[i].position);
+					transforms.setLocalRotation(i, pose[i].rotation);
+					transforms.setLocalScale(i, pose[i].scale);
+				}
+				transforms.update(1);
+			}
+
+			m_model.computeSkinMatrices(m_skinMatrices.data());
+			resMgr.getResourceAsStuructured(m_skinMatrixBuffer)->updateBuffer(curImageCount, (UINT)(m_skinMatrices.size() * sizeof(glm::mat4)), m_skinMatrices.data());
+		}
+
+		DrawCullConstant cullConstant;
+		DrawCuller::buildConstant(m_drawCullMatrix, (uint32_t)m_drawInstances.size(), cullConstant);
+		resMgr.getResourceAsCB(m_drawCullCB)->updateBuffer(curImageCount, sizeof(DrawCullConstant), &cullConstant);
 	}
 
 	ImGui_ImplDX12_NewFrame();
@@ -312,8 +1665,71 @@ void App::run(UINT curImageCount) {
 	ImGui::NewFrame();
 
 
+	// the mesh whose bounds the cursor ray enters first.
+	if (ImGui::IsMouseClicked(0) && !ImGui::GetIO().WantCaptureMouse) {
+		ImVec2 cursor = ImGui::GetIO().MousePos;
+		ImVec2 displaySize = ImGui::GetIO().DisplaySize;
+		float x = cursor.x / displaySize.x * 2.0f - 1.0f;
+		float y = 1.0f - cursor.y / displaySize.y * 2.0f;
+
+		glm::mat4 inverse = glm::inverse(m_drawCullMatrix);
+		glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+
+		BvhRay ray;
+		ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+		ray.direction = glm::vec3(farPoint) / farPoint.w - ray.origin;
+		ray.tMax = 1.0f;
+		m_pickedMesh = m_meshBvh.rayCast(ray, [this](uint32_t mesh, const BvhRay& ray) {
+			return Bvh::intersectBounds(ray, m_drawInstances[mesh].boundsMin, m_drawInstances[mesh].boundsMax);
+		});
+	}
+
 	ImGui::Text("deltaTime: %.4f", ImGui::GetIO().DeltaTime);
 	ImGui::Text("framerate: %.2f", ImGui::GetIO().Framerate);
+	ImGui::Text("compiling pipelines: %d", (int)m_pipelineCompiler.getPendingCount());
+	ImGui::Checkbox("gpu culling", &m_isGpuCulling);
+	if (m_isGpuCulling)
+		ImGui::Checkbox("hi-z occlusion culling", &m_isHiZCulling);
+	if (m_isGpuCulling && !m_isHiZCulling && ImGui::Button("validate draw culling"))
+		m_isDrawCullValidationRequested = true;
+	ImGui::Text("%s", m_drawCullValidationResult.c_str());
+	if (!m_isGpuCulling) {
+		ImGui::Checkbox("occlusion culling", &m_isOcclusionCulling);
+		ImGui::Text("cpu culling: %d of %d draws, %.4f ms", (int)m_visibleDraws.size(), (int)m_drawInstances.size(), m_cpuCullTime);
+		if (m_isOcclusionCulling) {
+			ImGui::Text("occluders: %d triangles, raster %.4f ms, query %.4f ms", (int)m_occlusionCuller.getTriangleCount(),
+				m_occluderRasterTime, m_occlusionQueryTime);
+		}
+	}
+	ImGui::Text("picked mesh: %d", m_pickedMesh);
+	if (m_model.isSkinned()) {
+		ImGui::Checkbox("animate", &m_isAnimating);
+		if (m_model.animationCount() > 1) {
+			int clip = m_animationClip;
+			if (ImGui::SliderInt("clip", &clip, 0, m_model.animationCount() - 1))
+				switchAnimation(clip);
+			ImGui::Text("%s", m_model.animation(m_animationClip).getName().c_str());
+		}
+		if (ImGui::Button("validate skinning"))
+			m_isSkinningValidationRequested = true;
+		ImGui::Text("%s", m_skinningValidationResult.c_str());
+	}
+	ImGui::Checkbox("visibility debug", &m_isVisibilityDebug);
+	if (ImGui::Button("validate material classification"))
+		m_isValidationRequested = true;
+	ImGui::Text("%s", m_validationResult.c_str());
+	if (!m_isReferenceRequested && ImGui::Button("render reference")) {
+		m_isReferenceRequested = true;
+		m_isValidationRequested = true;
+	}
+	ImGui::Text("%s", m_referenceResult.c_str());
+
+	CpuProfiler::Instance().drawImGui();
+	if (m_gpuProfiler.isAvailable())
+		m_gpuProfiler.getProfiler().drawImGui();
+	else
+		ImGui::Text("gpu timing is off");
 
 	ImGui::Render();
 }
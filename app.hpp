@@ -3,16 +3,30 @@
 
 #include "framework/device.h"
 #include "framework/commandbuffer.h"
+#include "framework/command_signature.h"
 #include "framework/descriptor_heap.h"
 #include "framework/pipeline.h"
+#include "framework/pipeline_cache.h"
 #include "framework/queue.h"
 #include "framework/root_signature.h"
 #include "framework/shader.h"
+#include "framework/shader_reflection.h"
+#include "framework/shader_permutation.h"
 #include "framework/buffer.h"
 #include "framework/texture.h"
 #include "framework/fence.h"
 
+#include "tools/bvh.h"
+#include "tools/draw_culler.h"
+#include "tools/frustum_culler.h"
+#include "tools/hiz_pyramid.h"
+#include "tools/occlusion_culler.h"
+#include "tools/reference_renderer.h"
+#include "tools/material_classifier.h"
 #include "tools/my_gui.h"
+#include "tools/shader_hot_reload.h"
+#include "tools/dxc_shader_compiler.h"
+#include "tools/d3d12_gpu_profiler.h"
 
 
 #include "tools/model.h"
@@ -35,6 +49,40 @@ public:
 	void run(UINT curImageCount);
 
 private:
+	bool reloadComputePipeline(ComputePipeline* pipeline, RootSignature* rootSignature, int shaderHandle);
+	// keeps the replaced pipeline state alive until the gpu is done with it, then hands it back to the pipeline cache.
+	void retirePipeline(ID3D12PipelineState* pipelineState);
+
+	bool createMaterialData();
+	bool isMaterialPassReady();
+	// isSkinned reads the vertices skinVertices wrote this frame instead of the ones of the model.
+	void renderMaterialPasses(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex, bool isSkinned);
+	void copyMaterialValidationData(ID3D12GraphicsCommandList* command, UINT curImageCount);
+	void validateMaterialClassification();
+	// ray casts the frame of m_referenceCamera and writes the images, and compares the visibility with the gpu when given.
+	void renderReference(const uint32_t* visibility, uint32_t rowPitch);
+
+	bool createDrawCullData();
+	bool isDrawCullReady();
+	void cullDraws(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex, CullPhase phase);
+	void copyDrawCullValidationData(ID3D12GraphicsCommandList* command);
+	void validateDrawCulling();
+
+	bool createHiZData();
+	void createHiZViews();
+	bool isHiZReady();
+	// leaves the pyramid in NON_PIXEL_SHADER_RESOURCE for the late cull phase.
+	void buildHiZ(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex);
+
+	bool createSkinningData();
+	bool isSkinningReady();
+	// leaves the skinned vertices of the frame as vertex buffer and shader resource.
+	void skinVertices(ID3D12GraphicsCommandList* command, UINT curImageCount, int& heapIndex);
+	void copySkinningValidationData(ID3D12GraphicsCommandList* command, UINT curImageCount);
+	void validateSkinning();
+	// plays clip from its start, fading from the current pose.
+	void switchAnimation(int clip);
+
 	Device m_device;
 	Queue m_queue;
 	Swapchain m_swapchain;
@@ -43,17 +91,46 @@ private:
 	std::vector<CommandList> m_commandList;
 
 	RootSignature m_rootSignature;
+	RootSignature m_drawCullRS;
+	RootSignature m_hiZBuildRS;
 	RootSignature m_materialCountRS;
+	RootSignature m_materialArgsRS;
 	RootSignature m_materialSortRS;
 	RootSignature m_renderingRS;
+	RootSignature m_skinningRS;
+
+	BindingLayout m_drawCullLayout;
+	BindingLayout m_hiZBuildLayout;
+	BindingLayout m_materialCountLayout;
+	BindingLayout m_materialArgsLayout;
+	BindingLayout m_materialSortLayout;
+	BindingLayout m_renderingLayout;
+	BindingLayout m_skinningLayout;
+
+	// the draw id and closure id root constants followed by an indexed draw, see IndirectDrawCommand.
+	CommandSignature m_drawSignature;
+	CommandSignature m_materialSortSignature;
+	CommandSignature m_materialShadingSignature;
+
+	PipelineCompiler m_pipelineCompiler;
 
 	Pipeline m_pipeline;
 	
+	ComputePipeline m_drawCullPipeline;
+	ComputePipeline m_hiZBuildPipeline;
 	ComputePipeline m_materialCountPipeline;
+	ComputePipeline m_materialArgsPipeline;
 	ComputePipeline m_materialSortPipeline;
+	// the closure without material features, also the fallback of every closure pipeline while it compiles.
 	ComputePipeline m_renderingPipeline;
+	ComputePipeline m_visibilityDebugPipeline;
+	ComputePipeline m_skinningPipeline;
+	// indexed by closure id, never resized after initialize.
+	std::vector<ComputePipeline> m_closurePipelines;
 
 	Fence m_presentFence;
+	// the passes recorded each frame, timed on the graphics queue.
+	D3D12GpuProfiler m_gpuProfiler;
 
 	Model m_model;
 
@@ -65,12 +142,137 @@ private:
 	int m_systemCB;
 	int m_wrapSampler;
 
+	int m_drawCullCB;
+	int m_drawInstanceBuffer;
+	int m_drawCommandBuffer;
+	int m_drawCommandCountBuffer;
+	// a single zero copied over the draw command counts every frame.
+	int m_drawCountResetBuffer;
+	// the draws the late cull phase adds, next to the early ones which are still read by ExecuteIndirect.
+	int m_lateDrawCommandBuffer;
+	int m_lateDrawCommandCountBuffer;
+	// per draw, whether the last late cull phase found it visible.
+	int m_drawVisibilityBuffer;
+
+	// the pyramid, its views live in the global heap at m_hiZHeapStart: the srv of every mip, then a uav per mip.
+	int m_hiZBuffer;
+	int m_hiZCounterBuffer;
+	int m_hiZHeapStart;
+
+	int m_drawBuffer;
+	// InstanceData of material_common.hlsli per instance of the model.
+	int m_instanceBuffer;
+	int m_materialBuffer;
+	int m_closureTileCountBuffer;
+	int m_closureTileOffsetBuffer;
+	int m_closureTileCursorBuffer;
+	int m_workItemBuffer;
+	int m_sortedTileBuffer;
+	int m_materialArgumentBuffer;
+
+	// only created for a skinned model. the SkinVertex of every vertex, the palette per frame written by run() and the
+	// vertices skinning_cs.fx writes per frame.
+	int m_skinVertexBuffer = -1;
+	int m_skinMatrixBuffer = -1;
+	int m_skinnedVertexBuffer = -1;
+	std::vector<D3D12_VERTEX_BUFFER_VIEW> m_skinnedVertexViews;
+
+	// resource ids of the material textures in the order of the bindless table in the global heap.
+	std::vector<int> m_materialTextures;
+	// per mesh of m_model.
+	std::vector<uint32_t> m_drawClosureIds;
+
 	int m_vs;
 	int m_ps;
 
+	int m_drawCullCS;
+	int m_hiZBuildCS;
 	int m_materialCountCS;
+	int m_materialArgsCS;
 	int m_materialSortCS;
-	int m_renderingCS;
+	int m_skinningCS;
+
+	ShaderPermutation m_renderingPermutation;
+	uint32_t m_visibilityDebugFeature;
+	uint32_t m_albedoMapFeature;
+	uint32_t m_normalMapFeature;
+	uint32_t m_roughMetalMapFeature;
+	// rendering permutation feature mask of every closure id.
+	std::vector<uint32_t> m_closureFeatures;
+	bool m_isVisibilityDebug = false;
+
+	// gpu results read back on request and compared with the cpu reference.
+	MaterialClassifier m_materialClassifier;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_validationReadback;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT m_visibilityFootprint{};
+	bool m_isValidationRequested = false;
+	bool m_isValidationRecorded = false;
+	std::string m_validationResult;
+
+	// cpu ray cast of the frame the material validation reads back.
+	ReferenceRenderer m_referenceRenderer;
+	ReferenceCamera m_referenceCamera;
+	bool m_isReferenceCreated = false;
+	bool m_isReferenceRequested = false;
+	std::string m_referenceResult;
+
+	// per mesh of m_model, uploaded to m_drawInstanceBuffer.
+	std::vector<DrawInstance> m_drawInstances;
+	bool m_isGpuCulling = true;
+	// two phase occlusion culling against the hi-z pyramid on top of the gpu frustum culling.
+	bool m_isHiZCulling = true;
+	glm::mat4 m_drawCullMatrix;
+
+	// the cpu path when gpu culling is off.
+	CullBounds m_cullBounds;
+	FrustumCuller m_frustumCuller;
+	std::vector<uint32_t> m_visibleDraws;
+	double m_cpuCullTime = 0.0;
+
+	OcclusionCuller m_occlusionCuller;
+	// instance indices of the occluders and their vertices in model space.
+	std::vector<int> m_occluders;
+	std::vector<std::vector<glm::vec3>> m_occluderPositions;
+	bool m_isOcclusionCulling = true;
+	double m_occluderRasterTime = 0.0;
+	double m_occlusionQueryTime = 0.0;
+
+	// mesh bounds in model space, for picking.
+	Bvh m_meshBvh;
+	int m_pickedMesh = -1;
+
+	// gpu draw commands read back on request and compared with the cpu culler.
+	DrawCuller m_drawCuller;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_drawCullReadback;
+	glm::mat4 m_drawCullValidationMatrix;
+	bool m_isDrawCullValidationRequested = false;
+	bool m_isDrawCullValidationRecorded = false;
+	std::string m_drawCullValidationResult;
+
+	// the clip of the model played on its node tree, and the palette of the frame. after a switch the previous clip
+	// is blended out over kAnimationFadeTime, m_fadeWeight is the weight of the new one.
+	AnimationSampler m_animationSampler;
+	std::vector<JointTransform> m_pose;
+	int m_animationClip = 0;
+	float m_animationTime = 0.0f;
+	AnimationSampler m_fadeSampler;
+	std::vector<JointTransform> m_fadePose;
+	std::vector<JointTransform> m_blendedPose;
+	int m_fadeClip = -1;
+	float m_fadeTime = 0.0f;
+	float m_fadeWeight = 1.0f;
+	bool m_isAnimating = true;
+	std::vector<glm::mat4> m_skinMatrices;
+
+	// gpu skinned vertices read back on request and compared with skinLinear.
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_skinningReadback;
+	std::vector<glm::mat4> m_skinValidationMatrices;
+	bool m_isSkinningValidationRequested = false;
+	bool m_isSkinningValidationRecorded = false;
+	std::string m_skinningValidationResult;
+
+	DxcShaderCompiler m_shaderCompiler;
+	ShaderHotReload m_shaderHotReload;
 
 	MyGui m_gui;
 };
\ No newline at end of file
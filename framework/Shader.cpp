@@ -1,178 +1,118 @@
 #include "shader.h"
 
 
-bool Shader::createVertexShader(const wchar_t* filename) {
-	Microsoft::WRL::ComPtr<IDxcLibrary> library;
-	HRESULT hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-	//if(FAILED(hr)) Handle error...
+namespace {
 
+// dxc objects are not free threaded, so each thread that compiles keeps its own set for the lifetime of the thread.
+struct DxcContext {
+	Microsoft::WRL::ComPtr<IDxcLibrary> library;
 	Microsoft::WRL::ComPtr<IDxcCompiler> compiler;
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-	//if(FAILED(hr)) Handle error...
+	Microsoft::WRL::ComPtr<IDxcIncludeHandler> includeHandler;
+	uint64_t compilerVersion = 0;
+};
 
-	UINT codePage = CP_UTF8;
-	Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
-	hr = library->CreateBlobFromFile(filename, &codePage, &sourceBlob);
-	//if(FAILED(hr)) Handle file loading error...
-
-	LPCWSTR args[] = {
-		L"-Vd",
-	};
+DxcContext* getDxcContext() {
+	thread_local DxcContext context;
+	if (context.compiler)
+		return &context;
 
-	Microsoft::WRL::ComPtr<IDxcOperationResult> result;
-	hr = compiler->Compile(
-		sourceBlob.Get(), // pSource
-		filename, // pSourceName
-		L"main", // pEntryPoint
-		L"vs_6_0", // pTargetProfile
-		args, 0, // pArguments, argCount
-		NULL, 0, // pDefines, defineCount
-		NULL, // pIncludeHandler
-		&result); // ppResult
-	if (SUCCEEDED(hr))
-		result->GetStatus(&hr);
+	HRESULT hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(context.library.ReleaseAndGetAddressOf()));
 	if (FAILED(hr))
-	{
-		if (result)
-		{
-			Microsoft::WRL::ComPtr<IDxcBlobEncoding> errorsBlob;
-			hr = result->GetErrorBuffer(&errorsBlob);
-			if (SUCCEEDED(hr) && errorsBlob)
-			{
-				OutputDebugString((const char*)errorsBlob->GetBufferPointer());
-			}
-		}
-		// Handle compilation error...
-	}
+		return nullptr;
 
-	result->GetResult(m_bytecode.GetAddressOf());
+	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(context.compiler.ReleaseAndGetAddressOf()));
+	if (FAILED(hr))
+		return nullptr;
 
+	hr = context.library->CreateIncludeHandler(context.includeHandler.ReleaseAndGetAddressOf());
 	if (FAILED(hr))
-		return false;
+		return nullptr;
+
+	Microsoft::WRL::ComPtr<IDxcVersionInfo> versionInfo;
+	if (SUCCEEDED(context.compiler.As(&versionInfo))) {
+		UINT32 major = 0;
+		UINT32 minor = 0;
+		versionInfo->GetVersion(&major, &minor);
+		context.compilerVersion = ((uint64_t)major << 48) | ((uint64_t)minor << 32);
+	}
 
-	return true;
+	Microsoft::WRL::ComPtr<IDxcVersionInfo2> versionInfo2;
+	if (SUCCEEDED(context.compiler.As(&versionInfo2))) {
+		UINT32 commitCount = 0;
+		char* commitHash = nullptr;
+		if (SUCCEEDED(versionInfo2->GetCommitInfo(&commitCount, &commitHash))) {
+			context.compilerVersion |= commitCount;
+			CoTaskMemFree(commitHash);
+		}
+	}
+
+	return &context;
 }
 
-bool Shader::createGeometoryShader(const wchar_t* filename) {
-	Microsoft::WRL::ComPtr<IDxcLibrary> library;
-	HRESULT hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-	//if(FAILED(hr)) Handle error...
+}
 
-	Microsoft::WRL::ComPtr<IDxcCompiler> compiler;
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-	//if(FAILED(hr)) Handle error...
 
-	UINT codePage = CP_UTF8;
-	Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
-	hr = library->CreateBlobFromFile(filename, &codePage, &sourceBlob);
-	//if(FAILED(hr)) Handle file loading error...
+bool Shader::createVertexShader(const wchar_t* filename) {
+	return compile(filename, L"main", L"vs_6_0", {});
+}
 
-	Microsoft::WRL::ComPtr<IDxcOperationResult> result;
-	hr = compiler->Compile(
-		sourceBlob.Get(), // pSource
-		filename, // pSourceName
-		L"main", // pEntryPoint
-		L"gs_6_0", // pTargetProfile
-		NULL, 0, // pArguments, argCount
-		NULL, 0, // pDefines, defineCount
-		NULL, // pIncludeHandler
-		&result); // ppResult
-	if (SUCCEEDED(hr))
-		result->GetStatus(&hr);
-	if (FAILED(hr))
-	{
-		if (result)
-		{
-			Microsoft::WRL::ComPtr<IDxcBlobEncoding> errorsBlob;
-			hr = result->GetErrorBuffer(&errorsBlob);
-			if (SUCCEEDED(hr) && errorsBlob)
-			{
-				OutputDebugString((const char*)errorsBlob->GetBufferPointer());
-			}
-		}
-		// Handle compilation error...
-	}
+bool Shader::createGeometoryShader(const wchar_t* filename) {
+	return compile(filename, L"main", L"gs_6_0", {});
+}
 
-	result->GetResult(m_bytecode.GetAddressOf());
+bool Shader::createPixelShader(const wchar_t* filename) {
+	return compile(filename, L"main", L"ps_6_0", {});
+}
 
-	if (FAILED(hr))
-		return false;
+bool Shader::createComputeShader(const wchar_t* filename) {
+	return compile(filename, L"main", L"cs_6_0", {});
+}
 
-	return true;
+bool Shader::create(const wchar_t* filename, const wchar_t* entryPoint, const wchar_t* profile, const std::vector<ShaderDefine>& defines) {
+	return compile(filename, entryPoint, profile, defines);
 }
 
-bool Shader::createPixelShader(const wchar_t* filename) {
-	Microsoft::WRL::ComPtr<IDxcLibrary> library;
-	HRESULT hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-	//if(FAILED(hr)) Handle error...
+bool Shader::compile(const wchar_t* filename, const wchar_t* entryPoint, const wchar_t* profile, const std::vector<ShaderDefine>& defines) {
+	DxcContext* context = getDxcContext();
+	if (context == nullptr)
+		return false;
 
-	Microsoft::WRL::ComPtr<IDxcCompiler> compiler;
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-	//if(FAILED(hr)) Handle error...
+	auto& cache = ShaderCache::Instance();
 
-	UINT codePage = CP_UTF8;
-	Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
-	hr = library->CreateBlobFromFile(filename, &codePage, &sourceBlob);
-	//if(FAILED(hr)) Handle file loading error...
+	m_cacheKey = cache.isEnable() ? cache.computeKey(filename, entryPoint, profile, defines, context->compilerVersion) : 0;
 
-	Microsoft::WRL::ComPtr<IDxcOperationResult> result;
-	hr = compiler->Compile(
-		sourceBlob.Get(), // pSource
-		filename, // pSourceName
-		L"main", // pEntryPoint
-		L"ps_6_0", // pTargetProfile
-		NULL, 0, // pArguments, argCount
-		NULL, 0, // pDefines, defineCount
-		NULL, // pIncludeHandler
-		&result); // ppResult
-	if (SUCCEEDED(hr))
-		result->GetStatus(&hr);
-	if (FAILED(hr))
-	{
-		if (result)
-		{
-			Microsoft::WRL::ComPtr<IDxcBlobEncoding> errorsBlob;
-			hr = result->GetErrorBuffer(&errorsBlob);
-			if (SUCCEEDED(hr) && errorsBlob)
-			{
-				OutputDebugString((const char*)errorsBlob->GetBufferPointer());
-			}
+	std::vector<uint8_t> cached;
+	if (cache.load(m_cacheKey, cached)) {
+		Microsoft::WRL::ComPtr<IDxcBlobEncoding> blob;
+		HRESULT hr = context->library->CreateBlobWithEncodingOnHeapCopy(cached.data(), (UINT32)cached.size(), 0, blob.ReleaseAndGetAddressOf());
+		if (SUCCEEDED(hr)) {
+			m_bytecode = blob;
+			return true;
 		}
-		// Handle compilation error...
 	}
 
-	result->GetResult(m_bytecode.GetAddressOf());
-
+	UINT codePage = CP_UTF8;
+	Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
+	HRESULT hr = context->library->CreateBlobFromFile(filename, &codePage, sourceBlob.ReleaseAndGetAddressOf());
 	if (FAILED(hr))
 		return false;
 
-	return true;
-}
-
-bool Shader::createComputeShader(const wchar_t* filename) {
-	Microsoft::WRL::ComPtr<IDxcLibrary> library;
-	HRESULT hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-	//if(FAILED(hr)) Handle error...
-
-	Microsoft::WRL::ComPtr<IDxcCompiler> compiler;
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-	//if(FAILED(hr)) Handle error...
-
-	UINT codePage = CP_UTF8;
-	Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
-	hr = library->CreateBlobFromFile(filename, &codePage, &sourceBlob);
-	//if(FAILED(hr)) Handle file loading error...
+	std::vector<DxcDefine> dxcDefines;
+	dxcDefines.reserve(defines.size());
+	for (auto& ite : defines) {
+		dxcDefines.push_back({ ite.name.c_str(), ite.value.empty() ? nullptr : ite.value.c_str() });
+	}
 
 	Microsoft::WRL::ComPtr<IDxcOperationResult> result;
-	hr = compiler->Compile(
+	hr = context->compiler->Compile(
 		sourceBlob.Get(), // pSource
 		filename, // pSourceName
-		L"main", // pEntryPoint
-		L"cs_6_0", // pTargetProfile
+		entryPoint, // pEntryPoint
+		profile, // pTargetProfile
 		NULL, 0, // pArguments, argCount
-		NULL, 0, // pDefines, defineCount
-		NULL, // pIncludeHandler
-		&result); // ppResult
+		dxcDefines.data(), (UINT32)dxcDefines.size(), // pDefines, defineCount
+		context->includeHandler.Get(), // pIncludeHandler
+		result.ReleaseAndGetAddressOf()); // ppResult
 	if (SUCCEEDED(hr))
 		result->GetStatus(&hr);
 	if (FAILED(hr))
@@ -180,19 +120,18 @@ bool Shader::createComputeShader(const wchar_t* filename) {
 		if (result)
 		{
 			Microsoft::WRL::ComPtr<IDxcBlobEncoding> errorsBlob;
-			hr = result->GetErrorBuffer(&errorsBlob);
-			if (SUCCEEDED(hr) && errorsBlob)
+			HRESULT errorResult = result->GetErrorBuffer(&errorsBlob);
+			if (SUCCEEDED(errorResult) && errorsBlob)
 			{
 				OutputDebugString((const char*)errorsBlob->GetBufferPointer());
 			}
 		}
-		// Handle compilation error...
+		return false;
 	}
 
-	result->GetResult(m_bytecode.GetAddressOf());
+	result->GetResult(m_bytecode.ReleaseAndGetAddressOf());
 
-	if (FAILED(hr))
-		return false;
+	cache.store(m_cacheKey, m_bytecode->GetBufferPointer(), m_bytecode->GetBufferSize());
 
 	return true;
 }
\ No newline at end of file
@@ -120,6 +120,19 @@ bool VertexBuffer::create(ID3D12Device* device, ID3D12CommandQueue* queue, UINT
 }
 
 
+void VertexBuffer::transitionResource(ID3D12GraphicsCommandList* command, UINT bufferNum, D3D12_RESOURCE_BARRIER_FLAGS flag,
+	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = flag;
+	barrier.Transition.pResource = m_resource[bufferNum].Get();
+	barrier.Transition.StateBefore = before;
+	barrier.Transition.StateAfter = after;
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	command->ResourceBarrier(1, &barrier);
+}
+
+
 bool IndexBuffer::create(ID3D12Device* device, ID3D12CommandQueue* queue, UINT bufferCount, UINT size, void* data) {
 	HRESULT res;
 
@@ -240,6 +253,19 @@ bool IndexBuffer::create(ID3D12Device* device, ID3D12CommandQueue* queue, UINT b
 }
 
 
+void IndexBuffer::transitionResource(ID3D12GraphicsCommandList* command, UINT bufferNum, D3D12_RESOURCE_BARRIER_FLAGS flag,
+	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = flag;
+	barrier.Transition.pResource = m_resource[bufferNum].Get();
+	barrier.Transition.StateBefore = before;
+	barrier.Transition.StateAfter = after;
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	command->ResourceBarrier(1, &barrier);
+}
+
+
 bool StructuredBuffer::create(ID3D12Device* device, UINT stride, UINT bufferCount, UINT elementCount, bool isCpuAccess, bool isUnorderedAccess, bool isAppend, bool isConsume) {
 	HRESULT res;
 
@@ -16,6 +16,9 @@ public:
 
 	D3D12_VERTEX_BUFFER_VIEW* getVertexBuferView(UINT num) { return &m_vertexBufferView[num]; }
 
+	void transitionResource(ID3D12GraphicsCommandList* command, UINT bufferNum, D3D12_RESOURCE_BARRIER_FLAGS flag,
+		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
 	bool getIsUnorderedAccess() { return m_isUnorderedAccess; }
 	bool getIsShaderResource() { return m_isShaderResource; }
 
@@ -37,6 +40,9 @@ public:
 
 	D3D12_INDEX_BUFFER_VIEW* getIndexBufferView(UINT num) { return &m_indexBufferView[num]; }
 
+	void transitionResource(ID3D12GraphicsCommandList* command, UINT bufferNum, D3D12_RESOURCE_BARRIER_FLAGS flag,
+		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
 	bool getIsUnorderedAccess() { return m_isUnorderedAccess; }
 	bool getIsShaderResource() { return m_isShaderResource; }
 
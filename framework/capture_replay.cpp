@@ -0,0 +1,593 @@
+#include "capture_replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+namespace {
+
+void addStreamStats(const CommandStream& stream, CaptureFrameStats& stats) {
+	stats.commands += stream.getCommandCount();
+	stats.draws += stream.countCommands(RenderCommandType::eDraw) + stream.countCommands(RenderCommandType::eDrawIndexed);
+	stats.indirectExecutes += stream.countCommands(RenderCommandType::eExecuteIndirect);
+	stats.dispatches += stream.countCommands(RenderCommandType::eDispatch);
+	stats.copies += stream.countCommands(RenderCommandType::eCopyBuffer);
+	stats.barriers += stream.countCommands(RenderCommandType::eBarrier) + stream.countCommands(RenderCommandType::eUavBarrier);
+	stats.pipelineChanges += stream.countCommands(RenderCommandType::eSetPipeline);
+	stats.commandBytes += stream.getMemorySize();
+
+	static const RenderCommandType stateTypes[] = {
+		RenderCommandType::eSetPipeline, RenderCommandType::eSetRootConstants, RenderCommandType::eSetRootBuffer,
+		RenderCommandType::eSetRootTable, RenderCommandType::eSetRenderTargets, RenderCommandType::eSetViewport,
+		RenderCommandType::eSetVertexBuffer, RenderCommandType::eSetIndexBuffer,
+	};
+	for (RenderCommandType type : stateTypes)
+		stats.stateChanges += stream.countCommands(type);
+}
+
+std::string formatFrameStats(const CaptureFrameStats& stats) {
+	return std::to_string(stats.submits) + " submits, " +
+		std::to_string(stats.lists) + " lists, " +
+		std::to_string(stats.commands) + " commands (" + std::to_string(stats.commandBytes) + " bytes), " +
+		std::to_string(stats.draws) + " draws, " +
+		std::to_string(stats.indirectExecutes) + " indirect, " +
+		std::to_string(stats.dispatches) + " dispatches, " +
+		std::to_string(stats.copies) + " copies, " +
+		std::to_string(stats.barriers) + " barriers, " +
+		std::to_string(stats.pipelineChanges) + " pipelines, " +
+		std::to_string(stats.stateChanges) + " state changes, " +
+		std::to_string(stats.resourcesCreated) + " resources created, " +
+		std::to_string(stats.uploadBytes) + " bytes uploaded";
+}
+
+// the state RenderDevice creates a resource in.
+ResourceState getBufferState(MemoryType memoryType) {
+	if (memoryType == MemoryType::eUpload)
+		return ResourceState::eGenericRead;
+	if (memoryType == MemoryType::eReadback)
+		return ResourceState::eCopyDest;
+	return ResourceState::eCommon;
+}
+
+}
+
+
+bool computeCaptureStats(const CaptureFile& capture, CaptureStats& stats) {
+	stats = CaptureStats();
+	CaptureFrameStats* current = &stats.setup;
+
+	std::vector<CommandStream> lists;
+	size_t offset = 0;
+	CaptureChunk chunk;
+	while (capture.nextChunk(offset, chunk)) {
+		switch (chunk.type) {
+		case CaptureChunkType::eCreateBuffer: {
+			CaptureReader reader(chunk.data, chunk.size);
+			RenderHandle handle;
+			uint64_t size = 0;
+			uint8_t memoryType;
+			uint8_t isUnorderedAccess;
+			uint64_t dataHash = 0;
+			if (!reader.read(handle) || !reader.read(size) || !reader.read(memoryType) || !reader.read(isUnorderedAccess) || !reader.read(dataHash))
+				return false;
+			current->resourcesCreated++;
+			if (dataHash != 0)
+				current->uploadBytes += size;
+			break;
+		}
+		case CaptureChunkType::eCreateTexture:
+		case CaptureChunkType::eCreateTimestampQueries:
+		case CaptureChunkType::eCreateFence:
+			current->resourcesCreated++;
+			break;
+		case CaptureChunkType::eWriteBuffer: {
+			CaptureReader reader(chunk.data, chunk.size);
+			RenderHandle buffer;
+			uint64_t hash;
+			uint64_t size = 0;
+			if (!reader.read(buffer) || !reader.read(hash) || !reader.read(size))
+				return false;
+			current->uploadBytes += size;
+			break;
+		}
+		case CaptureChunkType::eSubmit:
+			if (!CaptureFile::readLists(chunk, lists))
+				return false;
+			current->submits++;
+			current->lists += (uint32_t)lists.size();
+			for (const CommandStream& stream : lists)
+				addStreamStats(stream, *current);
+			break;
+		case CaptureChunkType::eFrame:
+			stats.frames.push_back(CaptureFrameStats());
+			current = &stats.frames.back();
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+std::string formatCaptureStats(const CaptureStats& stats) {
+	std::string text = "setup: " + formatFrameStats(stats.setup) + "\n";
+
+	CaptureFrameStats total;
+	for (size_t i = 0; i < stats.frames.size(); i++) {
+		const CaptureFrameStats& frame = stats.frames[i];
+		text += "frame " + std::to_string(i) + ": " + formatFrameStats(frame) + "\n";
+
+		total.submits += frame.submits;
+		total.lists += frame.lists;
+		total.commands += frame.commands;
+		total.draws += frame.draws;
+		total.indirectExecutes += frame.indirectExecutes;
+		total.dispatches += frame.dispatches;
+		total.copies += frame.copies;
+		total.barriers += frame.barriers;
+		total.pipelineChanges += frame.pipelineChanges;
+		total.stateChanges += frame.stateChanges;
+		total.resourcesCreated += frame.resourcesCreated;
+		total.uploadBytes += frame.uploadBytes;
+		total.commandBytes += frame.commandBytes;
+	}
+
+	if (!stats.frames.empty()) {
+		uint32_t count = (uint32_t)stats.frames.size();
+		CaptureFrameStats average;
+		average.submits = total.submits / count;
+		average.lists = total.lists / count;
+		average.commands = total.commands / count;
+		average.draws = total.draws / count;
+		average.indirectExecutes = total.indirectExecutes / count;
+		average.dispatches = total.dispatches / count;
+		average.copies = total.copies / count;
+		average.barriers = total.barriers / count;
+		average.pipelineChanges = total.pipelineChanges / count;
+		average.stateChanges = total.stateChanges / count;
+		average.resourcesCreated = total.resourcesCreated / count;
+		average.uploadBytes = total.uploadBytes / count;
+		average.commandBytes = total.commandBytes / count;
+		text += "average: " + formatFrameStats(average) + "\n";
+	}
+
+	return text;
+}
+
+
+bool CaptureReplayer::replay(const CaptureFile& capture, RenderDevice* device, bool isGpuTiming, std::vector<ReplayFrameTime>& times) {
+	m_device = device;
+	m_handles.clear();
+	m_views.clear();
+	m_setupStates.clear();
+	m_payloads.clear();
+	m_signaledValues.clear();
+	m_lists.clear();
+	m_listCount = 0;
+	m_isGpuTiming = isGpuTiming;
+	m_isFrameBegun = false;
+	m_frame = -1;
+	m_cpuTime = 0.0;
+	m_times = &times;
+	times.clear();
+
+	findFirstStates(capture);
+
+	m_frameFence = device->createFence();
+	m_frameValue = 0;
+	if (isGpuTiming) {
+		BufferDesc readbackDesc;
+		readbackDesc.size = sizeof(uint64_t) * 2;
+		readbackDesc.memoryType = MemoryType::eReadback;
+		readbackDesc.name = "replay timestamps";
+		m_queries = device->createTimestampQueries(2);
+		m_readback = device->createBuffer(readbackDesc);
+	}
+
+	bool isSucceeded = true;
+	size_t offset = 0;
+	CaptureChunk chunk;
+	while (isSucceeded && capture.nextChunk(offset, chunk))
+		isSucceeded = replayChunk(chunk);
+
+	if (isSucceeded && m_frame >= 0)
+		finishFrame(times);
+
+	// the device keeps its objects, the lists go with the replayer once the gpu is done with them.
+	m_device->signal(m_frameFence, ++m_frameValue);
+	m_device->wait(m_frameFence, m_frameValue);
+	m_lists.clear();
+
+	return isSucceeded;
+}
+
+bool CaptureReplayer::replayChunk(const CaptureChunk& chunk) {
+	CaptureReader reader(chunk.data, chunk.size);
+	RenderHandle handle = kInvalidRenderHandle;
+
+	switch (chunk.type) {
+	case CaptureChunkType::eCreateBuffer: {
+		BufferDesc desc;
+		uint8_t memoryType = 0;
+		uint8_t isUnorderedAccess = 0;
+		uint64_t dataHash = 0;
+		if (!reader.read(handle) || !reader.read(desc.size) || !reader.read(memoryType) || !reader.read(isUnorderedAccess) ||
+			!reader.read(dataHash) || !reader.readString(desc.name))
+			return false;
+		desc.memoryType = (MemoryType)memoryType;
+		desc.isUnorderedAccess = isUnorderedAccess != 0;
+
+		// a capture without the payloads still uploads as many bytes.
+		std::vector<uint8_t> zeros;
+		const void* data = nullptr;
+		if (dataHash != 0) {
+			auto ite = m_payloads.find(dataHash);
+			if (ite != m_payloads.end() && ite->second.size == desc.size) {
+				data = ite->second.data;
+			}
+			else {
+				zeros.resize((size_t)desc.size);
+				data = zeros.data();
+			}
+		}
+
+		setHandle(handle, m_device->createBuffer(desc, data), getBufferState(desc.memoryType));
+		return true;
+	}
+	case CaptureChunkType::eCreateTexture: {
+		TextureDesc desc;
+		uint8_t flags[4];
+		if (!reader.read(handle) || !reader.read(desc.width) || !reader.read(desc.height) || !reader.read(desc.mipLevels) ||
+			!reader.read(flags) || !reader.readString(desc.name))
+			return false;
+		desc.format = (RenderFormat)flags[0];
+		desc.isRenderTarget = flags[1] != 0;
+		desc.isDepthStencil = flags[2] != 0;
+		desc.isUnorderedAccess = flags[3] != 0;
+
+		ResourceState state = ResourceState::eCommon;
+		if (desc.isDepthStencil)
+			state = ResourceState::eDepthWrite;
+		else if (desc.isRenderTarget)
+			state = ResourceState::eRenderTarget;
+		setHandle(handle, m_device->createTexture(desc), state);
+		return true;
+	}
+	case CaptureChunkType::eCreateTimestampQueries: {
+		uint32_t count = 0;
+		if (!reader.read(handle) || !reader.read(count))
+			return false;
+		setHandle(handle, m_device->createTimestampQueries(count));
+		return true;
+	}
+	case CaptureChunkType::eCreateFence:
+		if (!reader.read(handle))
+			return false;
+		setHandle(handle, m_device->createFence());
+		return true;
+	case CaptureChunkType::eCreatePipeline: {
+		uint8_t isCompute = 0;
+		std::string name;
+		if (!reader.read(handle) || !reader.read(isCompute) || !reader.readString(name))
+			return false;
+
+		RenderHandle pipeline = kInvalidRenderHandle;
+		NullRenderDevice* nullDevice = dynamic_cast<NullRenderDevice*>(m_device);
+		if (m_pipelineFactory)
+			pipeline = m_pipelineFactory(name, isCompute != 0);
+		else if (nullDevice)
+			pipeline = nullDevice->createPipeline(name, isCompute != 0);
+		if (pipeline == kInvalidRenderHandle) {
+			logRenderError("capture replay: no pipeline for " + name + ".\n");
+			return false;
+		}
+		setHandle(handle, pipeline);
+		return true;
+	}
+	case CaptureChunkType::eCreateCommandSignature: {
+		uint32_t byteStride = 0;
+		std::string name;
+		if (!reader.read(handle) || !reader.read(byteStride) || !reader.readString(name))
+			return false;
+
+		RenderHandle signature = kInvalidRenderHandle;
+		NullRenderDevice* nullDevice = dynamic_cast<NullRenderDevice*>(m_device);
+		if (m_signatureFactory)
+			signature = m_signatureFactory(name, byteStride);
+		else if (nullDevice)
+			signature = nullDevice->createCommandSignature(name, byteStride);
+		if (signature == kInvalidRenderHandle) {
+			logRenderError("capture replay: no command signature for " + name + ".\n");
+			return false;
+		}
+		setHandle(handle, signature);
+		return true;
+	}
+	case CaptureChunkType::eCreateView: {
+		uint32_t descriptor = 0;
+		uint8_t type = 0;
+		uint32_t stride = 0;
+		if (!reader.read(descriptor) || !reader.read(handle) || !reader.read(type) || !reader.read(stride))
+			return false;
+
+		// views of resources destroyed before the capture started are left out.
+		if (getHandle(handle) == kInvalidRenderHandle)
+			return true;
+		if (descriptor >= m_views.size())
+			m_views.resize(descriptor + 1, kInvalidRenderHandle);
+		m_views[descriptor] = m_device->createView(getHandle(handle), (ViewType)type, stride);
+		return true;
+	}
+	case CaptureChunkType::eDestroy:
+		if (!reader.read(handle))
+			return false;
+		m_device->destroy(getHandle(handle));
+		setHandle(handle, kInvalidRenderHandle);
+		return true;
+	case CaptureChunkType::ePayload: {
+		uint64_t hash = 0;
+		Payload payload;
+		if (!reader.read(hash) || !reader.read(payload.size))
+			return false;
+		payload.data = reader.skip((size_t)payload.size);
+		if (payload.data == nullptr)
+			return false;
+		m_payloads[hash] = payload;
+		return true;
+	}
+	case CaptureChunkType::eWriteBuffer: {
+		uint64_t hash = 0;
+		uint64_t size = 0;
+		if (!reader.read(handle) || !reader.read(hash) || !reader.read(size))
+			return false;
+
+		void* dest = getHandle(handle) != kInvalidRenderHandle ? m_device->map(getHandle(handle)) : nullptr;
+		if (dest == nullptr)
+			return true;
+		auto ite = m_payloads.find(hash);
+		if (ite != m_payloads.end() && ite->second.size == size)
+			memcpy(dest, ite->second.data, (size_t)size);
+		else
+			memset(dest, 0, (size_t)size);
+		return true;
+	}
+	case CaptureChunkType::eSubmit: {
+		if (!CaptureFile::readLists(chunk, m_streams))
+			return false;
+
+		if (m_isGpuTiming && !m_isFrameBegun && m_frame >= 0) {
+			RenderCommandList* list = getList();
+			list->begin();
+			list->writeTimestamp(m_queries, 0);
+			list->end();
+			m_device->submit(&list, 1);
+		}
+		m_isFrameBegun = true;
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<RenderCommandList*> lists(m_streams.size());
+		for (size_t i = 0; i < m_streams.size(); i++) {
+			lists[i] = getList();
+			lists[i]->begin();
+			replayStream(m_streams[i], lists[i]);
+			lists[i]->end();
+		}
+		m_device->submit(lists.data(), (uint32_t)lists.size());
+		m_cpuTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+	case CaptureChunkType::eSignal: {
+		uint64_t value = 0;
+		if (!reader.read(handle) || !reader.read(value))
+			return false;
+		m_device->signal(getHandle(handle), value);
+		uint64_t& signaled = m_signaledValues[handle];
+		signaled = (std::max)(signaled, value);
+		return true;
+	}
+	case CaptureChunkType::eWait: {
+		uint64_t value = 0;
+		if (!reader.read(handle) || !reader.read(value))
+			return false;
+		// values signaled before the capture started never come.
+		auto ite = m_signaledValues.find(handle);
+		if (ite != m_signaledValues.end() && ite->second >= value)
+			m_device->wait(getHandle(handle), value);
+		return true;
+	}
+	case CaptureChunkType::eFrame:
+		if (m_frame < 0)
+			transitionSetup();
+		else
+			finishFrame(*m_times);
+		m_frame++;
+		return true;
+	default:
+		return true;
+	}
+}
+
+void CaptureReplayer::replayStream(const CommandStream& stream, RenderCommandList* list) {
+	for (const RenderCommand& command : stream.getCommands()) {
+		const uint32_t* args = command.args;
+		const void* payload = stream.getPayload(command);
+
+		switch (command.type) {
+		case RenderCommandType::eBarrier:
+			list->barrier(getHandle(args[0]), (ResourceState)args[1], (ResourceState)args[2]);
+			break;
+		case RenderCommandType::eUavBarrier:
+			list->uavBarrier(getHandle(args[0]));
+			break;
+		case RenderCommandType::eSetPipeline:
+			list->setPipeline(getHandle(args[0]));
+			break;
+		case RenderCommandType::eSetRootConstants:
+			list->setRootConstants(args[0], args[1], payload);
+			break;
+		case RenderCommandType::eSetRootBuffer:
+			list->setRootBuffer(args[0], (RootBufferType)args[1], getHandle(args[2]), args[3]);
+			break;
+		case RenderCommandType::eSetRootTable:
+			list->setRootTable(args[0], args[1] < m_views.size() ? m_views[args[1]] : kInvalidRenderHandle);
+			break;
+		case RenderCommandType::eSetRenderTargets: {
+			RenderHandle targets[8];
+			uint32_t count = (std::min)(args[0], 8u);
+			memcpy(targets, payload, sizeof(RenderHandle) * count);
+			for (uint32_t i = 0; i < count; i++)
+				targets[i] = getHandle(targets[i]);
+			list->setRenderTargets(targets, count, getHandle(args[1]));
+			break;
+		}
+		case RenderCommandType::eClearRenderTarget: {
+			float color[4];
+			memcpy(color, payload, sizeof(color));
+			list->clearRenderTarget(getHandle(args[0]), color);
+			break;
+		}
+		case RenderCommandType::eClearDepthStencil: {
+			float depth;
+			memcpy(&depth, payload, sizeof(depth));
+			list->clearDepthStencil(getHandle(args[0]), depth);
+			break;
+		}
+		case RenderCommandType::eSetViewport: {
+			float viewport[4];
+			memcpy(viewport, payload, sizeof(viewport));
+			list->setViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+			break;
+		}
+		case RenderCommandType::eSetVertexBuffer:
+			list->setVertexBuffer(getHandle(args[0]), args[1], args[2]);
+			break;
+		case RenderCommandType::eSetIndexBuffer:
+			list->setIndexBuffer(getHandle(args[0]), (RenderFormat)args[1], args[2]);
+			break;
+		case RenderCommandType::eDraw:
+			list->draw(args[0], args[1], args[2], args[3]);
+			break;
+		case RenderCommandType::eDrawIndexed:
+			list->drawIndexed(args[0], args[1], args[2], (int32_t)args[3], args[4]);
+			break;
+		case RenderCommandType::eDispatch:
+			list->dispatch(args[0], args[1], args[2]);
+			break;
+		case RenderCommandType::eExecuteIndirect:
+			list->executeIndirect(getHandle(args[0]), args[1], getHandle(args[2]), args[3], getHandle(args[4]), args[5]);
+			break;
+		case RenderCommandType::eCopyBuffer:
+			list->copyBuffer(getHandle(args[0]), args[1], getHandle(args[2]), args[3], args[4]);
+			break;
+		case RenderCommandType::eWriteTimestamp:
+			list->writeTimestamp(getHandle(args[0]), args[1]);
+			break;
+		case RenderCommandType::eResolveTimestamps:
+			list->resolveTimestamps(getHandle(args[0]), args[1], args[2], getHandle(args[3]), args[4]);
+			break;
+		case RenderCommandType::eBeginEvent: {
+			std::string name((const char*)payload, command.payloadSize);
+			list->beginEvent(name.c_str());
+			break;
+		}
+		case RenderCommandType::eEndEvent:
+			list->endEvent();
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+RenderCommandList* CaptureReplayer::getList() {
+	// the lists of a frame are only reused after it was waited for.
+	if (m_listCount == m_lists.size())
+		m_lists.push_back(m_device->createCommandList());
+	return m_lists[m_listCount++].get();
+}
+
+void CaptureReplayer::findFirstStates(const CaptureFile& capture) {
+	m_firstStates.clear();
+
+	std::vector<CommandStream> lists;
+	size_t offset = 0;
+	CaptureChunk chunk;
+	while (capture.nextChunk(offset, chunk)) {
+		if (chunk.type != CaptureChunkType::eSubmit || !CaptureFile::readLists(chunk, lists))
+			continue;
+
+		for (const CommandStream& stream : lists) {
+			for (const RenderCommand& command : stream.getCommands()) {
+				if (command.type == RenderCommandType::eBarrier)
+					m_firstStates.insert({ command.args[0], (ResourceState)command.args[1] });
+			}
+		}
+	}
+}
+
+void CaptureReplayer::transitionSetup() {
+	RenderCommandList* list = nullptr;
+	for (const auto& ite : m_setupStates) {
+		auto first = m_firstStates.find(ite.first);
+		RenderHandle handle = getHandle(ite.first);
+		if (first == m_firstStates.end() || first->second == ite.second || handle == kInvalidRenderHandle)
+			continue;
+
+		if (list == nullptr) {
+			list = getList();
+			list->begin();
+		}
+		list->barrier(handle, ite.second, first->second);
+	}
+
+	if (list) {
+		list->end();
+		m_device->submit(&list, 1);
+	}
+
+	m_device->signal(m_frameFence, ++m_frameValue);
+	m_device->wait(m_frameFence, m_frameValue);
+	m_listCount = 0;
+}
+
+void CaptureReplayer::finishFrame(std::vector<ReplayFrameTime>& times) {
+	if (m_isGpuTiming && m_isFrameBegun) {
+		RenderCommandList* list = getList();
+		list->begin();
+		list->writeTimestamp(m_queries, 1);
+		list->resolveTimestamps(m_queries, 0, 2, m_readback, 0);
+		list->end();
+		m_device->submit(&list, 1);
+	}
+
+	m_device->signal(m_frameFence, ++m_frameValue);
+	m_device->wait(m_frameFence, m_frameValue);
+
+	ReplayFrameTime time;
+	time.cpuTime = m_cpuTime;
+	if (m_isGpuTiming && m_isFrameBegun) {
+		uint64_t timestamps[2];
+		memcpy(timestamps, m_device->map(m_readback), sizeof(timestamps));
+		time.gpuTime = (double)(timestamps[1] - timestamps[0]) * 1000.0 / (double)m_device->getTimestampFrequency();
+	}
+	times.push_back(time);
+
+	m_listCount = 0;
+	m_cpuTime = 0.0;
+	m_isFrameBegun = false;
+}
+
+void CaptureReplayer::setHandle(RenderHandle captured, RenderHandle handle, ResourceState state) {
+	if (captured >= m_handles.size())
+		m_handles.resize(captured + 1, kInvalidRenderHandle);
+	m_handles[captured] = handle;
+
+	if (m_frame < 0 && handle != kInvalidRenderHandle)
+		m_setupStates[captured] = state;
+}
+
+RenderHandle CaptureReplayer::getHandle(RenderHandle captured) const {
+	return captured < m_handles.size() ? m_handles[captured] : kInvalidRenderHandle;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef _CAPTURE_REPLAY_H_
+#define _CAPTURE_REPLAY_H_
+
+#include "render_capture.h"
+
+#include <functional>
+
+struct CaptureFrameStats {
+	uint32_t submits = 0;
+	uint32_t lists = 0;
+	uint32_t commands = 0;
+	uint32_t draws = 0;
+	uint32_t indirectExecutes = 0;
+	uint32_t dispatches = 0;
+	uint32_t copies = 0;
+	uint32_t barriers = 0;
+	uint32_t pipelineChanges = 0;
+	// pipelines, root bindings, render targets, viewports, vertex and index buffers.
+	uint32_t stateChanges = 0;
+	uint32_t resourcesCreated = 0;
+	// creation data and upload buffer writes.
+	uint64_t uploadBytes = 0;
+	// of the recorded streams.
+	uint64_t commandBytes = 0;
+};
+
+struct CaptureStats {
+	// the resources live when the capture started.
+	CaptureFrameStats setup;
+	std::vector<CaptureFrameStats> frames;
+};
+
+bool computeCaptureStats(const CaptureFile& capture, CaptureStats& stats);
+// a line per frame and the average.
+std::string formatCaptureStats(const CaptureStats& stats);
+
+struct ReplayFrameTime {
+	// recording and submitting the lists, in milliseconds.
+	double cpuTime = 0.0;
+	// first to last timestamp of the frame, 0 without gpu timing.
+	double gpuTime = 0.0;
+};
+
+// runs a capture on a device. the handles of the capture are mapped to the ones the device creates, the resources
+// live at the start are moved into the state their first barrier expects, and waits on fence values the replay never
+// signals are skipped. every frame is waited for before the next one, so the frames are timed in isolation.
+class CaptureReplayer {
+public:
+	using PipelineFactory = std::function<RenderHandle(const std::string& name, bool isCompute)>;
+	using CommandSignatureFactory = std::function<RenderHandle(const std::string& name, uint32_t byteStride)>;
+
+	CaptureReplayer() = default;
+	~CaptureReplayer() = default;
+
+	// the pipelines and command signatures by the names they were registered with. a NullRenderDevice creates them
+	// itself, the other backends need the factories.
+	void setPipelineFactory(PipelineFactory factory) { m_pipelineFactory = factory; }
+	void setCommandSignatureFactory(CommandSignatureFactory factory) { m_signatureFactory = factory; }
+
+	// fails when the capture is damaged or a pipeline cannot be created. isGpuTiming brackets each frame with timestamps.
+	bool replay(const CaptureFile& capture, RenderDevice* device, bool isGpuTiming, std::vector<ReplayFrameTime>& times);
+
+private:
+	bool replayChunk(const CaptureChunk& chunk);
+	void replayStream(const CommandStream& stream, RenderCommandList* list);
+	RenderCommandList* getList();
+	void findFirstStates(const CaptureFile& capture);
+	void transitionSetup();
+	void finishFrame(std::vector<ReplayFrameTime>& times);
+	void setHandle(RenderHandle captured, RenderHandle handle, ResourceState state = ResourceState::eCommon);
+	RenderHandle getHandle(RenderHandle captured) const;
+
+	struct Payload {
+		const uint8_t* data;
+		uint64_t size;
+	};
+
+	PipelineFactory m_pipelineFactory;
+	CommandSignatureFactory m_signatureFactory;
+
+	RenderDevice* m_device = nullptr;
+	std::vector<RenderHandle> m_handles;
+	std::vector<uint32_t> m_views;
+	// the state the resources of the setup were created in and the one their first barrier expects.
+	std::unordered_map<RenderHandle, ResourceState> m_setupStates;
+	std::unordered_map<RenderHandle, ResourceState> m_firstStates;
+	std::unordered_map<uint64_t, Payload> m_payloads;
+	std::unordered_map<RenderHandle, uint64_t> m_signaledValues;
+
+	std::vector<std::unique_ptr<RenderCommandList>> m_lists;
+	uint32_t m_listCount = 0;
+	std::vector<CommandStream> m_streams;
+
+	RenderHandle m_frameFence = kInvalidRenderHandle;
+	uint64_t m_frameValue = 0;
+	RenderHandle m_queries = kInvalidRenderHandle;
+	RenderHandle m_readback = kInvalidRenderHandle;
+	std::vector<ReplayFrameTime>* m_times = nullptr;
+	bool m_isGpuTiming = false;
+	bool m_isFrameBegun = false;
+	int m_frame = -1;
+	double m_cpuTime = 0.0;
+};
+
+#endif
\ No newline at end of file
@@ -1,6 +1,16 @@
 #include "command_signature.h"
 
 
+void CommandSignature::addConstant(UINT rootParameterIndex, UINT destOffsetIn32BitValues, UINT num32BitValues) {
+	D3D12_INDIRECT_ARGUMENT_DESC desc{};
+	desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	desc.Constant.RootParameterIndex = rootParameterIndex;
+	desc.Constant.DestOffsetIn32BitValues = destOffsetIn32BitValues;
+	desc.Constant.Num32BitValuesToSet = num32BitValues;
+
+	m_argDescArray.push_back(desc);
+}
+
 void CommandSignature::addConstantBuffer(UINT rootParameterIndex) {
 	D3D12_INDIRECT_ARGUMENT_DESC desc{};
 	desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
@@ -55,40 +65,66 @@ void CommandSignature::addDispatchCommand() {
 }
 
 bool CommandSignature::createDrawIndirect(ID3D12Device* device, ID3D12RootSignature* rootSignature) {
-	HRESULT res;
-
-	D3D12_COMMAND_SIGNATURE_DESC csDesc{};
-
-	csDesc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) + sizeof(uint64_t);
-	csDesc.NumArgumentDescs = m_argDescArray.size();
-	csDesc.pArgumentDescs = m_argDescArray.data();
-	csDesc.NodeMask = 0;
+	return create(device, rootSignature);
+}
 
-	res = device->CreateCommandSignature(&csDesc, rootSignature, IID_PPV_ARGS(m_commandSignature.ReleaseAndGetAddressOf()));
-	if (FAILED(res)) {
-		return false;
-	}
+bool CommandSignature::createDispatchIndirect(ID3D12Device* device, ID3D12RootSignature* rootSignature) {
+	if (m_argDescArray.empty())
+		addDispatchCommand();
 
-	return true;
+	return create(device, rootSignature);
 }
 
-bool CommandSignature::createDispatchIndirect(ID3D12Device* device, ID3D12RootSignature* rootSignature) {
+bool CommandSignature::create(ID3D12Device* device, ID3D12RootSignature* rootSignature) {
 	HRESULT res;
 
-	D3D12_COMMAND_SIGNATURE_DESC csDesc{};
+	UINT byteStride = 0;
+	bool isRootArgument = false;
+	for (auto& ite : m_argDescArray) {
+		switch (ite.Type) {
+		case D3D12_INDIRECT_ARGUMENT_TYPE_DRAW:
+			byteStride += sizeof(D3D12_DRAW_ARGUMENTS);
+			break;
+		case D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED:
+			byteStride += sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+			break;
+		case D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH:
+			byteStride += sizeof(D3D12_DISPATCH_ARGUMENTS);
+			break;
+		case D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW:
+			byteStride += sizeof(D3D12_VERTEX_BUFFER_VIEW);
+			break;
+		case D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW:
+			byteStride += sizeof(D3D12_INDEX_BUFFER_VIEW);
+			break;
+		case D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT:
+			byteStride += ite.Constant.Num32BitValuesToSet * sizeof(UINT);
+			isRootArgument = true;
+			break;
+		case D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW:
+		case D3D12_INDIRECT_ARGUMENT_TYPE_SHADER_RESOURCE_VIEW:
+		case D3D12_INDIRECT_ARGUMENT_TYPE_UNORDERED_ACCESS_VIEW:
+			byteStride += sizeof(D3D12_GPU_VIRTUAL_ADDRESS);
+			isRootArgument = true;
+			break;
+		default:
+			break;
+		}
+	}
 
-	D3D12_INDIRECT_ARGUMENT_DESC args[1];
-	args[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+	D3D12_COMMAND_SIGNATURE_DESC csDesc{};
 
-	csDesc.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
-	csDesc.NumArgumentDescs = ARRAYSIZE(args);
-	csDesc.pArgumentDescs = args;
-	csDesc.NodeMask = 1;
+	csDesc.ByteStride = byteStride;
+	csDesc.NumArgumentDescs = (UINT)m_argDescArray.size();
+	csDesc.pArgumentDescs = m_argDescArray.data();
+	csDesc.NodeMask = 0;
 
-	res = device->CreateCommandSignature(&csDesc, rootSignature, IID_PPV_ARGS(m_commandSignature.ReleaseAndGetAddressOf()));
+	res = device->CreateCommandSignature(&csDesc, isRootArgument ? rootSignature : nullptr, IID_PPV_ARGS(m_commandSignature.ReleaseAndGetAddressOf()));
 	if (FAILED(res)) {
 		return false;
 	}
 
+	m_byteStride = byteStride;
+
 	return true;
 }
\ No newline at end of file
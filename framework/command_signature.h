@@ -11,6 +11,8 @@ public:
 	CommandSignature() = default;
 	~CommandSignature() = default;
 
+	// 32-bit values written to root constants before each draw or dispatch.
+	void addConstant(UINT rootParameterIndex, UINT destOffsetIn32BitValues, UINT num32BitValues);
 	void addConstantBuffer(UINT roodParameterIndex);
 	void addShaderResource(UINT rootParameterIndex);
 	void addUnorderedAccess(UINT rootParamterIndex);
@@ -19,15 +21,22 @@ public:
 	void addDrawIndexedCommand();
 	void addDispatchCommand();
 
+	// the byte stride is the packed size of the arguments in the order they were added. the root signature is
+	// only passed on when an argument changes root parameters.
 	bool createDrawIndirect(ID3D12Device* device, ID3D12RootSignature* rootSignature);
+	// a plain dispatch when no arguments were added.
 	bool createDispatchIndirect(ID3D12Device* device, ID3D12RootSignature* rootSignature);
 
 	ID3D12CommandSignature* getCommandSignatue() { return m_commandSignature.Get(); }
+	UINT getByteStride() { return m_byteStride; }
 
 private:
+	bool create(ID3D12Device* device, ID3D12RootSignature* rootSignature);
+
 	Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_commandSignature;
 
 	std::vector<D3D12_INDIRECT_ARGUMENT_DESC> m_argDescArray;
+	UINT m_byteStride = 0;
 };
 
 #endif
\ No newline at end of file
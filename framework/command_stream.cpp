@@ -0,0 +1,69 @@
+#include "command_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+const char* getRenderCommandName(RenderCommandType type) {
+	switch (type) {
+	case RenderCommandType::eBarrier: return "barrier";
+	case RenderCommandType::eUavBarrier: return "uavBarrier";
+	case RenderCommandType::eSetPipeline: return "setPipeline";
+	case RenderCommandType::eSetRootConstants: return "setRootConstants";
+	case RenderCommandType::eSetRootBuffer: return "setRootBuffer";
+	case RenderCommandType::eSetRootTable: return "setRootTable";
+	case RenderCommandType::eSetRenderTargets: return "setRenderTargets";
+	case RenderCommandType::eClearRenderTarget: return "clearRenderTarget";
+	case RenderCommandType::eClearDepthStencil: return "clearDepthStencil";
+	case RenderCommandType::eSetViewport: return "setViewport";
+	case RenderCommandType::eSetVertexBuffer: return "setVertexBuffer";
+	case RenderCommandType::eSetIndexBuffer: return "setIndexBuffer";
+	case RenderCommandType::eDraw: return "draw";
+	case RenderCommandType::eDrawIndexed: return "drawIndexed";
+	case RenderCommandType::eDispatch: return "dispatch";
+	case RenderCommandType::eExecuteIndirect: return "executeIndirect";
+	case RenderCommandType::eCopyBuffer: return "copyBuffer";
+	case RenderCommandType::eWriteTimestamp: return "writeTimestamp";
+	case RenderCommandType::eResolveTimestamps: return "resolveTimestamps";
+	case RenderCommandType::eBeginEvent: return "beginEvent";
+	case RenderCommandType::eEndEvent: return "endEvent";
+	default: return "unknown";
+	}
+}
+
+void CommandStream::clear() {
+	m_commands.clear();
+	m_payload.clear();
+}
+
+void CommandStream::record(RenderCommandType type, std::initializer_list<uint32_t> args, const void* payload, uint32_t payloadSize) {
+	RenderCommand command{};
+	command.type = type;
+	std::copy(args.begin(), args.begin() + std::min(args.size(), (size_t)6), command.args);
+	command.payloadOffset = (uint32_t)m_payload.size();
+	command.payloadSize = payloadSize;
+	if (payloadSize > 0) {
+		m_payload.resize(m_payload.size() + payloadSize);
+		memcpy(m_payload.data() + command.payloadOffset, payload, payloadSize);
+	}
+
+	m_commands.push_back(command);
+}
+
+void CommandStream::record(const RenderCommand& command, const void* payload) {
+	m_commands.push_back(command);
+	m_commands.back().payloadOffset = (uint32_t)m_payload.size();
+	if (command.payloadSize > 0) {
+		m_payload.resize(m_payload.size() + command.payloadSize);
+		memcpy(m_payload.data() + m_commands.back().payloadOffset, payload, command.payloadSize);
+	}
+}
+
+uint32_t CommandStream::countCommands(RenderCommandType type) const {
+	uint32_t count = 0;
+	for (const RenderCommand& command : m_commands) {
+		if (command.type == type)
+			count++;
+	}
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef _COMMAND_STREAM_H_
+#define _COMMAND_STREAM_H_
+
+#include "render_device.h"
+
+#include <initializer_list>
+#include <vector>
+
+// the calls of RenderCommandList, args in the order of the call unless noted.
+enum class RenderCommandType : uint8_t {
+	eBarrier,				// resource, before, after
+	eUavBarrier,			// resource
+	eSetPipeline,			// pipeline
+	eSetRootConstants,		// parameter, count; payload the values
+	eSetRootBuffer,			// parameter, type, buffer, offset
+	eSetRootTable,			// parameter, descriptor
+	eSetRenderTargets,		// count, depthStencil; payload the targets
+	eClearRenderTarget,		// target; payload the color
+	eClearDepthStencil,		// depthStencil; payload the depth
+	eSetViewport,			// payload x, y, width, height
+	eSetVertexBuffer,		// buffer, stride, offset
+	eSetIndexBuffer,		// buffer, format, offset
+	eDraw,					// vertexCount, instanceCount, firstVertex, firstInstance
+	eDrawIndexed,			// indexCount, instanceCount, firstIndex, vertexOffset, firstInstance
+	eDispatch,				// x, y, z
+	eExecuteIndirect,		// signature, maxCount, argumentBuffer, argumentOffset, countBuffer, countOffset
+	eCopyBuffer,			// dest, destOffset, source, sourceOffset, size
+	eWriteTimestamp,		// queries, index
+	eResolveTimestamps,		// queries, first, count, dest, destOffset
+	eBeginEvent,			// payload the name without the terminator
+	eEndEvent,
+	eCount,
+};
+
+struct RenderCommand {
+	RenderCommandType type;
+	uint32_t args[6];
+	uint32_t payloadOffset;
+	uint32_t payloadSize;
+};
+
+const char* getRenderCommandName(RenderCommandType type);
+
+// commands recorded as plain values with their variable sized data in one payload array, so a frame can be inspected,
+// counted or written out without touching a device.
+class CommandStream {
+public:
+	CommandStream() = default;
+	~CommandStream() = default;
+
+	void clear();
+	void record(RenderCommandType type, std::initializer_list<uint32_t> args, const void* payload = nullptr, uint32_t payloadSize = 0);
+	// a command read back from a capture, its payloadOffset is replaced.
+	void record(const RenderCommand& command, const void* payload);
+
+	uint32_t getCommandCount() const { return (uint32_t)m_commands.size(); }
+	const RenderCommand& getCommand(uint32_t index) const { return m_commands[index]; }
+	const std::vector<RenderCommand>& getCommands() const { return m_commands; }
+	const void* getPayload(const RenderCommand& command) const { return m_payload.data() + command.payloadOffset; }
+	const std::vector<uint8_t>& getPayloadData() const { return m_payload; }
+
+	uint32_t countCommands(RenderCommandType type) const;
+	size_t getMemorySize() const { return m_commands.size() * sizeof(RenderCommand) + m_payload.size(); }
+
+private:
+	std::vector<RenderCommand> m_commands;
+	std::vector<uint8_t> m_payload;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,592 @@
+#include "d3d12_device.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+static D3D12_RESOURCE_STATES toD3D12State(ResourceState state) {
+	switch (state) {
+	case ResourceState::eVertexAndConstantBuffer: return D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+	case ResourceState::eIndexBuffer: return D3D12_RESOURCE_STATE_INDEX_BUFFER;
+	case ResourceState::eShaderResource: return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	case ResourceState::eUnorderedAccess: return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	case ResourceState::eRenderTarget: return D3D12_RESOURCE_STATE_RENDER_TARGET;
+	case ResourceState::eDepthWrite: return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	case ResourceState::eIndirectArgument: return D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+	case ResourceState::eCopySource: return D3D12_RESOURCE_STATE_COPY_SOURCE;
+	case ResourceState::eCopyDest: return D3D12_RESOURCE_STATE_COPY_DEST;
+	case ResourceState::eGenericRead: return D3D12_RESOURCE_STATE_GENERIC_READ;
+	case ResourceState::ePresent: return D3D12_RESOURCE_STATE_PRESENT;
+	default: return D3D12_RESOURCE_STATE_COMMON;
+	}
+}
+
+static DXGI_FORMAT toDxgiFormat(RenderFormat format) {
+	switch (format) {
+	case RenderFormat::eRgba8Unorm: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case RenderFormat::eRgba16Float: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case RenderFormat::eR32Float: return DXGI_FORMAT_R32_FLOAT;
+	case RenderFormat::eR32Uint: return DXGI_FORMAT_R32_UINT;
+	case RenderFormat::eRg32Uint: return DXGI_FORMAT_R32G32_UINT;
+	// typeless so the depth can also be read as r32 float.
+	case RenderFormat::eD32Float: return DXGI_FORMAT_R32_TYPELESS;
+	default: return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+static D3D12_HEAP_PROPERTIES getHeapProperties(D3D12_HEAP_TYPE type) {
+	D3D12_HEAP_PROPERTIES heapProp{};
+	heapProp.Type = type;
+	heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProp.CreationNodeMask = 1;
+	heapProp.VisibleNodeMask = 1;
+	return heapProp;
+}
+
+static D3D12_RESOURCE_DESC getBufferDesc(UINT64 size, D3D12_RESOURCE_FLAGS flags) {
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Alignment = 0;
+	resDesc.Width = size;
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.SampleDesc.Quality = 0;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resDesc.Flags = flags;
+	return resDesc;
+}
+
+
+bool D3D12CommandList::create(ID3D12Device* device) {
+	if (!m_commandAllocator.createGraphicsCommandAllocator(device))
+		return false;
+	if (!m_commandList.createGraphicsCommandList(device, m_commandAllocator.getCommandAllocator()))
+		return false;
+
+	return true;
+}
+
+void D3D12CommandList::begin() {
+	ID3D12GraphicsCommandList* command = m_commandList.getCommandList();
+	m_commandAllocator.getCommandAllocator()->Reset();
+	command->Reset(m_commandAllocator.getCommandAllocator(), nullptr);
+
+	ID3D12DescriptorHeap* heaps[] = { m_device->m_viewHeap.getDescriptorHeap() };
+	command->SetDescriptorHeaps(_countof(heaps), heaps);
+	m_isCompute = false;
+}
+
+void D3D12CommandList::end() {
+	m_commandList.getCommandList()->Close();
+}
+
+void D3D12CommandList::barrier(RenderHandle resource, ResourceState before, ResourceState after) {
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Transition.pResource = m_device->getResource(resource);
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	barrier.Transition.StateBefore = toD3D12State(before);
+	barrier.Transition.StateAfter = toD3D12State(after);
+	m_commandList.getCommandList()->ResourceBarrier(1, &barrier);
+}
+
+void D3D12CommandList::uavBarrier(RenderHandle resource) {
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+	barrier.UAV.pResource = m_device->getResource(resource);
+	m_commandList.getCommandList()->ResourceBarrier(1, &barrier);
+}
+
+void D3D12CommandList::setPipeline(RenderHandle pipeline) {
+	ID3D12GraphicsCommandList* command = m_commandList.getCommandList();
+	const D3D12RenderDevice::Object& object = m_device->m_objects[pipeline];
+	m_isCompute = object.isCompute;
+	command->SetPipelineState(object.pipeline);
+	if (m_isCompute) {
+		command->SetComputeRootSignature(object.rootSignature);
+	}
+	else {
+		command->SetGraphicsRootSignature(object.rootSignature);
+		command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	}
+}
+
+void D3D12CommandList::setRootConstants(uint32_t parameter, uint32_t count, const void* values) {
+	if (m_isCompute)
+		m_commandList.getCommandList()->SetComputeRoot32BitConstants(parameter, count, values, 0);
+	else
+		m_commandList.getCommandList()->SetGraphicsRoot32BitConstants(parameter, count, values, 0);
+}
+
+void D3D12CommandList::setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset) {
+	ID3D12GraphicsCommandList* command = m_commandList.getCommandList();
+	D3D12_GPU_VIRTUAL_ADDRESS address = m_device->getResource(buffer)->GetGPUVirtualAddress() + offset;
+	switch (type) {
+	case RootBufferType::eConstantBuffer:
+		if (m_isCompute)
+			command->SetComputeRootConstantBufferView(parameter, address);
+		else
+			command->SetGraphicsRootConstantBufferView(parameter, address);
+		break;
+	case RootBufferType::eShaderResource:
+		if (m_isCompute)
+			command->SetComputeRootShaderResourceView(parameter, address);
+		else
+			command->SetGraphicsRootShaderResourceView(parameter, address);
+		break;
+	case RootBufferType::eUnorderedAccess:
+		if (m_isCompute)
+			command->SetComputeRootUnorderedAccessView(parameter, address);
+		else
+			command->SetGraphicsRootUnorderedAccessView(parameter, address);
+		break;
+	}
+}
+
+void D3D12CommandList::setRootTable(uint32_t parameter, uint32_t descriptor) {
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = m_device->m_viewHeap.getGpuHandle(descriptor);
+	if (m_isCompute)
+		m_commandList.getCommandList()->SetComputeRootDescriptorTable(parameter, handle);
+	else
+		m_commandList.getCommandList()->SetGraphicsRootDescriptorTable(parameter, handle);
+}
+
+void D3D12CommandList::setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) {
+	D3D12_CPU_DESCRIPTOR_HANDLE handles[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	count = (std::min)(count, (uint32_t)D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+	for (uint32_t i = 0; i < count; i++)
+		handles[i] = m_device->m_renderTargetHeap.getCpuHandle(m_device->m_objects[targets[i]].renderTarget);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE depthHandle{};
+	if (depthStencil != kInvalidRenderHandle)
+		depthHandle = m_device->m_depthStencilHeap.getCpuHandle(m_device->m_objects[depthStencil].depthStencil);
+
+	m_commandList.getCommandList()->OMSetRenderTargets(count, handles, FALSE, depthStencil != kInvalidRenderHandle ? &depthHandle : nullptr);
+}
+
+void D3D12CommandList::clearRenderTarget(RenderHandle target, const float color[4]) {
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = m_device->m_renderTargetHeap.getCpuHandle(m_device->m_objects[target].renderTarget);
+	m_commandList.getCommandList()->ClearRenderTargetView(handle, color, 0, nullptr);
+}
+
+void D3D12CommandList::clearDepthStencil(RenderHandle depthStencil, float depth) {
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = m_device->m_depthStencilHeap.getCpuHandle(m_device->m_objects[depthStencil].depthStencil);
+	m_commandList.getCommandList()->ClearDepthStencilView(handle, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr);
+}
+
+void D3D12CommandList::setViewport(float x, float y, float width, float height) {
+	D3D12_VIEWPORT viewport = { x, y, width, height, 0.0f, 1.0f };
+	D3D12_RECT scissor = { (LONG)x, (LONG)y, (LONG)(x + width), (LONG)(y + height) };
+	m_commandList.getCommandList()->RSSetViewports(1, &viewport);
+	m_commandList.getCommandList()->RSSetScissorRects(1, &scissor);
+}
+
+void D3D12CommandList::setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset) {
+	const D3D12RenderDevice::Object& object = m_device->m_objects[buffer];
+	D3D12_VERTEX_BUFFER_VIEW view{};
+	view.BufferLocation = object.resource->GetGPUVirtualAddress() + offset;
+	view.SizeInBytes = (UINT)(object.size - offset);
+	view.StrideInBytes = stride;
+	m_commandList.getCommandList()->IASetVertexBuffers(0, 1, &view);
+}
+
+void D3D12CommandList::setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset) {
+	const D3D12RenderDevice::Object& object = m_device->m_objects[buffer];
+	D3D12_INDEX_BUFFER_VIEW view{};
+	view.BufferLocation = object.resource->GetGPUVirtualAddress() + offset;
+	view.SizeInBytes = (UINT)(object.size - offset);
+	view.Format = format == RenderFormat::eR32Uint ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	m_commandList.getCommandList()->IASetIndexBuffer(&view);
+}
+
+void D3D12CommandList::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+	m_commandList.getCommandList()->DrawInstanced(vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void D3D12CommandList::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+	m_commandList.getCommandList()->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+void D3D12CommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+	m_commandList.getCommandList()->Dispatch(x, y, z);
+}
+
+void D3D12CommandList::executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+	RenderHandle countBuffer, uint32_t countOffset) {
+	ID3D12Resource* countResource = countBuffer != kInvalidRenderHandle ? m_device->getResource(countBuffer) : nullptr;
+	m_commandList.getCommandList()->ExecuteIndirect(m_device->m_objects[signature].commandSignature, maxCount,
+		m_device->getResource(argumentBuffer), argumentOffset, countResource, countOffset);
+}
+
+void D3D12CommandList::copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) {
+	m_commandList.getCommandList()->CopyBufferRegion(m_device->getResource(dest), destOffset, m_device->getResource(source), sourceOffset, size);
+}
+
+void D3D12CommandList::writeTimestamp(RenderHandle queries, uint32_t index) {
+	m_commandList.getCommandList()->EndQuery(m_device->m_objects[queries].queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, index);
+}
+
+void D3D12CommandList::resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) {
+	m_commandList.getCommandList()->ResolveQueryData(m_device->m_objects[queries].queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count,
+		m_device->getResource(dest), destOffset);
+}
+
+void D3D12CommandList::beginEvent(const char* name) {
+	// metadata 1 is an ansi string to pix and the graphics debuggers.
+	m_commandList.getCommandList()->BeginEvent(1, name, (UINT)strlen(name) + 1);
+}
+
+void D3D12CommandList::endEvent() {
+	m_commandList.getCommandList()->EndEvent();
+}
+
+
+D3D12RenderDevice::~D3D12RenderDevice() {
+	if (m_uploadFence) {
+		// nothing may still be in flight when the resources are released.
+		Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+		if (SUCCEEDED(getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.GetAddressOf())))) {
+			m_queue.getQueue()->Signal(fence.Get(), 1);
+			fence->SetEventOnCompletion(1, m_fenceEvent);
+			WaitForSingleObject(m_fenceEvent, INFINITE);
+		}
+	}
+
+	for (auto& ite : m_objects) {
+		if (ite.mapped)
+			ite.resource->Unmap(0, nullptr);
+	}
+
+	if (m_fenceEvent)
+		CloseHandle(m_fenceEvent);
+}
+
+bool D3D12RenderDevice::create() {
+	if (!m_device.create())
+		return false;
+
+	ID3D12Device* device = m_device.getDevice();
+	if (!m_queue.createGraphicsQueue(device))
+		return false;
+
+	if (!m_viewHeap.create(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, kD3D12ViewCount))
+		return false;
+	if (!m_renderTargetHeap.create(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE, kD3D12RenderTargetCount))
+		return false;
+	if (!m_depthStencilHeap.create(device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE, kD3D12DepthStencilCount))
+		return false;
+
+	if (!m_uploadAllocator.createGraphicsCommandAllocator(device))
+		return false;
+	if (!m_uploadList.createGraphicsCommandList(device, m_uploadAllocator.getCommandAllocator()))
+		return false;
+	if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_uploadFence.ReleaseAndGetAddressOf()))))
+		return false;
+
+	m_fenceEvent = CreateEvent(0, FALSE, FALSE, 0);
+
+	return m_fenceEvent != nullptr;
+}
+
+RenderHandle D3D12RenderDevice::createBuffer(const BufferDesc& desc, const void* data) {
+	D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_DEFAULT;
+	D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+	if (desc.memoryType == MemoryType::eUpload) {
+		heapType = D3D12_HEAP_TYPE_UPLOAD;
+		state = D3D12_RESOURCE_STATE_GENERIC_READ;
+	}
+	else if (desc.memoryType == MemoryType::eReadback) {
+		heapType = D3D12_HEAP_TYPE_READBACK;
+		state = D3D12_RESOURCE_STATE_COPY_DEST;
+	}
+
+	Object object;
+	object.size = (std::max)(desc.size, (uint64_t)1);
+	D3D12_HEAP_PROPERTIES heapProp = getHeapProperties(heapType);
+	D3D12_RESOURCE_DESC resDesc = getBufferDesc(object.size,
+		desc.isUnorderedAccess ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE);
+	HRESULT res = getDevice()->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc, state, nullptr,
+		IID_PPV_ARGS(object.resource.ReleaseAndGetAddressOf()));
+	if (FAILED(res)) {
+		logRenderError("d3d12 device: failed creating " + desc.name + ".\n");
+		return kInvalidRenderHandle;
+	}
+
+	std::wstring name(desc.name.begin(), desc.name.end());
+	object.resource->SetName(name.c_str());
+
+	if (desc.memoryType != MemoryType::eDefault) {
+		object.resource->Map(0, nullptr, reinterpret_cast<void**>(&object.mapped));
+		if (data && object.mapped)
+			memcpy(object.mapped, data, (size_t)desc.size);
+	}
+	else if (data && !upload(object.resource.Get(), data, desc.size)) {
+		logRenderError("d3d12 device: failed uploading " + desc.name + ".\n");
+		return kInvalidRenderHandle;
+	}
+
+	return addObject(std::move(object));
+}
+
+RenderHandle D3D12RenderDevice::createTexture(const TextureDesc& desc) {
+	ID3D12Device* device = getDevice();
+
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	resDesc.Width = desc.width;
+	resDesc.Height = desc.height;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = (UINT16)desc.mipLevels;
+	resDesc.Format = toDxgiFormat(desc.format);
+	resDesc.SampleDesc.Count = 1;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	if (desc.isRenderTarget)
+		resDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+	if (desc.isDepthStencil)
+		resDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+	if (desc.isUnorderedAccess)
+		resDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+	D3D12_CLEAR_VALUE clearValue{};
+	D3D12_CLEAR_VALUE* clearValuePtr = nullptr;
+	D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+	if (desc.isDepthStencil) {
+		clearValue.Format = DXGI_FORMAT_D32_FLOAT;
+		clearValue.DepthStencil.Depth = 1.0f;
+		clearValuePtr = &clearValue;
+		state = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	}
+	else if (desc.isRenderTarget) {
+		clearValue.Format = resDesc.Format;
+		clearValuePtr = &clearValue;
+		state = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	}
+
+	Object object;
+	object.isTexture = true;
+	object.format = desc.format;
+	object.mipLevels = desc.mipLevels;
+	D3D12_HEAP_PROPERTIES heapProp = getHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+	HRESULT res = device->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc, state, clearValuePtr,
+		IID_PPV_ARGS(object.resource.ReleaseAndGetAddressOf()));
+	if (FAILED(res)) {
+		logRenderError("d3d12 device: failed creating " + desc.name + ".\n");
+		return kInvalidRenderHandle;
+	}
+
+	std::wstring name(desc.name.begin(), desc.name.end());
+	object.resource->SetName(name.c_str());
+
+	if (desc.isRenderTarget && m_renderTargetCount < kD3D12RenderTargetCount) {
+		object.renderTarget = m_renderTargetCount++;
+		device->CreateRenderTargetView(object.resource.Get(), nullptr, m_renderTargetHeap.getCpuHandle(object.renderTarget));
+	}
+	if (desc.isDepthStencil && m_depthStencilCount < kD3D12DepthStencilCount) {
+		D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+		object.depthStencil = m_depthStencilCount++;
+		device->CreateDepthStencilView(object.resource.Get(), &dsvDesc, m_depthStencilHeap.getCpuHandle(object.depthStencil));
+	}
+
+	return addObject(std::move(object));
+}
+
+RenderHandle D3D12RenderDevice::createTimestampQueries(uint32_t count) {
+	D3D12_QUERY_HEAP_DESC qhDesc{};
+	qhDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	qhDesc.Count = count;
+
+	Object object;
+	if (FAILED(getDevice()->CreateQueryHeap(&qhDesc, IID_PPV_ARGS(object.queryHeap.ReleaseAndGetAddressOf())))) {
+		logRenderError("d3d12 device: failed creating a timestamp query heap.\n");
+		return kInvalidRenderHandle;
+	}
+
+	return addObject(std::move(object));
+}
+
+void D3D12RenderDevice::destroy(RenderHandle resource) {
+	if (resource >= m_objects.size())
+		return;
+
+	Object& object = m_objects[resource];
+	if (object.mapped)
+		object.resource->Unmap(0, nullptr);
+	object = Object();
+}
+
+void* D3D12RenderDevice::map(RenderHandle buffer) {
+	return m_objects[buffer].mapped;
+}
+
+uint32_t D3D12RenderDevice::createView(RenderHandle resource, ViewType type, uint32_t stride) {
+	if (m_viewCount >= kD3D12ViewCount) {
+		logRenderError("d3d12 device: out of views.\n");
+		return kInvalidRenderHandle;
+	}
+
+	ID3D12Device* device = getDevice();
+	const Object& object = m_objects[resource];
+	UINT index = m_viewCount++;
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = m_viewHeap.getCpuHandle(index);
+
+	if (type == ViewType::eConstantBuffer) {
+		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
+		cbvDesc.BufferLocation = object.resource->GetGPUVirtualAddress();
+		cbvDesc.SizeInBytes = (UINT)((object.size + 255) & ~255);
+		device->CreateConstantBufferView(&cbvDesc, handle);
+	}
+	else if (object.isTexture) {
+		DXGI_FORMAT format = object.format == RenderFormat::eD32Float ? DXGI_FORMAT_R32_FLOAT : toDxgiFormat(object.format);
+		if (type == ViewType::eShaderResource) {
+			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+			srvDesc.Format = format;
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			srvDesc.Texture2D.MipLevels = object.mipLevels;
+			device->CreateShaderResourceView(object.resource.Get(), &srvDesc, handle);
+		}
+		else {
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+			uavDesc.Format = format;
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+			device->CreateUnorderedAccessView(object.resource.Get(), nullptr, &uavDesc, handle);
+		}
+	}
+	else {
+		// raw views count 32 bit words.
+		UINT elementSize = stride > 0 ? stride : 4;
+		DXGI_FORMAT format = stride > 0 ? DXGI_FORMAT_UNKNOWN : DXGI_FORMAT_R32_TYPELESS;
+		if (type == ViewType::eShaderResource) {
+			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+			srvDesc.Format = format;
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			srvDesc.Buffer.NumElements = (UINT)(object.size / elementSize);
+			srvDesc.Buffer.StructureByteStride = stride;
+			srvDesc.Buffer.Flags = stride > 0 ? D3D12_BUFFER_SRV_FLAG_NONE : D3D12_BUFFER_SRV_FLAG_RAW;
+			device->CreateShaderResourceView(object.resource.Get(), &srvDesc, handle);
+		}
+		else {
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+			uavDesc.Format = format;
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+			uavDesc.Buffer.NumElements = (UINT)(object.size / elementSize);
+			uavDesc.Buffer.StructureByteStride = stride;
+			uavDesc.Buffer.Flags = stride > 0 ? D3D12_BUFFER_UAV_FLAG_NONE : D3D12_BUFFER_UAV_FLAG_RAW;
+			device->CreateUnorderedAccessView(object.resource.Get(), nullptr, &uavDesc, handle);
+		}
+	}
+
+	return index;
+}
+
+std::unique_ptr<RenderCommandList> D3D12RenderDevice::createCommandList() {
+	std::unique_ptr<D3D12CommandList> list(new D3D12CommandList(this));
+	if (!list->create(getDevice()))
+		return nullptr;
+
+	return std::move(list);
+}
+
+void D3D12RenderDevice::submit(RenderCommandList* const* lists, uint32_t count) {
+	std::vector<ID3D12CommandList*> commandLists(count);
+	for (uint32_t i = 0; i < count; i++)
+		commandLists[i] = static_cast<D3D12CommandList*>(lists[i])->getCommandList();
+
+	m_queue.getQueue()->ExecuteCommandLists(count, commandLists.data());
+}
+
+RenderHandle D3D12RenderDevice::createFence() {
+	Object object;
+	if (FAILED(getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(object.fence.ReleaseAndGetAddressOf())))) {
+		logRenderError("d3d12 device: failed creating a fence.\n");
+		return kInvalidRenderHandle;
+	}
+
+	return addObject(std::move(object));
+}
+
+void D3D12RenderDevice::signal(RenderHandle fence, uint64_t value) {
+	m_queue.getQueue()->Signal(m_objects[fence].fence.Get(), value);
+}
+
+uint64_t D3D12RenderDevice::getCompletedValue(RenderHandle fence) {
+	return m_objects[fence].fence->GetCompletedValue();
+}
+
+void D3D12RenderDevice::wait(RenderHandle fence, uint64_t value) {
+	ID3D12Fence* d3dFence = m_objects[fence].fence.Get();
+	if (d3dFence->GetCompletedValue() < value) {
+		d3dFence->SetEventOnCompletion(value, m_fenceEvent);
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+uint64_t D3D12RenderDevice::getTimestampFrequency() {
+	UINT64 frequency = 0;
+	m_queue.getQueue()->GetTimestampFrequency(&frequency);
+	return frequency;
+}
+
+RenderHandle D3D12RenderDevice::addPipeline(ID3D12PipelineState* pipeline, ID3D12RootSignature* rootSignature, bool isCompute) {
+	Object object;
+	object.pipeline = pipeline;
+	object.rootSignature = rootSignature;
+	object.isCompute = isCompute;
+	return addObject(std::move(object));
+}
+
+RenderHandle D3D12RenderDevice::addCommandSignature(ID3D12CommandSignature* commandSignature) {
+	Object object;
+	object.commandSignature = commandSignature;
+	return addObject(std::move(object));
+}
+
+RenderHandle D3D12RenderDevice::addObject(Object&& object) {
+	m_objects.push_back(std::move(object));
+	return (RenderHandle)m_objects.size() - 1;
+}
+
+bool D3D12RenderDevice::upload(ID3D12Resource* dest, const void* data, UINT64 size) {
+	ID3D12Device* device = getDevice();
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer;
+	D3D12_HEAP_PROPERTIES heapProp = getHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+	D3D12_RESOURCE_DESC resDesc = getBufferDesc(size, D3D12_RESOURCE_FLAG_NONE);
+	HRESULT res = device->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr, IID_PPV_ARGS(stagingBuffer.ReleaseAndGetAddressOf()));
+	if (FAILED(res))
+		return false;
+
+	BYTE* mappedData;
+	if (FAILED(stagingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData))))
+		return false;
+	memcpy(mappedData, data, (size_t)size);
+	stagingBuffer->Unmap(0, nullptr);
+
+	// the buffer is promoted from common to copy dest by the copy and decays back once the copy completes.
+	ID3D12CommandAllocator* commandAlloc = m_uploadAllocator.getCommandAllocator();
+	ID3D12GraphicsCommandList* command = m_uploadList.getCommandList();
+	commandAlloc->Reset();
+	command->Reset(commandAlloc, nullptr);
+	command->CopyBufferRegion(dest, 0, stagingBuffer.Get(), 0, size);
+	command->Close();
+
+	ID3D12CommandList* commandLists[] = { command };
+	m_queue.getQueue()->ExecuteCommandLists(_countof(commandLists), commandLists);
+	m_queue.getQueue()->Signal(m_uploadFence.Get(), ++m_uploadFenceValue);
+	if (m_uploadFence->GetCompletedValue() < m_uploadFenceValue) {
+		m_uploadFence->SetEventOnCompletion(m_uploadFenceValue, m_fenceEvent);
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#ifndef _D3D12_DEVICE_H_
+#define _D3D12_DEVICE_H_
+
+#include "render_device.h"
+#include "device.h"
+#include "queue.h"
+#include "commandbuffer.h"
+#include "descriptor_heap.h"
+
+#include <climits>
+#include <vector>
+
+// shader visible views, render target views and depth stencil views the device can hand out.
+static const UINT kD3D12ViewCount = 4096;
+static const UINT kD3D12RenderTargetCount = 256;
+static const UINT kD3D12DepthStencilCount = 64;
+
+class D3D12RenderDevice;
+
+class D3D12CommandList : public RenderCommandList {
+public:
+	D3D12CommandList(D3D12RenderDevice* device) : m_device(device) {}
+	~D3D12CommandList() = default;
+
+	bool create(ID3D12Device* device);
+
+	void begin() override;
+	void end() override;
+
+	void barrier(RenderHandle resource, ResourceState before, ResourceState after) override;
+	void uavBarrier(RenderHandle resource) override;
+
+	void setPipeline(RenderHandle pipeline) override;
+	void setRootConstants(uint32_t parameter, uint32_t count, const void* values) override;
+	void setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset) override;
+	void setRootTable(uint32_t parameter, uint32_t descriptor) override;
+
+	void setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) override;
+	void clearRenderTarget(RenderHandle target, const float color[4]) override;
+	void clearDepthStencil(RenderHandle depthStencil, float depth) override;
+	void setViewport(float x, float y, float width, float height) override;
+	void setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset) override;
+	void setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset) override;
+
+	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) override;
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) override;
+	void dispatch(uint32_t x, uint32_t y, uint32_t z) override;
+	void executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+		RenderHandle countBuffer, uint32_t countOffset) override;
+
+	void copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) override;
+
+	void writeTimestamp(RenderHandle queries, uint32_t index) override;
+	void resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) override;
+
+	void beginEvent(const char* name) override;
+	void endEvent() override;
+
+	ID3D12GraphicsCommandList* getCommandList() { return m_commandList.getCommandList(); }
+
+private:
+	D3D12RenderDevice* m_device;
+	CommandAllocator m_commandAllocator;
+	CommandList m_commandList;
+	// the root bindings go to the compute slots after a compute pipeline.
+	bool m_isCompute = false;
+};
+
+// the framework classes behind RenderDevice. resources are committed, the views live in one shader visible heap that
+// every command list binds at begin.
+class D3D12RenderDevice : public RenderDevice {
+public:
+	D3D12RenderDevice() = default;
+	~D3D12RenderDevice();
+
+	bool create();
+
+	RenderBackend getBackend() override { return RenderBackend::eD3D12; }
+
+	RenderHandle createBuffer(const BufferDesc& desc, const void* data = nullptr) override;
+	RenderHandle createTexture(const TextureDesc& desc) override;
+	RenderHandle createTimestampQueries(uint32_t count) override;
+	void destroy(RenderHandle resource) override;
+
+	void* map(RenderHandle buffer) override;
+	void unmap(RenderHandle buffer) override {}
+
+	uint32_t createView(RenderHandle resource, ViewType type, uint32_t stride = 0) override;
+
+	std::unique_ptr<RenderCommandList> createCommandList() override;
+	void submit(RenderCommandList* const* lists, uint32_t count) override;
+
+	RenderHandle createFence() override;
+	void signal(RenderHandle fence, uint64_t value) override;
+	uint64_t getCompletedValue(RenderHandle fence) override;
+	void wait(RenderHandle fence, uint64_t value) override;
+
+	uint64_t getTimestampFrequency() override;
+
+	// pipelines and signatures built with the framework classes, they have to outlive their use.
+	RenderHandle addPipeline(ID3D12PipelineState* pipeline, ID3D12RootSignature* rootSignature, bool isCompute);
+	RenderHandle addCommandSignature(ID3D12CommandSignature* commandSignature);
+
+	ID3D12Device* getDevice() { return m_device.getDevice(); }
+	ID3D12CommandQueue* getQueue() { return m_queue.getQueue(); }
+	ID3D12Resource* getResource(RenderHandle resource) { return m_objects[resource].resource.Get(); }
+
+private:
+	friend class D3D12CommandList;
+
+	struct Object {
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		Microsoft::WRL::ComPtr<ID3D12QueryHeap> queryHeap;
+		Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+		ID3D12PipelineState* pipeline = nullptr;
+		ID3D12RootSignature* rootSignature = nullptr;
+		ID3D12CommandSignature* commandSignature = nullptr;
+		bool isCompute = false;
+		bool isTexture = false;
+		BYTE* mapped = nullptr;
+		UINT64 size = 0;
+		RenderFormat format = RenderFormat::eUnknown;
+		UINT mipLevels = 1;
+		UINT renderTarget = UINT_MAX;
+		UINT depthStencil = UINT_MAX;
+	};
+
+	RenderHandle addObject(Object&& object);
+	bool upload(ID3D12Resource* dest, const void* data, UINT64 size);
+
+	Device m_device;
+	Queue m_queue;
+	DescriptorHeap m_viewHeap;
+	DescriptorHeap m_renderTargetHeap;
+	DescriptorHeap m_depthStencilHeap;
+	UINT m_viewCount = 0;
+	UINT m_renderTargetCount = 0;
+	UINT m_depthStencilCount = 0;
+
+	std::vector<Object> m_objects;
+	HANDLE m_fenceEvent = nullptr;
+
+	// createBuffer copies its data with these and waits.
+	CommandAllocator m_uploadAllocator;
+	CommandList m_uploadList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_uploadFence;
+	UINT64 m_uploadFenceValue = 0;
+};
+
+#endif
\ No newline at end of file
@@ -14,6 +14,9 @@ public:
 	bool create(ID3D12Device* device);
 
 	UINT64 getFenceValue() { return ++m_fenceValue; }
+	// value that Queue::waitForFence signals next with the value returned by getFenceValue.
+	UINT64 getNextSignalValue() { return m_fenceValue; }
+	UINT64 getCompletedValue() { return m_fence->GetCompletedValue(); }
 	ID3D12Fence* getFence() { return m_fence.Get(); }
 	HANDLE getFenceEvent() { return m_fenceEvent; }
 
@@ -0,0 +1,166 @@
+#include "file_watcher.h"
+
+#ifndef _WIN32
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+#ifdef _WIN32
+
+bool FileWatcher::create(const std::filesystem::path& directory) {
+	destroy();
+
+	m_directory = directory;
+
+	m_directoryHandle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (m_directoryHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	m_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (m_event == NULL) {
+		destroy();
+		return false;
+	}
+
+	if (!issueRead()) {
+		destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void FileWatcher::destroy() {
+	if (m_directoryHandle != INVALID_HANDLE_VALUE) {
+		CancelIo(m_directoryHandle);
+		DWORD transferred;
+		GetOverlappedResult(m_directoryHandle, &m_overlapped, &transferred, TRUE);
+		CloseHandle(m_directoryHandle);
+		m_directoryHandle = INVALID_HANDLE_VALUE;
+	}
+	if (m_event != NULL) {
+		CloseHandle(m_event);
+		m_event = NULL;
+	}
+}
+
+bool FileWatcher::issueRead() {
+	ZeroMemory(&m_overlapped, sizeof(m_overlapped));
+	m_overlapped.hEvent = m_event;
+	ResetEvent(m_event);
+
+	return ReadDirectoryChangesW(m_directoryHandle, m_buffer, sizeof(m_buffer), TRUE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE,
+		NULL, &m_overlapped, NULL) != FALSE;
+}
+
+bool FileWatcher::poll(std::vector<std::filesystem::path>& changedFiles) {
+	if (m_directoryHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD transferred = 0;
+	if (!GetOverlappedResult(m_directoryHandle, &m_overlapped, &transferred, FALSE)) {
+		return GetLastError() == ERROR_IO_INCOMPLETE;
+	}
+
+	// a zero sized result means the buffer overflowed, the caller only learns that something changed.
+	if (transferred == 0)
+		changedFiles.push_back(m_directory);
+
+	size_t offset = 0;
+	while (transferred != 0) {
+		const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(m_buffer + offset);
+		std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+		changedFiles.push_back(m_directory / name);
+
+		if (info->NextEntryOffset == 0)
+			break;
+		offset += info->NextEntryOffset;
+	}
+
+	return issueRead();
+}
+
+#else
+
+bool FileWatcher::create(const std::filesystem::path& directory) {
+	destroy();
+
+	m_directory = directory;
+
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0)
+		return false;
+
+	if (!addWatch(directory)) {
+		destroy();
+		return false;
+	}
+
+	std::error_code ec;
+	for (auto& ite : std::filesystem::recursive_directory_iterator(directory, ec)) {
+		if (ite.is_directory(ec))
+			addWatch(ite.path());
+	}
+
+	return true;
+}
+
+void FileWatcher::destroy() {
+	if (m_inotify >= 0) {
+		close(m_inotify);
+		m_inotify = -1;
+	}
+	m_watches.clear();
+}
+
+bool FileWatcher::addWatch(const std::filesystem::path& directory) {
+	int descriptor = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+	if (descriptor < 0)
+		return false;
+
+	m_watches.push_back({ descriptor, directory });
+	return true;
+}
+
+bool FileWatcher::poll(std::vector<std::filesystem::path>& changedFiles) {
+	if (m_inotify < 0)
+		return false;
+
+	alignas(inotify_event) char buffer[16 * 1024];
+	while (true) {
+		ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+		if (length < 0)
+			return errno == EAGAIN;
+		if (length == 0)
+			return true;
+
+		for (ssize_t offset = 0; offset < length;) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				changedFiles.push_back(m_directory);
+				continue;
+			}
+
+			for (auto& ite : m_watches) {
+				if (ite.descriptor != event->wd)
+					continue;
+
+				std::filesystem::path path = event->len > 0 ? ite.directory / event->name : ite.directory;
+				if ((event->mask & IN_CREATE) && (event->mask & IN_ISDIR))
+					addWatch(path);
+				else
+					changedFiles.push_back(path);
+				break;
+			}
+		}
+	}
+}
+
+#endif
\ No newline at end of file
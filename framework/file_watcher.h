@@ -0,0 +1,49 @@
+#ifndef _FILE_WATCHER_H_
+#define _FILE_WATCHER_H_
+
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+// reports files modified under a directory (recursively). ReadDirectoryChangesW on windows, inotify elsewhere.
+class FileWatcher {
+public:
+	FileWatcher() = default;
+	~FileWatcher() { destroy(); }
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool create(const std::filesystem::path& directory);
+	void destroy();
+
+	// non-blocking. appends the paths changed since the last call.
+	bool poll(std::vector<std::filesystem::path>& changedFiles);
+
+private:
+	std::filesystem::path m_directory;
+
+#ifdef _WIN32
+	bool issueRead();
+
+	HANDLE m_directoryHandle = INVALID_HANDLE_VALUE;
+	HANDLE m_event = NULL;
+	OVERLAPPED m_overlapped{};
+	alignas(DWORD) char m_buffer[16 * 1024];
+#else
+	struct Watch {
+		int descriptor;
+		std::filesystem::path directory;
+	};
+
+	bool addWatch(const std::filesystem::path& directory);
+
+	int m_inotify = -1;
+	std::vector<Watch> m_watches;
+#endif
+};
+
+#endif
\ No newline at end of file
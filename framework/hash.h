@@ -0,0 +1,45 @@
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// 64-bit FNV-1a, used for the shader and pipeline cache keys.
+static const uint64_t kHashSeed = 14695981039346656037ull;
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = kHashSeed) {
+	const uint8_t* ptr = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= ptr[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+template<class T>
+inline uint64_t hashValue(const T& value, uint64_t hash = kHashSeed) {
+	return hashBytes(&value, sizeof(T), hash);
+}
+
+inline uint64_t hashString(const std::string& str, uint64_t hash = kHashSeed) {
+	hash = hashValue(str.size(), hash);
+	return hashBytes(str.data(), str.size(), hash);
+}
+
+inline uint64_t hashString(const std::wstring& str, uint64_t hash = kHashSeed) {
+	hash = hashValue(str.size(), hash);
+	return hashBytes(str.data(), str.size() * sizeof(wchar_t), hash);
+}
+
+inline std::string hashToString(uint64_t hash) {
+	static const char* digits = "0123456789abcdef";
+	std::string str(16, '0');
+	for (int i = 15; i >= 0; i--) {
+		str[i] = digits[hash & 0xf];
+		hash >>= 4;
+	}
+	return str;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "null_device.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+void NullCommandList::begin() {
+	m_stream.clear();
+	m_isRecording = true;
+}
+
+void NullCommandList::end() {
+	m_isRecording = false;
+}
+
+void NullCommandList::barrier(RenderHandle resource, ResourceState before, ResourceState after) {
+	m_stream.record(RenderCommandType::eBarrier, { resource, (uint32_t)before, (uint32_t)after });
+}
+
+void NullCommandList::uavBarrier(RenderHandle resource) {
+	m_stream.record(RenderCommandType::eUavBarrier, { resource });
+}
+
+void NullCommandList::setPipeline(RenderHandle pipeline) {
+	m_stream.record(RenderCommandType::eSetPipeline, { pipeline });
+}
+
+void NullCommandList::setRootConstants(uint32_t parameter, uint32_t count, const void* values) {
+	m_stream.record(RenderCommandType::eSetRootConstants, { parameter, count }, values, count * sizeof(uint32_t));
+}
+
+void NullCommandList::setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset) {
+	m_stream.record(RenderCommandType::eSetRootBuffer, { parameter, (uint32_t)type, buffer, offset });
+}
+
+void NullCommandList::setRootTable(uint32_t parameter, uint32_t descriptor) {
+	m_stream.record(RenderCommandType::eSetRootTable, { parameter, descriptor });
+}
+
+void NullCommandList::setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) {
+	m_stream.record(RenderCommandType::eSetRenderTargets, { count, depthStencil }, targets, count * sizeof(RenderHandle));
+}
+
+void NullCommandList::clearRenderTarget(RenderHandle target, const float color[4]) {
+	m_stream.record(RenderCommandType::eClearRenderTarget, { target }, color, sizeof(float) * 4);
+}
+
+void NullCommandList::clearDepthStencil(RenderHandle depthStencil, float depth) {
+	m_stream.record(RenderCommandType::eClearDepthStencil, { depthStencil }, &depth, sizeof(float));
+}
+
+void NullCommandList::setViewport(float x, float y, float width, float height) {
+	float viewport[] = { x, y, width, height };
+	m_stream.record(RenderCommandType::eSetViewport, {}, viewport, sizeof(viewport));
+}
+
+void NullCommandList::setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset) {
+	m_stream.record(RenderCommandType::eSetVertexBuffer, { buffer, stride, offset });
+}
+
+void NullCommandList::setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset) {
+	m_stream.record(RenderCommandType::eSetIndexBuffer, { buffer, (uint32_t)format, offset });
+}
+
+void NullCommandList::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+	m_stream.record(RenderCommandType::eDraw, { vertexCount, instanceCount, firstVertex, firstInstance });
+}
+
+void NullCommandList::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+	m_stream.record(RenderCommandType::eDrawIndexed, { indexCount, instanceCount, firstIndex, (uint32_t)vertexOffset, firstInstance });
+}
+
+void NullCommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+	m_stream.record(RenderCommandType::eDispatch, { x, y, z });
+}
+
+void NullCommandList::executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+	RenderHandle countBuffer, uint32_t countOffset) {
+	m_stream.record(RenderCommandType::eExecuteIndirect, { signature, maxCount, argumentBuffer, argumentOffset, countBuffer, countOffset });
+}
+
+void NullCommandList::copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) {
+	m_stream.record(RenderCommandType::eCopyBuffer, { dest, destOffset, source, sourceOffset, size });
+}
+
+void NullCommandList::writeTimestamp(RenderHandle queries, uint32_t index) {
+	m_stream.record(RenderCommandType::eWriteTimestamp, { queries, index });
+}
+
+void NullCommandList::resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) {
+	m_stream.record(RenderCommandType::eResolveTimestamps, { queries, first, count, dest, destOffset });
+}
+
+void NullCommandList::beginEvent(const char* name) {
+	m_stream.record(RenderCommandType::eBeginEvent, {}, name, (uint32_t)strlen(name));
+}
+
+void NullCommandList::endEvent() {
+	m_stream.record(RenderCommandType::eEndEvent, {});
+}
+
+
+RenderHandle NullRenderDevice::createBuffer(const BufferDesc& desc, const void* data) {
+	Object object;
+	object.type = ObjectType::eBuffer;
+	object.name = desc.name;
+	object.memoryType = desc.memoryType;
+	object.memory.resize((size_t)desc.size);
+	if (data)
+		memcpy(object.memory.data(), data, (size_t)desc.size);
+
+	if (desc.memoryType == MemoryType::eUpload)
+		object.state = ResourceState::eGenericRead;
+	else if (desc.memoryType == MemoryType::eReadback)
+		object.state = ResourceState::eCopyDest;
+
+	return addObject(std::move(object));
+}
+
+RenderHandle NullRenderDevice::createTexture(const TextureDesc& desc) {
+	Object object;
+	object.type = ObjectType::eTexture;
+	object.name = desc.name;
+
+	size_t size = 0;
+	for (uint32_t i = 0; i < std::max(desc.mipLevels, 1u); i++)
+		size += (size_t)std::max(desc.width >> i, 1u) * std::max(desc.height >> i, 1u) * getFormatSize(desc.format);
+	object.memory.resize(size);
+
+	if (desc.isDepthStencil)
+		object.state = ResourceState::eDepthWrite;
+	else if (desc.isRenderTarget)
+		object.state = ResourceState::eRenderTarget;
+
+	return addObject(std::move(object));
+}
+
+RenderHandle NullRenderDevice::createTimestampQueries(uint32_t count) {
+	Object object;
+	object.type = ObjectType::eQueries;
+	object.name = "timestampQueries";
+	object.memory.resize((size_t)count * sizeof(uint64_t));
+	return addObject(std::move(object));
+}
+
+void NullRenderDevice::destroy(RenderHandle resource) {
+	if (resource >= m_objects.size())
+		return;
+
+	m_objects[resource].type = ObjectType::eDestroyed;
+	m_objects[resource].memory = std::vector<uint8_t>();
+}
+
+void* NullRenderDevice::map(RenderHandle buffer) {
+	Object* object = findObject(buffer, ObjectType::eBuffer, "map");
+	if (!object)
+		return nullptr;
+	if (object->memoryType == MemoryType::eDefault) {
+		error("map: " + object->name + " is not an upload or readback buffer.");
+		return nullptr;
+	}
+
+	return object->memory.data();
+}
+
+uint32_t NullRenderDevice::createView(RenderHandle resource, ViewType, uint32_t stride) {
+	Object* object = findResource(resource, "createView");
+	if (object && stride > 0 && object->memory.size() % stride != 0)
+		error("createView: the size of " + object->name + " is not a multiple of the stride " + std::to_string(stride) + ".");
+
+	m_views.push_back(resource);
+	return (uint32_t)m_views.size() - 1;
+}
+
+std::unique_ptr<RenderCommandList> NullRenderDevice::createCommandList() {
+	return std::unique_ptr<RenderCommandList>(new NullCommandList());
+}
+
+void NullRenderDevice::submit(RenderCommandList* const* lists, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		NullCommandList* list = dynamic_cast<NullCommandList*>(lists[i]);
+		if (!list) {
+			error("submit: the command list is not from the null device.");
+			continue;
+		}
+		if (list->isRecording())
+			error("submit: the command list was not ended.");
+
+		execute(list->getStream());
+	}
+
+	m_submitCount++;
+}
+
+RenderHandle NullRenderDevice::createFence() {
+	Object object;
+	object.type = ObjectType::eFence;
+	object.name = "fence";
+	return addObject(std::move(object));
+}
+
+void NullRenderDevice::signal(RenderHandle fence, uint64_t value) {
+	Object* object = findObject(fence, ObjectType::eFence, "signal");
+	if (object)
+		object->fenceValue = value;
+}
+
+uint64_t NullRenderDevice::getCompletedValue(RenderHandle fence) {
+	Object* object = findObject(fence, ObjectType::eFence, "getCompletedValue");
+	return object ? object->fenceValue : 0;
+}
+
+void NullRenderDevice::wait(RenderHandle fence, uint64_t value) {
+	Object* object = findObject(fence, ObjectType::eFence, "wait");
+	if (object && object->fenceValue < value)
+		error("wait: the fence is at " + std::to_string(object->fenceValue) + " and nothing signals " + std::to_string(value) + ", a device would hang.");
+}
+
+RenderHandle NullRenderDevice::createPipeline(const std::string& name, bool isCompute) {
+	Object object;
+	object.type = ObjectType::ePipeline;
+	object.name = name;
+	object.isCompute = isCompute;
+	return addObject(std::move(object));
+}
+
+RenderHandle NullRenderDevice::createCommandSignature(const std::string& name, uint32_t byteStride) {
+	Object object;
+	object.type = ObjectType::eCommandSignature;
+	object.name = name;
+	object.byteStride = byteStride;
+	return addObject(std::move(object));
+}
+
+ResourceState NullRenderDevice::getState(RenderHandle resource) const {
+	return resource < m_objects.size() ? m_objects[resource].state : ResourceState::eCommon;
+}
+
+const std::vector<uint8_t>& NullRenderDevice::getMemory(RenderHandle resource) const {
+	static const std::vector<uint8_t> empty;
+	return resource < m_objects.size() ? m_objects[resource].memory : empty;
+}
+
+const std::string& NullRenderDevice::getName(RenderHandle handle) const {
+	static const std::string empty;
+	return handle < m_objects.size() ? m_objects[handle].name : empty;
+}
+
+RenderHandle NullRenderDevice::addObject(Object&& object) {
+	m_objects.push_back(std::move(object));
+	return (RenderHandle)m_objects.size() - 1;
+}
+
+NullRenderDevice::Object* NullRenderDevice::findObject(RenderHandle handle, ObjectType type, const char* call) {
+	if (handle >= m_objects.size() || m_objects[handle].type != type) {
+		error(std::string(call) + ": invalid handle " + std::to_string(handle) + ".");
+		return nullptr;
+	}
+	return &m_objects[handle];
+}
+
+NullRenderDevice::Object* NullRenderDevice::findResource(RenderHandle handle, const char* call) {
+	if (handle < m_objects.size() && m_objects[handle].type == ObjectType::eTexture)
+		return &m_objects[handle];
+	return findObject(handle, ObjectType::eBuffer, call);
+}
+
+bool NullRenderDevice::checkRange(RenderHandle buffer, uint64_t offset, uint64_t size, const char* call) {
+	Object* object = findObject(buffer, ObjectType::eBuffer, call);
+	if (!object)
+		return false;
+	if (offset + size > object->memory.size()) {
+		error(std::string(call) + ": " + std::to_string(size) + " bytes at " + std::to_string(offset) + " are outside of " + object->name + ".");
+		return false;
+	}
+	return true;
+}
+
+void NullRenderDevice::execute(const CommandStream& stream) {
+	RenderHandle pipeline = kInvalidRenderHandle;
+	int eventDepth = 0;
+
+	for (const RenderCommand& command : stream.getCommands()) {
+		const uint32_t* args = command.args;
+		switch (command.type) {
+		case RenderCommandType::eBarrier: {
+			Object* object = findResource(args[0], "barrier");
+			if (!object)
+				break;
+			if (object->state != (ResourceState)args[1]) {
+				error("barrier: " + object->name + " is in " + getResourceStateName(object->state) + ", not in " +
+					getResourceStateName((ResourceState)args[1]) + ".");
+			}
+			object->state = (ResourceState)args[2];
+			break;
+		}
+		case RenderCommandType::eSetPipeline:
+			if (findObject(args[0], ObjectType::ePipeline, "setPipeline"))
+				pipeline = args[0];
+			break;
+		case RenderCommandType::eSetRootBuffer:
+			findObject(args[2], ObjectType::eBuffer, "setRootBuffer");
+			break;
+		case RenderCommandType::eSetRootTable:
+			if (args[1] >= m_views.size())
+				error("setRootTable: descriptor " + std::to_string(args[1]) + " is out of range.");
+			break;
+		case RenderCommandType::eSetVertexBuffer:
+			findObject(args[0], ObjectType::eBuffer, "setVertexBuffer");
+			break;
+		case RenderCommandType::eSetIndexBuffer:
+			findObject(args[0], ObjectType::eBuffer, "setIndexBuffer");
+			break;
+		case RenderCommandType::eDraw:
+		case RenderCommandType::eDrawIndexed:
+			if (pipeline == kInvalidRenderHandle || m_objects[pipeline].isCompute)
+				error(std::string(getRenderCommandName(command.type)) + ": no graphics pipeline is set.");
+			break;
+		case RenderCommandType::eDispatch:
+			if (pipeline == kInvalidRenderHandle || !m_objects[pipeline].isCompute)
+				error("dispatch: no compute pipeline is set.");
+			break;
+		case RenderCommandType::eExecuteIndirect: {
+			Object* signature = findObject(args[0], ObjectType::eCommandSignature, "executeIndirect");
+			if (pipeline == kInvalidRenderHandle)
+				error("executeIndirect: no pipeline is set.");
+			if (signature)
+				checkRange(args[2], args[3], (uint64_t)signature->byteStride * args[1], "executeIndirect");
+			if (args[4] != kInvalidRenderHandle)
+				checkRange(args[4], args[5], sizeof(uint32_t), "executeIndirect");
+			break;
+		}
+		case RenderCommandType::eCopyBuffer:
+			if (checkRange(args[0], args[1], args[4], "copyBuffer") && checkRange(args[2], args[3], args[4], "copyBuffer"))
+				memmove(m_objects[args[0]].memory.data() + args[1], m_objects[args[2]].memory.data() + args[3], args[4]);
+			break;
+		case RenderCommandType::eWriteTimestamp: {
+			Object* queries = findObject(args[0], ObjectType::eQueries, "writeTimestamp");
+			if (!queries)
+				break;
+			if ((args[1] + 1) * sizeof(uint64_t) > queries->memory.size()) {
+				error("writeTimestamp: query " + std::to_string(args[1]) + " is out of range.");
+				break;
+			}
+			uint64_t ticks = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			memcpy(queries->memory.data() + args[1] * sizeof(uint64_t), &ticks, sizeof(ticks));
+			break;
+		}
+		case RenderCommandType::eResolveTimestamps: {
+			Object* queries = findObject(args[0], ObjectType::eQueries, "resolveTimestamps");
+			uint32_t size = args[2] * (uint32_t)sizeof(uint64_t);
+			if (!queries || !checkRange(args[3], args[4], size, "resolveTimestamps"))
+				break;
+			if ((args[1] + args[2]) * sizeof(uint64_t) > queries->memory.size()) {
+				error("resolveTimestamps: the queries are out of range.");
+				break;
+			}
+			if (m_objects[args[3]].state != ResourceState::eCopyDest)
+				error("resolveTimestamps: " + m_objects[args[3]].name + " is not in eCopyDest.");
+			memcpy(m_objects[args[3]].memory.data() + args[4], queries->memory.data() + args[1] * sizeof(uint64_t), size);
+			break;
+		}
+		case RenderCommandType::eBeginEvent:
+			eventDepth++;
+			break;
+		case RenderCommandType::eEndEvent:
+			if (--eventDepth < 0) {
+				error("endEvent: no event is open.");
+				eventDepth = 0;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (eventDepth != 0)
+		error("submit: " + std::to_string(eventDepth) + " events are still open.");
+}
+
+void NullRenderDevice::error(const std::string& message) {
+	m_errors.push_back(message);
+	logRenderError("null device: " + message + "\n");
+}
\ No newline at end of file
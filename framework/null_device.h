@@ -0,0 +1,136 @@
+#ifndef _NULL_DEVICE_H_
+#define _NULL_DEVICE_H_
+
+#include "render_device.h"
+#include "command_stream.h"
+
+#include <vector>
+
+// records every call into a CommandStream that stays inspectable until the next begin.
+class NullCommandList : public RenderCommandList {
+public:
+	NullCommandList() = default;
+	~NullCommandList() = default;
+
+	void begin() override;
+	void end() override;
+
+	void barrier(RenderHandle resource, ResourceState before, ResourceState after) override;
+	void uavBarrier(RenderHandle resource) override;
+
+	void setPipeline(RenderHandle pipeline) override;
+	void setRootConstants(uint32_t parameter, uint32_t count, const void* values) override;
+	void setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset) override;
+	void setRootTable(uint32_t parameter, uint32_t descriptor) override;
+
+	void setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) override;
+	void clearRenderTarget(RenderHandle target, const float color[4]) override;
+	void clearDepthStencil(RenderHandle depthStencil, float depth) override;
+	void setViewport(float x, float y, float width, float height) override;
+	void setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset) override;
+	void setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset) override;
+
+	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) override;
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) override;
+	void dispatch(uint32_t x, uint32_t y, uint32_t z) override;
+	void executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+		RenderHandle countBuffer, uint32_t countOffset) override;
+
+	void copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) override;
+
+	void writeTimestamp(RenderHandle queries, uint32_t index) override;
+	void resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) override;
+
+	void beginEvent(const char* name) override;
+	void endEvent() override;
+
+	const CommandStream& getStream() const { return m_stream; }
+	bool isRecording() const { return m_isRecording; }
+
+private:
+	CommandStream m_stream;
+	bool m_isRecording = false;
+};
+
+// a device without a gpu. resources are host memory, submit runs the copies, timestamps and state checks of the
+// streams at once and fences complete as soon as they are signaled, so nothing ever waits. the errors a real device
+// would hit (barriers from the wrong state, draws without a pipeline, copies, handles or descriptors out of range,
+// waits that never finish) are collected for the caller and logged.
+class NullRenderDevice : public RenderDevice {
+public:
+	NullRenderDevice() = default;
+	~NullRenderDevice() = default;
+
+	RenderBackend getBackend() override { return RenderBackend::eNull; }
+
+	RenderHandle createBuffer(const BufferDesc& desc, const void* data = nullptr) override;
+	RenderHandle createTexture(const TextureDesc& desc) override;
+	RenderHandle createTimestampQueries(uint32_t count) override;
+	void destroy(RenderHandle resource) override;
+
+	void* map(RenderHandle buffer) override;
+	void unmap(RenderHandle) override {}
+
+	uint32_t createView(RenderHandle resource, ViewType type, uint32_t stride = 0) override;
+
+	std::unique_ptr<RenderCommandList> createCommandList() override;
+	void submit(RenderCommandList* const* lists, uint32_t count) override;
+
+	RenderHandle createFence() override;
+	void signal(RenderHandle fence, uint64_t value) override;
+	uint64_t getCompletedValue(RenderHandle fence) override;
+	void wait(RenderHandle fence, uint64_t value) override;
+
+	// nanoseconds of a steady clock read when submit runs the timestamp, not anything the gpu would take.
+	uint64_t getTimestampFrequency() override { return 1000000000ull; }
+
+	RenderHandle createPipeline(const std::string& name, bool isCompute);
+	RenderHandle createCommandSignature(const std::string& name, uint32_t byteStride);
+
+	ResourceState getState(RenderHandle resource) const;
+	const std::vector<uint8_t>& getMemory(RenderHandle resource) const;
+	const std::string& getName(RenderHandle handle) const;
+	uint32_t getSubmitCount() const { return m_submitCount; }
+	uint32_t getViewCount() const { return (uint32_t)m_views.size(); }
+
+	const std::vector<std::string>& getErrors() const { return m_errors; }
+	void clearErrors() { m_errors.clear(); }
+
+private:
+	enum class ObjectType {
+		eBuffer,
+		eTexture,
+		eQueries,
+		eFence,
+		ePipeline,
+		eCommandSignature,
+		eDestroyed,
+	};
+
+	struct Object {
+		ObjectType type;
+		std::string name;
+		std::vector<uint8_t> memory;
+		ResourceState state = ResourceState::eCommon;
+		MemoryType memoryType = MemoryType::eDefault;
+		uint64_t fenceValue = 0;
+		bool isCompute = false;
+		// of a command signature.
+		uint32_t byteStride = 0;
+	};
+
+	RenderHandle addObject(Object&& object);
+	Object* findObject(RenderHandle handle, ObjectType type, const char* call);
+	Object* findResource(RenderHandle handle, const char* call);
+	bool checkRange(RenderHandle buffer, uint64_t offset, uint64_t size, const char* call);
+	void execute(const CommandStream& stream);
+	void error(const std::string& message);
+
+	std::vector<Object> m_objects;
+	// the resource of every view.
+	std::vector<RenderHandle> m_views;
+	uint32_t m_submitCount = 0;
+	std::vector<std::string> m_errors;
+};
+
+#endif
\ No newline at end of file
@@ -1,9 +1,99 @@
 #include "pipeline.h"
 
+#include "hash.h"
+#include "pipeline_cache.h"
+#include "pipeline_key.h"
+
+
+namespace {
+
+uint64_t hashShader(const D3D12_SHADER_BYTECODE& shader) {
+	if (shader.pShaderBytecode == nullptr || shader.BytecodeLength == 0)
+		return 0;
+	return hashBytes(shader.pShaderBytecode, shader.BytecodeLength);
+}
+
+GraphicsPipelineKey getPipelineKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+	GraphicsPipelineKey key;
+	key.rootSignature = PipelineCache::getRootSignatureHash(desc.pRootSignature);
+	key.vertexShader = hashShader(desc.VS);
+	key.geometoryShader = hashShader(desc.GS);
+	key.pixelShader = hashShader(desc.PS);
+
+	for (UINT i = 0; i < desc.InputLayout.NumElements; i++) {
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		InputElementKey elementKey;
+		elementKey.semanticName = element.SemanticName;
+		elementKey.semanticIndex = element.SemanticIndex;
+		elementKey.format = element.Format;
+		elementKey.inputSlot = element.InputSlot;
+		elementKey.alignedByteOffset = element.AlignedByteOffset;
+		elementKey.inputSlotClass = element.InputSlotClass;
+		elementKey.instanceDataStepRate = element.InstanceDataStepRate;
+		key.inputLayout.push_back(elementKey);
+	}
+
+	key.fillMode = desc.RasterizerState.FillMode;
+	key.cullMode = desc.RasterizerState.CullMode;
+	key.frontCounterClockwise = desc.RasterizerState.FrontCounterClockwise;
+	key.depthBias = desc.RasterizerState.DepthBias;
+	key.depthBiasClamp = desc.RasterizerState.DepthBiasClamp;
+	key.slopeScaledDepthBias = desc.RasterizerState.SlopeScaledDepthBias;
+	key.depthClipEnable = desc.RasterizerState.DepthClipEnable;
+	key.multisampleEnable = desc.RasterizerState.MultisampleEnable;
+	key.antialiasedLineEnable = desc.RasterizerState.AntialiasedLineEnable;
+	key.forcedSampleCount = desc.RasterizerState.ForcedSampleCount;
+	key.conservativeRaster = desc.RasterizerState.ConservativeRaster;
+
+	key.alphaToCoverageEnable = desc.BlendState.AlphaToCoverageEnable;
+	key.independentBlendEnable = desc.BlendState.IndependentBlendEnable;
+	for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; i++) {
+		const D3D12_RENDER_TARGET_BLEND_DESC& blend = desc.BlendState.RenderTarget[i];
+		RenderTargetBlendKey blendKey;
+		blendKey.blendEnable = blend.BlendEnable;
+		blendKey.logicOpEnable = blend.LogicOpEnable;
+		blendKey.srcBlend = blend.SrcBlend;
+		blendKey.destBlend = blend.DestBlend;
+		blendKey.blendOp = blend.BlendOp;
+		blendKey.srcBlendAlpha = blend.SrcBlendAlpha;
+		blendKey.destBlendAlpha = blend.DestBlendAlpha;
+		blendKey.blendOpAlpha = blend.BlendOpAlpha;
+		blendKey.logicOp = blend.LogicOp;
+		blendKey.renderTargetWriteMask = blend.RenderTargetWriteMask;
+		key.blend.push_back(blendKey);
+	}
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	key.depthEnable = depthStencil.DepthEnable;
+	key.depthWriteMask = depthStencil.DepthWriteMask;
+	key.depthFunc = depthStencil.DepthFunc;
+	key.stencilEnable = depthStencil.StencilEnable;
+	key.stencilReadMask = depthStencil.StencilReadMask;
+	key.stencilWriteMask = depthStencil.StencilWriteMask;
+	key.frontFace = { (uint32_t)depthStencil.FrontFace.StencilFailOp, (uint32_t)depthStencil.FrontFace.StencilDepthFailOp,
+		(uint32_t)depthStencil.FrontFace.StencilPassOp, (uint32_t)depthStencil.FrontFace.StencilFunc };
+	key.backFace = { (uint32_t)depthStencil.BackFace.StencilFailOp, (uint32_t)depthStencil.BackFace.StencilDepthFailOp,
+		(uint32_t)depthStencil.BackFace.StencilPassOp, (uint32_t)depthStencil.BackFace.StencilFunc };
+
+	for (UINT i = 0; i < desc.NumRenderTargets && i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+		key.renderTargetFormats.push_back(desc.RTVFormats[i]);
+	key.depthStencilFormat = desc.DSVFormat;
+	key.primitiveTopologyType = desc.PrimitiveTopologyType;
+	key.sampleMask = desc.SampleMask;
+	key.sampleCount = desc.SampleDesc.Count;
+	key.sampleQuality = desc.SampleDesc.Quality;
+
+	return key;
+}
+
+}
+
 
 bool Pipeline::create(ID3D12Device* device, ID3D12RootSignature* rootSignature) {
 	HRESULT res;
 
+	m_task.reset();
+
 	D3D12_RENDER_TARGET_BLEND_DESC rtblendDesc{};
 	if (m_blendState == BlendState::eNone) {
 		rtblendDesc.BlendEnable = FALSE;
@@ -74,7 +164,11 @@ bool Pipeline::create(ID3D12Device* device, ID3D12RootSignature* rootSignature)
 	gpsDesc.SampleDesc.Count = 1;
 	gpsDesc.SampleDesc.Quality = 0;
 
-	res = device->CreateGraphicsPipelineState(&gpsDesc, IID_PPV_ARGS(m_pipelineState.ReleaseAndGetAddressOf()));
+	// pipelines whose root signature is not known to the cache are created directly.
+	GraphicsPipelineKey key = getPipelineKey(gpsDesc);
+	uint64_t keyHash = key.rootSignature != 0 ? hashPipelineKey(key) : 0;
+
+	res = PipelineCache::Instance().createGraphicsPipeline(device, gpsDesc, keyHash, m_pipelineState.ReleaseAndGetAddressOf());
 	if (FAILED(res)) {
 		return false;
 	}
@@ -82,6 +176,34 @@ bool Pipeline::create(ID3D12Device* device, ID3D12RootSignature* rootSignature)
 	return true;
 }
 
+bool Pipeline::createAsync(PipelineCompiler* compiler, ID3D12Device* device, ID3D12RootSignature* rootSignature) {
+	Pipeline pipeline = *this;
+	pipeline.m_pipelineState.Reset();
+	pipeline.m_task.reset();
+	pipeline.m_fallback = nullptr;
+
+	m_task = compiler->submit([pipeline, device, rootSignature](Microsoft::WRL::ComPtr<ID3D12PipelineState>& pipelineState) mutable {
+		if (!pipeline.create(device, rootSignature))
+			return false;
+		pipelineState = pipeline.m_pipelineState;
+		return true;
+	});
+
+	return m_task->getStatus() != PipelineStatus::eFailed;
+}
+
+ID3D12PipelineState* Pipeline::getPipelineState() {
+	if (m_task && m_task->getStatus() != PipelineStatus::ePending) {
+		if (m_task->isReady())
+			m_pipelineState = m_task->getPipelineState();
+		m_task.reset();
+	}
+
+	if (m_pipelineState || m_fallback == nullptr)
+		return m_pipelineState.Get();
+	return m_fallback->getPipelineState();
+}
+
 void Pipeline::addInputLayout(const char* name, DXGI_FORMAT format, UINT semanticIndex) {
 	D3D12_INPUT_ELEMENT_DESC layout{};
 	layout.SemanticName = name;
@@ -169,18 +291,53 @@ void Pipeline::setPrimitiveType(D3D12_PRIMITIVE_TOPOLOGY_TYPE type) {
 bool ComputePipeline::create(ID3D12Device* device, ID3D12RootSignature* rootSignature) {
 	HRESULT res;
 
+	m_task.reset();
+
 	D3D12_COMPUTE_PIPELINE_STATE_DESC cpsDesc{};
 	cpsDesc.CS = { m_computeShader->GetBufferPointer(), m_computeShader->GetBufferSize() };
 	cpsDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 	cpsDesc.pRootSignature = rootSignature;
 
-	res = device->CreateComputePipelineState(&cpsDesc, IID_PPV_ARGS(m_pipelineState.ReleaseAndGetAddressOf()));
+	ComputePipelineKey key;
+	key.rootSignature = PipelineCache::getRootSignatureHash(rootSignature);
+	key.computeShader = hashShader(cpsDesc.CS);
+	uint64_t keyHash = key.rootSignature != 0 ? hashPipelineKey(key) : 0;
+
+	res = PipelineCache::Instance().createComputePipeline(device, cpsDesc, keyHash, m_pipelineState.ReleaseAndGetAddressOf());
 	if (FAILED(res))
 		return false;
 
 	return true;
 }
 
+bool ComputePipeline::createAsync(PipelineCompiler* compiler, ID3D12Device* device, ID3D12RootSignature* rootSignature) {
+	ComputePipeline pipeline = *this;
+	pipeline.m_pipelineState.Reset();
+	pipeline.m_task.reset();
+	pipeline.m_fallback = nullptr;
+
+	m_task = compiler->submit([pipeline, device, rootSignature](Microsoft::WRL::ComPtr<ID3D12PipelineState>& pipelineState) mutable {
+		if (!pipeline.create(device, rootSignature))
+			return false;
+		pipelineState = pipeline.m_pipelineState;
+		return true;
+	});
+
+	return m_task->getStatus() != PipelineStatus::eFailed;
+}
+
+ID3D12PipelineState* ComputePipeline::getPipelineState() {
+	if (m_task && m_task->getStatus() != PipelineStatus::ePending) {
+		if (m_task->isReady())
+			m_pipelineState = m_task->getPipelineState();
+		m_task.reset();
+	}
+
+	if (m_pipelineState || m_fallback == nullptr)
+		return m_pipelineState.Get();
+	return m_fallback->getPipelineState();
+}
+
 void ComputePipeline::setComputeShader(IDxcBlob* blob) {
 	m_computeShader = blob;
 }
\ No newline at end of file
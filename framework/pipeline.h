@@ -7,6 +7,8 @@
 #include <wrl/client.h>
 #include <vector>
 
+#include "pipeline_compiler.h"
+
 
 enum class BlendState {
 	eNone,
@@ -20,6 +22,12 @@ public:
 	~Pipeline() = default;
 
 	bool create(ID3D12Device* device, ID3D12RootSignature* rootSignature);
+	// creates the pipeline on the compiler's worker threads from a copy of the current state. the shader blobs
+	// and the root signature have to stay alive until the pipeline is ready.
+	bool createAsync(PipelineCompiler* compiler, ID3D12Device* device, ID3D12RootSignature* rootSignature);
+
+	// used while this pipeline is still compiling. it has to share the root signature.
+	void setFallback(Pipeline* fallback) { m_fallback = fallback; }
 
 	void addInputLayout(const char* name, DXGI_FORMAT format, UINT semanticIndex);
 	void addRenderTargetFormat(DXGI_FORMAT format);
@@ -36,26 +44,30 @@ public:
 	void setPixelShader(IDxcBlob* blob);
 	void setPrimitiveType(D3D12_PRIMITIVE_TOPOLOGY_TYPE type);
 
-	ID3D12PipelineState* getPipelineState() { return m_pipelineState.Get(); }
+	// the fallback's state (or nullptr, so the draw can be skipped) until an async create finished.
+	ID3D12PipelineState* getPipelineState();
+	bool isReady() { return m_pipelineState || (m_task && m_task->isReady()); }
 
 private:
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineState;
+	PipelineTaskSp m_task;
+	Pipeline* m_fallback = nullptr;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_layout;
-	D3D12_RASTERIZER_DESC m_rasterDesc;
-	D3D12_COMPARISON_FUNC m_depthFunc;
-	bool m_depthEnable;
-	bool m_stencilEnable;
-	D3D12_DEPTH_STENCILOP_DESC m_frontFace;
-	D3D12_DEPTH_STENCILOP_DESC m_backFace;
+	D3D12_RASTERIZER_DESC m_rasterDesc{};
+	D3D12_COMPARISON_FUNC m_depthFunc = D3D12_COMPARISON_FUNC_LESS;
+	bool m_depthEnable = false;
+	bool m_stencilEnable = false;
+	D3D12_DEPTH_STENCILOP_DESC m_frontFace{};
+	D3D12_DEPTH_STENCILOP_DESC m_backFace{};
 	std::vector<DXGI_FORMAT> m_rtvFormat;
-	DXGI_FORMAT m_depthStencilFormat;
+	DXGI_FORMAT m_depthStencilFormat = DXGI_FORMAT_UNKNOWN;
 	BlendState m_blendState = BlendState::eNone;
 	IDxcBlob* m_vertexShader = nullptr;
 	IDxcBlob* m_geometoryShader = nullptr;
 	IDxcBlob* m_pixelShader = nullptr;
 	D3D12_PRIMITIVE_TOPOLOGY_TYPE m_primitiveType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	UINT8 m_readMask;
-	UINT8 m_writeMask;
+	UINT8 m_readMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+	UINT8 m_writeMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
 };
 
 
@@ -65,14 +77,20 @@ public:
 	~ComputePipeline() = default;
 
 	bool create(ID3D12Device* device, ID3D12RootSignature* rootSignature);
+	bool createAsync(PipelineCompiler* compiler, ID3D12Device* device, ID3D12RootSignature* rootSignature);
+
+	void setFallback(ComputePipeline* fallback) { m_fallback = fallback; }
 
 	void setComputeShader(IDxcBlob* blob);
 
-	ID3D12PipelineState* getPipelineState() { return m_pipelineState.Get(); }
+	ID3D12PipelineState* getPipelineState();
+	bool isReady() { return m_pipelineState || (m_task && m_task->isReady()); }
 
 private:
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineState;
-	IDxcBlob* m_computeShader;
+	PipelineTaskSp m_task;
+	ComputePipeline* m_fallback = nullptr;
+	IDxcBlob* m_computeShader = nullptr;
 };
 
 
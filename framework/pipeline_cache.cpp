@@ -0,0 +1,205 @@
+#include "pipeline_cache.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+// {6C1F3A52-8E4D-4B7A-9F21-3D5E7A10C48B}
+const GUID kRootSignatureHashGuid = { 0x6c1f3a52, 0x8e4d, 0x4b7a, { 0x9f, 0x21, 0x3d, 0x5e, 0x7a, 0x10, 0xc4, 0x8b } };
+
+
+namespace {
+
+std::wstring getPipelineName(uint64_t key) {
+	std::string name = hashToString(key);
+	return std::wstring(name.begin(), name.end());
+}
+
+bool readFile(const std::filesystem::path& filename, std::vector<uint8_t>& data) {
+	std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+	if (!ifs)
+		return false;
+
+	std::streamoff size = ifs.tellg();
+	if (size <= 0)
+		return false;
+
+	data.resize((size_t)size);
+	ifs.seekg(0);
+	return (bool)ifs.read((char*)data.data(), size);
+}
+
+}
+
+
+bool PipelineCache::open(ID3D12Device* device, const std::filesystem::path& filename) {
+	std::lock_guard<std::mutex> lock(m_libraryMutex);
+
+	m_filename = filename;
+	m_library.Reset();
+	m_libraryData.clear();
+	m_isDirty = false;
+
+	Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(device1.GetAddressOf()))))
+		return false;
+
+	HRESULT res = E_FAIL;
+	if (readFile(filename, m_libraryData)) {
+		res = device1->CreatePipelineLibrary(m_libraryData.data(), m_libraryData.size(), IID_PPV_ARGS(m_library.ReleaseAndGetAddressOf()));
+		if (FAILED(res)) {
+			// D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND or a damaged file.
+			OutputDebugString("pipeline cache: the saved pipeline library was discarded.\n");
+			m_libraryData.clear();
+		}
+	}
+
+	if (FAILED(res)) {
+		// DXGI_ERROR_UNSUPPORTED leaves the in-process deduplication only.
+		res = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(m_library.ReleaseAndGetAddressOf()));
+		if (FAILED(res))
+			return false;
+	}
+
+	return true;
+}
+
+bool PipelineCache::save() {
+	std::lock_guard<std::mutex> lock(m_libraryMutex);
+
+	if (!m_library || !m_isDirty)
+		return true;
+
+	std::vector<uint8_t> data(m_library->GetSerializedSize());
+	if (FAILED(m_library->Serialize(data.data(), data.size())))
+		return false;
+
+	std::error_code ec;
+	if (m_filename.has_parent_path())
+		std::filesystem::create_directories(m_filename.parent_path(), ec);
+
+	std::filesystem::path tempPath = m_filename;
+	tempPath += ".tmp";
+	{
+		std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+		if (!ofs || !ofs.write((const char*)data.data(), data.size())) {
+			ofs.close();
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, m_filename, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	m_isDirty = false;
+	return true;
+}
+
+HRESULT PipelineCache::createGraphicsPipeline(ID3D12Device* device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t key, ID3D12PipelineState** pipelineState) {
+	return createPipeline(key, pipelineState,
+		[&desc](ID3D12PipelineLibrary* library, const wchar_t* name, ID3D12PipelineState** pipelineState) {
+			return library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(pipelineState));
+		},
+		[device, &desc](ID3D12PipelineState** pipelineState) {
+			return device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipelineState));
+		});
+}
+
+HRESULT PipelineCache::createComputePipeline(ID3D12Device* device, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t key, ID3D12PipelineState** pipelineState) {
+	return createPipeline(key, pipelineState,
+		[&desc](ID3D12PipelineLibrary* library, const wchar_t* name, ID3D12PipelineState** pipelineState) {
+			return library->LoadComputePipeline(name, &desc, IID_PPV_ARGS(pipelineState));
+		},
+		[device, &desc](ID3D12PipelineState** pipelineState) {
+			return device->CreateComputePipelineState(&desc, IID_PPV_ARGS(pipelineState));
+		});
+}
+
+template<class Load, class Create>
+HRESULT PipelineCache::createPipeline(uint64_t key, ID3D12PipelineState** pipelineState, Load load, Create create) {
+	if (key == 0)
+		return create(pipelineState);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto ite = m_pipelines.find(key);
+		if (ite != m_pipelines.end()) {
+			m_memoryHitCount++;
+			return ite->second.CopyTo(pipelineState);
+		}
+	}
+
+	std::wstring name = getPipelineName(key);
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline;
+	bool isLoaded = false;
+	{
+		std::lock_guard<std::mutex> lock(m_libraryMutex);
+		if (m_library)
+			isLoaded = SUCCEEDED(load(m_library.Get(), name.c_str(), pipeline.ReleaseAndGetAddressOf()));
+	}
+
+	// compiled outside the locks so other threads keep creating pipelines meanwhile.
+	if (isLoaded) {
+		m_libraryHitCount++;
+	}
+	else {
+		HRESULT res = create(pipeline.ReleaseAndGetAddressOf());
+		if (FAILED(res))
+			return res;
+		m_missCount++;
+
+		std::lock_guard<std::mutex> lock(m_libraryMutex);
+		if (m_library && SUCCEEDED(m_library->StorePipeline(name.c_str(), pipeline.Get())))
+			m_isDirty = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// a thread that raced on the same key may have inserted first, everyone shares that one.
+		auto& cached = m_pipelines[key];
+		if (!cached)
+			cached = pipeline;
+		return cached.CopyTo(pipelineState);
+	}
+}
+
+void PipelineCache::release(ID3D12PipelineState* pipelineState) {
+	if (pipelineState == nullptr)
+		return;
+
+	// the lookups that hand out references run under the same lock, so the count can only drop meanwhile.
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto ite = std::find_if(m_pipelines.begin(), m_pipelines.end(),
+		[pipelineState](const auto& cached) { return cached.second.Get() == pipelineState; });
+	pipelineState->Release();
+	if (ite == m_pipelines.end())
+		return;
+
+	ite->second->AddRef();
+	if (ite->second->Release() == 1)
+		m_pipelines.erase(ite);
+}
+
+size_t PipelineCache::getPipelineCount() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pipelines.size();
+}
+
+uint64_t PipelineCache::getRootSignatureHash(ID3D12RootSignature* rootSignature) {
+	if (rootSignature == nullptr)
+		return 0;
+
+	uint64_t hash = 0;
+	UINT size = sizeof(hash);
+	if (FAILED(rootSignature->GetPrivateData(kRootSignatureHashGuid, &size, &hash)) || size != sizeof(hash))
+		return 0;
+
+	return hash;
+}
\ No newline at end of file
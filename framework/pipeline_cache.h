@@ -0,0 +1,77 @@
+#ifndef _PIPELINE_CACHE_H_
+#define _PIPELINE_CACHE_H_
+
+#include <d3d12.h>
+
+#include <wrl/client.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// identifies the private data RootSignature attaches to its root signature: the hash of the serialized blob.
+extern const GUID kRootSignatureHashGuid;
+
+// deduplicates pipeline states created in this process by their pipeline key hash and keeps the driver compiled
+// pipelines in an ID3D12PipelineLibrary that is saved to disk, so later runs skip the driver compile.
+class PipelineCache {
+private:
+	PipelineCache() :
+		m_filename("pipeline_cache.bin"),
+		m_isDirty(false),
+		m_memoryHitCount(0),
+		m_libraryHitCount(0),
+		m_missCount(0)
+	{}
+	~PipelineCache() = default;
+
+public:
+	static PipelineCache& Instance() {
+		static PipelineCache instance;
+		return instance;
+	}
+
+	// loads the library written by save. a library from another driver or adapter is discarded and rebuilt.
+	bool open(ID3D12Device* device, const std::filesystem::path& filename);
+	bool save();
+
+	// key is the hashPipelineKey of the description. 0 bypasses the cache.
+	HRESULT createGraphicsPipeline(ID3D12Device* device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t key, ID3D12PipelineState** pipelineState);
+	HRESULT createComputePipeline(ID3D12Device* device, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t key, ID3D12PipelineState** pipelineState);
+
+	// gives up a reference the caller held on a pipeline state it replaced. the cache drops its own reference once
+	// no other pipeline shares the state, so pipelines retired by a hot reload do not stay alive in the cache.
+	void release(ID3D12PipelineState* pipelineState);
+
+	// 0 when the root signature was not created through RootSignature.
+	static uint64_t getRootSignatureHash(ID3D12RootSignature* rootSignature);
+
+	size_t getPipelineCount();
+	uint32_t getMemoryHitCount() { return m_memoryHitCount; }
+	uint32_t getLibraryHitCount() { return m_libraryHitCount; }
+	uint32_t getMissCount() { return m_missCount; }
+
+private:
+	// load reads the pipeline from the library, create compiles it with the driver.
+	template<class Load, class Create>
+	HRESULT createPipeline(uint64_t key, ID3D12PipelineState** pipelineState, Load load, Create create);
+
+	std::mutex m_mutex;
+	std::unordered_map<uint64_t, Microsoft::WRL::ComPtr<ID3D12PipelineState>> m_pipelines;
+
+	// the library reads from m_libraryData for its whole lifetime.
+	std::mutex m_libraryMutex;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> m_library;
+	std::vector<uint8_t> m_libraryData;
+	std::filesystem::path m_filename;
+	bool m_isDirty;
+
+	std::atomic<uint32_t> m_memoryHitCount;
+	std::atomic<uint32_t> m_libraryHitCount;
+	std::atomic<uint32_t> m_missCount;
+};
+
+#endif
\ No newline at end of file
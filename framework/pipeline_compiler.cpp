@@ -0,0 +1,102 @@
+#include "pipeline_compiler.h"
+
+#include <algorithm>
+
+
+void PipelineTask::wait() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this]() { return getStatus() != PipelineStatus::ePending; });
+}
+
+
+bool PipelineCompiler::create(unsigned int threadCount) {
+	destroy();
+
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	m_isRunning = true;
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_threads.emplace_back([this]() { threadMain(); });
+
+	return true;
+}
+
+void PipelineCompiler::destroy() {
+	std::deque<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isRunning = false;
+		jobs.swap(m_jobs);
+	}
+	m_condition.notify_all();
+
+	for (auto& ite : m_threads)
+		ite.join();
+	m_threads.clear();
+
+	for (auto& ite : jobs)
+		finish(ite.task.get(), PipelineStatus::eFailed);
+	m_idleCondition.notify_all();
+}
+
+PipelineTaskSp PipelineCompiler::submit(CompileFunction compile) {
+	PipelineTaskSp task = std::make_shared<PipelineTask>();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_isRunning) {
+			finish(task.get(), PipelineStatus::eFailed);
+			return task;
+		}
+		m_jobs.push_back({ task, compile });
+	}
+	m_condition.notify_one();
+
+	return task;
+}
+
+size_t PipelineCompiler::getPendingCount() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_jobs.size() + m_runningCount;
+}
+
+void PipelineCompiler::waitIdle() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idleCondition.wait(lock, [this]() { return m_jobs.empty() && m_runningCount == 0; });
+}
+
+void PipelineCompiler::threadMain() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return !m_isRunning || !m_jobs.empty(); });
+			if (!m_isRunning)
+				return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			m_runningCount++;
+		}
+
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+		bool result = job.compile(pipelineState) && pipelineState;
+
+		job.task->m_pipelineState = pipelineState;
+		finish(job.task.get(), result ? PipelineStatus::eReady : PipelineStatus::eFailed);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_runningCount--;
+		}
+		m_idleCondition.notify_all();
+	}
+}
+
+void PipelineCompiler::finish(PipelineTask* task, PipelineStatus status) {
+	{
+		std::lock_guard<std::mutex> lock(task->m_mutex);
+		task->m_status.store(status, std::memory_order_release);
+	}
+	task->m_condition.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef _PIPELINE_COMPILER_H_
+#define _PIPELINE_COMPILER_H_
+
+#include <d3d12.h>
+
+#include <wrl/client.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class PipelineStatus {
+	ePending,
+	eReady,
+	eFailed,
+};
+
+// result of a pipeline compiled by PipelineCompiler. the pipeline state is only readable once the status is eReady.
+class PipelineTask {
+public:
+	PipelineTask() :
+		m_status(PipelineStatus::ePending)
+	{}
+	~PipelineTask() = default;
+
+	PipelineStatus getStatus() { return m_status.load(std::memory_order_acquire); }
+	bool isReady() { return getStatus() == PipelineStatus::eReady; }
+
+	// nullptr until ready.
+	ID3D12PipelineState* getPipelineState() { return isReady() ? m_pipelineState.Get() : nullptr; }
+
+	// blocks until the task finished. for loading screens and shutdown, never for a frame.
+	void wait();
+
+private:
+	friend class PipelineCompiler;
+
+	std::atomic<PipelineStatus> m_status;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineState;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+};
+
+using PipelineTaskSp = std::shared_ptr<PipelineTask>;
+
+// creates pipeline states on worker threads so startup and newly requested variants do not block a frame.
+class PipelineCompiler {
+public:
+	// fills pipelineState and returns true on success. runs on a worker thread.
+	using CompileFunction = std::function<bool(Microsoft::WRL::ComPtr<ID3D12PipelineState>& pipelineState)>;
+
+	PipelineCompiler() = default;
+	~PipelineCompiler() { destroy(); }
+
+	PipelineCompiler(const PipelineCompiler&) = delete;
+	PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+	// 0 threads picks the hardware concurrency minus the render thread.
+	bool create(unsigned int threadCount = 0);
+	// tasks still queued are marked failed, running ones are finished.
+	void destroy();
+
+	PipelineTaskSp submit(CompileFunction compile);
+
+	size_t getPendingCount();
+	void waitIdle();
+
+private:
+	struct Job {
+		PipelineTaskSp task;
+		CompileFunction compile;
+	};
+
+	void threadMain();
+	static void finish(PipelineTask* task, PipelineStatus status);
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::condition_variable m_idleCondition;
+	std::deque<Job> m_jobs;
+	size_t m_runningCount = 0;
+	bool m_isRunning = false;
+	std::vector<std::thread> m_threads;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "pipeline_key.h"
+
+#include "hash.h"
+
+#include <cctype>
+
+
+namespace {
+
+// values of the d3d12 enums the normalization depends on.
+const uint32_t kFormatUnknown = 0;				// DXGI_FORMAT_UNKNOWN
+const uint32_t kInputPerVertexData = 0;			// D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA
+const uint32_t kPrimitiveTopologyTypeTriangle = 3;	// D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE
+const uint32_t kMaxRenderTargetCount = 8;		// D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT
+
+uint64_t hashFloat(float value, uint64_t hash) {
+	// -0.0 and 0.0 behave the same.
+	if (value == 0.0f) value = 0.0f;
+	return hashValue(value, hash);
+}
+
+uint64_t hashBlend(const RenderTargetBlendKey& blend, uint64_t hash) {
+	hash = hashValue(blend.blendEnable, hash);
+	hash = hashValue(blend.logicOpEnable, hash);
+	hash = hashValue(blend.srcBlend, hash);
+	hash = hashValue(blend.destBlend, hash);
+	hash = hashValue(blend.blendOp, hash);
+	hash = hashValue(blend.srcBlendAlpha, hash);
+	hash = hashValue(blend.destBlendAlpha, hash);
+	hash = hashValue(blend.blendOpAlpha, hash);
+	hash = hashValue(blend.logicOp, hash);
+	return hashValue(blend.renderTargetWriteMask, hash);
+}
+
+uint64_t hashStencilFace(const StencilFaceKey& face, uint64_t hash) {
+	hash = hashValue(face.stencilFailOp, hash);
+	hash = hashValue(face.stencilDepthFailOp, hash);
+	hash = hashValue(face.stencilPassOp, hash);
+	return hashValue(face.stencilFunc, hash);
+}
+
+}
+
+
+void normalizePipelineKey(GraphicsPipelineKey& key) {
+	// semantics are case insensitive.
+	for (auto& ite : key.inputLayout) {
+		for (auto& c : ite.semanticName)
+			c = (char)toupper((unsigned char)c);
+		if (ite.inputSlotClass == kInputPerVertexData)
+			ite.instanceDataStepRate = 0;
+	}
+
+	while (!key.renderTargetFormats.empty() && key.renderTargetFormats.back() == kFormatUnknown)
+		key.renderTargetFormats.pop_back();
+	if (key.renderTargetFormats.size() > kMaxRenderTargetCount)
+		key.renderTargetFormats.resize(kMaxRenderTargetCount);
+
+	// only the first target is read without independent blend, and nothing is read without targets.
+	size_t blendCount = key.independentBlendEnable ? key.renderTargetFormats.size() : (key.renderTargetFormats.empty() ? 0 : 1);
+	key.blend.resize(blendCount);
+	if (blendCount <= 1)
+		key.independentBlendEnable = 0;
+	for (auto& ite : key.blend) {
+		if (!ite.blendEnable) {
+			ite.srcBlend = ite.destBlend = ite.blendOp = 0;
+			ite.srcBlendAlpha = ite.destBlendAlpha = ite.blendOpAlpha = 0;
+		}
+		if (!ite.logicOpEnable)
+			ite.logicOp = 0;
+	}
+	if (key.renderTargetFormats.empty())
+		key.alphaToCoverageEnable = 0;
+
+	if (!key.depthEnable) {
+		key.depthWriteMask = 0;
+		key.depthFunc = 0;
+	}
+	if (!key.stencilEnable) {
+		key.stencilReadMask = 0;
+		key.stencilWriteMask = 0;
+		key.frontFace = StencilFaceKey();
+		key.backFace = StencilFaceKey();
+	}
+
+	// antialiased lines only apply when lines are drawn.
+	if (key.primitiveTopologyType == kPrimitiveTopologyTypeTriangle)
+		key.antialiasedLineEnable = 0;
+
+	if (key.sampleCount == 0)
+		key.sampleCount = 1;
+}
+
+uint64_t hashPipelineKey(const GraphicsPipelineKey& desc) {
+	GraphicsPipelineKey key = desc;
+	normalizePipelineKey(key);
+
+	uint64_t hash = hashValue(key.rootSignature);
+	hash = hashValue(key.vertexShader, hash);
+	hash = hashValue(key.geometoryShader, hash);
+	hash = hashValue(key.pixelShader, hash);
+
+	hash = hashValue(key.inputLayout.size(), hash);
+	for (auto& ite : key.inputLayout) {
+		hash = hashString(ite.semanticName, hash);
+		hash = hashValue(ite.semanticIndex, hash);
+		hash = hashValue(ite.format, hash);
+		hash = hashValue(ite.inputSlot, hash);
+		hash = hashValue(ite.alignedByteOffset, hash);
+		hash = hashValue(ite.inputSlotClass, hash);
+		hash = hashValue(ite.instanceDataStepRate, hash);
+	}
+
+	hash = hashValue(key.fillMode, hash);
+	hash = hashValue(key.cullMode, hash);
+	hash = hashValue(key.frontCounterClockwise, hash);
+	hash = hashValue(key.depthBias, hash);
+	hash = hashFloat(key.depthBiasClamp, hash);
+	hash = hashFloat(key.slopeScaledDepthBias, hash);
+	hash = hashValue(key.depthClipEnable, hash);
+	hash = hashValue(key.multisampleEnable, hash);
+	hash = hashValue(key.antialiasedLineEnable, hash);
+	hash = hashValue(key.forcedSampleCount, hash);
+	hash = hashValue(key.conservativeRaster, hash);
+
+	hash = hashValue(key.alphaToCoverageEnable, hash);
+	hash = hashValue(key.independentBlendEnable, hash);
+	hash = hashValue(key.blend.size(), hash);
+	for (auto& ite : key.blend)
+		hash = hashBlend(ite, hash);
+
+	hash = hashValue(key.depthEnable, hash);
+	hash = hashValue(key.depthWriteMask, hash);
+	hash = hashValue(key.depthFunc, hash);
+	hash = hashValue(key.stencilEnable, hash);
+	hash = hashValue(key.stencilReadMask, hash);
+	hash = hashValue(key.stencilWriteMask, hash);
+	hash = hashStencilFace(key.frontFace, hash);
+	hash = hashStencilFace(key.backFace, hash);
+
+	hash = hashValue(key.renderTargetFormats.size(), hash);
+	for (auto& ite : key.renderTargetFormats)
+		hash = hashValue(ite, hash);
+	hash = hashValue(key.depthStencilFormat, hash);
+	hash = hashValue(key.primitiveTopologyType, hash);
+	hash = hashValue(key.sampleMask, hash);
+	hash = hashValue(key.sampleCount, hash);
+	hash = hashValue(key.sampleQuality, hash);
+
+	return hash == 0 ? 1 : hash;
+}
+
+uint64_t hashPipelineKey(const ComputePipelineKey& key) {
+	// tagged so a compute key never equals a graphics key built from the same values.
+	uint64_t hash = hashString(std::string("compute"));
+	hash = hashValue(key.rootSignature, hash);
+	hash = hashValue(key.computeShader, hash);
+	return hash == 0 ? 1 : hash;
+}
\ No newline at end of file
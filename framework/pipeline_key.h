@@ -0,0 +1,95 @@
+#ifndef _PIPELINE_KEY_H_
+#define _PIPELINE_KEY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// pipeline descriptions with the d3d12 enums stored as their integer values, so they can be normalized and hashed
+// without the d3d12 headers. shaders and the root signature are referenced by the hash of their bytecode.
+
+struct InputElementKey {
+	std::string semanticName;
+	uint32_t semanticIndex = 0;
+	uint32_t format = 0;
+	uint32_t inputSlot = 0;
+	uint32_t alignedByteOffset = 0;
+	uint32_t inputSlotClass = 0;
+	uint32_t instanceDataStepRate = 0;
+};
+
+struct RenderTargetBlendKey {
+	uint32_t blendEnable = 0;
+	uint32_t logicOpEnable = 0;
+	uint32_t srcBlend = 0;
+	uint32_t destBlend = 0;
+	uint32_t blendOp = 0;
+	uint32_t srcBlendAlpha = 0;
+	uint32_t destBlendAlpha = 0;
+	uint32_t blendOpAlpha = 0;
+	uint32_t logicOp = 0;
+	uint32_t renderTargetWriteMask = 0;
+};
+
+struct StencilFaceKey {
+	uint32_t stencilFailOp = 0;
+	uint32_t stencilDepthFailOp = 0;
+	uint32_t stencilPassOp = 0;
+	uint32_t stencilFunc = 0;
+};
+
+struct GraphicsPipelineKey {
+	uint64_t rootSignature = 0;
+	uint64_t vertexShader = 0;
+	uint64_t geometoryShader = 0;
+	uint64_t pixelShader = 0;
+
+	std::vector<InputElementKey> inputLayout;
+
+	uint32_t fillMode = 0;
+	uint32_t cullMode = 0;
+	uint32_t frontCounterClockwise = 0;
+	int32_t depthBias = 0;
+	float depthBiasClamp = 0.0f;
+	float slopeScaledDepthBias = 0.0f;
+	uint32_t depthClipEnable = 0;
+	uint32_t multisampleEnable = 0;
+	uint32_t antialiasedLineEnable = 0;
+	uint32_t forcedSampleCount = 0;
+	uint32_t conservativeRaster = 0;
+
+	uint32_t alphaToCoverageEnable = 0;
+	uint32_t independentBlendEnable = 0;
+	std::vector<RenderTargetBlendKey> blend;
+
+	uint32_t depthEnable = 0;
+	uint32_t depthWriteMask = 0;
+	uint32_t depthFunc = 0;
+	uint32_t stencilEnable = 0;
+	uint32_t stencilReadMask = 0;
+	uint32_t stencilWriteMask = 0;
+	StencilFaceKey frontFace;
+	StencilFaceKey backFace;
+
+	std::vector<uint32_t> renderTargetFormats;
+	uint32_t depthStencilFormat = 0;
+	uint32_t primitiveTopologyType = 0;
+	uint32_t sampleMask = 0;
+	uint32_t sampleCount = 0;
+	uint32_t sampleQuality = 0;
+};
+
+struct ComputePipelineKey {
+	uint64_t rootSignature = 0;
+	uint64_t computeShader = 0;
+};
+
+// clears the fields the runtime ignores (depth state with depth disabled, stencil state with stencil disabled, blend
+// factors of targets that do not blend, ...) so two descriptions that build the same pipeline become identical.
+void normalizePipelineKey(GraphicsPipelineKey& key);
+
+// hashes a normalized copy. 0 is never returned.
+uint64_t hashPipelineKey(const GraphicsPipelineKey& key);
+uint64_t hashPipelineKey(const ComputePipelineKey& key);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,658 @@
+#include "render_capture.h"
+
+#include "hash.h"
+
+#include <cstring>
+#include <fstream>
+
+
+namespace {
+
+// "RCAP"
+const uint32_t kCaptureMagic = 0x50414352;
+const uint32_t kCaptureVersion = 1;
+const size_t kChunkHeaderSize = 8;
+
+}
+
+
+const char* getCaptureChunkName(CaptureChunkType type) {
+	switch (type) {
+	case CaptureChunkType::eCreateBuffer: return "createBuffer";
+	case CaptureChunkType::eCreateTexture: return "createTexture";
+	case CaptureChunkType::eCreateTimestampQueries: return "createTimestampQueries";
+	case CaptureChunkType::eCreateFence: return "createFence";
+	case CaptureChunkType::eCreatePipeline: return "createPipeline";
+	case CaptureChunkType::eCreateCommandSignature: return "createCommandSignature";
+	case CaptureChunkType::eCreateView: return "createView";
+	case CaptureChunkType::eDestroy: return "destroy";
+	case CaptureChunkType::ePayload: return "payload";
+	case CaptureChunkType::eWriteBuffer: return "writeBuffer";
+	case CaptureChunkType::eSubmit: return "submit";
+	case CaptureChunkType::eSignal: return "signal";
+	case CaptureChunkType::eWait: return "wait";
+	case CaptureChunkType::eFrame: return "frame";
+	default: return "unknown";
+	}
+}
+
+
+void CaptureWriter::beginChunk(CaptureChunkType type) {
+	m_chunkOffset = m_data.size();
+	write((uint16_t)type);
+	write((uint16_t)0);
+	write((uint32_t)0);
+}
+
+void CaptureWriter::endChunk() {
+	uint32_t size = (uint32_t)(m_data.size() - m_chunkOffset - kChunkHeaderSize);
+	memcpy(m_data.data() + m_chunkOffset + 4, &size, sizeof(size));
+}
+
+void CaptureWriter::write(const void* data, size_t size) {
+	if (size == 0)
+		return;
+
+	size_t offset = m_data.size();
+	m_data.resize(offset + size);
+	memcpy(m_data.data() + offset, data, size);
+}
+
+void CaptureWriter::writeString(const std::string& str) {
+	write((uint32_t)str.size());
+	write(str.data(), str.size());
+}
+
+
+bool CaptureReader::read(void* data, size_t size) {
+	const uint8_t* ptr = skip(size);
+	if (ptr == nullptr)
+		return false;
+
+	memcpy(data, ptr, size);
+	return true;
+}
+
+bool CaptureReader::readString(std::string& str) {
+	uint32_t size = 0;
+	if (!read(size))
+		return false;
+
+	const uint8_t* ptr = skip(size);
+	if (ptr == nullptr)
+		return false;
+
+	str.assign((const char*)ptr, size);
+	return true;
+}
+
+const uint8_t* CaptureReader::skip(size_t size) {
+	if (size > m_size - m_offset)
+		return nullptr;
+
+	const uint8_t* ptr = m_data + m_offset;
+	m_offset += size;
+	return ptr;
+}
+
+
+bool CaptureFile::save(const std::filesystem::path& filename) const {
+	std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+	if (!ofs)
+		return false;
+
+	uint32_t header[] = { kCaptureMagic, kCaptureVersion, m_frameCount };
+	ofs.write((const char*)header, sizeof(header));
+	ofs.write((const char*)m_chunks.data(), m_chunks.size());
+	return (bool)ofs;
+}
+
+bool CaptureFile::load(const std::filesystem::path& filename) {
+	m_chunks.clear();
+	m_frameCount = 0;
+
+	std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+	if (!ifs)
+		return false;
+
+	std::streamoff size = ifs.tellg();
+	uint32_t header[3];
+	if (size < (std::streamoff)sizeof(header))
+		return false;
+
+	ifs.seekg(0);
+	ifs.read((char*)header, sizeof(header));
+	if (header[0] != kCaptureMagic || header[1] != kCaptureVersion) {
+		logRenderError("render capture: " + filename.string() + " is not a capture of this version.\n");
+		return false;
+	}
+
+	m_chunks.resize((size_t)size - sizeof(header));
+	if (!ifs.read((char*)m_chunks.data(), m_chunks.size()))
+		return false;
+
+	size_t offset = 0;
+	CaptureChunk chunk;
+	while (nextChunk(offset, chunk)) {}
+	if (offset != m_chunks.size()) {
+		logRenderError("render capture: " + filename.string() + " is truncated.\n");
+		m_chunks.clear();
+		return false;
+	}
+
+	m_frameCount = header[2];
+	return true;
+}
+
+bool CaptureFile::nextChunk(size_t& offset, CaptureChunk& chunk) const {
+	if (m_chunks.size() - offset < kChunkHeaderSize)
+		return false;
+
+	uint16_t type = 0;
+	uint32_t size = 0;
+	memcpy(&type, m_chunks.data() + offset, sizeof(type));
+	memcpy(&size, m_chunks.data() + offset + 4, sizeof(size));
+	if (type >= (uint16_t)CaptureChunkType::eCount || size > m_chunks.size() - offset - kChunkHeaderSize)
+		return false;
+
+	chunk.type = (CaptureChunkType)type;
+	chunk.data = m_chunks.data() + offset + kChunkHeaderSize;
+	chunk.size = size;
+	offset += kChunkHeaderSize + size;
+	return true;
+}
+
+bool CaptureFile::readLists(const CaptureChunk& chunk, std::vector<CommandStream>& lists) {
+	CaptureReader reader(chunk.data, chunk.size);
+	uint32_t listCount = 0;
+	// every list takes at least its two counts, so a larger count is a damaged chunk and not worth allocating.
+	if (!reader.read(listCount) || listCount > chunk.size / 8)
+		return false;
+
+	lists.resize(listCount);
+	for (CommandStream& stream : lists) {
+		stream.clear();
+
+		uint32_t commandCount = 0;
+		uint32_t payloadSize = 0;
+		if (!reader.read(commandCount) || !reader.read(payloadSize))
+			return false;
+
+		// the commands are written without their payload offsets, the payloads follow in the same order.
+		const size_t commandSize = 1 + sizeof(uint32_t) * 7;
+		const uint8_t* commands = reader.skip(commandSize * commandCount);
+		const uint8_t* payload = reader.skip(payloadSize);
+		if (commands == nullptr || payload == nullptr)
+			return false;
+
+		uint32_t payloadOffset = 0;
+		for (uint32_t i = 0; i < commandCount; i++) {
+			const uint8_t* ptr = commands + commandSize * i;
+			RenderCommand command{};
+			command.type = (RenderCommandType)ptr[0];
+			memcpy(command.args, ptr + 1, sizeof(command.args));
+			memcpy(&command.payloadSize, ptr + 1 + sizeof(command.args), sizeof(uint32_t));
+			if (command.type >= RenderCommandType::eCount || command.payloadSize > payloadSize - payloadOffset)
+				return false;
+
+			stream.record(command, payload + payloadOffset);
+			payloadOffset += command.payloadSize;
+		}
+	}
+
+	return true;
+}
+
+
+void CaptureCommandList::begin() {
+	m_list->begin();
+	m_isRecording = m_device->isCapturing();
+	if (m_isRecording)
+		m_recorder.begin();
+}
+
+void CaptureCommandList::end() {
+	m_list->end();
+	if (m_isRecording)
+		m_recorder.end();
+}
+
+void CaptureCommandList::barrier(RenderHandle resource, ResourceState before, ResourceState after) {
+	m_list->barrier(resource, before, after);
+	if (m_isRecording)
+		m_recorder.barrier(resource, before, after);
+}
+
+void CaptureCommandList::uavBarrier(RenderHandle resource) {
+	m_list->uavBarrier(resource);
+	if (m_isRecording)
+		m_recorder.uavBarrier(resource);
+}
+
+void CaptureCommandList::setPipeline(RenderHandle pipeline) {
+	m_list->setPipeline(pipeline);
+	if (m_isRecording)
+		m_recorder.setPipeline(pipeline);
+}
+
+void CaptureCommandList::setRootConstants(uint32_t parameter, uint32_t count, const void* values) {
+	m_list->setRootConstants(parameter, count, values);
+	if (m_isRecording)
+		m_recorder.setRootConstants(parameter, count, values);
+}
+
+void CaptureCommandList::setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset) {
+	m_list->setRootBuffer(parameter, type, buffer, offset);
+	if (m_isRecording)
+		m_recorder.setRootBuffer(parameter, type, buffer, offset);
+}
+
+void CaptureCommandList::setRootTable(uint32_t parameter, uint32_t descriptor) {
+	m_list->setRootTable(parameter, descriptor);
+	if (m_isRecording)
+		m_recorder.setRootTable(parameter, descriptor);
+}
+
+void CaptureCommandList::setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) {
+	m_list->setRenderTargets(targets, count, depthStencil);
+	if (m_isRecording)
+		m_recorder.setRenderTargets(targets, count, depthStencil);
+}
+
+void CaptureCommandList::clearRenderTarget(RenderHandle target, const float color[4]) {
+	m_list->clearRenderTarget(target, color);
+	if (m_isRecording)
+		m_recorder.clearRenderTarget(target, color);
+}
+
+void CaptureCommandList::clearDepthStencil(RenderHandle depthStencil, float depth) {
+	m_list->clearDepthStencil(depthStencil, depth);
+	if (m_isRecording)
+		m_recorder.clearDepthStencil(depthStencil, depth);
+}
+
+void CaptureCommandList::setViewport(float x, float y, float width, float height) {
+	m_list->setViewport(x, y, width, height);
+	if (m_isRecording)
+		m_recorder.setViewport(x, y, width, height);
+}
+
+void CaptureCommandList::setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset) {
+	m_list->setVertexBuffer(buffer, stride, offset);
+	if (m_isRecording)
+		m_recorder.setVertexBuffer(buffer, stride, offset);
+}
+
+void CaptureCommandList::setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset) {
+	m_list->setIndexBuffer(buffer, format, offset);
+	if (m_isRecording)
+		m_recorder.setIndexBuffer(buffer, format, offset);
+}
+
+void CaptureCommandList::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+	m_list->draw(vertexCount, instanceCount, firstVertex, firstInstance);
+	if (m_isRecording)
+		m_recorder.draw(vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void CaptureCommandList::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+	m_list->drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+	if (m_isRecording)
+		m_recorder.drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+void CaptureCommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+	m_list->dispatch(x, y, z);
+	if (m_isRecording)
+		m_recorder.dispatch(x, y, z);
+}
+
+void CaptureCommandList::executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+	RenderHandle countBuffer, uint32_t countOffset) {
+	m_list->executeIndirect(signature, maxCount, argumentBuffer, argumentOffset, countBuffer, countOffset);
+	if (m_isRecording)
+		m_recorder.executeIndirect(signature, maxCount, argumentBuffer, argumentOffset, countBuffer, countOffset);
+}
+
+void CaptureCommandList::copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) {
+	m_list->copyBuffer(dest, destOffset, source, sourceOffset, size);
+	if (m_isRecording)
+		m_recorder.copyBuffer(dest, destOffset, source, sourceOffset, size);
+}
+
+void CaptureCommandList::writeTimestamp(RenderHandle queries, uint32_t index) {
+	m_list->writeTimestamp(queries, index);
+	if (m_isRecording)
+		m_recorder.writeTimestamp(queries, index);
+}
+
+void CaptureCommandList::resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) {
+	m_list->resolveTimestamps(queries, first, count, dest, destOffset);
+	if (m_isRecording)
+		m_recorder.resolveTimestamps(queries, first, count, dest, destOffset);
+}
+
+void CaptureCommandList::beginEvent(const char* name) {
+	m_list->beginEvent(name);
+	if (m_isRecording)
+		m_recorder.beginEvent(name);
+}
+
+void CaptureCommandList::endEvent() {
+	m_list->endEvent();
+	if (m_isRecording)
+		m_recorder.endEvent();
+}
+
+
+RenderHandle CaptureDevice::createBuffer(const BufferDesc& desc, const void* data) {
+	RenderHandle handle = m_device->createBuffer(desc, data);
+	if (handle == kInvalidRenderHandle)
+		return handle;
+
+	Object& object = addObject(handle, CaptureChunkType::eCreateBuffer);
+	object.size = desc.size;
+	object.isUpload = desc.memoryType == MemoryType::eUpload;
+	if (data) {
+		object.dataHash = hashBytes(data, (size_t)desc.size);
+		object.contentHash = object.dataHash;
+		if (m_isEmbeddingPayloads && m_payloads.find(object.dataHash) == m_payloads.end())
+			m_payloads[object.dataHash].assign((const uint8_t*)data, (const uint8_t*)data + desc.size);
+	}
+
+	CaptureWriter body;
+	body.write(handle);
+	body.write(desc.size);
+	body.write((uint8_t)desc.memoryType);
+	body.write((uint8_t)desc.isUnorderedAccess);
+	body.write(object.dataHash);
+	body.writeString(desc.name);
+	object.creation = std::move(body.getData());
+
+	if (isCapturing()) {
+		if (data)
+			writePayload(object.dataHash, data, desc.size);
+		writeChunk(object.type, object.creation);
+	}
+
+	return handle;
+}
+
+RenderHandle CaptureDevice::createTexture(const TextureDesc& desc) {
+	RenderHandle handle = m_device->createTexture(desc);
+	if (handle == kInvalidRenderHandle)
+		return handle;
+
+	CaptureWriter body;
+	body.write(handle);
+	body.write(desc.width);
+	body.write(desc.height);
+	body.write(desc.mipLevels);
+	body.write((uint8_t)desc.format);
+	body.write((uint8_t)desc.isRenderTarget);
+	body.write((uint8_t)desc.isDepthStencil);
+	body.write((uint8_t)desc.isUnorderedAccess);
+	body.writeString(desc.name);
+
+	Object& object = addObject(handle, CaptureChunkType::eCreateTexture);
+	object.creation = std::move(body.getData());
+	if (isCapturing())
+		writeChunk(object.type, object.creation);
+
+	return handle;
+}
+
+RenderHandle CaptureDevice::createTimestampQueries(uint32_t count) {
+	RenderHandle handle = m_device->createTimestampQueries(count);
+	if (handle == kInvalidRenderHandle)
+		return handle;
+
+	CaptureWriter body;
+	body.write(handle);
+	body.write(count);
+
+	Object& object = addObject(handle, CaptureChunkType::eCreateTimestampQueries);
+	object.creation = std::move(body.getData());
+	if (isCapturing())
+		writeChunk(object.type, object.creation);
+
+	return handle;
+}
+
+void CaptureDevice::destroy(RenderHandle resource) {
+	m_device->destroy(resource);
+	if (resource >= m_objects.size() || !m_objects[resource].isLive)
+		return;
+
+	m_objects[resource] = Object();
+	if (isCapturing()) {
+		m_writer.beginChunk(CaptureChunkType::eDestroy);
+		m_writer.write(resource);
+		m_writer.endChunk();
+	}
+}
+
+uint32_t CaptureDevice::createView(RenderHandle resource, ViewType type, uint32_t stride) {
+	uint32_t descriptor = m_device->createView(resource, type, stride);
+	if (descriptor == kInvalidRenderHandle)
+		return descriptor;
+
+	CaptureWriter body;
+	body.write(descriptor);
+	body.write(resource);
+	body.write((uint8_t)type);
+	body.write(stride);
+
+	if (descriptor >= m_views.size())
+		m_views.resize(descriptor + 1);
+	m_views[descriptor] = std::move(body.getData());
+	if (isCapturing())
+		writeChunk(CaptureChunkType::eCreateView, m_views[descriptor]);
+
+	return descriptor;
+}
+
+std::unique_ptr<RenderCommandList> CaptureDevice::createCommandList() {
+	std::unique_ptr<RenderCommandList> list = m_device->createCommandList();
+	if (!list)
+		return nullptr;
+
+	return std::unique_ptr<RenderCommandList>(new CaptureCommandList(this, std::move(list)));
+}
+
+void CaptureDevice::submit(RenderCommandList* const* lists, uint32_t count) {
+	std::vector<RenderCommandList*> deviceLists(count);
+	for (uint32_t i = 0; i < count; i++)
+		deviceLists[i] = static_cast<CaptureCommandList*>(lists[i])->getList();
+
+	if (isCapturing()) {
+		writeUploadBuffers(false);
+
+		m_writer.beginChunk(CaptureChunkType::eSubmit);
+		m_writer.write(count);
+		for (uint32_t i = 0; i < count; i++) {
+			const CommandStream* stream = static_cast<CaptureCommandList*>(lists[i])->getStream();
+			if (stream == nullptr) {
+				logRenderError("render capture: a list recorded before the capture started is submitted empty.\n");
+				m_writer.write((uint32_t)0);
+				m_writer.write((uint32_t)0);
+				continue;
+			}
+
+			m_writer.write(stream->getCommandCount());
+			m_writer.write((uint32_t)stream->getPayloadData().size());
+			for (const RenderCommand& command : stream->getCommands()) {
+				m_writer.write((uint8_t)command.type);
+				m_writer.write(command.args, sizeof(command.args));
+				m_writer.write(command.payloadSize);
+			}
+			m_writer.write(stream->getPayloadData().data(), stream->getPayloadData().size());
+		}
+		m_writer.endChunk();
+	}
+
+	m_device->submit(deviceLists.data(), count);
+}
+
+RenderHandle CaptureDevice::createFence() {
+	RenderHandle handle = m_device->createFence();
+	if (handle == kInvalidRenderHandle)
+		return handle;
+
+	CaptureWriter body;
+	body.write(handle);
+
+	Object& object = addObject(handle, CaptureChunkType::eCreateFence);
+	object.creation = std::move(body.getData());
+	if (isCapturing())
+		writeChunk(object.type, object.creation);
+
+	return handle;
+}
+
+void CaptureDevice::signal(RenderHandle fence, uint64_t value) {
+	m_device->signal(fence, value);
+	if (isCapturing()) {
+		m_writer.beginChunk(CaptureChunkType::eSignal);
+		m_writer.write(fence);
+		m_writer.write(value);
+		m_writer.endChunk();
+	}
+}
+
+void CaptureDevice::wait(RenderHandle fence, uint64_t value) {
+	m_device->wait(fence, value);
+	if (isCapturing()) {
+		m_writer.beginChunk(CaptureChunkType::eWait);
+		m_writer.write(fence);
+		m_writer.write(value);
+		m_writer.endChunk();
+	}
+}
+
+void CaptureDevice::registerPipeline(RenderHandle pipeline, const std::string& name, bool isCompute) {
+	CaptureWriter body;
+	body.write(pipeline);
+	body.write((uint8_t)isCompute);
+	body.writeString(name);
+
+	Object& object = addObject(pipeline, CaptureChunkType::eCreatePipeline);
+	object.creation = std::move(body.getData());
+	if (isCapturing())
+		writeChunk(object.type, object.creation);
+}
+
+void CaptureDevice::registerCommandSignature(RenderHandle signature, const std::string& name, uint32_t byteStride) {
+	CaptureWriter body;
+	body.write(signature);
+	body.write(byteStride);
+	body.writeString(name);
+
+	Object& object = addObject(signature, CaptureChunkType::eCreateCommandSignature);
+	object.creation = std::move(body.getData());
+	if (isCapturing())
+		writeChunk(object.type, object.creation);
+}
+
+void CaptureDevice::captureFrames(uint32_t count) {
+	m_writer = CaptureWriter();
+	m_capture = CaptureFile();
+	m_writtenPayloads.clear();
+	m_requestedFrames = count;
+	m_capturedFrames = 0;
+	m_isStarted = false;
+}
+
+void CaptureDevice::endFrame() {
+	if (m_requestedFrames == 0 || isCaptureComplete())
+		return;
+
+	if (!m_isStarted) {
+		startCapture();
+	}
+	else if (++m_capturedFrames == m_requestedFrames) {
+		m_capture.m_chunks = std::move(m_writer.getData());
+		m_capture.m_frameCount = m_capturedFrames;
+		m_writer = CaptureWriter();
+		return;
+	}
+
+	m_writer.beginChunk(CaptureChunkType::eFrame);
+	m_writer.write(m_capturedFrames);
+	m_writer.endChunk();
+}
+
+CaptureDevice::Object& CaptureDevice::addObject(RenderHandle handle, CaptureChunkType type) {
+	if (handle >= m_objects.size())
+		m_objects.resize(handle + 1);
+
+	Object& object = m_objects[handle];
+	object = Object();
+	object.isLive = true;
+	object.type = type;
+	return object;
+}
+
+void CaptureDevice::writeChunk(CaptureChunkType type, const std::vector<uint8_t>& body) {
+	m_writer.beginChunk(type);
+	m_writer.write(body.data(), body.size());
+	m_writer.endChunk();
+}
+
+void CaptureDevice::writePayload(uint64_t hash, const void* data, uint64_t size) {
+	if (!m_isEmbeddingPayloads || data == nullptr || !m_writtenPayloads.insert(hash).second)
+		return;
+
+	m_writer.beginChunk(CaptureChunkType::ePayload);
+	m_writer.write(hash);
+	m_writer.write(size);
+	m_writer.write(data, (size_t)size);
+	m_writer.endChunk();
+}
+
+void CaptureDevice::writeUploadBuffers(bool isAll) {
+	for (size_t i = 0; i < m_objects.size(); i++) {
+		Object& object = m_objects[i];
+		if (!object.isLive || !object.isUpload)
+			continue;
+
+		const void* data = m_device->map((RenderHandle)i);
+		if (data == nullptr)
+			continue;
+
+		uint64_t hash = hashBytes(data, (size_t)object.size);
+		if (!isAll && hash == object.contentHash)
+			continue;
+
+		object.contentHash = hash;
+		writePayload(hash, data, object.size);
+		m_writer.beginChunk(CaptureChunkType::eWriteBuffer);
+		m_writer.write((RenderHandle)i);
+		m_writer.write(hash);
+		m_writer.write(object.size);
+		m_writer.endChunk();
+	}
+}
+
+void CaptureDevice::startCapture() {
+	m_isStarted = true;
+
+	for (const Object& object : m_objects) {
+		if (!object.isLive)
+			continue;
+
+		if (object.dataHash != 0) {
+			auto ite = m_payloads.find(object.dataHash);
+			if (ite != m_payloads.end())
+				writePayload(object.dataHash, ite->second.data(), ite->second.size());
+		}
+		writeChunk(object.type, object.creation);
+	}
+
+	for (const std::vector<uint8_t>& view : m_views) {
+		if (!view.empty())
+			writeChunk(CaptureChunkType::eCreateView, view);
+	}
+
+	writeUploadBuffers(true);
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+#ifndef _RENDER_CAPTURE_H_
+#define _RENDER_CAPTURE_H_
+
+#include "render_device.h"
+#include "null_device.h"
+
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// the records of a capture file, each one a CaptureChunkType, a reserved 16 bit word, the 32 bit size of the body and
+// the body. values are little endian and unpadded, strings are a 32 bit length and the characters.
+enum class CaptureChunkType : uint16_t {
+	eCreateBuffer,				// handle, u64 size, u8 memoryType, u8 isUnorderedAccess, u64 data hash or 0, name
+	eCreateTexture,				// handle, width, height, mipLevels, u8 format, u8 isRenderTarget, u8 isDepthStencil, u8 isUnorderedAccess, name
+	eCreateTimestampQueries,	// handle, count
+	eCreateFence,				// handle
+	eCreatePipeline,			// handle, u8 isCompute, name
+	eCreateCommandSignature,	// handle, byteStride, name
+	eCreateView,				// descriptor, resource, u8 type, stride
+	eDestroy,					// handle
+	ePayload,					// u64 hash, u64 size, the bytes; once per hash and before its first reference
+	eWriteBuffer,				// buffer, u64 hash, u64 size; the new contents of a mapped upload buffer
+	eSubmit,					// list count, per list the command count, payload size, commands and payload
+	eSignal,					// fence, u64 value
+	eWait,						// fence, u64 value
+	eFrame,						// frame index; the chunks up to the first one set up the resources live at the start
+	eCount,
+};
+
+const char* getCaptureChunkName(CaptureChunkType type);
+
+class CaptureWriter {
+public:
+	CaptureWriter() = default;
+	~CaptureWriter() = default;
+
+	void beginChunk(CaptureChunkType type);
+	void endChunk();
+
+	void write(const void* data, size_t size);
+	template<class T>
+	void write(const T& value) { write(&value, sizeof(T)); }
+	void writeString(const std::string& str);
+
+	std::vector<uint8_t>& getData() { return m_data; }
+
+private:
+	std::vector<uint8_t> m_data;
+	size_t m_chunkOffset = 0;
+};
+
+// reads one chunk body, every read fails past its end.
+class CaptureReader {
+public:
+	CaptureReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+	~CaptureReader() = default;
+
+	bool read(void* data, size_t size);
+	template<class T>
+	bool read(T& value) { return read(&value, sizeof(T)); }
+	bool readString(std::string& str);
+	// size bytes in place.
+	const uint8_t* skip(size_t size);
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	size_t m_offset = 0;
+};
+
+struct CaptureChunk {
+	CaptureChunkType type;
+	const uint8_t* data;
+	uint32_t size;
+};
+
+class CaptureFile {
+public:
+	CaptureFile() = default;
+	~CaptureFile() = default;
+
+	bool save(const std::filesystem::path& filename) const;
+	// fails on a file of another version or a truncated chunk.
+	bool load(const std::filesystem::path& filename);
+
+	// walks the chunks, offset starts at 0.
+	bool nextChunk(size_t& offset, CaptureChunk& chunk) const;
+	// the submitted lists of an eSubmit chunk.
+	static bool readLists(const CaptureChunk& chunk, std::vector<CommandStream>& lists);
+
+	uint32_t getFrameCount() const { return m_frameCount; }
+	size_t getSize() const { return m_chunks.size(); }
+
+private:
+	friend class CaptureDevice;
+
+	std::vector<uint8_t> m_chunks;
+	uint32_t m_frameCount = 0;
+};
+
+class CaptureDevice;
+
+// forwards to the list of the captured device and records the calls while a capture runs.
+class CaptureCommandList : public RenderCommandList {
+public:
+	CaptureCommandList(CaptureDevice* device, std::unique_ptr<RenderCommandList> list) : m_device(device), m_list(std::move(list)) {}
+	~CaptureCommandList() = default;
+
+	void begin() override;
+	void end() override;
+
+	void barrier(RenderHandle resource, ResourceState before, ResourceState after) override;
+	void uavBarrier(RenderHandle resource) override;
+
+	void setPipeline(RenderHandle pipeline) override;
+	void setRootConstants(uint32_t parameter, uint32_t count, const void* values) override;
+	void setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset) override;
+	void setRootTable(uint32_t parameter, uint32_t descriptor) override;
+
+	void setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) override;
+	void clearRenderTarget(RenderHandle target, const float color[4]) override;
+	void clearDepthStencil(RenderHandle depthStencil, float depth) override;
+	void setViewport(float x, float y, float width, float height) override;
+	void setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset) override;
+	void setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset) override;
+
+	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) override;
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) override;
+	void dispatch(uint32_t x, uint32_t y, uint32_t z) override;
+	void executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+		RenderHandle countBuffer, uint32_t countOffset) override;
+
+	void copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) override;
+
+	void writeTimestamp(RenderHandle queries, uint32_t index) override;
+	void resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) override;
+
+	void beginEvent(const char* name) override;
+	void endEvent() override;
+
+	RenderCommandList* getList() { return m_list.get(); }
+	// nullptr when the list was begun outside of the capture.
+	const CommandStream* getStream() const { return m_isRecording ? &m_recorder.getStream() : nullptr; }
+
+private:
+	CaptureDevice* m_device;
+	std::unique_ptr<RenderCommandList> m_list;
+	NullCommandList m_recorder;
+	bool m_isRecording = false;
+};
+
+// a RenderDevice in front of another one that writes what it is asked to do into a CaptureFile. the resources live
+// when the capture starts are written first, then every creation, upload, submit and fence operation of the captured
+// frames. buffer data is referenced by hash and stored once; without embedding only the references are kept, which
+// keeps the file small and still replays the same amount of uploads.
+//
+// the device cannot see the gpu writes before the capture or what the cpu writes into mapped upload buffers, so the
+// upload buffers are hashed on every submit of a capture and written again when they changed. pipelines and command
+// signatures come from the backend, register them to have them recreated by the replayer.
+class CaptureDevice : public RenderDevice {
+public:
+	// device has to outlive the capture device.
+	CaptureDevice(RenderDevice* device, bool isEmbeddingPayloads = true) : m_device(device), m_isEmbeddingPayloads(isEmbeddingPayloads) {}
+	~CaptureDevice() = default;
+
+	RenderBackend getBackend() override { return m_device->getBackend(); }
+
+	RenderHandle createBuffer(const BufferDesc& desc, const void* data = nullptr) override;
+	RenderHandle createTexture(const TextureDesc& desc) override;
+	RenderHandle createTimestampQueries(uint32_t count) override;
+	void destroy(RenderHandle resource) override;
+
+	void* map(RenderHandle buffer) override { return m_device->map(buffer); }
+	void unmap(RenderHandle buffer) override { m_device->unmap(buffer); }
+
+	uint32_t createView(RenderHandle resource, ViewType type, uint32_t stride = 0) override;
+
+	std::unique_ptr<RenderCommandList> createCommandList() override;
+	void submit(RenderCommandList* const* lists, uint32_t count) override;
+
+	RenderHandle createFence() override;
+	void signal(RenderHandle fence, uint64_t value) override;
+	uint64_t getCompletedValue(RenderHandle fence) override { return m_device->getCompletedValue(fence); }
+	void wait(RenderHandle fence, uint64_t value) override;
+
+	uint64_t getTimestampFrequency() override { return m_device->getTimestampFrequency(); }
+
+	void registerPipeline(RenderHandle pipeline, const std::string& name, bool isCompute);
+	void registerCommandSignature(RenderHandle signature, const std::string& name, uint32_t byteStride);
+
+	// the capture starts at the next endFrame and stops after count frames.
+	void captureFrames(uint32_t count);
+	// call once per frame after its last submit.
+	void endFrame();
+	bool isCapturing() const { return m_capturedFrames < m_requestedFrames && m_isStarted; }
+	bool isCaptureComplete() const { return m_requestedFrames > 0 && m_capturedFrames == m_requestedFrames; }
+	const CaptureFile& getCapture() const { return m_capture; }
+
+	RenderDevice* getDevice() { return m_device; }
+
+private:
+	struct Object {
+		bool isLive = false;
+		// the body of the creation chunk, written again for the resources live at the start of a capture.
+		CaptureChunkType type = CaptureChunkType::eCount;
+		std::vector<uint8_t> creation;
+		uint64_t dataHash = 0;
+		// mapped upload buffers.
+		uint64_t size = 0;
+		bool isUpload = false;
+		uint64_t contentHash = 0;
+	};
+
+	Object& addObject(RenderHandle handle, CaptureChunkType type);
+	void writeChunk(CaptureChunkType type, const std::vector<uint8_t>& body);
+	void writePayload(uint64_t hash, const void* data, uint64_t size);
+	// contents of the upload buffers that changed since they were last written, or all of them.
+	void writeUploadBuffers(bool isAll);
+	void startCapture();
+
+	RenderDevice* m_device;
+	bool m_isEmbeddingPayloads;
+
+	std::vector<Object> m_objects;
+	std::vector<std::vector<uint8_t>> m_views;
+	// the creation data of every buffer, kept to be embedded into captures started later.
+	std::unordered_map<uint64_t, std::vector<uint8_t>> m_payloads;
+
+	CaptureWriter m_writer;
+	CaptureFile m_capture;
+	std::unordered_set<uint64_t> m_writtenPayloads;
+	uint32_t m_requestedFrames = 0;
+	uint32_t m_capturedFrames = 0;
+	bool m_isStarted = false;
+};
+
+#endif
\ No newline at end of file
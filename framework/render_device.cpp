@@ -0,0 +1,66 @@
+#include "render_device.h"
+
+#include "null_device.h"
+
+#if defined(_WIN32)
+#include "d3d12_device.h"
+#else
+#include <cstdio>
+#endif
+
+
+uint32_t getFormatSize(RenderFormat format) {
+	switch (format) {
+	case RenderFormat::eRgba8Unorm: return 4;
+	case RenderFormat::eRgba16Float: return 8;
+	case RenderFormat::eR32Float: return 4;
+	case RenderFormat::eR32Uint: return 4;
+	case RenderFormat::eRg32Uint: return 8;
+	case RenderFormat::eD32Float: return 4;
+	default: return 0;
+	}
+}
+
+const char* getResourceStateName(ResourceState state) {
+	switch (state) {
+	case ResourceState::eCommon: return "eCommon";
+	case ResourceState::eVertexAndConstantBuffer: return "eVertexAndConstantBuffer";
+	case ResourceState::eIndexBuffer: return "eIndexBuffer";
+	case ResourceState::eShaderResource: return "eShaderResource";
+	case ResourceState::eUnorderedAccess: return "eUnorderedAccess";
+	case ResourceState::eRenderTarget: return "eRenderTarget";
+	case ResourceState::eDepthWrite: return "eDepthWrite";
+	case ResourceState::eIndirectArgument: return "eIndirectArgument";
+	case ResourceState::eCopySource: return "eCopySource";
+	case ResourceState::eCopyDest: return "eCopyDest";
+	case ResourceState::eGenericRead: return "eGenericRead";
+	case ResourceState::ePresent: return "ePresent";
+	default: return "unknown";
+	}
+}
+
+void logRenderError(const std::string& message) {
+#if defined(_WIN32)
+	OutputDebugString(message.c_str());
+#else
+	fputs(message.c_str(), stderr);
+#endif
+}
+
+std::unique_ptr<RenderDevice> createRenderDevice(RenderBackend backend) {
+	switch (backend) {
+	case RenderBackend::eNull:
+		return std::unique_ptr<RenderDevice>(new NullRenderDevice());
+#if defined(_WIN32)
+	case RenderBackend::eD3D12: {
+		std::unique_ptr<D3D12RenderDevice> device(new D3D12RenderDevice());
+		if (!device->create())
+			return nullptr;
+		return std::move(device);
+	}
+#endif
+	default:
+		logRenderError("render device: the backend is not available on this platform.\n");
+		return nullptr;
+	}
+}
\ No newline at end of file
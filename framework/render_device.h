@@ -0,0 +1,178 @@
+#ifndef _RENDER_DEVICE_H_
+#define _RENDER_DEVICE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// backend neutral device and command list. nothing here includes a platform header, so the null backend builds and runs
+// anywhere; the d3d12 backend wraps the framework classes and hands out its native objects for code that is not ported.
+//
+// pipelines and command signatures come from the backend that compiled them (D3D12RenderDevice::addPipeline,
+// NullRenderDevice::createPipeline), the command lists only bind them by handle.
+//
+// d3d12 and null are the only backends. a vulkan one would also need the shaders compiled to spir-v and the root
+// signatures mapped to descriptor set layouts, and nothing here builds or runs it yet.
+
+typedef uint32_t RenderHandle;
+static const RenderHandle kInvalidRenderHandle = 0xffffffff;
+
+enum class RenderBackend {
+	eD3D12,
+	eNull,
+};
+
+enum class MemoryType {
+	eDefault,
+	// cpu written, mapped for the lifetime of the buffer.
+	eUpload,
+	// gpu written, stays in eCopyDest.
+	eReadback,
+};
+
+enum class RenderFormat {
+	eUnknown,
+	eRgba8Unorm,
+	eRgba16Float,
+	eR32Float,
+	eR32Uint,
+	eRg32Uint,
+	eD32Float,
+};
+
+enum class ResourceState {
+	eCommon,
+	eVertexAndConstantBuffer,
+	eIndexBuffer,
+	eShaderResource,
+	eUnorderedAccess,
+	eRenderTarget,
+	eDepthWrite,
+	eIndirectArgument,
+	eCopySource,
+	eCopyDest,
+	eGenericRead,
+	ePresent,
+};
+
+enum class RootBufferType {
+	eConstantBuffer,
+	eShaderResource,
+	eUnorderedAccess,
+};
+
+enum class ViewType {
+	eConstantBuffer,
+	eShaderResource,
+	eUnorderedAccess,
+};
+
+struct BufferDesc {
+	uint64_t size = 0;
+	MemoryType memoryType = MemoryType::eDefault;
+	bool isUnorderedAccess = false;
+	std::string name = "buffer";
+};
+
+struct TextureDesc {
+	uint32_t width = 1;
+	uint32_t height = 1;
+	uint32_t mipLevels = 1;
+	RenderFormat format = RenderFormat::eRgba8Unorm;
+	bool isRenderTarget = false;
+	bool isDepthStencil = false;
+	bool isUnorderedAccess = false;
+	std::string name = "texture";
+};
+
+uint32_t getFormatSize(RenderFormat format);
+const char* getResourceStateName(ResourceState state);
+// OutputDebugString on windows, stderr elsewhere.
+void logRenderError(const std::string& message);
+
+class RenderCommandList {
+public:
+	RenderCommandList() = default;
+	virtual ~RenderCommandList() = default;
+
+	// begin resets the list, its previous submission must have completed.
+	virtual void begin() = 0;
+	virtual void end() = 0;
+
+	virtual void barrier(RenderHandle resource, ResourceState before, ResourceState after) = 0;
+	virtual void uavBarrier(RenderHandle resource) = 0;
+
+	// also binds the root signature of the pipeline, the root bindings below go to its graphics or compute slots.
+	virtual void setPipeline(RenderHandle pipeline) = 0;
+	virtual void setRootConstants(uint32_t parameter, uint32_t count, const void* values) = 0;
+	virtual void setRootBuffer(uint32_t parameter, RootBufferType type, RenderHandle buffer, uint32_t offset = 0) = 0;
+	// descriptor from RenderDevice::createView.
+	virtual void setRootTable(uint32_t parameter, uint32_t descriptor) = 0;
+
+	virtual void setRenderTargets(const RenderHandle* targets, uint32_t count, RenderHandle depthStencil) = 0;
+	virtual void clearRenderTarget(RenderHandle target, const float color[4]) = 0;
+	virtual void clearDepthStencil(RenderHandle depthStencil, float depth) = 0;
+	// viewport and scissor.
+	virtual void setViewport(float x, float y, float width, float height) = 0;
+	virtual void setVertexBuffer(RenderHandle buffer, uint32_t stride, uint32_t offset = 0) = 0;
+	// eR32Uint or eUnknown for 16 bit indices.
+	virtual void setIndexBuffer(RenderHandle buffer, RenderFormat format, uint32_t offset = 0) = 0;
+
+	virtual void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) = 0;
+	virtual void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) = 0;
+	virtual void dispatch(uint32_t x, uint32_t y, uint32_t z) = 0;
+	// countBuffer may be kInvalidRenderHandle, then maxCount commands are executed.
+	virtual void executeIndirect(RenderHandle signature, uint32_t maxCount, RenderHandle argumentBuffer, uint32_t argumentOffset,
+		RenderHandle countBuffer, uint32_t countOffset) = 0;
+
+	virtual void copyBuffer(RenderHandle dest, uint32_t destOffset, RenderHandle source, uint32_t sourceOffset, uint32_t size) = 0;
+
+	virtual void writeTimestamp(RenderHandle queries, uint32_t index) = 0;
+	// 64 bit ticks of RenderDevice::getTimestampFrequency into a readback buffer.
+	virtual void resolveTimestamps(RenderHandle queries, uint32_t first, uint32_t count, RenderHandle dest, uint32_t destOffset) = 0;
+
+	virtual void beginEvent(const char* name) = 0;
+	virtual void endEvent() = 0;
+};
+
+class RenderDevice {
+public:
+	RenderDevice() = default;
+	virtual ~RenderDevice() = default;
+
+	virtual RenderBackend getBackend() = 0;
+
+	// the initial state is eGenericRead for upload buffers, eCopyDest for readback and eCommon otherwise; data is
+	// uploaded before the call returns.
+	virtual RenderHandle createBuffer(const BufferDesc& desc, const void* data = nullptr) = 0;
+	// render targets start in eRenderTarget, depth stencils in eDepthWrite and the rest in eCommon.
+	virtual RenderHandle createTexture(const TextureDesc& desc) = 0;
+	virtual RenderHandle createTimestampQueries(uint32_t count) = 0;
+	virtual void destroy(RenderHandle resource) = 0;
+
+	// upload and readback buffers only.
+	virtual void* map(RenderHandle buffer) = 0;
+	virtual void unmap(RenderHandle buffer) = 0;
+
+	// index of a descriptor for setRootTable. a stride makes a structured buffer view, buffers without one are raw.
+	virtual uint32_t createView(RenderHandle resource, ViewType type, uint32_t stride = 0) = 0;
+
+	virtual std::unique_ptr<RenderCommandList> createCommandList() = 0;
+	// the lists have to come from this device.
+	virtual void submit(RenderCommandList* const* lists, uint32_t count) = 0;
+
+	virtual RenderHandle createFence() = 0;
+	// signaled on the queue after the work submitted so far.
+	virtual void signal(RenderHandle fence, uint64_t value) = 0;
+	virtual uint64_t getCompletedValue(RenderHandle fence) = 0;
+	// blocks the cpu until the fence reaches value.
+	virtual void wait(RenderHandle fence, uint64_t value) = 0;
+
+	// ticks per second of writeTimestamp.
+	virtual uint64_t getTimestampFrequency() = 0;
+};
+
+// nullptr when the backend is not available on this platform or failed to create.
+std::unique_ptr<RenderDevice> createRenderDevice(RenderBackend backend);
+
+#endif
\ No newline at end of file
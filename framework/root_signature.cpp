@@ -1,34 +1,22 @@
 #include "root_signature.h"
 
+#include "hash.h"
+#include "pipeline_cache.h"
+
 bool RootSignature::create(ID3D12Device* device, D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlag) {
 	HRESULT res;
-	std::vector<D3D12_ROOT_PARAMETER> rootParam;
-
-	rootParam.reserve(m_range.size());
-	for(size_t i = 0; i < m_range.size(); i++) {
-		D3D12_ROOT_PARAMETER param{};
-		param.ParameterType = m_rootParameterType[i];
-		param.ShaderVisibility = m_shaderVisiblity[i];
-		param.DescriptorTable.NumDescriptorRanges = 1;
-		param.DescriptorTable.pDescriptorRanges = &m_range[i];
-
-		rootParam.push_back(param);
-
-		int a = 0;
-	}
-
-	D3D12_ROOT_SIGNATURE_DESC rsDesc{};
-	rsDesc.NumParameters = (UINT)rootParam.size();
-	rsDesc.pParameters = rootParam.data();
-	rsDesc.Flags = rootSignatureFlag;
 
 	Microsoft::WRL::ComPtr<ID3DBlob> signature;
 	Microsoft::WRL::ComPtr<ID3DBlob> error;
 
-	res = D3D12SerializeRootSignature(&rsDesc, D3D_ROOT_SIGNATURE_VERSION_1, signature.ReleaseAndGetAddressOf(),
-		error.ReleaseAndGetAddressOf());
-	if (FAILED(res)) {
-		OutputDebugString((const char*)error->GetBufferPointer());
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData{};
+	featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+		featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+
+	if (!serialize(featureData.HighestVersion, rootSignatureFlag, signature.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf())) {
+		if (error)
+			OutputDebugString((const char*)error->GetBufferPointer());
 		return false;
 	}
 
@@ -39,19 +27,193 @@ bool RootSignature::create(ID3D12Device* device, D3D12_ROOT_SIGNATURE_FLAGS root
 		return false;
 	}
 
+	// lets the pipeline cache key pipelines by the root signature contents instead of the object.
+	uint64_t hash = hashBytes(signature->GetBufferPointer(), signature->GetBufferSize());
+	m_rootSignature->SetPrivateData(kRootSignatureHashGuid, sizeof(hash), &hash);
+
 	return true;
 }
 
-void RootSignature::addDescriptorCount(D3D12_SHADER_VISIBILITY shaderVisiblity, D3D12_DESCRIPTOR_RANGE_TYPE descType, UINT baseShaderRegister, UINT count, D3D12_ROOT_PARAMETER_TYPE type) {
-	D3D12_DESCRIPTOR_RANGE descRange{};
-	descRange.RangeType = descType;
-	descRange.NumDescriptors = count;
-	descRange.BaseShaderRegister = baseShaderRegister;
-	descRange.RegisterSpace = 0;
-	descRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+bool RootSignature::serialize(D3D_ROOT_SIGNATURE_VERSION version, D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlag, ID3DBlob** signature, ID3DBlob** error) {
+	HRESULT res;
+
+	if (version == D3D_ROOT_SIGNATURE_VERSION_1_0) {
+		std::vector<D3D12_DESCRIPTOR_RANGE> range(m_parameter.size());
+		std::vector<D3D12_ROOT_PARAMETER> rootParam;
+
+		rootParam.reserve(m_parameter.size());
+		for (size_t i = 0; i < m_parameter.size(); i++) {
+			const Parameter& src = m_parameter[i];
+
+			D3D12_ROOT_PARAMETER param{};
+			param.ParameterType = src.type;
+			param.ShaderVisibility = src.shaderVisiblity;
+			switch (src.type) {
+			case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+				range[i].RangeType = src.range.RangeType;
+				range[i].NumDescriptors = src.range.NumDescriptors;
+				range[i].BaseShaderRegister = src.range.BaseShaderRegister;
+				range[i].RegisterSpace = src.range.RegisterSpace;
+				range[i].OffsetInDescriptorsFromTableStart = src.range.OffsetInDescriptorsFromTableStart;
+				param.DescriptorTable.NumDescriptorRanges = 1;
+				param.DescriptorTable.pDescriptorRanges = &range[i];
+				break;
+			case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+				param.Constants = src.constants;
+				break;
+			default:
+				param.Descriptor.ShaderRegister = src.descriptor.ShaderRegister;
+				param.Descriptor.RegisterSpace = src.descriptor.RegisterSpace;
+				break;
+			}
+
+			rootParam.push_back(param);
+		}
+
+		D3D12_ROOT_SIGNATURE_DESC rsDesc{};
+		rsDesc.NumParameters = (UINT)rootParam.size();
+		rsDesc.pParameters = rootParam.data();
+		rsDesc.NumStaticSamplers = (UINT)m_staticSampler.size();
+		rsDesc.pStaticSamplers = m_staticSampler.data();
+		rsDesc.Flags = rootSignatureFlag;
+
+		res = D3D12SerializeRootSignature(&rsDesc, D3D_ROOT_SIGNATURE_VERSION_1, signature, error);
+		return SUCCEEDED(res);
+	}
+
+	std::vector<D3D12_ROOT_PARAMETER1> rootParam;
+
+	rootParam.reserve(m_parameter.size());
+	for (size_t i = 0; i < m_parameter.size(); i++) {
+		const Parameter& src = m_parameter[i];
+
+		D3D12_ROOT_PARAMETER1 param{};
+		param.ParameterType = src.type;
+		param.ShaderVisibility = src.shaderVisiblity;
+		switch (src.type) {
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			param.DescriptorTable.NumDescriptorRanges = 1;
+			param.DescriptorTable.pDescriptorRanges = &src.range;
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			param.Constants = src.constants;
+			break;
+		default:
+			param.Descriptor = src.descriptor;
+			break;
+		}
+
+		rootParam.push_back(param);
+	}
+
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC rsDesc{};
+	rsDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	rsDesc.Desc_1_1.NumParameters = (UINT)rootParam.size();
+	rsDesc.Desc_1_1.pParameters = rootParam.data();
+	rsDesc.Desc_1_1.NumStaticSamplers = (UINT)m_staticSampler.size();
+	rsDesc.Desc_1_1.pStaticSamplers = m_staticSampler.data();
+	rsDesc.Desc_1_1.Flags = rootSignatureFlag;
+
+	res = D3D12SerializeVersionedRootSignature(&rsDesc, signature, error);
+	return SUCCEEDED(res);
+}
+
+bool RootSignature::isBound(D3D12_DESCRIPTOR_RANGE_TYPE type, UINT shaderRegister, UINT registerSpace) {
+	for (auto& ite : m_parameter) {
+		switch (ite.type) {
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			if (ite.range.RangeType == type && ite.range.RegisterSpace == registerSpace && shaderRegister >= ite.range.BaseShaderRegister &&
+				(ite.range.NumDescriptors == UINT_MAX || shaderRegister < ite.range.BaseShaderRegister + ite.range.NumDescriptors))
+				return true;
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			if (type == D3D12_DESCRIPTOR_RANGE_TYPE_CBV && ite.constants.ShaderRegister == shaderRegister && ite.constants.RegisterSpace == registerSpace)
+				return true;
+			break;
+		default:
+		{
+			D3D12_DESCRIPTOR_RANGE_TYPE descriptorType =
+				ite.type == D3D12_ROOT_PARAMETER_TYPE_CBV ? D3D12_DESCRIPTOR_RANGE_TYPE_CBV :
+				ite.type == D3D12_ROOT_PARAMETER_TYPE_SRV ? D3D12_DESCRIPTOR_RANGE_TYPE_SRV : D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+			if (descriptorType == type && ite.descriptor.ShaderRegister == shaderRegister && ite.descriptor.RegisterSpace == registerSpace)
+				return true;
+			break;
+		}
+		}
+	}
+
+	if (type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER) {
+		for (auto& ite : m_staticSampler) {
+			if (ite.ShaderRegister == shaderRegister && ite.RegisterSpace == registerSpace)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void RootSignature::addDescriptorCount(D3D12_SHADER_VISIBILITY shaderVisiblity, D3D12_DESCRIPTOR_RANGE_TYPE descType, UINT baseShaderRegister, UINT count,
+	D3D12_ROOT_PARAMETER_TYPE type, D3D12_DESCRIPTOR_RANGE_FLAGS flags, UINT registerSpace) {
+	// samplers have no data, so only the descriptor volatility can be requested for them.
+	if (descType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
+		flags &= D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
+
+	Parameter param{};
+	param.type = type;
+	param.shaderVisiblity = shaderVisiblity;
+	param.range.RangeType = descType;
+	param.range.NumDescriptors = count;
+	param.range.BaseShaderRegister = baseShaderRegister;
+	param.range.RegisterSpace = registerSpace;
+	param.range.Flags = flags;
+	param.range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+	m_parameter.push_back(param);
+}
+
+void RootSignature::addConstants(D3D12_SHADER_VISIBILITY shaderVisiblity, UINT shaderRegister, UINT num32BitValues, UINT registerSpace) {
+	Parameter param{};
+	param.type = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	param.shaderVisiblity = shaderVisiblity;
+	param.constants.ShaderRegister = shaderRegister;
+	param.constants.RegisterSpace = registerSpace;
+	param.constants.Num32BitValues = num32BitValues;
+
+	m_parameter.push_back(param);
+}
+
+void RootSignature::addRootDescriptor(D3D12_SHADER_VISIBILITY shaderVisiblity, D3D12_ROOT_PARAMETER_TYPE type, UINT shaderRegister,
+	D3D12_ROOT_DESCRIPTOR_FLAGS flags, UINT registerSpace) {
+	Parameter param{};
+	param.type = type;
+	param.shaderVisiblity = shaderVisiblity;
+	param.descriptor.ShaderRegister = shaderRegister;
+	param.descriptor.RegisterSpace = registerSpace;
+	param.descriptor.Flags = flags;
+
+	m_parameter.push_back(param);
+}
+
+void RootSignature::addStaticSampler(D3D12_SHADER_VISIBILITY shaderVisiblity, const D3D12_SAMPLER_DESC& samplerDesc, UINT shaderRegister, UINT registerSpace) {
+	D3D12_STATIC_SAMPLER_DESC desc{};
+	desc.Filter = samplerDesc.Filter;
+	desc.AddressU = samplerDesc.AddressU;
+	desc.AddressV = samplerDesc.AddressV;
+	desc.AddressW = samplerDesc.AddressW;
+	desc.MipLODBias = samplerDesc.MipLODBias;
+	desc.MaxAnisotropy = samplerDesc.MaxAnisotropy;
+	desc.ComparisonFunc = samplerDesc.ComparisonFunc;
+	desc.MinLOD = samplerDesc.MinLOD;
+	desc.MaxLOD = samplerDesc.MaxLOD;
+	desc.ShaderRegister = shaderRegister;
+	desc.RegisterSpace = registerSpace;
+	desc.ShaderVisibility = shaderVisiblity;
 
-	m_range.push_back(descRange);
-	m_shaderVisiblity.push_back(shaderVisiblity);
+	// static samplers only support the three fixed border colors.
+	if (samplerDesc.BorderColor[0] == 0.0f && samplerDesc.BorderColor[1] == 0.0f && samplerDesc.BorderColor[2] == 0.0f)
+		desc.BorderColor = samplerDesc.BorderColor[3] == 0.0f ? D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK : D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK;
+	else
+		desc.BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE;
 
-	m_rootParameterType.push_back(type);
+	m_staticSampler.push_back(desc);
 }
\ No newline at end of file
@@ -16,18 +16,48 @@ public:
 
 	~RootSignature() = default;
 
+	// serialized as version 1.1 when the device supports it, otherwise falls back to 1.0 and drops the volatility flags.
 	bool create(ID3D12Device* device, D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlag);
 
-	void addDescriptorCount(D3D12_SHADER_VISIBILITY shaderVisiblity, D3D12_DESCRIPTOR_RANGE_TYPE descType, UINT baseShaderRegister, UINT count, D3D12_ROOT_PARAMETER_TYPE type = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE);
+	// descriptor table with a single range. the default flags keep the 1.0 behaviour (descriptors and data volatile).
+	void addDescriptorCount(D3D12_SHADER_VISIBILITY shaderVisiblity, D3D12_DESCRIPTOR_RANGE_TYPE descType, UINT baseShaderRegister, UINT count,
+		D3D12_ROOT_PARAMETER_TYPE type = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE,
+		D3D12_DESCRIPTOR_RANGE_FLAGS flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE,
+		UINT registerSpace = 0);
+
+	// 32-bit values bound directly in the root signature, set with SetGraphicsRoot32BitConstants.
+	void addConstants(D3D12_SHADER_VISIBILITY shaderVisiblity, UINT shaderRegister, UINT num32BitValues, UINT registerSpace = 0);
+
+	// root CBV/SRV/UAV bound by gpu virtual address. type must be one of the D3D12_ROOT_PARAMETER_TYPE_CBV/SRV/UAV values.
+	void addRootDescriptor(D3D12_SHADER_VISIBILITY shaderVisiblity, D3D12_ROOT_PARAMETER_TYPE type, UINT shaderRegister,
+		D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_NONE, UINT registerSpace = 0);
+
+	void addStaticSampler(D3D12_SHADER_VISIBILITY shaderVisiblity, const D3D12_SAMPLER_DESC& samplerDesc, UINT shaderRegister, UINT registerSpace = 0);
+
+	// true when a parameter or static sampler covers the register.
+	bool isBound(D3D12_DESCRIPTOR_RANGE_TYPE type, UINT shaderRegister, UINT registerSpace);
+
+	// the serialized root signature without a device, version is D3D_ROOT_SIGNATURE_VERSION_1_0 or _1_1.
+	bool serialize(D3D_ROOT_SIGNATURE_VERSION version, D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlag, ID3DBlob** signature, ID3DBlob** error);
+
+	UINT getParameterCount() { return (UINT)m_parameter.size(); }
+	UINT getStaticSamplerCount() { return (UINT)m_staticSampler.size(); }
 
 	ID3D12RootSignature* getRootSignature() { return m_rootSignature.Get(); }
 
 private:
+	struct Parameter {
+		D3D12_ROOT_PARAMETER_TYPE type;
+		D3D12_SHADER_VISIBILITY shaderVisiblity;
+		D3D12_DESCRIPTOR_RANGE1 range;
+		D3D12_ROOT_CONSTANTS constants;
+		D3D12_ROOT_DESCRIPTOR1 descriptor;
+	};
+
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
 
-	std::vector<D3D12_DESCRIPTOR_RANGE> m_range;
-	std::vector<D3D12_SHADER_VISIBILITY> m_shaderVisiblity;
-	std::vector<D3D12_ROOT_PARAMETER_TYPE> m_rootParameterType;
+	std::vector<Parameter> m_parameter;
+	std::vector<D3D12_STATIC_SAMPLER_DESC> m_staticSampler;
 
 	UINT m_descriptorTableId;
 };
@@ -9,6 +9,10 @@
 #include <wrl/client.h>
 
 #include <memory>
+#include <string>
+#include <vector>
+
+#include "shader_cache.h"
 
 class Shader {
 public:
@@ -20,10 +24,19 @@ public:
 	bool createGeometoryShader(const wchar_t* filename);
 	bool createComputeShader(const wchar_t* filename);
 
+	// entry point, target profile and defines given explicitly, e.g. for permutations.
+	bool create(const wchar_t* filename, const wchar_t* entryPoint, const wchar_t* profile, const std::vector<ShaderDefine>& defines);
+
 	IDxcBlob* getByteCode() { return m_bytecode.Get(); }
 
+	// key the bytecode was cached under, 0 when the cache was not used.
+	uint64_t getCacheKey() { return m_cacheKey; }
+
 private:
+	bool compile(const wchar_t* filename, const wchar_t* entryPoint, const wchar_t* profile, const std::vector<ShaderDefine>& defines);
+
 	Microsoft::WRL::ComPtr<IDxcBlob> m_bytecode;
+	uint64_t m_cacheKey = 0;
 };
 
 
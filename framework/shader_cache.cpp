@@ -0,0 +1,264 @@
+#include "shader_cache.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+
+static const uint32_t kShaderCacheMagic = 0x43435844;	// "DXCC"
+static const uint32_t kShaderCacheVersion = 2;
+
+struct ShaderCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t size;
+	// of the bytecode, a damaged entry is treated as a miss.
+	uint64_t hash;
+};
+
+
+static bool readFile(const std::filesystem::path& filename, std::string& data) {
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs) return false;
+
+	data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	return true;
+}
+
+static bool parseInclude(const std::string& line, std::string& includeName) {
+	size_t pos = line.find_first_not_of(" \t");
+	if (pos == std::string::npos || line[pos] != '#') return false;
+
+	pos = line.find_first_not_of(" \t", pos + 1);
+	if (pos == std::string::npos || line.compare(pos, 7, "include") != 0) return false;
+
+	size_t begin = line.find('"', pos + 7);
+	if (begin == std::string::npos) return false;
+	size_t end = line.find('"', begin + 1);
+	if (end == std::string::npos) return false;
+
+	includeName = line.substr(begin + 1, end - begin - 1);
+	return true;
+}
+
+bool ShaderCache::collectIncludes(const std::filesystem::path& filename, std::vector<std::filesystem::path>& files) {
+	std::error_code ec;
+	std::filesystem::path path = std::filesystem::weakly_canonical(filename, ec);
+	if (ec) path = filename;
+
+	if (std::find(files.begin(), files.end(), path) != files.end())
+		return true;
+
+	std::string source;
+	if (!readFile(path, source))
+		return false;
+
+	files.push_back(path);
+
+	std::istringstream iss(source);
+	std::string line;
+	while (std::getline(iss, line)) {
+		std::string includeName;
+		if (!parseInclude(line, includeName))
+			continue;
+
+		std::filesystem::path includePath = path.parent_path() / includeName;
+		if (!std::filesystem::exists(includePath, ec))
+			includePath = includeName;
+
+		if (!collectIncludes(includePath, files))
+			return false;
+	}
+
+	return true;
+}
+
+uint64_t ShaderCache::computeKey(const std::filesystem::path& filename, const std::wstring& entryPoint, const std::wstring& profile,
+	const std::vector<ShaderDefine>& defines, uint64_t compilerVersion) {
+	std::vector<std::filesystem::path> files;
+	if (!collectIncludes(filename, files))
+		return 0;
+
+	uint64_t hash = kHashSeed;
+	for (auto& ite : files) {
+		std::string source;
+		if (!readFile(ite, source))
+			return 0;
+
+		hash = hashString(ite.filename().wstring(), hash);
+		hash = hashString(source, hash);
+	}
+
+	hash = hashString(entryPoint, hash);
+	hash = hashString(profile, hash);
+	for (auto& ite : defines) {
+		hash = hashString(ite.name, hash);
+		hash = hashString(ite.value, hash);
+	}
+	hash = hashValue(compilerVersion, hash);
+
+	// 0 is reserved for "could not be computed".
+	return hash == 0 ? 1 : hash;
+}
+
+bool ShaderCache::load(uint64_t key, std::vector<uint8_t>& bytecode) {
+	if (!m_isEnable || key == 0) return false;
+
+	std::filesystem::path path = getEntryPath(key);
+
+	std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+	if (!ifs) return false;
+
+	uint64_t fileSize = (uint64_t)ifs.tellg();
+	ifs.seekg(0);
+
+	ShaderCacheHeader header{};
+	ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!ifs || header.magic != kShaderCacheMagic || header.version != kShaderCacheVersion || header.key != key) {
+		ifs.close();
+		removeEntry(path);
+		return false;
+	}
+
+	// checked before allocating, a damaged header must not request gigabytes.
+	if (header.size != fileSize - sizeof(header)) {
+		ifs.close();
+		removeEntry(path);
+		return false;
+	}
+
+	bytecode.resize((size_t)header.size);
+	ifs.read(reinterpret_cast<char*>(bytecode.data()), bytecode.size());
+	ifs.close();
+	if (!ifs || hashBytes(bytecode.data(), bytecode.size()) != header.hash) {
+		bytecode.clear();
+		removeEntry(path);
+		return false;
+	}
+
+	// the modification time doubles as the last access time for the lru eviction.
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+	return true;
+}
+
+bool ShaderCache::store(uint64_t key, const void* data, size_t size) {
+	if (!m_isEnable || key == 0) return false;
+
+	std::error_code ec;
+	std::filesystem::create_directories(m_directory, ec);
+
+	std::filesystem::path path = getEntryPath(key);
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp" + std::to_string(m_tempId++);
+
+	ShaderCacheHeader header{ kShaderCacheMagic, kShaderCacheVersion, key, (uint64_t)size, hashBytes(data, size) };
+	{
+		std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+		if (!ofs) return false;
+
+		ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		ofs.write(static_cast<const char*>(data), size);
+		if (!ofs) {
+			ofs.close();
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_isSizeKnown)
+		scan();
+
+	// an entry stored by another thread under the same key is replaced.
+	uint64_t previousSize = std::filesystem::file_size(path, ec);
+	if (ec) previousSize = 0;
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	m_size += sizeof(header) + size;
+	m_size -= (std::min)(previousSize, m_size);
+	if (m_size > m_maxSize)
+		evict();
+
+	return true;
+}
+
+void ShaderCache::clear() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code ec;
+	std::filesystem::remove_all(m_directory, ec);
+	m_size = 0;
+	m_isSizeKnown = true;
+}
+
+uint64_t ShaderCache::getSize() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_isSizeKnown)
+		scan();
+
+	return m_size;
+}
+
+std::filesystem::path ShaderCache::getEntryPath(uint64_t key) {
+	return m_directory / (hashToString(key) + ".dxil");
+}
+
+void ShaderCache::removeEntry(const std::filesystem::path& path) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code ec;
+	uint64_t size = std::filesystem::file_size(path, ec);
+	if (ec || !std::filesystem::remove(path, ec))
+		return;
+
+	if (m_isSizeKnown)
+		m_size -= (std::min)(size, m_size);
+}
+
+std::vector<ShaderCache::Entry> ShaderCache::scan() {
+	std::vector<Entry> entries;
+	m_size = 0;
+
+	std::error_code ec;
+	for (auto& ite : std::filesystem::directory_iterator(m_directory, ec)) {
+		if (!ite.is_regular_file(ec) || ite.path().extension() != ".dxil")
+			continue;
+
+		Entry entry{ ite.path(), ite.last_write_time(ec), ite.file_size(ec) };
+		m_size += entry.size;
+		entries.push_back(entry);
+	}
+
+	m_isSizeKnown = true;
+	return entries;
+}
+
+void ShaderCache::evict() {
+	// the running size only counts this process, the directory is walked again once it says the cap is reached.
+	std::vector<Entry> entries = scan();
+	if (m_size <= m_maxSize)
+		return;
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+	std::error_code ec;
+	for (auto& ite : entries) {
+		if (m_size <= m_maxSize) break;
+
+		if (std::filesystem::remove(ite.path, ec))
+			m_size -= ite.size;
+	}
+}
\ No newline at end of file
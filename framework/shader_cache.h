@@ -0,0 +1,84 @@
+#ifndef _SHADER_CACHE_H_
+#define _SHADER_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ShaderDefine {
+	std::wstring name;
+	std::wstring value;
+};
+
+// on-disk dxil cache. entries are written to a temporary file and renamed into place so a crash never leaves a
+// truncated entry behind, and the least recently used entries are removed once the directory grows over the size cap.
+// entries whose size or hash does not match their header are removed when loaded.
+class ShaderCache {
+private:
+	ShaderCache() :
+		m_directory("shader_cache"),
+		m_maxSize(64ull * 1024 * 1024),
+		m_isEnable(true),
+		m_tempId(0),
+		m_size(0),
+		m_isSizeKnown(false)
+	{}
+	~ShaderCache() = default;
+
+public:
+	static ShaderCache& Instance() {
+		static ShaderCache instance;
+		return instance;
+	}
+
+	void setDirectory(const std::filesystem::path& directory) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_directory = directory;
+		m_isSizeKnown = false;
+	}
+	void setMaxSize(uint64_t maxSize) { m_maxSize = maxSize; }
+	void setEnable(bool isEnable) { m_isEnable = isEnable; }
+	bool isEnable() { return m_isEnable; }
+
+	// hashes the source and every file it includes together with everything else that changes the compiled output.
+	uint64_t computeKey(const std::filesystem::path& filename, const std::wstring& entryPoint, const std::wstring& profile,
+		const std::vector<ShaderDefine>& defines, uint64_t compilerVersion);
+
+	bool load(uint64_t key, std::vector<uint8_t>& bytecode);
+	bool store(uint64_t key, const void* data, size_t size);
+
+	void clear();
+
+	// bytes of the entries, the directory is walked on the first call only.
+	uint64_t getSize();
+
+	// filename followed by every file reached through #include "...", each listed once.
+	static bool collectIncludes(const std::filesystem::path& filename, std::vector<std::filesystem::path>& files);
+
+private:
+	struct Entry {
+		std::filesystem::path path;
+		std::filesystem::file_time_type time;
+		uint64_t size;
+	};
+
+	std::filesystem::path getEntryPath(uint64_t key);
+	void removeEntry(const std::filesystem::path& path);
+	// the entries of the directory, also recounts m_size. called with m_mutex held.
+	std::vector<Entry> scan();
+	void evict();
+
+	std::mutex m_mutex;
+	std::filesystem::path m_directory;
+	uint64_t m_maxSize;
+	bool m_isEnable;
+	std::atomic<uint32_t> m_tempId;
+	// the running size of the directory, walked once and then kept up to date by store and load.
+	uint64_t m_size;
+	bool m_isSizeKnown;
+};
+
+#endif
\ No newline at end of file
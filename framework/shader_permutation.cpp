@@ -0,0 +1,109 @@
+#include "shader_permutation.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+
+void ShaderPermutation::setSource(const wchar_t* filename, const wchar_t* entryPoint, const wchar_t* profile) {
+	m_filename = filename;
+	m_entryPoint = entryPoint;
+	m_profile = profile;
+}
+
+uint32_t ShaderPermutation::addFeature(const wchar_t* define) {
+	m_features.push_back(define);
+	return 1u << (uint32_t)(m_features.size() - 1);
+}
+
+void ShaderPermutation::addDefine(const wchar_t* name, const wchar_t* value) {
+	m_defines.push_back({ name, value });
+}
+
+std::vector<ShaderDefine> ShaderPermutation::getDefines(uint32_t featureMask) {
+	std::vector<ShaderDefine> defines = m_defines;
+	for (size_t i = 0; i < m_features.size(); i++) {
+		defines.push_back({ m_features[i], (featureMask & (1u << i)) ? L"1" : L"0" });
+	}
+	return defines;
+}
+
+bool ShaderPermutation::compile(const std::vector<uint32_t>& featureMasks, unsigned int threadCount) {
+	std::vector<uint32_t> masks;
+	for (auto& ite : featureMasks) {
+		if (m_variants.find(ite) == m_variants.end() && std::find(masks.begin(), masks.end(), ite) == masks.end())
+			masks.push_back(ite);
+	}
+
+	if (masks.empty())
+		return true;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, (unsigned int)masks.size());
+
+	std::vector<ShaderSp> shaders(masks.size());
+	std::vector<char> results(masks.size(), 0);
+	std::atomic<size_t> next(0);
+
+	auto worker = [&]() {
+		for (size_t i = next++; i < masks.size(); i = next++) {
+			shaders[i] = std::make_shared<Shader>();
+			results[i] = shaders[i]->create(m_filename.c_str(), m_entryPoint.c_str(), m_profile.c_str(), getDefines(masks[i]));
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& ite : threads)
+		ite.join();
+
+	bool result = true;
+	for (size_t i = 0; i < masks.size(); i++) {
+		if (!results[i]) {
+			result = false;
+			continue;
+		}
+
+		IDxcBlob* bytecode = shaders[i]->getByteCode();
+		uint64_t hash = hashBytes(bytecode->GetBufferPointer(), bytecode->GetBufferSize());
+
+		auto ite = m_uniqueVariants.find(hash);
+		if (ite != m_uniqueVariants.end()) {
+			IDxcBlob* other = ite->second->getByteCode();
+			if (other->GetBufferSize() == bytecode->GetBufferSize() &&
+				memcmp(other->GetBufferPointer(), bytecode->GetBufferPointer(), bytecode->GetBufferSize()) == 0) {
+				m_variants[masks[i]] = ite->second;
+				continue;
+			}
+		}
+		else {
+			m_uniqueVariants[hash] = shaders[i];
+		}
+
+		m_variants[masks[i]] = shaders[i];
+	}
+
+	return result;
+}
+
+ShaderSp ShaderPermutation::getVariant(uint32_t featureMask) {
+	auto ite = m_variants.find(featureMask);
+	if (ite == m_variants.end())
+		return nullptr;
+	return ite->second;
+}
+
+size_t ShaderPermutation::getUniqueVariantCount() {
+	std::vector<Shader*> unique;
+	for (auto& ite : m_variants) {
+		if (std::find(unique.begin(), unique.end(), ite.second.get()) == unique.end())
+			unique.push_back(ite.second.get());
+	}
+	return unique.size();
+}
\ No newline at end of file
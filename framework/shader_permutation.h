@@ -0,0 +1,47 @@
+#ifndef _SHADER_PERMUTATION_H_
+#define _SHADER_PERMUTATION_H_
+
+#include "shader.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// compiles the variants of one shader selected by a feature bitmask. every feature bit maps to a define that is
+// set to 1 or 0, so the shader can use #if FEATURE. variants whose dxil turns out identical share one Shader.
+class ShaderPermutation {
+public:
+	ShaderPermutation() = default;
+	~ShaderPermutation() = default;
+
+	void setSource(const wchar_t* filename, const wchar_t* entryPoint, const wchar_t* profile);
+
+	// returns the bit of the new feature.
+	uint32_t addFeature(const wchar_t* define);
+	// define passed to every variant.
+	void addDefine(const wchar_t* name, const wchar_t* value);
+
+	std::vector<ShaderDefine> getDefines(uint32_t featureMask);
+
+	// compiles the missing variants on threadCount worker threads (0 picks the hardware concurrency).
+	bool compile(const std::vector<uint32_t>& featureMasks, unsigned int threadCount = 0);
+
+	ShaderSp getVariant(uint32_t featureMask);
+
+	size_t getVariantCount() { return m_variants.size(); }
+	size_t getUniqueVariantCount();
+
+private:
+	std::wstring m_filename;
+	std::wstring m_entryPoint;
+	std::wstring m_profile;
+
+	std::vector<std::wstring> m_features;
+	std::vector<ShaderDefine> m_defines;
+
+	std::unordered_map<uint32_t, ShaderSp> m_variants;
+	std::unordered_map<uint64_t, ShaderSp> m_uniqueVariants;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "shader_reflection.h"
+
+#include <d3d12shader.h>
+
+#include <algorithm>
+#include <climits>
+
+
+static bool toRangeType(D3D_SHADER_INPUT_TYPE type, D3D12_DESCRIPTOR_RANGE_TYPE* rangeType) {
+	switch (type) {
+	case D3D_SIT_CBUFFER:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+		return true;
+	case D3D_SIT_TBUFFER:
+	case D3D_SIT_TEXTURE:
+	case D3D_SIT_STRUCTURED:
+	case D3D_SIT_BYTEADDRESS:
+	case D3D_SIT_RTACCELERATIONSTRUCTURE:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		return true;
+	case D3D_SIT_UAV_RWTYPED:
+	case D3D_SIT_UAV_RWSTRUCTURED:
+	case D3D_SIT_UAV_RWBYTEADDRESS:
+	case D3D_SIT_UAV_APPEND_STRUCTURED:
+	case D3D_SIT_UAV_CONSUME_STRUCTURED:
+	case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+		return true;
+	case D3D_SIT_SAMPLER:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static const char* rangeTypeName(D3D12_DESCRIPTOR_RANGE_TYPE type) {
+	switch (type) {
+	case D3D12_DESCRIPTOR_RANGE_TYPE_CBV: return "b";
+	case D3D12_DESCRIPTOR_RANGE_TYPE_SRV: return "t";
+	case D3D12_DESCRIPTOR_RANGE_TYPE_UAV: return "u";
+	default: return "s";
+	}
+}
+
+static std::string registerName(const ShaderBinding& binding) {
+	return std::string(rangeTypeName(binding.rangeType)) + std::to_string(binding.bindPoint) + ", space" + std::to_string(binding.space);
+}
+
+static UINT lastRegister(const ShaderBinding& binding) {
+	if (binding.bindCount == UINT_MAX) return UINT_MAX;
+	return binding.bindPoint + binding.bindCount - 1;
+}
+
+
+bool ShaderReflection::create(IDxcBlob* bytecode, D3D12_SHADER_VISIBILITY visibility) {
+	HRESULT hr;
+
+	m_bindings.clear();
+	m_constantBuffers.clear();
+
+	if (bytecode == nullptr)
+		return false;
+
+	Microsoft::WRL::ComPtr<IDxcContainerReflection> containerReflection;
+	hr = DxcCreateInstance(CLSID_DxcContainerReflection, IID_PPV_ARGS(containerReflection.ReleaseAndGetAddressOf()));
+	if (FAILED(hr))
+		return false;
+
+	hr = containerReflection->Load(bytecode);
+	if (FAILED(hr))
+		return false;
+
+	UINT32 partIndex;
+	hr = containerReflection->FindFirstPartKind(DXC_PART_DXIL, &partIndex);
+	if (FAILED(hr))
+		return false;
+
+	Microsoft::WRL::ComPtr<ID3D12ShaderReflection> reflection;
+	hr = containerReflection->GetPartReflection(partIndex, IID_PPV_ARGS(reflection.ReleaseAndGetAddressOf()));
+	if (FAILED(hr))
+		return false;
+
+	D3D12_SHADER_DESC shaderDesc{};
+	reflection->GetDesc(&shaderDesc);
+
+	for (UINT i = 0; i < shaderDesc.BoundResources; i++) {
+		D3D12_SHADER_INPUT_BIND_DESC bindDesc{};
+		reflection->GetResourceBindingDesc(i, &bindDesc);
+
+		ShaderBinding binding{};
+		if (!toRangeType(bindDesc.Type, &binding.rangeType))
+			continue;
+
+		binding.name = bindDesc.Name;
+		binding.bindPoint = bindDesc.BindPoint;
+		binding.bindCount = bindDesc.BindCount == 0 ? UINT_MAX : bindDesc.BindCount;
+		binding.space = bindDesc.Space;
+		binding.visibility = visibility;
+		m_bindings.push_back(binding);
+
+		if (bindDesc.Type != D3D_SIT_CBUFFER)
+			continue;
+
+		ID3D12ShaderReflectionConstantBuffer* cbuffer = reflection->GetConstantBufferByName(bindDesc.Name);
+		D3D12_SHADER_BUFFER_DESC bufferDesc{};
+		if (FAILED(cbuffer->GetDesc(&bufferDesc)))
+			continue;
+
+		ShaderConstantBufferLayout layout{};
+		layout.name = bindDesc.Name;
+		layout.bindPoint = bindDesc.BindPoint;
+		layout.space = bindDesc.Space;
+		layout.size = bufferDesc.Size;
+		for (UINT j = 0; j < bufferDesc.Variables; j++) {
+			D3D12_SHADER_VARIABLE_DESC variableDesc{};
+			cbuffer->GetVariableByIndex(j)->GetDesc(&variableDesc);
+			layout.variables.push_back({ variableDesc.Name, variableDesc.StartOffset, variableDesc.Size });
+		}
+		m_constantBuffers.push_back(layout);
+	}
+
+	reflection->GetThreadGroupSize(&m_threadGroupSize[0], &m_threadGroupSize[1], &m_threadGroupSize[2]);
+
+	return true;
+}
+
+const ShaderConstantBufferLayout* ShaderReflection::getConstantBuffer(const char* name) const {
+	for (auto& ite : m_constantBuffers) {
+		if (ite.name == name) return &ite;
+	}
+	return nullptr;
+}
+
+
+bool BindingLayout::merge(const ShaderReflection& reflection) {
+	return merge(reflection.getBindings());
+}
+
+bool BindingLayout::merge(const std::vector<ShaderBinding>& bindings) {
+	bool result = true;
+
+	for (auto& binding : bindings) {
+		bool isMerged = false;
+		for (auto& ite : m_bindings) {
+			if (ite.rangeType != binding.rangeType || ite.space != binding.space)
+				continue;
+
+			if (ite.bindPoint == binding.bindPoint) {
+				if (ite.name != binding.name || ite.bindCount != binding.bindCount) {
+					result = addError("'" + binding.name + "' and '" + ite.name + "' both bind " + registerName(binding) + ".");
+				}
+				else if (ite.visibility != binding.visibility) {
+					ite.visibility = D3D12_SHADER_VISIBILITY_ALL;
+				}
+				isMerged = true;
+				break;
+			}
+
+			if (binding.bindPoint <= lastRegister(ite) && ite.bindPoint <= lastRegister(binding)) {
+				result = addError("'" + binding.name + "' at " + registerName(binding) + " overlaps '" + ite.name + "' at " + registerName(ite) + ".");
+				isMerged = true;
+				break;
+			}
+		}
+
+		if (!isMerged)
+			m_bindings.push_back(binding);
+	}
+
+	sortBindings();
+
+	return result;
+}
+
+void BindingLayout::setStaticSampler(const char* name, const D3D12_SAMPLER_DESC& samplerDesc) {
+	m_staticSamplers.push_back({ name, samplerDesc });
+}
+
+void BindingLayout::setRootConstants(const char* name, UINT num32BitValues) {
+	m_rootConstants.push_back({ name, num32BitValues });
+}
+
+void BindingLayout::build(RootSignature* rootSignature) {
+	m_parameterNames.clear();
+
+	for (auto& binding : m_bindings) {
+		if (binding.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER) {
+			const StaticSampler* sampler = findStaticSampler(binding.name);
+			if (sampler) {
+				rootSignature->addStaticSampler(binding.visibility, sampler->desc, binding.bindPoint, binding.space);
+				continue;
+			}
+		}
+
+		const RootConstants* constants = binding.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV ? findRootConstants(binding.name) : nullptr;
+		if (constants) {
+			rootSignature->addConstants(binding.visibility, binding.bindPoint, constants->num32BitValues, binding.space);
+		}
+		else if (binding.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV && binding.bindCount == 1) {
+			rootSignature->addRootDescriptor(binding.visibility, D3D12_ROOT_PARAMETER_TYPE_CBV, binding.bindPoint,
+				D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, binding.space);
+		}
+		else {
+			rootSignature->addDescriptorCount(binding.visibility, binding.rangeType, binding.bindPoint, binding.bindCount,
+				D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE,
+				D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE,
+				binding.space);
+		}
+
+		m_parameterNames.push_back(binding.name);
+	}
+}
+
+bool BindingLayout::createRootSignature(ID3D12Device* device, RootSignature* rootSignature, D3D12_ROOT_SIGNATURE_FLAGS flags) {
+	if (!m_error.empty()) {
+		OutputDebugString(m_error.c_str());
+		return false;
+	}
+
+	build(rootSignature);
+
+	return rootSignature->create(device, flags);
+}
+
+bool BindingLayout::validate(RootSignature* rootSignature) {
+	bool result = true;
+
+	for (auto& binding : m_bindings) {
+		UINT count = binding.bindCount == UINT_MAX ? 1 : binding.bindCount;
+		for (UINT i = 0; i < count; i++) {
+			if (!rootSignature->isBound(binding.rangeType, binding.bindPoint + i, binding.space)) {
+				result = addError("'" + binding.name + "' at " + registerName(binding) + " is not provided by the root signature.");
+				break;
+			}
+		}
+	}
+
+	if (!result)
+		OutputDebugString(m_error.c_str());
+
+	return result;
+}
+
+int BindingLayout::getRootParameterIndex(const char* name) const {
+	for (size_t i = 0; i < m_parameterNames.size(); i++) {
+		if (m_parameterNames[i] == name) return (int)i;
+	}
+	return -1;
+}
+
+bool BindingLayout::addError(const std::string& message) {
+	m_error += message;
+	m_error += "\n";
+	return false;
+}
+
+const BindingLayout::StaticSampler* BindingLayout::findStaticSampler(const std::string& name) const {
+	for (auto& ite : m_staticSamplers) {
+		if (ite.name == name) return &ite;
+	}
+	return nullptr;
+}
+
+const BindingLayout::RootConstants* BindingLayout::findRootConstants(const std::string& name) const {
+	for (auto& ite : m_rootConstants) {
+		if (ite.name == name) return &ite;
+	}
+	return nullptr;
+}
+
+void BindingLayout::sortBindings() {
+	std::stable_sort(m_bindings.begin(), m_bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+		if (a.rangeType != b.rangeType) return a.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV ? true :
+			b.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV ? false : a.rangeType < b.rangeType;
+		if (a.space != b.space) return a.space < b.space;
+		return a.bindPoint < b.bindPoint;
+	});
+}
\ No newline at end of file
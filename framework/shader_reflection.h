@@ -0,0 +1,115 @@
+#ifndef _SHADER_REFLECTION_H_
+#define _SHADER_REFLECTION_H_
+
+#include <d3d12.h>
+#include <dxcapi.h>
+
+#include <wrl/client.h>
+
+#include <string>
+#include <vector>
+
+#include "root_signature.h"
+
+
+struct ShaderBinding {
+	std::string name;
+	D3D12_DESCRIPTOR_RANGE_TYPE rangeType;
+	UINT bindPoint;
+	UINT bindCount;		// UINT_MAX for unbounded arrays
+	UINT space;
+	D3D12_SHADER_VISIBILITY visibility;
+};
+
+struct ShaderVariableLayout {
+	std::string name;
+	UINT offset;
+	UINT size;
+};
+
+struct ShaderConstantBufferLayout {
+	std::string name;
+	UINT bindPoint;
+	UINT space;
+	UINT size;
+	std::vector<ShaderVariableLayout> variables;
+};
+
+
+// resource bindings, cbuffer layouts and thread group size pulled out of a DXIL container.
+// the add/set functions allow filling one by hand so the layout code can run without a compiler.
+class ShaderReflection {
+public:
+	ShaderReflection() = default;
+	~ShaderReflection() = default;
+
+	bool create(IDxcBlob* bytecode, D3D12_SHADER_VISIBILITY visibility);
+
+	void addBinding(const ShaderBinding& binding) { m_bindings.push_back(binding); }
+	void addConstantBuffer(const ShaderConstantBufferLayout& layout) { m_constantBuffers.push_back(layout); }
+	void setThreadGroupSize(UINT x, UINT y, UINT z) { m_threadGroupSize[0] = x; m_threadGroupSize[1] = y; m_threadGroupSize[2] = z; }
+
+	const std::vector<ShaderBinding>& getBindings() const { return m_bindings; }
+	const std::vector<ShaderConstantBufferLayout>& getConstantBuffers() const { return m_constantBuffers; }
+	const ShaderConstantBufferLayout* getConstantBuffer(const char* name) const;
+
+	UINT getThreadGroupSizeX() const { return m_threadGroupSize[0]; }
+	UINT getThreadGroupSizeY() const { return m_threadGroupSize[1]; }
+	UINT getThreadGroupSizeZ() const { return m_threadGroupSize[2]; }
+
+private:
+	std::vector<ShaderBinding> m_bindings;
+	std::vector<ShaderConstantBufferLayout> m_constantBuffers;
+	UINT m_threadGroupSize[3] = { 0, 0, 0 };
+};
+
+
+// merges the bindings of every stage of a pipeline and turns them into a root signature with one parameter per binding.
+// cbuffers become root CBVs (root constants when registered with setRootConstants), everything else a single range
+// descriptor table, samplers registered with setStaticSampler become static samplers.
+class BindingLayout {
+public:
+	BindingLayout() = default;
+	~BindingLayout() = default;
+
+	bool merge(const ShaderReflection& reflection);
+	bool merge(const std::vector<ShaderBinding>& bindings);
+
+	void setStaticSampler(const char* name, const D3D12_SAMPLER_DESC& samplerDesc);
+	void setRootConstants(const char* name, UINT num32BitValues);
+
+	void build(RootSignature* rootSignature);
+	bool createRootSignature(ID3D12Device* device, RootSignature* rootSignature, D3D12_ROOT_SIGNATURE_FLAGS flags);
+
+	// reports every binding the root signature does not provide.
+	bool validate(RootSignature* rootSignature);
+
+	int getRootParameterIndex(const char* name) const;
+
+	const std::vector<ShaderBinding>& getBindings() const { return m_bindings; }
+	const std::string& getError() const { return m_error; }
+
+private:
+	struct StaticSampler {
+		std::string name;
+		D3D12_SAMPLER_DESC desc;
+	};
+
+	struct RootConstants {
+		std::string name;
+		UINT num32BitValues;
+	};
+
+	bool addError(const std::string& message);
+	const StaticSampler* findStaticSampler(const std::string& name) const;
+	const RootConstants* findRootConstants(const std::string& name) const;
+	void sortBindings();
+
+	std::vector<ShaderBinding> m_bindings;
+	std::vector<StaticSampler> m_staticSamplers;
+	std::vector<RootConstants> m_rootConstants;
+	std::vector<std::string> m_parameterNames;
+	std::string m_error;
+};
+
+#endif
\ No newline at end of file
@@ -1,10 +1,6 @@
 #include "texture.h"
 #include "commandbuffer.h"
 
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-
 #include "../tools/stb_image.h"
 
 
@@ -8,6 +8,7 @@
 #include <thread>
 
 #include "tools/input.h"
+#include "tools/cpu_profiler.h"
 
 #include "imgui_dx12/imgui.h"
 #include "imgui_dx12/imgui_impl_win32.h"
@@ -99,6 +100,7 @@ int  WINAPI  WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				break;
 
 			app.render();
+			CpuProfiler::Instance().endFrame();
 
 			Input::Instance().Updata();
 		}
@@ -1,5 +1,7 @@
 #include "resource_manager.h"
 
+#include "tools/cpu_profiler.h"
+
 
 int ResourceManager::createBackBuffer(ID3D12Device* device, IDXGISwapChain3* swapchain, UINT backBufferCount) {
 	int id = m_uniqueId;
@@ -255,6 +257,7 @@ int ResourceManager::addComputeShader(const wchar_t* filename) {
 
 
 void ResourceManager::updateDescriptorHeap(Device* device, int globalHeapCount) {
+	CPU_PROFILE_SCOPE("updateDescriptorHeap");
 
 	m_globalHeap.create(device->getDevice(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, globalHeapCount);
 
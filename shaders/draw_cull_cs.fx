@@ -0,0 +1,107 @@
+
+
+#include "hiz_common.hlsli"
+
+// same layouts as tools/draw_culler.h.
+struct DrawInstance {
+	float3 boundsMin;
+	uint indexCount;
+	float3 boundsMax;
+	uint indexOffset;
+	int vertexOffset;
+	uint closureId;
+	uint instanceOffset;
+	uint instanceCount;
+};
+
+// the root constants of vs.fx and ps.fx followed by D3D12_DRAW_INDEXED_ARGUMENTS.
+struct IndirectDrawCommand {
+	uint drawId;
+	uint closureId;
+	uint indexCountPerInstance;
+	uint instanceCount;
+	uint startIndexLocation;
+	int baseVertexLocation;
+	uint startInstanceLocation;
+};
+
+// the bounds are in model space.
+cbuffer CullConstant : register(b0) {
+	float4x4 WorldViewProj;
+	float4 FrustumPlanes[6];
+	uint DrawCount;
+}
+
+// same values as CullPhase in tools/draw_culler.h.
+static const uint CullPhaseFrustum = 0;
+static const uint CullPhaseEarly = 1;
+static const uint CullPhaseLate = 2;
+
+// frustum only culls every draw. the two phase occlusion culling runs early, which keeps the draws visible last
+// frame, then late against the pyramid built from the early draws, which keeps the draws that became visible and
+// remembers the visible set for the next frame.
+cbuffer CullPhaseConstant : register(b1) {
+	uint CullPhase;
+}
+
+StructuredBuffer<DrawInstance> drawInstances : register(t0);
+RWStructuredBuffer<IndirectDrawCommand> drawCommands : register(u0);
+// reset to zero by the application before the dispatch, read as the count of ExecuteIndirect.
+RWStructuredBuffer<uint> drawCommandCount : register(u1);
+// one flag per draw, whether the late phase of the last frame found it visible.
+RWStructuredBuffer<uint> drawVisibility : register(u2);
+// built by hiz_build_cs.fx between the phases, only read by the late phase.
+Texture2D<float> hiZ : register(t1);
+
+bool isVisible(float3 boundsMin, float3 boundsMax) {
+	float3 center = (boundsMin + boundsMax) * 0.5f;
+	float3 extent = (boundsMax - boundsMin) * 0.5f;
+
+	[unroll]
+	for (uint i = 0; i < 6; i++) {
+		if (dot(FrustumPlanes[i].xyz, center) + FrustumPlanes[i].w + dot(abs(FrustumPlanes[i].xyz), extent) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+[numthreads(64,1,1)]
+void main(uint3 globalThreadId : SV_DispatchThreadID) {
+	const uint DrawId = globalThreadId.x;
+	if (DrawId >= DrawCount)
+		return;
+
+	DrawInstance instance = drawInstances[DrawId];
+	if (!isVisible(instance.boundsMin, instance.boundsMax)) {
+		if (CullPhase == CullPhaseLate)
+			drawVisibility[DrawId] = 0;
+		return;
+	}
+
+	if (CullPhase == CullPhaseEarly) {
+		if (drawVisibility[DrawId] == 0)
+			return;
+	}
+	else if (CullPhase == CullPhaseLate) {
+		bool wasVisible = drawVisibility[DrawId] != 0;
+		bool isVisibleNow = !isOccluded(hiZ, WorldViewProj, instance.boundsMin, instance.boundsMax);
+		drawVisibility[DrawId] = isVisibleNow ? 1 : 0;
+
+		// the early phase drew it already.
+		if (wasVisible || !isVisibleNow)
+			return;
+	}
+
+	IndirectDrawCommand command;
+	command.drawId = DrawId;
+	command.closureId = instance.closureId;
+	command.indexCountPerInstance = instance.indexCount;
+	command.instanceCount = instance.instanceCount;
+	command.startIndexLocation = instance.indexOffset;
+	command.baseVertexLocation = instance.vertexOffset;
+	command.startInstanceLocation = instance.instanceOffset;
+
+	uint index;
+	InterlockedAdd(drawCommandCount[0], 1, index);
+	drawCommands[index] = command;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+
+
+#include "hiz_common.hlsli"
+
+// the whole pyramid in one dispatch of (HiZSize / HiZTileSize)^2 groups. every group reduces its tile of mip 0 down
+// to one texel of HiZTileMip, the last group to finish reduces that mip down to 1x1.
+
+Texture2D<float> depthBuffer : register(t0);
+globallycoherent RWTexture2D<float> hiZMips[HiZMipCount] : register(u0);
+// counts the finished groups, set back to zero by the last one.
+globallycoherent RWStructuredBuffer<uint> hiZGroupCounter : register(u11);
+
+groupshared float tileDepth[16][16];
+groupshared uint isLastGroup;
+
+float loadFootprint(uint2 texel, uint2 depthSize) {
+	uint2 begin;
+	uint2 end;
+	getDepthFootprint(texel, depthSize, begin, end);
+
+	float farthest = 0.0f;
+	for (uint y = begin.y; y < end.y; y++) {
+		for (uint x = begin.x; x < end.x; x++)
+			farthest = max(farthest, depthBuffer.Load(int3(x, y, 0)));
+	}
+	return farthest;
+}
+
+// reduces the 2 * size square in tileDepth to size, writing the result to mip at origin + thread.
+void reduceTile(uint2 localId, uint2 origin, uint mip, uint size) {
+	float farthest = 0.0f;
+	if (all(localId < size)) {
+		uint2 source = localId * 2;
+		farthest = max(
+			max(tileDepth[source.y][source.x], tileDepth[source.y][source.x + 1]),
+			max(tileDepth[source.y + 1][source.x], tileDepth[source.y + 1][source.x + 1]));
+		hiZMips[mip][origin + localId] = farthest;
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (all(localId < size))
+		tileDepth[localId.y][localId.x] = farthest;
+
+	GroupMemoryBarrierWithGroupSync();
+}
+
+[numthreads(16,16,1)]
+void main(uint3 localId : SV_GroupThreadID, uint3 groupId : SV_GroupID) {
+	const uint GroupCount = (HiZSize / HiZTileSize) * (HiZSize / HiZTileSize);
+
+	uint2 depthSize;
+	depthBuffer.GetDimensions(depthSize.x, depthSize.y);
+
+	// every thread owns 4x4 texels of mip 0 and reduces them to 2x2 of mip 1 and one of mip 2.
+	float mip2 = 0.0f;
+	[unroll]
+	for (uint i = 0; i < 4; i++) {
+		uint2 texel1 = groupId.xy * (HiZTileSize / 2) + localId.xy * 2 + uint2(i & 1, i >> 1);
+
+		float mip1 = 0.0f;
+		[unroll]
+		for (uint j = 0; j < 4; j++) {
+			uint2 texel0 = texel1 * 2 + uint2(j & 1, j >> 1);
+			float depth = loadFootprint(texel0, depthSize);
+			hiZMips[0][texel0] = depth;
+			mip1 = max(mip1, depth);
+		}
+
+		hiZMips[1][texel1] = mip1;
+		mip2 = max(mip2, mip1);
+	}
+
+	hiZMips[2][groupId.xy * (HiZTileSize / 4) + localId.xy] = mip2;
+	tileDepth[localId.y][localId.x] = mip2;
+
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for (uint mip = 3, size = 8; mip <= HiZTileMip; mip++, size >>= 1)
+		reduceTile(localId.xy, groupId.xy * size, mip, size);
+
+	// the texel of HiZTileMip has to reach memory before the counter says this group is done.
+	if (all(localId.xy == 0)) {
+		DeviceMemoryBarrier();
+
+		uint finishedCount;
+		InterlockedAdd(hiZGroupCounter[0], 1, finishedCount);
+		isLastGroup = finishedCount == GroupCount - 1 ? 1 : 0;
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (isLastGroup == 0)
+		return;
+
+	DeviceMemoryBarrier();
+
+	// HiZTileMip is 16x16, one texel per thread.
+	tileDepth[localId.y][localId.x] = hiZMips[HiZTileMip][localId.xy];
+
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for (uint level = HiZTileMip + 1, levelSize = 8; level < HiZMipCount; level++, levelSize >>= 1)
+		reduceTile(localId.xy, uint2(0, 0), level, levelSize);
+
+	if (all(localId.xy == 0))
+		hiZGroupCounter[0] = 0;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef HIZ_COMMON_HLSLI
+#define HIZ_COMMON_HLSLI
+
+// hierarchical z pyramid of the visibility pass depth. tools/hiz_pyramid.h mirrors these values and functions.
+//
+// mip 0 is a square of HiZSize texels stretched over the whole depth buffer, every texel holds the farthest depth
+// of the depth texels it overlaps, every following mip the farthest of its 2x2 texels.
+
+static const uint HiZSize = 1024;
+static const uint HiZMipCount = 11;
+// texels of mip 0 one group of hiz_build_cs.fx reduces down to a single texel of mip 6.
+static const uint HiZTileSize = 64;
+static const uint HiZTileMip = 6;
+// bounds whose nearest depth is within this of the pyramid stay visible, so draws never hide themselves.
+static const float HiZDepthBias = 1e-5f;
+static const float HiZMinClipW = 1e-5f;
+
+// depth texels under a texel of mip 0, end exclusive.
+void getDepthFootprint(uint2 texel, uint2 depthSize, out uint2 begin, out uint2 end) {
+	begin = texel * depthSize / HiZSize;
+	end = min(((texel + 1) * depthSize + HiZSize - 1) / HiZSize, depthSize);
+}
+
+// true when the bounds are behind every texel of the pyramid under their screen rectangle. bounds reaching behind
+// the near plane are never occluded.
+bool isOccluded(Texture2D<float> hiZ, float4x4 worldViewProj, float3 boundsMin, float3 boundsMax) {
+	float2 uvMin = 1e30f;
+	float2 uvMax = -1e30f;
+	float nearest = 1.0f;
+
+	[unroll]
+	for (uint i = 0; i < 8; i++) {
+		float3 corner = float3((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+		float4 clip = mul(worldViewProj, float4(corner, 1.0f));
+		if (clip.w < HiZMinClipW)
+			return false;
+
+		float3 ndc = clip.xyz / clip.w;
+		float2 uv = float2(ndc.x * 0.5f + 0.5f, 0.5f - ndc.y * 0.5f);
+		uvMin = min(uvMin, uv);
+		uvMax = max(uvMax, uv);
+		nearest = min(nearest, ndc.z);
+	}
+
+	if (any(uvMin > 1.0f) || any(uvMax < 0.0f))
+		return false;
+	uvMin = saturate(uvMin);
+	uvMax = saturate(uvMax);
+
+	// the first mip where the rectangle is at most one texel wide, so it touches at most 2x2 texels.
+	float2 size = (uvMax - uvMin) * HiZSize;
+	uint mip = min((uint)ceil(log2(max(max(size.x, size.y), 1.0f))), HiZMipCount - 1);
+
+	uint2 texelMin;
+	uint2 texelMax;
+	[loop]
+	for (;;) {
+		uint levelSize = HiZSize >> mip;
+		texelMin = min((uint2)(uvMin * levelSize), levelSize - 1);
+		texelMax = min((uint2)(uvMax * levelSize), levelSize - 1);
+		if (all(texelMax - texelMin <= 1) || mip == HiZMipCount - 1)
+			break;
+		mip++;
+	}
+
+	float farthest = max(
+		max(hiZ.Load(int3(texelMin.x, texelMin.y, mip)), hiZ.Load(int3(texelMax.x, texelMin.y, mip))),
+		max(hiZ.Load(int3(texelMin.x, texelMax.y, mip)), hiZ.Load(int3(texelMax.x, texelMax.y, mip))));
+
+	return farthest < nearest - HiZDepthBias;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+
+
+#include "material_common.hlsli"
+
+RWStructuredBuffer<uint> closureTileCounts : register(u0);
+RWStructuredBuffer<uint> closureTileOffsets : register(u1);
+RWStructuredBuffer<uint> closureTileCursors : register(u2);
+RWStructuredBuffer<uint> materialArguments : register(u3);
+
+groupshared uint offsets[NumClosures + 1];
+
+// a single group. turns the tile counts into the exclusive prefix sum, writes the indirect arguments of the sort
+// and shading passes and resets the counters for the next frame.
+[numthreads(32,1,1)]
+void main(uint3 localId : SV_GroupThreadID) {
+	const uint c = localId.x;
+
+	if (c == 0) {
+		uint sum = 0;
+		for (uint i = 0; i < NumClosures; i++) {
+			offsets[i] = sum;
+			sum += closureTileCounts[i];
+		}
+		offsets[NumClosures] = sum;
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (c < NumClosures) {
+		uint base = c * ClosureArgumentStride;
+		closureTileOffsets[c] = offsets[c];
+		closureTileCursors[c] = offsets[c];
+
+		materialArguments[base + 0] = offsets[c];
+		materialArguments[base + 1] = c;
+		materialArguments[base + 2] = offsets[c + 1] - offsets[c];
+		materialArguments[base + 3] = 1;
+		materialArguments[base + 4] = 1;
+
+		closureTileCounts[c] = 0;
+	}
+	else if (c == NumClosures) {
+		closureTileOffsets[NumClosures] = offsets[NumClosures];
+
+		materialArguments[SortArgumentOffset + 0] = (offsets[NumClosures] + SortThreadCount - 1) / SortThreadCount;
+		materialArguments[SortArgumentOffset + 1] = 1;
+		materialArguments[SortArgumentOffset + 2] = 1;
+
+		closureTileCounts[NumClosures] = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef MATERIAL_COMMON_HLSLI
+#define MATERIAL_COMMON_HLSLI
+
+// shared by the visibility buffer passes. tools/material_classifier.h mirrors these values.
+
+static const uint TileSizeX = 16;
+static const uint TileSizeY = 8;
+static const uint PixelPerTile = TileSizeX * TileSizeY;
+static const uint NumClosures = 22;
+
+// visibility buffer texel: x = primitive id, y = (instance id << ClosureIdBits) | closure id.
+// the clear value leaves the closure id at ClosureIdMask, which is background.
+static const uint ClosureIdBits = 8;
+static const uint ClosureIdMask = (1 << ClosureIdBits) - 1;
+
+// material argument buffer. one record per closure: tile offset and closure id (root constants of the shading
+// pass) followed by D3D12_DISPATCH_ARGUMENTS. the dispatch arguments of the sort pass follow the last record.
+static const uint ClosureArgumentStride = 5;
+static const uint SortArgumentOffset = NumClosures * ClosureArgumentStride;
+static const uint MaterialArgumentCount = SortArgumentOffset + 3;
+
+static const uint SortThreadCount = 64;
+
+struct WorkItem {
+	uint tile;
+	uint closureId;
+};
+
+// one node's reference to a mesh, the instances of a draw follow each other from its instance offset.
+struct InstanceData {
+	float4x4 world;
+	uint drawId;
+	uint materialIndex;
+	uint2 padding;
+};
+
+uint2 packVisibility(uint instanceId, uint closureId, uint primitiveId) {
+	return uint2(primitiveId, (instanceId << ClosureIdBits) | closureId);
+}
+
+uint getClosureId(uint2 visibility) {
+	return visibility.y & ClosureIdMask;
+}
+
+uint getInstanceId(uint2 visibility) {
+	return visibility.y >> ClosureIdBits;
+}
+
+uint getPrimitiveId(uint2 visibility) {
+	return visibility.x;
+}
+
+uint makeTile(uint2 tile) {
+	return (tile.y << 16) | tile.x;
+}
+
+uint2 getTile(uint tile) {
+	return uint2(tile & 0xffff, tile >> 16);
+}
+
+#endif
\ No newline at end of file
@@ -1,60 +1,47 @@
 
 
-static const uint TileSizeX = 16;
-static const uint TileSizeY = 8;
-static const uint PixelPerTile = 128;
-static const uint SamplesPerPixel = 4;
-static const uint InstanceIdMask = 1023;
-static const uint InstanceIdBits = 10;
-static const uint NumClosures = 22;
-
-cbuffer SystemConstant : register(b0) {
-	int2 ImageSize;
-}
-
-struct WorkItem {
-	uint tile;
-	uint closureId;
-};
+#include "material_common.hlsli"
 
 Texture2D<uint2> visibilityBuffer : register(t0);
-RWStructuredBuffer<uint4> closureToTileCountMap : register(u0);
-AppendStructuredBuffer<WorkItem> jobList : register(u1);
+// NumClosures tile counters followed by the work item counter. cleared again by material_args_cs.fx.
+RWStructuredBuffer<uint> closureTileCounts : register(u0);
+RWStructuredBuffer<WorkItem> workItems : register(u1);
+
+groupshared uint tileMask;
 
-groupshared uint scoreboard[NumClosures];
 [numthreads(TileSizeX,TileSizeY,1)]
-void main(uint3 localId : SV_GroupThreadID, uint3 globalId : SV_DispatchThreadID) {
+void main(uint3 localId : SV_GroupThreadID, uint3 groupId : SV_GroupID, uint3 globalId : SV_DispatchThreadID) {
 	const uint2 MyPixel = globalId.xy;
-	const uint TileIndex = ((MyPixel.y / TileSizeY) << 16) | (MyPixel.x / TileSizeX);
 	const uint LocalThreadId = localId.x + localId.y * TileSizeX;
-	
-	if (LocalThreadId == 0) {
-		[unroll]
-		for (int i = 0; i < NumClosures; i++)
-			scoreboard[i] = 0;
-	}
-	
+
+	uint2 imageSize;
+	visibilityBuffer.GetDimensions(imageSize.x, imageSize.y);
+
+	if (LocalThreadId == 0)
+		tileMask = 0;
+
 	GroupMemoryBarrierWithGroupSync();
-	
-	uint r = visibilityBuffer.Load(uint3(MyPixel, 0));
-	[unroll]
-	for (uint a = 0; a < SamplesPerPixel; a++) {
-		uint instanceId = visibilityBuffer.Load(uint3(MyPixel, a)).y;
-		scoreboard[instanceId] = 1;
+
+	if (all(MyPixel < imageSize)) {
+		uint closureId = getClosureId(visibilityBuffer.Load(uint3(MyPixel, 0)));
+		if (closureId < NumClosures)
+			InterlockedOr(tileMask, 1u << closureId);
 	}
-	
+
 	GroupMemoryBarrierWithGroupSync();
+
+	// one thread per closure emits the work item of this tile.
 	uint c = LocalThreadId;
-	while (c < NumClosures) {
-		[branch]
-		if (scoreboard[c] > 0) {
-			uint x;
-			InterlockedAdd(closureToTileCountMap[c].x, 1, x);
-			WorkItem item;
-			item.tile = TileIndex;
-			item.closureId = c;
-			jobList.Append(item);
-		}
-		c += PixelPerTile;
+	[branch]
+	if (c < NumClosures && (tileMask & (1u << c)) != 0) {
+		InterlockedAdd(closureTileCounts[c], 1);
+
+		uint index;
+		InterlockedAdd(closureTileCounts[NumClosures], 1, index);
+
+		WorkItem item;
+		item.tile = makeTile(groupId.xy);
+		item.closureId = c;
+		workItems[index] = item;
 	}
 }
\ No newline at end of file
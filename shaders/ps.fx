@@ -1,7 +1,11 @@
 
 
-Texture2D albedoTex : register(t0);
-SamplerState wrapSampler : register(s0);
+#include "material_common.hlsli"
+
+cbuffer DrawConstant : register(b1) {
+	uint DrawId;
+	uint ClosureId;
+}
 
 
 struct PS_IN {
@@ -10,9 +14,10 @@ struct PS_IN {
 	float3 tan : TANGNET0;
 	float3 binor : BINORMAL0;
 	float2 tex : TEXCOORD0;
+	nointerpolation uint instance : INSTANCE0;
 };
 
-float4 main(PS_IN input) : SV_Target0 {
-	//return float4(input.tex, 0.0f, 0.0f);
-	return albedoTex.Sample(wrapSampler, input.tex);
+// the visibility buffer only stores which triangle covers the pixel. materials are shaded per closure by rendering_cs.fx.
+uint2 main(PS_IN input, uint primitiveId : SV_PrimitiveID) : SV_Target0 {
+	return packVisibility(input.instance, ClosureId, primitiveId);
 }
\ No newline at end of file
@@ -1,169 +1,210 @@
 
 
-static const uint SuperSampledAA = 100;
-static const uint TriangleSampledAA = 200;
-static const uint StencilAA = 440;
-static const uint WireframeAA = 450;
-
-static const uint AAMode = SuperSampledAA;
-
-static const float MipMapLodBias = 0.5f;
-static const uint SamplesPerPixel = 4;
-static const float InvSpp = 0.25f;
-static const uint TileSize = 128;
-static const uint TileSizeX = 16;
-static const uint TileSizeY = 8;
-static const uint InstanceIdMask = 1023;
-static const uint InstanceIdBits = 0;
-static const uint MaxShadingSamplesPerTile = 512;
-
-
-struct VertexInput
-{
-   float4 position  ;
-   float4 tangent   ;
-   float4 bitangent ;
-   float4 texCoord  ;
+#include "material_common.hlsli"
+
+// set per closure by the application. every closure is one combination of these features.
+#ifndef VISIBILITY_DEBUG
+#define VISIBILITY_DEBUG 0
+#endif
+
+#ifndef HAS_ALBEDO_MAP
+#define HAS_ALBEDO_MAP 0
+#endif
+
+#ifndef HAS_NORMAL_MAP
+#define HAS_NORMAL_MAP 0
+#endif
+
+#ifndef HAS_ROUGH_METAL_MAP
+#define HAS_ROUGH_METAL_MAP 0
+#endif
+
+static const uint InvalidTexture = 0xffffffff;
+
+
+struct Vertex {
+	float3 pos;
+	float3 nor;
+	float3 tan;
+	float2 tex;
 };
 
-struct VertexOutput
-{
-   float4 position  ;
-   float4 tangent   ;
-   float4 bitangent ;
-   float4 texCoord  ;
+struct DrawData {
+	uint indexOffset;
+	uint vertexOffset;
+	uint materialIndex;
+	uint closureId;
+};
 
-   float4 clipSpacePosition : SV_POSITION;
+struct MaterialData {
+	uint albedoTexture;
+	uint normalTexture;
+	uint roughMetalTexture;
+	uint padding;
 };
 
-cbuffer __SystemConstant : register(b0) {
-	matrix InvViewProjMatrix;
-	matrix ViewMatrix;
-	float4 WorldSpaceCameraPosition;
-	uint2 ImageSize;
-	float isVB;
-	uint ShaderId;
-	matrix Padding2;
-	float4x2 Padding3;
+struct Barycentrics {
+	float3 lambda;
+	float3 ddx;
+	float3 ddy;
+};
+
+cbuffer MatrixBuffer : register(b0) {
+	float4x4 View;
+	float4x4 Proj;
+	float4x4 World;
+	float4 LightDirection;
+}
+
+// written by material_args_cs.fx into the argument buffer and set by ExecuteIndirect.
+cbuffer ClosureConstant : register(b1) {
+	uint TileOffset;
+	uint ClosureId;
 }
 
 Texture2D<uint2> visibilityBuffer : register(t0);
-StructuredBuffer<VertexInput> vertexBuffer : register(t1);
+StructuredBuffer<Vertex> vertexBuffer : register(t1);
 StructuredBuffer<uint> indexBuffer : register(t2);
-StructuredBuffer<uint4> instanceToIndexMap : register(t3);
-Texture2D<float4> albedoTexture[] : register(t4);
+StructuredBuffer<DrawData> drawBuffer : register(t3);
+StructuredBuffer<MaterialData> materialBuffer : register(t4);
+StructuredBuffer<uint> sortedTiles : register(t5);
+StructuredBuffer<InstanceData> instanceBuffer : register(t6);
+Texture2D<float4> materialTextures[] : register(t0, space1);
 SamplerState wrapSampler : register(s0);
 
 RWTexture2D<float4> resultTex : register(u0);
 
-VertexInput __loadVertex(uint bufferIndex)
-{
-   VertexInput vIn;
-   vIn.position  = vertexBuffer[bufferIndex].position;
-   vIn.tangent   = vertexBuffer[bufferIndex].tangent;
-   vIn.bitangent = vertexBuffer[bufferIndex].bitangent;
-	
-	
-	
-   vIn.texCoord = vertexBuffer[bufferIndex].texCoord;
-
-   return vIn;
-}
 
-float3 __intersect(float3 p0, float3 p1, float3 p2, float3 o, float3 d)
-{
-   float3 eo =  o - p0;
-   float3 e2 = p2 - p0;
-   float3 e1 = p1 - p0;
-   float3 r  = cross(d, e2);
-   float3 s  = cross(eo, e1);
-   float iV  = 1.0f / dot(r, e1);
-   float V1  = dot(r, eo);
-   float V2  = dot(s,  d);
-   float b   = V1 * iV;
-   float c   = V2 * iV;
-   float a   = 1.0f - b - c;
-   return float3(a, b, c);
+// perspective correct barycentrics of the pixel and their screen space derivatives, from the clip space positions.
+Barycentrics computeBarycentrics(float4 p0, float4 p1, float4 p2, float2 ndc, float2 ndcPerPixel) {
+	float3 invW = 1.0f / float3(p0.w, p1.w, p2.w);
+
+	float2 n0 = p0.xy * invW.x;
+	float2 n1 = p1.xy * invW.y;
+	float2 n2 = p2.xy * invW.z;
+
+	float invDet = 1.0f / determinant(float2x2(n2 - n1, n0 - n1));
+	float3 ddx = float3(n1.y - n2.y, n2.y - n0.y, n0.y - n1.y) * invDet * invW;
+	float3 ddy = float3(n2.x - n1.x, n0.x - n2.x, n1.x - n0.x) * invDet * invW;
+	float ddxSum = dot(ddx, float3(1.0f, 1.0f, 1.0f));
+	float ddySum = dot(ddy, float3(1.0f, 1.0f, 1.0f));
+
+	float2 delta = ndc - n0;
+	float interpInvW = invW.x + delta.x * ddxSum + delta.y * ddySum;
+	float interpW = 1.0f / interpInvW;
+
+	Barycentrics result;
+	result.lambda.x = interpW * (invW.x + delta.x * ddx.x + delta.y * ddy.x);
+	result.lambda.y = interpW * (delta.x * ddx.y + delta.y * ddy.y);
+	result.lambda.z = interpW * (delta.x * ddx.z + delta.y * ddy.z);
+
+	ddx *= ndcPerPixel.x;
+	ddy *= ndcPerPixel.y;
+	ddxSum *= ndcPerPixel.x;
+	ddySum *= ndcPerPixel.y;
+
+	float interpWx = 1.0f / (interpInvW + ddxSum);
+	float interpWy = 1.0f / (interpInvW + ddySum);
+	result.ddx = interpWx * (result.lambda * interpInvW + ddx) - result.lambda;
+	result.ddy = interpWy * (result.lambda * interpInvW + ddy) - result.lambda;
+
+	return result;
 }
 
-VertexInput __loadAndInterpolateVertex(uint tID, uint iId, float2 pixelCoord, out float filterWidth)
-{
-   uint indexOffset = indexOffsetBuffer[iId].indexOffset;
-   uint index0 = indexBuffer[ tID * 3 + 0 + indexOffset ];
-   uint index1 = indexBuffer[ tID * 3 + 1 + indexOffset ];
-   uint index2 = indexBuffer[ tID * 3 + 2 + indexOffset ];
-
-   VertexInput v0 = __loadVertex( index0 );
-   VertexInput v1 = __loadVertex( index1 );
-   VertexInput v2 = __loadVertex( index2 );
-   
-   v0.position = mul(v0.position, ViewMatrix);
-   v1.position = mul(v1.position, ViewMatrix);
-   v2.position = mul(v2.position, ViewMatrix);
-   
-   //v0.tangent.xyz = normalize(v0.tangent.xyz + v1.tangent.xyz + v2.tangent.xyz);
-   
-      
-   float4 d = float4(pixelCoord / ImageSize.xy * float2(2.0f, -2.0f) - float2(1.0f, -1.0f), 0.1f, 1.0f);
-   d = mul(d, InvViewProjMatrix);
-   d /= d.w;
-   
-   d = normalize(d);
-      
-   float4 p0 = v0.position;
-   float4 p1 = v1.position;
-   float4 p2 = v2.position;
-
-   /// Compute the barycentric coordinates
-   float3 H  = __intersect(p0.xyz, p1.xyz, p2.xyz, float3(0.0f, 0.0f, 0.0f), d.xyz);
-
-   VertexInput vIn;
-   vIn.position  = mad(v0.position,  H.x, mad(v1.position,  H.y, (v2.position  * H.z)));
-   vIn.tangent   = mad(v0.tangent,   H.x, mad(v1.tangent,   H.y, (v2.tangent   * H.z)));
-   vIn.bitangent = mad(v0.bitangent, H.x, mad(v1.bitangent, H.y, (v2.bitangent * H.z)));
-   vIn.texCoord  = mad(v0.texCoord,  H.x, mad(v1.texCoord,  H.y, (v2.texCoord  * H.z)));
-	
-	
-   return vIn;
+float3 interpolate(float3 a0, float3 a1, float3 a2, float3 lambda) {
+	return a0 * lambda.x + a1 * lambda.y + a2 * lambda.z;
 }
 
+float2 interpolate(float2 a0, float2 a1, float2 a2, float3 lambda) {
+	return a0 * lambda.x + a1 * lambda.y + a2 * lambda.z;
+}
 
+float3 debugColor(uint id) {
+	uint hash = id * 2654435761u;
+	return float3(hash & 0xff, (hash >> 8) & 0xff, (hash >> 16) & 0xff) / 255.0f;
+}
 
 
-[numthreads(16,8,1)]
-void main(uint3 globalThreadId : SV_DispatchThreadID,
-	uint3 tileThreadId : SV_GroupThreadID,
-	uint3 groupId : SV_GroupID) {
-	
-	const uint2 PixelCoord = uint2(globalThreadId.xy
-	);
-	
-	const uint PixelIndex = PixelCoord.x + ImageSize.x * PixelCoord.y;
-	uint groupThreadId = tileThreadId.x + tileThreadId.y * TileSizeX;
-	
-	uint2 vData = visibilityBuffer[PixelCoord];
-	uint tId = vData.y;
-	uint iId = vData.x;
-	uint sId = instanceToIndexMap[iId];
-	//if (sId > 10) return;
-	
-	float2 ImageCoord = float2(PixelCoord.x + 0.5f, PixelCoord.y + 0.5f) / ImageSize;
-	float FilterWidth = 1.0f;
-	
-	VertexInput vIn = __loadAndInterpolateVertex(tId, iId, (float2)PixelCoord, FilterWidth);
-	
-	//resultTex[PixelCoord] = float4((float2)vData / 100000.0f, 0.0f, 1.0f);
-	
-	float intensity = saturate(dot(normalize(float3(1, 1, 1)), vIn.tangent.xyz)) * 0.5f + 0.5f;
-	intensity *= intensity;
-	
-	resultTex[PixelCoord] = float4((float)(iId % 8) / 8.0f, 0.0f, 0.0f, 0.0f);
-	//resultTex[PixelCoord] = float4(intensity, intensity, intensity, 1.0f);
-	
-	float4 color = albedoTexture[sId].SampleLevel(wrapSampler, vIn.texCoord.xy, 0);
-	
-	if (isVB > 0.0f)
-		color = float4((float)(tId % 128) / 128.0f, (float)(iId % 128) / 128.0f, 0.0f, 0.0f);
-	
-	resultTex[PixelCoord] = color;
+// one group per tile of the closure. pixels of other closures in the tile are left to their own dispatch.
+[numthreads(TileSizeX, TileSizeY, 1)]
+void main(uint3 localId : SV_GroupThreadID, uint3 groupId : SV_GroupID) {
+	const uint2 PixelCoord = getTile(sortedTiles[TileOffset + groupId.x]) * uint2(TileSizeX, TileSizeY) + localId.xy;
+
+	uint2 imageSize;
+	visibilityBuffer.GetDimensions(imageSize.x, imageSize.y);
+	if (any(PixelCoord >= imageSize))
+		return;
+
+	uint2 visibility = visibilityBuffer[PixelCoord];
+	if (getClosureId(visibility) != ClosureId)
+		return;
+
+	InstanceData instance = instanceBuffer[getInstanceId(visibility)];
+	DrawData draw = drawBuffer[instance.drawId];
+	uint primitiveId = getPrimitiveId(visibility);
+
+#if VISIBILITY_DEBUG
+	resultTex[PixelCoord] = float4(debugColor(getInstanceId(visibility)) * 0.5f + debugColor(primitiveId) * 0.5f, 1.0f);
+	return;
+#endif
+
+	uint indexBase = draw.indexOffset + primitiveId * 3;
+	Vertex v0 = vertexBuffer[indexBuffer[indexBase + 0] + draw.vertexOffset];
+	Vertex v1 = vertexBuffer[indexBuffer[indexBase + 1] + draw.vertexOffset];
+	Vertex v2 = vertexBuffer[indexBuffer[indexBase + 2] + draw.vertexOffset];
+
+	// same transform as vs.fx.
+	float4x4 world = mul(World, instance.world);
+	float4x4 worldViewProj = mul(Proj, mul(View, world));
+	float4 p0 = mul(worldViewProj, float4(v0.pos, 1.0f));
+	float4 p1 = mul(worldViewProj, float4(v1.pos, 1.0f));
+	float4 p2 = mul(worldViewProj, float4(v2.pos, 1.0f));
+
+	float2 ndcPerPixel = float2(2.0f, -2.0f) / (float2)imageSize;
+	float2 ndc = ((float2)PixelCoord + 0.5f) * ndcPerPixel + float2(-1.0f, 1.0f);
+	Barycentrics bary = computeBarycentrics(p0, p1, p2, ndc, ndcPerPixel);
+
+	float2 uv = interpolate(v0.tex, v1.tex, v2.tex, bary.lambda);
+	float2 uvDdx = interpolate(v0.tex, v1.tex, v2.tex, bary.ddx);
+	float2 uvDdy = interpolate(v0.tex, v1.tex, v2.tex, bary.ddy);
+
+	float3 normal = normalize(mul((float3x3)world, interpolate(v0.nor, v1.nor, v2.nor, bary.lambda)));
+
+	MaterialData material = materialBuffer[instance.materialIndex];
+
+	float4 albedo = float4(1.0f, 1.0f, 1.0f, 1.0f);
+#if HAS_ALBEDO_MAP
+	albedo = materialTextures[NonUniformResourceIndex(material.albedoTexture)].SampleGrad(wrapSampler, uv, uvDdx, uvDdy);
+#endif
+
+#if HAS_NORMAL_MAP
+	float3 tangent = normalize(mul((float3x3)world, interpolate(v0.tan, v1.tan, v2.tan, bary.lambda)));
+	float3 binormal = cross(normal, tangent);
+	float3 normalSample = materialTextures[NonUniformResourceIndex(material.normalTexture)].SampleGrad(wrapSampler, uv, uvDdx, uvDdy).xyz * 2.0f - 1.0f;
+	normal = normalize(tangent * normalSample.x + binormal * normalSample.y + normal * normalSample.z);
+#endif
+
+	// gltf packs roughness in g and metalness in b.
+	float roughness = 1.0f;
+	float metalness = 0.0f;
+#if HAS_ROUGH_METAL_MAP
+	float4 roughMetal = materialTextures[NonUniformResourceIndex(material.roughMetalTexture)].SampleGrad(wrapSampler, uv, uvDdx, uvDdy);
+	roughness = roughMetal.g;
+	metalness = roughMetal.b;
+#endif
+
+	float3 viewNormal = normalize(mul((float3x3)View, normal));
+	float3 viewLight = normalize(mul((float3x3)View, -LightDirection.xyz));
+	float3 viewPosition = mul(View, mul(world, float4(interpolate(v0.pos, v1.pos, v2.pos, bary.lambda), 1.0f))).xyz;
+	float3 viewDirection = normalize(-viewPosition);
+	float3 halfVector = normalize(viewLight + viewDirection);
+
+	float diffuse = saturate(dot(viewNormal, viewLight)) * 0.8f + 0.2f;
+	float shininess = exp2(10.0f * (1.0f - roughness) + 1.0f);
+	float specular = pow(saturate(dot(viewNormal, halfVector)), shininess) * (1.0f - roughness);
+	float3 specularColor = lerp(float3(0.04f, 0.04f, 0.04f), albedo.rgb, metalness);
+
+	float3 color = albedo.rgb * (1.0f - metalness) * diffuse + specularColor * specular;
+
+	resultTex[PixelCoord] = float4(color, 1.0f);
 }
\ No newline at end of file
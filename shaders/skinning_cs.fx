@@ -0,0 +1,56 @@
+
+
+#define SKINNING_THREAD_COUNT 64
+
+// same layout as the vertex buffer of tools/model.cpp.
+struct Vertex {
+	float3 pos;
+	float3 nor;
+	float3 tan;
+	float2 tex;
+};
+
+// same layout as tools/skinning.h, four 16 bit joints then four 8 bit weights.
+struct SkinVertex {
+	uint joints01;
+	uint joints23;
+	uint weights;
+};
+
+cbuffer SkinningConstant : register(b0) {
+	uint VertexCount;
+}
+
+StructuredBuffer<Vertex> vertexBuffer : register(t0);
+StructuredBuffer<SkinVertex> skinVertices : register(t1);
+// Model::computeSkinMatrices of the frame.
+StructuredBuffer<float4x4> skinMatrices : register(t2);
+// read by the visibility pass as its vertex buffer and by the shading pass like vertexBuffer.
+RWStructuredBuffer<Vertex> skinnedVertices : register(u0);
+
+// linear blend skinning like skinLinear in tools/skinning.cpp, which validates it. the normals and tangents are
+// transformed without the inverse transpose like vs.fx does.
+[numthreads(SKINNING_THREAD_COUNT, 1, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID) {
+	if (dispatchId.x >= VertexCount)
+		return;
+
+	Vertex v = vertexBuffer[dispatchId.x];
+	SkinVertex skin = skinVertices[dispatchId.x];
+
+	uint4 joints = uint4(skin.joints01 & 0xffff, skin.joints01 >> 16, skin.joints23 & 0xffff, skin.joints23 >> 16);
+	float4 weights = float4(skin.weights & 0xff, (skin.weights >> 8) & 0xff, (skin.weights >> 16) & 0xff, skin.weights >> 24) / 255.0f;
+
+	float4x4 skinMatrix = skinMatrices[joints.x] * weights.x;
+	[unroll]
+	for (uint i = 1; i < 4; i++) {
+		if (weights[i] > 0.0f)
+			skinMatrix += skinMatrices[joints[i]] * weights[i];
+	}
+
+	v.pos = mul(skinMatrix, float4(v.pos, 1.0f)).xyz;
+	v.nor = normalize(mul((float3x3)skinMatrix, v.nor));
+	v.tan = normalize(mul((float3x3)skinMatrix, v.tan));
+
+	skinnedVertices[dispatchId.x] = v;
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 
 
+#include "material_common.hlsli"
+
 struct CB0 {
 	float4x4 view;
 	float4x4 proj;
@@ -10,6 +12,27 @@ cbuffer MatrixBuffer : register(b0) {
 	CB0 cb0;
 }
 
+cbuffer DrawConstant : register(b1) {
+	uint DrawId;
+	uint ClosureId;
+}
+
+// same layout as tools/draw_culler.h.
+struct DrawInstance {
+	float3 boundsMin;
+	uint indexCount;
+	float3 boundsMax;
+	uint indexOffset;
+	int vertexOffset;
+	uint closureId;
+	uint instanceOffset;
+	uint instanceCount;
+};
+
+// SV_InstanceID starts at zero whatever the start instance location is, so the offset comes from the draw.
+StructuredBuffer<DrawInstance> drawInstances : register(t0);
+StructuredBuffer<InstanceData> instances : register(t1);
+
 struct VS_IN {
 	float3 pos : POSITION0;
 	float3 nor : NORMAL0;
@@ -23,17 +46,21 @@ struct VS_OUT {
 	float3 tan : TANGNET0;
 	float3 binor : BINORMAL0;
 	float2 tex : TEXCOORD0;
+	nointerpolation uint instance : INSTANCE0;
 };
 
-VS_OUT main(VS_IN input) {
+VS_OUT main(VS_IN input, uint instanceId : SV_InstanceID) {
 	VS_OUT output = (VS_OUT)0;
+
+	output.instance = drawInstances[DrawId].instanceOffset + instanceId;
+	float4x4 world = mul(cb0.world, instances[output.instance].world);
 	
-	output.pos = mul(cb0.world, float4(input.pos, 1));
+	output.pos = mul(world, float4(input.pos, 1));
 	output.pos = mul(cb0.view, output.pos);
 	output.pos = mul(cb0.proj, output.pos);
 	
-	output.nor = normalize(mul((float3x3)cb0.world, input.nor));
-	output.tan = normalize(mul((float3x3)cb0.world, input.tan));
+	output.nor = normalize(mul((float3x3)world, input.nor));
+	output.tan = normalize(mul((float3x3)world, input.tan));
 	
 	output.binor = cross(output.nor, output.tan);
 	
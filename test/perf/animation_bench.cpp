@@ -0,0 +1,178 @@
+#include "perf.h"
+
+#include "../../tools/animation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 1000 skeletons of 64 joints per frame, each sampling a walk and a run clip, blending them and computing its model
+// matrices, spread over 1, 2, 4, ... threads. against the same frame sampled from the keys as imported with a binary
+// search per channel, and the size of the clips before and after compression.
+
+namespace {
+
+const uint32_t kSkeletonCount = 1000;
+const uint32_t kJointCount = 64;
+const int kKeyCount = 61;
+const float kDuration = 2.0f;
+const float kFrameTime = 1.0f / 60.0f;
+
+std::vector<AnimationTrackSource> makeTracks(std::mt19937& random, float speedScale) {
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<AnimationTrackSource> tracks(kJointCount);
+	for (uint32_t joint = 0; joint < kJointCount; joint++) {
+		AnimationTrackSource& track = tracks[joint];
+		track.joint = joint;
+		glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+		float speed = unit(random) * speedScale;
+		float sway = joint % 3 == 0 ? 0.2f : 0.0f;
+		for (int i = 0; i < kKeyCount; i++) {
+			float time = kDuration * i / (kKeyCount - 1);
+			track.positionTimes.push_back(time);
+			track.positions.push_back(glm::vec3(std::sin(time * speedScale) * sway, 1.0f, 0.0f));
+			track.rotationTimes.push_back(time);
+			track.rotations.push_back(glm::angleAxis(speed * time, axis));
+			track.scaleTimes.push_back(time);
+			track.scales.push_back(glm::vec3(1.0f));
+		}
+	}
+	return tracks;
+}
+
+// every key of the file, found by a binary search each time.
+void sampleSource(const std::vector<AnimationTrackSource>& tracks, float time, JointTransform* pose) {
+	time = std::fmod(time, kDuration);
+	auto find = [time](const std::vector<float>& times, float& alpha) {
+		size_t key = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+		key = (std::min)((std::max)(key, (size_t)1), times.size() - 1) - 1;
+		alpha = glm::clamp((time - times[key]) / (times[key + 1] - times[key]), 0.0f, 1.0f);
+		return key;
+	};
+	for (const AnimationTrackSource& track : tracks) {
+		float alpha = 0.0f;
+		size_t key = find(track.positionTimes, alpha);
+		pose[track.joint].position = glm::mix(track.positions[key], track.positions[key + 1], alpha);
+		key = find(track.rotationTimes, alpha);
+		pose[track.joint].rotation = glm::slerp(track.rotations[key], track.rotations[key + 1], alpha);
+		key = find(track.scaleTimes, alpha);
+		pose[track.joint].scale = glm::mix(track.scales[key], track.scales[key + 1], alpha);
+	}
+}
+
+struct Skeleton {
+	AnimationSampler walkSampler;
+	AnimationSampler runSampler;
+	std::vector<JointTransform> walkPose;
+	std::vector<JointTransform> runPose;
+	std::vector<glm::mat4> matrices;
+	float offset;
+	float weight;
+};
+
+// the skeletons in blocks of 16 over threadCount threads.
+template<class Function>
+void forEachSkeleton(unsigned int threadCount, Function&& function) {
+	std::atomic<uint32_t> next(0);
+	auto worker = [&]() {
+		for (uint32_t begin = next.fetch_add(16); begin < kSkeletonCount; begin = next.fetch_add(16)) {
+			for (uint32_t i = begin; i < (std::min)(begin + 16, kSkeletonCount); i++)
+				function(i);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+}
+
+
+int main() {
+	std::mt19937 random(1);
+	std::vector<int32_t> parents(kJointCount);
+	for (uint32_t i = 0; i < kJointCount; i++)
+		parents[i] = i == 0 ? -1 : (int32_t)(random() % i);
+
+	std::vector<AnimationTrackSource> walkTracks = makeTracks(random, 3.0f);
+	std::vector<AnimationTrackSource> runTracks = makeTracks(random, 6.0f);
+	AnimationClip walk;
+	AnimationClip run;
+	if (!walk.create("walk", kDuration, walkTracks) || !run.create("run", kDuration, runTracks)) {
+		std::printf("failed creating the clips\n");
+		return 1;
+	}
+	size_t sourceSize = (size_t)(walk.getSourceKeyCount() + run.getSourceKeyCount()) * (sizeof(float) + sizeof(glm::vec3));
+	std::printf("2 clips of %u joints: %u keys, %.1f KB as imported, %u keys, %.1f KB compressed\n", kJointCount,
+		walk.getSourceKeyCount() + run.getSourceKeyCount(), sourceSize / 1024.0,
+		walk.getKeyCount() + run.getKeyCount(), (walk.getMemorySize() + run.getMemorySize()) / 1024.0);
+
+	std::vector<Skeleton> skeletons(kSkeletonCount);
+	for (uint32_t i = 0; i < kSkeletonCount; i++) {
+		skeletons[i].walkPose.resize(kJointCount);
+		skeletons[i].runPose.resize(kJointCount);
+		skeletons[i].matrices.resize(kJointCount);
+		skeletons[i].offset = i * 0.01f;
+		skeletons[i].weight = (i % 10) / 9.0f;
+	}
+
+	// every call is the next frame, so the cursors walk forward like they do in the app.
+	float time = 0.0f;
+	auto animate = [&](Skeleton& skeleton) {
+		skeleton.walkSampler.sample(walk, time + skeleton.offset, skeleton.walkPose.data());
+		skeleton.runSampler.sample(run, time + skeleton.offset, skeleton.runPose.data());
+		blendPoses(skeleton.walkPose.data(), skeleton.runPose.data(), skeleton.weight, kJointCount, skeleton.walkPose.data());
+		computeModelMatrices(parents.data(), skeleton.walkPose.data(), kJointCount, skeleton.matrices.data());
+	};
+
+	std::printf("%u skeletons, times per frame\n", kSkeletonCount);
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	double singleTime = 0.0;
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		double frameTime = measure([&]() {
+			time += kFrameTime;
+			forEachSkeleton(threadCount, [&](uint32_t i) { animate(skeletons[i]); });
+		});
+		if (threadCount == 1)
+			singleTime = frameTime;
+		std::printf("  %2u threads: %8.3f ms %8.2fx\n", threadCount, frameTime * 1000.0, singleTime / frameTime);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+
+	// the steps on one thread.
+	double sampleTime = measure([&]() {
+		time += kFrameTime;
+		for (Skeleton& skeleton : skeletons) {
+			skeleton.walkSampler.sample(walk, time + skeleton.offset, skeleton.walkPose.data());
+			skeleton.runSampler.sample(run, time + skeleton.offset, skeleton.runPose.data());
+		}
+	});
+	double blendTime = measure([&]() {
+		for (Skeleton& skeleton : skeletons)
+			blendPoses(skeleton.walkPose.data(), skeleton.runPose.data(), skeleton.weight, kJointCount, skeleton.runPose.data());
+	});
+	double matrixTime = measure([&]() {
+		for (Skeleton& skeleton : skeletons)
+			computeModelMatrices(parents.data(), skeleton.walkPose.data(), kJointCount, skeleton.matrices.data());
+	});
+	double sourceTime = measure([&]() {
+		time += kFrameTime;
+		for (Skeleton& skeleton : skeletons) {
+			sampleSource(walkTracks, time + skeleton.offset, skeleton.walkPose.data());
+			sampleSource(runTracks, time + skeleton.offset, skeleton.runPose.data());
+		}
+	});
+	std::printf("  sample both clips:  %8.3f ms\n", sampleTime * 1000.0);
+	std::printf("  blend:              %8.3f ms\n", blendTime * 1000.0);
+	std::printf("  model matrices:     %8.3f ms\n", matrixTime * 1000.0);
+	std::printf("  sample as imported: %8.3f ms, binary search per channel\n", sourceTime * 1000.0);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "perf.h"
+#include "sponza_scene.h"
+
+#include "../../tools/bvh.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// the bvh on the triangles of sponza: build time over thread counts, refit, and closest hit rays per second for
+// primary rays from a camera down the atrium and for incoherent bounce rays from where they hit, against a brute
+// force loop over every triangle. run from the repository root, or pass the path of a .gltf.
+
+namespace {
+
+const uint32_t kImageWidth = 640;
+const uint32_t kImageHeight = 360;
+const uint32_t kBruteForceRayCount = 200;
+
+// hits per second of rays spread over threadCount threads, hitCount is set to the rays that hit.
+double castRays(const TriangleBvh& bvh, const std::vector<BvhRay>& rays, unsigned int threadCount, size_t& hitCount) {
+	std::atomic<size_t> hits(0);
+	double time = measure([&]() {
+		std::atomic<size_t> next(0);
+		hits = 0;
+		auto worker = [&]() {
+			size_t localHits = 0;
+			for (size_t begin = next.fetch_add(1024); begin < rays.size(); begin = next.fetch_add(1024)) {
+				for (size_t i = begin; i < (std::min)(begin + 1024, rays.size()); i++) {
+					BvhHit hit;
+					localHits += bvh.rayCast(rays[i], hit) ? 1 : 0;
+				}
+			}
+			hits += localHits;
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto& ite : threads)
+			ite.join();
+	}, 0.3, 3);
+	hitCount = hits;
+	return rays.size() / time;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+	const char* filename = argc > 1 ? argv[1] : "models/sponza/glTF/Sponza.gltf";
+
+	// about the triangle count of sponza when it has to stand in.
+	std::vector<ScenePrimitive> primitives;
+	loadSponza(filename, primitives, 3);
+
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	glm::vec3 sceneMin(FLT_MAX);
+	glm::vec3 sceneMax(-FLT_MAX);
+	std::vector<glm::vec3> primitiveMin;
+	std::vector<glm::vec3> primitiveMax;
+	for (const ScenePrimitive& primitive : primitives) {
+		uint32_t base = (uint32_t)positions.size();
+		positions.insert(positions.end(), primitive.positions.begin(), primitive.positions.end());
+		for (uint32_t index : primitive.indices)
+			indices.push_back(base + index);
+		sceneMin = glm::min(sceneMin, primitive.boundsMin);
+		sceneMax = glm::max(sceneMax, primitive.boundsMax);
+		primitiveMin.push_back(primitive.boundsMin);
+		primitiveMax.push_back(primitive.boundsMax);
+	}
+	const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+	std::printf("%u triangles in %zu primitives\n", triangleCount, primitives.size());
+
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+	// build.
+	TriangleBvh bvh;
+	std::printf("threads  triangle bvh   primitive bvh\n");
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		double triangleTime = measure([&]() { bvh.build(positions.data(), indices.data(), triangleCount, threadCount); }, 0.5, 3);
+		Bvh primitiveBvh;
+		double primitiveTime = measure([&]() { primitiveBvh.build(primitiveMin.data(), primitiveMax.data(), (uint32_t)primitiveMin.size(), threadCount); });
+		std::printf("%7u %10.2f ms %12.4f ms\n", threadCount, triangleTime * 1000.0, primitiveTime * 1000.0);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+	bvh.build(positions.data(), indices.data(), triangleCount, maxThreadCount);
+	std::printf("%zu nodes, depth %u\n", bvh.getBvh().getNodes().size(), bvh.getBvh().getDepth());
+
+	// refit of the triangle bounds in place, as an animated mesh would do every frame.
+	std::vector<glm::vec3> triangleMin(triangleCount);
+	std::vector<glm::vec3> triangleMax(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		const glm::vec3& p0 = positions[indices[i * 3 + 0]];
+		const glm::vec3& p1 = positions[indices[i * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[i * 3 + 2]];
+		triangleMin[i] = glm::min(glm::min(p0, p1), p2);
+		triangleMax[i] = glm::max(glm::max(p0, p1), p2);
+	}
+	Bvh boundsBvh;
+	boundsBvh.build(triangleMin.data(), triangleMax.data(), triangleCount, maxThreadCount);
+	double refitTime = measure([&]() { boundsBvh.refit(triangleMin.data(), triangleMax.data()); });
+	std::printf("refit %.2f ms\n", refitTime * 1000.0);
+
+	// primary rays from the end of the atrium, along its long axis.
+	glm::vec3 center = (sceneMin + sceneMax) * 0.5f;
+	glm::vec3 size = sceneMax - sceneMin;
+	glm::vec3 along(0.0f);
+	along[size.x >= size.z ? 0 : 2] = size[size.x >= size.z ? 0 : 2] * 0.5f;
+	glm::vec3 eye = center - along * 0.85f + glm::vec3(0.0f, sceneMin.y + size.y * 0.15f - center.y, 0.0f);
+	glm::mat4 inverseViewProj = glm::inverse(glm::perspective(glm::radians(60.0f), (float)kImageWidth / kImageHeight, 0.1f, 1000.0f) *
+		glm::lookAt(eye, eye + along, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	std::vector<BvhRay> primaryRays;
+	for (uint32_t y = 0; y < kImageHeight; y++) {
+		for (uint32_t x = 0; x < kImageWidth; x++) {
+			glm::vec4 target = inverseViewProj * glm::vec4((x + 0.5f) / kImageWidth * 2.0f - 1.0f, 1.0f - (y + 0.5f) / kImageHeight * 2.0f, 1.0f, 1.0f);
+			BvhRay ray;
+			ray.origin = eye;
+			ray.direction = glm::normalize(glm::vec3(target) / target.w - eye);
+			primaryRays.push_back(ray);
+		}
+	}
+
+	// a bounce in a random direction from every primary hit.
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<BvhRay> bounceRays;
+	for (const BvhRay& primary : primaryRays) {
+		BvhHit hit;
+		if (!bvh.rayCast(primary, hit))
+			continue;
+
+		BvhRay ray;
+		ray.origin = primary.origin + primary.direction * hit.t;
+		ray.tMin = 1e-3f;
+		do {
+			ray.direction = glm::vec3(unit(random), unit(random), unit(random));
+		} while (glm::dot(ray.direction, ray.direction) > 1.0f || glm::dot(ray.direction, ray.direction) < 1e-4f);
+		ray.direction = glm::normalize(ray.direction);
+		bounceRays.push_back(ray);
+	}
+
+	std::printf("threads   primary rays/s  hits   bounce rays/s  hits\n");
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		size_t primaryHits = 0;
+		size_t bounceHits = 0;
+		double primary = castRays(bvh, primaryRays, threadCount, primaryHits);
+		double bounce = castRays(bvh, bounceRays, threadCount, bounceHits);
+		std::printf("%7u %14.2f M %4.0f%% %13.2f M %4.0f%%\n", threadCount, primary * 1e-6, 100.0 * primaryHits / primaryRays.size(),
+			bounce * 1e-6, 100.0 * bounceHits / bounceRays.size());
+		if (threadCount == maxThreadCount)
+			break;
+	}
+
+	// every triangle for every ray, the same test without the tree.
+	std::vector<glm::vec3> edge1(triangleCount);
+	std::vector<glm::vec3> edge2(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		edge1[i] = positions[indices[i * 3 + 1]] - positions[indices[i * 3 + 0]];
+		edge2[i] = positions[indices[i * 3 + 2]] - positions[indices[i * 3 + 0]];
+	}
+	double begin = getPerfSeconds();
+	size_t bruteHits = 0;
+	for (uint32_t r = 0; r < kBruteForceRayCount; r++) {
+		const BvhRay& ray = bounceRays[r * bounceRays.size() / kBruteForceRayCount];
+		float closest = ray.tMax;
+		for (uint32_t i = 0; i < triangleCount; i++) {
+			glm::vec3 p = glm::cross(ray.direction, edge2[i]);
+			float determinant = glm::dot(edge1[i], p);
+			if (std::abs(determinant) < 1e-12f)
+				continue;
+			float inverse = 1.0f / determinant;
+			glm::vec3 s = ray.origin - positions[indices[i * 3 + 0]];
+			float u = glm::dot(s, p) * inverse;
+			glm::vec3 q = glm::cross(s, edge1[i]);
+			float v = glm::dot(ray.direction, q) * inverse;
+			float t = glm::dot(edge2[i], q) * inverse;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= ray.tMin && t < closest)
+				closest = t;
+		}
+		bruteHits += closest < ray.tMax ? 1 : 0;
+	}
+	double bruteTime = getPerfSeconds() - begin;
+	keepValue(bruteHits);
+	std::printf("brute force, 1 thread: %.0f bounce rays/s\n", kBruteForceRayCount / bruteTime);
+	return 0;
+}
\ No newline at end of file
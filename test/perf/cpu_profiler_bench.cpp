@@ -0,0 +1,106 @@
+#include "perf.h"
+
+#include "../../tools/cpu_profiler.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the cost of a CPU_PROFILE_SCOPE: the clock read on its own, a loop with and without a scope around its body, the
+// scoped loop on 1, 2, 4, ... threads at once up to the hardware concurrency, each with its own buffer, and what
+// endFrame spends per event it drains and merges.
+
+namespace {
+
+// scopes per thread and frame, below the capacity of a buffer so nothing is dropped.
+const int kScopeCount = 4000;
+const int kRoundCount = 200;
+
+// nanoseconds per iteration.
+double runLoop(bool isScoped) {
+	uint64_t begin = getProfilerTime();
+	if (isScoped) {
+		for (int i = 0; i < kScopeCount; i++) {
+			CPU_PROFILE_SCOPE("bench");
+			keepValue(i);
+		}
+	}
+	else {
+		for (int i = 0; i < kScopeCount; i++)
+			keepValue(i);
+	}
+	return (double)(getProfilerTime() - begin) / kScopeCount;
+}
+
+// the best round of threadCount threads running the scoped loop at the same time, averaged over the threads.
+double runThreads(unsigned int threadCount) {
+	CpuProfiler& profiler = CpuProfiler::Instance();
+	std::vector<double> times(threadCount);
+
+	double best = 1e30;
+	for (int round = 0; round < kRoundCount; round++) {
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < threadCount; i++) {
+			threads.emplace_back([&times, i]() {
+				CpuProfiler::Instance().setThreadName("worker " + std::to_string(i));
+				times[i] = runLoop(true);
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		profiler.endFrame();
+
+		double time = 0.0;
+		for (double threadTime : times)
+			time += threadTime;
+		best = (std::min)(best, time / threadCount);
+	}
+	return best;
+}
+
+}
+
+
+int main() {
+	CpuProfiler& profiler = CpuProfiler::Instance();
+	profiler.setThreadName("main");
+	profiler.endFrame();
+
+	const int clockCount = 1000000;
+	uint64_t clockBegin = getProfilerTime();
+	for (int i = 0; i < clockCount; i++)
+		keepValue(getProfilerTime());
+	double clockTime = (double)(getProfilerTime() - clockBegin) / clockCount;
+
+	double baseline = 1e30;
+	double scoped = 1e30;
+	double endFrame = 1e30;
+	for (int round = 0; round < kRoundCount; round++) {
+		baseline = (std::min)(baseline, runLoop(false));
+		scoped = (std::min)(scoped, runLoop(true));
+
+		uint64_t begin = getProfilerTime();
+		profiler.endFrame();
+		endFrame = (std::min)(endFrame, (double)(getProfilerTime() - begin) / kScopeCount);
+	}
+	if (profiler.getFrame(0)->dropped != 0)
+		std::printf("dropped %u events\n", profiler.getFrame(0)->dropped);
+
+	std::printf("clock read:      %6.1f ns\n", clockTime);
+	std::printf("loop:            %6.1f ns per iteration\n", baseline);
+	std::printf("scoped loop:     %6.1f ns per iteration\n", scoped);
+	std::printf("per scope:       %6.1f ns\n", scoped - baseline);
+	std::printf("endFrame:        %6.1f ns per event\n", endFrame);
+
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	std::printf("threads  per scope\n");
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		double time = runThreads(threadCount);
+		std::printf("%7u %8.1f ns\n", threadCount, time - baseline);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "perf.h"
+
+#include "../../tools/frustum_culler.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <random>
+#include <vector>
+
+// 1M random boxes and their spheres culled against a perspective frustum, scalar against the sse or avx path the
+// compiler targets.
+
+namespace {
+
+const size_t kBoundsCount = 1000000;
+
+void report(const char* name, double scalar, double simd, size_t visibleCount) {
+	std::printf("%-8s scalar %7.2f ms (%6.1f M/s)   simd %7.2f ms (%6.1f M/s)   %.2fx, %zu visible\n", name,
+		scalar * 1000.0, kBoundsCount / scalar * 1e-6, simd * 1000.0, kBoundsCount / simd * 1e-6, scalar / simd, visibleCount);
+}
+
+}
+
+
+int main() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.01f, 3.0f);
+
+	CullBounds bounds;
+	bounds.reserve(kBoundsCount);
+	for (size_t i = 0; i < kBoundsCount; i++) {
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		bounds.add(center - extent, center + extent);
+	}
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::half_pi<float>(), 16.0f / 9.0f, 0.1f, 100.0f);
+	FrustumCuller culler;
+	culler.setMatrix(proj * view);
+
+#if defined(__AVX__)
+	std::printf("%zu bounds, avx\n", kBoundsCount);
+#else
+	std::printf("%zu bounds, sse\n", kBoundsCount);
+#endif
+
+	std::vector<uint32_t> visible;
+	visible.reserve(kBoundsCount);
+	double boxScalar = measure([&]() { keepValue(culler.cullBoxesScalar(bounds, visible)); });
+	double boxSimd = measure([&]() { keepValue(culler.cullBoxes(bounds, visible)); });
+	report("boxes", boxScalar, boxSimd, visible.size());
+
+	double sphereScalar = measure([&]() { keepValue(culler.cullSpheresScalar(bounds, visible)); });
+	double sphereSimd = measure([&]() { keepValue(culler.cullSpheres(bounds, visible)); });
+	report("spheres", sphereScalar, sphereSimd, visible.size());
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "perf.h"
+#include "sponza_scene.h"
+
+#include "../../tools/occlusion_culler.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+// the occlusion culling of the app on sponza: the 16 primitives with the largest bounds rasterized at 256x144 and
+// the bounds of every primitive plus scattered props queried, from a few cameras along the atrium.
+// run from the repository root, or pass the path of a .gltf.
+
+namespace {
+
+const uint32_t kWidth = 256;
+const uint32_t kHeight = 144;
+const size_t kOccluderCount = 16;
+const size_t kPropCount = 20000;
+
+struct Camera {
+	const char* name;
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+struct Scene {
+	std::vector<ScenePrimitive> primitives;
+	std::vector<size_t> occluders;
+	CullBounds bounds;
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+};
+
+void prepare(Scene& scene) {
+	for (const ScenePrimitive& primitive : scene.primitives) {
+		scene.boundsMin = glm::min(scene.boundsMin, primitive.boundsMin);
+		scene.boundsMax = glm::max(scene.boundsMax, primitive.boundsMax);
+		scene.bounds.add(primitive.boundsMin, primitive.boundsMax);
+	}
+
+	// the largest by bounding radius, as the app picks them.
+	for (size_t i = 0; i < scene.primitives.size(); i++)
+		scene.occluders.push_back(i);
+	auto getRadius = [&scene](size_t i) { return glm::length(scene.primitives[i].boundsMax - scene.primitives[i].boundsMin); };
+	std::sort(scene.occluders.begin(), scene.occluders.end(), [&getRadius](size_t a, size_t b) { return getRadius(a) > getRadius(b); });
+	scene.occluders.resize((std::min)(scene.occluders.size(), kOccluderCount));
+
+	// props of 0.1 to 0.6 scattered through the scene bounds.
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (size_t i = 0; i < kPropCount; i++) {
+		glm::vec3 center = scene.boundsMin + (scene.boundsMax - scene.boundsMin) * glm::vec3(unit(random), unit(random), unit(random));
+		glm::vec3 extent(0.05f + 0.25f * unit(random));
+		scene.bounds.add(center - extent, center + extent);
+	}
+}
+
+}
+
+
+int main(int argc, char** argv) {
+	const char* filename = argc > 1 ? argv[1] : "models/sponza/glTF/Sponza.gltf";
+
+	Scene scene;
+	bool isSponza = loadSponza(filename, scene.primitives);
+	prepare(scene);
+
+	size_t triangleCount = 0;
+	size_t occluderTriangleCount = 0;
+	for (size_t i = 0; i < scene.primitives.size(); i++)
+		triangleCount += scene.primitives[i].indices.size() / 3;
+	for (size_t occluder : scene.occluders)
+		occluderTriangleCount += scene.primitives[occluder].indices.size() / 3;
+	std::printf("%s: %zu primitives, %zu triangles, %zu occluders with %zu triangles, %zu bounds queried at %ux%u\n",
+		isSponza ? filename : "atrium", scene.primitives.size(), triangleCount, scene.occluders.size(), occluderTriangleCount,
+		scene.bounds.size(), kWidth, kHeight);
+
+	// cameras placed relative to the scene bounds, so they work for sponza and the atrium alike.
+	glm::vec3 center = (scene.boundsMin + scene.boundsMax) * 0.5f;
+	glm::vec3 size = scene.boundsMax - scene.boundsMin;
+	int longAxis = size.x >= size.z ? 0 : 2;
+	glm::vec3 along(0.0f);
+	along[longAxis] = size[longAxis] * 0.5f;
+	glm::vec3 across(0.0f);
+	across[2 - longAxis] = size[2 - longAxis] * 0.5f;
+	glm::vec3 eyeHeight(0.0f, scene.boundsMin.y + size.y * 0.15f - center.y, 0.0f);
+	const Camera cameras[] = {
+		{ "end, down the atrium", center + eyeHeight - along * 0.85f, center + eyeHeight + along },
+		{ "center, down the atrium", center + eyeHeight, center + eyeHeight + along },
+		{ "center, at an arcade", center + eyeHeight, center + eyeHeight + across },
+		{ "gallery, along it", center + eyeHeight * -0.2f + across * 0.75f - along * 0.8f, center + eyeHeight * -0.2f + across * 0.75f + along },
+	};
+
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), (float)kWidth / kHeight, 0.1f, 1000.0f);
+
+	OcclusionCuller culler;
+	culler.create(kWidth, kHeight);
+	std::vector<uint32_t> all(scene.bounds.size());
+	for (uint32_t i = 0; i < (uint32_t)all.size(); i++)
+		all[i] = i;
+
+	std::printf("%-24s %7s %10s %12s %12s %8s\n", "camera", "threads", "raster", "triangles/s", "queries/s", "culled");
+	for (const Camera& camera : cameras) {
+		glm::mat4 worldViewProj = proj * glm::lookAt(camera.position, camera.target, glm::vec3(0.0f, 1.0f, 0.0f));
+		auto addOccluders = [&]() {
+			culler.begin(worldViewProj);
+			for (size_t occluder : scene.occluders) {
+				const ScenePrimitive& primitive = scene.primitives[occluder];
+				culler.addOccluder(primitive.positions.data(), primitive.indices.data(), primitive.indices.size());
+			}
+		};
+
+		for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+			// setup and raster together, as the app times them.
+			double raster = measure([&]() {
+				addOccluders();
+				culler.rasterize(threadCount);
+				keepValue(culler.getHierarchy()[0]);
+			});
+
+			std::vector<uint32_t> visible;
+			double query = measure([&]() {
+				visible = all;
+				culler.cull(scene.bounds, visible);
+				keepValue(visible.size());
+			});
+
+			std::printf("%-24s %7u %7.3f ms %12.0f %12.0f %7.1f%%\n", camera.name, threadCount, raster * 1000.0,
+				culler.getTriangleCount() / raster, all.size() / query, 100.0 * (all.size() - visible.size()) / all.size());
+			if (threadCount == maxThreadCount)
+				break;
+		}
+	}
+	return 0;
+}
\ No newline at end of file
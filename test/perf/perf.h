@@ -0,0 +1,45 @@
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <chrono>
+#include <cstdio>
+
+// keeps the compiler from dropping a computation whose result is otherwise unused.
+template<class T>
+inline void keepValue(const T& value) {
+#if defined(_MSC_VER)
+	static const void* volatile sink;
+	sink = &value;
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+inline double getPerfSeconds() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// seconds per call of function, the best of repeatCount runs that each call it until minSeconds passed.
+template<class Function>
+double measure(Function&& function, double minSeconds = 0.1, int repeatCount = 3) {
+	function();
+
+	double best = 0.0;
+	for (int repeat = 0; repeat < repeatCount; repeat++) {
+		long long count = 0;
+		double begin = getPerfSeconds();
+		double elapsed = 0.0;
+		do {
+			function();
+			count++;
+			elapsed = getPerfSeconds() - begin;
+		} while (elapsed < minSeconds);
+
+		double time = elapsed / (double)count;
+		if (repeat == 0 || time < best)
+			best = time;
+	}
+	return best;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "perf.h"
+#include "sponza_scene.h"
+
+#include "../../tools/reference_renderer.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// the reference renderer on sponza at the resolution of the app: the bvh build and the primary rays per second of
+// render with 1, 2, 4, ... threads up to the hardware concurrency. the albedo maps are left out, the loader of the
+// benchmarks only reads positions. run from the repository root, or pass the path of a .gltf.
+
+namespace {
+
+const uint32_t kWidth = 1280;
+const uint32_t kHeight = 720;
+
+// every primitive a mesh with one instance, normals averaged from the faces.
+void makeReferenceScene(const std::vector<ScenePrimitive>& primitives, ReferenceScene& scene) {
+	for (const ScenePrimitive& primitive : primitives) {
+		std::vector<glm::vec3> normals(primitive.positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < primitive.indices.size(); i += 3) {
+			const uint32_t* indices = primitive.indices.data() + i;
+			glm::vec3 normal = glm::cross(primitive.positions[indices[1]] - primitive.positions[indices[0]], primitive.positions[indices[2]] - primitive.positions[indices[0]]);
+			for (int j = 0; j < 3; j++)
+				normals[indices[j]] += normal;
+		}
+		for (glm::vec3& normal : normals)
+			normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+		scene.instanceMeshes.push_back((int)scene.vertexCounts.size());
+		scene.instanceMatrices.push_back(glm::mat4(1.0f));
+		scene.vertexCounts.push_back((uint32_t)primitive.positions.size());
+		scene.indexCounts.push_back((uint32_t)primitive.indices.size());
+		scene.materialIndices.push_back(-1);
+		scene.positions.insert(scene.positions.end(), primitive.positions.begin(), primitive.positions.end());
+		scene.normals.insert(scene.normals.end(), normals.begin(), normals.end());
+		scene.texcoords.resize(scene.positions.size(), glm::vec2(0.0f));
+		scene.indices.insert(scene.indices.end(), primitive.indices.begin(), primitive.indices.end());
+	}
+}
+
+}
+
+
+int main(int argc, char** argv) {
+	const char* filename = argc > 1 ? argv[1] : "models/sponza/glTF/Sponza.gltf";
+
+	std::vector<ScenePrimitive> primitives;
+	loadSponza(filename, primitives, 3);
+	ReferenceScene scene;
+	makeReferenceScene(primitives, scene);
+
+	glm::vec3 sceneMin(FLT_MAX);
+	glm::vec3 sceneMax(-FLT_MAX);
+	for (const ScenePrimitive& primitive : primitives) {
+		sceneMin = glm::min(sceneMin, primitive.boundsMin);
+		sceneMax = glm::max(sceneMax, primitive.boundsMax);
+	}
+
+	// from the end of the atrium along its long axis.
+	glm::vec3 center = (sceneMin + sceneMax) * 0.5f;
+	glm::vec3 size = sceneMax - sceneMin;
+	glm::vec3 along(0.0f);
+	along[size.x >= size.z ? 0 : 2] = size[size.x >= size.z ? 0 : 2] * 0.5f;
+	glm::vec3 eye = center - along * 0.85f + glm::vec3(0.0f, sceneMin.y + size.y * 0.15f - center.y, 0.0f);
+
+	ReferenceCamera camera;
+	camera.view = glm::lookAt(eye, eye + along, glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.proj = glm::perspective(glm::radians(60.0f), (float)kWidth / kHeight, 0.1f, 1000.0f);
+	camera.world = glm::mat4(1.0f);
+	camera.lightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	std::printf("%zu triangles, %ux%u\n", scene.indices.size() / 3, kWidth, kHeight);
+	std::printf("threads      build     render     Mrays/s   speedup\n");
+
+	double singleRate = 0.0;
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		ReferenceRenderer renderer;
+		double build = 1e30;
+		double render = 1e30;
+		double rate = 0.0;
+		for (int repeat = 0; repeat < 3; repeat++) {
+			if (!renderer.create(scene, {}, threadCount)) {
+				std::printf("failed creating the reference renderer\n");
+				return 1;
+			}
+			renderer.render(camera, kWidth, kHeight, threadCount);
+			build = (std::min)(build, renderer.getBuildTime());
+			render = (std::min)(render, renderer.getRenderTime());
+			rate = (std::max)(rate, renderer.getRaysPerSecond());
+		}
+		if (threadCount == 1)
+			singleRate = rate;
+
+		std::printf("%7u %7.1f ms %7.1f ms %11.2f %8.2fx\n", threadCount, build, render, rate * 1e-6, rate / singleRate);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "perf.h"
+
+#include "../../framework/null_device.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// the cost of the RenderCommandList interface itself, on the null device: a frame built here in the shape of the app's
+// (the culling dispatches, a visibility pass with constants, buffers and an indexed draw per mesh, and the barriers
+// and timestamps around them). the app still records its own lists, so this is not its frame. recording is timed
+// apart from submit, which on the null device is the state checks of every command. the draws are then split over
+// 1, 2, 4, ... command lists recorded by as many threads up to the hardware concurrency.
+
+namespace {
+
+const uint32_t kMeshCount = 64;
+
+struct Scene {
+	NullRenderDevice device;
+	RenderHandle graphicsPipeline = kInvalidRenderHandle;
+	RenderHandle computePipeline = kInvalidRenderHandle;
+	RenderHandle target = kInvalidRenderHandle;
+	RenderHandle depth = kInvalidRenderHandle;
+	RenderHandle visibility = kInvalidRenderHandle;
+	RenderHandle queries = kInvalidRenderHandle;
+	RenderHandle timestamps = kInvalidRenderHandle;
+	RenderHandle vertexBuffers[kMeshCount] = {};
+	RenderHandle indexBuffers[kMeshCount] = {};
+	uint32_t visibilityView = 0;
+};
+
+void createScene(Scene& scene) {
+	NullRenderDevice& device = scene.device;
+	scene.graphicsPipeline = device.createPipeline("visibility", false);
+	scene.computePipeline = device.createPipeline("cull", true);
+
+	TextureDesc target;
+	target.width = 1280;
+	target.height = 720;
+	target.isRenderTarget = true;
+	target.name = "target";
+	scene.target = device.createTexture(target);
+
+	TextureDesc depth = target;
+	depth.format = RenderFormat::eD32Float;
+	depth.isRenderTarget = false;
+	depth.isDepthStencil = true;
+	depth.name = "depth";
+	scene.depth = device.createTexture(depth);
+
+	BufferDesc visibility;
+	visibility.size = 4096;
+	visibility.isUnorderedAccess = true;
+	visibility.name = "visibility";
+	scene.visibility = device.createBuffer(visibility);
+	scene.visibilityView = device.createView(scene.visibility, ViewType::eUnorderedAccess, 4);
+
+	scene.queries = device.createTimestampQueries(4);
+	BufferDesc timestamps;
+	timestamps.size = 4 * sizeof(uint64_t);
+	timestamps.memoryType = MemoryType::eReadback;
+	timestamps.name = "timestamps";
+	scene.timestamps = device.createBuffer(timestamps);
+
+	for (uint32_t i = 0; i < kMeshCount; i++) {
+		BufferDesc vertices;
+		vertices.size = 1024 * 32;
+		vertices.name = "vertices";
+		scene.vertexBuffers[i] = device.createBuffer(vertices);
+		BufferDesc indices;
+		indices.size = 3072 * 4;
+		indices.name = "indices";
+		scene.indexBuffers[i] = device.createBuffer(indices);
+	}
+}
+
+void recordDraws(const Scene& scene, RenderCommandList& list, uint32_t begin, uint32_t end) {
+	list.setPipeline(scene.graphicsPipeline);
+	list.setRenderTargets(&scene.target, 1, scene.depth);
+	list.setViewport(0.0f, 0.0f, 1280.0f, 720.0f);
+	for (uint32_t i = begin; i < end; i++) {
+		uint32_t mesh = i % kMeshCount;
+		uint32_t constants[4] = { i, mesh, 0, 0 };
+		list.setRootConstants(0, 4, constants);
+		list.setVertexBuffer(scene.vertexBuffers[mesh], 32);
+		list.setIndexBuffer(scene.indexBuffers[mesh], RenderFormat::eR32Uint);
+		list.drawIndexed(3072, 1, 0, 0, 0);
+	}
+}
+
+void recordFrame(const Scene& scene, RenderCommandList& list, uint32_t drawCount) {
+	static const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	list.begin();
+	list.writeTimestamp(scene.queries, 0);
+
+	list.beginEvent("cull");
+	list.setPipeline(scene.computePipeline);
+	list.setRootTable(0, scene.visibilityView);
+	list.dispatch((drawCount + 63) / 64, 1, 1);
+	list.uavBarrier(scene.visibility);
+	list.endEvent();
+	list.writeTimestamp(scene.queries, 1);
+
+	list.beginEvent("visibility");
+	list.clearRenderTarget(scene.target, clearColor);
+	list.clearDepthStencil(scene.depth, 1.0f);
+	recordDraws(scene, list, 0, drawCount);
+	list.endEvent();
+	list.writeTimestamp(scene.queries, 2);
+
+	list.beginEvent("shading");
+	list.barrier(scene.target, ResourceState::eRenderTarget, ResourceState::eUnorderedAccess);
+	list.setPipeline(scene.computePipeline);
+	list.setRootTable(0, scene.visibilityView);
+	list.dispatch(1280 / 8, 720 / 8, 1);
+	list.barrier(scene.target, ResourceState::eUnorderedAccess, ResourceState::eRenderTarget);
+	list.endEvent();
+	list.writeTimestamp(scene.queries, 3);
+
+	list.resolveTimestamps(scene.queries, 0, 4, scene.timestamps, 0);
+	list.end();
+}
+
+}
+
+
+int main() {
+	Scene scene;
+	createScene(scene);
+	std::unique_ptr<RenderCommandList> list = scene.device.createCommandList();
+
+	std::printf("   draws  commands     record     submit  record/cmd  submit/cmd\n");
+	for (uint32_t drawCount : { 1000u, 10000u, 100000u }) {
+		double record = measure([&]() { recordFrame(scene, *list, drawCount); });
+		double submit = measure([&]() {
+			RenderCommandList* lists[] = { list.get() };
+			scene.device.submit(lists, 1);
+		});
+		uint32_t commandCount = static_cast<NullCommandList*>(list.get())->getStream().getCommandCount();
+		std::printf("%8u %9u %7.3f ms %7.3f ms %8.1f ns %9.1f ns\n", drawCount, commandCount, record * 1000.0,
+			submit * 1000.0, record / commandCount * 1e9, submit / commandCount * 1e9);
+	}
+	if (!scene.device.getErrors().empty()) {
+		std::printf("the null device reported %zu errors\n", scene.device.getErrors().size());
+		return 1;
+	}
+
+	// the visibility pass of 100000 draws recorded into one list per thread.
+	const uint32_t drawCount = 100000;
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	std::vector<std::unique_ptr<RenderCommandList>> lists;
+	for (unsigned int i = 0; i < maxThreadCount; i++)
+		lists.push_back(scene.device.createCommandList());
+
+	std::printf("threads     record   speedup\n");
+	double singleTime = 0.0;
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		double time = measure([&]() {
+			std::vector<std::thread> threads;
+			for (unsigned int i = 0; i < threadCount; i++) {
+				threads.emplace_back([&, i]() {
+					lists[i]->begin();
+					recordDraws(scene, *lists[i], drawCount * i / threadCount, drawCount * (i + 1) / threadCount);
+					lists[i]->end();
+				});
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+		});
+		if (threadCount == 1)
+			singleTime = time;
+
+		std::printf("%7u %7.3f ms %8.2fx\n", threadCount, time * 1000.0, singleTime / time);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+
+	return 0;
+}
\ No newline at end of file
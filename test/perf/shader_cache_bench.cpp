@@ -0,0 +1,137 @@
+#include "perf.h"
+
+#include "../../framework/shader_cache.h"
+
+#if defined(_WIN32)
+#include "../../framework/shader.h"
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// the cache on its own with generated sources: a cold run computes the keys, misses and stores, a warm run computes
+// the keys and loads. on windows also the shaders of the app compiled with an empty and with a filled cache.
+// run from the repository root.
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "shader_cache_bench";
+const int kShaderCount = 64;
+const size_t kBytecodeSize = 32 * 1024;
+
+void writeSources() {
+	std::filesystem::create_directories(kDirectory / "src");
+	{
+		std::ofstream ofs(kDirectory / "src" / "common.hlsli");
+		for (int i = 0; i < 500; i++)
+			ofs << "float4 commonFunction" << i << "(float4 x) { return x * " << i << ".0; }\n";
+	}
+	for (int i = 0; i < kShaderCount; i++) {
+		std::ofstream ofs(kDirectory / "src" / ("shader" + std::to_string(i) + ".fx"));
+		ofs << "#include \"common.hlsli\"\n";
+		for (int j = 0; j < 200; j++)
+			ofs << "float4 function" << j << "(float4 x) { return commonFunction" << j << "(x) + " << i << ".0; }\n";
+	}
+}
+
+double run(bool isCold) {
+	ShaderCache& cache = ShaderCache::Instance();
+	if (isCold)
+		cache.clear();
+
+	std::vector<uint8_t> bytecode(kBytecodeSize, 0x5a);
+	std::vector<uint8_t> loaded;
+	int hitCount = 0;
+
+	double begin = getPerfSeconds();
+	for (int i = 0; i < kShaderCount; i++) {
+		std::filesystem::path filename = kDirectory / "src" / ("shader" + std::to_string(i) + ".fx");
+		uint64_t key = cache.computeKey(filename, L"main", L"cs_6_6", {}, 1);
+		if (cache.load(key, loaded)) {
+			hitCount++;
+			continue;
+		}
+		cache.store(key, bytecode.data(), bytecode.size());
+	}
+	double time = getPerfSeconds() - begin;
+
+	if (hitCount != (isCold ? 0 : kShaderCount))
+		std::printf("unexpected hit count %d\n", hitCount);
+	return time;
+}
+
+#if defined(_WIN32)
+double compileAppShaders() {
+	const wchar_t* computeShaders[] = {
+		L"shaders/draw_cull_cs.fx", L"shaders/hiz_build_cs.fx", L"shaders/material_count_cs.fx", L"shaders/material_args_cs.fx",
+		L"shaders/material_sort_cs.fx", L"shaders/skinning_cs.fx", L"shaders/rendering_cs.fx",
+	};
+
+	double begin = getPerfSeconds();
+	Shader vs;
+	Shader ps;
+	bool isCompiled = vs.createVertexShader(L"shaders/vs.fx") && ps.createPixelShader(L"shaders/ps.fx");
+	for (const wchar_t* filename : computeShaders) {
+		Shader cs;
+		isCompiled = cs.createComputeShader(filename) && isCompiled;
+	}
+	double time = getPerfSeconds() - begin;
+
+	if (!isCompiled)
+		std::printf("failed compiling the shaders of the app\n");
+	return time;
+}
+#endif
+
+}
+
+
+int main() {
+	ShaderCache& cache = ShaderCache::Instance();
+	cache.setDirectory(kDirectory / "cache");
+	writeSources();
+
+	double cold = 1e30;
+	double warm = 1e30;
+	for (int i = 0; i < 5; i++) {
+		cold = (std::min)(cold, run(true));
+		warm = (std::min)(warm, run(false));
+	}
+	std::printf("%d generated shaders, %zu KB each\n", kShaderCount, kBytecodeSize / 1024);
+	std::printf("  cold (key, miss, store): %8.3f ms\n", cold * 1000.0);
+	std::printf("  warm (key, load):        %8.3f ms\n", warm * 1000.0);
+
+	// the running size keeps a store from walking the directory, so the cost per store does not grow with the entries.
+	cache.clear();
+	std::vector<uint8_t> bytecode(4096, 0x5a);
+	const int storeCount = 2000;
+	const int sampleCount = 200;
+	double first = 0.0;
+	double last = 0.0;
+	for (int i = 0; i < storeCount; i++) {
+		double begin = getPerfSeconds();
+		cache.store((uint64_t)i + 1, bytecode.data(), bytecode.size());
+		double time = getPerfSeconds() - begin;
+		if (i < sampleCount)
+			first += time;
+		else if (i >= storeCount - sampleCount)
+			last += time;
+	}
+	std::printf("store with %d entries: %.1f us, with %d entries: %.1f us\n",
+		sampleCount / 2, first / sampleCount * 1e6, storeCount - sampleCount / 2, last / sampleCount * 1e6);
+
+#if defined(_WIN32)
+	cache.setDirectory("shader_cache_bench");
+	cache.clear();
+	double compileCold = compileAppShaders();
+	double compileWarm = compileAppShaders();
+	std::printf("app shaders, empty cache: %8.3f ms, filled cache: %8.3f ms\n", compileCold * 1000.0, compileWarm * 1000.0);
+	cache.clear();
+#endif
+
+	std::error_code ec;
+	std::filesystem::remove_all(kDirectory, ec);
+	return 0;
+}
\ No newline at end of file
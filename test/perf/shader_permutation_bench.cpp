@@ -0,0 +1,75 @@
+#include "perf.h"
+
+#include "../../framework/shader_permutation.h"
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+// every variant of the four features of rendering_cs.fx compiled with 1, 2, 4, ... threads up to the hardware
+// concurrency, with the shader cache off so each run compiles. run from the repository root.
+
+namespace {
+
+const wchar_t* kFeatures[] = { L"VISIBILITY_DEBUG", L"HAS_ALBEDO_MAP", L"HAS_NORMAL_MAP", L"HAS_ROUGH_METAL_MAP" };
+
+bool compile(unsigned int threadCount, double& time, size_t& uniqueCount) {
+	ShaderPermutation permutation;
+	permutation.setSource(L"shaders/rendering_cs.fx", L"main", L"cs_6_0");
+	for (const wchar_t* feature : kFeatures)
+		permutation.addFeature(feature);
+
+	std::vector<uint32_t> masks;
+	for (uint32_t mask = 0; mask < (1u << (uint32_t)std::size(kFeatures)); mask++)
+		masks.push_back(mask);
+
+	double begin = getPerfSeconds();
+	bool result = permutation.compile(masks, threadCount);
+	time = getPerfSeconds() - begin;
+	uniqueCount = permutation.getUniqueVariantCount();
+	return result;
+}
+
+}
+
+
+int main() {
+	ShaderCache& cache = ShaderCache::Instance();
+	cache.setEnable(false);
+
+	const unsigned int variantCount = 1u << (unsigned int)std::size(kFeatures);
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+	std::printf("%u variants of rendering_cs.fx\n", variantCount);
+	std::printf("threads      time   variants/s   speedup\n");
+
+	double singleTime = 0.0;
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		double time = 0.0;
+		size_t uniqueCount = 0;
+		if (!compile(threadCount, time, uniqueCount)) {
+			std::printf("failed compiling rendering_cs.fx\n");
+			return 1;
+		}
+		if (threadCount == 1)
+			singleTime = time;
+
+		std::printf("%7u %8.1f ms %12.1f %8.2fx (%zu unique)\n", threadCount, time * 1000.0, variantCount / time, singleTime / time, uniqueCount);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+
+	// the same variants again from a filled cache.
+	cache.setDirectory("shader_cache_bench");
+	cache.setEnable(true);
+	cache.clear();
+	double time = 0.0;
+	size_t uniqueCount = 0;
+	compile(maxThreadCount, time, uniqueCount);
+	compile(maxThreadCount, time, uniqueCount);
+	std::printf("cached  %8.1f ms %12.1f\n", time * 1000.0, variantCount / time);
+	cache.clear();
+
+	return 0;
+}
\ No newline at end of file
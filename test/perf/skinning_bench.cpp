@@ -0,0 +1,148 @@
+#include "perf.h"
+
+#include "../../tools/skinning.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+#include <thread>
+#include <vector>
+
+// vertices per second of the cpu skinner on 200000 vertices over a palette of 64 joints, one to four joints a vertex:
+// a plain glm loop, the linear blend with and without the bounds, the dual quaternions, and the linear blend split
+// over 1, 2, 4, ... threads with the bounds merged after. the avx path is only in when the compiler targets it.
+
+namespace {
+
+const uint32_t kJointCount = 64;
+const uint32_t kVertexCount = 200000;
+
+struct Mesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<SkinVertex> skin;
+	std::vector<glm::mat4> matrices;
+	std::vector<DualQuaternion> dualQuaternions;
+	std::vector<glm::vec3> skinnedPositions;
+	std::vector<glm::vec3> skinnedNormals;
+};
+
+Mesh makeMesh() {
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	Mesh mesh;
+	for (uint32_t i = 0; i < kJointCount; i++) {
+		glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+		mesh.matrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random))) * glm::mat4_cast(rotation));
+	}
+	mesh.dualQuaternions.resize(kJointCount);
+	computeDualQuaternions(mesh.matrices.data(), kJointCount, mesh.dualQuaternions.data());
+
+	// neighbouring vertices share their joints like they do in an exported mesh.
+	for (uint32_t i = 0; i < kVertexCount; i++) {
+		mesh.positions.push_back(glm::vec3(unit(random), unit(random), unit(random)));
+		mesh.normals.push_back(glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.01f)));
+
+		SkinVertex vertex = {};
+		uint16_t joint = (uint16_t)(i / 256 % kJointCount);
+		int influenceCount = 1 + (int)(random() % 4);
+		int remaining = 255;
+		for (int j = 0; j < influenceCount; j++) {
+			vertex.joints[j] = (uint16_t)((joint + j) % kJointCount);
+			int weight = j + 1 == influenceCount ? remaining : (int)(random() % (remaining + 1));
+			vertex.weights[j] = (uint8_t)weight;
+			remaining -= weight;
+		}
+		mesh.skin.push_back(vertex);
+	}
+	mesh.skinnedPositions.resize(kVertexCount);
+	mesh.skinnedNormals.resize(kVertexCount);
+	return mesh;
+}
+
+void skinGlm(Mesh& mesh) {
+	for (uint32_t i = 0; i < kVertexCount; i++) {
+		glm::mat4 matrix(0.0f);
+		for (int j = 0; j < 4; j++)
+			matrix += mesh.matrices[mesh.skin[i].joints[j]] * (mesh.skin[i].weights[j] / 255.0f);
+		mesh.skinnedPositions[i] = glm::vec3(matrix * glm::vec4(mesh.positions[i], 1.0f));
+		mesh.skinnedNormals[i] = glm::normalize(glm::mat3(matrix) * mesh.normals[i]);
+	}
+}
+
+void skinThreaded(Mesh& mesh, unsigned int threadCount, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+	std::vector<glm::vec3> threadMin(threadCount);
+	std::vector<glm::vec3> threadMax(threadCount);
+	auto worker = [&](unsigned int index) {
+		uint32_t begin = (uint32_t)((uint64_t)kVertexCount * index / threadCount);
+		uint32_t end = (uint32_t)((uint64_t)kVertexCount * (index + 1) / threadCount);
+		skinLinear(mesh.positions.data() + begin, mesh.normals.data() + begin, mesh.skin.data() + begin, end - begin,
+			mesh.matrices.data(), mesh.skinnedPositions.data() + begin, mesh.skinnedNormals.data() + begin,
+			&threadMin[index], &threadMax[index]);
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker, i);
+	worker(0);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	boundsMin = glm::vec3(FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX);
+	for (unsigned int i = 0; i < threadCount; i++) {
+		boundsMin = glm::min(boundsMin, threadMin[i]);
+		boundsMax = glm::max(boundsMax, threadMax[i]);
+	}
+}
+
+void print(const char* name, double time) {
+	std::printf("  %-24s %8.3f ms %8.1f M vertices/s\n", name, time * 1000.0, kVertexCount / time / 1000000.0);
+}
+
+}
+
+
+int main() {
+	Mesh mesh = makeMesh();
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+#if defined(__AVX__)
+	std::printf("%u vertices, %u joints, avx\n", kVertexCount, kJointCount);
+#else
+	std::printf("%u vertices, %u joints, sse\n", kVertexCount, kJointCount);
+#endif
+	print("glm", measure([&]() { skinGlm(mesh); }));
+	print("linear", measure([&]() {
+		skinLinear(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, mesh.matrices.data(),
+			mesh.skinnedPositions.data(), mesh.skinnedNormals.data());
+	}));
+	print("linear with bounds", measure([&]() {
+		skinLinear(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, mesh.matrices.data(),
+			mesh.skinnedPositions.data(), mesh.skinnedNormals.data(), &boundsMin, &boundsMax);
+	}));
+	print("dual quaternion", measure([&]() {
+		skinDualQuaternion(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, mesh.dualQuaternions.data(),
+			mesh.skinnedPositions.data(), mesh.skinnedNormals.data(), &boundsMin, &boundsMax);
+	}));
+	double paletteTime = measure([&]() { computeDualQuaternions(mesh.matrices.data(), kJointCount, mesh.dualQuaternions.data()); });
+	std::printf("  dual quaternion palette  %8.3f us\n", paletteTime * 1000000.0);
+
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	double singleTime = 0.0;
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+		double time = measure([&]() { skinThreaded(mesh, threadCount, boundsMin, boundsMax); });
+		if (threadCount == 1)
+			singleTime = time;
+		std::printf("  linear, %2u threads       %8.3f ms %8.1f M vertices/s %6.2fx\n", threadCount, time * 1000.0,
+			kVertexCount / time / 1000000.0, singleTime / time);
+		if (threadCount == maxThreadCount)
+			break;
+	}
+	keepValue(boundsMin);
+	keepValue(boundsMax);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,365 @@
+#ifndef _SPONZA_SCENE_H_
+#define _SPONZA_SCENE_H_
+
+#include "../../glm-master/glm/glm.hpp"
+#include "../../glm-master/glm/gtc/quaternion.hpp"
+
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// sponza for the benchmarks that want real geometry without assimp and d3d12. the triangles of a .gltf with an
+// external buffer are read, only positions and indices of triangle list primitives, flattened into world space.
+// sponza.bin is not in the repository, without it a procedural atrium of about the same layout and size stands in.
+
+struct ScenePrimitive {
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+};
+
+namespace sponza_scene {
+
+// just enough json for the gltf header.
+struct Value {
+	enum class Type { eNull, eNumber, eString, eArray, eObject };
+
+	Type type = Type::eNull;
+	double number = 0.0;
+	std::string string;
+	std::vector<Value> array;
+	std::map<std::string, Value> object;
+
+	const Value& operator[](const char* key) const {
+		static const Value null;
+		auto ite = object.find(key);
+		return ite == object.end() ? null : ite->second;
+	}
+	const Value& at(size_t index) const {
+		static const Value null;
+		return index < array.size() ? array[index] : null;
+	}
+	bool isNull() const { return type == Type::eNull; }
+	int toInt(int fallback = 0) const { return type == Type::eNumber ? (int)number : fallback; }
+	float toFloat(float fallback = 0.0f) const { return type == Type::eNumber ? (float)number : fallback; }
+};
+
+class Parser {
+public:
+	explicit Parser(const std::string& text) : m_text(text) {}
+
+	bool parse(Value& value) {
+		skipSpace();
+		if (m_pos >= m_text.size())
+			return false;
+
+		char c = m_text[m_pos];
+		if (c == '{') {
+			value.type = Value::Type::eObject;
+			m_pos++;
+			skipSpace();
+			if (consume('}'))
+				return true;
+			do {
+				Value key;
+				skipSpace();
+				if (!parse(key) || key.type != Value::Type::eString || !(skipSpace(), consume(':')))
+					return false;
+				if (!parse(value.object[key.string]))
+					return false;
+				skipSpace();
+			} while (consume(','));
+			return consume('}');
+		}
+		if (c == '[') {
+			value.type = Value::Type::eArray;
+			m_pos++;
+			skipSpace();
+			if (consume(']'))
+				return true;
+			do {
+				value.array.emplace_back();
+				if (!parse(value.array.back()))
+					return false;
+				skipSpace();
+			} while (consume(','));
+			return consume(']');
+		}
+		if (c == '"') {
+			value.type = Value::Type::eString;
+			m_pos++;
+			while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+				// escapes are kept as they are, gltf names and uris do not need them.
+				if (m_text[m_pos] == '\\')
+					value.string += m_text[m_pos++];
+				value.string += m_text[m_pos++];
+			}
+			return consume('"');
+		}
+		if (m_text.compare(m_pos, 4, "true") == 0 || m_text.compare(m_pos, 4, "null") == 0) {
+			value.type = m_text[m_pos] == 't' ? Value::Type::eNumber : Value::Type::eNull;
+			value.number = 1.0;
+			m_pos += 4;
+			return true;
+		}
+		if (m_text.compare(m_pos, 5, "false") == 0) {
+			value.type = Value::Type::eNumber;
+			m_pos += 5;
+			return true;
+		}
+
+		char* end = nullptr;
+		value.type = Value::Type::eNumber;
+		value.number = std::strtod(m_text.c_str() + m_pos, &end);
+		if (end == m_text.c_str() + m_pos)
+			return false;
+		m_pos = end - m_text.c_str();
+		return true;
+	}
+
+private:
+	void skipSpace() {
+		while (m_pos < m_text.size() && std::strchr(" \t\r\n", m_text[m_pos]))
+			m_pos++;
+	}
+	bool consume(char c) {
+		if (m_pos >= m_text.size() || m_text[m_pos] != c)
+			return false;
+		m_pos++;
+		return true;
+	}
+
+	const std::string& m_text;
+	size_t m_pos = 0;
+};
+
+inline glm::mat4 getNodeMatrix(const Value& node) {
+	const Value& matrix = node["matrix"];
+	if (!matrix.isNull()) {
+		glm::mat4 result;
+		for (int i = 0; i < 16; i++)
+			result[i / 4][i % 4] = matrix.at(i).toFloat();
+		return result;
+	}
+
+	const Value& t = node["translation"];
+	const Value& r = node["rotation"];
+	const Value& s = node["scale"];
+	glm::vec3 translation(t.at(0).toFloat(), t.at(1).toFloat(), t.at(2).toFloat());
+	glm::quat rotation(r.at(3).toFloat(1.0f), r.at(0).toFloat(), r.at(1).toFloat(), r.at(2).toFloat());
+	glm::vec3 scale(s.at(0).toFloat(1.0f), s.at(1).toFloat(1.0f), s.at(2).toFloat(1.0f));
+
+	glm::mat4 result = glm::mat4_cast(rotation);
+	result[0] *= scale.x;
+	result[1] *= scale.y;
+	result[2] *= scale.z;
+	result[3] = glm::vec4(translation, 1.0f);
+	return result;
+}
+
+// the bytes of an accessor element and the distance between elements.
+inline const uint8_t* getAccessorData(const Value& root, const std::vector<std::vector<uint8_t>>& buffers, const Value& accessor,
+	size_t elementSize, size_t& stride) {
+	const Value& view = root["bufferViews"].at(accessor["bufferView"].toInt(-1));
+	int buffer = view["buffer"].toInt(-1);
+	if (view.isNull() || buffer < 0 || buffer >= (int)buffers.size())
+		return nullptr;
+
+	stride = view["byteStride"].toInt(0) != 0 ? view["byteStride"].toInt() : elementSize;
+	size_t offset = (size_t)view["byteOffset"].toInt() + accessor["byteOffset"].toInt();
+	size_t count = accessor["count"].toInt();
+	if (count == 0 || offset + (count - 1) * stride + elementSize > buffers[buffer].size())
+		return nullptr;
+	return buffers[buffer].data() + offset;
+}
+
+inline bool readPrimitive(const Value& root, const std::vector<std::vector<uint8_t>>& buffers, const Value& primitive,
+	const glm::mat4& matrix, ScenePrimitive& result) {
+	if (primitive["mode"].toInt(4) != 4)
+		return false;
+
+	const Value& positions = root["accessors"].at(primitive["attributes"]["POSITION"].toInt(-1));
+	if (positions["componentType"].toInt() != 5126 || positions["type"].string != "VEC3")
+		return false;
+	size_t stride = 0;
+	const uint8_t* data = getAccessorData(root, buffers, positions, sizeof(glm::vec3), stride);
+	if (!data)
+		return false;
+
+	result.positions.resize(positions["count"].toInt());
+	for (size_t i = 0; i < result.positions.size(); i++) {
+		glm::vec3 position;
+		std::memcpy(&position, data + i * stride, sizeof(position));
+		result.positions[i] = glm::vec3(matrix * glm::vec4(position, 1.0f));
+		result.boundsMin = glm::min(result.boundsMin, result.positions[i]);
+		result.boundsMax = glm::max(result.boundsMax, result.positions[i]);
+	}
+
+	const Value& indices = root["accessors"].at(primitive["indices"].toInt(-1));
+	if (indices.isNull()) {
+		for (uint32_t i = 0; i < (uint32_t)result.positions.size(); i++)
+			result.indices.push_back(i);
+		return true;
+	}
+
+	int componentType = indices["componentType"].toInt();
+	size_t componentSize = componentType == 5121 ? 1 : componentType == 5123 ? 2 : componentType == 5125 ? 4 : 0;
+	if (componentSize == 0 || !(data = getAccessorData(root, buffers, indices, componentSize, stride)))
+		return false;
+
+	result.indices.resize(indices["count"].toInt());
+	for (size_t i = 0; i < result.indices.size(); i++) {
+		uint32_t index = 0;
+		std::memcpy(&index, data + i * stride, componentSize);
+		if (index >= result.positions.size())
+			return false;
+		result.indices[i] = index;
+	}
+	return true;
+}
+
+inline void readNode(const Value& root, const std::vector<std::vector<uint8_t>>& buffers, int nodeIndex,
+	const glm::mat4& parent, int depth, std::vector<ScenePrimitive>& primitives) {
+	const Value& node = root["nodes"].at(nodeIndex);
+	if (node.isNull() || depth > 64)
+		return;
+
+	glm::mat4 matrix = parent * getNodeMatrix(node);
+	const Value& mesh = root["meshes"].at(node["mesh"].toInt(-1));
+	for (const Value& primitive : mesh["primitives"].array) {
+		ScenePrimitive result;
+		if (readPrimitive(root, buffers, primitive, matrix, result))
+			primitives.push_back(std::move(result));
+	}
+	for (const Value& child : node["children"].array)
+		readNode(root, buffers, child.toInt(-1), matrix, depth + 1, primitives);
+}
+
+}
+
+// every triangle list primitive of the default scene, false when the file or one of its buffers is missing.
+inline bool loadGltfScene(const std::filesystem::path& filename, std::vector<ScenePrimitive>& primitives) {
+	using namespace sponza_scene;
+
+	primitives.clear();
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs)
+		return false;
+	std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	Value root;
+	Parser parser(text);
+	if (!parser.parse(root) || root.type != Value::Type::eObject)
+		return false;
+
+	std::vector<std::vector<uint8_t>> buffers;
+	for (const Value& buffer : root["buffers"].array) {
+		std::ifstream bin(filename.parent_path() / buffer["uri"].string, std::ios::binary);
+		if (!bin)
+			return false;
+		buffers.emplace_back((std::istreambuf_iterator<char>(bin)), std::istreambuf_iterator<char>());
+		if (buffers.back().size() < (size_t)buffer["byteLength"].toInt())
+			return false;
+	}
+
+	// without a scene every node that is nobody's child is a root.
+	std::vector<int> roots;
+	const Value& scene = root["scenes"].at(root["scene"].toInt());
+	if (scene.isNull()) {
+		std::vector<bool> isChild(root["nodes"].array.size());
+		for (const Value& node : root["nodes"].array) {
+			for (const Value& child : node["children"].array) {
+				if (child.toInt(-1) >= 0 && child.toInt() < (int)isChild.size())
+					isChild[child.toInt()] = true;
+			}
+		}
+		for (int i = 0; i < (int)isChild.size(); i++) {
+			if (!isChild[i])
+				roots.push_back(i);
+		}
+	}
+	else {
+		for (const Value& node : scene["nodes"].array)
+			roots.push_back(node.toInt(-1));
+	}
+	for (int node : roots)
+		readNode(root, buffers, node, glm::mat4(1.0f), 0, primitives);
+	return !primitives.empty();
+}
+
+// an axis aligned box as 12 triangles.
+inline void addBox(std::vector<ScenePrimitive>& primitives, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+	ScenePrimitive box;
+	for (int i = 0; i < 8; i++)
+		box.positions.push_back(glm::vec3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z));
+	box.indices = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+	box.boundsMin = boxMin;
+	box.boundsMax = boxMax;
+	primitives.push_back(std::move(box));
+}
+
+// a tessellated parallelogram, for triangle counts closer to the real meshes.
+inline void addGrid(std::vector<ScenePrimitive>& primitives, const glm::vec3& origin, const glm::vec3& u, const glm::vec3& v, int cellCount) {
+	ScenePrimitive grid;
+	for (int y = 0; y <= cellCount; y++) {
+		for (int x = 0; x <= cellCount; x++)
+			grid.positions.push_back(origin + u * ((float)x / cellCount) + v * ((float)y / cellCount));
+	}
+	for (int y = 0; y < cellCount; y++) {
+		for (int x = 0; x < cellCount; x++) {
+			uint32_t a = y * (cellCount + 1) + x;
+			grid.indices.insert(grid.indices.end(), { a, a + 1, a + cellCount + 1, a + 1, a + cellCount + 2, a + cellCount + 1 });
+		}
+	}
+	for (const glm::vec3& position : grid.positions) {
+		grid.boundsMin = glm::min(grid.boundsMin, position);
+		grid.boundsMax = glm::max(grid.boundsMax, position);
+	}
+	primitives.push_back(std::move(grid));
+}
+
+// sponza at the scale of the app is an atrium about 30 long, 13 wide and 12 high, with two floors of arcades on
+// the long sides. detail multiplies the tessellation of the walls and floors.
+inline void makeAtrium(std::vector<ScenePrimitive>& primitives, int detail) {
+	addGrid(primitives, glm::vec3(-15.0f, 0.0f, -6.5f), glm::vec3(30.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 13.0f), 64 * detail);
+	for (float side : { -1.0f, 1.0f }) {
+		// outer walls, the gallery floor and the columns of both arcades.
+		addGrid(primitives, glm::vec3(-15.0f, 0.0f, side * 6.5f), glm::vec3(30.0f, 0.0f, 0.0f), glm::vec3(0.0f, 12.0f, 0.0f), 48 * detail);
+		addGrid(primitives, glm::vec3(-15.0f, 0.0f, side * 4.0f), glm::vec3(30.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, side * 2.5f), 32 * detail);
+		addBox(primitives, glm::vec3(-15.0f, 3.8f, side * 4.0f - 0.2f), glm::vec3(15.0f, 4.4f, side * 4.0f + 0.2f));
+		addBox(primitives, glm::vec3(-15.0f, 7.8f, side * 4.0f - 0.2f), glm::vec3(15.0f, 8.4f, side * 4.0f + 0.2f));
+		for (int i = 0; i < 11; i++) {
+			float x = -13.5f + 2.7f * i;
+			addBox(primitives, glm::vec3(x - 0.3f, 0.0f, side * 4.0f - 0.3f), glm::vec3(x + 0.3f, 3.8f, side * 4.0f + 0.3f));
+			addBox(primitives, glm::vec3(x - 0.2f, 4.4f, side * 4.0f - 0.2f), glm::vec3(x + 0.2f, 7.8f, side * 4.0f + 0.2f));
+		}
+	}
+	for (float end : { -1.0f, 1.0f })
+		addGrid(primitives, glm::vec3(end * 15.0f, 0.0f, -6.5f), glm::vec3(0.0f, 0.0f, 13.0f), glm::vec3(0.0f, 12.0f, 0.0f), 32 * detail);
+	// the curtains hanging between the upper columns.
+	for (int i = 0; i < 6; i++) {
+		float x = -12.0f + 4.8f * i;
+		addGrid(primitives, glm::vec3(x - 1.0f, 4.6f, 3.8f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 3.0f, 0.0f), 12 * detail);
+	}
+}
+
+// sponza, or the atrium with a note when the file can not be loaded. true when the file was loaded.
+inline bool loadSponza(const char* filename, std::vector<ScenePrimitive>& primitives, int detail = 1) {
+	if (loadGltfScene(filename, primitives))
+		return true;
+
+	std::printf("%s could not be loaded, using the procedural atrium\n", filename);
+	makeAtrium(primitives, detail);
+	return false;
+}
+
+#endif
\ No newline at end of file
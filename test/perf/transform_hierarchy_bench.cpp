@@ -0,0 +1,163 @@
+#include "perf.h"
+
+#include "../../tools/transform_hierarchy.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 100000 nodes updated by the hierarchy with every node moved, over 1, 2, 4, ... threads, and with one node in the
+// middle moved, against the node tree the model used before: shared children, a raw parent, and a world matrix
+// pulled through the parents on access. the shapes are a random tree, chains of 64 like skeletons, a single chain
+// with the parents after their children, and one root with every other node below it.
+
+namespace {
+
+const uint32_t kNodeCount = 100000;
+
+// the node of tools/model.h before the hierarchy replaced it, cut down to what an update touches.
+class Node {
+public:
+	Node() : m_parent(nullptr), m_isDirty(true) {}
+
+	void dirtyUpdate() {
+		if (!m_isDirty)
+			return;
+
+		m_localMatrix = glm::mat4(m_localRotation) * glm::translate(glm::identity<glm::mat4>(), m_localPosition);
+		if (m_parent != nullptr)
+			m_worldMatrix = m_parent->worldMatrix() * m_localMatrix;
+		else
+			m_worldMatrix = m_localMatrix;
+		m_position = glm::vec3(m_worldMatrix[3][0], m_worldMatrix[3][1], m_worldMatrix[3][2]);
+		m_rotation = glm::quat(m_worldMatrix);
+	}
+
+	void setDirty() {
+		m_isDirty = true;
+		for (auto& ite : m_children)
+			ite->setDirty();
+	}
+
+	glm::mat4& worldMatrix() {
+		dirtyUpdate();
+		return m_worldMatrix;
+	}
+
+	glm::mat4 m_localMatrix;
+	glm::mat4 m_worldMatrix;
+	glm::vec3 m_localPosition;
+	glm::quat m_localRotation;
+	glm::vec3 m_position;
+	glm::quat m_rotation;
+	Node* m_parent;
+	std::vector<std::shared_ptr<Node>> m_children;
+	bool m_isDirty;
+};
+
+enum class Shape { eRandomTree, eChains, eDeepChain, eFlat };
+
+const char* kShapeNames[] = { "random tree", "chains of 64", "single chain", "flat" };
+
+std::vector<int32_t> makeParents(Shape shape, std::mt19937& random) {
+	std::vector<int32_t> parents(kNodeCount);
+	for (uint32_t i = 0; i < kNodeCount; i++) {
+		switch (shape) {
+		case Shape::eRandomTree: parents[i] = i == 0 ? -1 : (int32_t)(random() % i); break;
+		case Shape::eChains: parents[i] = i % 64 == 0 ? -1 : (int32_t)i - 1; break;
+		case Shape::eDeepChain: parents[i] = i + 1 < kNodeCount ? (int32_t)i + 1 : -1; break;
+		case Shape::eFlat: parents[i] = i == 0 ? -1 : 0; break;
+		}
+	}
+	return parents;
+}
+
+// the node tree, null for the single chain: setDirty and worldMatrix recurse once per level and would overflow the
+// stack on 100000 of them.
+double measureNodes(const std::vector<int32_t>& parents, const std::vector<glm::vec3>& positions, const std::vector<glm::quat>& rotations) {
+	std::vector<std::shared_ptr<Node>> nodes(kNodeCount);
+	for (auto& node : nodes)
+		node = std::make_shared<Node>();
+	for (uint32_t i = 0; i < kNodeCount; i++) {
+		nodes[i]->m_localPosition = positions[i];
+		nodes[i]->m_localRotation = rotations[i];
+		if (parents[i] >= 0) {
+			nodes[i]->m_parent = nodes[parents[i]].get();
+			nodes[parents[i]]->m_children.push_back(nodes[i]);
+		}
+	}
+
+	return measure([&]() {
+		for (uint32_t i = 0; i < kNodeCount; i++) {
+			if (parents[i] < 0)
+				nodes[i]->setDirty();
+		}
+		for (auto& node : nodes)
+			keepValue(node->worldMatrix());
+	});
+}
+
+}
+
+
+int main() {
+	const unsigned int maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<glm::vec3> positions(kNodeCount);
+	std::vector<glm::quat> rotations(kNodeCount);
+	for (uint32_t i = 0; i < kNodeCount; i++) {
+		positions[i] = glm::vec3(unit(random), unit(random), unit(random)) * 0.01f;
+		rotations[i] = glm::normalize(glm::quat(1.0f, unit(random) * 0.01f, unit(random) * 0.01f, unit(random) * 0.01f));
+	}
+
+	std::printf("%u nodes, times per update\n", kNodeCount);
+	for (Shape shape : { Shape::eRandomTree, Shape::eChains, Shape::eDeepChain, Shape::eFlat }) {
+		std::vector<int32_t> parents = makeParents(shape, random);
+		TransformHierarchy hierarchy;
+		if (!hierarchy.create(parents.data(), kNodeCount)) {
+			std::printf("failed creating the hierarchy\n");
+			return 1;
+		}
+		for (uint32_t i = 0; i < kNodeCount; i++) {
+			hierarchy.setLocalPosition(i, positions[i]);
+			hierarchy.setLocalRotation(i, rotations[i]);
+		}
+
+		std::printf("%s\n", kShapeNames[(int)shape]);
+		double singleTime = 0.0;
+		for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreadCount)) {
+			double time = measure([&]() {
+				for (uint32_t i = 0; i < kNodeCount; i++)
+					hierarchy.setLocalRotation(i, rotations[i]);
+				hierarchy.update(threadCount);
+			});
+			if (threadCount == 1)
+				singleTime = time;
+			std::printf("  all moved, %2u threads: %8.3f ms %8.2fx\n", threadCount, time * 1000.0, singleTime / time);
+			if (threadCount == maxThreadCount)
+				break;
+		}
+
+		uint32_t middle = hierarchy.getOrder()[kNodeCount / 2];
+		double partialTime = measure([&]() {
+			hierarchy.setLocalPosition(middle, positions[middle]);
+			hierarchy.update(maxThreadCount);
+		});
+		std::printf("  one moved:             %8.3f ms\n", partialTime * 1000.0);
+
+		if (shape == Shape::eDeepChain) {
+			std::printf("  node tree:             skipped, recurses once per level\n");
+			continue;
+		}
+		double nodeTime = measureNodes(parents, positions, rotations);
+		std::printf("  node tree:             %8.3f ms %8.2fx slower than 1 thread\n", nodeTime * 1000.0, nodeTime / singleTime);
+	}
+
+	return 0;
+}
\ No newline at end of file
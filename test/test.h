@@ -0,0 +1,21 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <cmath>
+
+// the cases of a test executable run in the order they are defined, a failed check is reported and the case keeps
+// running. the executable fails when any case did.
+int registerTestCase(const char* name, void (*function)());
+void reportCheckFailure(const char* file, int line, const char* expression);
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const int name##Registration = registerTestCase(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) reportCheckFailure(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_NEAR(a, b, epsilon) CHECK(std::fabs((double)(a) - (double)(b)) <= (double)(epsilon))
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "test.h"
+
+#include <cstdio>
+#include <vector>
+
+
+namespace {
+
+struct TestCase {
+	const char* name;
+	void (*function)();
+};
+
+std::vector<TestCase>& getTestCases() {
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+int s_failedCheckCount = 0;
+
+}
+
+
+int registerTestCase(const char* name, void (*function)()) {
+	getTestCases().push_back({ name, function });
+	return (int)getTestCases().size();
+}
+
+void reportCheckFailure(const char* file, int line, const char* expression) {
+	std::printf("%s(%d): check failed: %s\n", file, line, expression);
+	s_failedCheckCount++;
+}
+
+int main() {
+	int failedCount = 0;
+	for (const TestCase& testCase : getTestCases()) {
+		int checkCount = s_failedCheckCount;
+		testCase.function();
+
+		bool isPassed = s_failedCheckCount == checkCount;
+		std::printf("%s %s\n", isPassed ? "passed" : "FAILED", testCase.name);
+		if (!isPassed)
+			failedCount++;
+	}
+
+	std::printf("%d of %d cases failed\n", failedCount, (int)getTestCases().size());
+	return failedCount == 0 ? 0 : 1;
+}
\ No newline at end of file
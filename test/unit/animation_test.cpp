@@ -0,0 +1,192 @@
+#include "../test.h"
+
+#include "../../tools/animation.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+const uint32_t kJointCount = 24;
+const int kKeyCount = 61;
+const float kDuration = 2.0f;
+
+// a clip whose joints turn around their own axis and sway, sampled at 30 keys per second like an exported file.
+std::vector<AnimationTrackSource> makeTracks(uint32_t seed) {
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<AnimationTrackSource> tracks(kJointCount);
+	for (uint32_t joint = 0; joint < kJointCount; joint++) {
+		AnimationTrackSource& track = tracks[joint];
+		track.joint = joint;
+		glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+		float speed = unit(random) * 3.0f;
+		float sway = joint % 3 == 0 ? 0.2f : 0.0f;
+		for (int i = 0; i < kKeyCount; i++) {
+			float time = kDuration * i / (kKeyCount - 1);
+			track.positionTimes.push_back(time);
+			track.positions.push_back(glm::vec3(std::sin(time * 3.0f) * sway, 1.0f, 0.0f));
+			track.rotationTimes.push_back(time);
+			track.rotations.push_back(glm::angleAxis(speed * time, axis));
+			track.scaleTimes.push_back(time);
+			track.scales.push_back(glm::vec3(1.0f));
+		}
+	}
+	return tracks;
+}
+
+// the raw keys of a track at time, linear between them like the sampler.
+JointTransform sampleSource(const AnimationTrackSource& track, float time) {
+	float position = time / kDuration * (kKeyCount - 1);
+	int key = (std::min)((int)position, kKeyCount - 2);
+	float alpha = position - key;
+	JointTransform result;
+	result.position = glm::mix(track.positions[key], track.positions[key + 1], alpha);
+	result.rotation = glm::normalize(glm::slerp(track.rotations[key], track.rotations[key + 1], alpha));
+	result.scale = glm::mix(track.scales[key], track.scales[key + 1], alpha);
+	return result;
+}
+
+bool isSamePose(const std::vector<JointTransform>& a, const std::vector<JointTransform>& b) {
+	return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(JointTransform)) == 0;
+}
+
+}
+
+
+TEST_CASE(create) {
+	AnimationClip clip;
+	std::vector<AnimationTrackSource> tracks = makeTracks(1);
+	CHECK(clip.create("walk", kDuration, tracks));
+	CHECK(clip.getName() == "walk");
+	CHECK(clip.getSourceKeyCount() == kJointCount * kKeyCount * 3);
+	CHECK(clip.getKeyCount() < clip.getSourceKeyCount() / 2);
+	CHECK(clip.getMemorySize() < clip.getSourceKeyCount() * (sizeof(float) + sizeof(glm::vec3)) / 4);
+
+	// constant channels keep one key, a straight line keeps its ends.
+	AnimationTrackSource track;
+	track.joint = 0;
+	for (int i = 0; i < kKeyCount; i++) {
+		float time = kDuration * i / (kKeyCount - 1);
+		track.positionTimes.push_back(time);
+		track.positions.push_back(glm::vec3(time, 0.0f, 0.0f));
+		track.rotationTimes.push_back(time);
+		track.rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	}
+	CHECK(clip.create("line", kDuration, { track }));
+	CHECK(clip.getKeyCount() == 3);
+
+	// keys without times and a negative duration.
+	track.positionTimes.pop_back();
+	CHECK(!clip.create("broken", kDuration, { track }));
+	CHECK(!clip.create("broken", -1.0f, {}));
+}
+
+TEST_CASE(accuracy) {
+	std::vector<AnimationTrackSource> tracks = makeTracks(2);
+	AnimationClip clip;
+	CHECK(clip.create("walk", kDuration, tracks));
+
+	// the tolerances of the reduction plus what the 16 bit times and the 15 bit components add.
+	AnimationSampler sampler;
+	std::vector<JointTransform> pose(kJointCount);
+	float positionError = 0.0f;
+	float rotationError = 0.0f;
+	for (int i = 0; i < 1000; i++) {
+		float time = kDuration * i / 1000.0f;
+		sampler.sample(clip, time, pose.data());
+		for (uint32_t joint = 0; joint < kJointCount; joint++) {
+			JointTransform expected = sampleSource(tracks[joint], time);
+			positionError = (std::max)(positionError, glm::length(expected.position - pose[joint].position));
+			rotationError = (std::max)(rotationError, 1.0f - std::abs(glm::dot(expected.rotation, pose[joint].rotation)));
+		}
+	}
+	CHECK(positionError < 2e-4f);
+	CHECK(rotationError < 5e-5f);
+}
+
+TEST_CASE(cursors) {
+	std::vector<AnimationTrackSource> tracks = makeTracks(3);
+	AnimationClip clip;
+	CHECK(clip.create("walk", kDuration, tracks));
+
+	// forward, backward, wrapped and negative times sample the same as a sampler that starts at that time.
+	std::vector<float> times;
+	for (int i = 0; i < 200; i++)
+		times.push_back(kDuration * i / 100.0f - 0.5f);
+	std::shuffle(times.begin() + 100, times.end(), std::mt19937(4));
+
+	AnimationSampler sampler;
+	bool isSame = true;
+	for (float time : times) {
+		std::vector<JointTransform> pose(kJointCount);
+		std::vector<JointTransform> expected(kJointCount);
+		sampler.sample(clip, time, pose.data());
+		AnimationSampler fresh;
+		fresh.sample(clip, time, expected.data());
+		isSame = isSame && isSamePose(pose, expected);
+	}
+	CHECK(isSame);
+
+	// joints the clip does not animate are left alone.
+	std::vector<AnimationTrackSource> partial(tracks.begin(), tracks.begin() + 4);
+	CHECK(clip.create("partial", kDuration, partial));
+	std::vector<JointTransform> pose(kJointCount, { glm::vec3(7.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(2.0f) });
+	sampler.sample(clip, 0.5f, pose.data());
+	CHECK(pose[4].position == glm::vec3(7.0f) && pose[kJointCount - 1].scale == glm::vec3(2.0f));
+	CHECK(pose[0].position != glm::vec3(7.0f));
+}
+
+TEST_CASE(blend) {
+	glm::quat rotation = glm::angleAxis(1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+	JointTransform from = { glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) };
+	// the same rotation with the other sign, the blend takes the short way.
+	JointTransform to = { glm::vec3(2.0f, 0.0f, 0.0f), -rotation, glm::vec3(3.0f) };
+
+	JointTransform result;
+	blendPoses(&from, &to, 0.5f, 1, &result);
+	CHECK(glm::length(result.position - glm::vec3(1.0f, 0.0f, 0.0f)) < 1e-6f);
+	CHECK(glm::length(result.scale - glm::vec3(2.0f)) < 1e-6f);
+	CHECK(1.0f - std::abs(glm::dot(result.rotation, glm::angleAxis(0.5f, glm::vec3(0.0f, 1.0f, 0.0f)))) < 1e-5f);
+
+	blendPoses(&from, &to, 1.0f, 1, &result);
+	CHECK(1.0f - std::abs(glm::dot(result.rotation, rotation)) < 1e-6f);
+
+	// in place, three clips one after the other.
+	JointTransform pose = from;
+	blendPoses(&pose, &to, 0.5f, 1, &pose);
+	blendPoses(&pose, &from, 0.5f, 1, &pose);
+	CHECK(glm::length(pose.position - glm::vec3(0.5f, 0.0f, 0.0f)) < 1e-6f);
+}
+
+TEST_CASE(modelMatrices) {
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<int32_t> parents(kJointCount);
+	std::vector<JointTransform> pose(kJointCount);
+	for (uint32_t i = 0; i < kJointCount; i++) {
+		parents[i] = i == 0 ? -1 : (int32_t)(random() % i);
+		pose[i].position = glm::vec3(unit(random), unit(random), unit(random));
+		pose[i].rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+		pose[i].scale = glm::vec3(1.0f + 0.5f * unit(random), 1.0f, 1.0f + 0.5f * unit(random));
+	}
+
+	std::vector<glm::mat4> matrices(kJointCount);
+	computeModelMatrices(parents.data(), pose.data(), kJointCount, matrices.data());
+
+	std::vector<glm::mat4> expected(kJointCount);
+	float error = 0.0f;
+	for (uint32_t i = 0; i < kJointCount; i++) {
+		glm::mat4 local = glm::translate(glm::mat4(1.0f), pose[i].position) * glm::mat4_cast(pose[i].rotation) *
+			glm::scale(glm::mat4(1.0f), pose[i].scale);
+		expected[i] = parents[i] < 0 ? local : expected[parents[i]] * local;
+		for (int column = 0; column < 4; column++)
+			error = (std::max)(error, glm::length(expected[i][column] - matrices[i][column]) / (1.0f + glm::length(expected[i][column])));
+	}
+	CHECK(error < 1e-5f);
+}
\ No newline at end of file
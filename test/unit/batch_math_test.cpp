@@ -0,0 +1,170 @@
+#include "../test.h"
+
+#include "../../tools/batch_math.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// the counts around the widths of the paths, so every tail runs.
+const uint32_t kCounts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 17, 1001 };
+// written past the end, a path that stores one element too many changes it.
+const float kGuard = 77.0f;
+
+float getMaxError(const float* a, const float* b, size_t count) {
+	float error = 0.0f;
+	for (size_t i = 0; i < count; i++)
+		error = (std::max)(error, std::abs(a[i] - b[i]));
+	return error;
+}
+
+struct Inputs {
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec3> boundsMin;
+	std::vector<glm::vec3> boundsMax;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::mat4> a;
+	std::vector<glm::mat4> b;
+
+	Inputs(uint32_t count) {
+		std::mt19937 random(count + 1);
+		std::uniform_real_distribution<float> unit(-2.0f, 2.0f);
+		for (uint32_t i = 0; i < count; i++) {
+			glm::vec3 point(unit(random), unit(random), unit(random));
+			points.push_back(point);
+			boundsMin.push_back(point - glm::vec3(std::abs(unit(random))));
+			boundsMax.push_back(point + glm::vec3(std::abs(unit(random))));
+			scales.push_back(glm::vec3(unit(random), unit(random), unit(random)));
+			rotations.push_back(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+			glm::mat4 matrixA;
+			glm::mat4 matrixB;
+			for (int column = 0; column < 4; column++) {
+				for (int row = 0; row < 4; row++) {
+					matrixA[column][row] = unit(random);
+					matrixB[column][row] = unit(random);
+				}
+			}
+			a.push_back(matrixA);
+			b.push_back(matrixB);
+		}
+	}
+};
+
+// runs check at every level the cpu supports.
+template<class Function>
+void forEachLevel(Function&& check) {
+	SimdLevel supported = getSupportedSimdLevel();
+	for (int level = 0; level <= (int)supported; level++) {
+		setSimdLevel((SimdLevel)level);
+		CHECK(getSimdLevel() == (SimdLevel)level);
+		check();
+	}
+	setSimdLevel(supported);
+}
+
+}
+
+
+TEST_CASE(levels) {
+	SimdLevel supported = getSupportedSimdLevel();
+	setSimdLevel(SimdLevel::eAvx512);
+	CHECK(getSimdLevel() == supported);
+	setSimdLevel(SimdLevel::eScalar);
+	CHECK(getSimdLevel() == SimdLevel::eScalar);
+	setSimdLevel(supported);
+	std::printf("  supported level: %s\n", getSimdLevelName(supported));
+}
+
+TEST_CASE(transforms) {
+	forEachLevel([]() {
+		for (uint32_t count : kCounts) {
+			Inputs inputs(count);
+			glm::mat4 matrix = count > 0 ? inputs.a[0] : glm::mat4(1.0f);
+
+			std::vector<glm::vec3> points(count + 1, glm::vec3(kGuard));
+			transformPoints(matrix, inputs.points.data(), count, points.data());
+			float pointError = 0.0f;
+			for (uint32_t i = 0; i < count; i++)
+				pointError = (std::max)(pointError, glm::length(points[i] - glm::vec3(matrix * glm::vec4(inputs.points[i], 1.0f))));
+			CHECK(pointError < 1e-5f);
+			CHECK(points[count] == glm::vec3(kGuard));
+
+			// the box around the eight transformed corners.
+			std::vector<glm::vec3> resultMin(count + 1, glm::vec3(kGuard));
+			std::vector<glm::vec3> resultMax(count + 1, glm::vec3(kGuard));
+			transformBounds(matrix, inputs.boundsMin.data(), inputs.boundsMax.data(), count, resultMin.data(), resultMax.data());
+			float boundsError = 0.0f;
+			for (uint32_t i = 0; i < count; i++) {
+				glm::vec3 expectedMin(1e30f);
+				glm::vec3 expectedMax(-1e30f);
+				for (int corner = 0; corner < 8; corner++) {
+					glm::vec3 point((corner & 1) ? inputs.boundsMax[i].x : inputs.boundsMin[i].x, (corner & 2) ? inputs.boundsMax[i].y : inputs.boundsMin[i].y,
+						(corner & 4) ? inputs.boundsMax[i].z : inputs.boundsMin[i].z);
+					point = glm::vec3(matrix * glm::vec4(point, 1.0f));
+					expectedMin = glm::min(expectedMin, point);
+					expectedMax = glm::max(expectedMax, point);
+				}
+				boundsError = (std::max)(boundsError, glm::length(expectedMin - resultMin[i]) + glm::length(expectedMax - resultMax[i]));
+			}
+			CHECK(boundsError < 1e-4f);
+			CHECK(resultMin[count] == glm::vec3(kGuard) && resultMax[count] == glm::vec3(kGuard));
+		}
+	});
+}
+
+TEST_CASE(matrices) {
+	forEachLevel([]() {
+		for (uint32_t count : kCounts) {
+			Inputs inputs(count);
+			std::vector<glm::mat4> result(count + 1, glm::mat4(kGuard));
+			multiplyMatrices(inputs.a.data(), inputs.b.data(), count, result.data());
+			float error = 0.0f;
+			for (uint32_t i = 0; i < count; i++)
+				error = (std::max)(error, getMaxError(&result[i][0][0], &(inputs.a[i] * inputs.b[i])[0][0], 16));
+			CHECK(error < 1e-5f);
+			CHECK(result[count] == glm::mat4(kGuard));
+
+			glm::mat4 matrix = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+			multiplyMatrices(matrix, inputs.b.data(), count, result.data());
+			error = 0.0f;
+			for (uint32_t i = 0; i < count; i++)
+				error = (std::max)(error, getMaxError(&result[i][0][0], &(matrix * inputs.b[i])[0][0], 16));
+			CHECK(error < 1e-5f);
+			CHECK(result[count] == glm::mat4(kGuard));
+		}
+	});
+}
+
+TEST_CASE(quaternions) {
+	forEachLevel([]() {
+		for (uint32_t count : kCounts) {
+			Inputs inputs(count);
+			std::vector<glm::quat> normalized = inputs.rotations;
+			normalized.push_back(glm::quat(kGuard, kGuard, kGuard, kGuard));
+			normalizeQuaternions(normalized.data(), count);
+			float error = 0.0f;
+			for (uint32_t i = 0; i < count; i++)
+				error = (std::max)(error, getMaxError(&normalized[i][0], &glm::normalize(inputs.rotations[i])[0], 4));
+			CHECK(error < 1e-6f);
+			CHECK(normalized[count] == glm::quat(kGuard, kGuard, kGuard, kGuard));
+
+			// translation * rotation * scale.
+			std::vector<glm::mat4> result(count + 1, glm::mat4(kGuard));
+			composeTransforms(inputs.points.data(), normalized.data(), inputs.scales.data(), count, result.data());
+			error = 0.0f;
+			for (uint32_t i = 0; i < count; i++) {
+				glm::mat4 expected = glm::translate(glm::mat4(1.0f), inputs.points[i]) * glm::mat4_cast(normalized[i]) *
+					glm::scale(glm::mat4(1.0f), inputs.scales[i]);
+				error = (std::max)(error, getMaxError(&result[i][0][0], &expected[0][0], 16));
+			}
+			CHECK(error < 1e-5f);
+			CHECK(result[count] == glm::mat4(kGuard));
+		}
+	});
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "../test.h"
+
+#include "../../framework/shader_reflection.h"
+
+#include <climits>
+
+
+namespace {
+
+ShaderBinding makeBinding(const char* name, D3D12_DESCRIPTOR_RANGE_TYPE rangeType, UINT bindPoint, UINT bindCount = 1, UINT space = 0,
+	D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL) {
+	return { name, rangeType, bindPoint, bindCount, space, visibility };
+}
+
+// the bindings of rendering_cs.fx as dxc reflects them.
+ShaderReflection getRenderingFixture() {
+	ShaderReflection reflection;
+	reflection.addBinding(makeBinding("MatrixBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 0));
+	reflection.addBinding(makeBinding("ClosureConstant", D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1));
+	reflection.addBinding(makeBinding("visibilityBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0));
+	reflection.addBinding(makeBinding("vertexBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1));
+	reflection.addBinding(makeBinding("indexBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2));
+	reflection.addBinding(makeBinding("materialTextures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, UINT_MAX, 1));
+	reflection.addBinding(makeBinding("wrapSampler", D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 0));
+	reflection.addBinding(makeBinding("resultTex", D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0));
+	reflection.addConstantBuffer({ "ClosureConstant", 1, 0, 16, { { "closureId", 0, 4 }, { "tileOffset", 4, 4 } } });
+	reflection.setThreadGroupSize(8, 8, 1);
+	return reflection;
+}
+
+D3D12_SAMPLER_DESC getWrapSampler() {
+	D3D12_SAMPLER_DESC samplerDesc{};
+	samplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	return samplerDesc;
+}
+
+}
+
+
+TEST_CASE(reflectionFixture) {
+	ShaderReflection reflection = getRenderingFixture();
+	CHECK(reflection.getBindings().size() == 8);
+	CHECK(reflection.getThreadGroupSizeX() == 8 && reflection.getThreadGroupSizeY() == 8 && reflection.getThreadGroupSizeZ() == 1);
+
+	const ShaderConstantBufferLayout* layout = reflection.getConstantBuffer("ClosureConstant");
+	CHECK(layout && layout->bindPoint == 1 && layout->variables.size() == 2 && layout->variables[1].offset == 4);
+	CHECK(reflection.getConstantBuffer("MissingBuffer") == nullptr);
+}
+
+TEST_CASE(mergeSortsBindings) {
+	BindingLayout layout;
+	CHECK(layout.merge(getRenderingFixture()));
+
+	// cbuffers first, then srv, uav and samplers, by space and register.
+	const std::vector<ShaderBinding>& bindings = layout.getBindings();
+	CHECK(bindings.size() == 8);
+	if (bindings.size() != 8)
+		return;
+
+	const char* order[] = { "MatrixBuffer", "ClosureConstant", "visibilityBuffer", "vertexBuffer", "indexBuffer", "materialTextures", "resultTex", "wrapSampler" };
+	for (size_t i = 0; i < bindings.size(); i++)
+		CHECK(bindings[i].name == order[i]);
+	CHECK(layout.getError().empty());
+}
+
+TEST_CASE(mergeStages) {
+	// the same cbuffer in both stages becomes visible to all of them, a binding of one stage keeps its visibility.
+	std::vector<ShaderBinding> vs = {
+		makeBinding("MatrixBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 0, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX),
+		makeBinding("DrawConstant", D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX),
+		makeBinding("drawInstances", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX),
+	};
+	std::vector<ShaderBinding> ps = {
+		makeBinding("DrawConstant", D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL),
+	};
+
+	BindingLayout layout;
+	CHECK(layout.merge(vs));
+	CHECK(layout.merge(ps));
+	CHECK(layout.merge(ps));
+
+	const std::vector<ShaderBinding>& bindings = layout.getBindings();
+	CHECK(bindings.size() == 3);
+	if (bindings.size() != 3)
+		return;
+
+	CHECK(bindings[0].name == "MatrixBuffer" && bindings[0].visibility == D3D12_SHADER_VISIBILITY_VERTEX);
+	CHECK(bindings[1].name == "DrawConstant" && bindings[1].visibility == D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(bindings[2].name == "drawInstances" && bindings[2].visibility == D3D12_SHADER_VISIBILITY_VERTEX);
+}
+
+TEST_CASE(mergeConflicts) {
+	{
+		// two names on one register.
+		BindingLayout layout;
+		CHECK(layout.merge({ makeBinding("vertexBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1) }));
+		CHECK(!layout.merge({ makeBinding("indexBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1) }));
+		CHECK(layout.getError().find("'indexBuffer' and 'vertexBuffer' both bind t1, space0.") != std::string::npos);
+	}
+	{
+		// an array over a register of another binding.
+		BindingLayout layout;
+		CHECK(layout.merge({ makeBinding("textures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4) }));
+		CHECK(!layout.merge({ makeBinding("normalMap", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3) }));
+		CHECK(layout.getError().find("overlaps 'textures'") != std::string::npos);
+		CHECK(layout.getBindings().size() == 1);
+	}
+	{
+		// unbounded arrays overlap every later register of their space, other spaces and types are fine.
+		BindingLayout layout;
+		CHECK(layout.merge({ makeBinding("materialTextures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, UINT_MAX, 1) }));
+		CHECK(layout.merge({ makeBinding("visibilityBuffer", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 100) }));
+		CHECK(layout.merge({ makeBinding("resultTex", D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 100, 1, 1) }));
+		CHECK(!layout.merge({ makeBinding("lightTextures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 100, 1, 1) }));
+	}
+	{
+		// the same name with a different array size.
+		BindingLayout layout;
+		CHECK(layout.merge({ makeBinding("textures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4) }));
+		CHECK(!layout.merge({ makeBinding("textures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2) }));
+	}
+}
+
+TEST_CASE(build) {
+	BindingLayout layout;
+	layout.setStaticSampler("wrapSampler", getWrapSampler());
+	layout.setRootConstants("ClosureConstant", 2);
+	CHECK(layout.merge(getRenderingFixture()));
+
+	RootSignature rootSignature;
+	layout.build(&rootSignature);
+
+	// the sampler is static, everything else is one parameter.
+	CHECK(rootSignature.getParameterCount() == 7);
+	CHECK(rootSignature.getStaticSamplerCount() == 1);
+	CHECK(layout.getRootParameterIndex("MatrixBuffer") == 0);
+	CHECK(layout.getRootParameterIndex("ClosureConstant") == 1);
+	CHECK(layout.getRootParameterIndex("materialTextures") == 5);
+	CHECK(layout.getRootParameterIndex("resultTex") == 6);
+	CHECK(layout.getRootParameterIndex("wrapSampler") == -1);
+	CHECK(layout.getRootParameterIndex("missing") == -1);
+
+	CHECK(layout.validate(&rootSignature));
+	CHECK(layout.getError().empty());
+
+	Microsoft::WRL::ComPtr<ID3DBlob> signature;
+	Microsoft::WRL::ComPtr<ID3DBlob> error;
+	CHECK(rootSignature.serialize(D3D_ROOT_SIGNATURE_VERSION_1_1, D3D12_ROOT_SIGNATURE_FLAG_NONE, signature.ReleaseAndGetAddressOf(),
+		error.ReleaseAndGetAddressOf()));
+}
+
+TEST_CASE(validateMissingBinding) {
+	// rendering_cs.fx once read an index offset buffer no root signature provided.
+	RootSignature rootSignature;
+	rootSignature.addRootDescriptor(D3D12_SHADER_VISIBILITY_ALL, D3D12_ROOT_PARAMETER_TYPE_CBV, 0);
+	rootSignature.addConstants(D3D12_SHADER_VISIBILITY_ALL, 1, 2);
+	rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+	rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, UINT_MAX, D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE,
+		D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE, 1);
+	rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+	rootSignature.addStaticSampler(D3D12_SHADER_VISIBILITY_ALL, getWrapSampler(), 0);
+
+	BindingLayout layout;
+	CHECK(layout.merge(getRenderingFixture()));
+	CHECK(!layout.validate(&rootSignature));
+	CHECK(layout.getError().find("'indexBuffer' at t2, space0 is not provided by the root signature.") != std::string::npos);
+	// only the missing binding is reported.
+	CHECK(layout.getError().find("vertexBuffer") == std::string::npos);
+
+	rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 1);
+	BindingLayout fixed;
+	CHECK(fixed.merge(getRenderingFixture()));
+	CHECK(fixed.validate(&rootSignature));
+}
+
+TEST_CASE(validateArray) {
+	// every register of a bounded array has to be provided.
+	BindingLayout layout;
+	CHECK(layout.merge({ makeBinding("textures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4) }));
+
+	RootSignature partial;
+	partial.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 3);
+	CHECK(!layout.validate(&partial));
+
+	BindingLayout full;
+	CHECK(full.merge({ makeBinding("textures", D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4) }));
+	RootSignature rootSignature;
+	rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4);
+	CHECK(full.validate(&rootSignature));
+}
\ No newline at end of file
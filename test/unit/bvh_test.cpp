@@ -0,0 +1,376 @@
+#include "../test.h"
+
+#include "../../tools/bvh.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// random boxes of a few sizes, clustered so the sah has something to find.
+struct Boxes {
+	std::vector<glm::vec3> boundsMin;
+	std::vector<glm::vec3> boundsMax;
+
+	Boxes(uint32_t count, uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<glm::vec3> clusters(16);
+		for (glm::vec3& cluster : clusters)
+			cluster = glm::vec3(unit(random), unit(random), unit(random)) * 100.0f - 50.0f;
+
+		for (uint32_t i = 0; i < count; i++) {
+			glm::vec3 center = clusters[random() % clusters.size()] + glm::vec3(unit(random), unit(random), unit(random)) * 20.0f - 10.0f;
+			glm::vec3 extent = glm::vec3(unit(random), unit(random), unit(random)) * (i % 10 == 0 ? 5.0f : 0.5f);
+			boundsMin.push_back(center - extent);
+			boundsMax.push_back(center + extent);
+		}
+	}
+};
+
+// random triangles of about unit size.
+struct Triangles {
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	Triangles(uint32_t count, uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (uint32_t i = 0; i < count; i++) {
+			glm::vec3 center = glm::vec3(unit(random), unit(random), unit(random)) * 20.0f;
+			for (int j = 0; j < 3; j++) {
+				indices.push_back((uint32_t)positions.size());
+				positions.push_back(center + glm::vec3(unit(random), unit(random), unit(random)));
+			}
+		}
+	}
+};
+
+BvhRay makeRandomRay(std::mt19937& random, float range) {
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	BvhRay ray;
+	ray.origin = glm::vec3(unit(random), unit(random), unit(random)) * range;
+	do {
+		ray.direction = glm::vec3(unit(random), unit(random), unit(random));
+	} while (glm::dot(ray.direction, ray.direction) < 1e-2f);
+	ray.direction = glm::normalize(ray.direction);
+	// now and then axis aligned, where the slab test divides by zero.
+	if (random() % 8 == 0)
+		ray.direction = glm::vec3(0.0f, random() % 2 ? 1.0f : -1.0f, 0.0f);
+	return ray;
+}
+
+// the same tests the queries use, one primitive at a time.
+bool isBoxInside(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	for (int i = 0; i < 6; i++) {
+		glm::vec3 normal(planes[i]);
+		if (glm::dot(normal, center) + planes[i].w + glm::dot(glm::abs(normal), extent) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool isBoxInSphere(const glm::vec3& center, float radius, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 distance = glm::max(glm::max(boundsMin - center, center - boundsMax), glm::vec3(0.0f));
+	return glm::dot(distance, distance) <= radius * radius;
+}
+
+// the six planes of a perspective camera, normals pointing inside.
+void makeFrustum(const glm::vec3& eye, const glm::vec3& target, glm::vec4 planes[6]) {
+	glm::mat4 matrix = glm::transpose(glm::perspective(glm::radians(50.0f), 1.5f, 1.0f, 60.0f) * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+	planes[0] = matrix[3] + matrix[0];
+	planes[1] = matrix[3] - matrix[0];
+	planes[2] = matrix[3] + matrix[1];
+	planes[3] = matrix[3] - matrix[1];
+	planes[4] = matrix[2];
+	planes[5] = matrix[3] - matrix[2];
+}
+
+// every node bounds its children, leaves are small, and the leaves hold every primitive once.
+bool isTreeValid(const Bvh& bvh, const glm::vec3* boundsMin, const glm::vec3* boundsMax) {
+	const std::vector<BvhNode>& nodes = bvh.getNodes();
+	std::vector<int> seen(bvh.getPrimitiveCount(), 0);
+	bool isValid = true;
+
+	auto contains = [](const BvhNode& node, int i, const glm::vec3& childMin, const glm::vec3& childMax) {
+		return node.minX[i] <= childMin.x && node.minY[i] <= childMin.y && node.minZ[i] <= childMin.z &&
+			node.maxX[i] >= childMax.x && node.maxY[i] >= childMax.y && node.maxZ[i] >= childMax.z;
+	};
+
+	for (const BvhNode& node : nodes) {
+		for (int i = 0; i < 4; i++) {
+			if (node.child[i] < 0)
+				continue;
+
+			if (node.count[i] > 0) {
+				isValid = isValid && node.count[i] <= kBvhMaxLeafSize;
+				for (uint32_t j = (uint32_t)node.child[i]; j < (uint32_t)node.child[i] + node.count[i]; j++) {
+					uint32_t primitive = bvh.getOrder()[j];
+					seen[primitive]++;
+					isValid = isValid && contains(node, i, boundsMin[primitive], boundsMax[primitive]);
+				}
+			}
+			else {
+				const BvhNode& child = nodes[node.child[i]];
+				for (int k = 0; k < 4; k++) {
+					if (child.child[k] >= 0) {
+						isValid = isValid && contains(node, i, glm::vec3(child.minX[k], child.minY[k], child.minZ[k]),
+							glm::vec3(child.maxX[k], child.maxY[k], child.maxZ[k]));
+					}
+				}
+			}
+		}
+	}
+	return isValid && std::count(seen.begin(), seen.end(), 1) == (long)seen.size();
+}
+
+}
+
+
+TEST_CASE(buildStructure) {
+	Boxes boxes(20000, 1);
+	for (unsigned int threadCount : { 1u, 2u, 7u }) {
+		for (uint32_t count : { 0u, 1u, 3u, 5u, 100u, 20000u }) {
+			Bvh bvh;
+			CHECK(bvh.build(boxes.boundsMin.data(), boxes.boundsMax.data(), count, threadCount));
+			CHECK(bvh.getPrimitiveCount() == count);
+			CHECK(bvh.getNodes().empty() == (count == 0));
+			CHECK(isTreeValid(bvh, boxes.boundsMin.data(), boxes.boundsMax.data()));
+		}
+	}
+
+	// the parallel build splits the same way as the serial one.
+	Bvh serial;
+	Bvh parallel;
+	serial.build(boxes.boundsMin.data(), boxes.boundsMax.data(), 20000, 1);
+	parallel.build(boxes.boundsMin.data(), boxes.boundsMax.data(), 20000, 4);
+	CHECK(serial.getOrder() == parallel.getOrder());
+	CHECK(serial.getDepth() == parallel.getDepth());
+	// four wide with small leaves stays shallow.
+	CHECK(serial.getDepth() < 16);
+
+	// every primitive in one spot.
+	std::vector<glm::vec3> same(1000, glm::vec3(1.0f));
+	Bvh degenerate;
+	CHECK(degenerate.build(same.data(), same.data(), 1000, 1));
+	CHECK(isTreeValid(degenerate, same.data(), same.data()));
+}
+
+TEST_CASE(rayCastBoxes) {
+	Boxes boxes(5000, 2);
+	Bvh bvh;
+	bvh.build(boxes.boundsMin.data(), boxes.boundsMax.data(), 5000, 1);
+
+	std::mt19937 random(3);
+	int mismatchCount = 0;
+	int hitCount = 0;
+	for (int i = 0; i < 2000; i++) {
+		BvhRay ray = makeRandomRay(random, 60.0f);
+		if (i % 4 == 0)
+			ray.tMax = 30.0f;
+
+		int expected = -1;
+		float expectedT = ray.tMax;
+		for (uint32_t j = 0; j < 5000; j++) {
+			float t = Bvh::intersectBounds(ray, boxes.boundsMin[j], boxes.boundsMax[j]);
+			if (t >= ray.tMin && t < expectedT) {
+				expected = (int)j;
+				expectedT = t;
+			}
+		}
+
+		BvhRay test = ray;
+		int result = bvh.rayCast(test, [&boxes](uint32_t primitive, const BvhRay& r) {
+			return Bvh::intersectBounds(r, boxes.boundsMin[primitive], boxes.boundsMax[primitive]);
+		});
+		hitCount += expected >= 0 ? 1 : 0;
+		// ties between overlapping boxes may resolve either way, the distance may not.
+		if ((result >= 0) != (expected >= 0) || (result >= 0 && test.tMax != expectedT))
+			mismatchCount++;
+	}
+	CHECK(mismatchCount == 0);
+	CHECK(hitCount > 200);
+}
+
+TEST_CASE(rayCastTriangles) {
+	Triangles triangles(4000, 4);
+	TriangleBvh bvh;
+	CHECK(bvh.build(triangles.positions.data(), triangles.indices.data(), 4000, 2));
+	CHECK(bvh.getTriangleCount() == 4000);
+
+	std::mt19937 random(5);
+	int mismatchCount = 0;
+	int hitCount = 0;
+	for (int i = 0; i < 2000; i++) {
+		BvhRay ray = makeRandomRay(random, 25.0f);
+
+		// moller trumbore in double on every triangle.
+		int expected = -1;
+		double expectedT = ray.tMax;
+		for (uint32_t j = 0; j < 4000; j++) {
+			glm::dvec3 p0 = triangles.positions[j * 3 + 0];
+			glm::dvec3 edge1 = glm::dvec3(triangles.positions[j * 3 + 1]) - p0;
+			glm::dvec3 edge2 = glm::dvec3(triangles.positions[j * 3 + 2]) - p0;
+			glm::dvec3 direction = ray.direction;
+			glm::dvec3 p = glm::cross(direction, edge2);
+			double determinant = glm::dot(edge1, p);
+			if (std::abs(determinant) < 1e-12)
+				continue;
+			glm::dvec3 s = glm::dvec3(ray.origin) - p0;
+			double u = glm::dot(s, p) / determinant;
+			glm::dvec3 q = glm::cross(s, edge1);
+			double v = glm::dot(direction, q) / determinant;
+			double t = glm::dot(edge2, q) / determinant;
+			if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && t >= ray.tMin && t < expectedT) {
+				expected = (int)j;
+				expectedT = t;
+			}
+		}
+
+		BvhHit hit;
+		bool isHit = bvh.rayCast(ray, hit);
+		hitCount += expected >= 0 ? 1 : 0;
+		if (isHit != (expected >= 0)) {
+			// a ray through an edge or a vertex may go either way in float.
+			mismatchCount++;
+			continue;
+		}
+		if (isHit && (std::abs(hit.t - expectedT) > 1e-4 * (std::max)(1.0, expectedT) || hit.triangle != expected)) {
+			mismatchCount++;
+			continue;
+		}
+		if (isHit) {
+			// the barycentrics give back the hit point.
+			glm::vec3 p0 = triangles.positions[hit.triangle * 3 + 0];
+			glm::vec3 point = p0 + (triangles.positions[hit.triangle * 3 + 1] - p0) * hit.u + (triangles.positions[hit.triangle * 3 + 2] - p0) * hit.v;
+			if (glm::length(point - (ray.origin + ray.direction * hit.t)) > 1e-3f)
+				mismatchCount++;
+		}
+	}
+	CHECK(mismatchCount <= 2);
+	CHECK(hitCount > 200);
+}
+
+TEST_CASE(backfaceCulling) {
+	// counterclockwise seen from -z.
+	std::vector<glm::vec3> positions = { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f) };
+	std::vector<uint32_t> indices = { 0, 1, 2 };
+	TriangleBvh bvh;
+	bvh.build(positions.data(), indices.data(), 1, 1);
+
+	BvhRay front;
+	front.origin = glm::vec3(0.0f, 0.0f, -5.0f);
+	front.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+	BvhRay back = front;
+	back.origin.z = 5.0f;
+	back.direction.z = -1.0f;
+
+	BvhHit hit;
+	CHECK(bvh.rayCast(front, hit, 0.0f) && hit.triangle == 0 && std::abs(hit.t - 5.0f) < 1e-5f);
+	CHECK(bvh.rayCast(back, hit, 0.0f));
+	// one side passes each sign.
+	CHECK(bvh.rayCast(front, hit, 1.0f) != bvh.rayCast(back, hit, 1.0f));
+	CHECK(bvh.rayCast(front, hit, -1.0f) != bvh.rayCast(back, hit, -1.0f));
+	CHECK(bvh.rayCast(front, hit, 1.0f) != bvh.rayCast(front, hit, -1.0f));
+
+	// the ray interval.
+	front.tMax = 4.0f;
+	CHECK(!bvh.rayCast(front, hit));
+	front.tMax = FLT_MAX;
+	front.tMin = 6.0f;
+	CHECK(!bvh.rayCast(front, hit));
+}
+
+TEST_CASE(queries) {
+	Boxes boxes(10000, 6);
+	Bvh bvh;
+	bvh.build(boxes.boundsMin.data(), boxes.boundsMax.data(), 10000, 3);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	bool isFrustumEqual = true;
+	bool isSphereEqual = true;
+	size_t foundCount = 0;
+	for (int i = 0; i < 100; i++) {
+		glm::vec4 planes[6];
+		glm::vec3 eye = glm::vec3(unit(random), unit(random), unit(random)) * 70.0f;
+		makeFrustum(eye, glm::vec3(unit(random), unit(random), unit(random)) * 20.0f, planes);
+
+		std::vector<uint32_t> result;
+		bvh.queryFrustum(planes, result);
+		std::sort(result.begin(), result.end());
+		std::vector<uint32_t> expected;
+		for (uint32_t j = 0; j < 10000; j++) {
+			if (isBoxInside(planes, boxes.boundsMin[j], boxes.boundsMax[j]))
+				expected.push_back(j);
+		}
+		isFrustumEqual = isFrustumEqual && result == expected;
+		foundCount += expected.size();
+
+		glm::vec3 center = glm::vec3(unit(random), unit(random), unit(random)) * 60.0f;
+		float radius = (unit(random) + 1.0f) * 15.0f;
+		bvh.querySphere(center, radius, result);
+		std::sort(result.begin(), result.end());
+		expected.clear();
+		for (uint32_t j = 0; j < 10000; j++) {
+			if (isBoxInSphere(center, radius, boxes.boundsMin[j], boxes.boundsMax[j]))
+				expected.push_back(j);
+		}
+		isSphereEqual = isSphereEqual && result == expected;
+		foundCount += expected.size();
+	}
+	CHECK(isFrustumEqual);
+	CHECK(isSphereEqual);
+	CHECK(foundCount > 10000);
+
+	// an empty tree finds nothing.
+	Bvh empty;
+	empty.build(nullptr, nullptr, 0, 1);
+	std::vector<uint32_t> result(3, 0);
+	empty.querySphere(glm::vec3(0.0f), 1000.0f, result);
+	CHECK(result.empty());
+	BvhRay ray;
+	ray.direction = glm::vec3(1.0f, 0.0f, 0.0f);
+	CHECK(empty.rayCast(ray, [](uint32_t, const BvhRay&) { return 0.0f; }) == -1);
+}
+
+TEST_CASE(refit) {
+	Boxes boxes(8000, 8);
+	Bvh bvh;
+	bvh.build(boxes.boundsMin.data(), boxes.boundsMax.data(), 8000, 2);
+	std::vector<uint32_t> order = bvh.getOrder();
+
+	// move every box, as animated nodes would.
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (size_t i = 0; i < boxes.boundsMin.size(); i++) {
+		glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * 15.0f;
+		boxes.boundsMin[i] += offset;
+		boxes.boundsMax[i] += offset;
+	}
+	bvh.refit(boxes.boundsMin.data(), boxes.boundsMax.data());
+	CHECK(bvh.getOrder() == order);
+	CHECK(isTreeValid(bvh, boxes.boundsMin.data(), boxes.boundsMax.data()));
+
+	bool isEqual = true;
+	for (int i = 0; i < 50; i++) {
+		glm::vec3 center = glm::vec3(unit(random), unit(random), unit(random)) * 60.0f;
+		std::vector<uint32_t> result;
+		bvh.querySphere(center, 10.0f, result);
+		std::sort(result.begin(), result.end());
+		std::vector<uint32_t> expected;
+		for (uint32_t j = 0; j < 8000; j++) {
+			if (isBoxInSphere(center, 10.0f, boxes.boundsMin[j], boxes.boundsMax[j]))
+				expected.push_back(j);
+		}
+		isEqual = isEqual && result == expected;
+	}
+	CHECK(isEqual);
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "../test.h"
+
+#include "../../tools/draw_culler.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <vector>
+
+
+namespace {
+
+DrawInstance makeInstance(const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t index) {
+	DrawInstance instance;
+	instance.boundsMin = boundsMin;
+	instance.indexCount = 3 * (index + 1);
+	instance.boundsMax = boundsMax;
+	instance.indexOffset = 100 * index;
+	instance.vertexOffset = -(int32_t)index;
+	instance.closureId = index % 22;
+	instance.instanceOffset = 10 * index;
+	instance.instanceCount = index + 1;
+	return instance;
+}
+
+// a camera at z = -4 looking at the origin, 90 degrees vertically.
+glm::mat4 getWorldViewProj() {
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::half_pi<float>(), 16.0f / 9.0f, 0.1f, 100.0f);
+	return proj * view;
+}
+
+float getPlaneDistance(const glm::vec4& plane, const glm::vec3& point) {
+	return glm::dot(glm::vec3(plane), point) + plane.w;
+}
+
+// visible, right of the frustum, behind the camera, beyond the far plane, straddling the left plane.
+std::vector<DrawInstance> getScene() {
+	return {
+		makeInstance(glm::vec3(-1.0f), glm::vec3(1.0f), 0),
+		makeInstance(glm::vec3(100.0f, 0.0f, 0.0f), glm::vec3(101.0f, 1.0f, 1.0f), 1),
+		makeInstance(glm::vec3(-1.0f, -1.0f, -20.0f), glm::vec3(1.0f, 1.0f, -10.0f), 2),
+		makeInstance(glm::vec3(-1.0f, -1.0f, 200.0f), glm::vec3(1.0f, 1.0f, 210.0f), 3),
+		makeInstance(glm::vec3(-20.0f, -1.0f, 5.0f), glm::vec3(-10.0f, 1.0f, 6.0f), 4),
+		makeInstance(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(3.0f, 3.0f, 3.0f), 5),
+	};
+}
+
+}
+
+
+TEST_CASE(layouts) {
+	// the strides draw_cull_cs.fx and the command signature expect.
+	CHECK(sizeof(DrawInstance) == 48);
+	CHECK(sizeof(IndirectDrawCommand) == 28);
+	CHECK(sizeof(DrawCullConstant) % 16 == 0);
+}
+
+TEST_CASE(packCommand) {
+	DrawInstance instance = makeInstance(glm::vec3(0.0f), glm::vec3(1.0f), 7);
+	IndirectDrawCommand command = DrawCuller::packCommand(42, instance);
+	CHECK(command.drawId == 42);
+	CHECK(command.closureId == 7);
+	CHECK(command.indexCountPerInstance == 24);
+	CHECK(command.instanceCount == 8);
+	CHECK(command.startIndexLocation == 700);
+	CHECK(command.baseVertexLocation == -7);
+	CHECK(command.startInstanceLocation == 70);
+}
+
+TEST_CASE(extractFrustumPlanes) {
+	// the identity is the clip volume itself: x, y and z in -1..1.
+	glm::vec4 planes[6];
+	DrawCuller::extractFrustumPlanes(glm::mat4(1.0f), planes);
+	const glm::vec4 expected[6] = {
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+		glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), glm::vec4(0.0f, -1.0f, 0.0f, 1.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),
+	};
+	for (int i = 0; i < 6; i++)
+		CHECK_NEAR(glm::length(planes[i] - expected[i]), 0.0f, 1e-6f);
+
+	// a perspective camera: normalized, pointing inside, through the frustum corners.
+	glm::mat4 worldViewProj = getWorldViewProj();
+	DrawCuller::extractFrustumPlanes(worldViewProj, planes);
+	glm::mat4 inverse = glm::inverse(worldViewProj);
+	for (int i = 0; i < 6; i++) {
+		CHECK_NEAR(glm::length(glm::vec3(planes[i])), 1.0f, 1e-5f);
+		CHECK(getPlaneDistance(planes[i], glm::vec3(0.0f)) > 0.0f);
+	}
+
+	// the corners of the clip volume lie on three planes each.
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec4 clip((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f, 1.0f);
+		glm::vec4 world = inverse * clip;
+		glm::vec3 point = glm::vec3(world) / world.w;
+		int planeIndices[3] = { (corner & 1) ? 1 : 0, (corner & 2) ? 3 : 2, (corner & 4) ? 5 : 4 };
+		// the far corners are 100 units away.
+		float tolerance = (corner & 4) ? 1e-2f : 1e-4f;
+		for (int i : planeIndices)
+			CHECK_NEAR(getPlaneDistance(planes[i], point), 0.0f, tolerance);
+	}
+
+	// the near plane is 0.1 in front of the camera.
+	CHECK_NEAR(getPlaneDistance(planes[4], glm::vec3(0.0f, 0.0f, -3.9f)), 0.0f, 1e-4f);
+	CHECK(getPlaneDistance(planes[4], glm::vec3(0.0f, 0.0f, -3.95f)) < 0.0f);
+}
+
+TEST_CASE(isVisible) {
+	glm::vec4 planes[6];
+	DrawCuller::extractFrustumPlanes(getWorldViewProj(), planes);
+	std::vector<DrawInstance> scene = getScene();
+	const bool expected[] = { true, false, false, false, true, true };
+	for (size_t i = 0; i < scene.size(); i++)
+		CHECK(DrawCuller::isVisible(planes, scene[i].boundsMin, scene[i].boundsMax) == expected[i]);
+
+	// a box enclosing the camera.
+	CHECK(DrawCuller::isVisible(planes, glm::vec3(-1000.0f), glm::vec3(1000.0f)));
+}
+
+TEST_CASE(cull) {
+	std::vector<DrawInstance> scene = getScene();
+	DrawCuller culler;
+	culler.cull(scene, getWorldViewProj());
+
+	// survivors in draw order.
+	const std::vector<IndirectDrawCommand>& commands = culler.getCommands();
+	CHECK(commands.size() == 3);
+	if (commands.size() == 3) {
+		CHECK(commands[0].drawId == 0 && commands[1].drawId == 4 && commands[2].drawId == 5);
+		CHECK(commands[1].closureId == 4 && commands[1].startIndexLocation == 400);
+	}
+
+	culler.cull({}, getWorldViewProj());
+	CHECK(culler.getCommands().empty());
+}
+
+TEST_CASE(buildConstant) {
+	DrawCullConstant constant;
+	DrawCuller::buildConstant(getWorldViewProj(), 17, constant);
+	glm::vec4 planes[6];
+	DrawCuller::extractFrustumPlanes(getWorldViewProj(), planes);
+	CHECK(constant.worldViewProj == getWorldViewProj());
+	for (int i = 0; i < 6; i++)
+		CHECK(constant.frustumPlanes[i] == planes[i]);
+	CHECK(constant.drawCount == 17);
+	CHECK(constant.padding[0] == 0 && constant.padding[1] == 0 && constant.padding[2] == 0);
+}
+
+TEST_CASE(validate) {
+	std::vector<DrawInstance> scene = getScene();
+	DrawCuller culler;
+	culler.cull(scene, getWorldViewProj());
+	std::vector<IndirectDrawCommand> commands = culler.getCommands();
+	std::string error;
+
+	CHECK(culler.validate(scene, commands.data(), (uint32_t)commands.size(), error) && error.empty());
+	// the gpu appends in any order.
+	std::swap(commands[0], commands[2]);
+	CHECK(culler.validate(scene, commands.data(), (uint32_t)commands.size(), error));
+}
+
+TEST_CASE(validateNegative) {
+	std::vector<DrawInstance> scene = getScene();
+	DrawCuller culler;
+	culler.cull(scene, getWorldViewProj());
+	const std::vector<IndirectDrawCommand>& commands = culler.getCommands();
+	std::string error;
+
+	// a visible draw missing.
+	CHECK(!culler.validate(scene, commands.data(), 2, error));
+	CHECK(error == "draw 5: culled, expected visible.\n");
+
+	// a culled draw emitted.
+	std::vector<IndirectDrawCommand> wrong = commands;
+	wrong.push_back(DrawCuller::packCommand(1, scene[1]));
+	CHECK(!culler.validate(scene, wrong.data(), (uint32_t)wrong.size(), error));
+	CHECK(error == "draw 1: visible, expected culled.\n");
+
+	// a draw emitted twice, and an id past the draws.
+	wrong = commands;
+	wrong[1] = wrong[0];
+	CHECK(!culler.validate(scene, wrong.data(), (uint32_t)wrong.size(), error));
+	CHECK(error.find("repeated draw id 0") != std::string::npos);
+	wrong = commands;
+	wrong[2].drawId = 99;
+	CHECK(!culler.validate(scene, wrong.data(), (uint32_t)wrong.size(), error));
+	CHECK(error.find("invalid or repeated draw id 99") != std::string::npos);
+
+	// the arguments of a draw.
+	wrong = commands;
+	wrong[1].baseVertexLocation = 0;
+	CHECK(!culler.validate(scene, wrong.data(), (uint32_t)wrong.size(), error));
+	CHECK(error == "draw 4: arguments differ.\n");
+
+	// more draws than instances.
+	wrong.assign(scene.size() + 1, commands[0]);
+	CHECK(!culler.validate(scene, wrong.data(), (uint32_t)wrong.size(), error));
+	CHECK(error.find("gpu emitted 7 draws for 6 instances") != std::string::npos);
+}
+
+TEST_CASE(validateTolerance) {
+	// a box touching the right plane from outside may go either way on the gpu.
+	glm::vec4 planes[6];
+	glm::mat4 worldViewProj = getWorldViewProj();
+	DrawCuller::extractFrustumPlanes(worldViewProj, planes);
+	glm::vec4 corner = glm::inverse(worldViewProj) * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+	glm::vec3 onPlane = glm::vec3(corner) / corner.w;
+	// the box lies on the outside of the plane and touches it with one face.
+	glm::vec3 outside = onPlane - glm::vec3(planes[1]) * 0.5f;
+	std::vector<DrawInstance> scene = {
+		makeInstance(glm::min(onPlane, outside), glm::max(onPlane, outside), 0),
+	};
+	scene[0].boundsMin.y = scene[0].boundsMax.y = onPlane.y;
+	scene[0].boundsMin.z = scene[0].boundsMax.z = onPlane.z;
+
+	DrawCuller culler;
+	culler.cull(scene, worldViewProj);
+	std::string error;
+	IndirectDrawCommand command = DrawCuller::packCommand(0, scene[0]);
+	CHECK(culler.validate(scene, &command, 1, error, 1e-3f));
+	CHECK(culler.validate(scene, nullptr, 0, error, 1e-3f));
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "../test.h"
+
+#include "../../tools/frustum_culler.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+struct Box {
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+glm::mat4 getViewProj(const glm::vec3& eye, const glm::vec3& target) {
+	glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	return proj * view;
+}
+
+std::vector<Box> makeBoxes(size_t count, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.01f, 3.0f);
+	std::vector<Box> boxes(count);
+	for (auto& ite : boxes) {
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		ite = { center - extent, center + extent };
+	}
+	return boxes;
+}
+
+// how far the box reaches inside the clip volume, computed on the corners in clip space with glm: for every clip
+// plane the best corner, then the worst plane. negative when all the corners are outside one plane.
+float getClipReach(const glm::mat4& matrix, const Box& box) {
+	float reach[6] = { -1e30f, -1e30f, -1e30f, -1e30f, -1e30f, -1e30f };
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 point((corner & 1) ? box.boundsMax.x : box.boundsMin.x, (corner & 2) ? box.boundsMax.y : box.boundsMin.y,
+			(corner & 4) ? box.boundsMax.z : box.boundsMin.z);
+		glm::vec4 clip = matrix * glm::vec4(point, 1.0f);
+		const float distances[6] = { clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y, clip.w + clip.z, clip.w - clip.z };
+		for (int i = 0; i < 6; i++)
+			reach[i] = (std::max)(reach[i], distances[i]);
+	}
+
+	float result = reach[0];
+	for (int i = 1; i < 6; i++)
+		result = (std::min)(result, reach[i]);
+	return result;
+}
+
+std::vector<bool> toFlags(const std::vector<uint32_t>& visible, size_t count) {
+	std::vector<bool> flags(count, false);
+	for (auto& ite : visible)
+		flags[ite] = true;
+	return flags;
+}
+
+}
+
+
+TEST_CASE(boxesAgainstGlm) {
+	std::vector<Box> boxes = makeBoxes(100003, 1);
+	CullBounds bounds;
+	bounds.reserve(boxes.size());
+	for (auto& ite : boxes)
+		bounds.add(ite.boundsMin, ite.boundsMax);
+
+	const glm::vec3 eyes[] = { glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(30.0f, 20.0f, 50.0f), glm::vec3(-70.0f, 0.0f, 0.0f) };
+	for (auto& eye : eyes) {
+		glm::mat4 matrix = getViewProj(eye, glm::vec3(0.0f));
+		FrustumCuller culler;
+		culler.setMatrix(matrix);
+
+		std::vector<uint32_t> simd;
+		std::vector<uint32_t> scalar;
+		size_t simdCount = culler.cullBoxes(bounds, simd);
+		size_t scalarCount = culler.cullBoxesScalar(bounds, scalar);
+		CHECK(simdCount == simd.size() && scalarCount == scalar.size());
+		// the same distances in the same order, so the very same list.
+		CHECK(simd == scalar);
+		CHECK(!simd.empty() && simd.size() < boxes.size());
+
+		// the box is culled exactly when all its corners are outside one clip plane. boxes within rounding of a
+		// plane may go either way.
+		std::vector<bool> isVisible = toFlags(simd, boxes.size());
+		size_t mismatchCount = 0;
+		for (size_t i = 0; i < boxes.size(); i++) {
+			float reach = getClipReach(matrix, boxes[i]);
+			if (std::abs(reach) > 1e-3f && (reach > 0.0f) != isVisible[i])
+				mismatchCount++;
+		}
+		CHECK(mismatchCount == 0);
+	}
+}
+
+TEST_CASE(spheresAgainstGlm) {
+	std::vector<Box> boxes = makeBoxes(50001, 2);
+	CullBounds bounds;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> radius(0.0f, 4.0f);
+	std::vector<float> radii;
+	for (auto& ite : boxes) {
+		radii.push_back(radius(random));
+		bounds.add(ite.boundsMin, ite.boundsMax, radii.back());
+	}
+
+	glm::mat4 matrix = getViewProj(glm::vec3(10.0f, 5.0f, -30.0f), glm::vec3(0.0f, 0.0f, 10.0f));
+	FrustumCuller culler;
+	culler.setMatrix(matrix);
+
+	std::vector<uint32_t> simd;
+	std::vector<uint32_t> scalar;
+	culler.cullSpheres(bounds, simd);
+	culler.cullSpheresScalar(bounds, scalar);
+	CHECK(simd == scalar);
+
+	// the planes from the rows of the matrix, normalized, and the center distance against the radius.
+	glm::mat4 transposed = glm::transpose(matrix);
+	glm::vec4 planes[6] = {
+		transposed[3] + transposed[0], transposed[3] - transposed[0], transposed[3] + transposed[1],
+		transposed[3] - transposed[1], transposed[3] + transposed[2], transposed[3] - transposed[2],
+	};
+	std::vector<bool> isVisible = toFlags(simd, boxes.size());
+	size_t mismatchCount = 0;
+	for (size_t i = 0; i < boxes.size(); i++) {
+		glm::vec3 center = (boxes[i].boundsMin + boxes[i].boundsMax) * 0.5f;
+		float reach = 1e30f;
+		for (auto& plane : planes)
+			reach = (std::min)(reach, (glm::dot(glm::vec3(plane), center) + plane.w) / glm::length(glm::vec3(plane)) + radii[i]);
+		if (std::abs(reach) > 1e-3f && (reach > 0.0f) != isVisible[i])
+			mismatchCount++;
+	}
+	CHECK(mismatchCount == 0);
+
+	// the enclosing sphere never culls a box the box test keeps.
+	CullBounds enclosing;
+	for (auto& ite : boxes)
+		enclosing.add(ite.boundsMin, ite.boundsMax);
+	std::vector<uint32_t> visibleBoxes;
+	std::vector<uint32_t> visibleSpheres;
+	culler.cullBoxes(enclosing, visibleBoxes);
+	culler.cullSpheres(enclosing, visibleSpheres);
+	std::vector<bool> isSphereVisible = toFlags(visibleSpheres, boxes.size());
+	size_t lostCount = 0;
+	for (auto& ite : visibleBoxes)
+		lostCount += isSphereVisible[ite] ? 0 : 1;
+	CHECK(lostCount == 0);
+}
+
+TEST_CASE(remainders) {
+	// counts that leave every remainder of the 4 and 8 wide loops, all visible.
+	FrustumCuller culler;
+	culler.setMatrix(getViewProj(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f)));
+	for (size_t count = 0; count < 20; count++) {
+		CullBounds bounds;
+		for (size_t i = 0; i < count; i++)
+			bounds.add(glm::vec3(-0.5f + i * 0.01f), glm::vec3(0.5f));
+		std::vector<uint32_t> visible = { 12345 };
+		CHECK(culler.cullBoxes(bounds, visible) == count);
+		CHECK(culler.cullSpheres(bounds, visible) == count);
+		for (size_t i = 0; i < visible.size(); i++)
+			CHECK(visible[i] == i);
+	}
+
+	// and the same with the last one behind the camera.
+	CullBounds bounds;
+	for (size_t i = 0; i < 7; i++)
+		bounds.add(glm::vec3(-0.5f), glm::vec3(0.5f));
+	bounds.add(glm::vec3(-0.5f, -0.5f, -30.0f), glm::vec3(0.5f, 0.5f, -20.0f));
+	std::vector<uint32_t> visible;
+	CHECK(culler.cullBoxes(bounds, visible) == 7);
+	CHECK(culler.cullSpheres(bounds, visible) == 7);
+}
\ No newline at end of file
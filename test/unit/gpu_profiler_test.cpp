@@ -0,0 +1,215 @@
+#include "../test.h"
+
+#include "../../tools/gpu_profiler.h"
+#include "../../framework/null_device.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+// frames recorded on the null device, whose fence reaches the value of a frame lag frames after its submit.
+struct Timeline {
+	NullRenderDevice device;
+	RenderGpuProfiler profiler;
+	RenderHandle fence = kInvalidRenderHandle;
+	RenderHandle source = kInvalidRenderHandle;
+	RenderHandle dest = kInvalidRenderHandle;
+	std::unique_ptr<RenderCommandList> list;
+	uint64_t frameValue = 0;
+	// per frame the newest frame read back when it began, -1 before the first one.
+	std::vector<int64_t> timedFrames;
+
+	bool create(uint32_t frameCount, uint32_t passCount) {
+		fence = device.createFence();
+		BufferDesc desc;
+		desc.size = 1 << 16;
+		source = device.createBuffer(desc);
+		dest = device.createBuffer(desc);
+		list = device.createCommandList();
+		return profiler.create(&device, frameCount, passCount);
+	}
+
+	// passCount passes nested in a frame pass, each copying.
+	void run(uint32_t frameCount, uint32_t lag, uint32_t passCount = 2) {
+		for (uint32_t i = 0; i < frameCount; i++) {
+			profiler.beginFrame(device.getCompletedValue(fence));
+			GpuProfiler& timing = profiler.getProfiler();
+			timedFrames.push_back(timing.getPasses().empty() ? -1 : (int64_t)timing.getTimedFrame());
+			list->begin();
+			profiler.beginPass(list.get(), "frame");
+			for (uint32_t j = 0; j < passCount; j++) {
+				profiler.beginPass(list.get(), "copy");
+				list->copyBuffer(dest, 0, source, 0, 1 << 16);
+				profiler.endPass(list.get());
+			}
+			profiler.endPass(list.get());
+			profiler.endFrame(list.get(), ++frameValue);
+			list->end();
+
+			RenderCommandList* lists[] = { list.get() };
+			device.submit(lists, 1);
+			if (frameValue > lag)
+				device.signal(fence, frameValue - lag);
+		}
+	}
+
+	// lets the fence reach every frame and reads them in a frame without passes.
+	void finish() {
+		device.signal(fence, frameValue);
+		profiler.beginFrame(device.getCompletedValue(fence));
+		profiler.endFrame(list.get(), frameValue);
+	}
+
+	uint32_t getTimestampCount() const {
+		return static_cast<const NullCommandList*>(list.get())->getStream().countCommands(RenderCommandType::eWriteTimestamp);
+	}
+};
+
+}
+
+
+TEST_CASE(passTimes) {
+	// two frames of two passes on the profiler alone, at a microsecond per tick.
+	GpuProfiler profiler;
+	CHECK(!profiler.create(2, 2, 0));
+	CHECK(profiler.create(2, 2, 1000000));
+	CHECK(profiler.getQueryCount() == 8);
+
+	std::vector<uint64_t> readback(profiler.getQueryCount(), 0);
+	profiler.beginFrame(0, readback.data());
+	uint32_t outerBegin = profiler.beginPass("outer");
+	uint32_t innerBegin = profiler.beginPass("inner");
+	uint32_t innerEnd = profiler.endPass();
+	uint32_t outerEnd = profiler.endPass();
+	uint32_t first = 0;
+	uint32_t count = 0;
+	CHECK(profiler.getResolveRange(first, count));
+	CHECK(first == 0 && count == 4);
+	profiler.endFrame(1);
+
+	readback[outerBegin] = 1000;
+	readback[innerBegin] = 1500;
+	readback[innerEnd] = 3500;
+	readback[outerEnd] = 5000;
+
+	// not complete yet.
+	profiler.beginFrame(0, readback.data());
+	CHECK(profiler.getPasses().empty());
+	profiler.endFrame(2);
+
+	profiler.beginFrame(1, readback.data());
+	const std::vector<GpuPassTime>& passes = profiler.getPasses();
+	CHECK(passes.size() == 2);
+	if (passes.size() == 2) {
+		CHECK(strcmp(passes[0].name, "outer") == 0 && passes[0].depth == 0);
+		CHECK(strcmp(passes[1].name, "inner") == 0 && passes[1].depth == 1);
+		CHECK_NEAR(passes[0].time, 4.0, 1e-9);
+		CHECK_NEAR(passes[1].time, 2.0, 1e-9);
+		CHECK_NEAR(passes[1].average, 2.0, 1e-9);
+	}
+	CHECK_NEAR(profiler.getFrameTime(), 4.0, 1e-9);
+	CHECK(profiler.getTimedFrame() == 0);
+	// the frame just begun has no passes yet, so there is nothing to resolve.
+	CHECK(!profiler.getResolveRange(first, count));
+	CHECK(profiler.getSkippedCount() == 0);
+}
+
+TEST_CASE(frameLag) {
+	// the fence trails by two frames, three frames in flight are enough to time every one.
+	Timeline timeline;
+	CHECK(timeline.create(3, 4));
+	GpuProfiler& profiler = timeline.profiler.getProfiler();
+
+	timeline.run(12, 2);
+	CHECK(timeline.timedFrames.size() == 12);
+	for (size_t i = 0; i < timeline.timedFrames.size(); i++) {
+		// the fence has passed the frame three before when a frame begins.
+		CHECK(timeline.timedFrames[i] == (i < 3 ? -1 : (int64_t)i - 3));
+	}
+	CHECK(profiler.getSkippedCount() == 0);
+
+	timeline.finish();
+	CHECK(profiler.getTimedFrame() == 11);
+	const std::vector<GpuPassTime>& passes = profiler.getPasses();
+	CHECK(passes.size() == 3);
+	if (passes.size() == 3) {
+		CHECK(strcmp(passes[0].name, "frame") == 0 && passes[0].depth == 0);
+		CHECK(strcmp(passes[2].name, "copy") == 0 && passes[2].depth == 1);
+		CHECK(passes[0].time >= passes[1].time + passes[2].time);
+	}
+	CHECK(timeline.device.getErrors().empty());
+}
+
+TEST_CASE(skippedFrames) {
+	// two frames in flight against a fence three frames behind: the slot of a frame is still pending when it comes
+	// around, so the frame is recorded without queries instead of waiting. two frames are timed, two skipped.
+	Timeline timeline;
+	CHECK(timeline.create(2, 4));
+	GpuProfiler& profiler = timeline.profiler.getProfiler();
+
+	timeline.run(2, 3);
+	CHECK(profiler.getSkippedCount() == 0);
+	CHECK(timeline.getTimestampCount() == 6);
+
+	timeline.run(1, 3);
+	CHECK(profiler.getSkippedCount() == 1);
+	CHECK(timeline.getTimestampCount() == 0);
+
+	timeline.run(7, 3);
+	CHECK(profiler.getSkippedCount() == 4);
+	CHECK(timeline.timedFrames.back() == 5);
+
+	// once the fence catches up every frame is timed again.
+	timeline.finish();
+	CHECK(profiler.getTimedFrame() == 9);
+	timeline.run(4, 0);
+	CHECK(profiler.getSkippedCount() == 4);
+	CHECK(timeline.getTimestampCount() == 6);
+	CHECK(timeline.device.getErrors().empty());
+}
+
+TEST_CASE(passOverflow) {
+	// queries for two passes: the frame pass and its first copy are timed, the later copies are not. the end query
+	// of the open frame pass stays reserved, so it is never cut off by its children.
+	Timeline timeline;
+	CHECK(timeline.create(2, 2));
+	GpuProfiler& profiler = timeline.profiler.getProfiler();
+
+	timeline.run(1, 0, 5);
+	CHECK(timeline.getTimestampCount() == 4);
+	// every pass is still marked as an event, and no query was written out of range.
+	CHECK(static_cast<const NullCommandList*>(timeline.list.get())->getStream().countCommands(RenderCommandType::eBeginEvent) == 6);
+	timeline.finish();
+
+	const std::vector<GpuPassTime>& passes = profiler.getPasses();
+	CHECK(passes.size() == 2);
+	if (passes.size() == 2) {
+		CHECK(strcmp(passes[0].name, "frame") == 0);
+		CHECK(strcmp(passes[1].name, "copy") == 0);
+		CHECK(passes[0].time >= passes[1].time);
+	}
+	CHECK(timeline.device.getErrors().empty());
+
+	// an end without a begin is ignored.
+	timeline.profiler.beginFrame(timeline.device.getCompletedValue(timeline.fence));
+	CHECK(profiler.endPass() == GpuProfiler::kInvalidQuery);
+	timeline.profiler.endFrame(timeline.list.get(), timeline.frameValue);
+}
+
+TEST_CASE(unavailable) {
+	// a profiler that failed to create still marks the passes as events and writes no queries, so the frame records
+	// the same without timing.
+	Timeline timeline;
+	CHECK(!timeline.create(2, 0));
+	timeline.run(3, 0);
+	const CommandStream& stream = static_cast<const NullCommandList*>(timeline.list.get())->getStream();
+	CHECK(stream.countCommands(RenderCommandType::eBeginEvent) == 3);
+	CHECK(stream.countCommands(RenderCommandType::eEndEvent) == 3);
+	CHECK(timeline.getTimestampCount() == 0);
+	CHECK(stream.countCommands(RenderCommandType::eResolveTimestamps) == 0);
+	CHECK(timeline.profiler.getProfiler().getPasses().empty());
+	CHECK(timeline.device.getErrors().empty());
+}
\ No newline at end of file
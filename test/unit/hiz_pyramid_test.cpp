@@ -0,0 +1,262 @@
+#include "../test.h"
+
+#include "../../tools/hiz_pyramid.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// a depth buffer with padding at the end of the rows that build must not read.
+struct DepthBuffer {
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowPitch;
+	std::vector<float> texels;
+
+	DepthBuffer(uint32_t width, uint32_t height, float value) : width(width), height(height), rowPitch(width + 7),
+		texels((size_t)rowPitch * height, 2.0f) {
+		for (uint32_t y = 0; y < height; y++)
+			std::fill_n(texels.begin() + (size_t)y * rowPitch, width, value);
+	}
+
+	float& at(uint32_t x, uint32_t y) { return texels[(size_t)y * rowPitch + x]; }
+
+	void build(HiZPyramid& pyramid) const { pyramid.build(texels.data(), width, height, rowPitch); }
+};
+
+// the farthest mip 0 texel under a screen rectangle in uv, the texels the query has to cover.
+float getReferenceFarthest(const HiZPyramid& pyramid, glm::vec2 uvMin, glm::vec2 uvMax) {
+	uvMin = glm::clamp(uvMin, 0.0f, 1.0f);
+	uvMax = glm::clamp(uvMax, 0.0f, 1.0f);
+	uint32_t size = pyramid.getSize();
+	uint32_t minX = (std::min)((uint32_t)(uvMin.x * size), size - 1);
+	uint32_t minY = (std::min)((uint32_t)(uvMin.y * size), size - 1);
+	uint32_t maxX = (std::min)((uint32_t)(uvMax.x * size), size - 1);
+	uint32_t maxY = (std::min)((uint32_t)(uvMax.y * size), size - 1);
+
+	float farthest = 0.0f;
+	for (uint32_t y = minY; y <= maxY; y++) {
+		for (uint32_t x = minX; x <= maxX; x++)
+			farthest = (std::max)(farthest, pyramid.load(0, x, y));
+	}
+	return farthest;
+}
+
+// with an identity matrix the bounds are in ndc, x and y from -1 to 1 map to u from 0 to 1 and v from 1 to 0.
+bool isOccluded(const HiZPyramid& pyramid, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	return pyramid.isOccluded(glm::mat4(1.0f), boundsMin, boundsMax);
+}
+
+}
+
+
+TEST_CASE(create) {
+	HiZPyramid pyramid;
+	CHECK(!pyramid.create(0));
+	CHECK(!pyramid.create(100));
+	CHECK(!pyramid.create(1023));
+	CHECK(pyramid.create());
+	CHECK(pyramid.getSize() == kHiZSize);
+	CHECK(pyramid.getMipCount() == kHiZMipCount);
+	CHECK(pyramid.getMipSize(kHiZMipCount - 1) == 1);
+
+	CHECK(pyramid.create(1));
+	CHECK(pyramid.getMipCount() == 1);
+}
+
+TEST_CASE(depthFootprint) {
+	HiZPyramid pyramid;
+	pyramid.create(64);
+
+	// the footprints cover every depth texel, smaller and larger depth buffers and sizes that do not divide.
+	for (uint32_t depthSize : { 1u, 17u, 63u, 64u, 65u, 100u, 1080u, 1920u }) {
+		std::vector<int> coverCount(depthSize, 0);
+		uint32_t previousEnd = 0;
+		for (uint32_t texel = 0; texel < 64; texel++) {
+			uint32_t begin, end;
+			pyramid.getDepthFootprint(texel, depthSize, begin, end);
+			CHECK(begin < end && end <= depthSize);
+			CHECK(begin <= previousEnd);
+			previousEnd = end;
+			for (uint32_t i = begin; i < end; i++)
+				coverCount[i]++;
+		}
+		CHECK(previousEnd == depthSize);
+		CHECK(std::count(coverCount.begin(), coverCount.end(), 0) == 0);
+	}
+}
+
+TEST_CASE(reduction) {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	for (glm::uvec2 extent : { glm::uvec2(1920, 1080), glm::uvec2(100, 37), glm::uvec2(128, 128) }) {
+		DepthBuffer depth(extent.x, extent.y, 0.0f);
+		for (uint32_t y = 0; y < depth.height; y++) {
+			for (uint32_t x = 0; x < depth.width; x++)
+				depth.at(x, y) = unit(random);
+		}
+
+		HiZPyramid pyramid;
+		pyramid.create(128);
+		depth.build(pyramid);
+
+		// mip 0 against its footprint, the padding of 2 is never reached.
+		bool isMip0Equal = true;
+		for (uint32_t y = 0; y < 128; y++) {
+			uint32_t beginY, endY;
+			pyramid.getDepthFootprint(y, depth.height, beginY, endY);
+			for (uint32_t x = 0; x < 128; x++) {
+				uint32_t beginX, endX;
+				pyramid.getDepthFootprint(x, depth.width, beginX, endX);
+				float farthest = 0.0f;
+				for (uint32_t depthY = beginY; depthY < endY; depthY++) {
+					for (uint32_t depthX = beginX; depthX < endX; depthX++)
+						farthest = (std::max)(farthest, depth.at(depthX, depthY));
+				}
+				isMip0Equal = isMip0Equal && pyramid.load(0, x, y) == farthest;
+			}
+		}
+		CHECK(isMip0Equal);
+
+		// every texel of a mip is the farthest of the mip 0 texels under it.
+		bool isMipEqual = true;
+		for (uint32_t mip = 1; mip < pyramid.getMipCount(); mip++) {
+			uint32_t scale = 1u << mip;
+			for (uint32_t y = 0; y < pyramid.getMipSize(mip); y++) {
+				for (uint32_t x = 0; x < pyramid.getMipSize(mip); x++) {
+					float farthest = 0.0f;
+					for (uint32_t sourceY = y * scale; sourceY < (y + 1) * scale; sourceY++) {
+						for (uint32_t sourceX = x * scale; sourceX < (x + 1) * scale; sourceX++)
+							farthest = (std::max)(farthest, pyramid.load(0, sourceX, sourceY));
+					}
+					isMipEqual = isMipEqual && pyramid.load(mip, x, y) == farthest;
+				}
+			}
+		}
+		CHECK(isMipEqual);
+		CHECK(pyramid.load(pyramid.getMipCount() - 1, 0, 0) == *std::max_element(pyramid.getMip(0).begin(), pyramid.getMip(0).end()));
+	}
+}
+
+TEST_CASE(occlusion) {
+	HiZPyramid pyramid;
+	pyramid.create(64);
+	DepthBuffer depth(256, 256, 0.5f);
+	depth.build(pyramid);
+
+	// behind, in front and straddling the depth, and within the bias of it.
+	CHECK(isOccluded(pyramid, glm::vec3(-0.2f, -0.2f, 0.6f), glm::vec3(0.2f, 0.2f, 0.7f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.2f, -0.2f, 0.3f), glm::vec3(0.2f, 0.2f, 0.4f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.2f, -0.2f, 0.4f), glm::vec3(0.2f, 0.2f, 0.6f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.2f, -0.2f, 0.5f), glm::vec3(0.2f, 0.2f, 0.6f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.2f, -0.2f, 0.500001f), glm::vec3(0.2f, 0.2f, 0.6f)));
+
+	// the whole screen and a single texel.
+	CHECK(isOccluded(pyramid, glm::vec3(-1.0f, -1.0f, 0.6f), glm::vec3(1.0f, 1.0f, 0.7f)));
+	CHECK(isOccluded(pyramid, glm::vec3(0.01f, 0.01f, 0.6f), glm::vec3(0.02f, 0.02f, 0.7f)));
+}
+
+TEST_CASE(rectangleEdges) {
+	HiZPyramid pyramid;
+	pyramid.create(64);
+
+	// a single far depth texel in each corner of the screen, boxes over the corners reaching off-screen must see it
+	// whatever mip they end up in.
+	DepthBuffer depth(256, 256, 0.0f);
+	depth.at(0, 0) = 1.0f;
+	depth.at(255, 0) = 1.0f;
+	depth.at(0, 255) = 1.0f;
+	depth.at(255, 255) = 1.0f;
+	depth.build(pyramid);
+
+	for (float width : { 0.01f, 0.1f, 0.5f, 1.5f }) {
+		for (float signX : { -1.0f, 1.0f }) {
+			for (float signY : { -1.0f, 1.0f }) {
+				glm::vec3 corner(signX, signY, 0.5f);
+				CHECK(!isOccluded(pyramid, glm::min(corner, corner * glm::vec3(1.0f - width, 1.0f - width, 1.2f)),
+					glm::max(corner, corner * glm::vec3(1.0f + width, 1.0f + width, 1.2f))));
+				// ending exactly on the edge.
+				CHECK(!isOccluded(pyramid, glm::min(corner, corner * glm::vec3(1.0f - width, 1.0f - width, 1.2f)),
+					glm::max(corner, corner * glm::vec3(1.0f - width, 1.0f - width, 1.2f))));
+			}
+		}
+	}
+	// away from the corners boxes reaching off-screen are hidden, small enough that their mip does not reach a corner.
+	CHECK(isOccluded(pyramid, glm::vec3(0.9f, -0.1f, 0.5f), glm::vec3(1.5f, 0.1f, 0.6f)));
+	CHECK(isOccluded(pyramid, glm::vec3(-0.1f, -1.5f, 0.5f), glm::vec3(0.1f, -0.9f, 0.6f)));
+
+	// a rectangle straddling a texel boundary of every mip must look at both sides of it.
+	depth = DepthBuffer(256, 256, 0.0f);
+	depth.at(128, 100) = 1.0f;
+	depth.build(pyramid);
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.03f, 0.1f, 0.5f), glm::vec3(0.001f, 0.3f, 0.6f)));
+	CHECK(isOccluded(pyramid, glm::vec3(-0.03f, 0.1f, 0.5f), glm::vec3(-0.001f, 0.3f, 0.6f)));
+}
+
+TEST_CASE(conservative) {
+	// random depth and boxes, an occluded box is always behind every mip 0 texel under it, and with a fine enough
+	// rectangle the coarser mip rarely loses it.
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	HiZPyramid pyramid;
+	pyramid.create(128);
+	DepthBuffer depth(320, 180, 0.0f);
+	for (uint32_t y = 0; y < depth.height; y++) {
+		for (uint32_t x = 0; x < depth.width; x++)
+			depth.at(x, y) = 0.3f + 0.2f * unit(random) + (x > 200 ? 0.4f : 0.0f);
+	}
+	depth.build(pyramid);
+
+	size_t wrongCount = 0;
+	size_t occludedCount = 0;
+	size_t referenceCount = 0;
+	for (int i = 0; i < 20000; i++) {
+		glm::vec3 center(unit(random) * 2.6f - 1.3f, unit(random) * 2.6f - 1.3f, unit(random));
+		glm::vec3 extent(unit(random) * 0.3f, unit(random) * 0.3f, unit(random) * 0.1f);
+		glm::vec3 boundsMin = center - extent;
+		glm::vec3 boundsMax = center + extent;
+		bool result = isOccluded(pyramid, boundsMin, boundsMax);
+
+		glm::vec2 uvMin(boundsMin.x * 0.5f + 0.5f, 0.5f - boundsMax.y * 0.5f);
+		glm::vec2 uvMax(boundsMax.x * 0.5f + 0.5f, 0.5f - boundsMin.y * 0.5f);
+		bool isOnScreen = uvMin.x <= 1.0f && uvMin.y <= 1.0f && uvMax.x >= 0.0f && uvMax.y >= 0.0f;
+		bool reference = isOnScreen && getReferenceFarthest(pyramid, uvMin, uvMax) < boundsMin.z - 1e-5f;
+
+		wrongCount += result && !reference ? 1 : 0;
+		occludedCount += result ? 1 : 0;
+		referenceCount += reference ? 1 : 0;
+	}
+	CHECK(wrongCount == 0);
+	CHECK(occludedCount > referenceCount / 2);
+}
+
+TEST_CASE(earlyOuts) {
+	HiZPyramid pyramid;
+	pyramid.create(64);
+	// the nearest possible depth everywhere, so only the early-outs can keep a box.
+	DepthBuffer depth(128, 128, 0.0f);
+	depth.build(pyramid);
+
+	// entirely off each side of the screen is left to the frustum culling, not reported as occluded.
+	CHECK(!isOccluded(pyramid, glm::vec3(1.1f, -0.5f, 0.5f), glm::vec3(1.5f, 0.5f, 0.6f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-1.5f, -0.5f, 0.5f), glm::vec3(-1.1f, 0.5f, 0.6f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.5f, 1.1f, 0.5f), glm::vec3(0.5f, 1.5f, 0.6f)));
+	CHECK(!isOccluded(pyramid, glm::vec3(-0.5f, -1.5f, 0.5f), glm::vec3(0.5f, -1.1f, 0.6f)));
+	CHECK(isOccluded(pyramid, glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.6f)));
+
+	// through a camera: behind it, crossing the near plane and right in front of it.
+	glm::mat4 worldViewProj = glm::perspective(glm::half_pi<float>(), 1.0f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	CHECK(pyramid.isOccluded(worldViewProj, glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -10.0f)));
+	CHECK(!pyramid.isOccluded(worldViewProj, glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, 1.0f)));
+	CHECK(!pyramid.isOccluded(worldViewProj, glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 2.0f)));
+	CHECK(!pyramid.isOccluded(worldViewProj, glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, 0.0f)));
+}
\ No newline at end of file
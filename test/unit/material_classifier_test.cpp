@@ -0,0 +1,297 @@
+#include "../test.h"
+
+#include "../../tools/material_classifier.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+const uint32_t kBackground = 0xffffffff;
+
+// a uint2 per pixel, x is left as garbage since only y is read.
+struct VisibilityBuffer {
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowPitch;
+	std::vector<uint32_t> data;
+
+	VisibilityBuffer(uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t value) :
+		width(width), height(height), rowPitch(rowPitch), data((size_t)rowPitch * height * 2, 0)
+	{
+		for (size_t i = 0; i < data.size(); i += 2) {
+			data[i] = 0xdeadbeef;
+			data[i + 1] = value;
+		}
+	}
+
+	void set(uint32_t x, uint32_t y, uint32_t instanceId, uint32_t closureId) {
+		data[((size_t)y * rowPitch + x) * 2 + 1] = (instanceId << kClosureIdBits) | closureId;
+	}
+
+	void fill(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t closureId) {
+		for (uint32_t y = y0; y < y1; y++) {
+			for (uint32_t x = x0; x < x1; x++)
+				set(x, y, x + y, closureId);
+		}
+	}
+};
+
+bool classify(MaterialClassifier& classifier, const VisibilityBuffer& buffer, unsigned int threadCount = 1) {
+	return classifier.classify(buffer.data.data(), buffer.width, buffer.height, buffer.rowPitch, threadCount);
+}
+
+// the tile masks a pixel at a time.
+std::vector<uint32_t> computeTileMasks(const VisibilityBuffer& buffer) {
+	uint32_t tileCountX = (buffer.width + kMaterialTileSizeX - 1) / kMaterialTileSizeX;
+	uint32_t tileCountY = (buffer.height + kMaterialTileSizeY - 1) / kMaterialTileSizeY;
+	std::vector<uint32_t> masks((size_t)tileCountX * tileCountY, 0);
+	for (uint32_t y = 0; y < buffer.height; y++) {
+		for (uint32_t x = 0; x < buffer.width; x++) {
+			uint32_t closureId = buffer.data[((size_t)y * buffer.rowPitch + x) * 2 + 1] & kClosureIdMask;
+			if (closureId < kNumClosures)
+				masks[(y / kMaterialTileSizeY) * tileCountX + x / kMaterialTileSizeX] |= 1u << closureId;
+		}
+	}
+	return masks;
+}
+
+}
+
+
+TEST_CASE(invalidInput) {
+	MaterialClassifier classifier;
+	VisibilityBuffer buffer(16, 8, 16, kBackground);
+	CHECK(!classifier.classify(nullptr, 16, 8, 16));
+	CHECK(!classifier.classify(buffer.data.data(), 0, 8, 16));
+	CHECK(!classifier.classify(buffer.data.data(), 16, 0, 16));
+	CHECK(!classifier.classify(buffer.data.data(), 16, 8, 15));
+}
+
+TEST_CASE(partialEdgeTiles) {
+	// 40x20 is 3x3 tiles, the last column 8 pixels wide and the last row 4 pixels high. the row pitch leaves 8
+	// pixels of padding on every row that hold a closure id and must not be read.
+	VisibilityBuffer buffer(40, 20, 48, kBackground);
+	buffer.fill(40, 0, 48, 20, 9);
+	buffer.fill(0, 0, 16, 20, 3);
+	buffer.set(39, 19, 1, 7);
+	buffer.set(32, 16, 2, 5);
+	buffer.set(17, 8, 3, 0);
+
+	MaterialClassifier classifier;
+	CHECK(classify(classifier, buffer, 2));
+	CHECK(classifier.getTileCountX() == 3 && classifier.getTileCountY() == 3);
+
+	const std::vector<uint32_t> expectedMasks = {
+		1u << 3, 0, 0,
+		1u << 3, 1u << 0, 0,
+		1u << 3, 0, (1u << 5) | (1u << 7),
+	};
+	CHECK(classifier.getTileMasks() == expectedMasks);
+
+	std::vector<uint32_t> expectedCounts(kNumClosures, 0);
+	expectedCounts[0] = 1;
+	expectedCounts[3] = 3;
+	expectedCounts[5] = 1;
+	expectedCounts[7] = 1;
+	CHECK(classifier.getClosureTileCounts() == expectedCounts);
+
+	// a work item per (tile, closure) in tile order.
+	const std::vector<MaterialWorkItem>& workItems = classifier.getWorkItems();
+	const std::vector<MaterialWorkItem> expectedWorkItems = {
+		{ MaterialClassifier::makeTile(0, 0), 3 },
+		{ MaterialClassifier::makeTile(0, 1), 3 },
+		{ MaterialClassifier::makeTile(1, 1), 0 },
+		{ MaterialClassifier::makeTile(0, 2), 3 },
+		{ MaterialClassifier::makeTile(2, 2), 5 },
+		{ MaterialClassifier::makeTile(2, 2), 7 },
+	};
+	CHECK(workItems.size() == expectedWorkItems.size());
+	for (size_t i = 0; i < workItems.size() && i < expectedWorkItems.size(); i++)
+		CHECK(workItems[i].tile == expectedWorkItems[i].tile && workItems[i].closureId == expectedWorkItems[i].closureId);
+
+	const std::vector<uint32_t>& offsets = classifier.getClosureTileOffsets();
+	CHECK(offsets.size() == kNumClosures + 1);
+	CHECK(offsets[0] == 0 && offsets[1] == 1 && offsets[3] == 1 && offsets[4] == 4 && offsets[5] == 4 && offsets[6] == 5);
+	CHECK(offsets[7] == 5 && offsets[8] == 6 && offsets[kNumClosures] == 6);
+
+	const std::vector<uint32_t> expectedSorted = {
+		MaterialClassifier::makeTile(1, 1),
+		MaterialClassifier::makeTile(0, 0), MaterialClassifier::makeTile(0, 1), MaterialClassifier::makeTile(0, 2),
+		MaterialClassifier::makeTile(2, 2),
+		MaterialClassifier::makeTile(2, 2),
+	};
+	CHECK(classifier.getSortedTiles() == expectedSorted);
+}
+
+TEST_CASE(backgroundIds) {
+	VisibilityBuffer buffer(32, 16, 32, kBackground);
+	// the instance id above the closure bits is ignored, the first id past the closures and the cleared value are
+	// background.
+	buffer.set(0, 0, 0xffffff, 21);
+	buffer.set(1, 0, 5, kNumClosures);
+	buffer.set(2, 0, 5, kClosureIdMask);
+	buffer.set(20, 10, 0, 0);
+	buffer.set(21, 10, 0, 31);
+
+	MaterialClassifier classifier;
+	CHECK(classify(classifier, buffer));
+	const std::vector<uint32_t> expectedMasks = { 1u << 21, 0, 0, 1u << 0 };
+	CHECK(classifier.getTileMasks() == expectedMasks);
+	CHECK(classifier.getWorkItems().size() == 2);
+
+	// nothing but background.
+	VisibilityBuffer empty(100, 50, 100, kBackground);
+	CHECK(classify(classifier, empty));
+	CHECK(classifier.getWorkItems().empty());
+	CHECK(classifier.getSortedTiles().empty());
+	CHECK(classifier.getClosureTileOffsets()[kNumClosures] == 0);
+}
+
+TEST_CASE(randomBuffers) {
+	std::mt19937 random(7);
+	const uint32_t sizes[][3] = { { 1, 1, 1 }, { 17, 9, 17 }, { 333, 127, 340 }, { 1280, 720, 1280 } };
+	for (auto& size : sizes) {
+		VisibilityBuffer buffer(size[0], size[1], size[2], kBackground);
+		for (size_t i = 1; i < buffer.data.size(); i += 2) {
+			// mostly a few closures per tile, as a frame has.
+			uint32_t closureId = random() % 8 == 0 ? random() % 32 : (uint32_t)(i / 2 / 600) % kNumClosures;
+			buffer.data[i] = ((uint32_t)random() << kClosureIdBits) | closureId;
+		}
+
+		MaterialClassifier reference;
+		CHECK(classify(reference, buffer, 1));
+		CHECK(reference.getTileMasks() == computeTileMasks(buffer));
+
+		// the results do not depend on the thread count.
+		for (unsigned int threadCount : { 2u, 3u, 8u }) {
+			MaterialClassifier classifier;
+			CHECK(classify(classifier, buffer, threadCount));
+			CHECK(classifier.getTileMasks() == reference.getTileMasks());
+			CHECK(classifier.getSortedTiles() == reference.getSortedTiles());
+			CHECK(classifier.getClosureTileOffsets() == reference.getClosureTileOffsets());
+		}
+
+		// every tile of a closure is listed once, from its offset.
+		const std::vector<uint32_t>& offsets = reference.getClosureTileOffsets();
+		const std::vector<uint32_t>& sorted = reference.getSortedTiles();
+		for (uint32_t c = 0; c < kNumClosures; c++) {
+			for (uint32_t i = offsets[c]; i < offsets[c + 1]; i++) {
+				uint32_t tile = sorted[i];
+				uint32_t mask = reference.getTileMasks()[MaterialClassifier::getTileY(tile) * reference.getTileCountX() + MaterialClassifier::getTileX(tile)];
+				CHECK(mask & (1u << c));
+				if (i > offsets[c])
+					CHECK(sorted[i - 1] < tile);
+			}
+		}
+	}
+}
+
+TEST_CASE(validateGpuResults) {
+	VisibilityBuffer buffer(64, 32, 64, kBackground);
+	buffer.fill(0, 0, 64, 16, 2);
+	buffer.fill(16, 16, 48, 32, 4);
+
+	MaterialClassifier classifier;
+	CHECK(classify(classifier, buffer));
+	std::vector<uint32_t> counts = classifier.getClosureTileCounts();
+	std::vector<uint32_t> tiles = classifier.getSortedTiles();
+	std::string error;
+	CHECK(classifier.validate(counts.data(), tiles.data(), tiles.size(), error) && error.empty());
+
+	// the gpu appends in any order within a closure.
+	uint32_t begin = classifier.getClosureTileOffsets()[2];
+	uint32_t end = classifier.getClosureTileOffsets()[3];
+	std::reverse(tiles.begin() + begin, tiles.begin() + end);
+	CHECK(classifier.validate(counts.data(), tiles.data(), tiles.size(), error));
+
+	// a tile of another closure.
+	std::vector<uint32_t> wrongTiles = tiles;
+	std::swap(wrongTiles[begin], wrongTiles.back());
+	CHECK(!classifier.validate(counts.data(), wrongTiles.data(), wrongTiles.size(), error));
+	CHECK(error.find("closure 2: tile list differs") != std::string::npos);
+
+	std::vector<uint32_t> wrongCounts = counts;
+	wrongCounts[4]--;
+	CHECK(!classifier.validate(wrongCounts.data(), tiles.data(), tiles.size(), error));
+	CHECK(error.find("closure 4:") != std::string::npos);
+
+	CHECK(!classifier.validate(counts.data(), tiles.data(), tiles.size() - 1, error));
+}
+
+TEST_CASE(buildArguments) {
+	// 70 tiles of closure 1 and a tile each of closures 0 and 21.
+	VisibilityBuffer buffer(160, 56, 160, kBackground);
+	buffer.fill(0, 0, 160, 56, 1);
+	buffer.set(0, 0, 0, 0);
+	buffer.set(159, 55, 0, 21);
+
+	MaterialClassifier classifier;
+	CHECK(classify(classifier, buffer));
+	CHECK(classifier.getTileCountX() * classifier.getTileCountY() == 70);
+
+	std::vector<uint32_t> arguments;
+	classifier.buildArguments(arguments);
+	CHECK(arguments.size() == kMaterialArgumentCount);
+
+	// tile offset, closure id and a group per tile.
+	const uint32_t* closure0 = &arguments[0];
+	const uint32_t* closure1 = &arguments[1 * kClosureArgumentStride];
+	const uint32_t* closure2 = &arguments[2 * kClosureArgumentStride];
+	const uint32_t* closure21 = &arguments[21 * kClosureArgumentStride];
+	CHECK(closure0[0] == 0 && closure0[1] == 0 && closure0[2] == 1 && closure0[3] == 1 && closure0[4] == 1);
+	CHECK(closure1[0] == 1 && closure1[1] == 1 && closure1[2] == 70 && closure1[3] == 1 && closure1[4] == 1);
+	// an empty closure dispatches no groups.
+	CHECK(closure2[0] == 71 && closure2[1] == 2 && closure2[2] == 0 && closure2[3] == 1 && closure2[4] == 1);
+	CHECK(closure21[0] == 71 && closure21[1] == 21 && closure21[2] == 1);
+
+	// the sort pass takes kSortThreadCount tiles per group.
+	CHECK(arguments[kSortArgumentOffset + 0] == (72 + kSortThreadCount - 1) / kSortThreadCount);
+	CHECK(arguments[kSortArgumentOffset + 1] == 1 && arguments[kSortArgumentOffset + 2] == 1);
+
+	// nothing but background still writes the argument layout.
+	VisibilityBuffer empty(16, 8, 16, kBackground);
+	CHECK(classify(classifier, empty));
+	classifier.buildArguments(arguments);
+	CHECK(arguments.size() == kMaterialArgumentCount);
+	CHECK(arguments[3 * kClosureArgumentStride + 1] == 3 && arguments[3 * kClosureArgumentStride + 2] == 0);
+	CHECK(arguments[kSortArgumentOffset] == 0);
+
+	// before the first classify everything is zero.
+	MaterialClassifier unused;
+	unused.buildArguments(arguments);
+	CHECK(arguments == std::vector<uint32_t>(kMaterialArgumentCount, 0));
+}
+
+TEST_CASE(validateArguments) {
+	VisibilityBuffer buffer(64, 32, 64, kBackground);
+	buffer.fill(0, 0, 64, 16, 2);
+	buffer.fill(16, 16, 48, 32, 4);
+
+	MaterialClassifier classifier;
+	CHECK(classify(classifier, buffer));
+	std::vector<uint32_t> arguments;
+	classifier.buildArguments(arguments);
+
+	std::string error;
+	CHECK(classifier.validateArguments(arguments.data(), error) && error.empty());
+
+	std::vector<uint32_t> wrong = arguments;
+	wrong[4 * kClosureArgumentStride + 2]++;
+	CHECK(!classifier.validateArguments(wrong.data(), error));
+	CHECK(error == "closure 4 group count x: " + std::to_string(wrong[4 * kClosureArgumentStride + 2]) + ", expected " +
+		std::to_string(arguments[4 * kClosureArgumentStride + 2]) + ".\n");
+
+	wrong = arguments;
+	wrong[5 * kClosureArgumentStride + 0] = 0;
+	wrong[5 * kClosureArgumentStride + 1] = 6;
+	CHECK(!classifier.validateArguments(wrong.data(), error));
+	CHECK(error.find("closure 5 tile offset") != std::string::npos && error.find("closure 5 closure id") != std::string::npos);
+
+	wrong = arguments;
+	wrong[kSortArgumentOffset + 2] = 0;
+	CHECK(!classifier.validateArguments(wrong.data(), error));
+	CHECK(error == "sort group count 2: 0, expected 1.\n");
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "../test.h"
+
+#include "../../tools/model.h"
+
+#include <dxgi1_4.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "model_test";
+const std::filesystem::path kTruckDirectory = "models/CesiumMilkTruck/glTF";
+// the vertices of the wheel accessor and the two translations of the wheel nodes along x.
+const int kWheelVertexCount = 828;
+const float kWheelDistance = 1.432669997215271f + 1.352329969406128f;
+
+// warp, so the test runs without a gpu.
+bool createDevice(Microsoft::WRL::ComPtr<ID3D12Device>& device, Microsoft::WRL::ComPtr<ID3D12CommandQueue>& queue) {
+	Microsoft::WRL::ComPtr<IDXGIFactory4> factory;
+	Microsoft::WRL::ComPtr<IDXGIAdapter> adapter;
+	D3D12_COMMAND_QUEUE_DESC desc = {};
+	desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+	return SUCCEEDED(CreateDXGIFactory1(IID_PPV_ARGS(factory.GetAddressOf()))) &&
+		SUCCEEDED(factory->EnumWarpAdapter(IID_PPV_ARGS(adapter.GetAddressOf()))) &&
+		SUCCEEDED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(device.GetAddressOf()))) &&
+		SUCCEEDED(device->CreateCommandQueue(&desc, IID_PPV_ARGS(queue.GetAddressOf())));
+}
+
+bool isTruckPresent() {
+	if (std::filesystem::exists(kTruckDirectory / "CesiumMilkTruck.gltf"))
+		return true;
+	std::printf("  %s is missing, skipped\n", (kTruckDirectory / "CesiumMilkTruck.gltf").string().c_str());
+	return false;
+}
+
+bool importModel(Model& model, const std::filesystem::path& filename) {
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue;
+	if (!createDevice(device, queue))
+		return false;
+	std::string folder = filename.parent_path().string() + "/";
+	return model.create(device.Get(), queue.Get(), folder.c_str(), filename.string().c_str());
+}
+
+// the truck with a copy of the wheel mesh in front of the others that the second wheel references instead, so
+// the file has two identical meshes the import has to merge again.
+std::filesystem::path writeDuplicatedWheels() {
+	std::ifstream ifs(kTruckDirectory / "CesiumMilkTruck.gltf");
+	std::stringstream stream;
+	stream << ifs.rdbuf();
+	std::string text = stream.str();
+
+	// the body moves to mesh 2 and the second wheel to mesh 1.
+	size_t body = text.find("\"mesh\": 1,");
+	size_t secondWheel = text.find("\"mesh\": 0,", text.find("\"mesh\": 0,") + 1);
+	size_t meshes = text.find("\"meshes\": [");
+	if (body == std::string::npos || secondWheel == std::string::npos || meshes == std::string::npos)
+		return std::filesystem::path();
+	text.replace(body, 10, "\"mesh\": 2,");
+	text.replace(secondWheel, 10, "\"mesh\": 1,");
+
+	size_t wheelsBegin = text.find('{', meshes);
+	size_t wheelsEnd = text.rfind('{', text.find("\"Cesium_Milk_Truck\"", meshes));
+	text.insert(wheelsBegin, text.substr(wheelsBegin, wheelsEnd - wheelsBegin));
+
+	std::filesystem::create_directories(kDirectory);
+	for (const char* name : { "CesiumMilkTruck_data.bin", "CesiumMilkTruck.jpg" })
+		std::filesystem::copy_file(kTruckDirectory / name, kDirectory / name, std::filesystem::copy_options::overwrite_existing);
+	std::ofstream ofs(kDirectory / "CesiumMilkTruck.gltf", std::ios::trunc);
+	ofs << text;
+	return kDirectory / "CesiumMilkTruck.gltf";
+}
+
+// the wheel mesh is drawn twice, the three primitives of the body once each, and the instances of a mesh are
+// contiguous.
+void checkTruck(Model& model) {
+	CHECK(model.meshCount() == 4);
+	CHECK(model.instanceCount() == 5);
+
+	int wheel = -1;
+	int onceCount = 0;
+	for (int i = 0; i < model.meshCount(); i++) {
+		if (model.meshInstanceCount(i) == 2)
+			wheel = i;
+		onceCount += model.meshInstanceCount(i) == 1 ? 1 : 0;
+		for (int j = 0; j < model.meshInstanceCount(i); j++)
+			CHECK(model.instanceMesh(model.meshInstanceOffset(i) + j) == i);
+	}
+	CHECK(wheel != -1);
+	CHECK(onceCount == 3);
+	if (wheel == -1)
+		return;
+	CHECK(model.vertexCount(wheel) == kWheelVertexCount);
+
+	// the wheels are different nodes with their own transforms.
+	int first = model.meshInstanceOffset(wheel);
+	CHECK(model.instanceNode(first) != model.instanceNode(first + 1));
+	glm::vec3 a = glm::vec3(model.instanceMatrix(first)[3]);
+	glm::vec3 b = glm::vec3(model.instanceMatrix(first + 1)[3]);
+	CHECK_NEAR(glm::length(a - b), kWheelDistance, 1e-4f);
+
+	// the box of the root holds the center of every instance, the wheel nodes each hold their own.
+	for (int i = 0; i < model.instanceCount(); i++) {
+		int mesh = model.instanceMesh(i);
+		glm::vec3 center = glm::vec3(model.instanceMatrix(i) * glm::vec4((model.boundsMin(mesh) + model.boundsMax(mesh)) * 0.5f, 1.0f));
+		for (uint32_t node : { 0u, model.instanceNode(i) }) {
+			CHECK(glm::all(glm::greaterThanEqual(center, model.nodeBoundsMin(node) - 1e-4f)));
+			CHECK(glm::all(glm::lessThanEqual(center, model.nodeBoundsMax(node) + 1e-4f)));
+		}
+	}
+}
+
+}
+
+
+TEST_CASE(missingFile) {
+	Model model;
+	CHECK(!importModel(model, kDirectory / "missing.gltf"));
+}
+
+TEST_CASE(sharedWheels) {
+	if (!isTruckPresent())
+		return;
+
+	Model model;
+	CHECK(importModel(model, kTruckDirectory / "CesiumMilkTruck.gltf"));
+	checkTruck(model);
+}
+
+TEST_CASE(mergedWheels) {
+	if (!isTruckPresent())
+		return;
+
+	std::filesystem::path filename = writeDuplicatedWheels();
+	CHECK(!filename.empty());
+	if (filename.empty())
+		return;
+
+	// five meshes in the file, the copy of the wheel is merged into the first.
+	Model model;
+	CHECK(importModel(model, filename));
+	checkTruck(model);
+
+	std::error_code ec;
+	std::filesystem::remove_all(kDirectory, ec);
+}
\ No newline at end of file
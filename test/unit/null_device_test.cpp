@@ -0,0 +1,174 @@
+#include "../test.h"
+
+#include "../../framework/null_device.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+
+namespace {
+
+const NullCommandList& asNull(const std::unique_ptr<RenderCommandList>& list) {
+	return *static_cast<const NullCommandList*>(list.get());
+}
+
+// true when exactly one error was reported and it names the call.
+bool hasError(NullRenderDevice& device, const char* call) {
+	bool isFound = device.getErrors().size() == 1 && device.getErrors()[0].find(call) == 0;
+	device.clearErrors();
+	return isFound;
+}
+
+void submit(NullRenderDevice& device, const std::unique_ptr<RenderCommandList>& list) {
+	RenderCommandList* lists[] = { list.get() };
+	device.submit(lists, 1);
+}
+
+}
+
+
+TEST_CASE(streamOrder) {
+	CommandStream stream;
+	uint32_t constants[3] = { 7, 8, 9 };
+	stream.record(RenderCommandType::eSetPipeline, { 4 });
+	stream.record(RenderCommandType::eSetRootConstants, { 1, 3 }, constants, sizeof(constants));
+	stream.record(RenderCommandType::eBeginEvent, {}, "pass", 4);
+	stream.record(RenderCommandType::eDispatch, { 2, 3, 4 });
+	stream.record(RenderCommandType::eEndEvent, {});
+
+	CHECK(stream.getCommandCount() == 5);
+	CHECK(stream.getCommand(0).type == RenderCommandType::eSetPipeline && stream.getCommand(0).args[0] == 4);
+	CHECK(stream.getCommand(1).type == RenderCommandType::eSetRootConstants);
+	CHECK(stream.getCommand(1).payloadSize == sizeof(constants));
+	CHECK(memcmp(stream.getPayload(stream.getCommand(1)), constants, sizeof(constants)) == 0);
+	CHECK(memcmp(stream.getPayload(stream.getCommand(2)), "pass", 4) == 0);
+	const RenderCommand& dispatch = stream.getCommand(3);
+	CHECK(dispatch.type == RenderCommandType::eDispatch && dispatch.args[0] == 2 && dispatch.args[1] == 3 && dispatch.args[2] == 4);
+	CHECK(stream.getCommand(4).type == RenderCommandType::eEndEvent);
+	CHECK(stream.countCommands(RenderCommandType::eDispatch) == 1);
+
+	stream.clear();
+	CHECK(stream.getCommandCount() == 0 && stream.getPayloadData().empty());
+}
+
+TEST_CASE(listRecording) {
+	// the list records its calls in order and begin starts over.
+	NullRenderDevice device;
+	RenderHandle pipeline = device.createPipeline("cull", true);
+	BufferDesc desc;
+	desc.size = 256;
+	desc.isUnorderedAccess = true;
+	RenderHandle buffer = device.createBuffer(desc);
+	uint32_t view = device.createView(buffer, ViewType::eUnorderedAccess, 4);
+
+	std::unique_ptr<RenderCommandList> list = device.createCommandList();
+	list->begin();
+	list->setPipeline(pipeline);
+	list->setRootTable(0, view);
+	list->dispatch(1, 1, 1);
+	list->uavBarrier(buffer);
+	list->end();
+
+	const CommandStream& stream = asNull(list).getStream();
+	const RenderCommandType types[] = { RenderCommandType::eSetPipeline, RenderCommandType::eSetRootTable,
+		RenderCommandType::eDispatch, RenderCommandType::eUavBarrier };
+	CHECK(stream.getCommandCount() == 4);
+	for (uint32_t i = 0; i < stream.getCommandCount() && i < 4; i++)
+		CHECK(stream.getCommand(i).type == types[i]);
+
+	submit(device, list);
+	CHECK(device.getErrors().empty());
+	CHECK(device.getSubmitCount() == 1);
+
+	list->begin();
+	CHECK(asNull(list).getStream().getCommandCount() == 0);
+	list->end();
+}
+
+TEST_CASE(fences) {
+	// a fence completes as soon as it is signaled, a wait on a value nothing signals is reported.
+	NullRenderDevice device;
+	RenderHandle fence = device.createFence();
+	CHECK(device.getCompletedValue(fence) == 0);
+	device.signal(fence, 3);
+	CHECK(device.getCompletedValue(fence) == 3);
+	device.wait(fence, 3);
+	CHECK(device.getErrors().empty());
+	device.wait(fence, 4);
+	CHECK(hasError(device, "wait:"));
+}
+
+TEST_CASE(stateErrors) {
+	NullRenderDevice device;
+	BufferDesc desc;
+	desc.size = 64;
+	RenderHandle buffer = device.createBuffer(desc);
+	std::unique_ptr<RenderCommandList> list = device.createCommandList();
+
+	// the barrier still moves the resource to its after state.
+	list->begin();
+	list->barrier(buffer, ResourceState::eCopySource, ResourceState::eCopyDest);
+	list->end();
+	submit(device, list);
+	CHECK(hasError(device, "barrier:"));
+	CHECK(device.getState(buffer) == ResourceState::eCopyDest);
+
+	list->begin();
+	list->barrier(buffer, ResourceState::eCopyDest, ResourceState::eCommon);
+	list->end();
+	submit(device, list);
+	CHECK(device.getErrors().empty());
+
+	list->begin();
+	list->draw(3, 1, 0, 0);
+	list->end();
+	submit(device, list);
+	CHECK(hasError(device, "draw:"));
+
+	list->begin();
+	list->beginEvent("open");
+	list->end();
+	submit(device, list);
+	CHECK(hasError(device, "submit:"));
+
+	// submitting a list still recording.
+	list->begin();
+	submit(device, list);
+	CHECK(hasError(device, "submit:"));
+	list->end();
+}
+
+TEST_CASE(rangeErrors) {
+	NullRenderDevice device;
+	BufferDesc desc;
+	desc.size = 64;
+	RenderHandle buffer = device.createBuffer(desc);
+	RenderHandle fence = device.createFence();
+	uint32_t view = device.createView(buffer, ViewType::eShaderResource, 4);
+	std::unique_ptr<RenderCommandList> list = device.createCommandList();
+
+	// every call records one bad handle or descriptor, which submit reports under the name of the call.
+	const RenderHandle missing = 100;
+	auto check = [&](const char* call, auto record) {
+		list->begin();
+		record(*list);
+		list->end();
+		submit(device, list);
+		CHECK(hasError(device, call));
+	};
+	check("setPipeline:", [&](RenderCommandList& l) { l.setPipeline(missing); });
+	check("setPipeline:", [&](RenderCommandList& l) { l.setPipeline(fence); });
+	check("setRootTable:", [&](RenderCommandList& l) { l.setRootTable(0, view + 1); });
+	check("setRootBuffer:", [&](RenderCommandList& l) { l.setRootBuffer(0, RootBufferType::eConstantBuffer, missing); });
+	check("setVertexBuffer:", [&](RenderCommandList& l) { l.setVertexBuffer(fence, 16); });
+	check("setIndexBuffer:", [&](RenderCommandList& l) { l.setIndexBuffer(missing, RenderFormat::eR32Uint); });
+	check("barrier:", [&](RenderCommandList& l) { l.barrier(missing, ResourceState::eCommon, ResourceState::eCopyDest); });
+	check("copyBuffer:", [&](RenderCommandList& l) { l.copyBuffer(buffer, 32, buffer, 0, 64); });
+	check("writeTimestamp:", [&](RenderCommandList& l) { l.writeTimestamp(buffer, 0); });
+
+	device.signal(missing, 1);
+	CHECK(hasError(device, "signal:"));
+	CHECK(device.map(buffer) == nullptr);
+	CHECK(hasError(device, "map:"));
+}
\ No newline at end of file
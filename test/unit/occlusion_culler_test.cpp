@@ -0,0 +1,269 @@
+#include "../test.h"
+
+#include "../../tools/occlusion_culler.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+const uint32_t kWidth = 256;
+const uint32_t kHeight = 144;
+
+// a camera at z = -4 looking at the origin, 90 degrees vertically.
+glm::mat4 getWorldViewProj() {
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::half_pi<float>(), 16.0f / 9.0f, 0.1f, 100.0f);
+	return proj * view;
+}
+
+// a grid of quads in the z = depth plane from -size to size.
+struct Wall {
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	Wall(float size, float depth, int quadCount) {
+		for (int y = 0; y <= quadCount; y++) {
+			for (int x = 0; x <= quadCount; x++)
+				positions.push_back(glm::vec3(-size + 2.0f * size * x / quadCount, -size + 2.0f * size * y / quadCount, depth));
+		}
+		for (int y = 0; y < quadCount; y++) {
+			for (int x = 0; x < quadCount; x++) {
+				uint32_t a = y * (quadCount + 1) + x;
+				indices.insert(indices.end(), { a, a + 1, a + quadCount + 1, a + 1, a + quadCount + 2, a + quadCount + 1 });
+			}
+		}
+	}
+};
+
+glm::vec3 project(const glm::mat4& matrix, const glm::vec3& point) {
+	glm::vec4 clip = matrix * glm::vec4(point, 1.0f);
+	return glm::vec3((clip.x / clip.w + 1.0f) * kWidth * 0.5f, (1.0f - clip.y / clip.w) * kHeight * 0.5f, clip.z / clip.w);
+}
+
+// the pixel centers a screen space rectangle covers, decided in double away from its edges. 1 covered, 0 not,
+// -1 within margin of an edge.
+int getReferenceCoverage(const glm::vec3& topLeft, const glm::vec3& bottomRight, uint32_t x, uint32_t y, double margin) {
+	double px = x + 0.5;
+	double py = y + 0.5;
+	double distance = (std::min)({ px - topLeft.x, bottomRight.x - px, py - topLeft.y, bottomRight.y - py });
+	if (std::abs(distance) <= margin)
+		return -1;
+	return distance > 0.0 ? 1 : 0;
+}
+
+OcclusionCuller makeCuller(const Wall& wall, unsigned int threadCount = 1) {
+	OcclusionCuller culler;
+	culler.create(kWidth, kHeight);
+	culler.begin(getWorldViewProj());
+	culler.addOccluder(wall.positions.data(), wall.indices.data(), wall.indices.size());
+	culler.rasterize(threadCount);
+	return culler;
+}
+
+}
+
+
+TEST_CASE(create) {
+	OcclusionCuller culler;
+	CHECK(!culler.create(0, 8));
+	CHECK(!culler.create(254, 144));
+	CHECK(!culler.create(256, 140));
+	CHECK(culler.create(kWidth, kHeight));
+	CHECK(culler.getWidth() == kWidth && culler.getHeight() == kHeight);
+	CHECK(culler.getDepth().size() == kWidth * kHeight);
+	CHECK(culler.getHierarchy().size() == (kWidth / kOcclusionBlockSize) * (kHeight / kOcclusionBlockSize));
+}
+
+TEST_CASE(rasterizeWall) {
+	// 20000 triangles whose shared edges must not leave cracks.
+	Wall wall(3.0f, 0.0f, 100);
+	OcclusionCuller culler = makeCuller(wall);
+	CHECK(culler.getTriangleCount() == wall.indices.size() / 3);
+
+	glm::mat4 matrix = getWorldViewProj();
+	glm::vec3 topLeft = project(matrix, glm::vec3(-3.0f, 3.0f, 0.0f));
+	glm::vec3 bottomRight = project(matrix, glm::vec3(3.0f, -3.0f, 0.0f));
+	// the view looks down +z, so +x is on the left of the screen.
+	std::swap(topLeft.x, bottomRight.x);
+	const float wallDepth = topLeft.z;
+
+	size_t coveredCount = 0;
+	size_t mismatchCount = 0;
+	size_t wrongDepthCount = 0;
+	for (uint32_t y = 0; y < kHeight; y++) {
+		for (uint32_t x = 0; x < kWidth; x++) {
+			float depth = culler.getDepth()[y * kWidth + x];
+			bool isCovered = depth < 1.0f;
+			coveredCount += isCovered ? 1 : 0;
+
+			int expected = getReferenceCoverage(topLeft, bottomRight, x, y, 1e-2);
+			if (expected >= 0 && isCovered != (expected == 1))
+				mismatchCount++;
+			if (isCovered && std::abs(depth - wallDepth) > 1e-5f)
+				wrongDepthCount++;
+		}
+	}
+	CHECK(coveredCount > 0);
+	CHECK(mismatchCount == 0);
+	CHECK(wrongDepthCount == 0);
+
+	// the hierarchy keeps the farthest depth of every block.
+	const uint32_t blockCountX = kWidth / kOcclusionBlockSize;
+	for (uint32_t blockY = 0; blockY < kHeight / kOcclusionBlockSize; blockY++) {
+		for (uint32_t blockX = 0; blockX < blockCountX; blockX++) {
+			float farthest = 0.0f;
+			for (uint32_t y = blockY * kOcclusionBlockSize; y < (blockY + 1) * kOcclusionBlockSize; y++) {
+				for (uint32_t x = blockX * kOcclusionBlockSize; x < (blockX + 1) * kOcclusionBlockSize; x++)
+					farthest = (std::max)(farthest, culler.getDepth()[y * kWidth + x]);
+			}
+			CHECK(culler.getHierarchy()[blockY * blockCountX + blockX] == farthest);
+		}
+	}
+}
+
+TEST_CASE(nearestDepthWins) {
+	// a small wall in front of a large one, drawn in either order.
+	Wall back(3.0f, 2.0f, 4);
+	Wall front(1.0f, 0.0f, 4);
+	glm::mat4 matrix = getWorldViewProj();
+	const float frontDepth = project(matrix, glm::vec3(0.0f)).z;
+	const float backDepth = project(matrix, glm::vec3(0.0f, 0.0f, 2.0f)).z;
+
+	for (int order = 0; order < 2; order++) {
+		OcclusionCuller culler;
+		culler.create(kWidth, kHeight);
+		culler.begin(matrix);
+		const Wall& first = order == 0 ? back : front;
+		const Wall& second = order == 0 ? front : back;
+		culler.addOccluder(first.positions.data(), first.indices.data(), first.indices.size());
+		culler.addOccluder(second.positions.data(), second.indices.data(), second.indices.size());
+		culler.rasterize(1);
+
+		CHECK_NEAR(culler.getDepth()[(kHeight / 2) * kWidth + kWidth / 2], frontDepth, 1e-5f);
+		glm::vec3 backOnly = project(matrix, glm::vec3(2.0f, 0.0f, 2.0f));
+		CHECK_NEAR(culler.getDepth()[(uint32_t)backOnly.y * kWidth + (uint32_t)backOnly.x], backDepth, 1e-5f);
+	}
+}
+
+TEST_CASE(threadCountIndependence) {
+	Wall wall(2.5f, 1.0f, 37);
+	OcclusionCuller reference = makeCuller(wall, 1);
+	for (unsigned int threadCount : { 2u, 3u, 8u, 64u }) {
+		OcclusionCuller culler = makeCuller(wall, threadCount);
+		CHECK(culler.getDepth() == reference.getDepth());
+		CHECK(culler.getHierarchy() == reference.getHierarchy());
+	}
+}
+
+TEST_CASE(beginClearsTheFrame) {
+	Wall wall(3.0f, 0.0f, 4);
+	OcclusionCuller culler = makeCuller(wall);
+	culler.begin(getWorldViewProj());
+	culler.rasterize(1);
+	CHECK(culler.getTriangleCount() == 0);
+	for (float depth : culler.getDepth())
+		CHECK(depth == 1.0f);
+}
+
+TEST_CASE(nearPlaneTriangles) {
+	// a triangle with a vertex behind the camera is skipped rather than clipped.
+	std::vector<glm::vec3> positions = { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 1.0f, -10.0f) };
+	std::vector<uint32_t> indices = { 0, 1, 2 };
+	OcclusionCuller culler;
+	culler.create(kWidth, kHeight);
+	culler.begin(getWorldViewProj());
+	culler.addOccluder(positions.data(), indices.data(), indices.size());
+	culler.rasterize(1);
+	CHECK(culler.getTriangleCount() == 0);
+
+	// degenerate and fully off-screen triangles are dropped too.
+	positions = { glm::vec3(0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(2.0f, 2.0f, 0.0f),
+		glm::vec3(100.0f, 0.0f, 0.0f), glm::vec3(101.0f, 0.0f, 0.0f), glm::vec3(100.0f, 1.0f, 0.0f) };
+	indices = { 0, 1, 2, 3, 4, 5 };
+	culler.begin(getWorldViewProj());
+	culler.addOccluder(positions.data(), indices.data(), indices.size());
+	CHECK(culler.getTriangleCount() == 0);
+}
+
+TEST_CASE(queries) {
+	Wall wall(3.0f, 0.0f, 10);
+	OcclusionCuller culler = makeCuller(wall);
+
+	// right behind the center, beside the wall, in front of it.
+	CHECK(!culler.isVisible(glm::vec3(-0.5f, -0.5f, 1.0f), glm::vec3(0.5f, 0.5f, 2.0f)));
+	CHECK(culler.isVisible(glm::vec3(3.5f, -0.5f, 1.0f), glm::vec3(4.0f, 0.5f, 2.0f)));
+	CHECK(culler.isVisible(glm::vec3(-0.5f, -0.5f, -2.0f), glm::vec3(0.5f, 0.5f, -1.0f)));
+	// behind, but peeking over the top edge.
+	CHECK(culler.isVisible(glm::vec3(-0.5f, 3.0f, 1.0f), glm::vec3(0.5f, 4.5f, 2.0f)));
+	// the occluder does not hide itself, nor a flat box on it.
+	CHECK(culler.isVisible(glm::vec3(-3.0f, -3.0f, 0.0f), glm::vec3(3.0f, 3.0f, 0.0f)));
+	CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f)));
+	// reaching behind the camera.
+	CHECK(culler.isVisible(glm::vec3(-0.5f, -0.5f, -10.0f), glm::vec3(0.5f, 0.5f, 10.0f)));
+	// off-screen is left to the frustum culling.
+	CHECK(!culler.isVisible(glm::vec3(100.0f, 0.0f, 5.0f), glm::vec3(101.0f, 1.0f, 6.0f)));
+
+	// conservative: nothing in front of the wall is ever culled, and everything well inside its shadow is.
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+	std::uniform_real_distribution<float> depth(-3.0f, 20.0f);
+	std::uniform_real_distribution<float> size(0.05f, 1.0f);
+	glm::mat4 matrix = getWorldViewProj();
+	size_t wrongCount = 0;
+	size_t occludedCount = 0;
+	for (int i = 0; i < 20000; i++) {
+		glm::vec3 center(position(random), position(random), depth(random));
+		glm::vec3 extent(size(random));
+		glm::vec3 boundsMin = center - extent;
+		glm::vec3 boundsMax = center + extent;
+		bool isVisible = culler.isVisible(boundsMin, boundsMax);
+
+		// on screen and reaching in front of the wall.
+		glm::vec3 projected = project(matrix, center);
+		bool isOnScreen = projected.x > 0.0f && projected.x < kWidth && projected.y > 0.0f && projected.y < kHeight;
+		if (isOnScreen && boundsMin.z <= 0.0f && !isVisible)
+			wrongCount++;
+
+		// behind the wall and inside its silhouette seen from the camera, with a pixel of margin.
+		bool isShadowed = boundsMin.z > 0.01f;
+		for (int corner = 0; corner < 8 && isShadowed; corner++) {
+			glm::vec3 point((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+			// where the ray from the camera to the corner crosses z = 0.
+			glm::vec3 eye(0.0f, 0.0f, -4.0f);
+			glm::vec3 hit = eye + (point - eye) * (4.0f / (point.z + 4.0f));
+			isShadowed = std::abs(hit.x) < 2.9f && std::abs(hit.y) < 2.9f;
+		}
+		if (isShadowed) {
+			occludedCount++;
+			if (isVisible)
+				wrongCount++;
+		}
+	}
+	CHECK(wrongCount == 0);
+	CHECK(occludedCount > 100);
+}
+
+TEST_CASE(cull) {
+	Wall wall(3.0f, 0.0f, 10);
+	OcclusionCuller culler = makeCuller(wall);
+
+	CullBounds bounds;
+	bounds.add(glm::vec3(-0.5f, -0.5f, 1.0f), glm::vec3(0.5f, 0.5f, 2.0f));
+	bounds.add(glm::vec3(3.5f, -0.5f, 1.0f), glm::vec3(4.0f, 0.5f, 2.0f));
+	bounds.add(glm::vec3(-1.0f, -1.0f, 3.0f), glm::vec3(1.0f, 1.0f, 4.0f));
+	bounds.add(glm::vec3(-0.5f, -0.5f, -2.0f), glm::vec3(0.5f, 0.5f, -1.0f));
+
+	// only the listed entries are tested and the order is kept.
+	std::vector<uint32_t> indices = { 3, 2, 1, 0 };
+	CHECK(culler.cull(bounds, indices) == 2);
+	CHECK((indices == std::vector<uint32_t>{ 3, 1 }));
+
+	indices.clear();
+	CHECK(culler.cull(bounds, indices) == 0);
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "../test.h"
+
+#include "../../framework/pipeline.h"
+#include "../../framework/pipeline_cache.h"
+#include "../../framework/root_signature.h"
+#include "../../framework/shader.h"
+
+#include <dxgi1_4.h>
+
+#include <fstream>
+
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "pipeline_cache_test";
+
+// warp, so the test runs without a gpu.
+Microsoft::WRL::ComPtr<ID3D12Device> createDevice() {
+	Microsoft::WRL::ComPtr<IDXGIFactory4> factory;
+	Microsoft::WRL::ComPtr<IDXGIAdapter> adapter;
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(factory.GetAddressOf()))) ||
+		FAILED(factory->EnumWarpAdapter(IID_PPV_ARGS(adapter.GetAddressOf()))) ||
+		FAILED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(device.GetAddressOf())))) {
+		return nullptr;
+	}
+	return device;
+}
+
+bool compileShader(Shader& shader, const char* name, const char* text) {
+	std::filesystem::create_directories(kDirectory);
+	std::filesystem::path filename = kDirectory / name;
+	{
+		std::ofstream ofs(filename, std::ios::trunc);
+		ofs << text;
+	}
+	return shader.create(filename.c_str(), L"main", L"cs_6_0", {});
+}
+
+// what App::retirePipeline does once the gpu passed the swap.
+void replacePipeline(ComputePipeline& pipeline, const ComputePipeline& newPipeline) {
+	ID3D12PipelineState* retired = pipeline.getPipelineState();
+	retired->AddRef();
+	pipeline = newPipeline;
+	PipelineCache::Instance().release(retired);
+}
+
+}
+
+
+TEST_CASE(releaseRetiredPipelines) {
+	Microsoft::WRL::ComPtr<ID3D12Device> device = createDevice();
+	CHECK(device);
+	if (!device)
+		return;
+
+	Shader shaderA;
+	Shader shaderB;
+	CHECK(compileShader(shaderA, "a.fx", "RWBuffer<uint> result : register(u0);\n[numthreads(64, 1, 1)]\nvoid main(uint id : SV_DispatchThreadID) { result[id] = id; }\n"));
+	CHECK(compileShader(shaderB, "b.fx", "RWBuffer<uint> result : register(u0);\n[numthreads(64, 1, 1)]\nvoid main(uint id : SV_DispatchThreadID) { result[id] = id * 2; }\n"));
+
+	RootSignature rootSignature;
+	rootSignature.addDescriptorCount(D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+	CHECK(rootSignature.create(device.Get(), D3D12_ROOT_SIGNATURE_FLAG_NONE));
+	CHECK(PipelineCache::getRootSignatureHash(rootSignature.getRootSignature()) != 0);
+
+	PipelineCache& cache = PipelineCache::Instance();
+	const size_t baseCount = cache.getPipelineCount();
+	const uint32_t baseMissCount = cache.getMissCount();
+
+	// two pipelines of the same description share one state.
+	ComputePipeline first;
+	first.setComputeShader(shaderA.getByteCode());
+	CHECK(first.create(device.Get(), rootSignature.getRootSignature()));
+	ComputePipeline second = first;
+	CHECK(second.create(device.Get(), rootSignature.getRootSignature()));
+	CHECK(first.getPipelineState() == second.getPipelineState());
+	CHECK(cache.getPipelineCount() == baseCount + 1);
+
+	ComputePipeline reloaded = first;
+	reloaded.setComputeShader(shaderB.getByteCode());
+	CHECK(reloaded.create(device.Get(), rootSignature.getRootSignature()));
+	CHECK(cache.getPipelineCount() == baseCount + 2);
+
+	// the state stays cached while another pipeline uses it.
+	replacePipeline(first, reloaded);
+	CHECK(cache.getPipelineCount() == baseCount + 2);
+	CHECK(second.getPipelineState() != nullptr);
+
+	// and is dropped with the last one.
+	replacePipeline(second, reloaded);
+	CHECK(cache.getPipelineCount() == baseCount + 1);
+	CHECK(first.getPipelineState() == reloaded.getPipelineState());
+
+	// the dropped description is compiled again, no library is open.
+	ComputePipeline recreated;
+	recreated.setComputeShader(shaderA.getByteCode());
+	CHECK(recreated.create(device.Get(), rootSignature.getRootSignature()));
+	CHECK(cache.getPipelineCount() == baseCount + 2);
+	CHECK(cache.getMissCount() == baseMissCount + 3);
+
+	// a state the cache never saw is only released.
+	replacePipeline(recreated, reloaded);
+	cache.release(nullptr);
+	CHECK(cache.getPipelineCount() == baseCount + 1);
+
+	std::error_code ec;
+	std::filesystem::remove_all(kDirectory, ec);
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "../test.h"
+
+#include "../../framework/pipeline_compiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+
+namespace {
+
+std::atomic<int> g_liveStateCount(0);
+
+// stands in for a driver compiled pipeline, nothing calls into it.
+class FakePipelineState : public ID3D12PipelineState {
+public:
+	FakePipelineState() { g_liveStateCount++; }
+	virtual ~FakePipelineState() { g_liveStateCount--; }
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override { *object = nullptr; return E_NOINTERFACE; }
+	ULONG STDMETHODCALLTYPE AddRef() override { return ++m_refCount; }
+	ULONG STDMETHODCALLTYPE Release() override {
+		ULONG count = --m_refCount;
+		if (count == 0)
+			delete this;
+		return count;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override { *device = nullptr; return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE GetCachedBlob(ID3DBlob** blob) override { *blob = nullptr; return E_NOTIMPL; }
+
+private:
+	std::atomic<ULONG> m_refCount{ 1 };
+};
+
+// a driver compile that takes latency and counts how many run at once.
+class MockCompiler {
+public:
+	PipelineCompiler::CompileFunction makeCompile(std::chrono::milliseconds latency, bool isSucceeding = true) {
+		return [this, latency, isSucceeding](Microsoft::WRL::ComPtr<ID3D12PipelineState>& pipelineState) {
+			int running = ++m_runningCount;
+			int maxRunning = m_maxRunningCount.load();
+			while (running > maxRunning && !m_maxRunningCount.compare_exchange_weak(maxRunning, running)) {}
+
+			std::this_thread::sleep_for(latency);
+			m_runningCount--;
+			m_compileCount++;
+			if (!isSucceeding)
+				return false;
+
+			pipelineState.Attach(new FakePipelineState());
+			return true;
+		};
+	}
+
+	int getMaxRunningCount() { return m_maxRunningCount; }
+	int getCompileCount() { return m_compileCount; }
+
+private:
+	std::atomic<int> m_runningCount{ 0 };
+	std::atomic<int> m_maxRunningCount{ 0 };
+	std::atomic<int> m_compileCount{ 0 };
+};
+
+double getMilliseconds(std::chrono::steady_clock::time_point begin) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+}
+
+
+TEST_CASE(framesDoNotBlock) {
+	PipelineCompiler compiler;
+	MockCompiler mock;
+	CHECK(compiler.create(3));
+
+	// the startup pipelines, each slower than a frame.
+	std::vector<PipelineTaskSp> tasks;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < 24; i++)
+		tasks.push_back(compiler.submit(mock.makeCompile(std::chrono::milliseconds(20 + 15 * (i % 5)))));
+	CHECK(getMilliseconds(begin) < 5.0);
+
+	// a frame polls every pipeline and requests a new variant now and then. none of it may wait for a compile.
+	double maxFrameTime = 0.0;
+	int frameCount = 0;
+	size_t readyWhilePending = 0;
+	while (compiler.getPendingCount() > 0 && frameCount < 10000) {
+		auto frameBegin = std::chrono::steady_clock::now();
+		size_t readyCount = 0;
+		for (auto& ite : tasks) {
+			if (ite->getPipelineState() != nullptr)
+				readyCount++;
+		}
+		if (frameCount % 20 == 10)
+			tasks.push_back(compiler.submit(mock.makeCompile(std::chrono::milliseconds(40))));
+		maxFrameTime = (std::max)(maxFrameTime, getMilliseconds(frameBegin));
+
+		readyWhilePending = (std::max)(readyWhilePending, readyCount);
+		frameCount++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	CHECK(maxFrameTime < 5.0);
+	// frames kept running and drawing with the pipelines finished so far.
+	CHECK(frameCount > 10);
+	CHECK(readyWhilePending > 0);
+
+	compiler.waitIdle();
+	for (auto& ite : tasks) {
+		CHECK(ite->isReady());
+		CHECK(ite->getPipelineState() != nullptr);
+	}
+	CHECK(mock.getCompileCount() == (int)tasks.size());
+}
+
+TEST_CASE(workerCount) {
+	PipelineCompiler compiler;
+	MockCompiler mock;
+	CHECK(compiler.create(2));
+
+	std::vector<PipelineTaskSp> tasks;
+	for (int i = 0; i < 8; i++)
+		tasks.push_back(compiler.submit(mock.makeCompile(std::chrono::milliseconds(20))));
+	CHECK(compiler.getPendingCount() > 0);
+
+	tasks.back()->wait();
+	compiler.waitIdle();
+	CHECK(compiler.getPendingCount() == 0);
+	// the jobs overlapped, but never on more threads than were asked for.
+	CHECK(mock.getMaxRunningCount() == 2);
+	for (auto& ite : tasks)
+		CHECK(ite->isReady());
+}
+
+TEST_CASE(failedCompiles) {
+	PipelineCompiler compiler;
+	MockCompiler mock;
+	CHECK(compiler.create(2));
+
+	PipelineTaskSp failed = compiler.submit(mock.makeCompile(std::chrono::milliseconds(5), false));
+	// succeeding without a pipeline state counts as a failure.
+	PipelineTaskSp empty = compiler.submit([](Microsoft::WRL::ComPtr<ID3D12PipelineState>&) { return true; });
+	PipelineTaskSp ready = compiler.submit(mock.makeCompile(std::chrono::milliseconds(5)));
+
+	failed->wait();
+	empty->wait();
+	ready->wait();
+	CHECK(failed->getStatus() == PipelineStatus::eFailed && failed->getPipelineState() == nullptr);
+	CHECK(empty->getStatus() == PipelineStatus::eFailed && empty->getPipelineState() == nullptr);
+	CHECK(ready->getStatus() == PipelineStatus::eReady && ready->getPipelineState() != nullptr);
+}
+
+TEST_CASE(destroyWithQueuedJobs) {
+	int liveStateCount = g_liveStateCount;
+	{
+		PipelineCompiler compiler;
+		MockCompiler mock;
+		CHECK(compiler.create(1));
+
+		PipelineTaskSp running = compiler.submit(mock.makeCompile(std::chrono::milliseconds(50)));
+		while (compiler.getPendingCount() > 0 && mock.getMaxRunningCount() == 0)
+			std::this_thread::yield();
+		std::vector<PipelineTaskSp> queued;
+		for (int i = 0; i < 4; i++)
+			queued.push_back(compiler.submit(mock.makeCompile(std::chrono::milliseconds(50))));
+
+		// the running job finishes, the queued ones fail without being compiled.
+		auto begin = std::chrono::steady_clock::now();
+		compiler.destroy();
+		CHECK(getMilliseconds(begin) < 150.0);
+		CHECK(running->isReady());
+		for (auto& ite : queued)
+			CHECK(ite->getStatus() == PipelineStatus::eFailed);
+		CHECK(mock.getCompileCount() == 1);
+
+		// nothing is queued once destroyed.
+		PipelineTaskSp late = compiler.submit(mock.makeCompile(std::chrono::milliseconds(0)));
+		CHECK(late->getStatus() == PipelineStatus::eFailed);
+		CHECK(g_liveStateCount == liveStateCount + 1);
+	}
+	// the task held the only reference.
+	CHECK(g_liveStateCount == liveStateCount);
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "../test.h"
+
+#include "../../framework/pipeline_key.h"
+
+#include <functional>
+#include <set>
+#include <vector>
+
+
+namespace {
+
+// the opaque pass of the app: one target, depth test, no blending.
+GraphicsPipelineKey makeKey() {
+	GraphicsPipelineKey key;
+	key.rootSignature = 0x1111;
+	key.vertexShader = 0x2222;
+	key.pixelShader = 0x3333;
+	key.inputLayout.push_back({ "POSITION", 0, 6, 0, 0xffffffff, 0, 0 });
+	key.inputLayout.push_back({ "NORMAL", 0, 6, 0, 0xffffffff, 0, 0 });
+	key.inputLayout.push_back({ "TEXCOORD", 0, 16, 0, 0xffffffff, 0, 0 });
+	key.fillMode = 3;
+	key.cullMode = 3;
+	key.depthClipEnable = 1;
+	key.blend.resize(8);
+	for (auto& ite : key.blend)
+		ite.renderTargetWriteMask = 0xf;
+	key.depthEnable = 1;
+	key.depthWriteMask = 1;
+	key.depthFunc = 2;
+	key.renderTargetFormats = { 28 };
+	key.depthStencilFormat = 40;
+	key.primitiveTopologyType = 3;
+	key.sampleMask = 0xffffffff;
+	key.sampleCount = 1;
+	return key;
+}
+
+uint64_t hashWith(const std::function<void(GraphicsPipelineKey&)>& change) {
+	GraphicsPipelineKey key = makeKey();
+	change(key);
+	return hashPipelineKey(key);
+}
+
+}
+
+
+TEST_CASE(equalDescriptions) {
+	CHECK(hashPipelineKey(makeKey()) == hashPipelineKey(makeKey()));
+	CHECK(hashPipelineKey(makeKey()) != 0);
+	CHECK(hashPipelineKey(GraphicsPipelineKey()) != 0);
+
+	// hashing normalizes a copy and leaves the description alone.
+	GraphicsPipelineKey key = makeKey();
+	key.inputLayout[0].semanticName = "position";
+	hashPipelineKey(key);
+	CHECK(key.inputLayout[0].semanticName == "position");
+}
+
+TEST_CASE(normalizedFields) {
+	const uint64_t expected = hashPipelineKey(makeKey());
+
+	// fields the runtime ignores, each change builds the same pipeline.
+	std::vector<std::function<void(GraphicsPipelineKey&)>> changes = {
+		[](GraphicsPipelineKey& key) { key.inputLayout[1].semanticName = "normal"; },
+		[](GraphicsPipelineKey& key) { key.inputLayout[0].instanceDataStepRate = 4; },
+		[](GraphicsPipelineKey& key) { key.renderTargetFormats.push_back(0); },
+		[](GraphicsPipelineKey& key) { key.blend.resize(1); },
+		[](GraphicsPipelineKey& key) { key.blend[3].blendEnable = 1; },
+		[](GraphicsPipelineKey& key) { key.blend[0].srcBlend = 5; key.blend[0].blendOpAlpha = 2; },
+		[](GraphicsPipelineKey& key) { key.blend[0].logicOp = 4; },
+		[](GraphicsPipelineKey& key) { key.stencilReadMask = 0x12; key.frontFace.stencilFunc = 7; key.backFace.stencilPassOp = 3; },
+		[](GraphicsPipelineKey& key) { key.antialiasedLineEnable = 1; },
+		[](GraphicsPipelineKey& key) { key.sampleCount = 0; },
+		[](GraphicsPipelineKey& key) { key.depthBiasClamp = -0.0f; },
+	};
+	for (auto& ite : changes)
+		CHECK(hashWith(ite) == expected);
+
+	// depth state without depth.
+	GraphicsPipelineKey a = makeKey();
+	a.depthEnable = 0;
+	GraphicsPipelineKey b = a;
+	b.depthFunc = 4;
+	b.depthWriteMask = 0;
+	CHECK(hashPipelineKey(a) == hashPipelineKey(b));
+
+	// blend state without targets.
+	a = makeKey();
+	a.renderTargetFormats.clear();
+	b = a;
+	b.blend[0].blendEnable = 1;
+	b.alphaToCoverageEnable = 1;
+	CHECK(hashPipelineKey(a) == hashPipelineKey(b));
+}
+
+TEST_CASE(distinctDescriptions) {
+	// every change builds another pipeline, so all the hashes differ from the base and from each other.
+	std::vector<std::function<void(GraphicsPipelineKey&)>> changes = {
+		[](GraphicsPipelineKey&) {},
+		[](GraphicsPipelineKey& key) { key.rootSignature++; },
+		[](GraphicsPipelineKey& key) { key.vertexShader++; },
+		[](GraphicsPipelineKey& key) { key.geometoryShader = 0x4444; },
+		[](GraphicsPipelineKey& key) { key.pixelShader++; },
+		[](GraphicsPipelineKey& key) { key.pixelShader = 0; },
+		[](GraphicsPipelineKey& key) { key.inputLayout.pop_back(); },
+		[](GraphicsPipelineKey& key) { std::swap(key.inputLayout[0], key.inputLayout[1]); },
+		[](GraphicsPipelineKey& key) { key.inputLayout[0].semanticIndex = 1; },
+		[](GraphicsPipelineKey& key) { key.inputLayout[2].format = 6; },
+		[](GraphicsPipelineKey& key) { key.inputLayout[0].inputSlot = 1; },
+		[](GraphicsPipelineKey& key) { key.inputLayout[0].inputSlotClass = 1; key.inputLayout[0].instanceDataStepRate = 1; },
+		[](GraphicsPipelineKey& key) { key.fillMode = 2; },
+		[](GraphicsPipelineKey& key) { key.cullMode = 1; },
+		[](GraphicsPipelineKey& key) { key.frontCounterClockwise = 1; },
+		[](GraphicsPipelineKey& key) { key.depthBias = 1; },
+		[](GraphicsPipelineKey& key) { key.depthBiasClamp = 0.5f; },
+		[](GraphicsPipelineKey& key) { key.slopeScaledDepthBias = 1.0f; },
+		[](GraphicsPipelineKey& key) { key.depthClipEnable = 0; },
+		[](GraphicsPipelineKey& key) { key.conservativeRaster = 1; },
+		[](GraphicsPipelineKey& key) { key.alphaToCoverageEnable = 1; },
+		[](GraphicsPipelineKey& key) { key.blend[0].blendEnable = 1; },
+		[](GraphicsPipelineKey& key) { key.blend[0].renderTargetWriteMask = 0x7; },
+		[](GraphicsPipelineKey& key) { key.depthWriteMask = 0; },
+		[](GraphicsPipelineKey& key) { key.depthFunc = 4; },
+		[](GraphicsPipelineKey& key) { key.depthEnable = 0; },
+		[](GraphicsPipelineKey& key) { key.stencilEnable = 1; },
+		[](GraphicsPipelineKey& key) { key.renderTargetFormats[0] = 10; },
+		[](GraphicsPipelineKey& key) { key.renderTargetFormats.push_back(28); },
+		[](GraphicsPipelineKey& key) { key.depthStencilFormat = 20; },
+		[](GraphicsPipelineKey& key) { key.primitiveTopologyType = 2; },
+		[](GraphicsPipelineKey& key) { key.sampleMask = 1; },
+		[](GraphicsPipelineKey& key) { key.sampleCount = 4; },
+		[](GraphicsPipelineKey& key) { key.sampleQuality = 1; },
+	};
+
+	std::set<uint64_t> hashes;
+	for (auto& ite : changes)
+		hashes.insert(hashWith(ite));
+	CHECK(hashes.size() == changes.size());
+
+	// stencil state counts once stencil is on.
+	GraphicsPipelineKey a = makeKey();
+	a.stencilEnable = 1;
+	a.stencilReadMask = 0xff;
+	GraphicsPipelineKey b = a;
+	b.frontFace.stencilFunc = 3;
+	CHECK(hashPipelineKey(a) != hashPipelineKey(b));
+
+	// and the blend of the second target with independent blend.
+	a = makeKey();
+	a.renderTargetFormats.push_back(28);
+	a.independentBlendEnable = 1;
+	b = a;
+	b.blend[1].blendEnable = 1;
+	CHECK(hashPipelineKey(a) != hashPipelineKey(b));
+}
+
+TEST_CASE(computeKeys) {
+	ComputePipelineKey a{ 0x1111, 0x2222 };
+	ComputePipelineKey b{ 0x1111, 0x2223 };
+	ComputePipelineKey c{ 0x1112, 0x2222 };
+	CHECK(hashPipelineKey(a) == hashPipelineKey(ComputePipelineKey{ 0x1111, 0x2222 }));
+	CHECK(hashPipelineKey(a) != hashPipelineKey(b));
+	CHECK(hashPipelineKey(a) != hashPipelineKey(c));
+	CHECK(hashPipelineKey(a) != 0);
+
+	// a compute key never collides with a graphics key of the same shader and root signature.
+	GraphicsPipelineKey graphics;
+	graphics.rootSignature = 0x1111;
+	graphics.vertexShader = 0x2222;
+	CHECK(hashPipelineKey(a) != hashPipelineKey(graphics));
+}
\ No newline at end of file
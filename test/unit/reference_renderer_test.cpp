@@ -0,0 +1,343 @@
+#include "../test.h"
+
+#include "../../tools/reference_renderer.h"
+#include "../../tools/material_classifier.h"
+#include "../../tools/stb_image.h"
+#include "../../tools/stb_image_write.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "reference_renderer_test";
+// run with this set to write the golden images again after an intended change of the output.
+const char* kUpdateGoldenVariable = "REFERENCE_RENDERER_UPDATE_GOLDEN";
+const std::filesystem::path kGoldenDirectory = "test/golden";
+
+const uint32_t kWidth = 160;
+const uint32_t kHeight = 90;
+
+// the camera of the app.
+ReferenceCamera makeCamera(const glm::vec3& eye = glm::vec3(0.0f, 0.0f, -4.0f), const glm::vec3& target = glm::vec3(0.0f)) {
+	ReferenceCamera camera;
+	camera.view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.proj = glm::perspective(glm::half_pi<float>(), 16.0f / 9.0f, 0.1f, 100.0f);
+	camera.world = glm::mat4(1.0f);
+	// shining along +z, so a quad facing the default camera gets the full diffuse.
+	camera.lightDirection = glm::vec3(0.0f, 0.0f, 1.0f);
+	return camera;
+}
+
+// appends a mesh to the scene and returns its index.
+int addMesh(ReferenceScene& scene, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& texcoords, const std::vector<uint32_t>& indices, int material) {
+	scene.positions.insert(scene.positions.end(), positions.begin(), positions.end());
+	scene.normals.insert(scene.normals.end(), normals.begin(), normals.end());
+	scene.texcoords.insert(scene.texcoords.end(), texcoords.begin(), texcoords.end());
+	scene.indices.insert(scene.indices.end(), indices.begin(), indices.end());
+	scene.vertexCounts.push_back((uint32_t)positions.size());
+	scene.indexCounts.push_back((uint32_t)indices.size());
+	scene.materialIndices.push_back(material);
+	return (int)scene.vertexCounts.size() - 1;
+}
+
+// a quad in the z = 0 plane facing -z, the default camera. u runs along -x, left to right on screen.
+int addQuad(ReferenceScene& scene, float halfSize, int material, bool isFlipped = false) {
+	std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+	if (isFlipped)
+		indices = { 0, 2, 1, 0, 3, 2 };
+	return addMesh(scene,
+		{ glm::vec3(halfSize, -halfSize, 0.0f), glm::vec3(halfSize, halfSize, 0.0f), glm::vec3(-halfSize, halfSize, 0.0f), glm::vec3(-halfSize, -halfSize, 0.0f) },
+		std::vector<glm::vec3>(4, glm::vec3(0.0f, 0.0f, -1.0f)),
+		{ glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f) },
+		indices, material);
+}
+
+int addCube(ReferenceScene& scene, int material) {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<uint32_t> indices;
+	for (int axis = 0; axis < 3; axis++) {
+		for (float sign : { -1.0f, 1.0f }) {
+			glm::vec3 normal(0.0f);
+			normal[axis] = sign;
+			glm::vec3 u(0.0f);
+			u[(axis + 1) % 3] = 1.0f;
+			glm::vec3 v = glm::cross(normal, u);
+			uint32_t base = (uint32_t)positions.size();
+			for (int corner = 0; corner < 4; corner++) {
+				glm::vec2 uv((corner == 1 || corner == 2) ? 1.0f : 0.0f, corner >= 2 ? 1.0f : 0.0f);
+				positions.push_back(normal * 0.5f + u * (uv.x - 0.5f) + v * (uv.y - 0.5f));
+				normals.push_back(normal);
+				texcoords.push_back(uv);
+			}
+			// counterclockwise seen from outside.
+			indices.insert(indices.end(), { base, base + 2, base + 1, base, base + 3, base + 2 });
+		}
+	}
+	return addMesh(scene, positions, normals, texcoords, indices, material);
+}
+
+void addInstance(ReferenceScene& scene, int mesh, const glm::mat4& matrix) {
+	scene.instanceMeshes.push_back(mesh);
+	scene.instanceMatrices.push_back(matrix);
+}
+
+// an albedo map written to the temporary directory, texel (x, y) colored by the function.
+template<class Function>
+std::string writeAlbedo(const char* name, int width, int height, Function color) {
+	std::filesystem::create_directories(kDirectory);
+	std::vector<uint8_t> pixels((size_t)width * height * 4);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			glm::u8vec4 texel = color(x, y);
+			for (int i = 0; i < 4; i++)
+				pixels[((size_t)y * width + x) * 4 + i] = texel[i];
+		}
+	}
+	std::string filename = (kDirectory / name).string();
+	stbi_write_png(filename.c_str(), width, height, 4, pixels.data(), width * 4);
+	return filename;
+}
+
+bool isBackground(const glm::uvec2& visibility) {
+	return (visibility.y & kClosureIdMask) == kClosureIdMask;
+}
+
+std::vector<uint8_t> loadPng(const std::filesystem::path& filename, int& width, int& height) {
+	int channels;
+	uint8_t* pixels = stbi_load(filename.string().c_str(), &width, &height, &channels, 4);
+	if (!pixels)
+		return {};
+	std::vector<uint8_t> result(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+	return result;
+}
+
+}
+
+
+TEST_CASE(invalidScenes) {
+	ReferenceRenderer renderer;
+	ReferenceScene scene;
+	int quad = addQuad(scene, 1.0f, -1);
+	addInstance(scene, quad, glm::mat4(1.0f));
+	CHECK(renderer.create(scene, {}));
+	CHECK(renderer.create(scene, { 3 }));
+
+	// closure ids for a mesh that does not exist.
+	CHECK(!renderer.create(scene, { 3, 4 }));
+
+	ReferenceScene broken = scene;
+	broken.instanceMeshes[0] = 1;
+	CHECK(!renderer.create(broken, {}));
+	broken = scene;
+	broken.indices[2] = 4;
+	CHECK(!renderer.create(broken, {}));
+	broken = scene;
+	broken.instanceMatrices.clear();
+	CHECK(!renderer.create(broken, {}));
+	broken = scene;
+	broken.normals.pop_back();
+	CHECK(!renderer.create(broken, {}));
+
+	// nothing to hit.
+	CHECK(renderer.create(ReferenceScene(), {}));
+	renderer.render(makeCamera(), 16, 8, 1);
+	CHECK(std::all_of(renderer.getVisibility().begin(), renderer.getVisibility().end(), isBackground));
+}
+
+TEST_CASE(visibility) {
+	// a quad filling the view, made of two instances of a half quad side by side.
+	ReferenceScene scene;
+	int quad = addQuad(scene, 4.0f, -1);
+	int flipped = addQuad(scene, 4.0f, -1, true);
+	addInstance(scene, quad, glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0.0f, 0.0f)));
+	addInstance(scene, quad, glm::translate(glm::mat4(1.0f), glm::vec3(-4.0f, 0.0f, 0.0f)));
+	// facing away and in front of the others, so culling is the only thing hiding it.
+	addInstance(scene, flipped, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
+
+	ReferenceRenderer renderer;
+	CHECK(renderer.create(scene, { 5, 6 }, 1));
+	renderer.render(makeCamera(), kWidth, kHeight, 1);
+	CHECK(renderer.getWidth() == kWidth && renderer.getHeight() == kHeight);
+
+	// +x is on the left of the screen, so instance 0 covers the left half and instance 1 the right half.
+	const std::vector<glm::uvec2>& visibility = renderer.getVisibility();
+	size_t wrongCount = 0;
+	for (uint32_t y = 0; y < kHeight; y++) {
+		for (uint32_t x = 0; x < kWidth; x++) {
+			const glm::uvec2& texel = visibility[(size_t)y * kWidth + x];
+			uint32_t expectedInstance = x < kWidth / 2 ? 0 : 1;
+			if (isBackground(texel) || texel.y != ((expectedInstance << kClosureIdBits) | 5) || texel.x > 1)
+				wrongCount++;
+		}
+	}
+	CHECK(wrongCount == 0);
+
+	// the same primitive ids in both instances, they are per mesh.
+	CHECK(visibility[0].x == visibility[kWidth / 2].x);
+
+	// the reversed winding alone is culled, the near and far planes clip.
+	ReferenceScene single;
+	addInstance(single, addQuad(single, 1.0f, -1, true), glm::mat4(1.0f));
+	CHECK(renderer.create(single, {}));
+	renderer.render(makeCamera(), kWidth, kHeight, 1);
+	CHECK(std::all_of(renderer.getVisibility().begin(), renderer.getVisibility().end(), isBackground));
+
+	for (float z : { -3.95f, 97.0f }) {
+		ReferenceScene plane;
+		addInstance(plane, addQuad(plane, 500.0f, -1), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, z)));
+		renderer.create(plane, {});
+		renderer.render(makeCamera(), 16, 8, 1);
+		CHECK(std::all_of(renderer.getVisibility().begin(), renderer.getVisibility().end(), isBackground));
+	}
+}
+
+TEST_CASE(shading) {
+	// a gradient along u, read back through the barycentric interpolation of the texcoords and the bilinear filter.
+	std::string gradient = writeAlbedo("gradient.png", 256, 4, [](int x, int) { return glm::u8vec4(x, 255 - x, 128, 255); });
+
+	ReferenceScene scene;
+	scene.albedoPaths = { gradient, "" };
+	int quad = addQuad(scene, 2.0f, 0);
+	addInstance(scene, quad, glm::mat4(1.0f));
+
+	ReferenceRenderer renderer;
+	CHECK(renderer.create(scene, {}));
+	ReferenceCamera camera = makeCamera();
+	renderer.render(camera, kWidth, kHeight, 1);
+
+	glm::mat4 matrix = camera.proj * camera.view;
+	size_t checkedCount = 0;
+	size_t wrongCount = 0;
+	for (uint32_t y = 0; y < kHeight; y++) {
+		for (uint32_t x = 0; x < kWidth; x++) {
+			size_t pixel = (size_t)y * kWidth + x;
+			if (isBackground(renderer.getVisibility()[pixel]))
+				continue;
+
+			// where the pixel center lands on the quad, u runs from x = 2 to x = -2.
+			glm::vec4 nearPoint = glm::inverse(matrix) * glm::vec4((x + 0.5f) / kWidth * 2.0f - 1.0f, 1.0f - (y + 0.5f) / kHeight * 2.0f, 0.0f, 1.0f);
+			glm::vec4 farPoint = glm::inverse(matrix) * glm::vec4((x + 0.5f) / kWidth * 2.0f - 1.0f, 1.0f - (y + 0.5f) / kHeight * 2.0f, 1.0f, 1.0f);
+			glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+			glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+			glm::vec3 hit = origin + direction * (-origin.z / direction.z);
+			float u = (2.0f - hit.x) / 4.0f;
+			// away from the wrap at the ends.
+			if (u < 0.01f || u > 0.99f)
+				continue;
+
+			// facing the light, so the diffuse term is 1 and with roughness 1 there is no specular.
+			float texel = glm::clamp(u * 256.0f - 0.5f, 0.0f, 255.0f);
+			glm::vec4 color = renderer.getColor()[pixel];
+			checkedCount++;
+			if (std::abs(color.r - texel / 255.0f) > 1e-3f || std::abs(color.g - (255.0f - texel) / 255.0f) > 1e-3f ||
+				std::abs(color.b - 128.0f / 255.0f) > 1e-5f || color.a != 1.0f)
+				wrongCount++;
+		}
+	}
+	CHECK(checkedCount > 1000);
+	CHECK(wrongCount == 0);
+
+	// without an albedo map the surface is white, lit from behind it keeps the ambient 0.2.
+	scene.materialIndices[0] = 1;
+	renderer.create(scene, {});
+	camera.lightDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+	renderer.render(camera, kWidth, kHeight, 1);
+	glm::vec4 center = renderer.getColor()[(size_t)(kHeight / 2) * kWidth + kWidth / 2];
+	CHECK(!isBackground(renderer.getVisibility()[(size_t)(kHeight / 2) * kWidth + kWidth / 2]));
+	CHECK(std::abs(center.r - 0.2f) < 0.01f && center.r == center.g && center.g == center.b);
+}
+
+TEST_CASE(threadCountIndependence) {
+	ReferenceScene scene;
+	int cube = addCube(scene, -1);
+	for (int i = 0; i < 20; i++)
+		addInstance(scene, cube, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(i % 5 - 2.0f, i / 5 - 1.5f, i * 0.3f)), i * 0.4f, glm::vec3(1.0f, 1.0f, 0.0f)));
+
+	ReferenceRenderer reference;
+	reference.create(scene, {}, 1);
+	reference.render(makeCamera(), kWidth, kHeight, 1);
+	for (unsigned int threadCount : { 2u, 3u, 16u }) {
+		ReferenceRenderer renderer;
+		renderer.create(scene, {}, threadCount);
+		renderer.render(makeCamera(), kWidth, kHeight, threadCount);
+		CHECK(renderer.getVisibility() == reference.getVisibility());
+		CHECK(renderer.getColor() == reference.getColor());
+	}
+}
+
+TEST_CASE(goldenImages) {
+	// a checkered floor, a textured back wall and rotated cubes of two closures seen from above.
+	ReferenceScene scene;
+	scene.albedoPaths = {
+		writeAlbedo("checker.png", 64, 64, [](int x, int y) { return ((x / 8 + y / 8) & 1) ? glm::u8vec4(230, 220, 200, 255) : glm::u8vec4(60, 70, 90, 255); }),
+		writeAlbedo("stripes.png", 32, 32, [](int x, int y) { return glm::u8vec4(x * 8, 120, y * 8, 255); }),
+		"",
+	};
+	int floor = addQuad(scene, 6.0f, 0);
+	int wall = addQuad(scene, 6.0f, 1);
+	int cube = addCube(scene, 2);
+	addInstance(scene, floor, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 2.0f)), glm::half_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f)));
+	addInstance(scene, wall, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, 8.0f)));
+	for (int i = 0; i < 6; i++) {
+		glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(i % 3 * 2.0f - 2.0f, -0.4f + i / 3 * 0.5f, i / 3 * 2.5f + 0.5f));
+		addInstance(scene, cube, glm::scale(glm::rotate(matrix, i * 0.7f, glm::vec3(0.3f, 1.0f, 0.2f)), glm::vec3(1.0f + i * 0.1f)));
+	}
+
+	ReferenceRenderer renderer;
+	CHECK(renderer.create(scene, { 1, 2, 3 }));
+	ReferenceCamera camera = makeCamera(glm::vec3(1.5f, 2.5f, -3.5f), glm::vec3(0.0f, 0.0f, 2.0f));
+	camera.lightDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, 0.6f));
+	renderer.render(camera, kWidth, kHeight);
+
+	CHECK(renderer.writeVisibility((kDirectory / "reference_visibility.png").string().c_str()));
+	CHECK(renderer.writeColor((kDirectory / "reference_color.png").string().c_str()));
+
+	if (std::getenv(kUpdateGoldenVariable)) {
+		std::filesystem::create_directories(kGoldenDirectory);
+		for (const char* name : { "reference_visibility.png", "reference_color.png" })
+			std::filesystem::copy_file(kDirectory / name, kGoldenDirectory / name, std::filesystem::copy_options::overwrite_existing);
+	}
+
+	// pixels on an edge may fall the other way with another compiler's float code, a few are allowed to differ.
+	int width, height, goldenWidth, goldenHeight;
+	std::vector<uint8_t> visibility = loadPng(kDirectory / "reference_visibility.png", width, height);
+	std::vector<uint8_t> goldenVisibility = loadPng(kGoldenDirectory / "reference_visibility.png", goldenWidth, goldenHeight);
+	CHECK(!goldenVisibility.empty());
+	CHECK(width == goldenWidth && height == goldenHeight && visibility.size() == goldenVisibility.size());
+
+	std::vector<uint8_t> color = loadPng(kDirectory / "reference_color.png", width, height);
+	std::vector<uint8_t> goldenColor = loadPng(kGoldenDirectory / "reference_color.png", goldenWidth, goldenHeight);
+	CHECK(color.size() == goldenColor.size());
+	if (visibility.size() != goldenVisibility.size() || color.size() != goldenColor.size())
+		return;
+
+	size_t visibilityMismatchCount = 0;
+	size_t colorMismatchCount = 0;
+	size_t coveredCount = 0;
+	for (size_t i = 0; i < visibility.size(); i += 4) {
+		bool isSame = std::equal(visibility.begin() + i, visibility.begin() + i + 4, goldenVisibility.begin() + i);
+		visibilityMismatchCount += isSame ? 0 : 1;
+		coveredCount += isBackground(renderer.getVisibility()[i / 4]) ? 0 : 1;
+		for (size_t j = i; j < i + 4 && isSame; j++) {
+			if (std::abs((int)color[j] - (int)goldenColor[j]) > 2) {
+				colorMismatchCount++;
+				break;
+			}
+		}
+	}
+	size_t pixelCount = visibility.size() / 4;
+	CHECK(coveredCount > pixelCount / 2);
+	CHECK(visibilityMismatchCount <= pixelCount / 200);
+	CHECK(colorMismatchCount <= pixelCount / 200);
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "../test.h"
+
+#include "../../framework/capture_replay.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "render_capture_test";
+const uint32_t kFrameCount = 6;
+const uint32_t kCapturedFrameCount = 3;
+const uint32_t kDrawCount = 10;
+
+// frames of a compute pass and a draw pass on the null device behind a capture device, the capture taking the
+// frames from the second one on.
+struct Recording {
+	NullRenderDevice device;
+	CaptureDevice capture{ &device };
+
+	bool run() {
+		BufferDesc constantDesc;
+		constantDesc.size = 256;
+		constantDesc.memoryType = MemoryType::eUpload;
+		constantDesc.name = "constants";
+		RenderHandle constants = capture.createBuffer(constantDesc);
+
+		std::vector<float> vertices(300, 1.0f);
+		BufferDesc vertexDesc;
+		vertexDesc.size = vertices.size() * sizeof(float);
+		vertexDesc.name = "vertices";
+		RenderHandle vertexBuffer = capture.createBuffer(vertexDesc, vertices.data());
+
+		BufferDesc visibilityDesc;
+		visibilityDesc.size = 64;
+		visibilityDesc.isUnorderedAccess = true;
+		visibilityDesc.name = "visibility";
+		RenderHandle visibility = capture.createBuffer(visibilityDesc);
+		uint32_t view = capture.createView(visibility, ViewType::eUnorderedAccess, 4);
+
+		TextureDesc targetDesc;
+		targetDesc.width = 64;
+		targetDesc.height = 64;
+		targetDesc.isRenderTarget = true;
+		targetDesc.name = "target";
+		RenderHandle target = capture.createTexture(targetDesc);
+
+		RenderHandle graphics = device.createPipeline("draw", false);
+		capture.registerPipeline(graphics, "draw", false);
+		RenderHandle compute = device.createPipeline("cull", true);
+		capture.registerPipeline(compute, "cull", true);
+		RenderHandle fence = capture.createFence();
+
+		std::unique_ptr<RenderCommandList> list = capture.createCommandList();
+		for (uint32_t frame = 0; frame < kFrameCount; frame++) {
+			if (frame == 1)
+				capture.captureFrames(kCapturedFrameCount);
+			float* mapped = (float*)capture.map(constants);
+			if (mapped)
+				mapped[0] = (float)frame;
+
+			list->begin();
+			list->beginEvent("cull");
+			list->setPipeline(compute);
+			list->setRootTable(0, view);
+			list->dispatch(1, 1, 1);
+			list->uavBarrier(visibility);
+			list->endEvent();
+			list->beginEvent("draw");
+			list->setPipeline(graphics);
+			list->setRenderTargets(&target, 1, kInvalidRenderHandle);
+			list->setViewport(0.0f, 0.0f, 64.0f, 64.0f);
+			list->setRootBuffer(0, RootBufferType::eConstantBuffer, constants);
+			list->setVertexBuffer(vertexBuffer, 12);
+			for (uint32_t i = 0; i < kDrawCount; i++)
+				list->draw(3, 1, i * 3, 0);
+			list->endEvent();
+			list->end();
+
+			RenderCommandList* lists[] = { list.get() };
+			capture.submit(lists, 1);
+			capture.signal(fence, frame + 1);
+			capture.endFrame();
+		}
+		return device.getErrors().empty() && capture.isCaptureComplete();
+	}
+};
+
+uint32_t countChunks(const CaptureFile& file, CaptureChunkType type) {
+	size_t offset = 0;
+	CaptureChunk chunk;
+	uint32_t count = 0;
+	while (file.nextChunk(offset, chunk))
+		count += chunk.type == type ? 1 : 0;
+	return count;
+}
+
+std::vector<char> readBytes(const std::filesystem::path& filename) {
+	std::ifstream ifs(filename, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::filesystem::path& filename, const std::vector<char>& bytes) {
+	std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+	ofs.write(bytes.data(), bytes.size());
+}
+
+}
+
+
+TEST_CASE(saveLoadReplay) {
+	Recording recording;
+	CHECK(recording.run());
+	const CaptureFile& capture = recording.capture.getCapture();
+	CHECK(capture.getFrameCount() == kCapturedFrameCount);
+
+	std::filesystem::create_directories(kDirectory);
+	CHECK(capture.save(kDirectory / "frames.rcap"));
+	CaptureFile file;
+	CHECK(file.load(kDirectory / "frames.rcap"));
+	CHECK(file.getFrameCount() == kCapturedFrameCount);
+	CHECK(file.getSize() == capture.getSize());
+
+	// a submit and a signal per frame, every resource created once before the first frame.
+	CHECK(countChunks(file, CaptureChunkType::eFrame) == kCapturedFrameCount);
+	CHECK(countChunks(file, CaptureChunkType::eSubmit) == kCapturedFrameCount);
+	CHECK(countChunks(file, CaptureChunkType::eSignal) == kCapturedFrameCount);
+	CHECK(countChunks(file, CaptureChunkType::eCreateBuffer) == 3);
+	CHECK(countChunks(file, CaptureChunkType::eCreateTexture) == 1);
+	CHECK(countChunks(file, CaptureChunkType::eCreatePipeline) == 2);
+
+	// the submitted list reads back as it was recorded.
+	size_t offset = 0;
+	CaptureChunk chunk;
+	while (file.nextChunk(offset, chunk) && chunk.type != CaptureChunkType::eSubmit) {}
+	std::vector<CommandStream> lists;
+	CHECK(chunk.type == CaptureChunkType::eSubmit && CaptureFile::readLists(chunk, lists));
+	CHECK(lists.size() == 1);
+	if (lists.size() == 1) {
+		CHECK(lists[0].getCommandCount() == 13 + kDrawCount);
+		CHECK(lists[0].countCommands(RenderCommandType::eDraw) == kDrawCount);
+		CHECK(lists[0].getCommand(0).type == RenderCommandType::eBeginEvent);
+	}
+
+	CaptureStats stats;
+	CHECK(computeCaptureStats(file, stats));
+	CHECK(stats.frames.size() == kCapturedFrameCount);
+	for (const CaptureFrameStats& frame : stats.frames)
+		CHECK(frame.draws == kDrawCount && frame.dispatches == 1 && frame.submits == 1);
+
+	NullRenderDevice device;
+	CaptureReplayer replayer;
+	std::vector<ReplayFrameTime> times;
+	CHECK(replayer.replay(file, &device, true, times));
+	CHECK(times.size() == kCapturedFrameCount);
+	CHECK(device.getSubmitCount() >= kCapturedFrameCount);
+	CHECK(device.getErrors().empty());
+}
+
+TEST_CASE(damagedFiles) {
+	Recording recording;
+	CHECK(recording.run());
+	std::filesystem::create_directories(kDirectory);
+	CHECK(recording.capture.getCapture().save(kDirectory / "frames.rcap"));
+	std::vector<char> bytes = readBytes(kDirectory / "frames.rcap");
+	CHECK(bytes.size() > 12);
+
+	CaptureFile file;
+	CHECK(!file.load(kDirectory / "missing.rcap"));
+
+	// cut inside the last chunk, and inside the header.
+	writeBytes(kDirectory / "truncated.rcap", std::vector<char>(bytes.begin(), bytes.end() - 5));
+	CHECK(!file.load(kDirectory / "truncated.rcap"));
+	CHECK(file.getSize() == 0 && file.getFrameCount() == 0);
+	writeBytes(kDirectory / "header.rcap", std::vector<char>(bytes.begin(), bytes.begin() + 8));
+	CHECK(!file.load(kDirectory / "header.rcap"));
+
+	// the version follows the magic.
+	std::vector<char> version = bytes;
+	version[4]++;
+	writeBytes(kDirectory / "version.rcap", version);
+	CHECK(!file.load(kDirectory / "version.rcap"));
+
+	CHECK(file.load(kDirectory / "frames.rcap"));
+}
+
+TEST_CASE(oversizedListCount) {
+	// a submit chunk claiming more lists than its bytes could hold fails before allocating them.
+	const uint32_t body[] = { 0xffffffff, 0, 0 };
+	CaptureChunk chunk;
+	chunk.type = CaptureChunkType::eSubmit;
+	chunk.data = (const uint8_t*)body;
+	chunk.size = sizeof(body);
+	std::vector<CommandStream> lists;
+	CHECK(!CaptureFile::readLists(chunk, lists));
+	CHECK(lists.empty());
+
+	// one empty list fits.
+	const uint32_t empty[] = { 1, 0, 0 };
+	chunk.data = (const uint8_t*)empty;
+	CHECK(CaptureFile::readLists(chunk, lists));
+	CHECK(lists.size() == 1 && lists[0].getCommandCount() == 0);
+
+	// two do not.
+	const uint32_t two[] = { 2, 0, 0 };
+	chunk.data = (const uint8_t*)two;
+	CHECK(!CaptureFile::readLists(chunk, lists));
+}
\ No newline at end of file
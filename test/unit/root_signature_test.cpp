@@ -0,0 +1,269 @@
+#include "../test.h"
+
+#include "../../framework/root_signature.h"
+
+#include <climits>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+enum class ParameterKind {
+	eTable,
+	eConstants,
+	eRootDescriptor,
+	eStaticSampler,
+};
+
+struct ParameterDesc {
+	ParameterKind kind;
+	D3D12_SHADER_VISIBILITY visibility;
+	// the range type of a table, the CBV/SRV/UAV root parameter type of a root descriptor.
+	int type;
+	UINT shaderRegister;
+	UINT registerSpace;
+	// the descriptors of a table, the 32-bit values of constants.
+	UINT count;
+	// the range flags of a table, the descriptor flags of a root descriptor.
+	UINT flags;
+};
+
+struct RootSignatureDesc {
+	const char* name;
+	D3D12_ROOT_SIGNATURE_FLAGS flags;
+	std::vector<ParameterDesc> parameters;
+};
+
+const D3D12_DESCRIPTOR_RANGE_FLAGS kVolatile = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+
+const D3D12_ROOT_SIGNATURE_FLAGS kComputeFlags =
+	D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+	D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+	D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+// the four root signatures of App::initialize: the visibility pass built by hand and the material passes in the
+// order BindingLayout builds them from the registers of their shaders.
+std::vector<RootSignatureDesc> getAppRootSignatures() {
+	std::vector<RootSignatureDesc> descs;
+
+	descs.push_back({ "visibility", kComputeFlags | D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT, {
+		{ ParameterKind::eRootDescriptor, D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_PARAMETER_TYPE_CBV, 0, 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE },
+		{ ParameterKind::eConstants, D3D12_SHADER_VISIBILITY_ALL, 0, 1, 0, 2, 0 },
+		{ ParameterKind::eRootDescriptor, D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC },
+		{ ParameterKind::eRootDescriptor, D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_PARAMETER_TYPE_SRV, 1, 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC },
+	} });
+
+	descs.push_back({ "material count", kComputeFlags, {
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 0, 1, kVolatile },
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 0, 1, kVolatile },
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 1, kVolatile },
+	} });
+
+	descs.push_back({ "material sort", kComputeFlags, {
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 0, 1, kVolatile },
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 1, kVolatile },
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0, 1, kVolatile },
+		{ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 0, 1, kVolatile },
+	} });
+
+	std::vector<ParameterDesc> rendering = {
+		{ ParameterKind::eRootDescriptor, D3D12_SHADER_VISIBILITY_ALL, D3D12_ROOT_PARAMETER_TYPE_CBV, 0, 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE },
+		{ ParameterKind::eConstants, D3D12_SHADER_VISIBILITY_ALL, 0, 1, 0, 2, 0 },
+	};
+	for (UINT i = 0; i <= 6; i++)
+		rendering.push_back({ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, i, 0, 1, kVolatile });
+	rendering.push_back({ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1, UINT_MAX, kVolatile });
+	rendering.push_back({ ParameterKind::eTable, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 0, 1, kVolatile });
+	rendering.push_back({ ParameterKind::eStaticSampler, D3D12_SHADER_VISIBILITY_ALL, D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 0, 0, 1, 0 });
+	descs.push_back({ "rendering", kComputeFlags, rendering });
+
+	return descs;
+}
+
+void build(const RootSignatureDesc& desc, RootSignature& rootSignature) {
+	D3D12_SAMPLER_DESC samplerDesc{};
+	samplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
+
+	for (const ParameterDesc& param : desc.parameters) {
+		switch (param.kind) {
+		case ParameterKind::eTable:
+			rootSignature.addDescriptorCount(param.visibility, (D3D12_DESCRIPTOR_RANGE_TYPE)param.type, param.shaderRegister, param.count,
+				D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, (D3D12_DESCRIPTOR_RANGE_FLAGS)param.flags, param.registerSpace);
+			break;
+		case ParameterKind::eConstants:
+			rootSignature.addConstants(param.visibility, param.shaderRegister, param.count, param.registerSpace);
+			break;
+		case ParameterKind::eRootDescriptor:
+			rootSignature.addRootDescriptor(param.visibility, (D3D12_ROOT_PARAMETER_TYPE)param.type, param.shaderRegister,
+				(D3D12_ROOT_DESCRIPTOR_FLAGS)param.flags, param.registerSpace);
+			break;
+		case ParameterKind::eStaticSampler:
+			rootSignature.addStaticSampler(param.visibility, samplerDesc, param.shaderRegister, param.registerSpace);
+			break;
+		}
+	}
+}
+
+D3D12_DESCRIPTOR_RANGE_TYPE getRangeType(const ParameterDesc& param) {
+	switch (param.kind) {
+	case ParameterKind::eConstants:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	case ParameterKind::eRootDescriptor:
+		return param.type == D3D12_ROOT_PARAMETER_TYPE_CBV ? D3D12_DESCRIPTOR_RANGE_TYPE_CBV :
+			param.type == D3D12_ROOT_PARAMETER_TYPE_SRV ? D3D12_DESCRIPTOR_RANGE_TYPE_SRV : D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+	default:
+		return (D3D12_DESCRIPTOR_RANGE_TYPE)param.type;
+	}
+}
+
+// compares a deserialized 1.1 root signature with its description.
+void checkDesc(const RootSignatureDesc& desc, const D3D12_ROOT_SIGNATURE_DESC1& result) {
+	CHECK(result.Flags == desc.flags);
+
+	UINT parameter = 0;
+	UINT sampler = 0;
+	for (const ParameterDesc& param : desc.parameters) {
+		if (param.kind == ParameterKind::eStaticSampler) {
+			CHECK(sampler < result.NumStaticSamplers);
+			if (sampler >= result.NumStaticSamplers)
+				return;
+
+			const D3D12_STATIC_SAMPLER_DESC& samplerDesc = result.pStaticSamplers[sampler++];
+			CHECK(samplerDesc.ShaderRegister == param.shaderRegister);
+			CHECK(samplerDesc.RegisterSpace == param.registerSpace);
+			CHECK(samplerDesc.AddressU == D3D12_TEXTURE_ADDRESS_MODE_WRAP);
+			continue;
+		}
+
+		CHECK(parameter < result.NumParameters);
+		if (parameter >= result.NumParameters)
+			return;
+
+		const D3D12_ROOT_PARAMETER1& rootParam = result.pParameters[parameter++];
+		CHECK(rootParam.ShaderVisibility == param.visibility);
+		switch (param.kind) {
+		case ParameterKind::eTable:
+			CHECK(rootParam.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE);
+			CHECK(rootParam.DescriptorTable.NumDescriptorRanges == 1);
+			CHECK(rootParam.DescriptorTable.pDescriptorRanges[0].RangeType == (D3D12_DESCRIPTOR_RANGE_TYPE)param.type);
+			CHECK(rootParam.DescriptorTable.pDescriptorRanges[0].BaseShaderRegister == param.shaderRegister);
+			CHECK(rootParam.DescriptorTable.pDescriptorRanges[0].RegisterSpace == param.registerSpace);
+			CHECK(rootParam.DescriptorTable.pDescriptorRanges[0].NumDescriptors == param.count);
+			CHECK(rootParam.DescriptorTable.pDescriptorRanges[0].Flags == (D3D12_DESCRIPTOR_RANGE_FLAGS)param.flags);
+			break;
+		case ParameterKind::eConstants:
+			CHECK(rootParam.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS);
+			CHECK(rootParam.Constants.ShaderRegister == param.shaderRegister);
+			CHECK(rootParam.Constants.Num32BitValues == param.count);
+			break;
+		default:
+			CHECK(rootParam.ParameterType == (D3D12_ROOT_PARAMETER_TYPE)param.type);
+			CHECK(rootParam.Descriptor.ShaderRegister == param.shaderRegister);
+			CHECK(rootParam.Descriptor.Flags == (D3D12_ROOT_DESCRIPTOR_FLAGS)param.flags);
+			break;
+		}
+	}
+
+	CHECK(parameter == result.NumParameters);
+	CHECK(sampler == result.NumStaticSamplers);
+}
+
+}
+
+
+TEST_CASE(serializeVersion1_1) {
+	for (const RootSignatureDesc& desc : getAppRootSignatures()) {
+		RootSignature rootSignature;
+		build(desc, rootSignature);
+
+		Microsoft::WRL::ComPtr<ID3DBlob> signature;
+		Microsoft::WRL::ComPtr<ID3DBlob> error;
+		bool isSerialized = rootSignature.serialize(D3D_ROOT_SIGNATURE_VERSION_1_1, desc.flags, signature.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf());
+		CHECK(isSerialized);
+		if (!isSerialized)
+			continue;
+
+		Microsoft::WRL::ComPtr<ID3D12VersionedRootSignatureDeserializer> deserializer;
+		CHECK(SUCCEEDED(D3D12CreateVersionedRootSignatureDeserializer(signature->GetBufferPointer(), signature->GetBufferSize(),
+			IID_PPV_ARGS(deserializer.ReleaseAndGetAddressOf()))));
+		if (!deserializer)
+			continue;
+
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC* result = nullptr;
+		CHECK(SUCCEEDED(deserializer->GetRootSignatureDescAtVersion(D3D_ROOT_SIGNATURE_VERSION_1_1, &result)));
+		if (result)
+			checkDesc(desc, result->Desc_1_1);
+	}
+}
+
+TEST_CASE(serializeVersion1_0) {
+	// 1.0 has no volatility flags, the runtime reads the parameters back as volatile descriptors and data.
+	for (const RootSignatureDesc& desc : getAppRootSignatures()) {
+		RootSignature rootSignature;
+		build(desc, rootSignature);
+
+		Microsoft::WRL::ComPtr<ID3DBlob> signature;
+		Microsoft::WRL::ComPtr<ID3DBlob> error;
+		CHECK(rootSignature.serialize(D3D_ROOT_SIGNATURE_VERSION_1_0, desc.flags, signature.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf()));
+		if (!signature)
+			continue;
+
+		Microsoft::WRL::ComPtr<ID3D12VersionedRootSignatureDeserializer> deserializer;
+		CHECK(SUCCEEDED(D3D12CreateVersionedRootSignatureDeserializer(signature->GetBufferPointer(), signature->GetBufferSize(),
+			IID_PPV_ARGS(deserializer.ReleaseAndGetAddressOf()))));
+		if (!deserializer)
+			continue;
+
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC* result = deserializer->GetUnconvertedRootSignatureDesc();
+		CHECK(result->Version == D3D_ROOT_SIGNATURE_VERSION_1_0);
+		CHECK(result->Desc_1_0.NumParameters == rootSignature.getParameterCount());
+		CHECK(result->Desc_1_0.NumStaticSamplers == rootSignature.getStaticSamplerCount());
+	}
+}
+
+TEST_CASE(serializeIsDeterministic) {
+	// the pipeline cache keys pipelines by the hash of the serialized root signature.
+	for (const RootSignatureDesc& desc : getAppRootSignatures()) {
+		RootSignature a;
+		RootSignature b;
+		build(desc, a);
+		build(desc, b);
+
+		Microsoft::WRL::ComPtr<ID3DBlob> signatureA;
+		Microsoft::WRL::ComPtr<ID3DBlob> signatureB;
+		Microsoft::WRL::ComPtr<ID3DBlob> error;
+		CHECK(a.serialize(D3D_ROOT_SIGNATURE_VERSION_1_1, desc.flags, signatureA.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf()));
+		CHECK(b.serialize(D3D_ROOT_SIGNATURE_VERSION_1_1, desc.flags, signatureB.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf()));
+		if (!signatureA || !signatureB)
+			continue;
+
+		CHECK(signatureA->GetBufferSize() == signatureB->GetBufferSize());
+		CHECK(std::memcmp(signatureA->GetBufferPointer(), signatureB->GetBufferPointer(), signatureA->GetBufferSize()) == 0);
+	}
+}
+
+TEST_CASE(isBound) {
+	for (const RootSignatureDesc& desc : getAppRootSignatures()) {
+		RootSignature rootSignature;
+		build(desc, rootSignature);
+
+		for (const ParameterDesc& param : desc.parameters) {
+			CHECK(rootSignature.isBound(getRangeType(param), param.shaderRegister, param.registerSpace));
+			// nothing is bound in the next space.
+			CHECK(!rootSignature.isBound(getRangeType(param), param.shaderRegister, param.registerSpace + 2));
+		}
+	}
+
+	// the unbounded texture array of rendering_cs.fx covers every register of its space.
+	RootSignature rootSignature;
+	build(getAppRootSignatures()[3], rootSignature);
+	CHECK(rootSignature.isBound(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1000, 1));
+	CHECK(!rootSignature.isBound(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 7, 0));
+	CHECK(!rootSignature.isBound(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0));
+	CHECK(!rootSignature.isBound(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0));
+}
\ No newline at end of file
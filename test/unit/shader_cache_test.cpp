@@ -0,0 +1,205 @@
+#include "../test.h"
+
+#include "../../framework/shader_cache.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "shader_cache_test";
+
+void writeFile(const std::filesystem::path& filename, const std::string& text) {
+	std::filesystem::create_directories(filename.parent_path());
+	std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+	ofs << text;
+}
+
+std::vector<uint8_t> makeBytecode(size_t size, uint8_t seed) {
+	std::vector<uint8_t> bytecode(size);
+	for (size_t i = 0; i < size; i++)
+		bytecode[i] = (uint8_t)(seed + i * 31);
+	return bytecode;
+}
+
+ShaderCache& resetCache(uint64_t maxSize = 64ull * 1024 * 1024) {
+	ShaderCache& cache = ShaderCache::Instance();
+	cache.setDirectory(kDirectory / "cache");
+	cache.setMaxSize(maxSize);
+	cache.setEnable(true);
+	cache.clear();
+	return cache;
+}
+
+std::filesystem::path getEntryPath(uint64_t key) {
+	static const char* digits = "0123456789abcdef";
+	std::string name(16, '0');
+	for (int i = 15; i >= 0; i--, key >>= 4)
+		name[i] = digits[key & 0xf];
+	return kDirectory / "cache" / (name + ".dxil");
+}
+
+uint64_t getDirectorySize() {
+	uint64_t size = 0;
+	std::error_code ec;
+	for (auto& ite : std::filesystem::directory_iterator(kDirectory / "cache", ec))
+		size += ite.file_size(ec);
+	return size;
+}
+
+uint64_t computeKey(const char* filename, const std::vector<ShaderDefine>& defines = {}, uint64_t compilerVersion = 1) {
+	return ShaderCache::Instance().computeKey(kDirectory / "src" / filename, L"main", L"cs_6_6", defines, compilerVersion);
+}
+
+}
+
+
+TEST_CASE(storeAndLoad) {
+	ShaderCache& cache = resetCache();
+
+	std::vector<uint8_t> bytecode = makeBytecode(1000, 1);
+	CHECK(cache.store(42, bytecode.data(), bytecode.size()));
+
+	std::vector<uint8_t> loaded;
+	CHECK(cache.load(42, loaded));
+	CHECK(loaded == bytecode);
+
+	// misses.
+	CHECK(!cache.load(43, loaded));
+	CHECK(!cache.load(0, loaded));
+	CHECK(!cache.store(0, bytecode.data(), bytecode.size()));
+
+	cache.setEnable(false);
+	CHECK(!cache.load(42, loaded));
+	cache.setEnable(true);
+}
+
+TEST_CASE(damagedEntries) {
+	ShaderCache& cache = resetCache();
+	std::vector<uint8_t> bytecode = makeBytecode(4096, 2);
+	std::vector<uint8_t> loaded;
+
+	// cut short.
+	CHECK(cache.store(1, bytecode.data(), bytecode.size()));
+	std::filesystem::resize_file(getEntryPath(1), std::filesystem::file_size(getEntryPath(1)) - 100);
+	CHECK(!cache.load(1, loaded));
+	// the entry is removed, so the next compile stores it again.
+	CHECK(!std::filesystem::exists(getEntryPath(1)));
+
+	// longer than the header says.
+	CHECK(cache.store(2, bytecode.data(), bytecode.size()));
+	{
+		std::ofstream ofs(getEntryPath(2), std::ios::binary | std::ios::app);
+		ofs << "garbage";
+	}
+	CHECK(!cache.load(2, loaded));
+
+	// same size, different bytes.
+	CHECK(cache.store(3, bytecode.data(), bytecode.size()));
+	{
+		std::fstream fs(getEntryPath(3), std::ios::binary | std::ios::in | std::ios::out);
+		fs.seekp(-10, std::ios::end);
+		fs.put('x');
+	}
+	CHECK(!cache.load(3, loaded));
+	CHECK(loaded.empty());
+
+	// a header cut in the middle.
+	CHECK(cache.store(4, bytecode.data(), bytecode.size()));
+	std::filesystem::resize_file(getEntryPath(4), 12);
+	CHECK(!cache.load(4, loaded));
+
+	// an entry copied to another key.
+	CHECK(cache.store(5, bytecode.data(), bytecode.size()));
+	std::filesystem::copy_file(getEntryPath(5), getEntryPath(6));
+	CHECK(!cache.load(6, loaded));
+	CHECK(cache.load(5, loaded) && loaded == bytecode);
+
+	// the files were changed behind the back of the running size, opening the directory again recounts it.
+	cache.setDirectory(kDirectory / "cache");
+	CHECK(cache.getSize() == getDirectorySize());
+}
+
+TEST_CASE(runningSize) {
+	ShaderCache& cache = resetCache();
+	CHECK(cache.getSize() == 0);
+
+	for (uint8_t i = 1; i <= 10; i++) {
+		std::vector<uint8_t> bytecode = makeBytecode(100 * i, i);
+		CHECK(cache.store(i, bytecode.data(), bytecode.size()));
+	}
+	CHECK(cache.getSize() == getDirectorySize());
+
+	// replacing an entry only counts the new size.
+	std::vector<uint8_t> bytecode = makeBytecode(50, 0);
+	CHECK(cache.store(10, bytecode.data(), bytecode.size()));
+	CHECK(cache.getSize() == getDirectorySize());
+
+	// a cache opened on an existing directory starts from its size.
+	cache.setDirectory(kDirectory / "cache");
+	CHECK(cache.getSize() == getDirectorySize());
+
+	cache.clear();
+	CHECK(cache.getSize() == 0);
+}
+
+TEST_CASE(evictLeastRecentlyUsed) {
+	// room for three entries.
+	const size_t entrySize = 10000;
+	ShaderCache& cache = resetCache(3 * entrySize + 3 * 64);
+	std::vector<uint8_t> loaded;
+
+	for (uint8_t i = 1; i <= 3; i++) {
+		std::vector<uint8_t> bytecode = makeBytecode(entrySize, i);
+		CHECK(cache.store(i, bytecode.data(), bytecode.size()));
+	}
+	CHECK(cache.load(1, loaded));
+
+	std::vector<uint8_t> bytecode = makeBytecode(entrySize, 4);
+	CHECK(cache.store(4, bytecode.data(), bytecode.size()));
+
+	// 2 is the oldest after 1 was loaded.
+	CHECK(cache.load(1, loaded));
+	CHECK(!cache.load(2, loaded));
+	CHECK(cache.load(3, loaded));
+	CHECK(cache.load(4, loaded));
+	CHECK(cache.getSize() <= 3 * entrySize + 3 * 64);
+	CHECK(cache.getSize() == getDirectorySize());
+}
+
+TEST_CASE(includeInvalidation) {
+	resetCache();
+	writeFile(kDirectory / "src" / "common.hlsli", "float4 common;\n");
+	writeFile(kDirectory / "src" / "detail" / "nested.hlsli", "#include \"../common.hlsli\"\nfloat nested;\n");
+	writeFile(kDirectory / "src" / "a.fx", "  #  include \"detail/nested.hlsli\"\nvoid main() {}\n");
+	writeFile(kDirectory / "src" / "b.fx", "void main() {}\n");
+
+	std::vector<std::filesystem::path> files;
+	CHECK(ShaderCache::collectIncludes(kDirectory / "src" / "a.fx", files));
+	CHECK(files.size() == 3);
+
+	uint64_t a = computeKey("a.fx");
+	uint64_t b = computeKey("b.fx");
+	CHECK(a != 0 && b != 0 && a != b);
+	CHECK(computeKey("a.fx") == a);
+
+	// an edit two includes down changes the key of the source, not of the shader that does not include it.
+	writeFile(kDirectory / "src" / "common.hlsli", "float4 common2;\n");
+	uint64_t edited = computeKey("a.fx");
+	CHECK(edited != a);
+	CHECK(computeKey("b.fx") == b);
+
+	// the defines and the compiler are part of the key.
+	CHECK(computeKey("a.fx", { { L"FEATURE", L"1" } }) != edited);
+	CHECK(computeKey("a.fx", { { L"FEATURE", L"1" } }) != computeKey("a.fx", { { L"FEATURE", L"0" } }));
+	CHECK(computeKey("a.fx", {}, 2) != edited);
+
+	// a missing include can not be keyed.
+	writeFile(kDirectory / "src" / "c.fx", "#include \"missing.hlsli\"\n");
+	CHECK(computeKey("c.fx") == 0);
+
+	std::error_code ec;
+	std::filesystem::remove_all(kDirectory, ec);
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "../test.h"
+
+#include "../../tools/shader_hot_reload.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+const std::filesystem::path kDirectory = std::filesystem::temp_directory_path() / "shader_hot_reload_test";
+
+void writeFile(const std::filesystem::path& filename, const std::string& text) {
+	std::filesystem::create_directories(filename.parent_path());
+	std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+	ofs << text;
+}
+
+// counts a version per shader instead of compiling, the includes are read from disk by the default getDependencies.
+class FakeShaderCompiler : public ShaderCompiler {
+public:
+	bool compile(int handle, const ShaderSource& source) override {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		resize(handle);
+		m_compileCount++;
+		m_compiledSources.push_back(source.filename.filename().string());
+		if (m_isFailing)
+			return false;
+
+		m_compiled[handle] = m_versions[handle] + 1;
+		return true;
+	}
+
+	void commit(int handle) override {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_versions[handle] = m_compiled[handle];
+	}
+
+	int getVersion(int handle) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		resize(handle);
+		return m_versions[handle];
+	}
+
+	int getCompileCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_compileCount;
+	}
+
+	std::vector<std::string> takeCompiledSources() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return std::move(m_compiledSources);
+	}
+
+	void setFailing(bool isFailing) { m_isFailing = isFailing; }
+
+private:
+	void resize(int handle) {
+		if (handle >= (int)m_versions.size()) {
+			m_versions.resize(handle + 1, 0);
+			m_compiled.resize(handle + 1, 0);
+		}
+	}
+
+	std::mutex m_mutex;
+	std::vector<int> m_versions;
+	std::vector<int> m_compiled;
+	std::vector<std::string> m_compiledSources;
+	int m_compileCount = 0;
+	bool m_isFailing = false;
+};
+
+ShaderSource makeSource(const char* filename) {
+	return { kDirectory / filename, L"main", L"cs_6_0", {} };
+}
+
+void writeSources() {
+	std::error_code ec;
+	std::filesystem::remove_all(kDirectory, ec);
+	writeFile(kDirectory / "common.hlsli", "float4 common;\n");
+	writeFile(kDirectory / "detail" / "nested.hlsli", "#include \"../common.hlsli\"\n");
+	writeFile(kDirectory / "a.fx", "#include \"detail/nested.hlsli\"\nvoid main() {}\n");
+	writeFile(kDirectory / "b.fx", "void main() {}\n");
+	writeFile(kDirectory / "c.fx", "#include \"common.hlsli\"\nvoid main() {}\n");
+}
+
+}
+
+
+TEST_CASE(includeInvalidation) {
+	writeSources();
+	FakeShaderCompiler compiler;
+	ShaderHotReload hotReload;
+	hotReload.setCompiler(&compiler);
+
+	int a = hotReload.addShader(makeSource("a.fx"));
+	int b = hotReload.addShader(makeSource("b.fx"));
+	int c = hotReload.addShader(makeSource("c.fx"));
+	CHECK(hotReload.getDependencies(a).size() == 3);
+	CHECK(hotReload.getDependencies(b).size() == 1);
+
+	int rebuildA = 0;
+	int rebuildBC = 0;
+	hotReload.addPipeline({ a }, [&]() { rebuildA++; return true; });
+	hotReload.addPipeline({ b, c }, [&]() { rebuildBC++; return true; });
+
+	// an include two levels down reaches a and c, not b.
+	hotReload.notifyChanged({ kDirectory / "detail" / ".." / "common.hlsli" });
+	CHECK(hotReload.compilePending() == 2);
+	CHECK((compiler.takeCompiledSources() == std::vector<std::string>{ "a.fx", "c.fx" }));
+	CHECK(hotReload.update(2, 1) == 2);
+	CHECK(rebuildA == 1 && rebuildBC == 1);
+
+	// a file nothing includes.
+	writeFile(kDirectory / "unused.hlsli", "float unused;\n");
+	hotReload.notifyChanged({ kDirectory / "unused.hlsli" });
+	CHECK(hotReload.compilePending() == 0);
+
+	// the same shader changed twice before compiling is compiled once.
+	hotReload.notifyChanged({ kDirectory / "b.fx", kDirectory / "b.fx" });
+	CHECK(hotReload.compilePending() == 1);
+	CHECK(hotReload.update(3, 2) == 1);
+	CHECK(rebuildA == 1 && rebuildBC == 2);
+
+	// the watched directory stands for an overflowed change list and recompiles everything.
+	CHECK(hotReload.create(kDirectory));
+	hotReload.destroy();
+	hotReload.notifyChanged({ kDirectory });
+	CHECK(hotReload.compilePending() == 3);
+	CHECK(hotReload.update(4, 3) == 2);
+}
+
+TEST_CASE(editedIncludes) {
+	writeSources();
+	FakeShaderCompiler compiler;
+	ShaderHotReload hotReload;
+	hotReload.setCompiler(&compiler);
+
+	int a = hotReload.addShader(makeSource("a.fx"));
+	int rebuildCount = 0;
+	hotReload.addPipeline({ a }, [&]() { rebuildCount++; return true; });
+
+	// an edit that drops the include.
+	writeFile(kDirectory / "a.fx", "void main() {}\n");
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	CHECK(hotReload.compilePending() == 1);
+	// the old includes stay in effect until the swap.
+	CHECK(hotReload.getDependencies(a).size() == 3);
+	hotReload.update(2, 1);
+	CHECK(hotReload.getDependencies(a).size() == 1);
+
+	hotReload.notifyChanged({ kDirectory / "common.hlsli" });
+	CHECK(hotReload.compilePending() == 0);
+
+	// and one that adds a new one.
+	writeFile(kDirectory / "added.hlsli", "float added;\n");
+	writeFile(kDirectory / "a.fx", "#include \"added.hlsli\"\nvoid main() {}\n");
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	CHECK(hotReload.compilePending() == 1);
+	hotReload.update(3, 2);
+
+	hotReload.notifyChanged({ kDirectory / "added.hlsli" });
+	CHECK(hotReload.compilePending() == 1);
+	hotReload.update(4, 3);
+	CHECK(rebuildCount == 3);
+}
+
+TEST_CASE(failedCompile) {
+	writeSources();
+	FakeShaderCompiler compiler;
+	ShaderHotReload hotReload;
+	hotReload.setCompiler(&compiler);
+
+	int a = hotReload.addShader(makeSource("a.fx"));
+	int rebuildCount = 0;
+	hotReload.addPipeline({ a }, [&]() { rebuildCount++; return true; });
+
+	compiler.setFailing(true);
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	CHECK(hotReload.compilePending() == 0);
+	CHECK(hotReload.update(2, 1) == 0);
+	CHECK(rebuildCount == 0);
+	CHECK(compiler.getVersion(a) == 0);
+
+	// fixing the error picks the shader up again.
+	compiler.setFailing(false);
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	CHECK(hotReload.compilePending() == 1);
+	CHECK(hotReload.update(3, 2) == 1);
+	CHECK(compiler.getVersion(a) == 1);
+
+	// a pipeline that fails to rebuild is not counted and retires nothing.
+	hotReload.addPipeline({ a }, []() { return false; });
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	hotReload.compilePending();
+	CHECK(hotReload.update(4, 3) == 1);
+	CHECK(hotReload.getRetiredCount() == 0);
+}
+
+TEST_CASE(retireAfterFence) {
+	writeSources();
+	FakeShaderCompiler compiler;
+	ShaderHotReload hotReload;
+	hotReload.setCompiler(&compiler);
+
+	int a = hotReload.addShader(makeSource("a.fx"));
+	std::shared_ptr<int> pipeline = std::make_shared<int>(0);
+	int versionAtRebuild = -1;
+	hotReload.addPipeline({ a }, [&]() {
+		// the new shader is committed before the pipeline is rebuilt from it.
+		versionAtRebuild = compiler.getVersion(a);
+		hotReload.retire(pipeline);
+		pipeline = std::make_shared<int>(versionAtRebuild);
+		return true;
+	});
+
+	std::weak_ptr<int> first = pipeline;
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	hotReload.compilePending();
+	// the frame being recorded signals 10, the gpu is at 8 and may still use the old pipeline.
+	CHECK(hotReload.update(10, 8) == 1);
+	CHECK(versionAtRebuild == 1);
+	CHECK(hotReload.getRetiredCount() == 1);
+	CHECK(!first.expired());
+
+	CHECK(hotReload.update(11, 9) == 0);
+	CHECK(!first.expired());
+
+	// a second swap before the first one is released.
+	std::weak_ptr<int> second = pipeline;
+	hotReload.notifyChanged({ kDirectory / "a.fx" });
+	hotReload.compilePending();
+	CHECK(hotReload.update(12, 9) == 1);
+	CHECK(hotReload.getRetiredCount() == 2);
+
+	// the gpu passed the first swap only.
+	CHECK(hotReload.update(13, 10) == 0);
+	CHECK(first.expired());
+	CHECK(!second.expired());
+	CHECK(hotReload.getRetiredCount() == 1);
+
+	CHECK(hotReload.update(14, 12) == 0);
+	CHECK(second.expired());
+	CHECK(hotReload.getRetiredCount() == 0);
+
+	hotReload.retire(nullptr);
+	CHECK(hotReload.getRetiredCount() == 0);
+}
+
+TEST_CASE(watcherThread) {
+	writeSources();
+	FakeShaderCompiler compiler;
+	ShaderHotReload hotReload;
+	hotReload.setCompiler(&compiler);
+
+	hotReload.addShader(makeSource("a.fx"));
+	int b = hotReload.addShader(makeSource("b.fx"));
+	int rebuildCount = 0;
+	hotReload.addPipeline({ b }, [&]() { rebuildCount++; return true; });
+	CHECK(hotReload.create(kDirectory));
+
+	writeFile(kDirectory / "b.fx", "float edited;\nvoid main() {}\n");
+
+	// compiling waits for the directory to settle, a few seconds leave room for a loaded machine.
+	size_t rebuilt = 0;
+	uint64_t fenceValue = 1;
+	for (int i = 0; i < 100 && rebuilt == 0; i++, fenceValue++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		rebuilt = hotReload.update(fenceValue + 1, fenceValue);
+	}
+	hotReload.destroy();
+
+	CHECK(rebuilt == 1);
+	CHECK(rebuildCount == 1);
+	CHECK(compiler.getCompileCount() == 1);
+
+	std::error_code ec;
+	std::filesystem::remove_all(kDirectory, ec);
+}
\ No newline at end of file
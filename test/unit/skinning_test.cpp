@@ -0,0 +1,146 @@
+#include "../test.h"
+
+#include "../../tools/skinning.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+const uint32_t kJointCount = 32;
+// odd, so a two vertex path has a vertex left over.
+const uint32_t kVertexCount = 4001;
+
+struct Mesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<SkinVertex> skin;
+	std::vector<glm::mat4> matrices;
+
+	Mesh(uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (uint32_t i = 0; i < kJointCount; i++) {
+			glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+			matrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random))) * glm::mat4_cast(rotation));
+		}
+		for (uint32_t i = 0; i < kVertexCount; i++) {
+			positions.push_back(glm::vec3(unit(random), unit(random), unit(random)));
+			normals.push_back(glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.01f)));
+
+			// one to four joints, the weights sum to 255 like the import leaves them.
+			SkinVertex vertex = {};
+			int influenceCount = 1 + (int)(random() % 4);
+			int remaining = 255;
+			for (int j = 0; j < influenceCount; j++) {
+				vertex.joints[j] = (uint16_t)(random() % kJointCount);
+				int weight = j + 1 == influenceCount ? remaining : (int)(random() % (remaining + 1));
+				vertex.weights[j] = (uint8_t)weight;
+				remaining -= weight;
+			}
+			skin.push_back(vertex);
+		}
+	}
+
+	glm::mat4 blendMatrix(uint32_t vertex) const {
+		glm::mat4 result(0.0f);
+		for (int j = 0; j < 4; j++)
+			result += matrices[skin[vertex].joints[j]] * (skin[vertex].weights[j] / 255.0f);
+		return result;
+	}
+};
+
+}
+
+
+TEST_CASE(linear) {
+	Mesh mesh(1);
+	std::vector<glm::vec3> positions(kVertexCount);
+	std::vector<glm::vec3> normals(kVertexCount);
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	skinLinear(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, mesh.matrices.data(),
+		positions.data(), normals.data(), &boundsMin, &boundsMax);
+
+	float positionError = 0.0f;
+	float normalError = 0.0f;
+	glm::vec3 expectedMin(FLT_MAX);
+	glm::vec3 expectedMax(-FLT_MAX);
+	for (uint32_t i = 0; i < kVertexCount; i++) {
+		glm::mat4 matrix = mesh.blendMatrix(i);
+		glm::vec3 position = glm::vec3(matrix * glm::vec4(mesh.positions[i], 1.0f));
+		glm::vec3 normal = glm::normalize(glm::mat3(matrix) * mesh.normals[i]);
+		positionError = (std::max)(positionError, glm::length(position - positions[i]));
+		normalError = (std::max)(normalError, glm::length(normal - normals[i]));
+		expectedMin = glm::min(expectedMin, positions[i]);
+		expectedMax = glm::max(expectedMax, positions[i]);
+	}
+	CHECK(positionError < 1e-5f);
+	CHECK(normalError < 1e-4f);
+	CHECK(boundsMin == expectedMin && boundsMax == expectedMax);
+
+	// the bounds are optional.
+	std::vector<glm::vec3> withoutBounds(kVertexCount);
+	skinLinear(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, mesh.matrices.data(),
+		withoutBounds.data(), normals.data());
+	CHECK(withoutBounds == positions);
+}
+
+TEST_CASE(dualQuaternion) {
+	Mesh mesh(2);
+	std::vector<DualQuaternion> dualQuaternions(kJointCount);
+	computeDualQuaternions(mesh.matrices.data(), kJointCount, dualQuaternions.data());
+
+	// one joint per vertex moves it like the matrix.
+	std::vector<SkinVertex> rigid = mesh.skin;
+	for (SkinVertex& vertex : rigid) {
+		vertex.weights[0] = 255;
+		vertex.weights[1] = vertex.weights[2] = vertex.weights[3] = 0;
+	}
+	std::vector<glm::vec3> positions(kVertexCount);
+	std::vector<glm::vec3> normals(kVertexCount);
+	skinDualQuaternion(mesh.positions.data(), mesh.normals.data(), rigid.data(), kVertexCount, dualQuaternions.data(),
+		positions.data(), normals.data());
+	float error = 0.0f;
+	for (uint32_t i = 0; i < kVertexCount; i++) {
+		const glm::mat4& matrix = mesh.matrices[rigid[i].joints[0]];
+		error = (std::max)(error, glm::length(glm::vec3(matrix * glm::vec4(mesh.positions[i], 1.0f)) - positions[i]));
+		error = (std::max)(error, glm::length(glm::normalize(glm::mat3(matrix) * mesh.normals[i]) - normals[i]));
+	}
+	CHECK(error < 1e-5f);
+
+	// the sign of a joint does not change the blend.
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	skinDualQuaternion(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, dualQuaternions.data(),
+		positions.data(), normals.data(), &boundsMin, &boundsMax);
+	for (uint32_t i = 0; i < kJointCount; i += 2) {
+		dualQuaternions[i].real = -dualQuaternions[i].real;
+		dualQuaternions[i].dual = -dualQuaternions[i].dual;
+	}
+	std::vector<glm::vec3> flipped(kVertexCount);
+	skinDualQuaternion(mesh.positions.data(), mesh.normals.data(), mesh.skin.data(), kVertexCount, dualQuaternions.data(),
+		flipped.data(), normals.data());
+	error = 0.0f;
+	glm::vec3 expectedMin(FLT_MAX);
+	glm::vec3 expectedMax(-FLT_MAX);
+	for (uint32_t i = 0; i < kVertexCount; i++) {
+		error = (std::max)(error, glm::length(flipped[i] - positions[i]));
+		expectedMin = glm::min(expectedMin, positions[i]);
+		expectedMax = glm::max(expectedMax, positions[i]);
+	}
+	CHECK(error < 1e-5f);
+	CHECK(boundsMin == expectedMin && boundsMax == expectedMax);
+
+	// the scale of a matrix is dropped.
+	glm::mat4 scaled = mesh.matrices[0] * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+	DualQuaternion fromScaled;
+	computeDualQuaternions(&scaled, 1, &fromScaled);
+	computeDualQuaternions(mesh.matrices.data(), 1, dualQuaternions.data());
+	CHECK(1.0f - std::abs(glm::dot(fromScaled.real, dualQuaternions[0].real)) < 1e-6f);
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "../test.h"
+
+#include "../../tools/transform_hierarchy.h"
+
+#include "../../glm-master/glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+enum class Shape { eRandomTree, eChains, eDeepChain, eFlat };
+
+// parents of count nodes. the deep chain has its parents after the children, so the ids are not already in order.
+std::vector<int32_t> makeParents(Shape shape, uint32_t count, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::vector<int32_t> parents(count);
+	for (uint32_t i = 0; i < count; i++) {
+		switch (shape) {
+		case Shape::eRandomTree: parents[i] = i == 0 ? -1 : (int32_t)(random() % i); break;
+		case Shape::eChains: parents[i] = i % 64 == 0 ? -1 : (int32_t)i - 1; break;
+		case Shape::eDeepChain: parents[i] = i + 1 < count ? (int32_t)i + 1 : -1; break;
+		case Shape::eFlat: parents[i] = i == 0 ? -1 : 0; break;
+		}
+	}
+	return parents;
+}
+
+struct Locals {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+
+	Locals(uint32_t count, uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (uint32_t i = 0; i < count; i++) {
+			positions.push_back(glm::vec3(unit(random), unit(random), unit(random)) * 0.01f);
+			rotations.push_back(glm::normalize(glm::quat(1.0f, unit(random) * 0.01f, unit(random) * 0.01f, unit(random) * 0.01f)));
+			scales.push_back(glm::vec3(1.0f + 0.0001f * (i % 3), 1.0f, 0.9999f));
+		}
+	}
+
+	void apply(TransformHierarchy& hierarchy) const {
+		for (uint32_t i = 0; i < (uint32_t)positions.size(); i++) {
+			hierarchy.setLocalPosition(i, positions[i]);
+			hierarchy.setLocalRotation(i, rotations[i]);
+			hierarchy.setLocalScale(i, scales[i]);
+		}
+	}
+
+	glm::mat4 getLocalMatrix(uint32_t i) const {
+		return glm::translate(glm::mat4(1.0f), positions[i]) * glm::mat4_cast(rotations[i]) * glm::scale(glm::mat4(1.0f), scales[i]);
+	}
+};
+
+// the world matrices with glm, walking the storage order so parents are done first.
+std::vector<glm::mat4> computeReference(const TransformHierarchy& hierarchy, const std::vector<int32_t>& parents, const Locals& locals) {
+	std::vector<glm::mat4> world(parents.size());
+	for (uint32_t node : hierarchy.getOrder())
+		world[node] = parents[node] < 0 ? locals.getLocalMatrix(node) : world[parents[node]] * locals.getLocalMatrix(node);
+	return world;
+}
+
+float getMaxError(const TransformHierarchy& hierarchy, const std::vector<glm::mat4>& reference) {
+	float error = 0.0f;
+	for (uint32_t i = 0; i < (uint32_t)reference.size(); i++) {
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				float expected = reference[i][column][row];
+				error = (std::max)(error, std::abs(expected - hierarchy.getWorldMatrix(i)[column][row]) / (1.0f + std::abs(expected)));
+			}
+		}
+	}
+	return error;
+}
+
+}
+
+
+TEST_CASE(create) {
+	TransformHierarchy hierarchy;
+	std::vector<int32_t> parents = { -1, 0, 1 };
+	CHECK(hierarchy.create(parents.data(), 3));
+	CHECK(hierarchy.create(nullptr, 0));
+	CHECK(hierarchy.getNodeCount() == 0);
+
+	// self, out of range and cycles that never reach a root.
+	parents = { -1, 1 };
+	CHECK(!hierarchy.create(parents.data(), 2));
+	parents = { -1, 2 };
+	CHECK(!hierarchy.create(parents.data(), 2));
+	parents = { -1, -2 };
+	CHECK(!hierarchy.create(parents.data(), 2));
+	parents = { -1, 2, 3, 1 };
+	CHECK(!hierarchy.create(parents.data(), 4));
+}
+
+TEST_CASE(storageOrder) {
+	for (Shape shape : { Shape::eRandomTree, Shape::eChains, Shape::eDeepChain, Shape::eFlat }) {
+		std::vector<int32_t> parents = makeParents(shape, 10000, 1);
+		TransformHierarchy hierarchy;
+		CHECK(hierarchy.create(parents.data(), 10000));
+		CHECK(hierarchy.getNodeCount() == 10000);
+
+		// every node once, parents before their children, and every subtree contiguous.
+		const std::vector<uint32_t>& order = hierarchy.getOrder();
+		std::vector<uint32_t> slots(order.size(), UINT32_MAX);
+		for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+			slots[order[i]] = i;
+		CHECK(std::count(slots.begin(), slots.end(), UINT32_MAX) == 0);
+
+		bool isValid = true;
+		std::vector<uint32_t> subtreeSizes(order.size(), 1);
+		for (uint32_t i = (uint32_t)order.size(); i-- > 0;) {
+			uint32_t node = order[i];
+			isValid = isValid && hierarchy.getParent(node) == parents[node];
+			if (parents[node] >= 0) {
+				isValid = isValid && slots[parents[node]] < i;
+				subtreeSizes[parents[node]] += subtreeSizes[node];
+			}
+		}
+		for (uint32_t node = 0; node < (uint32_t)order.size(); node++) {
+			if (parents[node] >= 0) {
+				uint32_t parentSlot = slots[parents[node]];
+				isValid = isValid && slots[node] + subtreeSizes[node] <= parentSlot + subtreeSizes[parents[node]];
+			}
+		}
+		CHECK(isValid);
+	}
+}
+
+TEST_CASE(worldMatrices) {
+	// large enough for several tasks and a serial top in the threaded update.
+	const uint32_t count = 30000;
+	for (Shape shape : { Shape::eRandomTree, Shape::eChains, Shape::eDeepChain, Shape::eFlat }) {
+		std::vector<int32_t> parents = makeParents(shape, count, 2);
+		Locals locals(count, 3);
+		std::vector<glm::mat4> reference;
+
+		for (unsigned int threadCount : { 1u, 3u, 8u }) {
+			TransformHierarchy hierarchy;
+			hierarchy.create(parents.data(), count);
+			locals.apply(hierarchy);
+			hierarchy.update(threadCount);
+			if (reference.empty())
+				reference = computeReference(hierarchy, parents, locals);
+			// the deep chain multiplies 30000 matrices in a row.
+			CHECK(getMaxError(hierarchy, reference) < (shape == Shape::eDeepChain ? 1e-3f : 1e-5f));
+		}
+	}
+
+	// the accessors.
+	std::vector<int32_t> parents = { -1, 0 };
+	TransformHierarchy hierarchy;
+	hierarchy.create(parents.data(), 2);
+	glm::quat rotation = glm::angleAxis(0.5f, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)));
+	hierarchy.setLocalPosition(0, glm::vec3(1.0f, 2.0f, 3.0f));
+	hierarchy.setLocalRotation(0, rotation);
+	hierarchy.setLocalScale(0, glm::vec3(2.0f, 3.0f, 4.0f));
+	hierarchy.setLocalPosition(1, glm::vec3(0.0f, 1.0f, 0.0f));
+	hierarchy.update(1);
+	CHECK(hierarchy.getLocalPosition(0) == glm::vec3(1.0f, 2.0f, 3.0f));
+	CHECK(hierarchy.getLocalRotation(0) == rotation);
+	CHECK(hierarchy.getLocalScale(0) == glm::vec3(2.0f, 3.0f, 4.0f));
+	glm::vec3 expected = glm::vec3(1.0f, 2.0f, 3.0f) + rotation * glm::vec3(0.0f, 3.0f, 0.0f);
+	CHECK(glm::length(hierarchy.getWorldPosition(1) - expected) < 1e-5f);
+	// the scale is taken out of the world rotation.
+	CHECK(std::abs(std::abs(glm::dot(hierarchy.getWorldRotation(1), rotation)) - 1.0f) < 1e-5f);
+}
+
+TEST_CASE(partialUpdate) {
+	const uint32_t count = 20000;
+	std::vector<int32_t> parents = makeParents(Shape::eRandomTree, count, 4);
+	Locals locals(count, 5);
+
+	for (unsigned int threadCount : { 1u, 4u }) {
+		TransformHierarchy hierarchy;
+		hierarchy.create(parents.data(), count);
+		locals.apply(hierarchy);
+		hierarchy.update(threadCount);
+		std::vector<glm::mat4> before(count);
+		for (uint32_t i = 0; i < count; i++)
+			before[i] = hierarchy.getWorldMatrix(i);
+
+		// a node in the middle of the order moves, only its subtree changes.
+		uint32_t changed = hierarchy.getOrder()[count / 2];
+		Locals moved = locals;
+		moved.positions[changed] += glm::vec3(0.5f);
+		hierarchy.setLocalPosition(changed, moved.positions[changed]);
+		hierarchy.update(threadCount);
+		std::vector<glm::mat4> reference = computeReference(hierarchy, parents, moved);
+		CHECK(getMaxError(hierarchy, reference) < 1e-5f);
+
+		std::vector<bool> isBelow(count, false);
+		for (uint32_t node : hierarchy.getOrder())
+			isBelow[node] = node == changed || (parents[node] >= 0 && isBelow[parents[node]]);
+		size_t untouchedCount = 0;
+		bool isUntouched = true;
+		for (uint32_t i = 0; i < count; i++) {
+			if (isBelow[i])
+				continue;
+			untouchedCount++;
+			isUntouched = isUntouched && hierarchy.getWorldMatrix(i) == before[i];
+		}
+		CHECK(isUntouched);
+		CHECK(untouchedCount > 0);
+
+		// nothing set, nothing changes.
+		hierarchy.update(threadCount);
+		CHECK(getMaxError(hierarchy, reference) < 1e-5f);
+	}
+}
+
+TEST_CASE(subtreeBounds) {
+	// a random tree with larger rotations and scales, every third node without a box.
+	const uint32_t count = 2000;
+	std::vector<int32_t> parents = makeParents(Shape::eRandomTree, count, 6);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	TransformHierarchy hierarchy;
+	hierarchy.create(parents.data(), count);
+	std::vector<glm::vec3> localMin(count);
+	std::vector<glm::vec3> localMax(count);
+	for (uint32_t i = 0; i < count; i++) {
+		hierarchy.setLocalPosition(i, glm::vec3(unit(random), unit(random), unit(random)));
+		hierarchy.setLocalRotation(i, glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random))));
+		hierarchy.setLocalScale(i, glm::vec3(1.0f + 0.5f * unit(random)) * 0.9f);
+		glm::vec3 center(unit(random), unit(random), unit(random));
+		glm::vec3 extent = glm::abs(glm::vec3(unit(random), unit(random), unit(random))) * (i % 3 == 0 ? -1.0f : 1.0f);
+		localMin[i] = center - extent;
+		localMax[i] = center + extent;
+	}
+	hierarchy.update(1);
+
+	std::vector<glm::vec3> resultMin(count);
+	std::vector<glm::vec3> resultMax(count);
+	hierarchy.computeSubtreeBounds(localMin.data(), localMax.data(), resultMin.data(), resultMax.data());
+
+	// the eight corners of every box, merged into the node and all of its ancestors.
+	std::vector<glm::vec3> referenceMin(count, glm::vec3(FLT_MAX));
+	std::vector<glm::vec3> referenceMax(count, glm::vec3(-FLT_MAX));
+	for (uint32_t i = 0; i < count; i++) {
+		if (i % 3 == 0)
+			continue;
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec3 local((corner & 1) ? localMax[i].x : localMin[i].x, (corner & 2) ? localMax[i].y : localMin[i].y,
+				(corner & 4) ? localMax[i].z : localMin[i].z);
+			glm::vec3 position = glm::vec3(hierarchy.getWorldMatrix(i) * glm::vec4(local, 1.0f));
+			for (int32_t node = (int32_t)i; node >= 0; node = parents[node]) {
+				referenceMin[node] = glm::min(referenceMin[node], position);
+				referenceMax[node] = glm::max(referenceMax[node], position);
+			}
+		}
+	}
+
+	float error = 0.0f;
+	uint32_t emptyCount = 0;
+	bool isEmptyMatching = true;
+	for (uint32_t i = 0; i < count; i++) {
+		bool isEmpty = referenceMin[i].x > referenceMax[i].x;
+		isEmptyMatching = isEmptyMatching && isEmpty == (resultMin[i].x > resultMax[i].x);
+		if (isEmpty) {
+			emptyCount++;
+			continue;
+		}
+		glm::vec3 scale = glm::vec3(1.0f) + glm::abs(referenceMin[i]) + glm::abs(referenceMax[i]);
+		error = (std::max)(error, glm::length((resultMin[i] - referenceMin[i]) / scale));
+		error = (std::max)(error, glm::length((resultMax[i] - referenceMax[i]) / scale));
+	}
+	CHECK(isEmptyMatching);
+	// the leaves without a box.
+	CHECK(emptyCount > 0);
+	CHECK(error < 1e-5f);
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+static const float kQuantizedRotationRange = 0.70710678f;
+static const float kQuantizedRotationScale = 32767.0f;
+
+static glm::vec3 lerpKey(const glm::vec3& a, const glm::vec3& b, float alpha) {
+	return glm::mix(a, b, alpha);
+}
+
+static glm::quat lerpKey(const glm::quat& a, const glm::quat& b, float alpha) {
+	glm::quat target = glm::dot(a, b) < 0.0f ? -b : b;
+	return glm::normalize(a * (1.0f - alpha) + target * alpha);
+}
+
+static float keyError(const glm::vec3& a, const glm::vec3& b) {
+	glm::vec3 difference = glm::abs(a - b);
+	return std::max(difference.x, std::max(difference.y, difference.z));
+}
+
+static float keyError(const glm::quat& a, const glm::quat& b) {
+	return 1.0f - std::abs(glm::dot(a, b));
+}
+
+// indices of the keys to keep. greedy, every dropped key is within tolerance of the line between the kept keys around it.
+template <class T>
+static std::vector<uint32_t> reduceKeys(const std::vector<float>& times, const std::vector<T>& values, float tolerance) {
+	std::vector<uint32_t> kept;
+	uint32_t count = (uint32_t)std::min(times.size(), values.size());
+	if (count == 0)
+		return kept;
+
+	kept.push_back(0);
+	uint32_t start = 0;
+	for (uint32_t end = 2; end < count; end++) {
+		float span = times[end] - times[start];
+		for (uint32_t i = start + 1; i < end; i++) {
+			float alpha = span > 0.0f ? (times[i] - times[start]) / span : 0.0f;
+			if (keyError(lerpKey(values[start], values[end], alpha), values[i]) > tolerance) {
+				start = end - 1;
+				kept.push_back(start);
+				break;
+			}
+		}
+	}
+	if (count > 1)
+		kept.push_back(count - 1);
+
+	if (kept.size() == 2 && keyError(values[kept[0]], values[kept[1]]) <= tolerance)
+		kept.pop_back();
+
+	return kept;
+}
+
+static uint16_t quantizeTime(float time, float duration) {
+	if (duration <= 0.0f)
+		return 0;
+	return (uint16_t)(glm::clamp(time / duration, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+
+bool AnimationClip::create(const std::string& name, float duration, const std::vector<AnimationTrackSource>& tracks) {
+	if (!(duration >= 0.0f))
+		return false;
+
+	m_name = name;
+	m_duration = duration;
+	m_sourceKeyCount = 0;
+	m_positionChannels.clear();
+	m_scaleChannels.clear();
+	m_rotationChannels.clear();
+	m_vectorTimes.clear();
+	m_vectorKeys.clear();
+	m_rotationTimes.clear();
+	m_rotationKeys.clear();
+
+	auto addVectorChannel = [&](uint32_t joint, const std::vector<float>& times, const std::vector<glm::vec3>& values, float tolerance,
+		std::vector<Channel>& channels) {
+		std::vector<uint32_t> kept = reduceKeys(times, values, tolerance);
+		if (kept.empty())
+			return;
+
+		channels.push_back({ joint, (uint32_t)m_vectorKeys.size(), (uint32_t)kept.size() });
+		for (uint32_t i : kept) {
+			m_vectorTimes.push_back(quantizeTime(times[i], duration));
+			m_vectorKeys.push_back(values[i]);
+		}
+	};
+
+	for (const AnimationTrackSource& track : tracks) {
+		if (track.positionTimes.size() != track.positions.size() || track.rotationTimes.size() != track.rotations.size() ||
+			track.scaleTimes.size() != track.scales.size())
+			return false;
+
+		m_sourceKeyCount += (uint32_t)(track.positions.size() + track.rotations.size() + track.scales.size());
+
+		addVectorChannel(track.joint, track.positionTimes, track.positions, kAnimationPositionTolerance, m_positionChannels);
+		addVectorChannel(track.joint, track.scaleTimes, track.scales, kAnimationScaleTolerance, m_scaleChannels);
+
+		std::vector<glm::quat> rotations(track.rotations.size());
+		for (size_t i = 0; i < rotations.size(); i++)
+			rotations[i] = glm::normalize(track.rotations[i]);
+		std::vector<uint32_t> kept = reduceKeys(track.rotationTimes, rotations, kAnimationRotationTolerance);
+		if (kept.empty())
+			continue;
+
+		m_rotationChannels.push_back({ track.joint, (uint32_t)m_rotationKeys.size(), (uint32_t)kept.size() });
+		for (uint32_t i : kept) {
+			m_rotationTimes.push_back(quantizeTime(track.rotationTimes[i], duration));
+			m_rotationKeys.push_back(quantize(rotations[i]));
+		}
+	}
+
+	return true;
+}
+
+size_t AnimationClip::getMemorySize() const {
+	return (m_positionChannels.size() + m_scaleChannels.size() + m_rotationChannels.size()) * sizeof(Channel) +
+		m_vectorTimes.size() * sizeof(uint16_t) + m_vectorKeys.size() * sizeof(glm::vec3) +
+		m_rotationTimes.size() * sizeof(uint16_t) + m_rotationKeys.size() * sizeof(QuantizedRotation);
+}
+
+AnimationClip::QuantizedRotation AnimationClip::quantize(const glm::quat& rotation) {
+	// the largest component is rebuilt from the others, its sign is dropped since q and -q are the same rotation.
+	glm::vec4 values(rotation.x, rotation.y, rotation.z, rotation.w);
+	int largest = 0;
+	for (int i = 1; i < 4; i++) {
+		if (std::abs(values[i]) > std::abs(values[largest]))
+			largest = i;
+	}
+	if (values[largest] < 0.0f)
+		values = -values;
+
+	QuantizedRotation result;
+	for (int i = 0, j = 0; i < 4; i++) {
+		if (i == largest)
+			continue;
+		float value = glm::clamp(values[i] / kQuantizedRotationRange, -1.0f, 1.0f) * 0.5f + 0.5f;
+		result.values[j++] = (uint16_t)(value * kQuantizedRotationScale + 0.5f);
+	}
+	result.values[0] |= (uint16_t)((largest & 1) << 15);
+	result.values[1] |= (uint16_t)((largest >> 1) << 15);
+
+	return result;
+}
+
+glm::quat AnimationClip::dequantize(const QuantizedRotation& rotation) {
+	int largest = (rotation.values[0] >> 15) | ((rotation.values[1] >> 15) << 1);
+
+	glm::vec4 values;
+	float sum = 0.0f;
+	for (int i = 0, j = 0; i < 4; i++) {
+		if (i == largest)
+			continue;
+		float value = ((rotation.values[j++] & 0x7fff) / kQuantizedRotationScale * 2.0f - 1.0f) * kQuantizedRotationRange;
+		values[i] = value;
+		sum += value * value;
+	}
+	values[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+
+	return glm::quat(values.w, values.x, values.y, values.z);
+}
+
+
+void AnimationSampler::reset(const AnimationClip& clip) {
+	m_clip = &clip;
+	m_cursors.assign(clip.m_positionChannels.size() + clip.m_scaleChannels.size() + clip.m_rotationChannels.size(), 0);
+}
+
+uint32_t AnimationSampler::advance(uint32_t cursor, const AnimationClip::Channel& channel, const uint16_t* times, float time) {
+	const uint16_t* keys = times + channel.keyOffset;
+	if (time < keys[cursor])
+		cursor = 0;
+	while (cursor + 1 < channel.keyCount && keys[cursor + 1] <= time)
+		cursor++;
+	return cursor;
+}
+
+void AnimationSampler::sample(const AnimationClip& clip, float time, JointTransform* pose) {
+	if (m_clip != &clip)
+		reset(clip);
+
+	// in the 16 bit time of the keys.
+	float duration = clip.m_duration;
+	if (duration > 0.0f) {
+		time = std::fmod(time, duration);
+		if (time < 0.0f)
+			time += duration;
+		time = time / duration * 65535.0f;
+	}
+	else {
+		time = 0.0f;
+	}
+
+	auto getAlpha = [time](const uint16_t* keys, uint32_t cursor, uint32_t count) {
+		if (cursor + 1 >= count || keys[cursor + 1] <= keys[cursor])
+			return 0.0f;
+		return glm::clamp((time - keys[cursor]) / (float)(keys[cursor + 1] - keys[cursor]), 0.0f, 1.0f);
+	};
+
+	uint32_t* cursors = m_cursors.data();
+	for (const AnimationClip::Channel& channel : clip.m_positionChannels) {
+		uint32_t cursor = *cursors = advance(*cursors, channel, clip.m_vectorTimes.data(), time);
+		cursors++;
+
+		const glm::vec3* keys = clip.m_vectorKeys.data() + channel.keyOffset;
+		float alpha = getAlpha(clip.m_vectorTimes.data() + channel.keyOffset, cursor, channel.keyCount);
+		pose[channel.joint].position = alpha > 0.0f ? lerpKey(keys[cursor], keys[cursor + 1], alpha) : keys[cursor];
+	}
+	for (const AnimationClip::Channel& channel : clip.m_scaleChannels) {
+		uint32_t cursor = *cursors = advance(*cursors, channel, clip.m_vectorTimes.data(), time);
+		cursors++;
+
+		const glm::vec3* keys = clip.m_vectorKeys.data() + channel.keyOffset;
+		float alpha = getAlpha(clip.m_vectorTimes.data() + channel.keyOffset, cursor, channel.keyCount);
+		pose[channel.joint].scale = alpha > 0.0f ? lerpKey(keys[cursor], keys[cursor + 1], alpha) : keys[cursor];
+	}
+	for (const AnimationClip::Channel& channel : clip.m_rotationChannels) {
+		uint32_t cursor = *cursors = advance(*cursors, channel, clip.m_rotationTimes.data(), time);
+		cursors++;
+
+		const AnimationClip::QuantizedRotation* keys = clip.m_rotationKeys.data() + channel.keyOffset;
+		float alpha = getAlpha(clip.m_rotationTimes.data() + channel.keyOffset, cursor, channel.keyCount);
+		glm::quat rotation = AnimationClip::dequantize(keys[cursor]);
+		if (alpha > 0.0f)
+			rotation = lerpKey(rotation, AnimationClip::dequantize(keys[cursor + 1]), alpha);
+		pose[channel.joint].rotation = rotation;
+	}
+}
+
+
+void blendPoses(const JointTransform* from, const JointTransform* to, float weight, uint32_t count, JointTransform* result) {
+	for (uint32_t i = 0; i < count; i++) {
+		result[i].position = glm::mix(from[i].position, to[i].position, weight);
+		result[i].rotation = lerpKey(from[i].rotation, to[i].rotation, weight);
+		result[i].scale = glm::mix(from[i].scale, to[i].scale, weight);
+	}
+}
+
+void computeModelMatrices(const int32_t* parents, const JointTransform* locals, uint32_t count, glm::mat4* result) {
+	for (uint32_t i = 0; i < count; i++) {
+		const JointTransform& local = locals[i];
+		glm::mat3 rotation = glm::mat3_cast(local.rotation);
+		glm::mat4 matrix(
+			glm::vec4(rotation[0] * local.scale.x, 0.0f),
+			glm::vec4(rotation[1] * local.scale.y, 0.0f),
+			glm::vec4(rotation[2] * local.scale.z, 0.0f),
+			glm::vec4(local.position, 1.0f));
+
+		result[i] = parents[i] < 0 ? matrix : result[parents[i]] * matrix;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef _ANIMATION_H_
+#define _ANIMATION_H_
+
+#include "../glm-master/glm/glm.hpp"
+#include "../glm-master/glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// keys closer than this to the interpolation of the keys kept around them are dropped at import.
+static const float kAnimationPositionTolerance = 1.0e-4f;
+static const float kAnimationScaleTolerance = 1.0e-4f;
+// 1 - |dot| of the quaternions, about 0.5 degree.
+static const float kAnimationRotationTolerance = 1.0e-5f;
+
+// local transform of a joint, the matrix is translation * rotation * scale.
+struct JointTransform {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+// the keys of one joint as the file has them, times in seconds and ascending. a channel without keys is not animated.
+struct AnimationTrackSource {
+	uint32_t joint;
+	std::vector<float> positionTimes;
+	std::vector<glm::vec3> positions;
+	std::vector<float> rotationTimes;
+	std::vector<glm::quat> rotations;
+	std::vector<float> scaleTimes;
+	std::vector<glm::vec3> scales;
+};
+
+// a clip compressed for sampling. every channel keeps only the keys that linear interpolation can not rebuild within the
+// tolerances, constant channels keep one. key times are 16 bit fractions of the duration and rotations are the smallest
+// three components in 15 bits each, the keys of a channel are contiguous.
+class AnimationClip {
+public:
+	AnimationClip() = default;
+	~AnimationClip() = default;
+
+	bool create(const std::string& name, float duration, const std::vector<AnimationTrackSource>& tracks);
+
+	const std::string& getName() const { return m_name; }
+	float getDuration() const { return m_duration; }
+	uint32_t getSourceKeyCount() const { return m_sourceKeyCount; }
+	uint32_t getKeyCount() const { return (uint32_t)(m_vectorTimes.size() + m_rotationTimes.size()); }
+	size_t getMemorySize() const;
+
+private:
+	friend class AnimationSampler;
+
+	struct Channel {
+		uint32_t joint;
+		uint32_t keyOffset;
+		uint32_t keyCount;
+	};
+
+	struct QuantizedRotation {
+		uint16_t values[3];
+	};
+
+	static QuantizedRotation quantize(const glm::quat& rotation);
+	static glm::quat dequantize(const QuantizedRotation& rotation);
+
+	std::string m_name;
+	float m_duration = 0.0f;
+	uint32_t m_sourceKeyCount = 0;
+
+	std::vector<Channel> m_positionChannels;
+	std::vector<Channel> m_scaleChannels;
+	std::vector<Channel> m_rotationChannels;
+	// keys of the position and scale channels.
+	std::vector<uint16_t> m_vectorTimes;
+	std::vector<glm::vec3> m_vectorKeys;
+	// keys of the rotation channels.
+	std::vector<uint16_t> m_rotationTimes;
+	std::vector<QuantizedRotation> m_rotationKeys;
+};
+
+// playback state of a clip on one skeleton. every channel remembers the key it sampled last, so playing forward walks
+// a few keys instead of searching, a jump back starts that channel over from its first key.
+class AnimationSampler {
+public:
+	AnimationSampler() = default;
+	~AnimationSampler() = default;
+
+	void reset(const AnimationClip& clip);
+
+	// writes the joints the clip animates and leaves the rest of pose as it is. time wraps around the duration.
+	void sample(const AnimationClip& clip, float time, JointTransform* pose);
+
+private:
+	uint32_t advance(uint32_t cursor, const AnimationClip::Channel& channel, const uint16_t* times, float time);
+
+	const AnimationClip* m_clip = nullptr;
+	// per channel, positions, scales then rotations.
+	std::vector<uint32_t> m_cursors;
+};
+
+// result is from blended towards to by weight for every joint, shortest path for the rotations. result may be either
+// input, so several clips are blended by calling it once per clip on the same result.
+void blendPoses(const JointTransform* from, const JointTransform* to, float weight, uint32_t count, JointTransform* result);
+
+// model space matrices of a pose over a flat joint array, every parent comes before its children and roots have -1.
+void computeModelMatrices(const int32_t* parents, const JointTransform* locals, uint32_t count, glm::mat4* result);
+
+#endif
\ No newline at end of file
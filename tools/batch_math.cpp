@@ -0,0 +1,487 @@
+#include "batch_math.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// msvc compiles any intrinsic without /arch, gcc and clang want the instruction set on the function using it.
+#if defined(_MSC_VER)
+#define BATCH_TARGET(isa)
+#else
+#define BATCH_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// where glm keeps the components of a quaternion.
+#if defined(GLM_FORCE_QUAT_DATA_XYZW)
+static const int kQuatX = 0;
+static const int kQuatY = 1;
+static const int kQuatZ = 2;
+static const int kQuatW = 3;
+#else
+static const int kQuatW = 0;
+static const int kQuatX = 1;
+static const int kQuatY = 2;
+static const int kQuatZ = 3;
+#endif
+
+
+static void cpuid(int leaf, int subleaf, int registers[4]) {
+#if defined(_MSC_VER)
+	__cpuidex(registers, leaf, subleaf);
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	registers[0] = (int)a;
+	registers[1] = (int)b;
+	registers[2] = (int)c;
+	registers[3] = (int)d;
+#endif
+}
+
+static uint64_t getEnabledStates() {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int low, high;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((uint64_t)high << 32) | low;
+#endif
+}
+
+static SimdLevel detectSimdLevel() {
+	int registers[4];
+	cpuid(0, 0, registers);
+	int maxLeaf = registers[0];
+
+	cpuid(1, 0, registers);
+	bool isSse41 = (registers[2] & (1 << 19)) != 0;
+	bool isFma = (registers[2] & (1 << 12)) != 0;
+	bool isOsxsave = (registers[2] & (1 << 27)) != 0;
+	bool isAvx = (registers[2] & (1 << 28)) != 0;
+	if (!isSse41)
+		return SimdLevel::eScalar;
+
+	// the os has to save the ymm registers, and the zmm and mask registers for avx-512.
+	uint64_t states = isOsxsave ? getEnabledStates() : 0;
+	if (!isAvx || !isFma || (states & 0x6) != 0x6 || maxLeaf < 7)
+		return SimdLevel::eSse4;
+
+	cpuid(7, 0, registers);
+	bool isAvx2 = (registers[1] & (1 << 5)) != 0;
+	bool isAvx512 = (registers[1] & (1 << 16)) != 0;
+	if (!isAvx2)
+		return SimdLevel::eSse4;
+	if (!isAvx512 || (states & 0xe6) != 0xe6)
+		return SimdLevel::eAvx2;
+
+	return SimdLevel::eAvx512;
+}
+
+static std::atomic<int>& getSelectedLevel() {
+	static std::atomic<int> level((int)getSupportedSimdLevel());
+	return level;
+}
+
+SimdLevel getSupportedSimdLevel() {
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+SimdLevel getSimdLevel() {
+	return (SimdLevel)getSelectedLevel().load(std::memory_order_relaxed);
+}
+
+void setSimdLevel(SimdLevel level) {
+	getSelectedLevel().store((int)std::min(level, getSupportedSimdLevel()), std::memory_order_relaxed);
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::eSse4: return "sse4";
+	case SimdLevel::eAvx2: return "avx2";
+	case SimdLevel::eAvx512: return "avx-512";
+	default: return "scalar";
+	}
+}
+
+
+// transformPoints. the wide paths keep one point per 128 bit lane with the matrix columns repeated in every lane, the
+// 16 byte loads and stores of a point touch the x of the next one, so the last point always takes the scalar loop.
+// sse4 has no path, one point per register loses to what the compiler makes of the scalar loop.
+
+static void transformPointsScalar(const glm::mat4& matrix, const glm::vec3* points, uint32_t begin, uint32_t count, glm::vec3* result) {
+	for (uint32_t i = begin; i < count; i++)
+		result[i] = glm::vec3(matrix * glm::vec4(points[i], 1.0f));
+}
+
+BATCH_TARGET("avx2,fma")
+static void transformPointsAvx2(const glm::mat4& matrix, const glm::vec3* points, uint32_t count, glm::vec3* result) {
+	__m256 c0 = _mm256_broadcast_ps((const __m128*)&matrix[0][0]);
+	__m256 c1 = _mm256_broadcast_ps((const __m128*)&matrix[1][0]);
+	__m256 c2 = _mm256_broadcast_ps((const __m128*)&matrix[2][0]);
+	__m256 c3 = _mm256_broadcast_ps((const __m128*)&matrix[3][0]);
+
+	uint32_t i = 0;
+	for (; i + 2 < count; i += 2) {
+		__m256 point = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&points[i].x)), _mm_loadu_ps(&points[i + 1].x), 1);
+		__m256 transformed = _mm256_fmadd_ps(c0, _mm256_permute_ps(point, 0x00),
+			_mm256_fmadd_ps(c1, _mm256_permute_ps(point, 0x55), _mm256_fmadd_ps(c2, _mm256_permute_ps(point, 0xaa), c3)));
+		_mm_storeu_ps(&result[i].x, _mm256_castps256_ps128(transformed));
+		_mm_storeu_ps(&result[i + 1].x, _mm256_extractf128_ps(transformed, 1));
+	}
+	transformPointsScalar(matrix, points, i, count, result);
+}
+
+BATCH_TARGET("avx512f")
+static void transformPointsAvx512(const glm::mat4& matrix, const glm::vec3* points, uint32_t count, glm::vec3* result) {
+	__m512 c0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&matrix[0][0]));
+	__m512 c1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&matrix[1][0]));
+	__m512 c2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&matrix[2][0]));
+	__m512 c3 = _mm512_broadcast_f32x4(_mm_loadu_ps(&matrix[3][0]));
+
+	uint32_t i = 0;
+	for (; i + 4 < count; i += 4) {
+		__m512 point = _mm512_castps128_ps512(_mm_loadu_ps(&points[i].x));
+		point = _mm512_insertf32x4(point, _mm_loadu_ps(&points[i + 1].x), 1);
+		point = _mm512_insertf32x4(point, _mm_loadu_ps(&points[i + 2].x), 2);
+		point = _mm512_insertf32x4(point, _mm_loadu_ps(&points[i + 3].x), 3);
+		__m512 transformed = _mm512_fmadd_ps(c0, _mm512_permute_ps(point, 0x00),
+			_mm512_fmadd_ps(c1, _mm512_permute_ps(point, 0x55), _mm512_fmadd_ps(c2, _mm512_permute_ps(point, 0xaa), c3)));
+		_mm_storeu_ps(&result[i].x, _mm512_castps512_ps128(transformed));
+		_mm_storeu_ps(&result[i + 1].x, _mm512_extractf32x4_ps(transformed, 1));
+		_mm_storeu_ps(&result[i + 2].x, _mm512_extractf32x4_ps(transformed, 2));
+		_mm_storeu_ps(&result[i + 3].x, _mm512_extractf32x4_ps(transformed, 3));
+	}
+	transformPointsScalar(matrix, points, i, count, result);
+}
+
+void transformPoints(const glm::mat4& matrix, const glm::vec3* points, uint32_t count, glm::vec3* result) {
+	switch (getSimdLevel()) {
+	case SimdLevel::eAvx512: transformPointsAvx512(matrix, points, count, result); break;
+	case SimdLevel::eAvx2: transformPointsAvx2(matrix, points, count, result); break;
+	default: transformPointsScalar(matrix, points, 0, count, result); break;
+	}
+}
+
+
+// transformBounds, the center is transformed like a point and the half extent by the absolute upper 3x3. no sse4
+// path for the same reason as transformPoints.
+
+static void transformBoundsScalar(const glm::mat4& matrix, const glm::vec3* boundsMin, const glm::vec3* boundsMax, uint32_t begin, uint32_t count,
+	glm::vec3* resultMin, glm::vec3* resultMax) {
+	glm::mat3 absolute(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+	for (uint32_t i = begin; i < count; i++) {
+		glm::vec3 center = glm::vec3(matrix * glm::vec4((boundsMin[i] + boundsMax[i]) * 0.5f, 1.0f));
+		glm::vec3 extent = absolute * ((boundsMax[i] - boundsMin[i]) * 0.5f);
+		resultMin[i] = center - extent;
+		resultMax[i] = center + extent;
+	}
+}
+
+BATCH_TARGET("avx2,fma")
+static void transformBoundsAvx2(const glm::mat4& matrix, const glm::vec3* boundsMin, const glm::vec3* boundsMax, uint32_t count,
+	glm::vec3* resultMin, glm::vec3* resultMax) {
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	__m256 c0 = _mm256_broadcast_ps((const __m128*)&matrix[0][0]);
+	__m256 c1 = _mm256_broadcast_ps((const __m128*)&matrix[1][0]);
+	__m256 c2 = _mm256_broadcast_ps((const __m128*)&matrix[2][0]);
+	__m256 c3 = _mm256_broadcast_ps((const __m128*)&matrix[3][0]);
+	__m256 a0 = _mm256_andnot_ps(signMask, c0);
+	__m256 a1 = _mm256_andnot_ps(signMask, c1);
+	__m256 a2 = _mm256_andnot_ps(signMask, c2);
+
+	uint32_t i = 0;
+	for (; i + 2 < count; i += 2) {
+		__m256 low = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&boundsMin[i].x)), _mm_loadu_ps(&boundsMin[i + 1].x), 1);
+		__m256 high = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&boundsMax[i].x)), _mm_loadu_ps(&boundsMax[i + 1].x), 1);
+		__m256 center = _mm256_mul_ps(_mm256_add_ps(low, high), half);
+		__m256 extent = _mm256_mul_ps(_mm256_sub_ps(high, low), half);
+
+		__m256 transformed = _mm256_fmadd_ps(c0, _mm256_permute_ps(center, 0x00),
+			_mm256_fmadd_ps(c1, _mm256_permute_ps(center, 0x55), _mm256_fmadd_ps(c2, _mm256_permute_ps(center, 0xaa), c3)));
+		__m256 radius = _mm256_fmadd_ps(a0, _mm256_permute_ps(extent, 0x00),
+			_mm256_fmadd_ps(a1, _mm256_permute_ps(extent, 0x55), _mm256_mul_ps(a2, _mm256_permute_ps(extent, 0xaa))));
+
+		__m256 transformedMin = _mm256_sub_ps(transformed, radius);
+		__m256 transformedMax = _mm256_add_ps(transformed, radius);
+		_mm_storeu_ps(&resultMin[i].x, _mm256_castps256_ps128(transformedMin));
+		_mm_storeu_ps(&resultMin[i + 1].x, _mm256_extractf128_ps(transformedMin, 1));
+		_mm_storeu_ps(&resultMax[i].x, _mm256_castps256_ps128(transformedMax));
+		_mm_storeu_ps(&resultMax[i + 1].x, _mm256_extractf128_ps(transformedMax, 1));
+	}
+	transformBoundsScalar(matrix, boundsMin, boundsMax, i, count, resultMin, resultMax);
+}
+
+void transformBounds(const glm::mat4& matrix, const glm::vec3* boundsMin, const glm::vec3* boundsMax, uint32_t count,
+	glm::vec3* resultMin, glm::vec3* resultMax) {
+	// avx-512 has no gain over the two boxes per instruction here, the loads dominate.
+	switch (getSimdLevel()) {
+	case SimdLevel::eAvx512:
+	case SimdLevel::eAvx2: transformBoundsAvx2(matrix, boundsMin, boundsMax, count, resultMin, resultMax); break;
+	default: transformBoundsScalar(matrix, boundsMin, boundsMax, 0, count, resultMin, resultMax); break;
+	}
+}
+
+
+// multiplyMatrices. column j of a * b is the columns of a weighted by column j of b, the wide paths compute two or
+// four columns at once with the columns of a repeated in every lane. one column at a time in sse4 is what the
+// compiler already makes of glm.
+
+BATCH_TARGET("avx2,fma")
+static void multiplyMatrixAvx2(const float* a, const float* b, float* result) {
+	__m256 a0 = _mm256_broadcast_ps((const __m128*)a);
+	__m256 a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+	for (int j = 0; j < 4; j += 2) {
+		__m256 columns = _mm256_loadu_ps(b + j * 4);
+		__m256 value = _mm256_mul_ps(a3, _mm256_permute_ps(columns, 0xff));
+		value = _mm256_fmadd_ps(a2, _mm256_permute_ps(columns, 0xaa), value);
+		value = _mm256_fmadd_ps(a1, _mm256_permute_ps(columns, 0x55), value);
+		value = _mm256_fmadd_ps(a0, _mm256_permute_ps(columns, 0x00), value);
+		_mm256_storeu_ps(result + j * 4, value);
+	}
+}
+
+BATCH_TARGET("avx512f")
+static void multiplyMatrixAvx512(const float* a, const float* b, float* result) {
+	__m512 columns = _mm512_loadu_ps(b);
+	__m512 value = _mm512_mul_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a + 12)), _mm512_permute_ps(columns, 0xff));
+	value = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a + 8)), _mm512_permute_ps(columns, 0xaa), value);
+	value = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a + 4)), _mm512_permute_ps(columns, 0x55), value);
+	value = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a)), _mm512_permute_ps(columns, 0x00), value);
+	_mm512_storeu_ps(result, value);
+}
+
+BATCH_TARGET("avx2,fma")
+static void multiplyMatricesAvx2(const glm::mat4* a, uint32_t aStride, const glm::mat4* b, uint32_t count, glm::mat4* result) {
+	for (uint32_t i = 0; i < count; i++)
+		multiplyMatrixAvx2(&a[i * aStride][0][0], &b[i][0][0], &result[i][0][0]);
+}
+
+BATCH_TARGET("avx512f")
+static void multiplyMatricesAvx512(const glm::mat4* a, uint32_t aStride, const glm::mat4* b, uint32_t count, glm::mat4* result) {
+	for (uint32_t i = 0; i < count; i++)
+		multiplyMatrixAvx512(&a[i * aStride][0][0], &b[i][0][0], &result[i][0][0]);
+}
+
+// aStride 0 multiplies every b by the same a.
+static void multiplyMatrices(const glm::mat4* a, uint32_t aStride, const glm::mat4* b, uint32_t count, glm::mat4* result) {
+	switch (getSimdLevel()) {
+	case SimdLevel::eAvx512: multiplyMatricesAvx512(a, aStride, b, count, result); break;
+	case SimdLevel::eAvx2: multiplyMatricesAvx2(a, aStride, b, count, result); break;
+	default:
+		for (uint32_t i = 0; i < count; i++)
+			result[i] = a[i * aStride] * b[i];
+		break;
+	}
+}
+
+void multiplyMatrices(const glm::mat4* a, const glm::mat4* b, uint32_t count, glm::mat4* result) {
+	multiplyMatrices(a, 1, b, count, result);
+}
+
+void multiplyMatrices(const glm::mat4& matrix, const glm::mat4* b, uint32_t count, glm::mat4* result) {
+	multiplyMatrices(&matrix, 0, b, count, result);
+}
+
+
+// normalizeQuaternions, one quaternion per 128 bit lane, the order of the components does not matter. the dot product
+// instruction of sse4 is slower than the scalar loop, so sse4 has no path.
+
+static void normalizeQuaternionsScalar(glm::quat* quaternions, uint32_t begin, uint32_t count) {
+	for (uint32_t i = begin; i < count; i++)
+		quaternions[i] = glm::normalize(quaternions[i]);
+}
+
+BATCH_TARGET("avx2,fma")
+static void normalizeQuaternionsAvx2(glm::quat* quaternions, uint32_t count) {
+	uint32_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		float* values = &quaternions[i][0];
+		__m256 quaternion = _mm256_loadu_ps(values);
+		__m256 length = _mm256_sqrt_ps(_mm256_dp_ps(quaternion, quaternion, 0xff));
+		_mm256_storeu_ps(values, _mm256_div_ps(quaternion, length));
+	}
+	normalizeQuaternionsScalar(quaternions, i, count);
+}
+
+BATCH_TARGET("avx512f")
+static void normalizeQuaternionsAvx512(glm::quat* quaternions, uint32_t count) {
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float* values = &quaternions[i][0];
+		__m512 quaternion = _mm512_loadu_ps(values);
+		__m512 square = _mm512_mul_ps(quaternion, quaternion);
+		square = _mm512_add_ps(square, _mm512_permute_ps(square, 0xb1));
+		square = _mm512_add_ps(square, _mm512_permute_ps(square, 0x4e));
+		_mm512_storeu_ps(values, _mm512_div_ps(quaternion, _mm512_sqrt_ps(square)));
+	}
+	normalizeQuaternionsScalar(quaternions, i, count);
+}
+
+void normalizeQuaternions(glm::quat* quaternions, uint32_t count) {
+	switch (getSimdLevel()) {
+	case SimdLevel::eAvx512: normalizeQuaternionsAvx512(quaternions, count); break;
+	case SimdLevel::eAvx2: normalizeQuaternionsAvx2(quaternions, count); break;
+	default: normalizeQuaternionsScalar(quaternions, 0, count); break;
+	}
+}
+
+
+// composeTransforms. the components of four or eight transforms are transposed into one register each, the matrices
+// are built like glm::mat3_cast and transposed back per column.
+
+static void composeTransformsScalar(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, uint32_t begin, uint32_t count, glm::mat4* result) {
+	for (uint32_t i = begin; i < count; i++) {
+		glm::mat3 rotation = glm::mat3_cast(rotations[i]);
+		result[i] = glm::mat4(
+			glm::vec4(rotation[0] * scales[i].x, 0.0f),
+			glm::vec4(rotation[1] * scales[i].y, 0.0f),
+			glm::vec4(rotation[2] * scales[i].z, 0.0f),
+			glm::vec4(positions[i], 1.0f));
+	}
+}
+
+BATCH_TARGET("sse4.1")
+static void composeTransformsSse4(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, uint32_t count, glm::mat4* result) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 q[4];
+		for (int j = 0; j < 4; j++)
+			q[j] = _mm_loadu_ps(&rotations[i + j][0]);
+		_MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+		__m128 x = q[kQuatX];
+		__m128 y = q[kQuatY];
+		__m128 z = q[kQuatZ];
+		__m128 w = q[kQuatW];
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		__m128 scaleX = _mm_setr_ps(scales[i].x, scales[i + 1].x, scales[i + 2].x, scales[i + 3].x);
+		__m128 scaleY = _mm_setr_ps(scales[i].y, scales[i + 1].y, scales[i + 2].y, scales[i + 3].y);
+		__m128 scaleZ = _mm_setr_ps(scales[i].z, scales[i + 1].z, scales[i + 2].z, scales[i + 3].z);
+
+		// rows of the columns, four transforms per register.
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+		columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+		columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+		columns[0][3] = zero;
+		columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+		columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+		columns[1][3] = zero;
+		columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+		columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+		columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+		columns[2][3] = zero;
+		columns[3][0] = _mm_setr_ps(positions[i].x, positions[i + 1].x, positions[i + 2].x, positions[i + 3].x);
+		columns[3][1] = _mm_setr_ps(positions[i].y, positions[i + 1].y, positions[i + 2].y, positions[i + 3].y);
+		columns[3][2] = _mm_setr_ps(positions[i].z, positions[i + 1].z, positions[i + 2].z, positions[i + 3].z);
+		columns[3][3] = one;
+
+		for (int c = 0; c < 4; c++) {
+			_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (int j = 0; j < 4; j++)
+				_mm_storeu_ps(&result[i + j][c][0], columns[c][j]);
+		}
+	}
+	composeTransformsScalar(positions, rotations, scales, i, count, result);
+}
+
+// _MM_TRANSPOSE4_PS within both 128 bit lanes.
+BATCH_TARGET("avx2,fma")
+static inline void transpose4Avx(__m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+	__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+	r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+BATCH_TARGET("avx2,fma")
+static void composeTransformsAvx2(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, uint32_t count, glm::mat4* result) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	// the vec3 components of eight transforms.
+	const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// transform j in the lower lane and j + 4 in the upper, so the registers hold transforms 0, 1, 2, 3, 4, 5, 6, 7.
+		__m256 q[4];
+		for (int j = 0; j < 4; j++)
+			q[j] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&rotations[i + j][0])), _mm_loadu_ps(&rotations[i + j + 4][0]), 1);
+		transpose4Avx(q[0], q[1], q[2], q[3]);
+		__m256 x = q[kQuatX];
+		__m256 y = q[kQuatY];
+		__m256 z = q[kQuatZ];
+		__m256 w = q[kQuatW];
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		const float* scale = &scales[i].x;
+		__m256 scaleX = _mm256_i32gather_ps(scale, stride, 4);
+		__m256 scaleY = _mm256_i32gather_ps(scale + 1, stride, 4);
+		__m256 scaleZ = _mm256_i32gather_ps(scale + 2, stride, 4);
+		const float* position = &positions[i].x;
+
+		__m256 columns[4][4];
+		columns[0][0] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), scaleX);
+		columns[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), scaleX);
+		columns[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), scaleX);
+		columns[0][3] = zero;
+		columns[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), scaleY);
+		columns[1][1] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), scaleY);
+		columns[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), scaleY);
+		columns[1][3] = zero;
+		columns[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), scaleZ);
+		columns[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), scaleZ);
+		columns[2][2] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), scaleZ);
+		columns[2][3] = zero;
+		columns[3][0] = _mm256_i32gather_ps(position, stride, 4);
+		columns[3][1] = _mm256_i32gather_ps(position + 1, stride, 4);
+		columns[3][2] = _mm256_i32gather_ps(position + 2, stride, 4);
+		columns[3][3] = one;
+
+		for (int c = 0; c < 4; c++) {
+			transpose4Avx(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (int j = 0; j < 4; j++) {
+				_mm_storeu_ps(&result[i + j][c][0], _mm256_castps256_ps128(columns[c][j]));
+				_mm_storeu_ps(&result[i + j + 4][c][0], _mm256_extractf128_ps(columns[c][j], 1));
+			}
+		}
+	}
+	composeTransformsScalar(positions, rotations, scales, i, count, result);
+}
+
+void composeTransforms(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, uint32_t count, glm::mat4* result) {
+	// the transposes cost avx-512 what its width gains.
+	switch (getSimdLevel()) {
+	case SimdLevel::eAvx512:
+	case SimdLevel::eAvx2: composeTransformsAvx2(positions, rotations, scales, count, result); break;
+	case SimdLevel::eSse4: composeTransformsSse4(positions, rotations, scales, count, result); break;
+	default: composeTransformsScalar(positions, rotations, scales, 0, count, result); break;
+	}
+}
\ No newline at end of file
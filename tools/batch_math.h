@@ -0,0 +1,43 @@
+#ifndef _BATCH_MATH_H_
+#define _BATCH_MATH_H_
+
+#include "../glm-master/glm/glm.hpp"
+#include "../glm-master/glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+
+// the instruction sets the batch functions have paths for, in the order they are preferred.
+enum class SimdLevel {
+	eScalar,
+	eSse4,
+	eAvx2,
+	eAvx512,
+};
+
+// the best level the cpu and the os support, detected once.
+SimdLevel getSupportedSimdLevel();
+// the level the batch functions use, the supported one unless set lower. a level above the supported one is clamped.
+SimdLevel getSimdLevel();
+void setSimdLevel(SimdLevel level);
+const char* getSimdLevelName(SimdLevel level);
+
+// loops over arrays of glm types for the hot paths that go through one matrix at a time, each dispatched to the widest
+// path of getSimdLevel. a level only has a path where test/perf/batch_math_bench measures it faster than the one below,
+// otherwise it takes that one. results match glm up to the rounding of the reordered multiply adds, inputs and outputs
+// may not overlap unless noted.
+
+// result[i] = matrix * vec4(points[i], 1), without the divide by w.
+void transformPoints(const glm::mat4& matrix, const glm::vec3* points, uint32_t count, glm::vec3* result);
+// the boxes around the transformed boxes, from the center and the absolute matrix times the half extent.
+void transformBounds(const glm::mat4& matrix, const glm::vec3* boundsMin, const glm::vec3* boundsMax, uint32_t count,
+	glm::vec3* resultMin, glm::vec3* resultMax);
+// result[i] = a[i] * b[i].
+void multiplyMatrices(const glm::mat4* a, const glm::mat4* b, uint32_t count, glm::mat4* result);
+// result[i] = matrix * b[i].
+void multiplyMatrices(const glm::mat4& matrix, const glm::mat4* b, uint32_t count, glm::mat4* result);
+// in place.
+void normalizeQuaternions(glm::quat* quaternions, uint32_t count);
+// translation * rotation * scale.
+void composeTransforms(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, uint32_t count, glm::mat4* result);
+
+#endif
\ No newline at end of file
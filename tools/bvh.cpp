@@ -0,0 +1,674 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+// entries of the traversal stack on the stack, deeper trees fall back to the heap.
+static const uint32_t kBvhStackSize = 256;
+// direction components closer to zero than this are pushed away from it, so the slab test never multiplies 0 by inf.
+static const float kBvhMinDirection = 1e-20f;
+
+
+static float getHalfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+static bool isBoxInside(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	for (int i = 0; i < 6; i++) {
+		glm::vec3 normal(planes[i]);
+		if (glm::dot(normal, center) + planes[i].w + glm::dot(glm::abs(normal), extent) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+static bool isBoxInSphere(const glm::vec3& center, float radius, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 distance = glm::max(glm::max(boundsMin - center, center - boundsMax), glm::vec3(0.0f));
+	return glm::dot(distance, distance) <= radius * radius;
+}
+
+
+bool Bvh::build(const glm::vec3* boundsMin, const glm::vec3* boundsMax, uint32_t count, unsigned int threadCount) {
+	m_boundsMin.assign(boundsMin, boundsMin + count);
+	m_boundsMax.assign(boundsMax, boundsMax + count);
+	m_centers.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		m_centers[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+
+	m_order.resize(count);
+	std::iota(m_order.begin(), m_order.end(), 0);
+
+	m_nodes.clear();
+	m_depth = 0;
+	if (count == 0)
+		return true;
+
+	std::vector<BuildNode> nodes;
+	nodes.reserve((size_t)count * 2);
+	nodes.push_back(BuildNode{ glm::vec3(0.0f), glm::vec3(0.0f), 0, count, 0, 0 });
+	computeBounds(nodes[0]);
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	if (threadCount > 1 && count >= kBvhParallelBuildSize) {
+		// about four subtrees per thread, so uneven splits still keep every thread busy.
+		uint32_t taskDepth = 0;
+		while ((1u << taskDepth) < threadCount * 4)
+			taskDepth++;
+
+		std::vector<BuildTask> tasks;
+		buildTop(nodes, 0, 0, taskDepth, tasks);
+
+		std::vector<std::vector<BuildNode>> subtrees(tasks.size());
+		std::atomic<uint32_t> nextTask(0);
+		auto worker = [&]() {
+			for (uint32_t task = nextTask++; task < (uint32_t)tasks.size(); task = nextTask++) {
+				subtrees[task].push_back(nodes[tasks[task].node]);
+				buildSubtree(subtrees[task], 0);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min(threadCount, (unsigned int)tasks.size()); i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto& ite : threads)
+			ite.join();
+
+		// the subtree root replaces its placeholder, the rest is appended.
+		for (size_t task = 0; task < tasks.size(); task++) {
+			const std::vector<BuildNode>& subtree = subtrees[task];
+			uint32_t root = tasks[task].node;
+			uint32_t offset = (uint32_t)nodes.size() - 1;
+			auto remap = [root, offset](uint32_t index) { return index == 0 ? root : offset + index; };
+
+			for (size_t i = 0; i < subtree.size(); i++) {
+				BuildNode node = subtree[i];
+				if (node.count == 0) {
+					node.left = remap(node.left);
+					node.right = remap(node.right);
+				}
+				if (i == 0)
+					nodes[root] = node;
+				else
+					nodes.push_back(node);
+			}
+		}
+	}
+	else {
+		buildSubtree(nodes, 0);
+	}
+
+	m_nodes.reserve(nodes.size() / 2 + 1);
+	collapse(nodes, 0, 1);
+
+	return true;
+}
+
+void Bvh::buildTop(std::vector<BuildNode>& nodes, uint32_t node, uint32_t depth, uint32_t taskDepth, std::vector<BuildTask>& tasks) {
+	if (depth == taskDepth || nodes[node].count < kBvhParallelBuildSize) {
+		tasks.push_back(BuildTask{ node, nodes[node].first, nodes[node].count });
+		return;
+	}
+
+	uint32_t leftCount;
+	if (!split(nodes[node], leftCount)) {
+		tasks.push_back(BuildTask{ node, nodes[node].first, nodes[node].count });
+		return;
+	}
+
+	uint32_t first = nodes[node].first;
+	uint32_t count = nodes[node].count;
+	uint32_t left = (uint32_t)nodes.size();
+	nodes.push_back(BuildNode{ glm::vec3(0.0f), glm::vec3(0.0f), first, leftCount, 0, 0 });
+	nodes.push_back(BuildNode{ glm::vec3(0.0f), glm::vec3(0.0f), first + leftCount, count - leftCount, 0, 0 });
+	computeBounds(nodes[left]);
+	computeBounds(nodes[left + 1]);
+
+	nodes[node].count = 0;
+	nodes[node].left = left;
+	nodes[node].right = left + 1;
+
+	buildTop(nodes, left, depth + 1, taskDepth, tasks);
+	buildTop(nodes, left + 1, depth + 1, taskDepth, tasks);
+}
+
+void Bvh::buildSubtree(std::vector<BuildNode>& nodes, uint32_t node) {
+	std::vector<uint32_t> stack(1, node);
+	while (!stack.empty()) {
+		uint32_t current = stack.back();
+		stack.pop_back();
+
+		uint32_t leftCount;
+		if (!split(nodes[current], leftCount))
+			continue;
+
+		uint32_t first = nodes[current].first;
+		uint32_t count = nodes[current].count;
+		uint32_t left = (uint32_t)nodes.size();
+		nodes.push_back(BuildNode{ glm::vec3(0.0f), glm::vec3(0.0f), first, leftCount, 0, 0 });
+		nodes.push_back(BuildNode{ glm::vec3(0.0f), glm::vec3(0.0f), first + leftCount, count - leftCount, 0, 0 });
+		computeBounds(nodes[left]);
+		computeBounds(nodes[left + 1]);
+
+		nodes[current].count = 0;
+		nodes[current].left = left;
+		nodes[current].right = left + 1;
+
+		stack.push_back(left);
+		stack.push_back(left + 1);
+	}
+}
+
+bool Bvh::split(BuildNode& node, uint32_t& leftCount) {
+	if (node.count <= 1)
+		return false;
+
+	uint32_t* order = m_order.data() + node.first;
+
+	glm::vec3 centerMin(FLT_MAX);
+	glm::vec3 centerMax(-FLT_MAX);
+	for (uint32_t i = 0; i < node.count; i++) {
+		centerMin = glm::min(centerMin, m_centers[order[i]]);
+		centerMax = glm::max(centerMax, m_centers[order[i]]);
+	}
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centerMax[axis] - centerMin[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		glm::vec3 binMin[kBvhBinCount];
+		glm::vec3 binMax[kBvhBinCount];
+		uint32_t binCount[kBvhBinCount] = {};
+		for (uint32_t i = 0; i < kBvhBinCount; i++) {
+			binMin[i] = glm::vec3(FLT_MAX);
+			binMax[i] = glm::vec3(-FLT_MAX);
+		}
+
+		float scale = kBvhBinCount / extent;
+		for (uint32_t i = 0; i < node.count; i++) {
+			uint32_t primitive = order[i];
+			uint32_t bin = std::min((uint32_t)((m_centers[primitive][axis] - centerMin[axis]) * scale), kBvhBinCount - 1);
+			binMin[bin] = glm::min(binMin[bin], m_boundsMin[primitive]);
+			binMax[bin] = glm::max(binMax[bin], m_boundsMax[primitive]);
+			binCount[bin]++;
+		}
+
+		// the cost of splitting after every bin, the right side swept from the back.
+		float rightCost[kBvhBinCount];
+		glm::vec3 sweepMin(FLT_MAX);
+		glm::vec3 sweepMax(-FLT_MAX);
+		uint32_t sweepCount = 0;
+		for (uint32_t i = kBvhBinCount - 1; i > 0; i--) {
+			sweepMin = glm::min(sweepMin, binMin[i]);
+			sweepMax = glm::max(sweepMax, binMax[i]);
+			sweepCount += binCount[i];
+			rightCost[i - 1] = sweepCount > 0 ? getHalfArea(sweepMin, sweepMax) * sweepCount : 0.0f;
+		}
+
+		sweepMin = glm::vec3(FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (uint32_t i = 0; i + 1 < kBvhBinCount; i++) {
+			sweepMin = glm::min(sweepMin, binMin[i]);
+			sweepMax = glm::max(sweepMax, binMax[i]);
+			sweepCount += binCount[i];
+			if (sweepCount == 0 || sweepCount == node.count)
+				continue;
+
+			float cost = getHalfArea(sweepMin, sweepMax) * sweepCount + rightCost[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = i;
+			}
+		}
+	}
+
+	// a traversal step costs as much as a primitive test.
+	float area = getHalfArea(node.boundsMin, node.boundsMax);
+	if (node.count <= kBvhMaxLeafSize && (bestAxis == -1 || node.count * area <= area + bestCost))
+		return false;
+
+	uint32_t* middle = order + node.count / 2;
+	if (bestAxis != -1) {
+		float scale = kBvhBinCount / (centerMax[bestAxis] - centerMin[bestAxis]);
+		float axisMin = centerMin[bestAxis];
+		middle = std::partition(order, order + node.count, [&](uint32_t primitive) {
+			return std::min((uint32_t)((m_centers[primitive][bestAxis] - axisMin) * scale), kBvhBinCount - 1) <= bestBin;
+		});
+	}
+
+	// every center in the same place, any halves do.
+	leftCount = (uint32_t)(middle - order);
+	if (leftCount == 0 || leftCount == node.count)
+		leftCount = node.count / 2;
+
+	return true;
+}
+
+void Bvh::computeBounds(BuildNode& node) const {
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	for (uint32_t i = node.first; i < node.first + node.count; i++) {
+		node.boundsMin = glm::min(node.boundsMin, m_boundsMin[m_order[i]]);
+		node.boundsMax = glm::max(node.boundsMax, m_boundsMax[m_order[i]]);
+	}
+}
+
+uint32_t Bvh::collapse(const std::vector<BuildNode>& nodes, uint32_t node, uint32_t depth) {
+	uint32_t index = (uint32_t)m_nodes.size();
+	m_nodes.emplace_back();
+	m_depth = std::max(m_depth, depth);
+
+	// open the largest inner child until there are four.
+	uint32_t children[4];
+	uint32_t childCount = 0;
+	if (nodes[node].count > 0) {
+		children[childCount++] = node;
+	}
+	else {
+		children[childCount++] = nodes[node].left;
+		children[childCount++] = nodes[node].right;
+	}
+
+	while (childCount < 4) {
+		int largest = -1;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; i++) {
+			const BuildNode& child = nodes[children[i]];
+			float area = getHalfArea(child.boundsMin, child.boundsMax);
+			if (child.count == 0 && area > largestArea) {
+				largest = (int)i;
+				largestArea = area;
+			}
+		}
+		if (largest == -1)
+			break;
+
+		const BuildNode& child = nodes[children[largest]];
+		children[largest] = child.left;
+		children[childCount++] = child.right;
+	}
+
+	for (uint32_t i = 0; i < 4; i++) {
+		int32_t child = -1;
+		uint32_t count = 0;
+		glm::vec3 boundsMin(0.0f);
+		glm::vec3 boundsMax(0.0f);
+		if (i < childCount) {
+			const BuildNode& buildNode = nodes[children[i]];
+			boundsMin = buildNode.boundsMin;
+			boundsMax = buildNode.boundsMax;
+			if (buildNode.count > 0) {
+				child = (int32_t)buildNode.first;
+				count = buildNode.count;
+			}
+			else {
+				child = (int32_t)collapse(nodes, children[i], depth + 1);
+			}
+		}
+
+		BvhNode& bvhNode = m_nodes[index];
+		bvhNode.minX[i] = boundsMin.x;
+		bvhNode.minY[i] = boundsMin.y;
+		bvhNode.minZ[i] = boundsMin.z;
+		bvhNode.maxX[i] = boundsMax.x;
+		bvhNode.maxY[i] = boundsMax.y;
+		bvhNode.maxZ[i] = boundsMax.z;
+		bvhNode.child[i] = child;
+		bvhNode.count[i] = count;
+	}
+
+	return index;
+}
+
+void Bvh::getNodeBounds(uint32_t node, glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+	const BvhNode& bvhNode = m_nodes[node];
+	boundsMin = glm::vec3(FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < 4; i++) {
+		if (bvhNode.child[i] < 0)
+			continue;
+		boundsMin = glm::min(boundsMin, glm::vec3(bvhNode.minX[i], bvhNode.minY[i], bvhNode.minZ[i]));
+		boundsMax = glm::max(boundsMax, glm::vec3(bvhNode.maxX[i], bvhNode.maxY[i], bvhNode.maxZ[i]));
+	}
+}
+
+void Bvh::refit(const glm::vec3* boundsMin, const glm::vec3* boundsMax) {
+	std::copy(boundsMin, boundsMin + m_boundsMin.size(), m_boundsMin.begin());
+	std::copy(boundsMax, boundsMax + m_boundsMax.size(), m_boundsMax.begin());
+
+	// children are always stored after their parent.
+	for (size_t node = m_nodes.size(); node-- > 0;) {
+		BvhNode& bvhNode = m_nodes[node];
+		for (int i = 0; i < 4; i++) {
+			if (bvhNode.child[i] < 0)
+				continue;
+
+			glm::vec3 childMin(FLT_MAX);
+			glm::vec3 childMax(-FLT_MAX);
+			if (bvhNode.count[i] > 0) {
+				for (uint32_t j = (uint32_t)bvhNode.child[i]; j < (uint32_t)bvhNode.child[i] + bvhNode.count[i]; j++) {
+					childMin = glm::min(childMin, m_boundsMin[m_order[j]]);
+					childMax = glm::max(childMax, m_boundsMax[m_order[j]]);
+				}
+			}
+			else {
+				getNodeBounds((uint32_t)bvhNode.child[i], childMin, childMax);
+			}
+
+			bvhNode.minX[i] = childMin.x;
+			bvhNode.minY[i] = childMin.y;
+			bvhNode.minZ[i] = childMin.z;
+			bvhNode.maxX[i] = childMax.x;
+			bvhNode.maxY[i] = childMax.y;
+			bvhNode.maxZ[i] = childMax.z;
+		}
+	}
+}
+
+template<class Intersect>
+int Bvh::traverse(BvhRay& ray, Intersect intersect) const {
+	if (m_nodes.empty())
+		return -1;
+
+	struct Entry {
+		uint32_t node;
+		float tNear;
+	};
+
+	// every node pops one entry and pushes at most four.
+	Entry localStack[kBvhStackSize];
+	std::vector<Entry> heapStack;
+	Entry* stack = localStack;
+	if (m_depth * 3 + 1 > kBvhStackSize) {
+		heapStack.resize(m_depth * 3 + 1);
+		stack = heapStack.data();
+	}
+
+	glm::vec3 direction = ray.direction;
+	for (int i = 0; i < 3; i++) {
+		if (std::abs(direction[i]) < kBvhMinDirection)
+			direction[i] = direction[i] < 0.0f ? -kBvhMinDirection : kBvhMinDirection;
+	}
+
+	const __m128 originX = _mm_set1_ps(ray.origin.x);
+	const __m128 originY = _mm_set1_ps(ray.origin.y);
+	const __m128 originZ = _mm_set1_ps(ray.origin.z);
+	const __m128 inverseX = _mm_set1_ps(1.0f / direction.x);
+	const __m128 inverseY = _mm_set1_ps(1.0f / direction.y);
+	const __m128 inverseZ = _mm_set1_ps(1.0f / direction.z);
+	const __m128 tMin = _mm_set1_ps(ray.tMin);
+	const __m128i invalidChild = _mm_set1_epi32(-1);
+
+	int hit = -1;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = Entry{ 0, ray.tMin };
+
+	while (stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		if (entry.tNear > ray.tMax)
+			continue;
+
+		const BvhNode& node = m_nodes[entry.node];
+
+		__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), originX), inverseX);
+		__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), originX), inverseX);
+		__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), originY), inverseY);
+		__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), originY), inverseY);
+		__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), originZ), inverseZ);
+		__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), originZ), inverseZ);
+
+		__m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), tMin));
+		__m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(ray.tMax)));
+
+		__m128 isValid = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)node.child), invalidChild));
+		int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(tNear, tFar), isValid));
+		if (mask == 0)
+			continue;
+
+		float nears[4];
+		_mm_storeu_ps(nears, tNear);
+
+		Entry children[4];
+		uint32_t childCount = 0;
+		for (int i = 0; i < 4; i++) {
+			if ((mask & (1 << i)) == 0)
+				continue;
+
+			if (node.count[i] > 0) {
+				for (uint32_t j = (uint32_t)node.child[i]; j < (uint32_t)node.child[i] + node.count[i]; j++) {
+					if (intersect(j, ray))
+						hit = (int)j;
+				}
+			}
+			else {
+				// sorted by distance, farthest first.
+				uint32_t slot = childCount++;
+				while (slot > 0 && children[slot - 1].tNear < nears[i]) {
+					children[slot] = children[slot - 1];
+					slot--;
+				}
+				children[slot] = Entry{ (uint32_t)node.child[i], nears[i] };
+			}
+		}
+
+		for (uint32_t i = 0; i < childCount; i++)
+			stack[stackSize++] = children[i];
+	}
+
+	return hit;
+}
+
+int Bvh::rayCast(BvhRay& ray, const std::function<float(uint32_t primitive, const BvhRay& ray)>& intersect) const {
+	int hit = traverse(ray, [&](uint32_t position, BvhRay& current) {
+		float t = intersect(m_order[position], current);
+		if (t < current.tMin || t >= current.tMax)
+			return false;
+		current.tMax = t;
+		return true;
+	});
+
+	return hit == -1 ? -1 : (int)m_order[hit];
+}
+
+void Bvh::queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& result) const {
+	result.clear();
+	if (m_nodes.empty())
+		return;
+
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m128 absX[6], absY[6], absZ[6];
+	for (int i = 0; i < 6; i++) {
+		planeX[i] = _mm_set1_ps(planes[i].x);
+		planeY[i] = _mm_set1_ps(planes[i].y);
+		planeZ[i] = _mm_set1_ps(planes[i].z);
+		planeW[i] = _mm_set1_ps(planes[i].w);
+		absX[i] = _mm_set1_ps(std::abs(planes[i].x));
+		absY[i] = _mm_set1_ps(std::abs(planes[i].y));
+		absZ[i] = _mm_set1_ps(std::abs(planes[i].z));
+	}
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i invalidChild = _mm_set1_epi32(-1);
+
+	std::vector<uint32_t> stack(1, 0);
+	while (!stack.empty()) {
+		const BvhNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		__m128 minX = _mm_loadu_ps(node.minX), maxX = _mm_loadu_ps(node.maxX);
+		__m128 minY = _mm_loadu_ps(node.minY), maxY = _mm_loadu_ps(node.maxY);
+		__m128 minZ = _mm_loadu_ps(node.minZ), maxZ = _mm_loadu_ps(node.maxZ);
+		__m128 centerX = _mm_mul_ps(_mm_add_ps(minX, maxX), half), extentX = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+		__m128 centerY = _mm_mul_ps(_mm_add_ps(minY, maxY), half), extentY = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+		__m128 centerZ = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half), extentZ = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+		__m128 inside = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)node.child), invalidChild));
+		for (int i = 0; i < 6; i++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[i], centerX), _mm_mul_ps(planeY[i], centerY)), _mm_add_ps(_mm_mul_ps(planeZ[i], centerZ), planeW[i]));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[i], extentX), _mm_mul_ps(absY[i], extentY)), _mm_mul_ps(absZ[i], extentZ));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int i = 0; i < 4; i++) {
+			if ((mask & (1 << i)) == 0)
+				continue;
+
+			if (node.count[i] > 0) {
+				for (uint32_t j = (uint32_t)node.child[i]; j < (uint32_t)node.child[i] + node.count[i]; j++) {
+					uint32_t primitive = m_order[j];
+					if (isBoxInside(planes, m_boundsMin[primitive], m_boundsMax[primitive]))
+						result.push_back(primitive);
+				}
+			}
+			else {
+				stack.push_back((uint32_t)node.child[i]);
+			}
+		}
+	}
+}
+
+void Bvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const {
+	result.clear();
+	if (m_nodes.empty())
+		return;
+
+	const __m128 centerX = _mm_set1_ps(center.x);
+	const __m128 centerY = _mm_set1_ps(center.y);
+	const __m128 centerZ = _mm_set1_ps(center.z);
+	const __m128 radiusSquared = _mm_set1_ps(radius * radius);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i invalidChild = _mm_set1_epi32(-1);
+
+	std::vector<uint32_t> stack(1, 0);
+	while (!stack.empty()) {
+		const BvhNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), centerX), _mm_sub_ps(centerX, _mm_loadu_ps(node.maxX))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), centerY), _mm_sub_ps(centerY, _mm_loadu_ps(node.maxY))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), centerZ), _mm_sub_ps(centerZ, _mm_loadu_ps(node.maxZ))), zero);
+		__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		__m128 isValid = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)node.child), invalidChild));
+		int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(distanceSquared, radiusSquared), isValid));
+		for (int i = 0; i < 4; i++) {
+			if ((mask & (1 << i)) == 0)
+				continue;
+
+			if (node.count[i] > 0) {
+				for (uint32_t j = (uint32_t)node.child[i]; j < (uint32_t)node.child[i] + node.count[i]; j++) {
+					uint32_t primitive = m_order[j];
+					if (isBoxInSphere(center, radius, m_boundsMin[primitive], m_boundsMax[primitive]))
+						result.push_back(primitive);
+				}
+			}
+			else {
+				stack.push_back((uint32_t)node.child[i]);
+			}
+		}
+	}
+}
+
+float Bvh::intersectBounds(const BvhRay& ray, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	float tNear = ray.tMin;
+	float tFar = ray.tMax;
+	for (int i = 0; i < 3; i++) {
+		float direction = std::abs(ray.direction[i]) < kBvhMinDirection ? (ray.direction[i] < 0.0f ? -kBvhMinDirection : kBvhMinDirection) : ray.direction[i];
+		float t0 = (boundsMin[i] - ray.origin[i]) / direction;
+		float t1 = (boundsMax[i] - ray.origin[i]) / direction;
+		tNear = std::max(tNear, std::min(t0, t1));
+		tFar = std::min(tFar, std::max(t0, t1));
+	}
+	return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+
+bool TriangleBvh::build(const glm::vec3* positions, const uint32_t* indices, uint32_t triangleCount, unsigned int threadCount) {
+	std::vector<glm::vec3> boundsMin(triangleCount);
+	std::vector<glm::vec3> boundsMax(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		const glm::vec3& p0 = positions[indices[i * 3 + 0]];
+		const glm::vec3& p1 = positions[indices[i * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[i * 3 + 2]];
+		boundsMin[i] = glm::min(glm::min(p0, p1), p2);
+		boundsMax[i] = glm::max(glm::max(p0, p1), p2);
+	}
+
+	if (!m_bvh.build(boundsMin.data(), boundsMax.data(), triangleCount, threadCount))
+		return false;
+
+	m_vertex0.resize(triangleCount);
+	m_edge1.resize(triangleCount);
+	m_edge2.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		uint32_t triangle = m_bvh.getOrder()[i];
+		const glm::vec3& p0 = positions[indices[triangle * 3 + 0]];
+		m_vertex0[i] = p0;
+		m_edge1[i] = positions[indices[triangle * 3 + 1]] - p0;
+		m_edge2[i] = positions[indices[triangle * 3 + 2]] - p0;
+	}
+
+	return true;
+}
+
+bool TriangleBvh::rayCast(const BvhRay& ray, BvhHit& hit, float cullSign) const {
+	BvhRay current = ray;
+	float hitU = 0.0f;
+	float hitV = 0.0f;
+
+	// moller trumbore, the determinant is positive when the vertices run counterclockwise seen along the ray.
+	int position = m_bvh.traverse(current, [&](uint32_t triangle, BvhRay& test) {
+		glm::vec3 p = glm::cross(test.direction, m_edge2[triangle]);
+		float determinant = glm::dot(m_edge1[triangle], p);
+		if (std::abs(determinant) < 1e-12f || determinant * cullSign < 0.0f)
+			return false;
+
+		float inverse = 1.0f / determinant;
+		glm::vec3 s = test.origin - m_vertex0[triangle];
+		float u = glm::dot(s, p) * inverse;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		glm::vec3 q = glm::cross(s, m_edge1[triangle]);
+		float v = glm::dot(test.direction, q) * inverse;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		float t = glm::dot(m_edge2[triangle], q) * inverse;
+		if (t < test.tMin || t >= test.tMax)
+			return false;
+
+		test.tMax = t;
+		hitU = u;
+		hitV = v;
+		return true;
+	});
+
+	if (position == -1)
+		return false;
+
+	hit.triangle = (int)m_bvh.getOrder()[position];
+	hit.t = current.tMax;
+	hit.u = hitU;
+	hit.v = hitV;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include "../glm-master/glm/glm.hpp"
+
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// binned sah buckets per axis.
+static const uint32_t kBvhBinCount = 16;
+// leaves hold at most this many primitives.
+static const uint32_t kBvhMaxLeafSize = 4;
+// subtrees with fewer primitives than this are built by the thread that reached them.
+static const uint32_t kBvhParallelBuildSize = 4096;
+
+struct BvhRay {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float tMin = 0.0f;
+	float tMax = FLT_MAX;
+};
+
+// a four wide node, the bounds of the children as structure of arrays so one sse instruction tests all of them.
+// a child with count 0 is an inner node at index child, otherwise a leaf over count entries of the primitive order
+// starting at child. unused children have child -1.
+struct BvhNode {
+	float minX[4];
+	float minY[4];
+	float minZ[4];
+	float maxX[4];
+	float maxY[4];
+	float maxZ[4];
+	int32_t child[4];
+	uint32_t count[4];
+};
+
+// bounding volume hierarchy over primitive bounds. built as a binary tree with binned sah, the top levels split
+// on the calling thread and the subtrees below them on a pool of threads, then collapsed into four wide nodes.
+// the queries report primitive indices as passed to build.
+class Bvh {
+public:
+	Bvh() = default;
+	~Bvh() = default;
+
+	bool build(const glm::vec3* boundsMin, const glm::vec3* boundsMax, uint32_t count, unsigned int threadCount = 0);
+	// recomputes the node bounds from moved primitives without changing the tree, the quality drops with the motion.
+	void refit(const glm::vec3* boundsMin, const glm::vec3* boundsMax);
+
+	// closest hit. intersect returns the hit distance of a primitive, anything outside tMin..tMax is a miss.
+	// returns the primitive index, or -1 when nothing is hit, and the distance in ray.tMax.
+	int rayCast(BvhRay& ray, const std::function<float(uint32_t primitive, const BvhRay& ray)>& intersect) const;
+	// the primitives whose bounds are inside or intersect the planes, normals pointing inside.
+	void queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& result) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const;
+
+	// where the ray enters the box, FLT_MAX when it misses. an intersect function for rayCast over boxes.
+	static float intersectBounds(const BvhRay& ray, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	uint32_t getPrimitiveCount() const { return (uint32_t)m_order.size(); }
+	// primitive indices in leaf order.
+	const std::vector<uint32_t>& getOrder() const { return m_order; }
+	const std::vector<BvhNode>& getNodes() const { return m_nodes; }
+	uint32_t getDepth() const { return m_depth; }
+
+private:
+	friend class TriangleBvh;
+
+	struct BuildNode {
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		uint32_t first;
+		uint32_t count;
+		uint32_t left;
+		uint32_t right;
+	};
+
+	struct BuildTask {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	void buildTop(std::vector<BuildNode>& nodes, uint32_t node, uint32_t depth, uint32_t taskDepth, std::vector<BuildTask>& tasks);
+	void buildSubtree(std::vector<BuildNode>& nodes, uint32_t node);
+	// partitions the primitives of the node and returns false when it stays a leaf.
+	bool split(BuildNode& node, uint32_t& leftCount);
+	void computeBounds(BuildNode& node) const;
+
+	uint32_t collapse(const std::vector<BuildNode>& nodes, uint32_t node, uint32_t depth);
+	void getNodeBounds(uint32_t node, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+	// closest hit front to back. intersect gets a position in m_order, and on a hit shortens ray.tMax and returns true.
+	// returns the position of the closest hit or -1.
+	template<class Intersect>
+	int traverse(BvhRay& ray, Intersect intersect) const;
+
+	std::vector<glm::vec3> m_boundsMin;
+	std::vector<glm::vec3> m_boundsMax;
+	std::vector<glm::vec3> m_centers;
+	std::vector<uint32_t> m_order;
+	std::vector<BvhNode> m_nodes;
+	uint32_t m_depth = 0;
+};
+
+struct BvhHit {
+	// -1 when nothing is hit.
+	int triangle = -1;
+	float t = FLT_MAX;
+	// barycentrics of the second and third vertex.
+	float u = 0.0f;
+	float v = 0.0f;
+};
+
+// a Bvh over triangles with the vertices copied in leaf order, for ray casts against a mesh.
+class TriangleBvh {
+public:
+	TriangleBvh() = default;
+	~TriangleBvh() = default;
+
+	// indices are three per triangle into positions.
+	bool build(const glm::vec3* positions, const uint32_t* indices, uint32_t triangleCount, unsigned int threadCount = 0);
+
+	// triangles seen from the side cullSign points to are skipped, 1 culls those whose vertices run clockwise around
+	// the ray, -1 counterclockwise and 0 keeps both sides.
+	bool rayCast(const BvhRay& ray, BvhHit& hit, float cullSign = 0.0f) const;
+
+	const Bvh& getBvh() const { return m_bvh; }
+	uint32_t getTriangleCount() const { return m_bvh.getPrimitiveCount(); }
+
+private:
+	Bvh m_bvh;
+	// first vertex and the two edges from it, in leaf order.
+	std::vector<glm::vec3> m_vertex0;
+	std::vector<glm::vec3> m_edge1;
+	std::vector<glm::vec3> m_edge2;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "../framework/capture_replay.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// prints the per frame summary of a capture written by CaptureDevice. with -replay the capture is also run on the
+// null device, which times the recording and submit of every frame without a gpu.
+//
+//   capture_stats [-replay] capture.rcap
+
+int main(int argc, char** argv) {
+	bool isReplay = false;
+	const char* filename = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-replay") == 0)
+			isReplay = true;
+		else
+			filename = argv[i];
+	}
+	if (!filename) {
+		std::printf("usage: capture_stats [-replay] capture.rcap\n");
+		return 1;
+	}
+
+	CaptureFile capture;
+	if (!capture.load(filename)) {
+		std::printf("failed loading %s\n", filename);
+		return 1;
+	}
+
+	CaptureStats stats;
+	if (!computeCaptureStats(capture, stats)) {
+		std::printf("%s is damaged\n", filename);
+		return 1;
+	}
+	std::printf("%s: %u frames, %zu bytes\n", filename, capture.getFrameCount(), capture.getSize());
+	std::printf("%s", formatCaptureStats(stats).c_str());
+
+	if (!isReplay)
+		return 0;
+
+	NullRenderDevice device;
+	CaptureReplayer replayer;
+	std::vector<ReplayFrameTime> times;
+	if (!replayer.replay(capture, &device, false, times)) {
+		std::printf("failed replaying %s\n", filename);
+		return 1;
+	}
+	for (size_t i = 0; i < times.size(); i++)
+		std::printf("replay frame %zu: %.3f ms\n", i, times[i].cpuTime);
+	if (!device.getErrors().empty()) {
+		std::printf("the null device reported %zu errors\n", device.getErrors().size());
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "cpu_profiler.h"
+
+#include "../framework/hash.h"
+
+#include "../imgui_dx12/imgui.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+struct ThreadSlot {
+	CpuProfileBuffer* buffer = nullptr;
+
+	~ThreadSlot() {
+		if (buffer)
+			buffer->retire();
+	}
+};
+
+thread_local ThreadSlot t_slot;
+
+void appendJsonString(std::string& json, const char* str) {
+	json += '"';
+	for (const char* c = str; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			json += '\\';
+			json += *c;
+		}
+		else if ((unsigned char)*c < 0x20) {
+			json += ' ';
+		}
+		else {
+			json += *c;
+		}
+	}
+	json += '"';
+}
+
+ImU32 getEventColor(const char* name) {
+	float hue = (float)(hashBytes(name, strlen(name)) % 360) / 360.0f;
+	return ImColor::HSV(hue, 0.45f, 0.85f);
+}
+
+}
+
+uint64_t getProfilerTime() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CpuProfileBuffer::push(const CpuProfileEvent& event) {
+	uint32_t head = m_head.load(std::memory_order_relaxed);
+	if (head - m_tail.load(std::memory_order_acquire) == kCapacity) {
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	m_events[head & (kCapacity - 1)] = event;
+	m_head.store(head + 1, std::memory_order_release);
+}
+
+size_t CpuProfileBuffer::drain(std::vector<CpuProfileEvent>& events) {
+	uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	uint32_t head = m_head.load(std::memory_order_acquire);
+	for (uint32_t i = tail; i != head; i++)
+		events.push_back(m_events[i & (kCapacity - 1)]);
+	m_tail.store(head, std::memory_order_release);
+	return head - tail;
+}
+
+
+#if !defined(CPU_PROFILE_DISABLED)
+CpuProfileScope::CpuProfileScope(const char* name) : m_name(name) {
+	m_buffer = t_slot.buffer ? t_slot.buffer : CpuProfiler::Instance().getThreadBuffer();
+	m_buffer->m_depth++;
+	m_begin = getProfilerTime();
+}
+
+CpuProfileScope::~CpuProfileScope() {
+	uint64_t end = getProfilerTime();
+	m_buffer->m_depth--;
+	m_buffer->push({ m_name, m_begin, end, m_buffer->m_depth });
+}
+
+void CpuProfileScope::next(const char* name) {
+	uint64_t end = getProfilerTime();
+	m_buffer->push({ m_name, m_begin, end, m_buffer->m_depth - 1 });
+	m_name = name;
+	m_begin = end;
+}
+#endif
+
+
+CpuProfiler::CpuProfiler() {
+	m_epoch = getProfilerTime();
+	m_frameBegin = m_epoch;
+	m_frames.resize(kFrameHistory);
+}
+
+void CpuProfiler::setThreadName(const std::string& name) {
+	if (!t_slot.buffer) {
+		t_slot.buffer = registerThread(name);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	t_slot.buffer->m_threadName = name;
+	t_slot.buffer->m_threadId = getThreadId(name);
+}
+
+CpuProfileBuffer* CpuProfiler::getThreadBuffer() {
+	if (!t_slot.buffer)
+		t_slot.buffer = registerThread(std::string());
+	return t_slot.buffer;
+}
+
+CpuProfileBuffer* CpuProfiler::registerThread(const std::string& name) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// a drained buffer of a thread that exited, its ring is empty.
+	CpuProfileBuffer* buffer;
+	if (!m_freeBuffers.empty()) {
+		buffer = m_freeBuffers.back();
+		m_freeBuffers.pop_back();
+	}
+	else {
+		m_buffers.push_back(std::make_unique<CpuProfileBuffer>());
+		buffer = m_buffers.back().get();
+	}
+
+	buffer->m_threadName = name.empty() ? "thread " + std::to_string(m_unnamedCount++) : name;
+	buffer->m_threadId = getThreadId(buffer->m_threadName);
+	buffer->m_depth = 0;
+	buffer->m_isFree = false;
+	buffer->m_isRetired.store(false, std::memory_order_relaxed);
+	return buffer;
+}
+
+uint32_t CpuProfiler::getThreadId(const std::string& name) {
+	for (uint32_t i = 0; i < m_threadNames.size(); i++) {
+		if (m_threadNames[i] == name)
+			return i;
+	}
+	m_threadNames.push_back(name);
+	return (uint32_t)m_threadNames.size() - 1;
+}
+
+void CpuProfiler::endFrame() {
+	uint64_t end = getProfilerTime();
+	bool isKept = !m_isPaused || m_frameCount == 0;
+
+	// the oldest frame of the history is overwritten.
+	CpuProfileFrame discarded;
+	CpuProfileFrame& frame = m_frameCount == 0 ? m_firstFrame : isKept ? m_frames[(m_frameCount - 1) % kFrameHistory] : discarded;
+	frame.index = m_frameCount;
+	frame.begin = m_frameBegin;
+	frame.end = end;
+	frame.threads.clear();
+	frame.nodes.clear();
+	frame.dropped = 0;
+	m_frameBegin = end;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& buffer : m_buffers) {
+			if (buffer->m_isFree)
+				continue;
+
+			// the thread pushed its last event before retiring.
+			bool isRetired = buffer->m_isRetired.load(std::memory_order_acquire);
+
+			m_drained.clear();
+			buffer->drain(m_drained);
+			frame.dropped += buffer->takeDropped();
+
+			if (!m_drained.empty()) {
+				auto thread = std::find_if(frame.threads.begin(), frame.threads.end(), [&](const CpuProfileThread& t) { return t.id == buffer->m_threadId; });
+				if (thread == frame.threads.end()) {
+					frame.threads.push_back({ buffer->m_threadName, buffer->m_threadId, {} });
+					thread = frame.threads.end() - 1;
+				}
+				thread->events.insert(thread->events.end(), m_drained.begin(), m_drained.end());
+			}
+
+			if (isRetired) {
+				buffer->m_isFree = true;
+				m_freeBuffers.push_back(buffer.get());
+			}
+		}
+	}
+
+	if (!isKept)
+		return;
+
+	buildFrame(frame);
+	m_frameCount++;
+}
+
+void CpuProfiler::buildFrame(CpuProfileFrame& frame) {
+	std::sort(frame.threads.begin(), frame.threads.end(), [](const CpuProfileThread& a, const CpuProfileThread& b) { return a.id < b.id; });
+
+	struct OpenNode {
+		int32_t node;
+		uint32_t depth;
+	};
+	std::vector<OpenNode> stack;
+
+	for (uint32_t t = 0; t < frame.threads.size(); t++) {
+		std::vector<CpuProfileEvent>& events = frame.threads[t].events;
+		std::sort(events.begin(), events.end(), [](const CpuProfileEvent& a, const CpuProfileEvent& b) {
+			return a.begin < b.begin || (a.begin == b.begin && a.depth < b.depth);
+		});
+
+		// the parent is the closest open scope above the event, which skips parents that end in a later frame.
+		int32_t firstRoot = -1;
+		stack.clear();
+		for (const CpuProfileEvent& event : events) {
+			while (!stack.empty() && stack.back().depth >= event.depth)
+				stack.pop_back();
+			int32_t parent = stack.empty() ? -1 : stack.back().node;
+
+			int32_t node = parent < 0 ? firstRoot : frame.nodes[parent].firstChild;
+			int32_t last = -1;
+			while (node >= 0 && frame.nodes[node].name != event.name && strcmp(frame.nodes[node].name, event.name) != 0) {
+				last = node;
+				node = frame.nodes[node].nextSibling;
+			}
+
+			if (node < 0) {
+				node = (int32_t)frame.nodes.size();
+				frame.nodes.push_back({ event.name, t, parent, -1, -1, parent < 0 ? 0 : frame.nodes[parent].depth + 1, 0, 0 });
+				if (last >= 0)
+					frame.nodes[last].nextSibling = node;
+				else if (parent >= 0)
+					frame.nodes[parent].firstChild = node;
+				else
+					firstRoot = node;
+			}
+
+			frame.nodes[node].time += event.end - event.begin;
+			frame.nodes[node].calls++;
+			stack.push_back({ node, event.depth });
+		}
+	}
+}
+
+uint32_t CpuProfiler::getFrameCount() const {
+	return m_frameCount > 0 ? (uint32_t)(std::min)(m_frameCount - 1, (uint64_t)kFrameHistory) : 0;
+}
+
+const CpuProfileFrame* CpuProfiler::getFrame(uint32_t age) const {
+	if (age >= getFrameCount())
+		return nullptr;
+	return &m_frames[(m_frameCount - 2 - age) % kFrameHistory];
+}
+
+bool CpuProfiler::exportChromeTrace(const std::filesystem::path& filename) const {
+	std::string json = "{\"traceEvents\":[\n";
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (uint32_t i = 0; i < m_threadNames.size(); i++) {
+			json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + std::to_string(i) + ",\"args\":{\"name\":";
+			appendJsonString(json, m_threadNames[i].c_str());
+			json += "}},\n";
+		}
+	}
+
+	// complete events in microseconds since the profiler started.
+	auto writeFrame = [&](const CpuProfileFrame& frame) {
+		for (const CpuProfileThread& thread : frame.threads) {
+			for (const CpuProfileEvent& event : thread.events) {
+				json += "{\"name\":";
+				appendJsonString(json, event.name);
+				json += ",\"ph\":\"X\",\"ts\":" + std::to_string((double)(event.begin - m_epoch) / 1000.0) +
+					",\"dur\":" + std::to_string((double)(event.end - event.begin) / 1000.0) +
+					",\"pid\":0,\"tid\":" + std::to_string(thread.id) + ",\"args\":{\"frame\":" + std::to_string(frame.index) + "}},\n";
+			}
+		}
+	};
+
+	if (m_frameCount > 0)
+		writeFrame(m_firstFrame);
+	for (uint32_t age = getFrameCount(); age > 0; age--)
+		writeFrame(*getFrame(age - 1));
+
+	// the format allows no trailing comma.
+	if (json.size() >= 2 && json[json.size() - 2] == ',')
+		json.erase(json.size() - 2, 1);
+	json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+	std::ofstream ofs(filename, std::ios::trunc);
+	if (!ofs)
+		return false;
+	ofs.write(json.data(), json.size());
+	return (bool)ofs;
+}
+
+void CpuProfiler::drawImGui() {
+	if (!ImGui::CollapsingHeader("cpu profiler"))
+		return;
+
+	ImGui::Checkbox("pause", &m_isPaused);
+	ImGui::SameLine();
+	ImGui::Checkbox("first frame", &m_isFirstFrameSelected);
+	ImGui::SameLine();
+	if (ImGui::Button("export chrome trace")) {
+		m_exportResult = exportChromeTrace("cpu_profile.json") ? "wrote cpu_profile.json" : "failed to write cpu_profile.json";
+	}
+	if (!m_exportResult.empty())
+		ImGui::Text("%s", m_exportResult.c_str());
+
+	uint32_t frameCount = getFrameCount();
+	if (frameCount == 0)
+		return;
+
+	// oldest first.
+	ImGui::PlotLines("frame ms", [](void* data, int i) {
+		CpuProfiler* profiler = static_cast<CpuProfiler*>(data);
+		const CpuProfileFrame* frame = profiler->getFrame(profiler->getFrameCount() - 1 - i);
+		return (float)(frame->end - frame->begin) / 1000000.0f;
+	}, this, (int)frameCount, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+
+	if (!m_isFirstFrameSelected) {
+		ImGui::SliderInt("frame age", &m_selectedFrame, 0, (int)frameCount - 1);
+		m_selectedFrame = (std::min)(m_selectedFrame, (int)frameCount - 1);
+	}
+
+	const CpuProfileFrame& frame = m_isFirstFrameSelected ? m_firstFrame : *getFrame((uint32_t)m_selectedFrame);
+	ImGui::Text("frame %llu: %.3f ms, %u events dropped", (unsigned long long)frame.index, (double)(frame.end - frame.begin) / 1000000.0, frame.dropped);
+
+	drawFlameGraph(frame);
+
+	for (uint32_t t = 0; t < frame.threads.size(); t++) {
+		if (!ImGui::TreeNodeEx(frame.threads[t].name.c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+			continue;
+		for (int32_t i = 0; i < (int32_t)frame.nodes.size(); i++) {
+			if (frame.nodes[i].thread == t && frame.nodes[i].parent < 0)
+				drawCallTree(frame, i);
+		}
+		ImGui::TreePop();
+	}
+}
+
+void CpuProfiler::drawFlameGraph(const CpuProfileFrame& frame) {
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	float width = ImGui::GetContentRegionAvailWidth();
+	double scale = (double)width / (double)(std::max)(frame.end - frame.begin, (uint64_t)1);
+
+	for (const CpuProfileThread& thread : frame.threads) {
+		ImGui::Text("%s", thread.name.c_str());
+
+		uint32_t depthCount = 0;
+		for (const CpuProfileEvent& event : thread.events)
+			depthCount = (std::max)(depthCount, event.depth + 1);
+
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImGui::Dummy(ImVec2(width, rowHeight * depthCount));
+
+		for (const CpuProfileEvent& event : thread.events) {
+			// scopes that began in an earlier frame are clipped to its start.
+			double x0 = ((double)event.begin - (double)frame.begin) * scale;
+			double x1 = ((double)event.end - (double)frame.begin) * scale;
+			x0 = (std::max)(x0, 0.0);
+			x1 = (std::min)((std::max)(x1, x0 + 1.0), (double)width);
+			if (x0 >= width)
+				continue;
+
+			ImVec2 min(origin.x + (float)x0, origin.y + rowHeight * event.depth);
+			ImVec2 max(origin.x + (float)x1, min.y + rowHeight - 1.0f);
+			drawList->AddRectFilled(min, max, getEventColor(event.name));
+
+			if (ImGui::CalcTextSize(event.name).x + 4.0f < max.x - min.x)
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(0, 0, 0, 255), event.name);
+
+			if (ImGui::IsMouseHoveringRect(min, max))
+				ImGui::SetTooltip("%s\n%.3f ms", event.name, (double)(event.end - event.begin) / 1000000.0);
+		}
+	}
+}
+
+void CpuProfiler::drawCallTree(const CpuProfileFrame& frame, int32_t node) {
+	const CpuProfileNode& n = frame.nodes[node];
+	ImGuiTreeNodeFlags flags = n.firstChild < 0 ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_DefaultOpen;
+	if (!ImGui::TreeNodeEx((void*)(intptr_t)node, flags, "%s  %.3f ms  x%u", n.name, (double)n.time / 1000000.0, n.calls))
+		return;
+
+	for (int32_t child = n.firstChild; child >= 0; child = frame.nodes[child].nextSibling)
+		drawCallTree(frame, child);
+	ImGui::TreePop();
+}
\ No newline at end of file
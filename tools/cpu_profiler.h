@@ -0,0 +1,190 @@
+#ifndef _CPU_PROFILER_H_
+#define _CPU_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// nanoseconds of a steady clock.
+uint64_t getProfilerTime();
+
+struct CpuProfileEvent {
+	// a string literal, only the pointer is kept.
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+	// the number of scopes of the thread open around it.
+	uint32_t depth;
+};
+
+// the events one thread finished, written by that thread and read by the profiler without locking. events that
+// do not fit are dropped and counted.
+class CpuProfileBuffer {
+public:
+	static const uint32_t kCapacity = 1 << 13;
+
+	CpuProfileBuffer() : m_events(kCapacity) {}
+	~CpuProfileBuffer() = default;
+
+	// only from the owning thread.
+	void push(const CpuProfileEvent& event);
+	// only from the profiler, returns the number of events appended.
+	size_t drain(std::vector<CpuProfileEvent>& events);
+
+	uint32_t takeDropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+	// called by the owning thread when it exits.
+	void retire() { m_isRetired.store(true, std::memory_order_release); }
+
+private:
+	friend class CpuProfiler;
+	friend class CpuProfileScope;
+
+	std::vector<CpuProfileEvent> m_events;
+	alignas(64) std::atomic<uint32_t> m_head = 0;
+	alignas(64) std::atomic<uint32_t> m_tail = 0;
+	std::atomic<uint32_t> m_dropped = 0;
+
+	// the rest is owned by the profiler.
+	std::string m_threadName;
+	uint32_t m_threadId = 0;
+	// set by the thread when it exits, the buffer is reused by another thread once drained.
+	std::atomic<bool> m_isRetired = false;
+	bool m_isFree = false;
+	// of the owning thread.
+	uint32_t m_depth = 0;
+};
+
+struct CpuProfileThread {
+	std::string name;
+	uint32_t id;
+	// ordered by begin, parents before their children.
+	std::vector<CpuProfileEvent> events;
+};
+
+// the events of a frame merged by call path.
+struct CpuProfileNode {
+	const char* name;
+	uint32_t thread;
+	// -1 for the scopes open at the top of the thread.
+	int32_t parent;
+	int32_t firstChild;
+	int32_t nextSibling;
+	uint32_t depth;
+	uint64_t time;
+	uint32_t calls;
+};
+
+struct CpuProfileFrame {
+	uint64_t index = 0;
+	uint64_t begin = 0;
+	uint64_t end = 0;
+	std::vector<CpuProfileThread> threads;
+	// parents before their children.
+	std::vector<CpuProfileNode> nodes;
+	uint32_t dropped = 0;
+};
+
+// collects the scopes of every thread into frames. a frame holds the events that ended since the previous
+// endFrame, so scopes that cross endFrame are counted in the frame they end in. the first frame, which covers the
+// initialization, is kept apart from the history.
+//
+// threads of the same name share a lane, threads that run at the same time need different names.
+class CpuProfiler {
+public:
+	static const uint32_t kFrameHistory = 120;
+
+	~CpuProfiler() = default;
+
+	// names the calling thread, call before its first scope.
+	void setThreadName(const std::string& name);
+
+	// drains the buffers of every thread. call endFrame, drawImGui and exportChromeTrace from the same thread.
+	void endFrame();
+
+	void setPaused(bool isPaused) { m_isPaused = isPaused; }
+	bool isPaused() const { return m_isPaused; }
+
+	// 0 is the newest frame.
+	const CpuProfileFrame* getFrame(uint32_t age) const;
+	const CpuProfileFrame& getFirstFrame() const { return m_firstFrame; }
+	// of the history.
+	uint32_t getFrameCount() const;
+
+	// the first frame and the history as complete events of the trace event format, readable by chrome://tracing
+	// and perfetto.
+	bool exportChromeTrace(const std::filesystem::path& filename) const;
+
+	// a frame time graph, the flame graph of a frame and its call tree.
+	void drawImGui();
+
+	// the buffer of the calling thread, registered on first use.
+	CpuProfileBuffer* getThreadBuffer();
+
+	static CpuProfiler& Instance() {
+		static CpuProfiler profiler;
+		return profiler;
+	}
+
+private:
+	CpuProfiler();
+
+	CpuProfileBuffer* registerThread(const std::string& name);
+	uint32_t getThreadId(const std::string& name);
+	void buildFrame(CpuProfileFrame& frame);
+	void drawFlameGraph(const CpuProfileFrame& frame);
+	void drawCallTree(const CpuProfileFrame& frame, int32_t node);
+
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<CpuProfileBuffer>> m_buffers;
+	std::vector<CpuProfileBuffer*> m_freeBuffers;
+	// the lane names, indexed by thread id.
+	std::vector<std::string> m_threadNames;
+	uint32_t m_unnamedCount = 0;
+
+	uint64_t m_epoch;
+	uint64_t m_frameBegin;
+	uint64_t m_frameCount = 0;
+	CpuProfileFrame m_firstFrame;
+	std::vector<CpuProfileFrame> m_frames;
+	std::vector<CpuProfileEvent> m_drained;
+	bool m_isPaused = false;
+
+	// the frame shown, by age.
+	int m_selectedFrame = 0;
+	bool m_isFirstFrameSelected = false;
+	std::string m_exportResult;
+};
+
+// times the enclosing block on the calling thread.
+class CpuProfileScope {
+public:
+#if defined(CPU_PROFILE_DISABLED)
+	explicit CpuProfileScope(const char*) {}
+	void next(const char*) {}
+#else
+	// name has to be a string literal.
+	explicit CpuProfileScope(const char* name);
+	~CpuProfileScope();
+
+	// ends the scope and begins name at the same depth, for the stages of one function.
+	void next(const char* name);
+
+private:
+	CpuProfileBuffer* m_buffer;
+	const char* m_name;
+	uint64_t m_begin;
+#endif
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+};
+
+#define CPU_PROFILE_CONCAT_(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_(a, b)
+#define CPU_PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "d3d12_gpu_profiler.h"
+
+#include <cstring>
+
+bool D3D12GpuProfiler::create(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t frameCount, uint32_t passCount) {
+	destroy();
+
+	UINT64 frequency = 0;
+	if (FAILED(queue->GetTimestampFrequency(&frequency)) || !m_profiler.create(frameCount, passCount, frequency)) {
+		OutputDebugString("gpu profiler: the queue has no timestamp frequency.\n");
+		return false;
+	}
+
+	D3D12_QUERY_HEAP_DESC qhDesc{};
+	qhDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	qhDesc.Count = m_profiler.getQueryCount();
+	if (FAILED(device->CreateQueryHeap(&qhDesc, IID_PPV_ARGS(m_queryHeap.ReleaseAndGetAddressOf())))) {
+		OutputDebugString("gpu profiler: failed creating the query heap.\n");
+		return false;
+	}
+
+	D3D12_HEAP_PROPERTIES heapProp{};
+	heapProp.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProp.CreationNodeMask = 1;
+	heapProp.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Width = m_profiler.getReadbackSize();
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	HRESULT res = device->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(m_readback.ReleaseAndGetAddressOf()));
+	if (FAILED(res)) {
+		OutputDebugString("gpu profiler: failed creating the readback buffer.\n");
+		return false;
+	}
+	m_readback->SetName(L"gpuProfilerReadback");
+
+	// readback buffers can stay mapped, each frame only reads the range the gpu has finished writing.
+	void* data = nullptr;
+	if (FAILED(m_readback->Map(0, nullptr, &data))) {
+		OutputDebugString("gpu profiler: failed mapping the readback buffer.\n");
+		return false;
+	}
+	memset(data, 0, (size_t)m_profiler.getReadbackSize());
+	m_readbackData = static_cast<const uint64_t*>(data);
+
+	return true;
+}
+
+void D3D12GpuProfiler::destroy() {
+	if (m_readbackData)
+		m_readback->Unmap(0, nullptr);
+	m_readbackData = nullptr;
+	m_readback.Reset();
+	m_queryHeap.Reset();
+}
+
+void D3D12GpuProfiler::beginFrame(uint64_t completedValue) {
+	if (m_readbackData)
+		m_profiler.beginFrame(completedValue, m_readbackData);
+}
+
+void D3D12GpuProfiler::beginPass(ID3D12GraphicsCommandList* command, const char* name) {
+	// metadata 1 is an ansi string to pix and the graphics debuggers.
+	command->BeginEvent(1, name, (UINT)strlen(name) + 1);
+	uint32_t query = m_profiler.beginPass(name);
+	if (query != GpuProfiler::kInvalidQuery)
+		command->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void D3D12GpuProfiler::endPass(ID3D12GraphicsCommandList* command) {
+	uint32_t query = m_profiler.endPass();
+	if (query != GpuProfiler::kInvalidQuery)
+		command->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+	command->EndEvent();
+}
+
+void D3D12GpuProfiler::endFrame(ID3D12GraphicsCommandList* command, uint64_t fenceValue) {
+	uint32_t first, count;
+	if (m_profiler.getResolveRange(first, count))
+		command->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count, m_readback.Get(), first * sizeof(uint64_t));
+	m_profiler.endFrame(fenceValue);
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef _D3D12_GPU_PROFILER_H_
+#define _D3D12_GPU_PROFILER_H_
+
+#include "gpu_profiler.h"
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+// the queries and the readback buffer of a GpuProfiler for code that records on the framework command lists.
+class D3D12GpuProfiler {
+public:
+	D3D12GpuProfiler() = default;
+	~D3D12GpuProfiler() { destroy(); }
+
+	// the passes have to run on queue. after a failed create the passes are still marked as events and never timed.
+	bool create(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t frameCount, uint32_t passCount);
+	void destroy();
+
+	void beginFrame(uint64_t completedValue);
+	void beginPass(ID3D12GraphicsCommandList* command, const char* name);
+	void endPass(ID3D12GraphicsCommandList* command);
+	// resolves the queries of the frame, record it after the last pass.
+	void endFrame(ID3D12GraphicsCommandList* command, uint64_t fenceValue);
+
+	GpuProfiler& getProfiler() { return m_profiler; }
+	bool isAvailable() const { return m_readbackData != nullptr; }
+
+private:
+	GpuProfiler m_profiler;
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_queryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_readback;
+	const uint64_t* m_readbackData = nullptr;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "draw_culler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+
+void DrawCuller::extractFrustumPlanes(const glm::mat4& worldViewProj, glm::vec4 planes[6]) {
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(worldViewProj[0][i], worldViewProj[1][i], worldViewProj[2][i], worldViewProj[3][i]);
+
+	planes[0] = row[3] + row[0];
+	planes[1] = row[3] - row[0];
+	planes[2] = row[3] + row[1];
+	planes[3] = row[3] - row[1];
+	planes[4] = row[3] + row[2];
+	planes[5] = row[3] - row[2];
+
+	for (int i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+float DrawCuller::getDistance(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+
+	float distance = FLT_MAX;
+	for (int i = 0; i < 6; i++) {
+		glm::vec3 normal = glm::vec3(planes[i]);
+		distance = std::min(distance, glm::dot(normal, center) + planes[i].w + glm::dot(glm::abs(normal), extent));
+	}
+	return distance;
+}
+
+bool DrawCuller::isVisible(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	return getDistance(planes, boundsMin, boundsMax) >= 0.0f;
+}
+
+IndirectDrawCommand DrawCuller::packCommand(uint32_t drawId, const DrawInstance& instance) {
+	IndirectDrawCommand command;
+	command.drawId = drawId;
+	command.closureId = instance.closureId;
+	command.indexCountPerInstance = instance.indexCount;
+	command.instanceCount = instance.instanceCount;
+	command.startIndexLocation = instance.indexOffset;
+	command.baseVertexLocation = instance.vertexOffset;
+	command.startInstanceLocation = instance.instanceOffset;
+	return command;
+}
+
+void DrawCuller::buildConstant(const glm::mat4& worldViewProj, uint32_t drawCount, DrawCullConstant& constant) {
+	constant.worldViewProj = worldViewProj;
+	extractFrustumPlanes(worldViewProj, constant.frustumPlanes);
+	constant.drawCount = drawCount;
+	constant.padding[0] = constant.padding[1] = constant.padding[2] = 0;
+}
+
+void DrawCuller::cull(const std::vector<DrawInstance>& instances, const glm::mat4& worldViewProj) {
+	extractFrustumPlanes(worldViewProj, m_planes);
+
+	m_commands.clear();
+	for (uint32_t i = 0; i < (uint32_t)instances.size(); i++) {
+		if (isVisible(m_planes, instances[i].boundsMin, instances[i].boundsMax))
+			m_commands.push_back(packCommand(i, instances[i]));
+	}
+}
+
+bool DrawCuller::validate(const std::vector<DrawInstance>& instances, const IndirectDrawCommand* commands, uint32_t commandCount,
+	std::string& error, float tolerance) {
+	error.clear();
+
+	if (commandCount > instances.size()) {
+		error = "gpu emitted " + std::to_string(commandCount) + " draws for " + std::to_string(instances.size()) + " instances.\n";
+		return false;
+	}
+
+	std::vector<bool> isEmitted(instances.size(), false);
+	for (uint32_t i = 0; i < commandCount; i++) {
+		const IndirectDrawCommand& command = commands[i];
+		if (command.drawId >= instances.size() || isEmitted[command.drawId]) {
+			error += "draw command " + std::to_string(i) + " has an invalid or repeated draw id " + std::to_string(command.drawId) + ".\n";
+			continue;
+		}
+		isEmitted[command.drawId] = true;
+
+		IndirectDrawCommand expected = packCommand(command.drawId, instances[command.drawId]);
+		if (memcmp(&command, &expected, sizeof(IndirectDrawCommand)) != 0)
+			error += "draw " + std::to_string(command.drawId) + ": arguments differ.\n";
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)instances.size(); i++) {
+		float distance = getDistance(m_planes, instances[i].boundsMin, instances[i].boundsMax);
+		if (std::abs(distance) <= tolerance)
+			continue;
+
+		bool isExpected = distance > 0.0f;
+		if (isExpected != isEmitted[i])
+			error += "draw " + std::to_string(i) + (isExpected ? ": culled, expected visible.\n" : ": visible, expected culled.\n");
+	}
+
+	return error.empty();
+}
\ No newline at end of file
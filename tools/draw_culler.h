@@ -0,0 +1,87 @@
+#ifndef _DRAW_CULLER_H_
+#define _DRAW_CULLER_H_
+
+#include "../glm-master/glm/glm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// same constants as shaders/draw_cull_cs.fx.
+static const uint32_t kDrawCullThreadCount = 64;
+
+// one mesh of the model as the cull pass reads it, same layout as DrawInstance in draw_cull_cs.fx. the bounds are in
+// model space around every instance of the mesh, which are drawn together from instanceOffset of the instance buffer.
+struct DrawInstance {
+	glm::vec3 boundsMin;
+	uint32_t indexCount;
+	glm::vec3 boundsMax;
+	uint32_t indexOffset;
+	int32_t vertexOffset;
+	uint32_t closureId;
+	uint32_t instanceOffset;
+	uint32_t instanceCount;
+};
+
+// one record of the indirect draw buffer: the draw id and closure id root constants of vs.fx and ps.fx followed by
+// D3D12_DRAW_INDEXED_ARGUMENTS.
+struct IndirectDrawCommand {
+	uint32_t drawId;
+	uint32_t closureId;
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+};
+
+// cbuffer CullConstant of draw_cull_cs.fx.
+struct DrawCullConstant {
+	glm::mat4 worldViewProj;
+	glm::vec4 frustumPlanes[6];
+	uint32_t drawCount;
+	uint32_t padding[3];
+};
+
+// the CullPhase root constant of draw_cull_cs.fx.
+enum class CullPhase : uint32_t {
+	eFrustum,
+	// draws visible last frame, before the hi-z pyramid is built.
+	eEarly,
+	// draws that became visible, tested against the pyramid of the early draws.
+	eLate,
+};
+
+// cpu twin of the frustum phase of draw_cull_cs.fx. frustum culls the draws against the planes of a world view projection matrix and
+// compacts the survivors into indirect draw commands, in draw order. the gpu appends in any order, so validate
+// only compares the sets.
+class DrawCuller {
+public:
+	DrawCuller() = default;
+	~DrawCuller() = default;
+
+	// left, right, bottom, top, near, far with the normals pointing inside, normalized. the clip space depth is
+	// -w..w as glm::perspective builds it, which is also conservative for 0..w.
+	static void extractFrustumPlanes(const glm::mat4& worldViewProj, glm::vec4 planes[6]);
+	static bool isVisible(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	static IndirectDrawCommand packCommand(uint32_t drawId, const DrawInstance& instance);
+
+	static void buildConstant(const glm::mat4& worldViewProj, uint32_t drawCount, DrawCullConstant& constant);
+
+	void cull(const std::vector<DrawInstance>& instances, const glm::mat4& worldViewProj);
+
+	const std::vector<IndirectDrawCommand>& getCommands() { return m_commands; }
+
+	// draws within tolerance of a plane may go either way on the gpu and are not reported.
+	bool validate(const std::vector<DrawInstance>& instances, const IndirectDrawCommand* commands, uint32_t commandCount,
+		std::string& error, float tolerance = 1e-4f);
+
+private:
+	// smallest distance of the farthest box corner over the planes, negative when the box is outside.
+	static float getDistance(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	glm::vec4 m_planes[6];
+	std::vector<IndirectDrawCommand> m_commands;
+};
+
+#endif
\ No newline at end of file
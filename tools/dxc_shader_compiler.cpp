@@ -0,0 +1,34 @@
+#include "dxc_shader_compiler.h"
+
+
+void DxcShaderCompiler::setShader(int handle, ShaderSp shader) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (handle >= (int)m_shaders.size()) {
+		m_shaders.resize(handle + 1);
+		m_compiled.resize(handle + 1);
+	}
+	m_shaders[handle] = shader;
+}
+
+ShaderSp DxcShaderCompiler::getShader(int handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_shaders[handle];
+}
+
+bool DxcShaderCompiler::compile(int handle, const ShaderSource& source) {
+	ShaderSp shader = std::make_shared<Shader>();
+	if (!shader->create(source.filename.c_str(), source.entryPoint.c_str(), source.profile.c_str(), source.defines) || !shader->getByteCode())
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_compiled[handle] = shader;
+	return true;
+}
+
+void DxcShaderCompiler::commit(int handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_compiled[handle]) {
+		m_shaders[handle] = m_compiled[handle];
+		m_compiled[handle] = nullptr;
+	}
+}
\ No newline at end of file
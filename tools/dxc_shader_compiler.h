@@ -0,0 +1,28 @@
+#ifndef _DXC_SHADER_COMPILER_H_
+#define _DXC_SHADER_COMPILER_H_
+
+#include "shader_hot_reload.h"
+
+#include "../framework/shader.h"
+
+#include <mutex>
+#include <vector>
+
+// the shaders of a ShaderHotReload compiled with dxc through Shader.
+class DxcShaderCompiler : public ShaderCompiler {
+public:
+	// the shader in use until handle is first reloaded.
+	void setShader(int handle, ShaderSp shader);
+	ShaderSp getShader(int handle);
+
+	bool compile(int handle, const ShaderSource& source) override;
+	void commit(int handle) override;
+
+private:
+	std::mutex m_mutex;
+	std::vector<ShaderSp> m_shaders;
+	// compiled on the compile thread, waiting for commit.
+	std::vector<ShaderSp> m_compiled;
+};
+
+#endif
\ No newline at end of file
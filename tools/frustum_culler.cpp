@@ -0,0 +1,317 @@
+#include "frustum_culler.h"
+
+#include "draw_culler.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+
+
+void CullBounds::clear() {
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_extentX.clear();
+	m_extentY.clear();
+	m_extentZ.clear();
+	m_radius.clear();
+}
+
+void CullBounds::reserve(size_t count) {
+	m_centerX.reserve(count);
+	m_centerY.reserve(count);
+	m_centerZ.reserve(count);
+	m_extentX.reserve(count);
+	m_extentY.reserve(count);
+	m_extentZ.reserve(count);
+	m_radius.reserve(count);
+}
+
+void CullBounds::add(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	add(boundsMin, boundsMax, glm::length(boundsMax - boundsMin) * 0.5f);
+}
+
+void CullBounds::add(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float radius) {
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+
+	m_centerX.push_back(center.x);
+	m_centerY.push_back(center.y);
+	m_centerZ.push_back(center.z);
+	m_extentX.push_back(extent.x);
+	m_extentY.push_back(extent.y);
+	m_extentZ.push_back(extent.z);
+	m_radius.push_back(radius);
+}
+
+
+void FrustumCuller::setMatrix(const glm::mat4& matrix) {
+	DrawCuller::extractFrustumPlanes(matrix, m_planes);
+}
+
+bool FrustumCuller::isBoxVisible(const CullBounds& bounds, size_t index) const {
+	float cx = bounds.centerX()[index];
+	float cy = bounds.centerY()[index];
+	float cz = bounds.centerZ()[index];
+	float ex = bounds.extentX()[index];
+	float ey = bounds.extentY()[index];
+	float ez = bounds.extentZ()[index];
+
+	bool isVisible = true;
+	for (int i = 0; i < 6; i++) {
+		const glm::vec4& plane = m_planes[i];
+		float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float reach = std::abs(plane.x) * ex + std::abs(plane.y) * ey + std::abs(plane.z) * ez;
+		isVisible &= distance + reach >= 0.0f;
+	}
+	return isVisible;
+}
+
+bool FrustumCuller::isSphereVisible(const CullBounds& bounds, size_t index) const {
+	float cx = bounds.centerX()[index];
+	float cy = bounds.centerY()[index];
+	float cz = bounds.centerZ()[index];
+	float r = bounds.radius()[index];
+
+	bool isVisible = true;
+	for (int i = 0; i < 6; i++) {
+		const glm::vec4& plane = m_planes[i];
+		float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		isVisible &= distance + r >= 0.0f;
+	}
+	return isVisible;
+}
+
+size_t FrustumCuller::cullBoxesScalar(const CullBounds& bounds, std::vector<uint32_t>& visible) {
+	visible.resize(bounds.size());
+
+	size_t count = 0;
+	for (size_t i = 0; i < bounds.size(); i++) {
+		visible[count] = (uint32_t)i;
+		count += isBoxVisible(bounds, i) ? 1 : 0;
+	}
+
+	visible.resize(count);
+	return count;
+}
+
+size_t FrustumCuller::cullSpheresScalar(const CullBounds& bounds, std::vector<uint32_t>& visible) {
+	visible.resize(bounds.size());
+
+	size_t count = 0;
+	for (size_t i = 0; i < bounds.size(); i++) {
+		visible[count] = (uint32_t)i;
+		count += isSphereVisible(bounds, i) ? 1 : 0;
+	}
+
+	visible.resize(count);
+	return count;
+}
+
+#if defined(__AVX__)
+
+static const size_t kCullLaneCount = 8;
+
+size_t FrustumCuller::cullBoxes(const CullBounds& bounds, std::vector<uint32_t>& visible) {
+	visible.resize(bounds.size());
+
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m256 absX[6], absY[6], absZ[6];
+	for (int i = 0; i < 6; i++) {
+		planeX[i] = _mm256_set1_ps(m_planes[i].x);
+		planeY[i] = _mm256_set1_ps(m_planes[i].y);
+		planeZ[i] = _mm256_set1_ps(m_planes[i].z);
+		planeW[i] = _mm256_set1_ps(m_planes[i].w);
+		absX[i] = _mm256_andnot_ps(signMask, planeX[i]);
+		absY[i] = _mm256_andnot_ps(signMask, planeY[i]);
+		absZ[i] = _mm256_andnot_ps(signMask, planeZ[i]);
+	}
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + kCullLaneCount <= bounds.size(); i += kCullLaneCount) {
+		__m256 cx = _mm256_loadu_ps(bounds.centerX() + i);
+		__m256 cy = _mm256_loadu_ps(bounds.centerY() + i);
+		__m256 cz = _mm256_loadu_ps(bounds.centerZ() + i);
+		__m256 ex = _mm256_loadu_ps(bounds.extentX() + i);
+		__m256 ey = _mm256_loadu_ps(bounds.extentY() + i);
+		__m256 ez = _mm256_loadu_ps(bounds.extentZ() + i);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+				_mm256_mul_ps(planeZ[p], cz)), planeW[p]);
+			__m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+		}
+
+		// branchless compaction, every lane writes and only the visible ones advance.
+		int mask = _mm256_movemask_ps(inside);
+		for (size_t lane = 0; lane < kCullLaneCount; lane++) {
+			visible[count] = (uint32_t)(i + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	for (; i < bounds.size(); i++) {
+		visible[count] = (uint32_t)i;
+		count += isBoxVisible(bounds, i) ? 1 : 0;
+	}
+
+	visible.resize(count);
+	return count;
+}
+
+size_t FrustumCuller::cullSpheres(const CullBounds& bounds, std::vector<uint32_t>& visible) {
+	visible.resize(bounds.size());
+
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int i = 0; i < 6; i++) {
+		planeX[i] = _mm256_set1_ps(m_planes[i].x);
+		planeY[i] = _mm256_set1_ps(m_planes[i].y);
+		planeZ[i] = _mm256_set1_ps(m_planes[i].z);
+		planeW[i] = _mm256_set1_ps(m_planes[i].w);
+	}
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + kCullLaneCount <= bounds.size(); i += kCullLaneCount) {
+		__m256 cx = _mm256_loadu_ps(bounds.centerX() + i);
+		__m256 cy = _mm256_loadu_ps(bounds.centerY() + i);
+		__m256 cz = _mm256_loadu_ps(bounds.centerZ() + i);
+		__m256 r = _mm256_loadu_ps(bounds.radius() + i);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+				_mm256_mul_ps(planeZ[p], cz)), planeW[p]);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (size_t lane = 0; lane < kCullLaneCount; lane++) {
+			visible[count] = (uint32_t)(i + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	for (; i < bounds.size(); i++) {
+		visible[count] = (uint32_t)i;
+		count += isSphereVisible(bounds, i) ? 1 : 0;
+	}
+
+	visible.resize(count);
+	return count;
+}
+
+#else
+
+static const size_t kCullLaneCount = 4;
+
+size_t FrustumCuller::cullBoxes(const CullBounds& bounds, std::vector<uint32_t>& visible) {
+	visible.resize(bounds.size());
+
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m128 absX[6], absY[6], absZ[6];
+	for (int i = 0; i < 6; i++) {
+		planeX[i] = _mm_set1_ps(m_planes[i].x);
+		planeY[i] = _mm_set1_ps(m_planes[i].y);
+		planeZ[i] = _mm_set1_ps(m_planes[i].z);
+		planeW[i] = _mm_set1_ps(m_planes[i].w);
+		absX[i] = _mm_andnot_ps(signMask, planeX[i]);
+		absY[i] = _mm_andnot_ps(signMask, planeY[i]);
+		absZ[i] = _mm_andnot_ps(signMask, planeZ[i]);
+	}
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + kCullLaneCount <= bounds.size(); i += kCullLaneCount) {
+		__m128 cx = _mm_loadu_ps(bounds.centerX() + i);
+		__m128 cy = _mm_loadu_ps(bounds.centerY() + i);
+		__m128 cz = _mm_loadu_ps(bounds.centerZ() + i);
+		__m128 ex = _mm_loadu_ps(bounds.extentX() + i);
+		__m128 ey = _mm_loadu_ps(bounds.extentY() + i);
+		__m128 ez = _mm_loadu_ps(bounds.extentZ() + i);
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_mul_ps(planeZ[p], cz)), planeW[p]);
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+		}
+
+		// branchless compaction, every lane writes and only the visible ones advance.
+		int mask = _mm_movemask_ps(inside);
+		for (size_t lane = 0; lane < kCullLaneCount; lane++) {
+			visible[count] = (uint32_t)(i + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	for (; i < bounds.size(); i++) {
+		visible[count] = (uint32_t)i;
+		count += isBoxVisible(bounds, i) ? 1 : 0;
+	}
+
+	visible.resize(count);
+	return count;
+}
+
+size_t FrustumCuller::cullSpheres(const CullBounds& bounds, std::vector<uint32_t>& visible) {
+	visible.resize(bounds.size());
+
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int i = 0; i < 6; i++) {
+		planeX[i] = _mm_set1_ps(m_planes[i].x);
+		planeY[i] = _mm_set1_ps(m_planes[i].y);
+		planeZ[i] = _mm_set1_ps(m_planes[i].z);
+		planeW[i] = _mm_set1_ps(m_planes[i].w);
+	}
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + kCullLaneCount <= bounds.size(); i += kCullLaneCount) {
+		__m128 cx = _mm_loadu_ps(bounds.centerX() + i);
+		__m128 cy = _mm_loadu_ps(bounds.centerY() + i);
+		__m128 cz = _mm_loadu_ps(bounds.centerZ() + i);
+		__m128 r = _mm_loadu_ps(bounds.radius() + i);
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_mul_ps(planeZ[p], cz)), planeW[p]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (size_t lane = 0; lane < kCullLaneCount; lane++) {
+			visible[count] = (uint32_t)(i + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	for (; i < bounds.size(); i++) {
+		visible[count] = (uint32_t)i;
+		count += isSphereVisible(bounds, i) ? 1 : 0;
+	}
+
+	visible.resize(count);
+	return count;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef _FRUSTUM_CULLER_H_
+#define _FRUSTUM_CULLER_H_
+
+#include "../glm-master/glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// bounds as structure of arrays so the culler tests several of them per instruction. boxes are center and half
+// extent, spheres share the center.
+class CullBounds {
+public:
+	CullBounds() = default;
+	~CullBounds() = default;
+
+	void clear();
+	void reserve(size_t count);
+	// the sphere radius defaults to the one enclosing the box.
+	void add(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	void add(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float radius);
+
+	size_t size() const { return m_centerX.size(); }
+
+	const float* centerX() const { return m_centerX.data(); }
+	const float* centerY() const { return m_centerY.data(); }
+	const float* centerZ() const { return m_centerZ.data(); }
+	const float* extentX() const { return m_extentX.data(); }
+	const float* extentY() const { return m_extentY.data(); }
+	const float* extentZ() const { return m_extentZ.data(); }
+	const float* radius() const { return m_radius.data(); }
+
+private:
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	std::vector<float> m_radius;
+};
+
+// tests CullBounds against the six planes of a matrix and writes the indices of the visible bounds in order.
+// the simd versions use avx when the compiler targets it (/arch:AVX) and sse otherwise, and evaluate the plane
+// distances in the same order as the scalar ones, so both give the same list.
+class FrustumCuller {
+public:
+	FrustumCuller() = default;
+	~FrustumCuller() = default;
+
+	// the bounds are culled in the space the matrix transforms from, pass projection * view * world for model space.
+	void setMatrix(const glm::mat4& matrix);
+
+	size_t cullBoxes(const CullBounds& bounds, std::vector<uint32_t>& visible);
+	size_t cullSpheres(const CullBounds& bounds, std::vector<uint32_t>& visible);
+
+	size_t cullBoxesScalar(const CullBounds& bounds, std::vector<uint32_t>& visible);
+	size_t cullSpheresScalar(const CullBounds& bounds, std::vector<uint32_t>& visible);
+
+	const glm::vec4* getPlanes() const { return m_planes; }
+
+private:
+	bool isBoxVisible(const CullBounds& bounds, size_t index) const;
+	bool isSphereVisible(const CullBounds& bounds, size_t index) const;
+
+	glm::vec4 m_planes[6];
+};
+
+#endif
\ No newline at end of file
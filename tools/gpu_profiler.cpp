@@ -0,0 +1,210 @@
+#include "gpu_profiler.h"
+
+#include "../imgui_dx12/imgui.h"
+
+#include <algorithm>
+
+bool GpuProfiler::create(uint32_t frameCount, uint32_t passCount, uint64_t frequency) {
+	if (frameCount == 0 || passCount == 0 || frequency == 0)
+		return false;
+
+	m_frameCount = frameCount;
+	m_passCount = passCount;
+	m_frequency = frequency;
+	m_frames.assign(frameCount, Frame());
+	m_frameIndex = 0;
+	m_frame = nullptr;
+	m_passStack.clear();
+	m_openCount = 0;
+	m_passes.clear();
+	m_averages.clear();
+	m_frameTime = 0.0;
+	m_timedFrame = 0;
+	m_skippedCount = 0;
+	return true;
+}
+
+void GpuProfiler::beginFrame(uint64_t completedValue, const uint64_t* readback) {
+	// oldest first, so the newest completed frame is read last.
+	std::vector<Frame*> completed;
+	for (Frame& frame : m_frames) {
+		if (frame.isPending && frame.fenceValue <= completedValue)
+			completed.push_back(&frame);
+	}
+	std::sort(completed.begin(), completed.end(), [](const Frame* a, const Frame* b) { return a->index < b->index; });
+	for (Frame* frame : completed) {
+		readFrame(*frame, readback);
+		frame->isPending = false;
+	}
+
+	m_passStack.clear();
+	m_openCount = 0;
+	m_frame = &m_frames[m_frameIndex % m_frameCount];
+	if (m_frame->isPending) {
+		m_frame = nullptr;
+		m_skippedCount++;
+		return;
+	}
+
+	m_frame->passes.clear();
+	m_frame->queryCount = 0;
+	m_frame->index = m_frameIndex;
+}
+
+uint32_t GpuProfiler::beginPass(const char* name) {
+	// the end queries of the open passes are taken.
+	if (!m_frame || m_frame->queryCount + m_openCount + 2 > m_passCount * 2) {
+		m_passStack.push_back((uint32_t)kInvalidQuery);
+		return kInvalidQuery;
+	}
+
+	uint32_t query = (uint32_t)(m_frame - m_frames.data()) * m_passCount * 2 + m_frame->queryCount++;
+	m_openCount++;
+	m_passStack.push_back((uint32_t)m_frame->passes.size());
+	m_frame->passes.push_back({ name, (uint32_t)m_passStack.size() - 1, query, kInvalidQuery });
+	return query;
+}
+
+uint32_t GpuProfiler::endPass() {
+	if (m_passStack.empty())
+		return kInvalidQuery;
+
+	uint32_t pass = m_passStack.back();
+	m_passStack.pop_back();
+	if (pass == kInvalidQuery)
+		return kInvalidQuery;
+
+	m_openCount--;
+	uint32_t query = (uint32_t)(m_frame - m_frames.data()) * m_passCount * 2 + m_frame->queryCount++;
+	m_frame->passes[pass].endQuery = query;
+	return query;
+}
+
+bool GpuProfiler::getResolveRange(uint32_t& first, uint32_t& count) const {
+	if (!m_frame || m_frame->queryCount == 0)
+		return false;
+
+	first = (uint32_t)(m_frame - m_frames.data()) * m_passCount * 2;
+	count = m_frame->queryCount;
+	return true;
+}
+
+void GpuProfiler::endFrame(uint64_t fenceValue) {
+	if (m_frame) {
+		m_frame->fenceValue = fenceValue;
+		m_frame->isPending = m_frame->queryCount > 0;
+	}
+	m_frame = nullptr;
+	m_passStack.clear();
+	m_openCount = 0;
+	m_frameIndex++;
+}
+
+void GpuProfiler::readFrame(Frame& frame, const uint64_t* readback) {
+	m_passes.clear();
+	uint64_t frameBegin = UINT64_MAX;
+	uint64_t frameEnd = 0;
+	for (const Pass& pass : frame.passes) {
+		// a pass left open when the frame ended.
+		if (pass.endQuery == kInvalidQuery)
+			continue;
+
+		uint64_t begin = readback[pass.beginQuery];
+		uint64_t end = (std::max)(readback[pass.endQuery], begin);
+		double time = (double)(end - begin) * 1000.0 / (double)m_frequency;
+
+		auto average = m_averages.find(pass.name);
+		if (average == m_averages.end())
+			average = m_averages.emplace(pass.name, time).first;
+		else
+			average->second += (time - average->second) * 0.1;
+
+		m_passes.push_back({ pass.name, pass.depth, time, average->second });
+		frameBegin = (std::min)(frameBegin, begin);
+		frameEnd = (std::max)(frameEnd, end);
+	}
+
+	m_frameTime = frameEnd > frameBegin ? (double)(frameEnd - frameBegin) * 1000.0 / (double)m_frequency : 0.0;
+	m_timedFrame = frame.index;
+}
+
+void GpuProfiler::drawImGui() {
+	if (!ImGui::CollapsingHeader("gpu profiler"))
+		return;
+
+	ImGui::Text("frame %llu: %.3f ms, %u frames not timed", (unsigned long long)m_timedFrame, m_frameTime, m_skippedCount);
+	for (const GpuPassTime& pass : m_passes) {
+		ImGui::Text("%*s%s", (int)pass.depth * 2, "", pass.name);
+		ImGui::SameLine(ImGui::GetWindowContentRegionWidth() * 0.5f);
+		ImGui::Text("%.3f ms (avg %.3f)", pass.time, pass.average);
+	}
+}
+
+
+bool RenderGpuProfiler::create(RenderDevice* device, uint32_t frameCount, uint32_t passCount) {
+	destroy();
+
+	m_device = device;
+	if (!m_profiler.create(frameCount, passCount, device->getTimestampFrequency())) {
+		logRenderError("gpu profiler: the device has no timestamp frequency.\n");
+		return false;
+	}
+
+	m_queries = device->createTimestampQueries(m_profiler.getQueryCount());
+
+	BufferDesc desc;
+	desc.size = m_profiler.getReadbackSize();
+	desc.memoryType = MemoryType::eReadback;
+	desc.name = "gpuProfilerReadback";
+	m_readback = device->createBuffer(desc);
+	if (m_queries == kInvalidRenderHandle || m_readback == kInvalidRenderHandle)
+		return false;
+
+	// readback buffers stay mapped.
+	m_readbackData = static_cast<const uint64_t*>(device->map(m_readback));
+	return m_readbackData != nullptr;
+}
+
+void RenderGpuProfiler::destroy() {
+	if (!m_device)
+		return;
+
+	if (m_readback != kInvalidRenderHandle) {
+		if (m_readbackData)
+			m_device->unmap(m_readback);
+		m_device->destroy(m_readback);
+	}
+	if (m_queries != kInvalidRenderHandle)
+		m_device->destroy(m_queries);
+
+	m_device = nullptr;
+	m_queries = kInvalidRenderHandle;
+	m_readback = kInvalidRenderHandle;
+	m_readbackData = nullptr;
+}
+
+void RenderGpuProfiler::beginFrame(uint64_t completedValue) {
+	if (m_readbackData)
+		m_profiler.beginFrame(completedValue, m_readbackData);
+}
+
+void RenderGpuProfiler::beginPass(RenderCommandList* list, const char* name) {
+	list->beginEvent(name);
+	uint32_t query = m_profiler.beginPass(name);
+	if (query != GpuProfiler::kInvalidQuery)
+		list->writeTimestamp(m_queries, query);
+}
+
+void RenderGpuProfiler::endPass(RenderCommandList* list) {
+	uint32_t query = m_profiler.endPass();
+	if (query != GpuProfiler::kInvalidQuery)
+		list->writeTimestamp(m_queries, query);
+	list->endEvent();
+}
+
+void RenderGpuProfiler::endFrame(RenderCommandList* list, uint64_t fenceValue) {
+	uint32_t first, count;
+	if (m_profiler.getResolveRange(first, count))
+		list->resolveTimestamps(m_queries, first, count, m_readback, first * (uint32_t)sizeof(uint64_t));
+	m_profiler.endFrame(fenceValue);
+}
\ No newline at end of file
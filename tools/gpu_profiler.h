@@ -0,0 +1,120 @@
+#ifndef _GPU_PROFILER_H_
+#define _GPU_PROFILER_H_
+
+#include "../framework/render_device.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct GpuPassTime {
+	// a string literal, only the pointer is kept.
+	const char* name;
+	uint32_t depth;
+	// milliseconds.
+	double time;
+	// moving average over the timed frames.
+	double average;
+};
+
+// the timestamp bookkeeping without a backend. every frame in flight owns passCount pairs of queries, which are
+// resolved to the same index of a readback buffer at the end of the frame. a frame is read once the gpu has reached
+// its fence value; when the queries of a frame are still in flight the frame is not timed rather than waited for.
+class GpuProfiler {
+public:
+	static const uint32_t kInvalidQuery = UINT32_MAX;
+
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+
+	// frequency is the ticks per second of the queue the passes run on.
+	bool create(uint32_t frameCount, uint32_t passCount, uint64_t frequency);
+
+	uint32_t getQueryCount() const { return m_frameCount * m_passCount * 2; }
+	uint64_t getReadbackSize() const { return getQueryCount() * sizeof(uint64_t); }
+
+	// readback is the mapped readback buffer. reads the frames completed by completedValue.
+	void beginFrame(uint64_t completedValue, const uint64_t* readback);
+	// the query to write a timestamp to, kInvalidQuery when the frame is not timed or ran out of queries.
+	uint32_t beginPass(const char* name);
+	uint32_t endPass();
+	// the queries written since beginFrame, false when there are none.
+	bool getResolveRange(uint32_t& first, uint32_t& count) const;
+	// fenceValue is signaled by the queue after the frame.
+	void endFrame(uint64_t fenceValue);
+
+	// the passes of the newest frame read back, parents before their children.
+	const std::vector<GpuPassTime>& getPasses() const { return m_passes; }
+	// the first begin to the last end of the newest frame read back, in milliseconds.
+	double getFrameTime() const { return m_frameTime; }
+	uint64_t getTimedFrame() const { return m_timedFrame; }
+	// frames that found their queries still in flight.
+	uint32_t getSkippedCount() const { return m_skippedCount; }
+
+	void drawImGui();
+
+private:
+	struct Pass {
+		const char* name;
+		uint32_t depth;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct Frame {
+		std::vector<Pass> passes;
+		uint32_t queryCount = 0;
+		uint64_t index = 0;
+		uint64_t fenceValue = 0;
+		bool isPending = false;
+	};
+
+	void readFrame(Frame& frame, const uint64_t* readback);
+
+	uint32_t m_frameCount = 0;
+	uint32_t m_passCount = 0;
+	uint64_t m_frequency = 1;
+
+	std::vector<Frame> m_frames;
+	uint64_t m_frameIndex = 0;
+	// nullptr while the frame is not timed.
+	Frame* m_frame = nullptr;
+	// the open passes by their index in the frame, kInvalidQuery for the ones without queries.
+	std::vector<uint32_t> m_passStack;
+	uint32_t m_openCount = 0;
+
+	std::vector<GpuPassTime> m_passes;
+	std::unordered_map<std::string, double> m_averages;
+	double m_frameTime = 0.0;
+	uint64_t m_timedFrame = 0;
+	uint32_t m_skippedCount = 0;
+};
+
+// the queries and the readback buffer of a GpuProfiler on a RenderDevice. the passes are also marked as events.
+class RenderGpuProfiler {
+public:
+	RenderGpuProfiler() = default;
+	~RenderGpuProfiler() { destroy(); }
+
+	bool create(RenderDevice* device, uint32_t frameCount, uint32_t passCount);
+	void destroy();
+
+	// completedValue is the value the fence the frames are signaled on has reached.
+	void beginFrame(uint64_t completedValue);
+	void beginPass(RenderCommandList* list, const char* name);
+	void endPass(RenderCommandList* list);
+	// resolves the queries of the frame, record it after the last pass.
+	void endFrame(RenderCommandList* list, uint64_t fenceValue);
+
+	GpuProfiler& getProfiler() { return m_profiler; }
+
+private:
+	GpuProfiler m_profiler;
+	RenderDevice* m_device = nullptr;
+	RenderHandle m_queries = kInvalidRenderHandle;
+	RenderHandle m_readback = kInvalidRenderHandle;
+	const uint64_t* m_readbackData = nullptr;
+};
+
+#endif
\ No newline at end of file
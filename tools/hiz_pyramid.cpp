@@ -0,0 +1,107 @@
+#include "hiz_pyramid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// same values as shaders/hiz_common.hlsli.
+static const float kHiZDepthBias = 1e-5f;
+static const float kHiZMinClipW = 1e-5f;
+
+
+bool HiZPyramid::create(uint32_t size) {
+	if (size == 0 || (size & (size - 1)) != 0)
+		return false;
+
+	m_size = size;
+	m_mips.clear();
+	for (uint32_t mipSize = size; mipSize > 0; mipSize >>= 1)
+		m_mips.emplace_back((size_t)mipSize * mipSize, 1.0f);
+
+	return true;
+}
+
+void HiZPyramid::getDepthFootprint(uint32_t texel, uint32_t depthSize, uint32_t& begin, uint32_t& end) const {
+	begin = texel * depthSize / m_size;
+	end = std::min(((texel + 1) * depthSize + m_size - 1) / m_size, depthSize);
+}
+
+void HiZPyramid::build(const float* depth, uint32_t width, uint32_t height, uint32_t rowPitch) {
+	std::vector<float>& mip0 = m_mips[0];
+	for (uint32_t y = 0; y < m_size; y++) {
+		uint32_t beginY, endY;
+		getDepthFootprint(y, height, beginY, endY);
+
+		for (uint32_t x = 0; x < m_size; x++) {
+			uint32_t beginX, endX;
+			getDepthFootprint(x, width, beginX, endX);
+
+			float farthest = 0.0f;
+			for (uint32_t depthY = beginY; depthY < endY; depthY++) {
+				const float* row = depth + (size_t)depthY * rowPitch;
+				for (uint32_t depthX = beginX; depthX < endX; depthX++)
+					farthest = std::max(farthest, row[depthX]);
+			}
+			mip0[(size_t)y * m_size + x] = farthest;
+		}
+	}
+
+	for (uint32_t mip = 1; mip < (uint32_t)m_mips.size(); mip++) {
+		const std::vector<float>& source = m_mips[mip - 1];
+		std::vector<float>& dest = m_mips[mip];
+		uint32_t sourceSize = getMipSize(mip - 1);
+		uint32_t destSize = getMipSize(mip);
+
+		for (uint32_t y = 0; y < destSize; y++) {
+			const float* row0 = source.data() + (size_t)y * 2 * sourceSize;
+			const float* row1 = row0 + sourceSize;
+			for (uint32_t x = 0; x < destSize; x++)
+				dest[(size_t)y * destSize + x] = std::max(std::max(row0[x * 2], row0[x * 2 + 1]), std::max(row1[x * 2], row1[x * 2 + 1]));
+		}
+	}
+}
+
+bool HiZPyramid::isOccluded(const glm::mat4& worldViewProj, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+	glm::vec2 uvMin(FLT_MAX);
+	glm::vec2 uvMax(-FLT_MAX);
+	float nearest = 1.0f;
+
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+		glm::vec4 clip = worldViewProj * glm::vec4(corner, 1.0f);
+		if (clip.w < kHiZMinClipW)
+			return false;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 uv(ndc.x * 0.5f + 0.5f, 0.5f - ndc.y * 0.5f);
+		uvMin = glm::min(uvMin, uv);
+		uvMax = glm::max(uvMax, uv);
+		nearest = std::min(nearest, ndc.z);
+	}
+
+	if (uvMin.x > 1.0f || uvMin.y > 1.0f || uvMax.x < 0.0f || uvMax.y < 0.0f)
+		return false;
+	uvMin = glm::clamp(uvMin, 0.0f, 1.0f);
+	uvMax = glm::clamp(uvMax, 0.0f, 1.0f);
+
+	// the first mip where the rectangle is at most one texel wide, so it touches at most 2x2 texels.
+	glm::vec2 size = (uvMax - uvMin) * (float)m_size;
+	uint32_t mipCount = (uint32_t)m_mips.size();
+	uint32_t mip = std::min((uint32_t)std::ceil(std::log2(std::max(std::max(size.x, size.y), 1.0f))), mipCount - 1);
+
+	uint32_t minX, minY, maxX, maxY;
+	for (;;) {
+		uint32_t levelSize = getMipSize(mip);
+		minX = std::min((uint32_t)(uvMin.x * levelSize), levelSize - 1);
+		minY = std::min((uint32_t)(uvMin.y * levelSize), levelSize - 1);
+		maxX = std::min((uint32_t)(uvMax.x * levelSize), levelSize - 1);
+		maxY = std::min((uint32_t)(uvMax.y * levelSize), levelSize - 1);
+		if ((maxX - minX <= 1 && maxY - minY <= 1) || mip == mipCount - 1)
+			break;
+		mip++;
+	}
+
+	float farthest = std::max(std::max(load(mip, minX, minY), load(mip, maxX, minY)), std::max(load(mip, minX, maxY), load(mip, maxX, maxY)));
+
+	return farthest < nearest - kHiZDepthBias;
+}
\ No newline at end of file
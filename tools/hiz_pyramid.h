@@ -0,0 +1,46 @@
+#ifndef _HIZ_PYRAMID_H_
+#define _HIZ_PYRAMID_H_
+
+#include "../glm-master/glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// same constants as shaders/hiz_common.hlsli.
+static const uint32_t kHiZSize = 1024;
+static const uint32_t kHiZMipCount = 11;
+static const uint32_t kHiZTileSize = 64;
+
+// cpu twin of hiz_build_cs.fx and the occlusion test of draw_cull_cs.fx. mip 0 is a square stretched over the
+// depth buffer holding the farthest depth of the depth texels under each texel, every following mip the farthest
+// of its 2x2 texels. the reduction only takes maxima, so build gives the same texels as the gpu.
+class HiZPyramid {
+public:
+	HiZPyramid() = default;
+	~HiZPyramid() = default;
+
+	// size must be a power of two, the gpu pyramid is kHiZSize.
+	bool create(uint32_t size = kHiZSize);
+
+	// rowPitch is in floats.
+	void build(const float* depth, uint32_t width, uint32_t height, uint32_t rowPitch);
+
+	// true when the bounds are behind every texel under their screen rectangle, bounds reaching behind the near
+	// plane are never occluded. the bounds are in the space the matrix transforms from.
+	bool isOccluded(const glm::mat4& worldViewProj, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+	uint32_t getSize() const { return m_size; }
+	uint32_t getMipCount() const { return (uint32_t)m_mips.size(); }
+	uint32_t getMipSize(uint32_t mip) const { return m_size >> mip; }
+	const std::vector<float>& getMip(uint32_t mip) const { return m_mips[mip]; }
+	float load(uint32_t mip, uint32_t x, uint32_t y) const { return m_mips[mip][(size_t)y * getMipSize(mip) + x]; }
+
+	// depth texels under a texel of mip 0, end exclusive.
+	void getDepthFootprint(uint32_t texel, uint32_t depthSize, uint32_t& begin, uint32_t& end) const;
+
+private:
+	uint32_t m_size = 0;
+	std::vector<std::vector<float>> m_mips;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "material_classifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+
+bool MaterialClassifier::classify(const uint32_t* visibilityBuffer, uint32_t width, uint32_t height, uint32_t rowPitch, unsigned int threadCount) {
+	if (visibilityBuffer == nullptr || width == 0 || height == 0 || rowPitch < width)
+		return false;
+
+	m_tileCountX = (width + kMaterialTileSizeX - 1) / kMaterialTileSizeX;
+	m_tileCountY = (height + kMaterialTileSizeY - 1) / kMaterialTileSizeY;
+	if (m_tileCountX > 0xffff || m_tileCountY > 0xffff)
+		return false;
+
+	m_tileMasks.assign((size_t)m_tileCountX * m_tileCountY, 0);
+	m_rowWorkItems.resize(m_tileCountY);
+
+	// tile rows are spread over threads. every row writes its own masks and work items, which are concatenated in
+	// row order afterwards so the result does not depend on the thread count.
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, m_tileCountY);
+
+	std::atomic<uint32_t> nextRow(0);
+	auto worker = [&]() {
+		for (uint32_t tileY = nextRow++; tileY < m_tileCountY; tileY = nextRow++)
+			classifyTileRow(visibilityBuffer, width, height, rowPitch, tileY);
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& ite : threads)
+		ite.join();
+
+	m_closureTileCounts.assign(kNumClosures, 0);
+	size_t workItemCount = 0;
+	for (auto& ite : m_rowWorkItems)
+		workItemCount += ite.size();
+
+	m_workItems.clear();
+	m_workItems.reserve(workItemCount);
+	for (auto& row : m_rowWorkItems) {
+		for (auto& ite : row)
+			m_closureTileCounts[ite.closureId]++;
+		m_workItems.insert(m_workItems.end(), row.begin(), row.end());
+	}
+
+	m_closureTileOffsets.assign(kNumClosures + 1, 0);
+	for (uint32_t c = 0; c < kNumClosures; c++)
+		m_closureTileOffsets[c + 1] = m_closureTileOffsets[c] + m_closureTileCounts[c];
+
+	std::vector<uint32_t> cursor(m_closureTileOffsets.begin(), m_closureTileOffsets.end() - 1);
+	m_sortedTiles.resize(m_workItems.size());
+	for (auto& ite : m_workItems)
+		m_sortedTiles[cursor[ite.closureId]++] = ite.tile;
+
+	return true;
+}
+
+void MaterialClassifier::classifyTileRow(const uint32_t* visibilityBuffer, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t tileY) {
+	uint32_t* masks = &m_tileMasks[tileY * m_tileCountX];
+	uint32_t yBegin = tileY * kMaterialTileSizeY;
+	uint32_t yEnd = std::min(yBegin + kMaterialTileSizeY, height);
+
+	for (uint32_t y = yBegin; y < yEnd; y++) {
+		const uint32_t* row = visibilityBuffer + (size_t)y * rowPitch * 2;
+
+		for (uint32_t tileX = 0; tileX < m_tileCountX; tileX++) {
+			uint32_t xBegin = tileX * kMaterialTileSizeX;
+			uint32_t xEnd = std::min(xBegin + kMaterialTileSizeX, width);
+
+			// branchless so the loop vectorizes: the shift is masked to stay defined and the bit is dropped when the
+			// id is background.
+			uint32_t mask = 0;
+			for (uint32_t x = xBegin; x < xEnd; x++) {
+				uint32_t closureId = row[x * 2 + 1] & kClosureIdMask;
+				mask |= (1u << (closureId & 31)) & (0u - (uint32_t)(closureId < kNumClosures));
+			}
+			masks[tileX] |= mask;
+		}
+	}
+
+	std::vector<MaterialWorkItem>& workItems = m_rowWorkItems[tileY];
+	workItems.clear();
+	for (uint32_t tileX = 0; tileX < m_tileCountX; tileX++) {
+		uint32_t mask = masks[tileX];
+		for (uint32_t c = 0; mask != 0; c++, mask >>= 1) {
+			if (mask & 1)
+				workItems.push_back({ makeTile(tileX, tileY), c });
+		}
+	}
+}
+
+void MaterialClassifier::buildArguments(std::vector<uint32_t>& arguments) {
+	arguments.assign(kMaterialArgumentCount, 0);
+	if (m_closureTileOffsets.size() != kNumClosures + 1)
+		return;
+
+	for (uint32_t c = 0; c < kNumClosures; c++) {
+		uint32_t* closureArguments = &arguments[c * kClosureArgumentStride];
+		closureArguments[0] = m_closureTileOffsets[c];
+		closureArguments[1] = c;
+		closureArguments[2] = m_closureTileCounts[c];
+		closureArguments[3] = 1;
+		closureArguments[4] = 1;
+	}
+
+	arguments[kSortArgumentOffset + 0] = (m_closureTileOffsets[kNumClosures] + kSortThreadCount - 1) / kSortThreadCount;
+	arguments[kSortArgumentOffset + 1] = 1;
+	arguments[kSortArgumentOffset + 2] = 1;
+}
+
+bool MaterialClassifier::validate(const uint32_t* closureTileCounts, const uint32_t* sortedTiles, size_t sortedTileCount, std::string& error) {
+	error.clear();
+
+	for (uint32_t c = 0; c < kNumClosures; c++) {
+		if (closureTileCounts[c] != m_closureTileCounts[c]) {
+			error += "closure " + std::to_string(c) + ": " + std::to_string(closureTileCounts[c]) + " tiles, expected " +
+				std::to_string(m_closureTileCounts[c]) + ".\n";
+		}
+	}
+	if (!error.empty())
+		return false;
+
+	if (sortedTileCount < m_sortedTiles.size()) {
+		error = "sorted tile list has " + std::to_string(sortedTileCount) + " entries, expected " + std::to_string(m_sortedTiles.size()) + ".\n";
+		return false;
+	}
+
+	for (uint32_t c = 0; c < kNumClosures; c++) {
+		uint32_t begin = m_closureTileOffsets[c];
+		uint32_t end = m_closureTileOffsets[c + 1];
+
+		std::vector<uint32_t> tiles(sortedTiles + begin, sortedTiles + end);
+		std::sort(tiles.begin(), tiles.end());
+		if (!std::equal(tiles.begin(), tiles.end(), m_sortedTiles.begin() + begin))
+			error += "closure " + std::to_string(c) + ": tile list differs.\n";
+	}
+
+	return error.empty();
+}
+
+bool MaterialClassifier::validateArguments(const uint32_t* arguments, std::string& error) {
+	error.clear();
+
+	std::vector<uint32_t> expected;
+	buildArguments(expected);
+
+	static const char* const kClosureFieldNames[kClosureArgumentStride] = { "tile offset", "closure id", "group count x", "group count y", "group count z" };
+	for (uint32_t c = 0; c < kNumClosures; c++) {
+		for (uint32_t i = 0; i < kClosureArgumentStride; i++) {
+			uint32_t index = c * kClosureArgumentStride + i;
+			if (arguments[index] != expected[index]) {
+				error += "closure " + std::to_string(c) + " " + kClosureFieldNames[i] + ": " + std::to_string(arguments[index]) +
+					", expected " + std::to_string(expected[index]) + ".\n";
+			}
+		}
+	}
+
+	for (uint32_t i = kSortArgumentOffset; i < kMaterialArgumentCount; i++) {
+		if (arguments[i] != expected[i]) {
+			error += "sort group count " + std::to_string(i - kSortArgumentOffset) + ": " + std::to_string(arguments[i]) +
+				", expected " + std::to_string(expected[i]) + ".\n";
+		}
+	}
+
+	return error.empty();
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef _MATERIAL_CLASSIFIER_H_
+#define _MATERIAL_CLASSIFIER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// same constants as shaders/material_common.hlsli.
+static const uint32_t kMaterialTileSizeX = 16;
+static const uint32_t kMaterialTileSizeY = 8;
+static const uint32_t kNumClosures = 22;
+
+// the visibility buffer y holds (instance id << kClosureIdBits) | closure id.
+static const uint32_t kClosureIdBits = 8;
+static const uint32_t kClosureIdMask = (1u << kClosureIdBits) - 1;
+
+// material argument buffer in uint32s: per closure the tile offset, the closure id and D3D12_DISPATCH_ARGUMENTS,
+// then the dispatch arguments of the sort pass.
+static const uint32_t kClosureArgumentStride = 5;
+static const uint32_t kSortArgumentOffset = kNumClosures * kClosureArgumentStride;
+static const uint32_t kMaterialArgumentCount = kSortArgumentOffset + 3;
+static const uint32_t kSortThreadCount = 64;
+
+// same layout as WorkItem in the shaders. tile is (tileY << 16) | tileX.
+struct MaterialWorkItem {
+	uint32_t tile;
+	uint32_t closureId;
+};
+
+// cpu reference of the material classification passes, used to validate the gpu results and as a baseline to
+// measure them against. the visibility buffer holds a uint2 per pixel whose y carries the closure id in its low
+// kClosureIdBits; ids outside [0, kNumClosures) are background and pixels outside the image are never read.
+class MaterialClassifier {
+public:
+	MaterialClassifier() = default;
+	~MaterialClassifier() = default;
+
+	static uint32_t makeTile(uint32_t tileX, uint32_t tileY) { return (tileY << 16) | tileX; }
+	static uint32_t getTileX(uint32_t tile) { return tile & 0xffff; }
+	static uint32_t getTileY(uint32_t tile) { return tile >> 16; }
+
+	// rowPitch is in pixels. 0 threads picks the hardware concurrency.
+	bool classify(const uint32_t* visibilityBuffer, uint32_t width, uint32_t height, uint32_t rowPitch, unsigned int threadCount = 0);
+
+	uint32_t getTileCountX() { return m_tileCountX; }
+	uint32_t getTileCountY() { return m_tileCountY; }
+
+	// bit c is set when closure c covers a pixel of the tile. indexed by tileY * tileCountX + tileX.
+	const std::vector<uint32_t>& getTileMasks() { return m_tileMasks; }
+
+	// the count pass: number of tiles per closure, and one work item per (tile, closure) in tile order.
+	const std::vector<uint32_t>& getClosureTileCounts() { return m_closureTileCounts; }
+	const std::vector<MaterialWorkItem>& getWorkItems() { return m_workItems; }
+
+	// the sort pass: exclusive prefix sum of the counts (kNumClosures + 1 entries) and the tiles of every closure
+	// stored contiguously from its offset.
+	const std::vector<uint32_t>& getClosureTileOffsets() { return m_closureTileOffsets; }
+	const std::vector<uint32_t>& getSortedTiles() { return m_sortedTiles; }
+
+	// the argument pass: the material argument buffer material_args_cs.fx writes for these counts.
+	void buildArguments(std::vector<uint32_t>& arguments);
+
+	// compares gpu results with the reference. the gpu appends in any order, so tiles only have to match per closure.
+	bool validate(const uint32_t* closureTileCounts, const uint32_t* sortedTiles, size_t sortedTileCount, std::string& error);
+	// compares a gpu material argument buffer of kMaterialArgumentCount values with buildArguments.
+	bool validateArguments(const uint32_t* arguments, std::string& error);
+
+private:
+	void classifyTileRow(const uint32_t* visibilityBuffer, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t tileY);
+
+	uint32_t m_tileCountX = 0;
+	uint32_t m_tileCountY = 0;
+
+	std::vector<uint32_t> m_tileMasks;
+	std::vector<uint32_t> m_closureTileCounts;
+	std::vector<MaterialWorkItem> m_workItems;
+	std::vector<std::vector<MaterialWorkItem>> m_rowWorkItems;
+	std::vector<uint32_t> m_closureTileOffsets;
+	std::vector<uint32_t> m_sortedTiles;
+};
+
+#endif
\ No newline at end of file
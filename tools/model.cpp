@@ -3,15 +3,24 @@
 #include "../glm-master/glm/glm.hpp"
 #include "../glm-master/glm/gtc/matrix_transform.hpp"
 #include "../glm-master/glm/gtc/quaternion.hpp"
+#include "../glm-master/glm/gtc/type_ptr.hpp"
 
 #include "../resource_manager.h"
+#include "../framework/hash.h"
+#include "cpu_profiler.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/pbrmaterial.h>
 
-Model::Model() {
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+Model::Model() : m_vertexBuffer(-1), m_indexBuffer(-1), m_allIndexCount(0), m_meshCount(0), m_materialCount(0) {
 
 }
 
@@ -31,23 +40,39 @@ bool Model::create(ID3D12Device* device, ID3D12CommandQueue* queue, const char*
 
 	Assimp::Importer importer;
 
+    CpuProfileScope stage("import");
     const aiScene* scene = importer.ReadFile(std::string(filename),
         aiPostProcessSteps::aiProcess_CalcTangentSpace |
         aiPostProcessSteps::aiProcess_Triangulate
     );
+    if (!scene) {
+        OutputDebugString((std::string("failed to import ") + filename + ": " + importer.GetErrorString() + "\n").c_str());
+        return false;
+    }
 
-    std::unordered_map<aiMesh*, int> meshIdMap;
+    stage.next("meshes");
+    // scene meshes with the same data as an earlier one are merged into it, so the nodes referencing either of them
+    // share one instanced draw.
+    std::vector<int> meshRemap;
+    std::vector<aiMesh*> uniqueMeshes;
 
     if (scene->HasMeshes()) {
-        m_meshCount = scene->mNumMeshes;
-
         std::vector<Vertex> vertices;
         std::vector<int> indices;
 
         int indexOffset = 0;
 
+        std::vector<size_t> vertexOffsets;
+        std::vector<size_t> indexOffsets;
+        std::unordered_multimap<uint64_t, int> meshHashes;
+
+        meshRemap.resize(scene->mNumMeshes);
         for (int i = 0; i < scene->mNumMeshes; i++) {
             aiMesh* mesh = scene->mMeshes[i];
+            size_t vertexOffset = vertices.size();
+            size_t indexStart = indices.size();
+            glm::vec3 boundsMin(FLT_MAX);
+            glm::vec3 boundsMax(-FLT_MAX);
             for (int j = 0; j < mesh->mNumVertices; j++) {
                 Vertex vertex;
                 vertex.pos = glm::vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z);
@@ -55,6 +80,9 @@ bool Model::create(ID3D12Device* device, ID3D12CommandQueue* queue, const char*
                 vertex.tan = glm::vec3(mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z);
                 vertex.tex = glm::vec2(mesh->mTextureCoords[0][j].x, 1.0f - mesh->mTextureCoords[0][j].y);
                 vertices.push_back(vertex);
+
+                boundsMin = glm::min(boundsMin, vertex.pos);
+                boundsMax = glm::max(boundsMax, vertex.pos);
             }
 
             for (int j = 0; j < mesh->mNumFaces; j++) {
@@ -64,13 +92,53 @@ bool Model::create(ID3D12Device* device, ID3D12CommandQueue* queue, const char*
                 }
             }
 
+            // fnv-1a over the vertices, the indices and the material.
+            size_t vertexBytes = mesh->mNumVertices * sizeof(Vertex);
+            size_t indexBytes = (indices.size() - indexStart) * sizeof(int);
+            uint64_t hash = hashBytes(vertices.data() + vertexOffset, vertexBytes);
+            hash = hashBytes(indices.data() + indexStart, indexBytes, hash);
+            hash = hashValue(mesh->mMaterialIndex, hash);
+
+            // skinned meshes are bound to their own joints and are never merged.
+            int duplicate = -1;
+            auto range = meshHashes.equal_range(hash);
+            for (auto ite = range.first; ite != range.second && duplicate == -1 && !mesh->HasBones(); ite++) {
+                int other = ite->second;
+                if (m_materialIndex[other] == mesh->mMaterialIndex && m_vertexCount[other] == mesh->mNumVertices &&
+                    m_indexCount[other] == (int)(indices.size() - indexStart) &&
+                    memcmp(vertices.data() + vertexOffsets[other], vertices.data() + vertexOffset, vertexBytes) == 0 &&
+                    memcmp(indices.data() + indexOffsets[other], indices.data() + indexStart, indexBytes) == 0)
+                    duplicate = other;
+            }
+            if (duplicate != -1) {
+                vertices.resize(vertexOffset);
+                indices.resize(indexStart);
+                meshRemap[i] = duplicate;
+                continue;
+            }
+
             indexOffset += mesh->mNumVertices;
 
-            meshIdMap[mesh] = i;
+            meshRemap[i] = m_meshCount++;
+            uniqueMeshes.push_back(mesh);
+            meshHashes.emplace(hash, meshRemap[i]);
+            vertexOffsets.push_back(vertexOffset);
+            indexOffsets.push_back(indexStart);
 
             m_materialIndex.push_back(mesh->mMaterialIndex);
             m_indexCount.push_back(mesh->mNumFaces * 3);
             m_vertexCount.push_back(mesh->mNumVertices);
+            m_boundsMin.push_back(boundsMin);
+            m_boundsMax.push_back(boundsMax);
+
+            // tighter than the sphere around the box corners.
+            glm::vec3 boundsCenter = (boundsMin + boundsMax) * 0.5f;
+            float radiusSquared = 0.0f;
+            for (auto ite = vertices.end() - mesh->mNumVertices; ite != vertices.end(); ite++) {
+                glm::vec3 offset = ite->pos - boundsCenter;
+                radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+            }
+            m_boundsRadius.push_back(std::sqrt(radiusSquared));
         }
 
 
@@ -79,32 +147,217 @@ bool Model::create(ID3D12Device* device, ID3D12CommandQueue* queue, const char*
 
         m_allIndexCount = indices.size();
 
+        m_positions.resize(vertices.size());
+        m_normals.resize(vertices.size());
+        m_texcoords.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            m_positions[i] = vertices[i].pos;
+            m_normals[i] = vertices[i].nor;
+            m_texcoords[i] = vertices[i].tex;
+        }
+        m_indices.assign(indices.begin(), indices.end());
+    }
 
-        m_nodes.resize(scene->mNumMeshes);
-        for (auto& ite : m_nodes) {
-            ite = std::make_shared<Node>();
+    stage.next("node tree");
+    // the node tree parents first, with the mesh references of every node.
+    std::vector<int32_t> parents;
+    std::vector<aiNode*> nodes;
+    std::vector<std::pair<int, uint32_t>> instances;
+    {
+        std::vector<std::pair<aiNode*, int32_t>> stack;
+        if (scene->mRootNode)
+            stack.push_back(std::make_pair(scene->mRootNode, -1));
+        while (!stack.empty()) {
+            aiNode* node = stack.back().first;
+            uint32_t id = (uint32_t)parents.size();
+            parents.push_back(stack.back().second);
+            nodes.push_back(node);
+            stack.pop_back();
+
+            for (int i = 0; i < node->mNumMeshes; i++)
+                instances.push_back(std::make_pair(meshRemap[node->mMeshes[i]], id));
+            for (int i = node->mNumChildren; i > 0; i--)
+                stack.push_back(std::make_pair(node->mChildren[i - 1], (int32_t)id));
         }
     }
 
-    if (scene->hasSkeletons()) {
-        for (int i = 0; i < scene->mNumSkeletons; i++) {
-            aiSkeleton* skeleton = scene->mSkeletons[i];
-            for (int j = 0; j < skeleton->mNumBones; j++) {
-                aiSkeletonBone* bone = skeleton->mBones[j];
-                if (!m_nodes[meshIdMap[bone->mMeshId]]) {
-                    m_nodes[meshIdMap[bone->mMeshId]] = std::make_shared<Node>();
+    // without a node tree every mesh is drawn once where it is.
+    if (parents.empty()) {
+        parents.push_back(-1);
+        nodes.push_back(nullptr);
+        for (int i = 0; i < m_meshCount; i++)
+            instances.push_back(std::make_pair(i, 0u));
+    }
+
+    m_transforms.create(parents.data(), (uint32_t)parents.size());
+    m_nodeParents = parents;
+    m_nodeNames.resize(nodes.size());
+    m_restPose.assign(nodes.size(), { glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) });
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        if (!nodes[i])
+            continue;
+
+        aiVector3D scaling;
+        aiQuaternion rotation;
+        aiVector3D position;
+        nodes[i]->mTransformation.Decompose(scaling, rotation, position);
+        m_transforms.setLocalPosition(i, glm::vec3(position.x, position.y, position.z));
+        m_transforms.setLocalRotation(i, glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
+        m_transforms.setLocalScale(i, glm::vec3(scaling.x, scaling.y, scaling.z));
+        m_nodeNames[i] = nodes[i]->mName.C_Str();
+        m_restPose[i] = { glm::vec3(position.x, position.y, position.z), glm::quat(rotation.w, rotation.x, rotation.y, rotation.z),
+            glm::vec3(scaling.x, scaling.y, scaling.z) };
+    }
+    m_transforms.update(1);
+
+    stage.next("animations");
+    // the channels and the bones find their node by name, the ones of nodes that are not in the tree are dropped.
+    std::unordered_map<std::string, uint32_t> nodeIds;
+    for (uint32_t i = 0; i < m_nodeNames.size(); i++)
+        nodeIds.emplace(m_nodeNames[i], i);
+
+    if (scene->HasAnimations()) {
+        for (int i = 0; i < scene->mNumAnimations; i++) {
+            aiAnimation* animation = scene->mAnimations[i];
+            double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+
+            std::vector<AnimationTrackSource> tracks;
+            for (int j = 0; j < animation->mNumChannels; j++) {
+                aiNodeAnim* channel = animation->mChannels[j];
+                auto node = nodeIds.find(channel->mNodeName.C_Str());
+                if (node == nodeIds.end())
+                    continue;
+
+                AnimationTrackSource track;
+                track.joint = node->second;
+                for (int k = 0; k < channel->mNumPositionKeys; k++) {
+                    const aiVectorKey& key = channel->mPositionKeys[k];
+                    track.positionTimes.push_back((float)(key.mTime / ticksPerSecond));
+                    track.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
                 }
+                for (int k = 0; k < channel->mNumRotationKeys; k++) {
+                    const aiQuatKey& key = channel->mRotationKeys[k];
+                    track.rotationTimes.push_back((float)(key.mTime / ticksPerSecond));
+                    track.rotations.push_back(glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+                }
+                for (int k = 0; k < channel->mNumScalingKeys; k++) {
+                    const aiVectorKey& key = channel->mScalingKeys[k];
+                    track.scaleTimes.push_back((float)(key.mTime / ticksPerSecond));
+                    track.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+                }
+                tracks.push_back(std::move(track));
+            }
 
-                m_nodes[meshIdMap[bone->mMeshId]]->setParent(m_nodes[bone->mParent].get());
-                m_nodes[bone->mParent]->children().push_back(m_nodes[meshIdMap[bone->mMeshId]]);
+            AnimationClip clip;
+            if (!clip.create(animation->mName.C_Str(), (float)(animation->mDuration / ticksPerSecond), tracks)) {
+                OutputDebugString((std::string("failed to import animation ") + animation->mName.C_Str() + ".\n").c_str());
+                continue;
             }
+            m_animations.push_back(std::move(clip));
         }
     }
 
+    stage.next("instances");
+    std::stable_sort(instances.begin(), instances.end(), [](const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b) { return a.first < b.first; });
+    m_instanceMeshes.resize(instances.size());
+    m_instanceNodes.resize(instances.size());
+    m_meshInstanceOffset.assign(m_meshCount, 0);
+    m_meshInstanceCount.assign(m_meshCount, 0);
+    for (size_t i = 0; i < instances.size(); i++) {
+        m_instanceMeshes[i] = instances[i].first;
+        m_instanceNodes[i] = instances[i].second;
+        if (m_meshInstanceCount[instances[i].first]++ == 0)
+            m_meshInstanceOffset[instances[i].first] = (int)i;
+    }
+
+    // the boxes of the meshes of every node in its own space, then in model space merged up the tree.
+    std::vector<glm::vec3> nodeMin(parents.size(), glm::vec3(FLT_MAX));
+    std::vector<glm::vec3> nodeMax(parents.size(), glm::vec3(-FLT_MAX));
+    for (auto& instance : instances) {
+        nodeMin[instance.second] = glm::min(nodeMin[instance.second], m_boundsMin[instance.first]);
+        nodeMax[instance.second] = glm::max(nodeMax[instance.second], m_boundsMax[instance.first]);
+    }
+    m_nodeBoundsMin.resize(parents.size());
+    m_nodeBoundsMax.resize(parents.size());
+    m_transforms.computeSubtreeBounds(nodeMin.data(), nodeMax.data(), m_nodeBoundsMin.data(), m_nodeBoundsMax.data());
+
+    stage.next("skin");
+    // the bones of every skinned mesh get a range of the palette, the vertices keep their four heaviest bones. the
+    // palette is in the space of the first instance of the mesh, which vs.fx applies after skinning.
+    m_skinJointNodes.assign(1, -1);
+    m_skinBindMatrices.assign(1, glm::mat4(1.0f));
+    m_skinOffsetMatrices.assign(1, glm::mat4(1.0f));
+    m_skinVertices.assign(m_positions.size(), { { 0, 0, 0, 0 }, { 255, 0, 0, 0 } });
+    {
+        int vertexOffset = 0;
+        for (int i = 0; i < (int)uniqueMeshes.size(); i++) {
+            aiMesh* mesh = uniqueMeshes[i];
+            if (!mesh->HasBones() || m_meshInstanceCount[i] == 0 || m_skinJointNodes.size() + mesh->mNumBones > 65536) {
+                vertexOffset += m_vertexCount[i];
+                continue;
+            }
+
+            glm::mat4 meshInverse = glm::inverse(instanceMatrix(m_meshInstanceOffset[i]));
+            uint16_t jointBase = (uint16_t)m_skinJointNodes.size();
+            std::vector<glm::vec4> weights(mesh->mNumVertices, glm::vec4(0.0f));
+            std::vector<glm::uvec4> joints(mesh->mNumVertices, glm::uvec4(0));
+            for (int j = 0; j < mesh->mNumBones; j++) {
+                aiBone* bone = mesh->mBones[j];
+                auto node = nodeIds.find(bone->mName.C_Str());
+
+                // assimp matrices are row major.
+                glm::mat4 offset = glm::transpose(glm::make_mat4(&bone->mOffsetMatrix.a1));
+                m_skinJointNodes.push_back(node == nodeIds.end() ? -1 : (int32_t)node->second);
+                m_skinBindMatrices.push_back(node == nodeIds.end() ? glm::mat4(1.0f) : meshInverse);
+                m_skinOffsetMatrices.push_back(offset);
+
+                for (int k = 0; k < bone->mNumWeights; k++) {
+                    const aiVertexWeight& weight = bone->mWeights[k];
+                    if (weight.mVertexId >= mesh->mNumVertices)
+                        continue;
+
+                    // replaces the lightest of the four when heavier.
+                    glm::vec4& vertexWeights = weights[weight.mVertexId];
+                    int lightest = 0;
+                    for (int l = 1; l < 4; l++) {
+                        if (vertexWeights[l] < vertexWeights[lightest])
+                            lightest = l;
+                    }
+                    if (weight.mWeight > vertexWeights[lightest]) {
+                        vertexWeights[lightest] = weight.mWeight;
+                        joints[weight.mVertexId][lightest] = jointBase + j;
+                    }
+                }
+            }
+
+            for (int j = 0; j < mesh->mNumVertices; j++) {
+                float sum = weights[j].x + weights[j].y + weights[j].z + weights[j].w;
+                if (sum <= 0.0f)
+                    continue;
+
+                // rounded to 1 / 255, the heaviest takes what the rounding leaves so they still sum to 255.
+                SkinVertex& skin = m_skinVertices[vertexOffset + j];
+                int total = 0;
+                int heaviest = 0;
+                for (int k = 0; k < 4; k++) {
+                    skin.joints[k] = (uint16_t)joints[j][k];
+                    skin.weights[k] = (uint8_t)(weights[j][k] / sum * 255.0f + 0.5f);
+                    total += skin.weights[k];
+                    if (weights[j][k] > weights[j][heaviest])
+                        heaviest = k;
+                }
+                skin.weights[heaviest] = (uint8_t)(skin.weights[heaviest] + 255 - total);
+            }
+            vertexOffset += m_vertexCount[i];
+        }
+    }
+    stage.next("materials");
     if (scene->HasMaterials()) {
-        m_albedoIndex.resize(scene->mNumMaterials);
-        m_normalIndex.resize(scene->mNumMaterials);
-        m_roughMetalIndex.resize(scene->mNumMaterials);
+        m_materialCount = scene->mNumMaterials;
+        m_albedoIndex.assign(scene->mNumMaterials, -1);
+        m_normalIndex.assign(scene->mNumMaterials, -1);
+        m_roughMetalIndex.assign(scene->mNumMaterials, -1);
+        m_albedoPath.assign(scene->mNumMaterials, std::string());
         for (int i = 0; i < scene->mNumMaterials; i++) {
             aiMaterial* material = scene->mMaterials[i];
             for (int j = 0; j < material->GetTextureCount(aiTextureType_BASE_COLOR); j++) {
@@ -115,6 +368,7 @@ bool Model::create(ID3D12Device* device, ID3D12CommandQueue* queue, const char*
                 fullpath += path.C_Str();
 
                 m_albedoIndex[i] = (resMgr.createTexture(device, queue, 1, DXGI_FORMAT_R8G8B8A8_UNORM, fullpath.c_str(), true));
+                m_albedoPath[i] = fullpath;
             }
             for (int j = 0; j < material->GetTextureCount(aiTextureType_NORMALS); j++) {
                 aiString path;
@@ -139,28 +393,12 @@ bool Model::create(ID3D12Device* device, ID3D12CommandQueue* queue, const char*
 
     return true;
 }
-
-
-Node::Node() : m_parent(nullptr), m_isDirty(true) {
-
-}
-
-Node::~Node() {
-
-}
-
-void Node::dirtyUpdate() {
-    if (!m_isDirty) return;
-
-    m_localMatrix = glm::mat4(m_localRotation) * glm::translate(glm::identity<glm::mat4>(), m_localPosition);
-
-    if (m_parent != nullptr) {
-        m_worldMatrix = m_parent->worldMatrix() * m_localMatrix;
-    }
-    else {
-        m_worldMatrix = m_localMatrix;
+void Model::computeSkinMatrices(glm::mat4* result) {
+    for (size_t i = 0; i < m_skinJointNodes.size(); i++) {
+        if (m_skinJointNodes[i] < 0) {
+            result[i] = glm::mat4(1.0f);
+            continue;
+        }
+        result[i] = m_skinBindMatrices[i] * m_transforms.getWorldMatrix(m_skinJointNodes[i]) * m_skinOffsetMatrices[i];
     }
-
-    m_position = glm::vec3(m_worldMatrix[3][0], m_worldMatrix[3][1], m_worldMatrix[3][2]);
-    m_rotation = glm::quat(m_worldMatrix);
 }
\ No newline at end of file
@@ -3,14 +3,17 @@
 
 #include "../framework/device.h"
 
+#include "animation.h"
+#include "skinning.h"
+#include "transform_hierarchy.h"
+
 #include "../glm-master/glm/glm.hpp"
 #include "../glm-master/glm/gtc/matrix_transform.hpp"
 #include "../glm-master/glm/gtc/quaternion.hpp"
 
 #include <vector>
 #include <memory>
-
-class Node;
+#include <string>
 
 class Model {
 public:
@@ -32,9 +35,54 @@ public:
 
 	int materialIndex(int index) { return m_materialIndex[index]; }
 
-	int albedoIndex(int index) { return index < m_albedoIndex.size() ? m_albedoIndex[index] : 0; }
-	int normalIndex(int index) { return index < m_normalIndex.size() ? m_normalIndex[index] : 0; }
-	int roughMetalIndex(int index) { return index < m_roughMetalIndex.size() ? m_roughMetalIndex[index] : 0; }
+	// bounds of a mesh in its own space, before the instance transform. the sphere is centered on the box.
+	const glm::vec3& boundsMin(int index) { return m_boundsMin[index]; }
+	const glm::vec3& boundsMax(int index) { return m_boundsMax[index]; }
+	float boundsRadius(int index) { return m_boundsRadius[index]; }
+
+	// cpu copies of the geometry, the indices of a mesh start at its first vertex.
+	const std::vector<glm::vec3>& positions() { return m_positions; }
+	const std::vector<glm::vec3>& normals() { return m_normals; }
+	const std::vector<glm::vec2>& texcoords() { return m_texcoords; }
+	const std::vector<uint32_t>& indices() { return m_indices; }
+
+	// resource ids of the material textures, -1 when the material has none.
+	int albedoIndex(int index) { return index < m_albedoIndex.size() ? m_albedoIndex[index] : -1; }
+	int normalIndex(int index) { return index < m_normalIndex.size() ? m_normalIndex[index] : -1; }
+	int roughMetalIndex(int index) { return index < m_roughMetalIndex.size() ? m_roughMetalIndex[index] : -1; }
+	// file of the albedo texture, empty when the material has none.
+	const std::string& albedoPath(int index) { return m_albedoPath[index]; }
+
+	// the node tree of the scene, the ids in import order so every parent comes before its children.
+	TransformHierarchy& transforms() { return m_transforms; }
+	const std::string& nodeName(uint32_t node) { return m_nodeNames[node]; }
+	// the parent of every node, -1 for the root, and the local transforms of the file. the clips animate this joint array.
+	const std::vector<int32_t>& nodeParents() { return m_nodeParents; }
+	const std::vector<JointTransform>& restPose() { return m_restPose; }
+	// model space box of the meshes of a node and of everything below it, at the rest pose. min > max for a node
+	// without meshes under it.
+	const glm::vec3& nodeBoundsMin(uint32_t node) { return m_nodeBoundsMin[node]; }
+	const glm::vec3& nodeBoundsMax(uint32_t node) { return m_nodeBoundsMax[node]; }
+
+	// the joint palette of the skinned meshes and the weights of every vertex of positions(). entry 0 is the identity
+	// the vertices of rigid meshes use, the palette is only worth running when there is more.
+	bool isSkinned() { return m_skinJointNodes.size() > 1; }
+	int skinJointCount() { return (int)m_skinJointNodes.size(); }
+	const std::vector<SkinVertex>& skinVertices() { return m_skinVertices; }
+	// the palette from the world matrices of transforms(), valid after its update.
+	void computeSkinMatrices(glm::mat4* result);
+
+	int animationCount() { return (int)m_animations.size(); }
+	const AnimationClip& animation(int index) { return m_animations[index]; }
+
+	// the meshes the nodes reference, sorted by mesh so the instances of a mesh are one instanced draw.
+	int instanceCount() { return (int)m_instanceMeshes.size(); }
+	int instanceMesh(int index) { return m_instanceMeshes[index]; }
+	uint32_t instanceNode(int index) { return m_instanceNodes[index]; }
+	// model space transform of an instance.
+	const glm::mat4& instanceMatrix(int index) { return m_transforms.getWorldMatrix(m_instanceNodes[index]); }
+	int meshInstanceOffset(int mesh) { return m_meshInstanceOffset[mesh]; }
+	int meshInstanceCount(int mesh) { return m_meshInstanceCount[mesh]; }
 
 private:
 	int m_vertexBuffer;
@@ -50,48 +98,34 @@ private:
 
 	std::vector<int> m_vertexCount;
 	std::vector<int> m_indexCount;
+	std::vector<glm::vec3> m_boundsMin;
+	std::vector<glm::vec3> m_boundsMax;
+	std::vector<float> m_boundsRadius;
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_normals;
+	std::vector<glm::vec2> m_texcoords;
+	std::vector<uint32_t> m_indices;
 	std::vector<int> m_albedoIndex;
 	std::vector<int> m_normalIndex;
 	std::vector<int> m_roughMetalIndex;
-
-	std::vector<std::shared_ptr<Node>> m_nodes;
-};
-
-class Node {
-public:
-	Node();
-	~Node();
-
-	void dirtyUpdate();
-	void setParent(Node* parent) { m_parent = parent; }
-
-	glm::vec3& localPosition() { dirtyUpdate(); return m_localPosition; }
-	glm::quat& localRotation() { dirtyUpdate(); return m_localRotation; }
-
-	glm::vec3& position() { dirtyUpdate(); return m_position; }
-	glm::quat& rotation() { dirtyUpdate(); return m_rotation; }
-
-	glm::mat4& localMatrix() { dirtyUpdate(); return m_localMatrix; }
-	glm::mat4& offsetMatrix() { dirtyUpdate(); return m_offsetMatrix; }
-	glm::mat4& worldMatrix() { dirtyUpdate(); return m_worldMatrix; }
-
-	int childCount() { return m_children.size(); }
-	std::vector<std::shared_ptr<Node>>& children() { return m_children; }
-
-	void setDirty() { m_isDirty = true; for (auto& ite : m_children) ite->setDirty(); }
-
-private:
-	glm::mat4 m_localMatrix;
-	glm::mat4 m_offsetMatrix;
-	glm::mat4 m_worldMatrix;
-	glm::vec3 m_localPosition;
-	glm::quat m_localRotation;
-	glm::vec3 m_position;
-	glm::quat m_rotation;
-	Node* m_parent;
-	std::vector<std::shared_ptr<Node>> m_children;
-
-	bool m_isDirty;
+	std::vector<std::string> m_albedoPath;
+
+	TransformHierarchy m_transforms;
+	std::vector<std::string> m_nodeNames;
+	std::vector<int32_t> m_nodeParents;
+	std::vector<JointTransform> m_restPose;
+	std::vector<glm::vec3> m_nodeBoundsMin;
+	std::vector<glm::vec3> m_nodeBoundsMax;
+	std::vector<AnimationClip> m_animations;
+	// per palette entry, the joint node or -1, the inverse of the mesh instance and the inverse bind matrix.
+	std::vector<int32_t> m_skinJointNodes;
+	std::vector<glm::mat4> m_skinBindMatrices;
+	std::vector<glm::mat4> m_skinOffsetMatrices;
+	std::vector<SkinVertex> m_skinVertices;
+	std::vector<int> m_instanceMeshes;
+	std::vector<uint32_t> m_instanceNodes;
+	std::vector<int> m_meshInstanceOffset;
+	std::vector<int> m_meshInstanceCount;
 };
 
 #endif
\ No newline at end of file
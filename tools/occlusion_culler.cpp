@@ -0,0 +1,255 @@
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include <xmmintrin.h>
+
+// clip w below this counts as behind the near plane.
+static const float kMinClipW = 1e-5f;
+// bounds whose nearest depth is within this of an occluder stay visible, so occluders never hide themselves.
+static const float kDepthBias = 1e-5f;
+// pixels this far outside an edge still count as covered, so rounding never opens cracks between triangles that
+// share the edge.
+static const float kEdgeTolerance = 1e-3f;
+
+
+bool OcclusionCuller::create(uint32_t width, uint32_t height) {
+	if (width == 0 || height == 0 || width % 4 != 0 || height % kOcclusionBlockSize != 0)
+		return false;
+
+	m_width = width;
+	m_height = height;
+	m_blockCountX = (width + kOcclusionBlockSize - 1) / kOcclusionBlockSize;
+	m_blockCountY = height / kOcclusionBlockSize;
+
+	m_depth.assign((size_t)width * height, 1.0f);
+	m_hierarchy.assign((size_t)m_blockCountX * m_blockCountY, 1.0f);
+	m_bandTriangles.resize(m_blockCountY);
+
+	return true;
+}
+
+void OcclusionCuller::begin(const glm::mat4& worldViewProj) {
+	m_worldViewProj = worldViewProj;
+
+	m_triangles.clear();
+	for (auto& ite : m_bandTriangles)
+		ite.clear();
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3* positions, const uint32_t* indices, size_t indexCount) {
+	uint32_t vertexCount = 0;
+	for (size_t i = 0; i < indexCount; i++)
+		vertexCount = std::max(vertexCount, indices[i] + 1);
+
+	m_clipPositions.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		m_clipPositions[i] = m_worldViewProj * glm::vec4(positions[i], 1.0f);
+
+	const float halfWidth = m_width * 0.5f;
+	const float halfHeight = m_height * 0.5f;
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		glm::vec3 screen[3];
+		bool isClipped = false;
+		for (int j = 0; j < 3; j++) {
+			const glm::vec4& clip = m_clipPositions[indices[i + j]];
+			isClipped |= clip.w < kMinClipW;
+
+			float invW = 1.0f / clip.w;
+			screen[j] = glm::vec3((clip.x * invW + 1.0f) * halfWidth, (1.0f - clip.y * invW) * halfHeight, clip.z * invW);
+		}
+		if (isClipped)
+			continue;
+
+		Triangle triangle;
+
+		// pixel centers sit at +0.5, a pixel is covered when its center is inside the bounding box.
+		float minX = std::min({ screen[0].x, screen[1].x, screen[2].x });
+		float maxX = std::max({ screen[0].x, screen[1].x, screen[2].x });
+		float minY = std::min({ screen[0].y, screen[1].y, screen[2].y });
+		float maxY = std::max({ screen[0].y, screen[1].y, screen[2].y });
+		triangle.minX = std::max((int)std::ceil(minX - 0.5f), 0);
+		triangle.maxX = std::min((int)std::floor(maxX - 0.5f), (int)m_width - 1);
+		triangle.minY = std::max((int)std::ceil(minY - 0.5f), 0);
+		triangle.maxY = std::min((int)std::floor(maxY - 0.5f), (int)m_height - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			continue;
+
+		glm::vec3 d1 = screen[1] - screen[0];
+		glm::vec3 d2 = screen[2] - screen[0];
+		float area = d1.x * d2.y - d2.x * d1.y;
+		if (std::abs(area) < 1e-8f)
+			continue;
+
+		// occluders are drawn from both sides, the edges are flipped so the inside is positive either way.
+		float orientation = area > 0.0f ? 1.0f : -1.0f;
+		for (int j = 0; j < 3; j++) {
+			const glm::vec3& v0 = screen[j];
+			const glm::vec3& v1 = screen[(j + 1) % 3];
+			triangle.edgeA[j] = (v0.y - v1.y) * orientation;
+			triangle.edgeB[j] = (v1.x - v0.x) * orientation;
+			triangle.edgeC[j] = ((v1.y - v0.y) * v0.x - (v1.x - v0.x) * v0.y) * orientation;
+			triangle.edgeC[j] += kEdgeTolerance * (std::abs(triangle.edgeA[j]) + std::abs(triangle.edgeB[j]));
+		}
+
+		triangle.depthX = (d1.z * d2.y - d2.z * d1.y) / area;
+		triangle.depthY = (d2.z * d1.x - d1.z * d2.x) / area;
+		triangle.depthC = screen[0].z - triangle.depthX * screen[0].x - triangle.depthY * screen[0].y;
+
+		uint32_t index = (uint32_t)m_triangles.size();
+		m_triangles.push_back(triangle);
+		for (int band = triangle.minY / (int)kOcclusionBlockSize; band <= triangle.maxY / (int)kOcclusionBlockSize; band++)
+			m_bandTriangles[band].push_back(index);
+	}
+}
+
+void OcclusionCuller::rasterize(unsigned int threadCount) {
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, m_blockCountY);
+
+	std::atomic<uint32_t> nextBand(0);
+	auto worker = [&]() {
+		for (uint32_t band = nextBand++; band < m_blockCountY; band = nextBand++)
+			rasterizeBand(band);
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& ite : threads)
+		ite.join();
+}
+
+void OcclusionCuller::rasterizeBand(uint32_t band) {
+	const int bandMinY = (int)(band * kOcclusionBlockSize);
+	const int bandMaxY = bandMinY + (int)kOcclusionBlockSize - 1;
+
+	std::fill(m_depth.begin() + (size_t)bandMinY * m_width, m_depth.begin() + (size_t)(bandMaxY + 1) * m_width, 1.0f);
+
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t index : m_bandTriangles[band]) {
+		const Triangle& triangle = m_triangles[index];
+
+		__m128 edgeA[3];
+		for (int j = 0; j < 3; j++)
+			edgeA[j] = _mm_set1_ps(triangle.edgeA[j]);
+		__m128 depthX = _mm_set1_ps(triangle.depthX);
+
+		int minY = std::max(triangle.minY, bandMinY);
+		int maxY = std::min(triangle.maxY, bandMaxY);
+		int minX = triangle.minX & ~3;
+
+		for (int y = minY; y <= maxY; y++) {
+			float py = y + 0.5f;
+			__m128 edgeRow[3];
+			for (int j = 0; j < 3; j++)
+				edgeRow[j] = _mm_set1_ps(triangle.edgeB[j] * py + triangle.edgeC[j]);
+			__m128 depthRow = _mm_set1_ps(triangle.depthY * py + triangle.depthC);
+
+			float* row = m_depth.data() + (size_t)y * m_width;
+			for (int x = minX; x <= triangle.maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+
+				__m128 inside = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), edgeRow[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), edgeRow[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), edgeRow[2]), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 depth = _mm_add_ps(_mm_mul_ps(depthX, px), depthRow);
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(current, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+		}
+	}
+
+	// the farthest depth of every block of the band.
+	for (uint32_t blockX = 0; blockX < m_blockCountX; blockX++) {
+		uint32_t minX = blockX * kOcclusionBlockSize;
+		uint32_t maxX = std::min(minX + kOcclusionBlockSize, m_width);
+
+		float farthest = 0.0f;
+		for (int y = bandMinY; y <= bandMaxY; y++) {
+			const float* row = m_depth.data() + (size_t)y * m_width;
+			for (uint32_t x = minX; x < maxX; x++)
+				farthest = std::max(farthest, row[x]);
+		}
+		m_hierarchy[band * m_blockCountX + blockX] = farthest;
+	}
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+		glm::vec4 clip = m_worldViewProj * glm::vec4(corner, 1.0f);
+		if (clip.w < kMinClipW)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW + 1.0f) * m_width * 0.5f;
+		float y = (1.0f - clip.y * invW) * m_height * 0.5f;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearest = std::min(nearest, clip.z * invW);
+	}
+
+	// every pixel the projected box touches.
+	int pixelMinX = std::max((int)std::floor(minX), 0);
+	int pixelMaxX = std::min((int)std::ceil(maxX), (int)m_width - 1);
+	int pixelMinY = std::max((int)std::floor(minY), 0);
+	int pixelMaxY = std::min((int)std::ceil(maxY), (int)m_height - 1);
+	if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY)
+		return false;
+
+	nearest -= kDepthBias;
+
+	for (int blockY = pixelMinY / (int)kOcclusionBlockSize; blockY <= pixelMaxY / (int)kOcclusionBlockSize; blockY++) {
+		for (int blockX = pixelMinX / (int)kOcclusionBlockSize; blockX <= pixelMaxX / (int)kOcclusionBlockSize; blockX++) {
+			if (m_hierarchy[blockY * m_blockCountX + blockX] < nearest)
+				continue;
+
+			// the block has something behind the bounds, check its pixels inside the rectangle.
+			int minPixelX = std::max(pixelMinX, blockX * (int)kOcclusionBlockSize);
+			int maxPixelX = std::min(pixelMaxX, blockX * (int)kOcclusionBlockSize + (int)kOcclusionBlockSize - 1);
+			int minPixelY = std::max(pixelMinY, blockY * (int)kOcclusionBlockSize);
+			int maxPixelY = std::min(pixelMaxY, blockY * (int)kOcclusionBlockSize + (int)kOcclusionBlockSize - 1);
+			for (int y = minPixelY; y <= maxPixelY; y++) {
+				const float* row = m_depth.data() + (size_t)y * m_width;
+				for (int x = minPixelX; x <= maxPixelX; x++) {
+					if (row[x] >= nearest)
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+size_t OcclusionCuller::cull(const CullBounds& bounds, std::vector<uint32_t>& indices) const {
+	size_t count = 0;
+	for (uint32_t index : indices) {
+		glm::vec3 center(bounds.centerX()[index], bounds.centerY()[index], bounds.centerZ()[index]);
+		glm::vec3 extent(bounds.extentX()[index], bounds.extentY()[index], bounds.extentZ()[index]);
+
+		indices[count] = index;
+		count += isVisible(center - extent, center + extent) ? 1 : 0;
+	}
+
+	indices.resize(count);
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef _OCCLUSION_CULLER_H_
+#define _OCCLUSION_CULLER_H_
+
+#include "frustum_culler.h"
+
+#include "../glm-master/glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// pixels per side of a depth hierarchy block, also the height of the bands the rasterizer threads work on.
+static const uint32_t kOcclusionBlockSize = 8;
+
+// software occlusion culling. occluder triangles are rasterized into a low resolution depth buffer on the cpu,
+// four pixels at a time with sse, and bounds are tested against the per block maximum of that buffer before
+// falling back to the pixels. depth is clip z / w, nearer is smaller.
+//
+// the result is conservative up to the pixel: triangles with a vertex behind the near plane are not drawn, pixels
+// are covered when their center is inside an occluder or on its edge, and bounds reaching behind the near plane
+// are visible.
+class OcclusionCuller {
+public:
+	OcclusionCuller() = default;
+	~OcclusionCuller() = default;
+
+	// width must be a multiple of 4 and height a multiple of kOcclusionBlockSize.
+	bool create(uint32_t width, uint32_t height);
+
+	// starts a frame. positions and bounds are in the space the matrix transforms from.
+	void begin(const glm::mat4& worldViewProj);
+	void addOccluder(const glm::vec3* positions, const uint32_t* indices, size_t indexCount);
+	// rasterizes every occluder added since begin, bands of rows are spread over threads.
+	void rasterize(unsigned int threadCount = 0);
+
+	bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+	// removes the occluded entries from a list of indices into bounds, keeping the order.
+	size_t cull(const CullBounds& bounds, std::vector<uint32_t>& indices) const;
+
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	size_t getTriangleCount() const { return m_triangles.size(); }
+	const std::vector<float>& getDepth() const { return m_depth; }
+	const std::vector<float>& getHierarchy() const { return m_hierarchy; }
+
+private:
+	// edge functions a * x + b * y + c, positive inside, and the depth plane, all in pixels.
+	struct Triangle {
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depthX;
+		float depthY;
+		float depthC;
+		int minX;
+		int maxX;
+		int minY;
+		int maxY;
+	};
+
+	void rasterizeBand(uint32_t band);
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_blockCountX = 0;
+	uint32_t m_blockCountY = 0;
+
+	glm::mat4 m_worldViewProj;
+
+	std::vector<Triangle> m_triangles;
+	std::vector<std::vector<uint32_t>> m_bandTriangles;
+	std::vector<glm::vec4> m_clipPositions;
+
+	std::vector<float> m_depth;
+	std::vector<float> m_hierarchy;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include "reference_renderer.h"
+
+#include "batch_math.h"
+#include "material_classifier.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(_WIN32)
+#include "model.h"
+#endif
+
+
+static glm::vec3 getDebugColor(uint32_t id) {
+	uint32_t hash = id * 2654435761u;
+	return glm::vec3(hash & 0xff, (hash >> 8) & 0xff, (hash >> 16) & 0xff) / 255.0f;
+}
+
+static bool writePng(const char* filename, uint32_t width, uint32_t height, const std::vector<glm::vec4>& colors) {
+	std::vector<uint8_t> pixels((size_t)width * height * 4);
+	for (size_t i = 0; i < colors.size(); i++) {
+		glm::vec4 color = glm::clamp(colors[i], 0.0f, 1.0f);
+		for (int j = 0; j < 4; j++)
+			pixels[i * 4 + j] = (uint8_t)(color[j] * 255.0f + 0.5f);
+	}
+	return stbi_write_png(filename, (int)width, (int)height, 4, pixels.data(), (int)width * 4) != 0;
+}
+
+
+bool ReferenceRenderer::create(const ReferenceScene& scene, const std::vector<uint32_t>& closureIds, unsigned int threadCount) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t meshCount = scene.vertexCounts.size();
+	if (scene.indexCounts.size() != meshCount || scene.materialIndices.size() != meshCount ||
+		scene.instanceMatrices.size() != scene.instanceMeshes.size() ||
+		scene.normals.size() != scene.positions.size() || scene.texcoords.size() != scene.positions.size())
+		return false;
+
+	std::vector<uint32_t> indexOffsets(meshCount);
+	std::vector<uint32_t> vertexOffsets(meshCount);
+	uint32_t indexOffset = 0;
+	uint32_t vertexOffset = 0;
+	for (size_t i = 0; i < meshCount; i++) {
+		indexOffsets[i] = indexOffset;
+		vertexOffsets[i] = vertexOffset;
+		indexOffset += scene.indexCounts[i];
+		vertexOffset += scene.vertexCounts[i];
+	}
+	if (indexOffset > scene.indices.size() || vertexOffset > scene.positions.size())
+		return false;
+	m_materialIndices = scene.materialIndices;
+
+	// the bvh wants every instance in model space with indices into one vertex array, the scene keeps the meshes
+	// once with their indices per mesh. normals are transformed like vs.fx does.
+	m_positions.clear();
+	m_normals.clear();
+	m_texcoords.clear();
+	m_indices.clear();
+	m_triangleInstances.clear();
+	m_trianglePrimitives.clear();
+	m_instanceMeshes = scene.instanceMeshes;
+	for (size_t i = 0; i < scene.instanceMeshes.size(); i++) {
+		int mesh = scene.instanceMeshes[i];
+		if (mesh < 0 || mesh >= (int)meshCount)
+			return false;
+
+		const glm::mat4& matrix = scene.instanceMatrices[i];
+		glm::mat3 normalMatrix(matrix);
+		uint32_t vertexBase = (uint32_t)m_positions.size();
+		uint32_t vertexCount = scene.vertexCounts[mesh];
+
+		m_positions.resize(vertexBase + vertexCount);
+		transformPoints(matrix, scene.positions.data() + vertexOffsets[mesh], vertexCount, m_positions.data() + vertexBase);
+		for (uint32_t j = 0; j < vertexCount; j++) {
+			uint32_t vertex = vertexOffsets[mesh] + j;
+			m_normals.push_back(normalMatrix * scene.normals[vertex]);
+			m_texcoords.push_back(scene.texcoords[vertex]);
+		}
+		for (uint32_t j = 0; j < scene.indexCounts[mesh]; j++) {
+			uint32_t index = scene.indices[indexOffsets[mesh] + j];
+			if (index >= vertexCount)
+				return false;
+			m_indices.push_back(index + vertexBase);
+		}
+		for (uint32_t j = 0; j < scene.indexCounts[mesh] / 3; j++) {
+			m_triangleInstances.push_back((uint32_t)i);
+			m_trianglePrimitives.push_back(j);
+		}
+	}
+
+	if (closureIds.empty())
+		m_closureIds.assign(meshCount, 0);
+	else if (closureIds.size() == meshCount)
+		m_closureIds = closureIds;
+	else
+		return false;
+
+	m_albedoImages.clear();
+	m_albedoImages.resize(scene.albedoPaths.size());
+	for (size_t i = 0; i < scene.albedoPaths.size(); i++) {
+		const std::string& path = scene.albedoPaths[i];
+		if (path.empty())
+			continue;
+
+		int channels;
+		Image& image = m_albedoImages[i];
+		uint8_t* pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+		if (!pixels) {
+			image = Image();
+			continue;
+		}
+		image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+		stbi_image_free(pixels);
+	}
+
+	if (!m_bvh.build(m_positions.data(), m_indices.data(), (uint32_t)m_triangleInstances.size(), threadCount))
+		return false;
+
+	m_buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return true;
+}
+
+#if defined(_WIN32)
+bool ReferenceRenderer::create(Model& model, const std::vector<uint32_t>& closureIds, unsigned int threadCount) {
+	ReferenceScene scene;
+	scene.positions = model.positions();
+	scene.normals = model.normals();
+	scene.texcoords = model.texcoords();
+	scene.indices = model.indices();
+	for (int i = 0; i < model.meshCount(); i++) {
+		scene.vertexCounts.push_back((uint32_t)model.vertexCount(i));
+		scene.indexCounts.push_back((uint32_t)model.indexCount(i));
+		scene.materialIndices.push_back(model.materialIndex(i));
+	}
+	for (int i = 0; i < model.instanceCount(); i++) {
+		scene.instanceMeshes.push_back(model.instanceMesh(i));
+		scene.instanceMatrices.push_back(model.instanceMatrix(i));
+	}
+	for (int i = 0; i < model.materialCount(); i++)
+		scene.albedoPaths.push_back(model.albedoPath(i));
+
+	return create(scene, closureIds, threadCount);
+}
+#endif
+
+void ReferenceRenderer::render(const ReferenceCamera& camera, uint32_t width, uint32_t height, unsigned int threadCount) {
+	m_width = width;
+	m_height = height;
+	m_visibility.assign((size_t)width * height, glm::uvec2(0, kClosureIdMask));
+	m_color.assign((size_t)width * height, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+	glm::mat4 matrix = camera.proj * camera.view * camera.world;
+	glm::mat4 inverse = glm::inverse(matrix);
+
+	// the visibility pass culls the faces that run clockwise on screen. which way that is along the rays depends
+	// on the handedness of the x, y and w rows of the matrix.
+	glm::mat3 rows(
+		glm::vec3(matrix[0][0], matrix[0][1], matrix[0][3]),
+		glm::vec3(matrix[1][0], matrix[1][1], matrix[1][3]),
+		glm::vec3(matrix[2][0], matrix[2][1], matrix[2][3]));
+	float cullSign = glm::determinant(rows) > 0.0f ? 1.0f : -1.0f;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, height);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::atomic<uint32_t> nextRow(0);
+	auto worker = [&]() {
+		for (uint32_t y = nextRow++; y < height; y = nextRow++)
+			renderRow(camera, inverse, cullSign, y);
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& ite : threads)
+		ite.join();
+
+	m_renderTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ReferenceRenderer::renderRow(const ReferenceCamera& camera, const glm::mat4& inverse, float cullSign, uint32_t y) {
+	glm::mat3 world(camera.world);
+	glm::mat3 view(camera.view);
+	glm::mat4 worldView = camera.view * camera.world;
+	glm::vec3 viewLight = glm::normalize(view * -camera.lightDirection);
+
+	for (uint32_t x = 0; x < m_width; x++) {
+		// from the near plane, where d3d clips, to the far plane through the pixel center.
+		float ndcX = (x + 0.5f) / m_width * 2.0f - 1.0f;
+		float ndcY = 1.0f - (y + 0.5f) / m_height * 2.0f;
+		glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, 0.0f, 1.0f);
+		glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+		BvhRay ray;
+		ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+		ray.direction = glm::vec3(farPoint) / farPoint.w - ray.origin;
+		ray.tMin = 0.0f;
+		ray.tMax = 1.0f;
+
+		BvhHit hit;
+		if (!m_bvh.rayCast(ray, hit, cullSign))
+			continue;
+
+		size_t pixel = (size_t)y * m_width + x;
+		uint32_t instance = m_triangleInstances[hit.triangle];
+		int mesh = m_instanceMeshes[instance];
+		m_visibility[pixel] = glm::uvec2(m_trianglePrimitives[hit.triangle], (instance << kClosureIdBits) | m_closureIds[mesh]);
+
+		// same shading as rendering_cs.fx without normal and roughness metalness maps.
+		glm::vec3 lambda(1.0f - hit.u - hit.v, hit.u, hit.v);
+		const uint32_t* indices = m_indices.data() + (size_t)hit.triangle * 3;
+		glm::vec3 position = m_positions[indices[0]] * lambda.x + m_positions[indices[1]] * lambda.y + m_positions[indices[2]] * lambda.z;
+		glm::vec3 normal = m_normals[indices[0]] * lambda.x + m_normals[indices[1]] * lambda.y + m_normals[indices[2]] * lambda.z;
+		glm::vec2 uv = m_texcoords[indices[0]] * lambda.x + m_texcoords[indices[1]] * lambda.y + m_texcoords[indices[2]] * lambda.z;
+		normal = glm::normalize(world * normal);
+
+		glm::vec4 albedo(1.0f);
+		int material = m_materialIndices[mesh];
+		if (material >= 0 && material < (int)m_albedoImages.size() && !m_albedoImages[material].pixels.empty())
+			albedo = sample(m_albedoImages[material], uv);
+
+		const float roughness = 1.0f;
+		const float metalness = 0.0f;
+
+		glm::vec3 viewNormal = glm::normalize(view * normal);
+		glm::vec3 viewPosition = glm::vec3(worldView * glm::vec4(position, 1.0f));
+		glm::vec3 viewDirection = glm::normalize(-viewPosition);
+		glm::vec3 halfVector = glm::normalize(viewLight + viewDirection);
+
+		float diffuse = glm::clamp(glm::dot(viewNormal, viewLight), 0.0f, 1.0f) * 0.8f + 0.2f;
+		float shininess = std::exp2(10.0f * (1.0f - roughness) + 1.0f);
+		float specular = std::pow(glm::clamp(glm::dot(viewNormal, halfVector), 0.0f, 1.0f), shininess) * (1.0f - roughness);
+		glm::vec3 specularColor = glm::mix(glm::vec3(0.04f), glm::vec3(albedo), metalness);
+
+		m_color[pixel] = glm::vec4(glm::vec3(albedo) * (1.0f - metalness) * diffuse + specularColor * specular, 1.0f);
+	}
+}
+
+glm::vec4 ReferenceRenderer::sample(const Image& image, const glm::vec2& uv) const {
+	// bilinear with wrap, texel centers at +0.5.
+	float x = uv.x * image.width - 0.5f;
+	float y = uv.y * image.height - 0.5f;
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	float fractionX = x - floorX;
+	float fractionY = y - floorY;
+
+	auto wrap = [](int value, int size) { value %= size; return value < 0 ? value + size : value; };
+	int x0 = wrap((int)floorX, image.width);
+	int y0 = wrap((int)floorY, image.height);
+	int x1 = wrap(x0 + 1, image.width);
+	int y1 = wrap(y0 + 1, image.height);
+
+	auto load = [&image](int texelX, int texelY) {
+		const uint8_t* texel = image.pixels.data() + ((size_t)texelY * image.width + texelX) * 4;
+		return glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+	};
+
+	glm::vec4 top = glm::mix(load(x0, y0), load(x1, y0), fractionX);
+	glm::vec4 bottom = glm::mix(load(x0, y1), load(x1, y1), fractionX);
+	return glm::mix(top, bottom, fractionY);
+}
+
+bool ReferenceRenderer::writeVisibility(const char* filename) const {
+	std::vector<glm::vec4> colors(m_visibility.size(), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	for (size_t i = 0; i < m_visibility.size(); i++) {
+		if ((m_visibility[i].y & kClosureIdMask) == kClosureIdMask)
+			continue;
+		glm::vec3 color = getDebugColor(m_visibility[i].y >> kClosureIdBits) * 0.5f + getDebugColor(m_visibility[i].x) * 0.5f;
+		colors[i] = glm::vec4(color, 1.0f);
+	}
+	return writePng(filename, m_width, m_height, colors);
+}
+
+bool ReferenceRenderer::writeColor(const char* filename) const {
+	return writePng(filename, m_width, m_height, m_color);
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef _REFERENCE_RENDERER_H_
+#define _REFERENCE_RENDERER_H_
+
+#include "bvh.h"
+
+#include "../glm-master/glm/glm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Model;
+
+// what create needs of a Model, the meshes once with their vertices and indices one after another and the
+// instances placing them.
+struct ReferenceScene {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	// relative to the first vertex of the mesh.
+	std::vector<uint32_t> indices;
+	// per mesh.
+	std::vector<uint32_t> vertexCounts;
+	std::vector<uint32_t> indexCounts;
+	std::vector<int> materialIndices;
+	// per instance.
+	std::vector<int> instanceMeshes;
+	std::vector<glm::mat4> instanceMatrices;
+	// per material, empty without an albedo map.
+	std::vector<std::string> albedoPaths;
+};
+
+// the constants of the frame, same as MatrixBuffer of rendering_cs.fx.
+struct ReferenceCamera {
+	glm::mat4 view;
+	glm::mat4 proj;
+	glm::mat4 world;
+	glm::vec3 lightDirection;
+};
+
+// cpu reference of the visibility pass and the shading pass. casts one ray per pixel center against a TriangleBvh
+// over every instance of the model, with the near plane, the far plane and the face culling of the visibility pass, and shades the hit
+// like rendering_cs.fx with only the albedo map. the visibility texels use the same packing as the gpu, the colors
+// differ where the gpu filters the textures, the albedo is sampled bilinearly from the top mip.
+class ReferenceRenderer {
+public:
+	ReferenceRenderer() = default;
+	~ReferenceRenderer() = default;
+
+	// closureIds holds one closure id per mesh, empty for all zero.
+	bool create(const ReferenceScene& scene, const std::vector<uint32_t>& closureIds, unsigned int threadCount = 0);
+#if defined(_WIN32)
+	bool create(Model& model, const std::vector<uint32_t>& closureIds, unsigned int threadCount = 0);
+#endif
+
+	// rows are spread over the threads, 0 picks the hardware concurrency.
+	void render(const ReferenceCamera& camera, uint32_t width, uint32_t height, unsigned int threadCount = 0);
+
+	// visibility as debug colors like VISIBILITY_DEBUG of rendering_cs.fx.
+	bool writeVisibility(const char* filename) const;
+	bool writeColor(const char* filename) const;
+
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	// x is the primitive id, y (instance id << kClosureIdBits) | closure id, background has kClosureIdMask.
+	const std::vector<glm::uvec2>& getVisibility() const { return m_visibility; }
+	const std::vector<glm::vec4>& getColor() const { return m_color; }
+
+	double getBuildTime() const { return m_buildTime; }
+	double getRenderTime() const { return m_renderTime; }
+	double getRaysPerSecond() const { return m_renderTime > 0.0 ? m_width * m_height / (m_renderTime * 0.001) : 0.0; }
+
+private:
+	struct Image {
+		int width = 0;
+		int height = 0;
+		std::vector<uint8_t> pixels;
+	};
+
+	void renderRow(const ReferenceCamera& camera, const glm::mat4& inverse, float cullSign, uint32_t y);
+	glm::vec4 sample(const Image& image, const glm::vec2& uv) const;
+
+	TriangleBvh m_bvh;
+
+	// the instances in model space.
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_normals;
+	std::vector<glm::vec2> m_texcoords;
+	std::vector<uint32_t> m_indices;
+	// per triangle of m_indices.
+	std::vector<uint32_t> m_triangleInstances;
+	std::vector<uint32_t> m_trianglePrimitives;
+	// per instance.
+	std::vector<int> m_instanceMeshes;
+	// per mesh.
+	std::vector<uint32_t> m_closureIds;
+	std::vector<int> m_materialIndices;
+	// per material, empty without an albedo map.
+	std::vector<Image> m_albedoImages;
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	std::vector<glm::uvec2> m_visibility;
+	std::vector<glm::vec4> m_color;
+
+	double m_buildTime = 0.0;
+	double m_renderTime = 0.0;
+};
+
+#endif
\ No newline at end of file
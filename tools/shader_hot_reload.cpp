@@ -0,0 +1,240 @@
+#include "shader_hot_reload.h"
+
+#include "../framework/render_device.h"
+
+#include <algorithm>
+#include <string>
+
+
+namespace {
+
+// editors write a file in several steps, so compiling waits until the directory has been quiet for a moment.
+const std::chrono::milliseconds kSettleTime(100);
+const std::chrono::milliseconds kPollInterval(50);
+
+}
+
+
+std::vector<std::filesystem::path> ShaderCompiler::getDependencies(const std::filesystem::path& filename) {
+	std::vector<std::filesystem::path> files;
+	if (!ShaderCache::collectIncludes(filename, files) && files.empty())
+		files.push_back(filename);
+	return files;
+}
+
+
+bool ShaderHotReload::create(const std::filesystem::path& directory) {
+	destroy();
+
+	m_directory = normalize(directory);
+	if (!m_watcher.create(directory)) {
+		logRenderError("shader hot reload: failed watching the shader directory.\n");
+		return false;
+	}
+
+	m_isRunning = true;
+	m_thread = std::thread([this]() { threadMain(); });
+
+	return true;
+}
+
+void ShaderHotReload::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isRunning = false;
+	}
+	m_condition.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	m_watcher.destroy();
+}
+
+int ShaderHotReload::addShader(const ShaderSource& source) {
+	std::vector<std::filesystem::path> dependencies = collectDependencies(source.filename);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	int handle = (int)m_shaders.size();
+	for (auto& ite : dependencies)
+		m_dependents[ite].push_back(handle);
+
+	m_shaders.push_back({ source, dependencies });
+
+	return handle;
+}
+
+void ShaderHotReload::addPipeline(const std::vector<int>& shaders, RebuildFunction rebuild) {
+	m_pipelines.push_back({ shaders, rebuild });
+}
+
+std::vector<std::filesystem::path> ShaderHotReload::getDependencies(int handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_shaders[handle].dependencies;
+}
+
+void ShaderHotReload::notifyChanged(const std::vector<std::filesystem::path>& files) {
+	if (files.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& ite : files)
+		m_pendingFiles.push_back(normalize(ite));
+	m_lastChange = std::chrono::steady_clock::now();
+}
+
+size_t ShaderHotReload::compilePending() {
+	std::vector<int> handles;
+	std::vector<ShaderSource> sources;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto& file : m_pendingFiles) {
+			// the watched directory itself is reported when the change list overflowed.
+			if (!m_directory.empty() && file == m_directory) {
+				for (int i = 0; i < (int)m_shaders.size(); i++)
+					handles.push_back(i);
+				continue;
+			}
+
+			auto ite = m_dependents.find(file);
+			if (ite != m_dependents.end())
+				handles.insert(handles.end(), ite->second.begin(), ite->second.end());
+		}
+		m_pendingFiles.clear();
+
+		std::sort(handles.begin(), handles.end());
+		handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+
+		for (auto& ite : handles)
+			sources.push_back(m_shaders[ite].source);
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < handles.size(); i++) {
+		if (!m_compiler->compile(handles[i], sources[i])) {
+			logRenderError("shader hot reload: compile failed, keeping the previous shader.\n");
+			continue;
+		}
+
+		std::vector<std::filesystem::path> dependencies = collectDependencies(sources[i].filename);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_compiled.push_back({ handles[i], dependencies });
+		}
+		count++;
+	}
+
+	return count;
+}
+
+size_t ShaderHotReload::update(uint64_t nextFenceValue, uint64_t completedFenceValue) {
+	std::vector<CompiledShader> compiled;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		compiled.swap(m_compiled);
+
+		for (auto& ite : compiled) {
+			ShaderEntry& entry = m_shaders[ite.handle];
+
+			// includes may have been added or removed by the edit.
+			for (auto& file : entry.dependencies) {
+				auto& dependents = m_dependents[file];
+				dependents.erase(std::remove(dependents.begin(), dependents.end(), ite.handle), dependents.end());
+				if (dependents.empty())
+					m_dependents.erase(file);
+			}
+			for (auto& file : ite.dependencies)
+				m_dependents[file].push_back(ite.handle);
+
+			entry.dependencies = ite.dependencies;
+		}
+	}
+
+	// the rebuilds below read the new shaders.
+	for (auto& ite : compiled)
+		m_compiler->commit(ite.handle);
+
+	m_retireFenceValue = nextFenceValue;
+
+	size_t rebuildCount = 0;
+	for (auto& pipeline : m_pipelines) {
+		bool isDirty = false;
+		for (auto& ite : compiled) {
+			if (std::find(pipeline.shaders.begin(), pipeline.shaders.end(), ite.handle) != pipeline.shaders.end()) {
+				isDirty = true;
+				break;
+			}
+		}
+		if (!isDirty)
+			continue;
+
+		if (pipeline.rebuild()) {
+			rebuildCount++;
+		}
+		else {
+			logRenderError("shader hot reload: failed rebuilding a pipeline, keeping the previous one.\n");
+		}
+	}
+
+	m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+		[completedFenceValue](const RetiredObject& retired) { return retired.fenceValue <= completedFenceValue; }),
+		m_retired.end());
+
+	return rebuildCount;
+}
+
+void ShaderHotReload::retire(std::shared_ptr<void> object) {
+	if (!object)
+		return;
+
+	m_retired.push_back({ m_retireFenceValue, std::move(object) });
+}
+
+#if defined(_WIN32)
+void ShaderHotReload::retire(IUnknown* object) {
+	if (object == nullptr)
+		return;
+
+	object->AddRef();
+	retire(std::shared_ptr<void>(object, [](void* object) { static_cast<IUnknown*>(object)->Release(); }));
+}
+#endif
+
+void ShaderHotReload::threadMain() {
+	std::vector<std::filesystem::path> changedFiles;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_isRunning) {
+		m_condition.wait_for(lock, kPollInterval);
+		if (!m_isRunning)
+			break;
+
+		bool hasPending = !m_pendingFiles.empty();
+		auto lastChange = m_lastChange;
+		lock.unlock();
+
+		changedFiles.clear();
+		m_watcher.poll(changedFiles);
+		notifyChanged(changedFiles);
+
+		if (changedFiles.empty() && hasPending && std::chrono::steady_clock::now() - lastChange >= kSettleTime)
+			compilePending();
+
+		lock.lock();
+	}
+}
+
+std::filesystem::path ShaderHotReload::normalize(const std::filesystem::path& path) {
+	std::error_code ec;
+	std::filesystem::path result = std::filesystem::weakly_canonical(path, ec);
+	return ec ? path.lexically_normal() : result;
+}
+
+std::vector<std::filesystem::path> ShaderHotReload::collectDependencies(const std::filesystem::path& filename) {
+	std::vector<std::filesystem::path> files = m_compiler->getDependencies(filename);
+	for (auto& ite : files)
+		ite = normalize(ite);
+	return files;
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#ifndef _SHADER_HOT_RELOAD_H_
+#define _SHADER_HOT_RELOAD_H_
+
+#include "../framework/file_watcher.h"
+#include "../framework/shader_cache.h"
+
+#if defined(_WIN32)
+#include <unknwn.h>
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ShaderSource {
+	std::filesystem::path filename;
+	std::wstring entryPoint;
+	std::wstring profile;
+	std::vector<ShaderDefine> defines;
+};
+
+// compiles the shaders of a ShaderHotReload and owns them. DxcShaderCompiler in the app.
+class ShaderCompiler {
+public:
+	virtual ~ShaderCompiler() = default;
+
+	// called on the compile thread. the new shader is kept aside until commit, false when compiling failed, in which
+	// case the current shader stays in use.
+	virtual bool compile(int handle, const ShaderSource& source) = 0;
+	// called on the render thread before the pipelines that use handle are rebuilt, the shader compiled last becomes
+	// the current one.
+	virtual void commit(int handle) = 0;
+
+	// the source followed by every file it includes, read from disk by default.
+	virtual std::vector<std::filesystem::path> getDependencies(const std::filesystem::path& filename);
+};
+
+// recompiles shaders whose source or includes changed on a background thread and rebuilds the pipelines that use them
+// between frames. the previous pipeline objects are kept alive until the gpu has passed the fence of the swap.
+class ShaderHotReload {
+public:
+	// builds the new pipeline, retires the old object and swaps it in. the pipeline is left untouched on failure.
+	using RebuildFunction = std::function<bool()>;
+
+	ShaderHotReload() = default;
+	~ShaderHotReload() { destroy(); }
+
+	ShaderHotReload(const ShaderHotReload&) = delete;
+	ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+	// set before the first addShader.
+	void setCompiler(ShaderCompiler* compiler) { m_compiler = compiler; }
+
+	// watches directory and starts the compile thread. changes can also be pushed with notifyChanged.
+	bool create(const std::filesystem::path& directory);
+	void destroy();
+
+	// the handle the compiler gets the shader back with.
+	int addShader(const ShaderSource& source);
+	void addPipeline(const std::vector<int>& shaders, RebuildFunction rebuild);
+
+	void notifyChanged(const std::vector<std::filesystem::path>& files);
+	// compiles every shader reached by the changes notified so far on the calling thread. returns the compiled count.
+	size_t compilePending();
+
+	// call on the render thread while no command list is being recorded. nextFenceValue is the fence value that
+	// will be signaled after the work already submitted, completedFenceValue the value the gpu has reached.
+	// returns the number of pipelines rebuilt.
+	size_t update(uint64_t nextFenceValue, uint64_t completedFenceValue);
+
+	// keeps object alive until the gpu has passed the fence of the swap. only valid from a RebuildFunction.
+	void retire(std::shared_ptr<void> object);
+#if defined(_WIN32)
+	void retire(IUnknown* object);
+#endif
+
+	size_t getRetiredCount() { return m_retired.size(); }
+	std::vector<std::filesystem::path> getDependencies(int handle);
+
+private:
+	struct ShaderEntry {
+		ShaderSource source;
+		std::vector<std::filesystem::path> dependencies;
+	};
+
+	struct PipelineEntry {
+		std::vector<int> shaders;
+		RebuildFunction rebuild;
+	};
+
+	struct CompiledShader {
+		int handle;
+		std::vector<std::filesystem::path> dependencies;
+	};
+
+	struct RetiredObject {
+		uint64_t fenceValue;
+		std::shared_ptr<void> object;
+	};
+
+	void threadMain();
+	static std::filesystem::path normalize(const std::filesystem::path& path);
+	std::vector<std::filesystem::path> collectDependencies(const std::filesystem::path& filename);
+
+	ShaderCompiler* m_compiler = nullptr;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::thread m_thread;
+	bool m_isRunning = false;
+
+	FileWatcher m_watcher;
+	std::filesystem::path m_directory;
+
+	std::vector<ShaderEntry> m_shaders;
+	// file -> handles of the shaders that include it.
+	std::map<std::filesystem::path, std::vector<int>> m_dependents;
+	std::vector<std::filesystem::path> m_pendingFiles;
+	std::chrono::steady_clock::time_point m_lastChange;
+	std::vector<CompiledShader> m_compiled;
+
+	// touched from the render thread only.
+	std::vector<PipelineEntry> m_pipelines;
+	std::vector<RetiredObject> m_retired;
+	uint64_t m_retireFenceValue = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "skinning.h"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+
+
+static const float kWeightScale = 1.0f / 255.0f;
+
+// the palette matrix weighted and summed per column.
+static inline void blendMatrix(const SkinVertex& skin, const glm::mat4* matrices, __m128* columns) {
+	for (int i = 0; i < 4; i++)
+		columns[i] = _mm_setzero_ps();
+
+	for (int j = 0; j < 4; j++) {
+		if (skin.weights[j] == 0)
+			continue;
+
+		__m128 weight = _mm_set1_ps(skin.weights[j] * kWeightScale);
+		const float* matrix = &matrices[skin.joints[j]][0][0];
+		for (int i = 0; i < 4; i++)
+			columns[i] = _mm_add_ps(columns[i], _mm_mul_ps(_mm_loadu_ps(matrix + i * 4), weight));
+	}
+}
+
+static inline __m128 transformPoint(const __m128* columns, const glm::vec3& point) {
+	__m128 result = _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(point.x)), columns[3]);
+	result = _mm_add_ps(result, _mm_mul_ps(columns[1], _mm_set1_ps(point.y)));
+	return _mm_add_ps(result, _mm_mul_ps(columns[2], _mm_set1_ps(point.z)));
+}
+
+static inline __m128 transformVector(const __m128* columns, const glm::vec3& vector) {
+	__m128 result = _mm_mul_ps(columns[0], _mm_set1_ps(vector.x));
+	result = _mm_add_ps(result, _mm_mul_ps(columns[1], _mm_set1_ps(vector.y)));
+	return _mm_add_ps(result, _mm_mul_ps(columns[2], _mm_set1_ps(vector.z)));
+}
+
+static inline glm::vec3 storeVector(__m128 value) {
+	float values[4];
+	_mm_storeu_ps(values, value);
+	return glm::vec3(values[0], values[1], values[2]);
+}
+
+static inline glm::vec3 normalizeVector(__m128 value) {
+	glm::vec3 vector = storeVector(value);
+	float length = glm::length(vector);
+	return length > 0.0f ? vector / length : vector;
+}
+
+// x, y, z, w whatever order glm stores them in.
+static inline __m128 loadQuaternion(const glm::quat& quaternion) {
+	return _mm_setr_ps(quaternion.x, quaternion.y, quaternion.z, quaternion.w);
+}
+
+static void storeBounds(__m128 boundsMin, __m128 boundsMax, glm::vec3* resultMin, glm::vec3* resultMax) {
+	if (resultMin)
+		*resultMin = storeVector(boundsMin);
+	if (resultMax)
+		*resultMax = storeVector(boundsMax);
+}
+
+
+void skinLinear(const glm::vec3* positions, const glm::vec3* normals, const SkinVertex* skin, uint32_t count,
+	const glm::mat4* matrices, glm::vec3* skinnedPositions, glm::vec3* skinnedNormals, glm::vec3* boundsMin, glm::vec3* boundsMax) {
+	__m128 minimum = _mm_set1_ps(FLT_MAX);
+	__m128 maximum = _mm_set1_ps(-FLT_MAX);
+
+	uint32_t i = 0;
+#if defined(__AVX__)
+	// the columns of two vertices share a register, the lower half is the first vertex.
+	for (; i + 2 <= count; i += 2) {
+		__m256 columns[4];
+		for (int k = 0; k < 4; k++)
+			columns[k] = _mm256_setzero_ps();
+
+		for (int j = 0; j < 4; j++) {
+			const SkinVertex& first = skin[i];
+			const SkinVertex& second = skin[i + 1];
+			if ((first.weights[j] | second.weights[j]) == 0)
+				continue;
+
+			__m256 weight = _mm256_setr_m128(_mm_set1_ps(first.weights[j] * kWeightScale), _mm_set1_ps(second.weights[j] * kWeightScale));
+			const float* firstMatrix = &matrices[first.joints[j]][0][0];
+			const float* secondMatrix = &matrices[second.joints[j]][0][0];
+			for (int k = 0; k < 4; k++) {
+				__m256 column = _mm256_loadu2_m128(secondMatrix + k * 4, firstMatrix + k * 4);
+				columns[k] = _mm256_add_ps(columns[k], _mm256_mul_ps(column, weight));
+			}
+		}
+
+		auto splat = [](float first, float second) { return _mm256_setr_m128(_mm_set1_ps(first), _mm_set1_ps(second)); };
+		const glm::vec3& p0 = positions[i];
+		const glm::vec3& p1 = positions[i + 1];
+		__m256 position = _mm256_add_ps(_mm256_mul_ps(columns[0], splat(p0.x, p1.x)), columns[3]);
+		position = _mm256_add_ps(position, _mm256_mul_ps(columns[1], splat(p0.y, p1.y)));
+		position = _mm256_add_ps(position, _mm256_mul_ps(columns[2], splat(p0.z, p1.z)));
+
+		const glm::vec3& n0 = normals[i];
+		const glm::vec3& n1 = normals[i + 1];
+		__m256 normal = _mm256_mul_ps(columns[0], splat(n0.x, n1.x));
+		normal = _mm256_add_ps(normal, _mm256_mul_ps(columns[1], splat(n0.y, n1.y)));
+		normal = _mm256_add_ps(normal, _mm256_mul_ps(columns[2], splat(n0.z, n1.z)));
+
+		__m128 firstPosition = _mm256_castps256_ps128(position);
+		__m128 secondPosition = _mm256_extractf128_ps(position, 1);
+		minimum = _mm_min_ps(minimum, _mm_min_ps(firstPosition, secondPosition));
+		maximum = _mm_max_ps(maximum, _mm_max_ps(firstPosition, secondPosition));
+
+		skinnedPositions[i] = storeVector(firstPosition);
+		skinnedPositions[i + 1] = storeVector(secondPosition);
+		skinnedNormals[i] = normalizeVector(_mm256_castps256_ps128(normal));
+		skinnedNormals[i + 1] = normalizeVector(_mm256_extractf128_ps(normal, 1));
+	}
+#endif
+
+	for (; i < count; i++) {
+		__m128 columns[4];
+		blendMatrix(skin[i], matrices, columns);
+
+		__m128 position = transformPoint(columns, positions[i]);
+		minimum = _mm_min_ps(minimum, position);
+		maximum = _mm_max_ps(maximum, position);
+
+		skinnedPositions[i] = storeVector(position);
+		skinnedNormals[i] = normalizeVector(transformVector(columns, normals[i]));
+	}
+
+	storeBounds(minimum, maximum, boundsMin, boundsMax);
+}
+
+void skinDualQuaternion(const glm::vec3* positions, const glm::vec3* normals, const SkinVertex* skin, uint32_t count,
+	const DualQuaternion* dualQuaternions, glm::vec3* skinnedPositions, glm::vec3* skinnedNormals, glm::vec3* boundsMin, glm::vec3* boundsMax) {
+	__m128 minimum = _mm_set1_ps(FLT_MAX);
+	__m128 maximum = _mm_set1_ps(-FLT_MAX);
+
+	for (uint32_t i = 0; i < count; i++) {
+		// q and -q are the same rotation, every joint is blended on the side of the first one.
+		__m128 firstReal = loadQuaternion(dualQuaternions[skin[i].joints[0]].real);
+		__m128 real = _mm_setzero_ps();
+		__m128 dual = _mm_setzero_ps();
+		for (int j = 0; j < 4; j++) {
+			if (skin[i].weights[j] == 0)
+				continue;
+
+			const DualQuaternion& joint = dualQuaternions[skin[i].joints[j]];
+			__m128 jointReal = loadQuaternion(joint.real);
+			__m128 product = _mm_mul_ps(jointReal, firstReal);
+			product = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+			product = _mm_add_ss(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 0, 3, 2)));
+			float weight = skin[i].weights[j] * kWeightScale;
+			if (_mm_cvtss_f32(product) < 0.0f)
+				weight = -weight;
+
+			__m128 weights = _mm_set1_ps(weight);
+			real = _mm_add_ps(real, _mm_mul_ps(jointReal, weights));
+			dual = _mm_add_ps(dual, _mm_mul_ps(loadQuaternion(joint.dual), weights));
+		}
+
+		float values[8];
+		_mm_storeu_ps(values, real);
+		_mm_storeu_ps(values + 4, dual);
+		glm::quat r(values[3], values[0], values[1], values[2]);
+		glm::quat d(values[7], values[4], values[5], values[6]);
+		float length = glm::length(r);
+		if (length > 0.0f) {
+			r = r / length;
+			d = d / length;
+		}
+
+		// p' = p + 2 r.xyz x (r.xyz x p + r.w p) + 2 (r.w d.xyz - d.w r.xyz + r.xyz x d.xyz).
+		glm::vec3 axis(r.x, r.y, r.z);
+		glm::vec3 dualAxis(d.x, d.y, d.z);
+		glm::vec3 translation = 2.0f * (r.w * dualAxis - d.w * axis + glm::cross(axis, dualAxis));
+
+		const glm::vec3& position = positions[i];
+		glm::vec3 skinned = position + 2.0f * glm::cross(axis, glm::cross(axis, position) + r.w * position) + translation;
+		const glm::vec3& normal = normals[i];
+		glm::vec3 skinnedNormal = normal + 2.0f * glm::cross(axis, glm::cross(axis, normal) + r.w * normal);
+
+		__m128 point = _mm_setr_ps(skinned.x, skinned.y, skinned.z, 0.0f);
+		minimum = _mm_min_ps(minimum, point);
+		maximum = _mm_max_ps(maximum, point);
+
+		skinnedPositions[i] = skinned;
+		skinnedNormals[i] = glm::normalize(skinnedNormal);
+	}
+
+	storeBounds(minimum, maximum, boundsMin, boundsMax);
+}
+
+void computeDualQuaternions(const glm::mat4* matrices, uint32_t count, DualQuaternion* result) {
+	for (uint32_t i = 0; i < count; i++) {
+		glm::mat3 rotation(matrices[i]);
+		for (int j = 0; j < 3; j++) {
+			float length = glm::length(rotation[j]);
+			if (length > 0.0f)
+				rotation[j] /= length;
+		}
+
+		glm::quat real = glm::normalize(glm::quat_cast(rotation));
+		glm::vec3 translation(matrices[i][3]);
+		result[i].real = real;
+		result[i].dual = glm::quat(0.0f, translation.x, translation.y, translation.z) * real * 0.5f;
+	}
+}
\ No newline at end of file
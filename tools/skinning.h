@@ -0,0 +1,40 @@
+#ifndef _SKINNING_H_
+#define _SKINNING_H_
+
+#include "../glm-master/glm/glm.hpp"
+#include "../glm-master/glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+
+// same as SKINNING_THREAD_COUNT of skinning_cs.fx.
+static const uint32_t kSkinningThreadCount = 64;
+
+// same layout as SkinVertex of skinning_cs.fx. four joints of the palette and their weights in 1 / 255, the weights
+// of a vertex sum to 255.
+struct SkinVertex {
+	uint16_t joints[4];
+	uint8_t weights[4];
+};
+
+// rotation and translation of a skin matrix, the scale is dropped.
+struct DualQuaternion {
+	glm::quat real;
+	glm::quat dual;
+};
+
+// linear blend skinning of count vertices by the palette matrices, the blended matrix is built and applied with sse
+// for one vertex or with avx for two at a time. the normals are transformed without the inverse transpose like vs.fx
+// does and normalized. boundsMin and boundsMax get the box of the skinned positions when they are not null.
+void skinLinear(const glm::vec3* positions, const glm::vec3* normals, const SkinVertex* skin, uint32_t count,
+	const glm::mat4* matrices, glm::vec3* skinnedPositions, glm::vec3* skinnedNormals,
+	glm::vec3* boundsMin = nullptr, glm::vec3* boundsMax = nullptr);
+
+// dual quaternion skinning, keeps the volume at twisting joints where the linear blend collapses. ignores the scale of
+// the matrices.
+void skinDualQuaternion(const glm::vec3* positions, const glm::vec3* normals, const SkinVertex* skin, uint32_t count,
+	const DualQuaternion* dualQuaternions, glm::vec3* skinnedPositions, glm::vec3* skinnedNormals,
+	glm::vec3* boundsMin = nullptr, glm::vec3* boundsMax = nullptr);
+
+void computeDualQuaternions(const glm::mat4* matrices, uint32_t count, DualQuaternion* result);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,6 @@
+// the implementations of the stb headers, for the textures of the app and the png output of the tools.
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "stb_image.h"
+#include "stb_image_write.h"
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "transform_hierarchy.h"
+
+#include <atomic>
+#include <cfloat>
+#include <thread>
+
+#include <xmmintrin.h>
+
+
+bool TransformHierarchy::create(const int32_t* parents, uint32_t count) {
+	m_slots.clear();
+	m_order.clear();
+	m_parents.clear();
+	m_subtreeSizes.clear();
+
+	// children of every node in id order, as offsets into one array.
+	std::vector<uint32_t> childOffsets(count + 1, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		if (parents[i] < -1 || parents[i] >= (int32_t)count || parents[i] == (int32_t)i)
+			return false;
+		if (parents[i] >= 0)
+			childOffsets[parents[i] + 1]++;
+	}
+	for (uint32_t i = 0; i < count; i++)
+		childOffsets[i + 1] += childOffsets[i];
+
+	std::vector<uint32_t> children(childOffsets[count]);
+	std::vector<uint32_t> childCounts(count, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		if (parents[i] >= 0)
+			children[childOffsets[parents[i]] + childCounts[parents[i]]++] = i;
+	}
+
+	// depth first, the first child right after its parent.
+	m_order.reserve(count);
+	std::vector<uint32_t> stack;
+	for (uint32_t i = 0; i < count; i++) {
+		if (parents[i] >= 0)
+			continue;
+
+		stack.push_back(i);
+		while (!stack.empty()) {
+			uint32_t node = stack.back();
+			stack.pop_back();
+			m_order.push_back(node);
+			for (uint32_t j = childOffsets[node + 1]; j > childOffsets[node]; j--)
+				stack.push_back(children[j - 1]);
+		}
+	}
+
+	// nodes on a cycle are never reached from a root.
+	if (m_order.size() != count) {
+		m_order.clear();
+		return false;
+	}
+
+	m_slots.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		m_slots[m_order[i]] = i;
+
+	m_parents.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		m_parents[i] = parents[m_order[i]] < 0 ? -1 : (int32_t)m_slots[parents[m_order[i]]];
+
+	m_subtreeSizes.assign(count, 1);
+	for (uint32_t i = count; i-- > 0;) {
+		if (m_parents[i] >= 0)
+			m_subtreeSizes[m_parents[i]] += m_subtreeSizes[i];
+	}
+
+	m_positionX.assign(count, 0.0f);
+	m_positionY.assign(count, 0.0f);
+	m_positionZ.assign(count, 0.0f);
+	m_rotationX.assign(count, 0.0f);
+	m_rotationY.assign(count, 0.0f);
+	m_rotationZ.assign(count, 0.0f);
+	m_rotationW.assign(count, 1.0f);
+	m_scaleX.assign(count, 1.0f);
+	m_scaleY.assign(count, 1.0f);
+	m_scaleZ.assign(count, 1.0f);
+	m_localMatrices.assign(count, glm::mat4(1.0f));
+	m_worldMatrices.assign(count, glm::mat4(1.0f));
+	m_dirty.assign(count, 1);
+	m_firstDirty = 0;
+
+	buildTasks();
+
+	return true;
+}
+
+void TransformHierarchy::buildTasks() {
+	m_tasks.clear();
+	m_serialSlots.clear();
+
+	// a subtree small enough becomes a task and is skipped as a whole, a larger one keeps its root on the calling
+	// thread and is split at its children.
+	uint32_t count = (uint32_t)m_order.size();
+	for (uint32_t i = 0; i < count;) {
+		uint32_t size = m_subtreeSizes[i];
+		if (size > kTransformTaskSize) {
+			m_serialSlots.push_back(i);
+			i++;
+			continue;
+		}
+
+		if (!m_tasks.empty() && m_tasks.back().end == i && m_tasks.back().end - m_tasks.back().begin + size <= kTransformTaskSize)
+			m_tasks.back().end += size;
+		else
+			m_tasks.push_back({ i, i + size });
+		i += size;
+	}
+}
+
+void TransformHierarchy::setLocalPosition(uint32_t node, const glm::vec3& position) {
+	uint32_t slot = m_slots[node];
+	m_positionX[slot] = position.x;
+	m_positionY[slot] = position.y;
+	m_positionZ[slot] = position.z;
+	markDirty(slot);
+}
+
+void TransformHierarchy::setLocalRotation(uint32_t node, const glm::quat& rotation) {
+	uint32_t slot = m_slots[node];
+	m_rotationX[slot] = rotation.x;
+	m_rotationY[slot] = rotation.y;
+	m_rotationZ[slot] = rotation.z;
+	m_rotationW[slot] = rotation.w;
+	markDirty(slot);
+}
+
+void TransformHierarchy::setLocalScale(uint32_t node, const glm::vec3& scale) {
+	uint32_t slot = m_slots[node];
+	m_scaleX[slot] = scale.x;
+	m_scaleY[slot] = scale.y;
+	m_scaleZ[slot] = scale.z;
+	markDirty(slot);
+}
+
+glm::vec3 TransformHierarchy::getLocalPosition(uint32_t node) const {
+	uint32_t slot = m_slots[node];
+	return glm::vec3(m_positionX[slot], m_positionY[slot], m_positionZ[slot]);
+}
+
+glm::quat TransformHierarchy::getLocalRotation(uint32_t node) const {
+	uint32_t slot = m_slots[node];
+	return glm::quat(m_rotationW[slot], m_rotationX[slot], m_rotationY[slot], m_rotationZ[slot]);
+}
+
+glm::vec3 TransformHierarchy::getLocalScale(uint32_t node) const {
+	uint32_t slot = m_slots[node];
+	return glm::vec3(m_scaleX[slot], m_scaleY[slot], m_scaleZ[slot]);
+}
+
+glm::quat TransformHierarchy::getWorldRotation(uint32_t node) const {
+	glm::mat3 matrix(getWorldMatrix(node));
+	return glm::quat_cast(glm::mat3(glm::normalize(matrix[0]), glm::normalize(matrix[1]), glm::normalize(matrix[2])));
+}
+
+void TransformHierarchy::computeSubtreeBounds(const glm::vec3* localMin, const glm::vec3* localMax, glm::vec3* resultMin,
+	glm::vec3* resultMax) const {
+	for (uint32_t node = 0; node < getNodeCount(); node++) {
+		resultMin[node] = glm::vec3(FLT_MAX);
+		resultMax[node] = glm::vec3(-FLT_MAX);
+		if (localMin[node].x > localMax[node].x || localMin[node].y > localMax[node].y || localMin[node].z > localMax[node].z)
+			continue;
+
+		// the box of the transformed center and the extent projected on every axis.
+		const glm::mat4& matrix = getWorldMatrix(node);
+		glm::vec3 center = glm::vec3(matrix * glm::vec4((localMin[node] + localMax[node]) * 0.5f, 1.0f));
+		glm::vec3 extent = (localMax[node] - localMin[node]) * 0.5f;
+		glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * extent.x + glm::abs(glm::vec3(matrix[1])) * extent.y +
+			glm::abs(glm::vec3(matrix[2])) * extent.z;
+		resultMin[node] = center - worldExtent;
+		resultMax[node] = center + worldExtent;
+	}
+
+	// children come after their parents in storage order.
+	for (uint32_t slot = (uint32_t)m_order.size(); slot-- > 0; ) {
+		if (m_parents[slot] < 0)
+			continue;
+		uint32_t node = m_order[slot];
+		uint32_t parent = m_order[m_parents[slot]];
+		resultMin[parent] = glm::min(resultMin[parent], resultMin[node]);
+		resultMax[parent] = glm::max(resultMax[parent], resultMax[node]);
+	}
+}
+
+void TransformHierarchy::update(unsigned int threadCount) {
+	uint32_t count = (uint32_t)m_order.size();
+	if (m_firstDirty >= count)
+		return;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	if (threadCount == 1 || count - m_firstDirty <= kTransformTaskSize) {
+		updateRange(m_firstDirty, count);
+	}
+	else {
+		for (uint32_t slot : m_serialSlots) {
+			if (slot >= m_firstDirty)
+				updateRange(slot, slot + 1);
+		}
+
+		// the tasks ending before the first dirty slot have nothing to do.
+		uint32_t firstTask = 0;
+		while (firstTask < m_tasks.size() && m_tasks[firstTask].end <= m_firstDirty)
+			firstTask++;
+
+		std::atomic<uint32_t> nextTask(firstTask);
+		auto worker = [&]() {
+			for (uint32_t i = nextTask++; i < m_tasks.size(); i = nextTask++)
+				updateRange(std::max(m_tasks[i].begin, m_firstDirty), m_tasks[i].end);
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min(threadCount, (unsigned int)(m_tasks.size() - firstTask)); i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto& ite : threads)
+			ite.join();
+	}
+
+	std::fill(m_dirty.begin() + m_firstDirty, m_dirty.end(), 0);
+	m_firstDirty = count;
+}
+
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end) {
+	// parents come first, so one pass carries the flags down any depth.
+	for (uint32_t i = begin; i < end; i++) {
+		int32_t parent = m_parents[i];
+		if (parent >= 0 && m_dirty[parent])
+			m_dirty[i] = 1;
+	}
+
+	composeLocalMatrices(begin, end);
+
+	for (uint32_t i = begin; i < end; i++) {
+		if (!m_dirty[i])
+			continue;
+
+		int32_t parent = m_parents[i];
+		if (parent < 0) {
+			m_worldMatrices[i] = m_localMatrices[i];
+			continue;
+		}
+
+		// parent * local a column at a time, every column of the result a sum of the parent columns.
+		const float* parentMatrix = &m_worldMatrices[parent][0][0];
+		const float* localMatrix = &m_localMatrices[i][0][0];
+		float* worldMatrix = &m_worldMatrices[i][0][0];
+		__m128 column0 = _mm_loadu_ps(parentMatrix);
+		__m128 column1 = _mm_loadu_ps(parentMatrix + 4);
+		__m128 column2 = _mm_loadu_ps(parentMatrix + 8);
+		__m128 column3 = _mm_loadu_ps(parentMatrix + 12);
+		for (int j = 0; j < 4; j++) {
+			const float* local = localMatrix + j * 4;
+			__m128 result = _mm_mul_ps(column0, _mm_set1_ps(local[0]));
+			result = _mm_add_ps(result, _mm_mul_ps(column1, _mm_set1_ps(local[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(column2, _mm_set1_ps(local[2])));
+			result = _mm_add_ps(result, _mm_mul_ps(column3, _mm_set1_ps(local[3])));
+			_mm_storeu_ps(worldMatrix + j * 4, result);
+		}
+	}
+}
+
+void TransformHierarchy::composeLocalMatrices(uint32_t begin, uint32_t end) {
+	// translation * rotation * scale of four nodes at once, the rotation with the same terms as glm::mat3_cast.
+	for (uint32_t i = begin; i < end; i += 4) {
+		uint32_t count = std::min(4u, end - i);
+		bool isDirty = false;
+		for (uint32_t j = 0; j < count; j++)
+			isDirty |= m_dirty[i + j] != 0;
+		if (!isDirty)
+			continue;
+
+		// the last group of a range repeats its last node.
+		float lanes[10][4];
+		const float* sources[10] = {
+			m_rotationX.data(), m_rotationY.data(), m_rotationZ.data(), m_rotationW.data(),
+			m_positionX.data(), m_positionY.data(), m_positionZ.data(),
+			m_scaleX.data(), m_scaleY.data(), m_scaleZ.data() };
+		for (int k = 0; k < 10; k++) {
+			for (uint32_t j = 0; j < 4; j++)
+				lanes[k][j] = sources[k][i + std::min(j, count - 1)];
+		}
+
+		__m128 x = _mm_loadu_ps(lanes[0]);
+		__m128 y = _mm_loadu_ps(lanes[1]);
+		__m128 z = _mm_loadu_ps(lanes[2]);
+		__m128 w = _mm_loadu_ps(lanes[3]);
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 two = _mm_set1_ps(2.0f);
+
+		__m128 xx = _mm_mul_ps(x, x);
+		__m128 yy = _mm_mul_ps(y, y);
+		__m128 zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y);
+		__m128 xz = _mm_mul_ps(x, z);
+		__m128 yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x);
+		__m128 wy = _mm_mul_ps(w, y);
+		__m128 wz = _mm_mul_ps(w, z);
+
+		// columns of the rotation, one register per row.
+		__m128 rows[4][4] = {
+			{ _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, wz)), _mm_mul_ps(two, _mm_sub_ps(xz, wy)), _mm_setzero_ps() },
+			{ _mm_mul_ps(two, _mm_sub_ps(xy, wz)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), _mm_mul_ps(two, _mm_add_ps(yz, wx)), _mm_setzero_ps() },
+			{ _mm_mul_ps(two, _mm_add_ps(xz, wy)), _mm_mul_ps(two, _mm_sub_ps(yz, wx)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), _mm_setzero_ps() },
+			{ _mm_loadu_ps(lanes[4]), _mm_loadu_ps(lanes[5]), _mm_loadu_ps(lanes[6]), one },
+		};
+
+		for (int column = 0; column < 3; column++) {
+			__m128 scale = _mm_loadu_ps(lanes[7 + column]);
+			for (int row = 0; row < 3; row++)
+				rows[column][row] = _mm_mul_ps(rows[column][row], scale);
+		}
+
+		// a transpose turns the four rows of a column into that column of each node.
+		for (int column = 0; column < 4; column++) {
+			_MM_TRANSPOSE4_PS(rows[column][0], rows[column][1], rows[column][2], rows[column][3]);
+			for (uint32_t j = 0; j < count; j++)
+				_mm_storeu_ps(&m_localMatrices[i + j][column][0], rows[column][j]);
+		}
+	}
+}
\ No newline at end of file
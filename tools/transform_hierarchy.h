@@ -0,0 +1,94 @@
+#ifndef _TRANSFORM_HIERARCHY_H_
+#define _TRANSFORM_HIERARCHY_H_
+
+#include "../glm-master/glm/glm.hpp"
+#include "../glm-master/glm/gtc/quaternion.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// subtrees with at most this many nodes are updated by one thread, smaller neighbours are merged up to it.
+static const uint32_t kTransformTaskSize = 4096;
+
+// local translation, rotation and scale of nodes and the world matrices they build, as structure of arrays. the nodes are
+// stored depth first so every parent comes before its children and every subtree is one contiguous range; update
+// propagates the dirty flags and computes the world matrices in one pass over that order, the local matrices four
+// nodes per sse instruction, and hands independent subtrees to a pool of threads.
+//
+// nodes keep the ids passed to create, the storage order is internal.
+class TransformHierarchy {
+public:
+	TransformHierarchy() = default;
+	~TransformHierarchy() = default;
+
+	// parents[i] is the parent id of node i, or -1 for a root. fails on cycles and parents out of range.
+	bool create(const int32_t* parents, uint32_t count);
+
+	void setLocalPosition(uint32_t node, const glm::vec3& position);
+	void setLocalRotation(uint32_t node, const glm::quat& rotation);
+	void setLocalScale(uint32_t node, const glm::vec3& scale);
+	glm::vec3 getLocalPosition(uint32_t node) const;
+	glm::quat getLocalRotation(uint32_t node) const;
+	glm::vec3 getLocalScale(uint32_t node) const;
+
+	// recomputes the nodes set since the last update and everything below them, 0 threads picks the hardware concurrency.
+	void update(unsigned int threadCount = 0);
+
+	// valid after update. translation * rotation * scale of the node and all of its parents.
+	const glm::mat4& getWorldMatrix(uint32_t node) const { return m_worldMatrices[m_slots[node]]; }
+	glm::vec3 getWorldPosition(uint32_t node) const { return glm::vec3(getWorldMatrix(node)[3]); }
+	// without the scale.
+	glm::quat getWorldRotation(uint32_t node) const;
+
+	uint32_t getNodeCount() const { return (uint32_t)m_order.size(); }
+	int32_t getParent(uint32_t node) const { int32_t parent = m_parents[m_slots[node]]; return parent < 0 ? -1 : (int32_t)m_order[parent]; }
+	// node ids in storage order.
+	const std::vector<uint32_t>& getOrder() const { return m_order; }
+
+	// valid after update. the boxes of every node in its own space, moved to model space by the world matrices and
+	// merged into every ancestor, so a node's result encloses its whole subtree. an empty box has min > max, and so
+	// does the result of a subtree without any.
+	void computeSubtreeBounds(const glm::vec3* localMin, const glm::vec3* localMax, glm::vec3* resultMin, glm::vec3* resultMax) const;
+
+private:
+	struct Task {
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	void buildTasks();
+	// slots begin..end in order, their parents outside the range must be up to date.
+	void updateRange(uint32_t begin, uint32_t end);
+	void composeLocalMatrices(uint32_t begin, uint32_t end);
+	void markDirty(uint32_t slot) { m_dirty[slot] = 1; m_firstDirty = std::min(m_firstDirty, slot); }
+
+	// per node id.
+	std::vector<uint32_t> m_slots;
+
+	// per slot.
+	std::vector<uint32_t> m_order;
+	std::vector<int32_t> m_parents;
+	std::vector<uint32_t> m_subtreeSizes;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_rotationW;
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	std::vector<glm::mat4> m_localMatrices;
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<uint8_t> m_dirty;
+
+	// subtrees updated in parallel, and the ancestors above them updated first on the calling thread.
+	std::vector<Task> m_tasks;
+	std::vector<uint32_t> m_serialSlots;
+	// the smallest dirty slot, everything before it is skipped. the node count when nothing is dirty.
+	uint32_t m_firstDirty = 0;
+};
+
+#endif
\ No newline at end of file